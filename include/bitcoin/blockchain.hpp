@@ -26,27 +26,61 @@
 #include <bitcoin/blockchain/interface/block_chain.hpp>
 #include <bitcoin/blockchain/interface/fast_chain.hpp>
 #include <bitcoin/blockchain/interface/safe_chain.hpp>
+#include <bitcoin/blockchain/organizers/block_importer.hpp>
 #include <bitcoin/blockchain/organizers/block_organizer.hpp>
 #include <bitcoin/blockchain/organizers/header_organizer.hpp>
 #include <bitcoin/blockchain/organizers/transaction_organizer.hpp>
+#include <bitcoin/blockchain/pools/address_indexer.hpp>
 #include <bitcoin/blockchain/pools/anchor_converter.hpp>
+#include <bitcoin/blockchain/pools/candidate_cache.hpp>
 #include <bitcoin/blockchain/pools/child_closure_calculator.hpp>
 #include <bitcoin/blockchain/pools/conflicting_spend_remover.hpp>
+#include <bitcoin/blockchain/pools/download_bitmap.hpp>
+#include <bitcoin/blockchain/pools/download_cache.hpp>
+#include <bitcoin/blockchain/pools/fee_estimator.hpp>
+#include <bitcoin/blockchain/pools/filter_index.hpp>
+#include <bitcoin/blockchain/pools/hash_filter.hpp>
+#include <bitcoin/blockchain/pools/hash_index.hpp>
+#include <bitcoin/blockchain/pools/hash_set.hpp>
+#include <bitcoin/blockchain/pools/header_array.hpp>
 #include <bitcoin/blockchain/pools/header_branch.hpp>
 #include <bitcoin/blockchain/pools/header_entry.hpp>
 #include <bitcoin/blockchain/pools/header_pool.hpp>
+#include <bitcoin/blockchain/pools/header_window.hpp>
+#include <bitcoin/blockchain/pools/memory_budget.hpp>
+#include <bitcoin/blockchain/pools/merkle_cache.hpp>
+#include <bitcoin/blockchain/pools/notification_queue.hpp>
+#include <bitcoin/blockchain/pools/payment_subscriber.hpp>
 #include <bitcoin/blockchain/pools/parent_closure_calculator.hpp>
 #include <bitcoin/blockchain/pools/priority_calculator.hpp>
+#include <bitcoin/blockchain/pools/spend_index.hpp>
 #include <bitcoin/blockchain/pools/stack_evaluator.hpp>
+#include <bitcoin/blockchain/pools/stage_metrics.hpp>
+#include <bitcoin/blockchain/pools/state_pool.hpp>
+#include <bitcoin/blockchain/pools/template_tree.hpp>
+#include <bitcoin/blockchain/pools/thread_binder.hpp>
+#include <bitcoin/blockchain/pools/tip_snapshot.hpp>
+#include <bitcoin/blockchain/pools/transaction_cache.hpp>
 #include <bitcoin/blockchain/pools/transaction_entry.hpp>
 #include <bitcoin/blockchain/pools/transaction_order_calculator.hpp>
 #include <bitcoin/blockchain/pools/transaction_pool.hpp>
 #include <bitcoin/blockchain/pools/transaction_pool_state.hpp>
+#include <bitcoin/blockchain/pools/validation_trace.hpp>
+#include <bitcoin/blockchain/pools/work_index.hpp>
+#include <bitcoin/blockchain/pools/workload_recorder.hpp>
+#include <bitcoin/blockchain/populate/compact_output.hpp>
+#include <bitcoin/blockchain/populate/pending_outputs.hpp>
 #include <bitcoin/blockchain/populate/populate_base.hpp>
 #include <bitcoin/blockchain/populate/populate_block.hpp>
 #include <bitcoin/blockchain/populate/populate_chain_state.hpp>
 #include <bitcoin/blockchain/populate/populate_header.hpp>
 #include <bitcoin/blockchain/populate/populate_transaction.hpp>
+#include <bitcoin/blockchain/populate/utxo_cache.hpp>
+#include <bitcoin/blockchain/validate/abort_token.hpp>
+#include <bitcoin/blockchain/validate/input_scheduler.hpp>
+#include <bitcoin/blockchain/validate/merkle_builder.hpp>
+#include <bitcoin/blockchain/validate/script_cache.hpp>
+#include <bitcoin/blockchain/validate/template_verifier.hpp>
 #include <bitcoin/blockchain/validate/validate_block.hpp>
 #include <bitcoin/blockchain/validate/validate_header.hpp>
 #include <bitcoin/blockchain/validate/validate_input.hpp>
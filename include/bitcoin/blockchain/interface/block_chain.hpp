@@ -30,14 +30,40 @@
 #include <bitcoin/blockchain/define.hpp>
 #include <bitcoin/blockchain/interface/fast_chain.hpp>
 #include <bitcoin/blockchain/interface/safe_chain.hpp>
+#include <bitcoin/blockchain/organizers/block_importer.hpp>
 #include <bitcoin/blockchain/organizers/block_organizer.hpp>
 #include <bitcoin/blockchain/organizers/header_organizer.hpp>
 #include <bitcoin/blockchain/organizers/transaction_organizer.hpp>
+#include <bitcoin/blockchain/pools/address_indexer.hpp>
+#include <bitcoin/blockchain/pools/candidate_cache.hpp>
+#include <bitcoin/blockchain/pools/download_bitmap.hpp>
+#include <bitcoin/blockchain/pools/fee_estimator.hpp>
+#include <bitcoin/blockchain/pools/filter_index.hpp>
+#include <bitcoin/blockchain/pools/hash_filter.hpp>
+#include <bitcoin/blockchain/pools/hash_index.hpp>
+#include <bitcoin/blockchain/pools/header_array.hpp>
 #include <bitcoin/blockchain/pools/header_branch.hpp>
 #include <bitcoin/blockchain/pools/header_pool.hpp>
+#include <bitcoin/blockchain/pools/header_window.hpp>
+#include <bitcoin/blockchain/pools/memory_budget.hpp>
+#include <bitcoin/blockchain/pools/merkle_cache.hpp>
+#include <bitcoin/blockchain/pools/notification_queue.hpp>
+#include <bitcoin/blockchain/pools/payment_subscriber.hpp>
+#include <bitcoin/blockchain/pools/spend_index.hpp>
+#include <bitcoin/blockchain/pools/stage_metrics.hpp>
+#include <bitcoin/blockchain/pools/state_pool.hpp>
+#include <bitcoin/blockchain/pools/template_tree.hpp>
+#include <bitcoin/blockchain/pools/thread_binder.hpp>
+#include <bitcoin/blockchain/pools/tip_snapshot.hpp>
+#include <bitcoin/blockchain/pools/transaction_cache.hpp>
 #include <bitcoin/blockchain/pools/transaction_pool.hpp>
+#include <bitcoin/blockchain/pools/validation_trace.hpp>
+#include <bitcoin/blockchain/pools/work_index.hpp>
+#include <bitcoin/blockchain/pools/workload_recorder.hpp>
 #include <bitcoin/blockchain/populate/populate_chain_state.hpp>
+#include <bitcoin/blockchain/populate/utxo_cache.hpp>
 #include <bitcoin/blockchain/settings.hpp>
+#include <bitcoin/blockchain/validate/script_cache.hpp>
 
 namespace libbitcoin {
 namespace blockchain {
@@ -52,6 +78,37 @@ public:
     typedef resubscriber<code, size_t, header_const_ptr_list_const_ptr,
         header_const_ptr_list_const_ptr> header_subscriber;
     typedef resubscriber<code, transaction_const_ptr> transaction_subscriber;
+    typedef resubscriber<code, size_t> template_subscriber;
+
+    // Locator of the top candidate, rebuilt as the top candidate moves.
+    struct header_locator
+    {
+        typedef std::shared_ptr<const header_locator> ptr;
+        chain::block::indexes heights;
+        hash_list hashes;
+    };
+
+    /// An immutable view of chain properties, published by each writer once
+    /// its indexes are updated. A reader that takes one view sees a single
+    /// consistent chain (even during a reorganization) without the lock.
+    /// Each property getter is one load of the current view.
+    struct chain_view
+    {
+        typedef std::shared_ptr<const chain_view> ptr;
+
+        /// Incremented by each publication.
+        size_t version;
+
+        config::checkpoint fork_point;
+        uint256_t candidate_work;
+        uint256_t confirmed_work;
+        chain::chain_state::ptr top_candidate_state;
+        chain::chain_state::ptr top_valid_candidate_state;
+        chain::chain_state::ptr next_confirmed_state;
+        hash_index::snapshot::ptr candidate_hashes;
+        hash_index::snapshot::ptr confirmed_hashes;
+        header_locator::ptr locator;
+    };
 
     /// Relay transactions is network setting that is passed through to block
     /// population as an optimization. This can be removed once there is an
@@ -115,6 +172,10 @@ public:
     /// Get block hash of an empty block, false if missing or failed.
     bool get_downloadable(hash_digest& out_hash, size_t height) const;
 
+    /// Get up to count downloadable candidate blocks at or above the height.
+    void get_downloadable(config::checkpoint::list& out_blocks, size_t height,
+        size_t count) const;
+
     /// Get block hash of an unvalidated block, false if empty/failed/valid.
     bool get_validatable(hash_digest& out_hash, size_t height) const;
 
@@ -137,6 +198,17 @@ public:
     bool populate_output(const chain::output_point& outpoint,
         size_t fork_height, bool candidate) const;
 
+    /// Get the outputs that are referenced by the outpoints, in store order.
+    /// Sets metadata based on fork point. 
+    /// Returns the number of previous transactions read from the store.
+    size_t populate_outputs(const outpoints& prevouts, size_t fork_height,
+        bool candidate) const;
+
+    /// Populate prevouts of pooled txs of a block extending the confirmed top.
+    /// Returns the number of inputs populated.
+    size_t populate_pooled_outputs(const chain::block& block,
+        std::vector<bool>& out_populated) const;
+
     /// Get state (flags) of candidate or confirmed block by height.
     uint8_t get_block_state(size_t height, bool candidate) const;
 
@@ -172,6 +244,10 @@ public:
     /// Set the block validation state and mark spent outputs.
     code candidate(block_const_ptr block);
 
+    /// Set the validation state of a contiguous run of checkpointed blocks
+    /// and mark spent outputs, advancing the top valid candidate once.
+    code candidate(block_const_ptr_list_const_ptr blocks);
+
     /// Reorganize the block index to the fork point, unmark index spends.
     code reorganize(block_const_ptr_list_const_ptr branch_cache,
         size_t branch_height);
@@ -247,6 +323,14 @@ public:
     void fetch_block(const hash_digest& hash, bool witness,
         block_fetch_handler handler) ;
 
+    /// fetch the wire serialization of a block by height.
+    void fetch_block_raw(size_t height, bool witness,
+        raw_block_fetch_handler handler) const;
+
+    /// fetch the wire serialization of a block by hash.
+    void fetch_block_raw(const hash_digest& hash, bool witness,
+        raw_block_fetch_handler handler) const;
+
     /// fetch block header by height.
     void fetch_block_header(size_t height,
         block_header_fetch_handler handler) const;
@@ -271,6 +355,13 @@ public:
     void fetch_compact_block(const hash_digest& hash,
         compact_block_fetch_handler handler) const;
 
+    /// fetch the basic filter of a confirmed block, by block height.
+    void fetch_filter(size_t height, filter_fetch_handler handler) const;
+
+    /// fetch up to count filter headers of confirmed blocks, from height.
+    void fetch_filter_headers(size_t height, size_t count,
+        filter_headers_fetch_handler handler) const;
+
     /// fetch height of block by hash.
     void fetch_block_height(const hash_digest& hash,
         block_height_fetch_handler handler) const;
@@ -278,6 +369,9 @@ public:
     /// fetch height of latest block.
     void fetch_last_height(last_height_fetch_handler handler) const;
 
+    /// The block body (with witness) at the height is served (not pruned).
+    bool is_available(size_t height, bool witness) const;
+
     /// fetch transaction by hash.
     void fetch_transaction(const hash_digest& hash, bool require_confirmed,
         bool witness, transaction_fetch_handler handler) const;
@@ -315,6 +409,12 @@ public:
     void fetch_history(const short_hash& address_hash, size_t limit,
         size_t from_height, history_fetch_handler handler) const;
 
+    /// fetch a page of history starting at the cursor (zero for first page).
+    /// The handler next cursor resumes the history, or is zero if complete.
+    void fetch_history_page(const short_hash& address_hash, size_t cursor,
+        size_t page_size, size_t from_height,
+        history_page_fetch_handler handler) const;
+
     /// fetch stealth results.
     void fetch_stealth(const binary& filter, size_t from_height,
         stealth_fetch_handler handler) const;
@@ -322,13 +422,22 @@ public:
     // Transaction Pool.
     //-------------------------------------------------------------------------
 
-    /// Fetch a merkle block for the maximal fee block template.
-    void fetch_template(merkle_block_fetch_handler handler) const;
+    /// Fetch the block template above the top confirmed block, as a merkle
+    /// block of the header and all tx hashes, with the coinbase tx and its
+    /// merkle branch (for coinbase-only refresh) and the template height.
+    void fetch_template(template_fetch_handler handler) const;
 
     /// Fetch an inventory vector for a rational "mempool" message response.
     void fetch_mempool(size_t count_limit, uint64_t minimum_fee,
         inventory_fetch_handler handler) const;
 
+    /// Estimated satoshis per kilobyte to confirm within target blocks.
+    uint64_t estimate_fee(size_t target_blocks) const;
+
+    /// Get the compact block txs from the pool, nullptr where unmatched.
+    transaction_const_ptr_list reconstruct(
+        compact_block_const_ptr block) const;
+
     // Filters.
     //-------------------------------------------------------------------------
 
@@ -351,6 +460,19 @@ public:
     /// Subscribe to memory pool additions, get transaction.
     void subscribe_transactions(transaction_handler&& handler);
 
+    /// Subscribe to block template changes (tip or pool), get height.
+    void subscribe_template(template_handler&& handler);
+
+    /// Subscribe to the txs of confirmed block reorganizations that pay to or
+    /// spend from any of the addresses, get matching txs/height.
+    void subscribe_blocks(const address_filter& addresses,
+        payment_block_handler&& handler);
+
+    /// Subscribe to the memory pool additions that pay to or spend from any
+    /// of the addresses, get transaction.
+    void subscribe_transactions(const address_filter& addresses,
+        transaction_handler&& handler);
+
     /// Send null data success notification to all subscribers.
     void unsubscribe();
 
@@ -363,15 +485,35 @@ public:
     /// Organize a header into the candidate chain and organize accordingly.
     void organize(header_const_ptr header, result_handler handler);
 
+    /// Organize a contiguous run of headers into the candidate chain.
+    void organize(headers_const_ptr headers, result_handler handler);
+
     /// Store a transaction to the pool.
     void organize(transaction_const_ptr tx, result_handler handler);
 
+    /// Store a set of transactions to the pool, with a result for each tx.
+    void organize(transaction_const_ptr_list_const_ptr txs,
+        result_list_handler handler);
+
+    /// Import the blocks of local files in order (blk*.dat or raw), storing
+    /// concurrently on all cores. Not thread safe (one import at a time).
+    code import(const block_importer::paths& files, uint32_t identifier);
+
     // Properties.
     //-------------------------------------------------------------------------
 
     /// Get a reference to the blockchain configuration settings.
     const settings& chain_settings() const;
 
+    /// Get the last published chain view (empty until started).
+    chain_view::ptr view() const;
+
+    /// Get the latency histograms of each validation stage.
+    const stage_metrics& metrics() const;
+
+    /// Get the memory accounting of pools and caches.
+    const memory_budget& budget() const;
+
 protected:
 
     // Determine if work should terminate early with service stopped code.
@@ -383,33 +525,79 @@ protected:
         header_const_ptr_list_const_ptr outgoing);
     void notify(size_t fork_height, block_const_ptr_list_const_ptr incoming,
         block_const_ptr_list_const_ptr outgoing);
+    void notify_template(size_t height);
 
 private:
+    void enroll_memory();
+
     // Properties.
     uint256_t candidate_work() const;
     uint256_t confirmed_work() const;
 
-    bool set_fork_point();
-    bool set_candidate_work();
-    bool set_confirmed_work();
-    bool set_top_candidate_state();
-    bool set_top_valid_candidate_state();
-    bool set_next_confirmed_state();
-
-    void set_fork_point(const config::checkpoint& fork);
-    void set_candidate_work(const uint256_t& work_above_fork);
-    void set_confirmed_work(const uint256_t& work_above_fork);
-    void set_top_candidate_state(chain::chain_state::ptr top);
-    void set_top_valid_candidate_state(chain::chain_state::ptr top);
-    void set_next_confirmed_state(chain::chain_state::ptr top);
+    bool load_tip_snapshot(chain_view& next);
+    bool save_tip_snapshot() const;
+    bool set_fork_point(chain_view& next);
+    bool set_indexes(const chain_view& next, bool windows);
+    bool set_work_index(work_index& index, size_t above_height,
+        bool candidate);
+    bool set_header_window(header_window& window, bool candidate);
+    bool set_hash_index(hash_index& index, bool candidate);
+    bool set_download_bitmap(size_t above_height);
+    bool set_candidate_work(chain_view& next);
+    bool set_confirmed_work(chain_view& next);
+    bool set_top_candidate_state(chain_view& next);
+    bool set_top_valid_candidate_state(chain_view& next);
+    bool set_next_confirmed_state(chain_view& next);
+
+    // Publish the next view of properties (writers only).
+    void publish(const chain_view& next);
+
+    // Transaction deserialization shared by a parallel block read.
+    struct block_read;
+    struct output_read;
+
+    header_locator::ptr make_header_locator(size_t top_height) const;
 
     // Utilities.
-    void index_block(block_const_ptr block);
-    void index_transaction(transaction_const_ptr tx);
+    void push_indexes(const chain::header& header, bool candidate);
+    void pop_indexes(size_t height, bool candidate);
+    bool get_height(size_t& out_height, const hash_digest& hash,
+        const hash_index::snapshot& index) const;
+    void populate_filter();
+    bool index_blocks(const block_const_ptr_list& blocks);
+    bool index_transactions(const transaction_const_ptr_list& txs);
+    block_const_ptr get_indexable_block(size_t height) const;
+    bool start_filters();
+    void push_filter(block_const_ptr block, size_t height);
+    void pop_filters(size_t height);
+    bool set_header_array();
+    bool start_spends();
+    void index_spends(size_t fork_height,
+        block_const_ptr_list_const_ptr incoming,
+        block_const_ptr_list_const_ptr outgoing);
+    bool get_mapped_headers(message::headers& out_headers,
+        const hash_index::snapshot& index, size_t begin, size_t end) const;
+    transaction_const_ptr make_coinbase(const chain::chain_state& state,
+        uint64_t fees, const hash_digest& witness_root) const;
     bool get_transactions(chain::transaction::list& out_transactions,
         const database::block_result& result, bool witness) const;
+    static void read_transactions(std::shared_ptr<block_read> read);
+    static void read_outputs(std::shared_ptr<output_read> read);
+    static void populate_output(const chain::output_point& outpoint,
+        const database::transaction_result& result, size_t fork_height,
+        bool candidate);
+    transaction_const_ptr get_transaction(
+        const database::transaction_result& result, bool witness) const;
+    std::shared_ptr<data_chunk> get_block_raw(
+        const database::block_result& result, bool witness) const;
+    bool resolve_history(chain::payment_record::list& payments,
+        size_t from_height) const;
     bool get_transaction_hashes(hash_list& out_hashes,
         const database::block_result& result) const;
+    bool get_merkle_hashes(hash_list& out_hashes,
+        const database::block_result& result) const;
+    compact_block_ptr get_compact_block(
+        const database::block_result& result) const;
 
     // This is protected by mutex.
     database::data_base database_;
@@ -417,14 +605,11 @@ private:
     // These are thread safe.
     std::atomic<bool> stopped_;
 
-    bc::atomic<config::checkpoint> fork_point_;
-    bc::atomic<uint256_t> candidate_work_;
-    bc::atomic<uint256_t> confirmed_work_;
     bc::atomic<block_const_ptr> last_block_;
     bc::atomic<transaction_const_ptr> last_transaction_;
-    bc::atomic<chain::chain_state::ptr> top_candidate_state_;
-    bc::atomic<chain::chain_state::ptr> top_valid_candidate_state_;
-    bc::atomic<chain::chain_state::ptr> next_confirmed_state_;
+
+    // All properties are read from (and replaced as) one view.
+    bc::atomic<chain_view::ptr> view_;
 
     const settings& settings_;
      bc::settings& bitcoin_settings_;
@@ -434,10 +619,33 @@ private:
     mutable prioritized_mutex validation_mutex_;
     mutable threadpool priority_pool_;
     mutable dispatcher priority_;
-    mutable dispatcher dispatch_;
+    mutable threadpool io_pool_;
+    mutable dispatcher io_;
+    stage_metrics metrics_;
+    validation_trace trace_;
+    workload_recorder workload_;
+    memory_budget memory_budget_;
 
     header_pool header_pool_;
+    script_cache script_cache_;
     transaction_pool transaction_pool_;
+    fee_estimator fee_estimator_;
+    utxo_cache utxo_cache_;
+    candidate_cache candidate_cache_;
+    work_index candidate_work_index_;
+    work_index confirmed_work_index_;
+    header_window candidate_window_;
+    header_window confirmed_window_;
+    const tip_snapshot tip_snapshot_;
+    hash_index candidate_hashes_;
+    hash_index confirmed_hashes_;
+    hash_filter hash_filter_;
+    download_bitmap candidate_downloads_;
+    mutable merkle_cache merkle_cache_;
+    mutable transaction_cache transaction_cache_;
+    mutable template_tree template_tree_;
+    mutable template_tree witness_tree_;
+    state_pool::ptr state_pool_;
 
     block_organizer block_organizer_;
     header_organizer header_organizer_;
@@ -446,6 +654,15 @@ private:
     block_subscriber::ptr block_subscriber_;
     header_subscriber::ptr header_subscriber_;
     transaction_subscriber::ptr transaction_subscriber_;
+    template_subscriber::ptr template_subscriber_;
+    payment_subscriber::ptr payment_subscriber_;
+
+    // Declared last so that it is stopped before subscribers are destroyed.
+    notification_queue notifications_;
+    address_indexer indexer_;
+    filter_index filters_;
+    header_array headers_;
+    spend_index spends_;
 };
 
 } // namespace blockchain
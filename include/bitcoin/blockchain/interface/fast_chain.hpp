@@ -20,6 +20,7 @@
 #define LIBBITCOIN_BLOCKCHAIN_FAST_CHAIN_HPP
 
 #include <cstddef>
+#include <vector>
 #include <bitcoin/database.hpp>
 #include <bitcoin/blockchain/define.hpp>
 #include <bitcoin/blockchain/pools/header_branch.hpp>
@@ -30,13 +31,16 @@ namespace blockchain {
 /// A low level interface for encapsulation of the blockchain database.
 /// Caller must ensure the database is not otherwise in use during these calls.
 /// Implementations are NOT expected to be thread safe with the exception
-/// that the import method may itself be called concurrently.
+/// that the update method may itself be called concurrently (bulk import).
 class BCB_API fast_chain
 {
 public:
     // This avoids conflict with the result_handler in safe_chain.
     typedef handle0 complete_handler;
 
+    // Outpoints are referenced so that their metadata can be populated.
+    typedef std::vector<const chain::output_point*> outpoints;
+
     // Readers.
     // ------------------------------------------------------------------------
     // Thread safe.
@@ -88,6 +92,10 @@ public:
     virtual bool get_downloadable(hash_digest& out_hash,
         size_t height) const = 0;
 
+    /// Get up to count downloadable candidate blocks at or above the height.
+    virtual void get_downloadable(config::checkpoint::list& out_blocks,
+        size_t height, size_t count) const = 0;
+
     /// Get block hash of an unvalidated block, false if empty/failed/valid.
     virtual bool get_validatable(hash_digest& out_hash,
         size_t height) const = 0;
@@ -113,6 +121,19 @@ public:
     virtual bool populate_output(const chain::output_point& outpoint,
         size_t fork_height, bool candidate) const = 0;
 
+    /// Sets metadata based on fork point.
+    /// Get the outputs referenced by the outpoints, deduplicated by previous
+    /// transaction and read in store order (missing outputs are populated).
+    /// Returns the number of previous transactions read from the store.
+    virtual size_t populate_outputs(const outpoints& prevouts,
+        size_t fork_height, bool candidate) const = 0;
+
+    /// Populate the prevouts of pooled txs of a block extending the confirmed
+    /// top from their pool validation, flagging each populated input
+    /// (non-coinbase inputs in block order). Returns the number populated.
+    virtual size_t populate_pooled_outputs(const chain::block& block,
+        std::vector<bool>& out_populated) const = 0;
+
     /// Get state (flags) of candidate or confirmed block by height.
     virtual uint8_t get_block_state(size_t height, bool candidate) const = 0;
 
@@ -144,12 +165,17 @@ public:
     virtual code invalidate( chain::header& header,
         const code& error) = 0;
 
-    /// Set the block validation state and all candidate chain ancestors.
+    /// Set the validation state of the candidate and all its descendants,
+    /// popping them from the candidate index in one reorganization.
     virtual code invalidate(block_const_ptr block, size_t height) = 0;
 
     /// Set the block validation state and mark spent outputs.
     virtual code candidate(block_const_ptr block) = 0;
 
+    /// Set the validation state of a contiguous run of checkpointed blocks
+    /// and mark spent outputs, advancing the top valid candidate once.
+    virtual code candidate(block_const_ptr_list_const_ptr blocks) = 0;
+
     /// Reorganize the block index to the fork point.
     virtual code reorganize(block_const_ptr_list_const_ptr branch_cache,
         size_t branch_height) = 0;
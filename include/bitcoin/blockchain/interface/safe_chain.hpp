@@ -23,6 +23,7 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <unordered_set>
 #include <vector>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/blockchain/define.hpp>
@@ -37,6 +38,7 @@ class BCB_API safe_chain
 {
 public:
     typedef handle0 result_handler;
+    typedef handle1<std::vector<code>> result_list_handler;
 
     /// Object fetch handlers.
     typedef handle1<size_t> last_height_fetch_handler;
@@ -46,10 +48,14 @@ public:
     typedef handle1<chain::payment_record::list> history_fetch_handler;
     typedef handle1<chain::stealth_record::list> stealth_fetch_handler;
     typedef handle2<size_t, size_t> transaction_index_fetch_handler;
+    typedef handle2<chain::payment_record::list, size_t>
+        history_page_fetch_handler;
 
     // Smart pointer parameters must not be passed by reference.
     typedef std::function<void(const code&, block_const_ptr, size_t)>
         block_fetch_handler;
+    typedef std::function<void(const code&, std::shared_ptr<data_chunk>,
+        size_t)> raw_block_fetch_handler;
     typedef std::function<void(const code&, merkle_block_ptr, size_t)>
         merkle_block_fetch_handler;
     typedef std::function<void(const code&, compact_block_ptr, size_t)>
@@ -66,6 +72,13 @@ public:
         header_locator_fetch_handler;
     typedef std::function<void(const code&, inventory_ptr)>
         inventory_fetch_handler;
+    typedef std::function<void(const code&, std::shared_ptr<data_chunk>,
+        size_t)> filter_fetch_handler;
+    typedef std::function<void(const code&, std::shared_ptr<hash_list>,
+        size_t)> filter_headers_fetch_handler;
+    typedef std::function<void(const code&, merkle_block_ptr,
+        transaction_const_ptr, std::shared_ptr<hash_list>, size_t)>
+        template_fetch_handler;
 
     /// Subscription handlers.
     typedef std::function<bool(code, size_t, header_const_ptr_list_const_ptr,
@@ -74,6 +87,12 @@ public:
         block_const_ptr_list_const_ptr)> block_handler;
     typedef std::function<bool(code, transaction_const_ptr)>
         transaction_handler;
+    typedef std::function<bool(code, size_t)> template_handler;
+
+    /// Filtered (payment) subscriptions, by address hash.
+    typedef std::unordered_set<short_hash> address_filter;
+    typedef std::function<bool(code, size_t, transaction_const_ptr_list_const_ptr,
+        transaction_const_ptr_list_const_ptr)> payment_block_handler;
 
     // Startup and shutdown.
     // ------------------------------------------------------------------------
@@ -91,6 +110,12 @@ public:
     virtual void fetch_block(const hash_digest& hash, bool witness,
         block_fetch_handler handler)  = 0;
 
+    virtual void fetch_block_raw(size_t height, bool witness,
+        raw_block_fetch_handler handler) const = 0;
+
+    virtual void fetch_block_raw(const hash_digest& hash, bool witness,
+        raw_block_fetch_handler handler) const = 0;
+
     virtual void fetch_block_header(size_t height,
         block_header_fetch_handler handler) const = 0;
 
@@ -109,12 +134,20 @@ public:
     virtual void fetch_compact_block(const hash_digest& hash,
         compact_block_fetch_handler handler) const = 0;
 
+    virtual void fetch_filter(size_t height,
+        filter_fetch_handler handler) const = 0;
+
+    virtual void fetch_filter_headers(size_t height, size_t count,
+        filter_headers_fetch_handler handler) const = 0;
+
     virtual void fetch_block_height(const hash_digest& hash,
         block_height_fetch_handler handler) const = 0;
 
     virtual void fetch_last_height(
         last_height_fetch_handler handler) const = 0;
 
+    virtual bool is_available(size_t height, bool witness) const = 0;
+
     virtual void fetch_transaction(const hash_digest& hash,
         bool require_confirmed, bool witness,
         transaction_fetch_handler handler) const = 0;
@@ -149,15 +182,22 @@ public:
     virtual void fetch_history(const short_hash& address_hash, size_t limit,
         size_t from_height, history_fetch_handler handler) const = 0;
 
+    virtual void fetch_history_page(const short_hash& address_hash,
+        size_t cursor, size_t page_size, size_t from_height,
+        history_page_fetch_handler handler) const = 0;
+
     virtual void fetch_stealth(const binary& filter, size_t from_height,
         stealth_fetch_handler handler) const = 0;
 
     // Transaction Pool.
     //-------------------------------------------------------------------------
 
-    virtual void fetch_template(merkle_block_fetch_handler handler) const = 0;
+    virtual void fetch_template(template_fetch_handler handler) const = 0;
     virtual void fetch_mempool(size_t count_limit, uint64_t minimum_fee,
         inventory_fetch_handler handler) const = 0;
+    virtual uint64_t estimate_fee(size_t target_blocks) const = 0;
+    virtual transaction_const_ptr_list reconstruct(
+        compact_block_const_ptr block) const = 0;
 
     // Filters.
     //-------------------------------------------------------------------------
@@ -174,13 +214,22 @@ public:
     virtual void subscribe_blocks(block_handler&& handler) = 0;
     virtual void subscribe_headers(header_handler&& handler) = 0;
     virtual void subscribe_transactions(transaction_handler&& handler) = 0;
+    virtual void subscribe_template(template_handler&& handler) = 0;
+    virtual void subscribe_blocks(const address_filter& addresses,
+        payment_block_handler&& handler) = 0;
+    virtual void subscribe_transactions(const address_filter& addresses,
+        transaction_handler&& handler) = 0;
     virtual void unsubscribe() = 0;
 
     // Organizers.
     //-------------------------------------------------------------------------
 
     virtual void organize(header_const_ptr header, result_handler handler) = 0;
+    virtual void organize(headers_const_ptr headers,
+        result_handler handler) = 0;
     virtual void organize(transaction_const_ptr tx, result_handler handler) = 0;
+    virtual void organize(transaction_const_ptr_list_const_ptr txs,
+        result_list_handler handler) = 0;
     virtual code organize(block_const_ptr block, size_t height) = 0;
 
     // Properties
@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_BLOCK_IMPORTER_HPP
+#define LIBBITCOIN_BLOCKCHAIN_BLOCK_IMPORTER_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+#include <bitcoin/blockchain/interface/fast_chain.hpp>
+#include <bitcoin/blockchain/interface/safe_chain.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is NOT thread safe (one import at a time).
+/// Bulk import of blocks from local files. Blocks are read in file order and
+/// ordered onto the candidate chain (out of order blocks are parked until
+/// their parent is read). Headers of each run are organized as one branch,
+/// then the blocks are checked and stored concurrently on all threads, and
+/// validation follows in strict height order on the block organizer.
+class BCB_API block_importer
+{
+public:
+    typedef std::function<bool(block_const_ptr)> block_handler;
+    typedef std::vector<boost::filesystem::path> paths;
+
+    /// Construct an importer of up to limit concurrently stored blocks.
+    block_importer(fast_chain& chain, safe_chain& organizer, size_t threads,
+        size_t limit, const asio::duration& commit_latency);
+
+    /// Import the blocks of the files in order, returning once all blocks that
+    /// connect to the candidate chain are stored (validation may follow).
+    /// The identifier is the network magic of blk*.dat style records.
+    code import(const paths& files, uint32_t identifier);
+
+    /// The number of blocks stored by the last import.
+    size_t imported() const;
+
+    /// The number of blocks of the last import not stored (unconnected,
+    /// competing or invalid headers).
+    size_t skipped() const;
+
+    /// Read the blocks of a file in order, as blk*.dat style records (magic,
+    /// size, block) if the file starts with the identifier, otherwise as raw
+    /// serialized blocks. False if malformed or if the handler returns false.
+    static bool read(const boost::filesystem::path& file, uint32_t identifier,
+        block_handler handler);
+
+private:
+    typedef std::pair<block_const_ptr, size_t> entry;
+
+    bool handle(block_const_ptr block, dispatcher& dispatch);
+    void extend(block_const_ptr block, dispatcher& dispatch);
+    bool flush(dispatcher& dispatch);
+    void promote(dispatcher& dispatch);
+    void submit(block_const_ptr block, size_t height, dispatcher& dispatch);
+    void store(block_const_ptr block, size_t height);
+    void reset_top();
+
+    // These are thread safe.
+    fast_chain& fast_chain_;
+    safe_chain& safe_chain_;
+    const size_t threads_;
+    const size_t limit_;
+    const asio::duration commit_latency_;
+
+    // These are accessed only by the importing thread.
+    hash_digest top_hash_;
+    size_t top_height_;
+    block_const_ptr_list run_;
+    std::vector<entry> waiting_;
+    std::unordered_map<hash_digest, block_const_ptr> orphans_;
+    size_t skipped_;
+
+    // These are protected by mutex.
+    size_t pending_;
+    size_t imported_;
+    code error_;
+    mutable std::mutex mutex_;
+    std::condition_variable completed_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
@@ -26,7 +26,12 @@
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/blockchain/define.hpp>
 #include <bitcoin/blockchain/interface/fast_chain.hpp>
+#include <bitcoin/blockchain/pools/download_cache.hpp>
+#include <bitcoin/blockchain/pools/stage_metrics.hpp>
+#include <bitcoin/blockchain/pools/validation_trace.hpp>
 #include <bitcoin/blockchain/settings.hpp>
+#include <bitcoin/blockchain/validate/abort_token.hpp>
+#include <bitcoin/blockchain/validate/script_cache.hpp>
 #include <bitcoin/blockchain/validate/validate_block.hpp>
 
 namespace libbitcoin {
@@ -44,8 +49,9 @@ public:
 
     /// Construct an instance.
     block_organizer(prioritized_mutex& mutex, dispatcher& priority_dispatch,
-        threadpool& threads, fast_chain& chain, const settings& settings,
-         bc::settings& bitcoin_settings);
+        dispatcher& io_dispatch, threadpool& threads, fast_chain& chain,
+        stage_metrics& metrics, validation_trace& trace, script_cache& cache,
+        const settings& settings,  bc::settings& bitcoin_settings);
 
     // Start/stop the organizer.
     bool start();
@@ -61,20 +67,59 @@ protected:
     bool stopped() const;
 
 private:
+    typedef std::shared_ptr<std::promise<code>> promise_ptr;
+    struct window_read;
+
     // Verify sub-sequence.
     code validate(block_const_ptr block);
+    code validate(block_const_ptr block, size_t height, block_const_ptr& next,
+        abort_token::ptr& next_token, std::future<code>& next_accepted);
+    std::future<code> start_accept(block_const_ptr block,
+        block_const_ptr parent, abort_token::ptr token);
+    std::future<code> start_connect(block_const_ptr block,
+        abort_token::ptr token);
+    void handle_accepted(const code& ec, block_const_ptr block,
+        promise_ptr promise);
+    void handle_connected(const code& ec, block_const_ptr block,
+        promise_ptr promise);
+    void handle_stage(const code& ec, promise_ptr promise);
+    void record_accept(block_const_ptr block);
+    void record_connect(block_const_ptr block);
     bool handle_check(const code& ec, const hash_digest& hash, size_t height);
-    void handle_accept(const code& ec, block_const_ptr block, result_handler handler);
+    void handle_accept(const code& ec, block_const_ptr block,
+        abort_token::ptr token, result_handler handler);
     void handle_connect(const code& ec, block_const_ptr block, result_handler handler);
-    void signal_completion(const code& ec);
+    block_const_ptr get_block(size_t height);
+    void prefetch(block_const_ptr block, size_t height);
+    void prefetch_block(size_t height);
+    void speculate(block_const_ptr block, size_t height);
+    void speculate_block(block_const_ptr block);
+
+    // Bulk checkpoint sub-sequence.
+    code organize_checkpointed(size_t& height,
+        block_const_ptr_list_ptr branch_cache, size_t& branch_height,
+        size_t& branch_bytes);
+    void bound_branch(block_const_ptr_list_ptr branch_cache,
+        size_t& branch_height, size_t& branch_bytes) const;
+    block_const_ptr_list read_window(size_t height);
+    void read_window_blocks(std::shared_ptr<window_read> read);
 
     // These are thread safe.
     fast_chain& fast_chain_;
+    stage_metrics& metrics_;
+    validation_trace& trace_;
     prioritized_mutex& mutex_;
     std::atomic<bool> stopped_;
-    std::promise<code> resume_;
+    const bool pipelined_;
+    const size_t prefetch_blocks_;
+    const size_t checkpoint_window_;
+    std::atomic<size_t> prefetched_;
+    const size_t speculative_blocks_;
+    std::atomic<size_t> speculating_;
     validate_block validator_;
+    download_cache download_cache_;
     download_subscriber::ptr downloader_subscriber_;
+    mutable dispatcher dispatch_;
 };
 
 } // namespace blockchain
@@ -26,6 +26,9 @@
 #include <bitcoin/blockchain/interface/fast_chain.hpp>
 #include <bitcoin/blockchain/pools/header_branch.hpp>
 #include <bitcoin/blockchain/pools/header_pool.hpp>
+#include <bitcoin/blockchain/pools/stage_metrics.hpp>
+#include <bitcoin/blockchain/settings.hpp>
+#include <bitcoin/blockchain/validate/abort_token.hpp>
 #include <bitcoin/blockchain/validate/validate_header.hpp>
 
 namespace libbitcoin {
@@ -41,8 +44,9 @@ public:
 
     /// Construct an instance.
     header_organizer(prioritized_mutex& mutex, dispatcher& priority_dispatch,
-        threadpool& threads, fast_chain& chain, header_pool& pool,
-        const bool scrypt, bc::settings& bitcoin_settings);
+        threadpool& threads, fast_chain& chain, stage_metrics& metrics,
+        header_pool& pool, const settings& settings,
+        bc::settings& bitcoin_settings);
 
     // Start/stop the organizer.
     bool start();
@@ -51,20 +55,51 @@ public:
     /// validate and organize a header into header pool and store.
     void organize(header_const_ptr header, result_handler handler);
 
+    /// validate and organize a contiguous run of headers as one branch.
+    void organize(headers_const_ptr headers, result_handler handler);
+
 protected:
     bool stopped() const;
 
 private:
     // Verify sub-sequence.
-    void handle_accept(const code& ec, header_branch::ptr branch, result_handler handler);
+    void handle_accept(const code& ec, header_branch::ptr branch,
+        const asio::time_point& start, result_handler handler);
     void handle_complete(const code& ec, result_handler handler);
+    code organize_branch(header_branch::ptr branch, size_t count);
+
+    // Group commit sub-sequence (call only within the critical section).
+    code get_branch(header_branch::ptr& out_branch, header_const_ptr header);
+    code commit(header_branch::ptr branch);
+    code defer(header_branch::ptr branch);
+    code flush();
+    void handle_timer(const code& ec);
+
+    // Check sub-sequence.
+    void check_headers(header_const_ptr_list_const_ptr headers,
+        size_t bucket, size_t buckets, abort_token::ptr token,
+        result_handler handler) const;
+    void resume_checked(const code& ec,
+        header_const_ptr_list_const_ptr headers, result_handler handler);
+    void handle_checked(const code& ec,
+        header_const_ptr_list_const_ptr headers, result_handler handler);
 
     // These are thread safe.
+    dispatcher& priority_dispatch_;
     fast_chain& fast_chain_;
+    stage_metrics& metrics_;
     prioritized_mutex& mutex_;
     std::atomic<bool> stopped_;
     header_pool& pool_;
     validate_header validator_;
+    threadpool& threads_;
+    mutable dispatcher dispatch_;
+    const asio::duration commit_latency_;
+
+    // These are protected by the critical section.
+    header_branch::ptr pending_;
+    deadline::ptr timer_;
+    code failure_;
 };
 
 } // namespace blockchain
@@ -22,14 +22,16 @@
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
-#include <future>
 #include <memory>
+#include <vector>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/blockchain/define.hpp>
 #include <bitcoin/blockchain/interface/fast_chain.hpp>
 #include <bitcoin/blockchain/interface/safe_chain.hpp>
+#include <bitcoin/blockchain/pools/stage_metrics.hpp>
 #include <bitcoin/blockchain/pools/transaction_pool.hpp>
 #include <bitcoin/blockchain/settings.hpp>
+#include <bitcoin/blockchain/validate/script_cache.hpp>
 #include <bitcoin/blockchain/validate/validate_transaction.hpp>
 
 namespace libbitcoin {
@@ -41,14 +43,17 @@ class BCB_API transaction_organizer
 {
 public:
     typedef handle0 result_handler;
+    typedef safe_chain::result_list_handler result_list_handler;
     typedef std::shared_ptr<transaction_organizer> ptr;
     typedef safe_chain::inventory_fetch_handler inventory_fetch_handler;
     typedef safe_chain::merkle_block_fetch_handler merkle_block_fetch_handler;
 
     /// Construct an instance.
     transaction_organizer(prioritized_mutex& mutex,
-        dispatcher& priority_dispatch, threadpool& threads, fast_chain& chain,
-        transaction_pool& pool, const settings& settings);
+        dispatcher& priority_dispatch, dispatcher& io_dispatch,
+        threadpool& threads, fast_chain& chain, stage_metrics& metrics,
+        transaction_pool& pool, script_cache& cache,
+        const settings& settings);
 
     // Start/stop the organizer.
     bool start();
@@ -58,24 +63,66 @@ public:
     void organize(transaction_const_ptr tx, result_handler handler,
         uint64_t max_money);
 
+    /// validate and organize a set of transactions, in dependency order, with
+    /// a result for each tx aligned with the set.
+    void organize(transaction_const_ptr_list_const_ptr txs,
+        result_list_handler handler, uint64_t max_money);
+
 protected:
     bool stopped() const;
     uint64_t price(transaction_const_ptr tx) const;
 
 private:
+    // The state of a set organization, carried across its generations.
+    struct set_sequence
+    {
+        transaction_const_ptr_list_const_ptr txs;
+        validate_transaction::result_list results;
+        std::vector<size_t> parents;
+        std::vector<std::vector<size_t>> children;
+        std::vector<size_t> generation;
+        std::vector<size_t> mapping;
+        transaction_const_ptr_list_const_ptr incoming;
+        validate_transaction::result_list_ptr outcomes;
+        result_list_handler handler;
+    };
+
+    typedef std::shared_ptr<set_sequence> set_sequence_ptr;
+
+    // Organize sub-sequence.
+    void validate(transaction_const_ptr tx, result_handler handler);
+    void resume(const code& ec, transaction_const_ptr tx,
+        result_handler handler);
+    void handle_validated(const code& ec, transaction_const_ptr tx,
+        result_handler handler);
+    void organize_generation(set_sequence_ptr sequence);
+    static void next_generation(set_sequence& sequence);
+    void validate(set_sequence_ptr sequence);
+    void resume_set(const code& ec, set_sequence_ptr sequence);
+    void handle_validated_set(const code& ec, set_sequence_ptr sequence);
+    code store(transaction_const_ptr tx);
+
     // Verify sub-sequence.
-    void handle_accept(const code& ec, transaction_const_ptr tx, result_handler handler);
-    void handle_connect(const code& ec, transaction_const_ptr tx, result_handler handler);
-    void signal_completion(const code& ec);
+    void handle_accept_set(const code& ec,
+        transaction_const_ptr_list_const_ptr txs,
+        validate_transaction::result_list_ptr results,
+        result_handler handler);
+    void handle_accept(const code& ec, transaction_const_ptr tx,
+        const asio::time_point& start, result_handler handler);
+    void handle_connected(const code& ec, const asio::time_point& start,
+        result_handler handler);
+    void handle_connect(const code& ec, result_handler handler);
 
     // These are thread safe.
     fast_chain& fast_chain_;
+    stage_metrics& metrics_;
     prioritized_mutex& mutex_;
     std::atomic<bool> stopped_;
-    std::promise<code> resume_;
     const settings& settings_;
     transaction_pool& pool_;
+    script_cache& script_cache_;
     validate_transaction validator_;
+    mutable dispatcher dispatch_;
 };
 
 } // namespace blockchain
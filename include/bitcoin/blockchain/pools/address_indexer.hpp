@@ -0,0 +1,107 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_ADDRESS_INDEXER_HPP
+#define LIBBITCOIN_BLOCKCHAIN_ADDRESS_INDEXER_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <boost/filesystem.hpp>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Payment indexing is staged on a dedicated thread, which takes all queued
+/// blocks and txs as a batch. Push blocks while the queue is at its limit
+/// (zero is unbounded), so that the organizer cannot outpace the indexer.
+/// The height of the last indexed block is persisted after each batch, and
+/// on start blocks above it are read and indexed before any queued block.
+class BCB_API address_indexer
+{
+public:
+    typedef std::function<bool(const block_const_ptr_list&)> block_handler;
+    typedef std::function<bool(const transaction_const_ptr_list&)>
+        transaction_handler;
+    typedef std::function<block_const_ptr(size_t)> fetch_handler;
+
+    /// Construct a stopped indexer, persisting its height to the file.
+    /// Handlers return false on store failure, which stops the indexer.
+    address_indexer(const boost::filesystem::path& file, size_t limit,
+        block_handler index_blocks, transaction_handler index_transactions,
+        fetch_handler fetch_block);
+
+    /// Stop and join the indexing thread.
+    ~address_indexer();
+
+    /// Start the indexing thread, first catching up through the given top
+    /// height (from the persisted height) using the fetch handler.
+    void start(size_t top);
+
+    /// Discard queued work and stop the indexing thread, waiting for a batch
+    /// in progress unless called from that thread. Discarded blocks are above
+    /// the persisted height, so they are indexed again on the next start.
+    void stop();
+
+    /// The height of the last indexed block (zero if none).
+    size_t height() const;
+
+    /// The number of queued blocks and txs (excluding a batch in progress).
+    size_t size() const;
+
+    /// Queue the block at the given height for indexing, false if stopped.
+    bool push(block_const_ptr block, size_t height);
+
+    /// Queue the tx for indexing, false if stopped.
+    bool push(transaction_const_ptr tx);
+
+private:
+    bool enqueue(std::unique_lock<std::mutex>& lock);
+    bool catch_up(size_t top);
+    bool read_height();
+    bool write_height(size_t height) const;
+    void index(size_t top);
+
+    // These are thread safe.
+    const boost::filesystem::path file_;
+    const size_t limit_;
+    const block_handler index_blocks_;
+    const transaction_handler index_transactions_;
+    const fetch_handler fetch_block_;
+
+    // These are protected by mutex.
+    bool stopped_;
+    size_t height_;
+    std::thread thread_;
+    std::deque<std::pair<block_const_ptr, size_t>> blocks_;
+    transaction_const_ptr_list transactions_;
+    mutable std::mutex mutex_;
+    std::condition_variable pushed_;
+    std::condition_variable popped_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
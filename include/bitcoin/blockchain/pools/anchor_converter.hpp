@@ -37,6 +37,8 @@ public:
 
     void add_bounds(transaction_const_ptr tx);
 
+    void add_bounds(const hash_digest& digest);
+
     bool within_bounds(hash_digest digest);
 
 protected:
@@ -0,0 +1,84 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_CANDIDATE_CACHE_HPP
+#define LIBBITCOIN_BLOCKCHAIN_CANDIDATE_CACHE_HPP
+
+#include <cstddef>
+#include <map>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Memory-bounded set of validated candidate blocks (with chain state) above
+/// the fork point, keyed by height, so that reorganization of a validated
+/// branch into the confirmed chain does not reread the blocks. Blocks beyond
+/// the budget are not cached, which preserves the lowest (first required)
+/// heights, and a miss implies only a store read.
+class BCB_API candidate_cache
+{
+public:
+    /// Construct a cache bounded to the given size (zero disables).
+    candidate_cache(size_t maximum_megabytes);
+
+    /// The cache is disabled.
+    bool disabled() const;
+
+    /// The number of cached blocks.
+    size_t size() const;
+
+    /// The serialized bytes of cached blocks.
+    size_t bytes() const;
+
+    /// Cache the validated candidate block (requires state).
+    void add(block_const_ptr block);
+
+    /// The cached block at the height if of the given hash, otherwise null.
+    block_const_ptr get(size_t height, const hash_digest& hash) const;
+
+    /// Remove blocks at and below the height (confirmed).
+    void prune(size_t height);
+
+    /// Remove all entries.
+    void clear();
+
+private:
+    struct entry
+    {
+        block_const_ptr block;
+        size_t bytes;
+    };
+
+    typedef std::map<size_t, entry> entries;
+
+    // This is thread safe.
+    const size_t maximum_bytes_;
+
+    // These are protected by mutex.
+    entries entries_;
+    size_t bytes_;
+    mutable shared_mutex mutex_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
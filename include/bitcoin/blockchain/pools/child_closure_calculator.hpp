@@ -19,7 +19,6 @@
 #ifndef LIBBITCOIN_CHILD_CLOSURE_CALCULATOR_HPP
 #define LIBBITCOIN_CHILD_CLOSURE_CALCULATOR_HPP
 
-#include <deque>
 #include <bitcoin/blockchain/pools/stack_evaluator.hpp>
 #include <bitcoin/blockchain/pools/transaction_pool_state.hpp>
 
@@ -32,14 +31,14 @@ public:
 
     child_closure_calculator(transaction_pool_state& state);
 
-    transaction_entry::list get_closure(transaction_entry::ptr tx);
+    /// The descendants of the tx, valid until the next call.
+    const transaction_entry::list& get_closure(transaction_entry::ptr tx);
 
 protected:
     virtual bool visit(transaction_entry::ptr element);
 
 private:
     transaction_pool_state& state_;
-    transaction_entry::list closure_;
 };
 
 } // namespace blockchain
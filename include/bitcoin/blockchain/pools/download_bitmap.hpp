@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_DOWNLOAD_BITMAP_HPP
+#define LIBBITCOIN_BLOCKCHAIN_DOWNLOAD_BITMAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// One bit per candidate height above a base height, set while the block is
+/// downloadable (neither populated nor failed), so that download scheduling
+/// does not query the store. The bitmap is maintained incrementally as
+/// headers are pushed to and popped from the candidate index, and as blocks
+/// are populated or invalidated.
+class BCB_API download_bitmap
+{
+public:
+    /// Construct an empty bitmap based at genesis.
+    download_bitmap();
+
+    /// The height below the first indexed height.
+    size_t base() const;
+
+    /// The top indexed height (base if empty).
+    size_t top() const;
+
+    /// Clear the bitmap and set the base height.
+    void reset(size_t base_height);
+
+    /// Index the height above top as downloadable or not.
+    void push(bool downloadable);
+
+    /// Remove heights above the given height (resets if below base).
+    void pop(size_t height);
+
+    /// Mark the indexed height as not downloadable (populated or failed).
+    void clear(size_t height);
+
+    /// True if the height is indexed and downloadable.
+    bool get(size_t height) const;
+
+    /// Get up to count downloadable heights at or above the given height.
+    void get(std::vector<size_t>& out_heights, size_t height,
+        size_t count) const;
+
+private:
+    // These are protected by mutex.
+    size_t base_;
+    size_t size_;
+    std::vector<uint64_t> words_;
+    mutable shared_mutex mutex_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
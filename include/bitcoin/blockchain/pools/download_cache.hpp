@@ -0,0 +1,74 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_DOWNLOAD_CACHE_HPP
+#define LIBBITCOIN_BLOCKCHAIN_DOWNLOAD_CACHE_HPP
+
+#include <cstddef>
+#include <deque>
+#include <unordered_map>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Bounded set of downloaded blocks awaiting validation, keyed by hash, so
+/// that the validator can avoid rebuilding the block from the store. Entries
+/// are evicted oldest first, and a miss implies only a store read.
+class BCB_API download_cache
+{
+public:
+    /// Construct a cache bounded to the given block count (zero disables).
+    download_cache(size_t maximum_blocks);
+
+    /// The maximum number of cached blocks.
+    size_t capacity() const;
+
+    /// The number of cached blocks.
+    size_t size() const;
+
+    /// The block of the given hash is cached.
+    bool exists(const hash_digest& hash) const;
+
+    /// Cache the downloaded block, evicting the oldest if at capacity.
+    void add(block_const_ptr block);
+
+    /// Remove and return the block of the given hash, or null if not cached.
+    block_const_ptr take(const hash_digest& hash);
+
+    /// Remove all entries.
+    void clear();
+
+private:
+    typedef std::unordered_map<hash_digest, block_const_ptr> blocks;
+
+    // This is thread safe.
+    const size_t maximum_blocks_;
+
+    // These are protected by mutex.
+    blocks blocks_;
+    std::deque<hash_digest> order_;
+    mutable shared_mutex mutex_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,114 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_FEE_ESTIMATOR_HPP
+#define LIBBITCOIN_BLOCKCHAIN_FEE_ESTIMATOR_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Feerate estimation from the confirmation delay of pooled txs. Each pooled
+/// tx is tracked in a feerate bucket (log spaced, in satoshis per kilobyte)
+/// from the height at which it could first confirm. Upon each confirmed block
+/// its tracked txs are counted as confirmed within each target at or above
+/// their delay, and tracked txs reaching each target age unconfirmed are
+/// counted as failed for that target. Counts decay with each block, and the
+/// estimates are recomputed with each block, so that each is read in constant
+/// time. Blocks popped from the confirmed chain are not unwound.
+class BCB_API fee_estimator
+  : noncopyable
+{
+public:
+    /// The largest confirmation target (in blocks).
+    static const size_t maximum_target = 25;
+
+    /// The number of feerate buckets.
+    static const size_t buckets = 128;
+
+    /// The lower bound of the first bucket (one satoshi per byte).
+    static const uint64_t minimum_rate = 1000;
+
+    /// Construct an empty estimator.
+    fee_estimator();
+
+    /// Track the pooled tx from the height at which it could first confirm.
+    /// Prevouts must be populated, as these are required to compute its fee.
+    void add(transaction_const_ptr tx, size_t height);
+
+    /// Account the confirmed block at the height (call in height order).
+    void confirm(block_const_ptr block, size_t height);
+
+    /// The lowest feerate (satoshis per kilobyte) at which txs have confirmed
+    /// within the target (clamped to [1, maximum_target]), zero if unknown.
+    uint64_t estimate(size_t target_blocks) const;
+
+    /// The number of tracked (unconfirmed) txs.
+    size_t size() const;
+
+    /// The feerate (satoshis per kilobyte) of the tx.
+    static uint64_t rate(const chain::transaction& tx);
+
+    /// The bucket of a feerate.
+    static size_t bucket(uint64_t rate);
+
+    /// The lowest feerate of a bucket.
+    static uint64_t lower_bound(size_t bucket);
+
+private:
+    struct entry
+    {
+        size_t height;
+        size_t bucket;
+    };
+
+    typedef std::array<double, buckets> counts;
+    typedef std::array<counts, maximum_target + 1> table;
+    typedef std::unordered_map<hash_digest, entry> entries;
+    typedef std::map<size_t, std::vector<hash_digest>> heights;
+
+    void decay();
+    void expire(size_t height);
+    void update();
+
+    // These are thread safe.
+    std::array<std::atomic<uint64_t>, maximum_target + 1> estimates_;
+
+    // These are protected by mutex.
+    entries entries_;
+    heights heights_;
+    table confirmed_;
+    table failed_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
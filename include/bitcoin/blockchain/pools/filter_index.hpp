@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_FILTER_INDEX_HPP
+#define LIBBITCOIN_BLOCKCHAIN_FILTER_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// BIP158 basic filters and BIP157 filter headers of the candidate chain, by
+/// height from genesis. Each filter is appended to the file with its block
+/// hash and filter header, which are also retained in memory, so a rollback
+/// truncates the file and a filter read is a single seek.
+class BCB_API filter_index
+  : noncopyable
+{
+public:
+    /// BIP158 basic filter parameters.
+    static const uint8_t rice_bits;
+    static const uint64_t false_positive_rate;
+
+    /// Construct a stopped index over the file (empty path disables).
+    filter_index(const boost::filesystem::path& file);
+
+    /// The index is disabled.
+    bool disabled() const;
+
+    /// Load the index from the file, discarding any partial last record.
+    bool start();
+
+    /// Close the file, the index is retained until the next start.
+    void stop();
+
+    /// The number of indexed blocks, which are at heights [0, size).
+    size_t size() const;
+
+    /// Index the block at the given height, replacing any at or above it.
+    /// False if not contiguous, a prevout is not populated, or write failed.
+    bool push(const chain::block& block, size_t height);
+
+    /// Remove all blocks above the given height, false if truncate failed.
+    bool pop(size_t height);
+
+    /// Get the block hash of the indexed block, false if not indexed.
+    bool get_hash(hash_digest& out_hash, size_t height) const;
+
+    /// Get the block hash and filter at the height, false if not indexed.
+    bool get_filter(data_chunk& out_filter, hash_digest& out_hash,
+        size_t height) const;
+
+    /// Get up to count filter headers from the height, and the block hash of
+    /// the last returned, false if the height is not indexed.
+    bool get_headers(hash_list& out_headers, hash_digest& out_stop_hash,
+        size_t height, size_t count) const;
+
+    /// Compute the basic filter of the block, using populated prevouts.
+    static bool compute(data_chunk& out_filter, const chain::block& block);
+
+    /// The filter header from the filter and the previous filter header.
+    static hash_digest to_header(const data_chunk& filter,
+        const hash_digest& previous);
+
+    /// The filter of the block of the given hash may contain the item.
+    static bool match(const data_chunk& filter, const hash_digest& block_hash,
+        const data_chunk& item);
+
+private:
+    struct entry
+    {
+        hash_digest hash;
+        hash_digest header;
+        uint64_t offset;
+        uint32_t size;
+    };
+
+    bool open();
+    bool truncate(size_t height);
+
+    // This is thread safe.
+    const boost::filesystem::path file_;
+
+    // These are protected by mutex.
+    std::vector<entry> entries_;
+    uint64_t end_;
+    boost::filesystem::ofstream stream_;
+    mutable shared_mutex mutex_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,72 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_HASH_FILTER_HPP
+#define LIBBITCOIN_BLOCKCHAIN_HASH_FILTER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe (lock free).
+/// Blocked Bloom filter over stored block and transaction hashes. Each hash
+/// sets bits within one cache line, derived from the (uniform) hash itself.
+/// A negative result is definite only once the filter is complete, that is
+/// when all previously-stored hashes have been added.
+class BCB_API hash_filter
+{
+public:
+    /// Construct a filter of the given size (zero disables).
+    hash_filter(size_t maximum_megabytes);
+
+    /// The filter is disabled.
+    bool disabled() const;
+
+    /// All previously-stored hashes have been added.
+    bool complete() const;
+
+    /// Mark the filter as complete.
+    void set_complete();
+
+    /// Add the hash to the filter.
+    void insert(const hash_digest& hash);
+
+    /// False if the hash has definitely not been added.
+    bool contains(const hash_digest& hash) const;
+
+private:
+    typedef std::atomic<uint64_t> word;
+
+    size_t block(const hash_digest& hash) const;
+
+    // These are thread safe.
+    const size_t blocks_;
+    const std::unique_ptr<word[]> words_;
+    std::atomic<bool> complete_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
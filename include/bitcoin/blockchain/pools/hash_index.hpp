@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_HASH_INDEX_HPP
+#define LIBBITCOIN_BLOCKCHAIN_HASH_INDEX_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Dense height-to-hash array of a block index, published as immutable
+/// versioned snapshots so that readers obtain a view consistent across
+/// reorganization. Hashes are stored in fixed-size chunks, and a snapshot
+/// shares all unchanged chunks with its predecessor.
+class BCB_API hash_index
+{
+public:
+    typedef std::vector<hash_digest> chunk;
+    typedef std::shared_ptr<const chunk> chunk_ptr;
+
+    /// An immutable view of the index.
+    class BCB_API snapshot
+    {
+    public:
+        typedef std::shared_ptr<const snapshot> ptr;
+
+        /// Construct an empty snapshot.
+        snapshot();
+
+        /// The number of updates preceding this snapshot.
+        size_t version() const;
+
+        /// The number of indexed heights (top height plus one).
+        size_t size() const;
+
+        /// Get the hash at the height, false if not indexed.
+        bool get(hash_digest& out_hash, size_t height) const;
+
+    private:
+        friend class hash_index;
+
+        size_t version_;
+        size_t size_;
+        std::vector<chunk_ptr> chunks_;
+    };
+
+    /// Construct an empty index.
+    hash_index();
+
+    /// The current snapshot.
+    snapshot::ptr get() const;
+
+    /// Replace heights at and above first_height with the given hashes.
+    void update(size_t first_height, const hash_list& hashes);
+
+private:
+    // This is thread safe.
+    bc::atomic<snapshot::ptr> snapshot_;
+
+    // This serializes writers.
+    mutable shared_mutex mutex_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,76 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_HASH_SET_HPP
+#define LIBBITCOIN_BLOCKCHAIN_HASH_SET_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <unordered_set>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Set of hashes partitioned into independently locked shards, selected by
+/// the (uniform) hash itself, so that concurrent queries rarely contend.
+class BCB_API hash_set
+{
+public:
+    /// Construct an empty set.
+    hash_set();
+
+    /// The number of hashes in the set.
+    size_t size() const;
+
+    /// The hash exists in the set.
+    bool contains(const hash_digest& hash) const;
+
+    /// Add the hash, false if it already exists.
+    bool insert(const hash_digest& hash);
+
+    /// Remove the hash, false if it did not exist.
+    bool erase(const hash_digest& hash);
+
+    /// Remove all hashes.
+    void clear();
+
+private:
+    static const size_t shard_count = 64;
+
+    struct shard
+    {
+        std::unordered_set<hash_digest> hashes;
+        mutable shared_mutex mutex;
+    };
+
+    shard& get_shard(const hash_digest& hash);
+    const shard& get_shard(const hash_digest& hash) const;
+
+    // These are thread safe.
+    std::array<shard, shard_count> shards_;
+    std::atomic<size_t> size_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,94 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_HEADER_ARRAY_HPP
+#define LIBBITCOIN_BLOCKCHAIN_HEADER_ARRAY_HPP
+
+#include <cstddef>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Memory-mapped flat array of serialized confirmed headers by height from
+/// genesis, so that a headers reply is one bounded slice copy and not a store
+/// read per header. The array is maintained incrementally as headers are
+/// pushed to and popped from the confirmed index. The file is grown in fixed
+/// increments (remapped), and the persisted count is verified on start.
+class BCB_API header_array
+  : noncopyable
+{
+public:
+    /// The size of a serialized header.
+    static const size_t header_size;
+
+    /// Construct a stopped array over the file (empty path disables).
+    header_array(const boost::filesystem::path& file);
+
+    /// The array is disabled.
+    bool disabled() const;
+
+    /// Map the file, creating it if it does not exist.
+    bool start();
+
+    /// Flush and unmap the file, after which the array is empty.
+    void stop();
+
+    /// The number of mapped headers, which are at heights [0, size).
+    size_t size() const;
+
+    /// Map the header at the height above the top, false if not mapped.
+    /// Once a push fails, pushes and reads fail until the next start.
+    bool push(const chain::header& header);
+
+    /// Remove heights above the given height.
+    void pop(size_t height);
+
+    /// Remove all heights.
+    void clear();
+
+    /// Get the header at the height, false if not mapped.
+    bool get(chain::header& out_header, size_t height) const;
+
+    /// Copy serialized headers of heights [begin, end), false if not mapped.
+    bool get(data_chunk& out_data, size_t begin, size_t end) const;
+
+private:
+    bool map();
+    bool grow();
+    void write_count();
+
+    // This is thread safe.
+    const boost::filesystem::path file_;
+
+    // These are protected by mutex.
+    bool failed_;
+    size_t count_;
+    size_t capacity_;
+    boost::interprocess::mapped_region region_;
+    mutable shared_mutex mutex_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
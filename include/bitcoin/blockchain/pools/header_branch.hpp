@@ -45,6 +45,12 @@ public:
     /// Push the header onto the branch, true if chains to top.
     bool push(header_const_ptr header);
 
+    /// Append the header to the top of the branch, true if chains to top.
+    bool extend(header_const_ptr header);
+
+    /// Remove the top header from the branch, if it exists.
+    void pop();
+
     /// The parent header of the top header of the branch, if both exist.
     header_const_ptr top_parent() const;
 
@@ -20,27 +20,31 @@
 #define LIBBITCOIN_BLOCKCHAIN_HEADER_POOL_HPP
 
 #include <cstddef>
-#include <boost/bimap.hpp>
-#include <boost/bimap/multiset_of.hpp>
-#include <boost/bimap/unordered_set_of.hpp>
+#include <cstdint>
+#include <vector>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/blockchain/define.hpp>
 #include <bitcoin/blockchain/pools/header_branch.hpp>
-#include <bitcoin/blockchain/pools/header_entry.hpp>
 
 namespace libbitcoin {
 namespace blockchain {
 
 /// This class is thread safe against concurrent filtering only.
 /// There is no search within headers of the header pool (just hashes).
+/// Only leaf headers are retained as objects (with any chain state), other
+/// headers are packed and are rematerialized (without chain state) on read.
 class BCB_API header_pool
 {
 public:
-    header_pool(size_t maximum_depth);
+    /// Construct a pool bounded by depth and size (zero disables either).
+    header_pool(size_t maximum_depth, size_t maximum_megabytes=0);
 
     /// The number of headers in the pool.
     size_t size() const;
 
+    /// The approximate memory used by the pool and its headers, in bytes.
+    size_t memory() const;
+
     /// The header exists in the pool.
     bool exists(header_const_ptr header) const;
 
@@ -56,6 +60,9 @@ public:
     /// Purge branch rooted below top minus maximum depth.
     void prune(size_t top_height);
 
+    /// Purge the lowest branches until the pool is reduced by the given bytes.
+    void shed(size_t bytes);
+
     /// Remove all message vectors that match header hashes.
     void filter(get_data_ptr message) const;
 
@@ -64,24 +71,72 @@ public:
     header_branch::ptr get_branch(header_const_ptr candidate_header) const;
 
 protected:
-    // A bidirectional map is used for efficient header and position retrieval.
-    // This produces the effect of a circular buffer hash table header forest.
-    typedef boost::bimaps::bimap<
-        boost::bimaps::unordered_set_of<header_entry>,
-        boost::bimaps::multiset_of<size_t>> header_entries;
+    typedef uint32_t link;
+    typedef std::vector<link> links;
+    static const link null_link = max_uint32;
+
+    // The 80 bytes of a header, as the wire serialization.
+    struct record
+    {
+        uint32_t version;
+        hash_digest previous_block_hash;
+        hash_digest merkle_root;
+        uint32_t timestamp;
+        uint32_t bits;
+        uint32_t nonce;
+    };
+
+    // A compact node of the header forest, children are linked by position
+    // so that there is no allocation per child. The height is that of the
+    // header, and a root is connected to the chain (or disconnected). The
+    // origin is the memoized root of the node's tree (itself for a root) and
+    // is null for a recycled node. The header object is held only by a leaf.
+    struct node
+    {
+        hash_digest hash;
+        record value;
+        uint32_t median_time_past;
+        header_const_ptr header;
+        size_t height;
+        link parent;
+        link origin;
+        link first_child;
+        link next_sibling;
+        bool root;
+    };
 
     bool exists(const hash_digest& hash) const;
-    void prune(const hash_list& hashes, size_t minimum_height);
+    link find(const hash_digest& hash) const;
+    void insert(header_const_ptr header, size_t height);
+    void erase(link item);
+    void place(link item);
+    void reserve();
+    void plant(link item);
+    void reroot(link item);
+    void unplant(link item);
+    void prune(links&& expired, size_t minimum_height);
+    void trim(size_t maximum_bytes);
+    bool live(link item) const;
+    size_t bytes() const;
+    header_const_ptr materialize(link item) const;
     header_const_ptr parent(header_const_ptr header) const;
     size_t height(const hash_digest& hash) const;
-    ////void log_content() const;
 
-    // This is thread safe.
+    // These are thread safe.
     const size_t maximum_depth_;
+    const size_t maximum_bytes_;
 
-    // This is guarded against filtering concurrent to writing.
+    // These are guarded against filtering concurrent to writing.
     // All other operations are presumed to be externally protected.
-    header_entries headers_;
+    // Nodes are stable (recycled), the open addressing (linear probing) slot
+    // table maps hashes to nodes, and roots are bucketed by height in a ring.
+    size_t count_;
+    size_t headers_;
+    size_t floor_;
+    links slots_;
+    std::vector<node> nodes_;
+    links recycled_;
+    std::vector<links> roots_;
     mutable upgrade_mutex mutex_;
 };
 
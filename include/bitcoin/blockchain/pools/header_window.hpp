@@ -0,0 +1,85 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_HEADER_WINDOW_HPP
+#define LIBBITCOIN_BLOCKCHAIN_HEADER_WINDOW_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Columns of the header fields queried by chain state population, for the
+/// trailing window of a block index. The window is maintained incrementally
+/// as headers are pushed to and popped from the store index, so that chain
+/// state for heights within the window is populated without store reads.
+class BCB_API header_window
+{
+public:
+    /// Construct an empty window retaining up to capacity heights.
+    header_window(size_t capacity);
+
+    /// The maximum number of windowed heights.
+    size_t capacity() const;
+
+    /// Clear the window, the next pushed header is at the given height.
+    void reset(size_t first_height);
+
+    /// Window the header at the height above the top, dropping the oldest.
+    void push(const chain::header& header);
+
+    /// Remove heights above the given height (resets if below window).
+    void pop(size_t height);
+
+    /// Get fields of the header at the height, false if not windowed.
+    bool get_bits(uint32_t& out_bits, size_t height) const;
+    bool get_version(uint32_t& out_version, size_t height) const;
+    bool get_timestamp(uint32_t& out_timestamp, size_t height) const;
+    bool get_block_hash(hash_digest& out_hash, size_t height) const;
+
+    /// Serialize the first height and the columns of the window.
+    void to_data(writer& sink) const;
+
+    /// Replace the window from its serialization, false if invalid or over
+    /// capacity (the window is then empty at height zero).
+    bool from_data(reader& source);
+
+private:
+    bool find(size_t& out_position, size_t height) const;
+
+    // This is thread safe.
+    const size_t capacity_;
+
+    // These are protected by mutex.
+    size_t first_;
+    std::deque<uint32_t> bits_;
+    std::deque<uint32_t> versions_;
+    std::deque<uint32_t> timestamps_;
+    std::deque<hash_digest> hashes_;
+    mutable shared_mutex mutex_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
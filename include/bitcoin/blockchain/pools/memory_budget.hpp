@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_MEMORY_BUDGET_HPP
+#define LIBBITCOIN_BLOCKCHAIN_MEMORY_BUDGET_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Shared accounting of the memory held by pools and caches. Each component
+/// is enrolled with a measure of its bytes and an action that sheds them.
+/// Once the total exceeds the budget, components are shed in enrollment order
+/// (the first enrolled is shed first) until the total is within the budget.
+/// Each component also bounds itself, so a zero budget only reports.
+class BCB_API memory_budget
+  : noncopyable
+{
+public:
+    /// The bytes held by a component.
+    typedef std::function<size_t()> measure;
+
+    /// Shed at least the given bytes from a component, where possible.
+    typedef std::function<void(size_t)> shed;
+
+    struct usage
+    {
+        std::string name;
+        size_t bytes;
+    };
+
+    typedef std::vector<usage> usages;
+
+    /// Construct a budget of the given size (zero disables shedding).
+    memory_budget(size_t maximum_megabytes);
+
+    /// Shedding is disabled.
+    bool disabled() const;
+
+    /// The budget in bytes.
+    size_t maximum() const;
+
+    /// Enroll a component, in shedding order (call before enforcement).
+    void enroll(const std::string& name, measure bytes, shed action);
+
+    /// The bytes held by each component, in enrollment order.
+    usages report() const;
+
+    /// The bytes held by all components.
+    size_t total() const;
+
+    /// The number of components shed since construction.
+    size_t sheds() const;
+
+    /// Shed components in order while over the budget. This returns without
+    /// effect while enforcement (or enrollment/report) is in progress.
+    void enforce();
+
+private:
+    struct component
+    {
+        std::string name;
+        measure bytes;
+        shed action;
+    };
+
+    // These are thread safe.
+    const size_t maximum_bytes_;
+    std::atomic<size_t> sheds_;
+
+    // These are protected by mutex.
+    std::vector<component> components_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
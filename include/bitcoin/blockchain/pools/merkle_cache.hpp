@@ -0,0 +1,78 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_MERKLE_CACHE_HPP
+#define LIBBITCOIN_BLOCKCHAIN_MERKLE_CACHE_HPP
+
+#include <cstddef>
+#include <deque>
+#include <unordered_map>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Memory-bounded map of block hash to the ordered hashes of its txs (the
+/// merkle leaves), so that merkle block replies do not read the tx store.
+/// Entries are evicted oldest first, and a miss implies only a store read.
+class BCB_API merkle_cache
+{
+public:
+    /// Construct a cache bounded to the given size (zero disables).
+    merkle_cache(size_t maximum_megabytes);
+
+    /// The cache is disabled.
+    bool disabled() const;
+
+    /// The number of cached blocks.
+    size_t size() const;
+
+    /// The bytes of cached tx hashes.
+    size_t bytes() const;
+
+    /// Cache the tx hashes of the block.
+    void add(block_const_ptr block);
+
+    /// Cache the tx hashes of the block of the given hash (empty ignored).
+    void add(const hash_digest& block_hash, const hash_list& tx_hashes);
+
+    /// Get the tx hashes of the block, false if not cached.
+    bool get(hash_list& out_hashes, const hash_digest& block_hash) const;
+
+    /// Remove all entries.
+    void clear();
+
+private:
+    typedef std::unordered_map<hash_digest, hash_list> entries;
+
+    // This is thread safe.
+    const size_t maximum_bytes_;
+
+    // These are protected by mutex.
+    entries entries_;
+    std::deque<hash_digest> order_;
+    size_t bytes_;
+    mutable shared_mutex mutex_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,104 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_NOTIFICATION_QUEUE_HPP
+#define LIBBITCOIN_BLOCKCHAIN_NOTIFICATION_QUEUE_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Chain notifications are queued by the organizers and invoked in order on a
+/// dedicated thread, so that no subscriber runs within the critical section.
+/// A queued header reorganization is coalesced with one that extends it.
+/// Push blocks while the queue is at its limit (zero is unbounded), except
+/// from the dispatch thread, which would otherwise wait on itself.
+class BCB_API notification_queue
+{
+public:
+    typedef std::function<void()> handler;
+    typedef std::function<void(size_t, header_const_ptr_list_const_ptr,
+        header_const_ptr_list_const_ptr)> header_handler;
+
+    /// Construct a stopped queue, headers are invoked on the given handler.
+    notification_queue(size_t limit, header_handler headers);
+
+    /// Stop and join the dispatch thread.
+    ~notification_queue();
+
+    /// Start the dispatch thread.
+    void start();
+
+    /// Discard queued notifications and stop the dispatch thread, waiting
+    /// for a notification in progress unless called from that thread.
+    void stop();
+
+    /// The number of queued notifications (excluding any in progress).
+    size_t size() const;
+
+    /// Queue the notification, false if stopped.
+    bool push(handler notify);
+
+    /// Queue or coalesce the header reorganization, false if stopped.
+    bool push(size_t fork_height, header_const_ptr_list_const_ptr incoming,
+        header_const_ptr_list_const_ptr outgoing);
+
+private:
+    struct notification
+    {
+        handler notify;
+
+        // Header reorganizations retain arguments so that they coalesce.
+        size_t fork_height;
+        header_const_ptr_list_const_ptr incoming;
+        header_const_ptr_list_const_ptr outgoing;
+    };
+
+    static bool coalesce(notification& prior, size_t fork_height,
+        header_const_ptr_list_const_ptr incoming,
+        header_const_ptr_list_const_ptr outgoing);
+
+    bool enqueue(notification&& next, std::unique_lock<std::mutex>& lock);
+    void dispatch();
+
+    // These are thread safe.
+    const size_t limit_;
+    const header_handler headers_;
+
+    // These are protected by mutex.
+    bool stopped_;
+    std::thread thread_;
+    std::deque<notification> queue_;
+    mutable std::mutex mutex_;
+    std::condition_variable pushed_;
+    std::condition_variable popped_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
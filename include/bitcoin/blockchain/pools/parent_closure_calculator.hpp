@@ -19,7 +19,6 @@
 #ifndef LIBBITCOIN_PARENT_CLOSURE_CALCULATOR_HPP
 #define LIBBITCOIN_PARENT_CLOSURE_CALCULATOR_HPP
 
-#include <deque>
 #include <bitcoin/blockchain/pools/stack_evaluator.hpp>
 #include <bitcoin/blockchain/pools/transaction_entry.hpp>
 #include <bitcoin/blockchain/pools/transaction_pool_state.hpp>
@@ -33,7 +32,8 @@ public:
 
     parent_closure_calculator(transaction_pool_state& state);
 
-    transaction_entry::list get_closure(transaction_entry::ptr tx);
+    /// The tx and its ancestors, valid until the next call.
+    const transaction_entry::list& get_closure(transaction_entry::ptr tx);
 
 protected:
     virtual bool visit(transaction_entry::ptr element);
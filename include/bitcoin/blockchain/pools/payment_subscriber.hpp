@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_PAYMENT_SUBSCRIBER_HPP
+#define LIBBITCOIN_BLOCKCHAIN_PAYMENT_SUBSCRIBER_HPP
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Subscriptions to the txs that pay to or spend from any of a set of address
+/// hashes. Each tx of a notification is matched once for all subscribers
+/// (against the union of their filters), and each subscriber is invoked only
+/// with its matching txs, if any. A handler returning false is unsubscribed.
+class BCB_API payment_subscriber
+{
+public:
+    typedef std::shared_ptr<payment_subscriber> ptr;
+    typedef std::unordered_set<short_hash> filter;
+    typedef std::function<bool(code, size_t, transaction_const_ptr_list_const_ptr,
+        transaction_const_ptr_list_const_ptr)> block_handler;
+    typedef std::function<bool(code, transaction_const_ptr)>
+        transaction_handler;
+
+    /// Construct a stopped instance.
+    payment_subscriber();
+
+    /// Accept subscriptions.
+    void start();
+
+    /// Invoke and drop all subscribers with the stop code, and reject (invoke)
+    /// subsequent subscriptions with it.
+    void stop();
+
+    /// The number of subscriptions.
+    size_t size() const;
+
+    /// Subscribe to the matching txs of block reorganizations, in block order.
+    void subscribe(const filter& addresses, block_handler&& handler);
+
+    /// Subscribe to the matching txs of memory pool additions.
+    void subscribe(const filter& addresses, transaction_handler&& handler);
+
+    /// Invoke each subscriber with the code and null data, dropping those
+    /// that return false.
+    void invoke(const code& ec);
+
+    /// Invoke each subscriber with its matching txs of the branches.
+    void notify(size_t fork_height, block_const_ptr_list_const_ptr incoming,
+        block_const_ptr_list_const_ptr outgoing);
+
+    /// Invoke each subscriber with the tx if it matches.
+    void notify(transaction_const_ptr tx);
+
+    /// The address hashes paid to or spent from by the tx (by prevout script
+    /// where populated, otherwise by input script).
+    static filter addresses(const chain::transaction& tx);
+
+private:
+    typedef std::vector<size_t> identifiers;
+    typedef std::unordered_map<size_t, transaction_const_ptr_list_ptr> matches;
+
+    struct subscription
+    {
+        filter addresses;
+        block_handler blocks;
+        transaction_handler transactions;
+    };
+
+    typedef std::shared_ptr<const subscription> subscription_ptr;
+    typedef std::unordered_map<size_t, subscription_ptr> subscriptions;
+
+    void add(subscription_ptr value);
+    void remove(const identifiers& ids);
+    identifiers match(const chain::transaction& tx, bool blocks) const;
+    void match(matches& out, block_const_ptr_list_const_ptr blocks) const;
+    subscriptions copy() const;
+
+    // These are protected by mutex.
+    bool stopped_;
+    size_t next_;
+    subscriptions subscriptions_;
+    std::unordered_map<short_hash, identifiers> index_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_SPEND_INDEX_HPP
+#define LIBBITCOIN_BLOCKCHAIN_SPEND_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Memory-mapped open addressing table of confirmed spends, keyed by the
+/// truncated outpoint hash (mixed with the outpoint index) to the store link
+/// and input index of the spender. Keys are not unique, so a lookup returns
+/// all spenders of the key and the caller verifies each against the spending
+/// tx. Blocks are pushed and popped in confirmed order, and the table is
+/// grown (rehashed in place) at half load. Each update is flushed, so only a
+/// table interrupted during an update (or failed) is cleared on start.
+class BCB_API spend_index
+  : noncopyable
+{
+public:
+    struct spender
+    {
+        typedef std::vector<spender> list;
+
+        uint64_t link;
+        uint32_t index;
+    };
+
+    /// Construct a stopped index over the file (empty path disables).
+    spend_index(const boost::filesystem::path& file);
+
+    /// The index is disabled.
+    bool disabled() const;
+
+    /// Map the file, cleared if new or not consistent with its top.
+    bool start();
+
+    /// Flush and unmap the file, marked clean unless an update failed.
+    void stop();
+
+    /// The number of indexed spends.
+    size_t size() const;
+
+    /// Get the height and hash of the top indexed block, false if empty.
+    bool top(size_t& out_height, hash_digest& out_hash) const;
+
+    /// Index the spends of the stored block at the height above the top.
+    /// Once an update fails, updates fail until the index is cleared.
+    bool push(const chain::block& block, size_t height);
+
+    /// Remove the spends of the top indexed block at the height.
+    bool pop(const chain::block& block, size_t height);
+
+    /// Remove all spends, clearing a failed update.
+    bool clear();
+
+    /// Get the spenders indexed under the key of the outpoint.
+    spender::list get(const chain::output_point& outpoint) const;
+
+private:
+    bool map();
+    bool reset();
+    bool grow();
+    void mark(bool consistent);
+    void commit();
+    void read_header();
+    void write_header(bool clean);
+
+    // This is thread safe.
+    const boost::filesystem::path file_;
+
+    // These are protected by mutex.
+    bool failed_;
+    size_t count_;
+    size_t capacity_;
+    uint64_t top_;
+    hash_digest top_hash_;
+    boost::interprocess::mapped_region region_;
+    mutable shared_mutex mutex_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
@@ -19,18 +19,27 @@
 #ifndef LIBBITCOIN_BLOCKCHAIN_STACK_EVALUATOR_HPP
 #define LIBBITCOIN_BLOCKCHAIN_STACK_EVALUATOR_HPP
 
-#include <deque>
+#include <cstdint>
+#include <memory>
+#include <vector>
 #include <bitcoin/blockchain/pools/transaction_entry.hpp>
 
 namespace libbitcoin {
 namespace blockchain {
 
+/// Entries are marked with the traversal epoch rather than collected into a
+/// visited set, and traversal buffers are recycled across evaluators of the
+/// thread, so a warm traversal does not allocate. Marks are restored on
+/// completion, so traversals may nest. This class is not thread safe.
 class stack_evaluator
 {
 public:
     typedef transaction_entry::ptr element_type;
+    typedef transaction_entry::list element_list;
 
-    typedef std::map<hash_digest, element_type> element_type_natural_key_map;
+    stack_evaluator();
+
+    ~stack_evaluator();
 
     void enqueue(element_type element);
 
@@ -43,13 +52,25 @@ protected:
 
     void mark_encountered(element_type element);
 
-    element_type_natural_key_map::const_iterator begin_encountered() const;
-
-    element_type_natural_key_map::const_iterator end_encountered() const;
+    /// The encountered elements in order of encounter.
+    const element_list& encountered() const;
 
 private:
-    element_type_natural_key_map encountered_;
-    std::deque<element_type> stack_;
+    struct scratch
+    {
+        element_list stack;
+        element_list encountered;
+        std::vector<uint64_t> marks;
+    };
+
+    typedef std::unique_ptr<scratch> scratch_ptr;
+
+    static std::vector<scratch_ptr>& recycled();
+
+    void restore();
+
+    uint64_t epoch_;
+    scratch_ptr scratch_;
 };
 
 } // namespace blockchain
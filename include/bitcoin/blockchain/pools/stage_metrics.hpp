@@ -0,0 +1,226 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_STAGE_METRICS_HPP
+#define LIBBITCOIN_BLOCKCHAIN_STAGE_METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Lock-free log-linear (HDR-style) histogram of microsecond latencies.
+/// Values below 8us are exact, above which each power of two is divided into
+/// eight buckets, bounding the relative error of any bucket to 12.5%.
+class BCB_API latency_histogram
+  : noncopyable
+{
+public:
+    static const size_t sub_buckets = 8;
+    static const size_t buckets = 62 * sub_buckets;
+
+    /// Construct an empty histogram.
+    latency_histogram();
+
+    /// Record a latency sample.
+    void record(uint64_t microseconds);
+
+    /// The number of samples.
+    uint64_t count() const;
+
+    /// The sum of samples in microseconds.
+    uint64_t total() const;
+
+    /// The largest sample in microseconds.
+    uint64_t maximum() const;
+
+    /// The upper bound of the bucket at the quantile (0..1), zero if empty.
+    uint64_t quantile(double ratio) const;
+
+    /// The sample count of each bucket, in bucket order.
+    std::vector<uint64_t> counts() const;
+
+    /// The bucket of a value.
+    static size_t bucket(uint64_t microseconds);
+
+    /// The largest value of a bucket.
+    static uint64_t upper_bound(size_t bucket);
+
+private:
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> total_;
+    std::atomic<uint64_t> maximum_;
+    std::array<std::atomic<uint64_t>, buckets> counts_;
+};
+
+/// This class is thread safe.
+/// Wait and hold latency of the validation mutex at each caller site, and the
+/// number of times each waiter of low priority was overtaken by an acquisition
+/// of high priority (starvation). The mutex is exclusive, so the acquisition
+/// time is set and read only by the holder.
+class BCB_API lock_metrics
+  : noncopyable
+{
+public:
+    enum class site
+    {
+        /// Block validation sequence (high priority).
+        block_validate,
+
+        /// Header organization, single or batched (high priority).
+        header_organize,
+
+        /// Flush of deferred headers upon timer (high priority).
+        header_flush,
+
+        /// Storage of a validated tx or tx set (low priority).
+        transaction_store,
+
+        /// Coalescence of work upon chain stop (high priority).
+        chain_stop
+    };
+
+    static const size_t sites = 5;
+
+    /// Construct empty metrics.
+    lock_metrics();
+
+    /// Call before requesting the lock at the site, returns the wait start.
+    asio::time_point waiting(site caller);
+
+    /// Call once the lock is acquired at the site, given the wait start.
+    void acquired(site caller, const asio::time_point& start);
+
+    /// Call before the lock acquired at the site is released.
+    void released(site caller);
+
+    /// The wait latency histogram of the site.
+    const latency_histogram& wait(site caller) const;
+
+    /// The hold latency histogram of the site.
+    const latency_histogram& hold(site caller) const;
+
+    /// The number of high priority acquisitions while the site was waiting.
+    uint64_t overtaken(site caller) const;
+
+    /// The site requests the lock at high priority.
+    static bool is_high_priority(site caller);
+
+    /// The metric name of a site.
+    static std::string name(site caller);
+
+private:
+    std::array<latency_histogram, sites> waits_;
+    std::array<latency_histogram, sites> holds_;
+    std::array<std::atomic<uint64_t>, sites> waiting_;
+    std::array<std::atomic<uint64_t>, sites> overtaken_;
+
+    // This is protected by the profiled mutex.
+    asio::time_point acquired_;
+};
+
+/// This class is thread safe.
+/// Validation latency of each stage of block, header and tx organization.
+/// Not all stages apply to each entity, and inapplicable stages remain empty.
+class BCB_API stage_metrics
+  : noncopyable
+{
+public:
+    enum class entity
+    {
+        block,
+        header,
+        transaction
+    };
+
+    enum class stage
+    {
+        /// Read of the block from the cache/store, or of the header branch.
+        read,
+
+        /// Population of chain state and prevouts (blocks only).
+        populate,
+
+        /// Contextual validation (includes population for headers and txs).
+        accept,
+
+        /// Script validation.
+        connect,
+
+        /// Marking of the block as valid candidate, or tx memory pooling.
+        candidate,
+
+        /// Reorganization of the header or block branch.
+        reorganize,
+
+        /// Invocation of subscribers.
+        notify
+    };
+
+    static const size_t entities = 3;
+    static const size_t stages = 7;
+
+    /// Construct empty metrics.
+    stage_metrics();
+
+    /// Record the latency of the stage.
+    void record(entity target, stage step, const asio::duration& elapsed);
+
+    /// Record the latency of the stage from its start until now.
+    void record(entity target, stage step, const asio::time_point& start);
+
+    /// The histogram of the stage.
+    const latency_histogram& histogram(entity target, stage step) const;
+
+    /// Count a preceding block of a block reorganization, read from the
+    /// candidate cache or (if not cached) from the store.
+    void preceding(bool cached);
+
+    /// The number of preceding blocks read from the candidate cache.
+    uint64_t cached_preceding() const;
+
+    /// The number of preceding blocks read from the store.
+    uint64_t stored_preceding() const;
+
+    /// The validation mutex metrics.
+    lock_metrics& locks();
+    const lock_metrics& locks() const;
+
+    /// The metric names of an entity and stage.
+    static std::string name(entity target);
+    static std::string name(stage step);
+
+private:
+    std::array<latency_histogram, entities * stages> histograms_;
+    std::atomic<uint64_t> cached_preceding_;
+    std::atomic<uint64_t> stored_preceding_;
+    lock_metrics locks_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
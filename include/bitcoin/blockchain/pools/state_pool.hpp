@@ -0,0 +1,125 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_STATE_POOL_HPP
+#define LIBBITCOIN_BLOCKCHAIN_STATE_POOL_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Recycles equally-sized blocks carved from slabs, so that the chain state
+/// promoted for each header and block is not a distinct heap allocation.
+/// The block size is that of the first allocation, others use the heap.
+/// Slab memory is retained (at peak state count) until the pool is destroyed.
+class BCB_API state_pool
+{
+public:
+    typedef std::shared_ptr<state_pool> ptr;
+
+    /// Construct a pool that allocates the given number of blocks per slab.
+    state_pool(size_t slab_blocks);
+
+    /// Release all slabs.
+    ~state_pool();
+
+    /// The number of blocks held by all slabs.
+    size_t capacity() const;
+
+    /// The number of blocks in use.
+    size_t size() const;
+
+    /// Allocate a block of the given size.
+    void* allocate(size_t bytes);
+
+    /// Return a block obtained from allocate with the same size.
+    void deallocate(void* block, size_t bytes);
+
+private:
+    static size_t round(size_t bytes);
+
+    // This is thread safe.
+    const size_t slab_blocks_;
+
+    // These are protected by mutex.
+    size_t block_size_;
+    std::vector<void*> slabs_;
+    std::vector<void*> free_;
+    mutable shared_mutex mutex_;
+};
+
+/// Allocator for std::allocate_shared, sharing ownership of the pool so that
+/// the pool outlives every object allocated from it.
+template <typename Type>
+class state_allocator
+{
+public:
+    typedef Type value_type;
+
+    state_allocator(state_pool::ptr pool)
+      : pool_(pool)
+    {
+    }
+
+    template <typename Other>
+    state_allocator(const state_allocator<Other>& other)
+      : pool_(other.pool())
+    {
+    }
+
+    Type* allocate(size_t count)
+    {
+        return static_cast<Type*>(pool_->allocate(count * sizeof(Type)));
+    }
+
+    void deallocate(Type* value, size_t count)
+    {
+        pool_->deallocate(value, count * sizeof(Type));
+    }
+
+    state_pool::ptr pool() const
+    {
+        return pool_;
+    }
+
+    template <typename Other>
+    bool operator==(const state_allocator<Other>& other) const
+    {
+        return pool_ == other.pool();
+    }
+
+    template <typename Other>
+    bool operator!=(const state_allocator<Other>& other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+    state_pool::ptr pool_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_TEMPLATE_TREE_HPP
+#define LIBBITCOIN_BLOCKCHAIN_TEMPLATE_TREE_HPP
+
+#include <cstddef>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Cached merkle tree of the block template, with the coinbase leaf left
+/// open, so that a template refresh that changes only the coinbase folds its
+/// hash up the cached branch. An update rehashes only the nodes above the
+/// first leaf that differs from the cached leaves, so appended (or trimmed)
+/// txs cost the changed leaves and the right edge of the tree.
+class BCB_API template_tree
+  : noncopyable
+{
+public:
+    /// Construct an empty tree.
+    template_tree();
+
+    /// The number of cached (non-coinbase) leaves.
+    size_t size() const;
+
+    /// Update the tree to the template tx hashes (excluding the coinbase) and
+    /// return the coinbase merkle branch, siblings ordered from the leaf.
+    hash_list update(const hash_list& hashes);
+
+    /// The merkle root of the coinbase hash folded up its branch.
+    static hash_digest root(const hash_digest& coinbase,
+        const hash_list& branch);
+
+private:
+    // These are protected by mutex.
+    // Nodes by level from the leaves, where node zero of each level is above
+    // the open coinbase leaf and is never read.
+    std::vector<hash_list> levels_;
+    hash_list branch_;
+    mutable shared_mutex mutex_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,60 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_THREAD_BINDER_HPP
+#define LIBBITCOIN_BLOCKCHAIN_THREAD_BINDER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Binds the threads of a pool to a set of processors, given explicitly or as
+/// those of a numa node. Binding is supported on linux only, elsewhere each
+/// bind fails (threads remain unbound).
+class BCB_API thread_binder
+{
+public:
+    typedef std::vector<uint32_t> cpus;
+
+    /// The processors of the numa node, empty if not found.
+    static cpus node_cpus(uint32_t node);
+
+    /// Parse a linux cpu list (e.g. "0-3,8,10-11"), empty if invalid.
+    static cpus parse(const std::string& list);
+
+    /// Bind the calling thread to the processors.
+    static bool bind(const cpus& processors);
+
+    /// Bind each thread of the idle pool to the processors, return on bound.
+    /// Each thread runs one binding and waits until all have been run.
+    static bool bind(threadpool& pool, const cpus& processors);
+
+private:
+    struct binding;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
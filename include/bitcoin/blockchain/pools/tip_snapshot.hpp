@@ -0,0 +1,73 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_TIP_SNAPSHOT_HPP
+#define LIBBITCOIN_BLOCKCHAIN_TIP_SNAPSHOT_HPP
+
+#include <boost/filesystem.hpp>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+#include <bitcoin/blockchain/pools/header_window.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Checksummed file of the chain tip state (fork point, work, chain states and
+/// header windows), written on clean stop so that start need not recompute it.
+/// The file is removed when loaded, so that it cannot outlive the store state
+/// from which it was taken (an unclean stop leaves no snapshot).
+class BCB_API tip_snapshot
+{
+public:
+    struct tips
+    {
+        config::checkpoint candidate_top;
+        config::checkpoint confirmed_top;
+        config::checkpoint fork_point;
+        uint256_t candidate_work;
+        uint256_t confirmed_work;
+        chain::chain_state::data top_candidate_state;
+        chain::chain_state::data top_valid_candidate_state;
+        chain::chain_state::data next_confirmed_state;
+    };
+
+    /// Construct a snapshot of the file, bound to the context (a digest of
+    /// the settings from which chain state is derived).
+    tip_snapshot(const boost::filesystem::path& file,
+        const hash_digest& context);
+
+    /// Read and remove the snapshot, false if missing, corrupt or of another
+    /// context. Windows are replaced (and are invalid if false).
+    bool load(tips& out_tips, header_window& candidate,
+        header_window& confirmed) const;
+
+    /// Write the snapshot, replacing any prior, false on failure.
+    bool save(const tips& tips, const header_window& candidate,
+        const header_window& confirmed) const;
+
+private:
+    // These are thread safe.
+    const boost::filesystem::path file_;
+    const hash_digest context_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_TRANSACTION_CACHE_HPP
+#define LIBBITCOIN_BLOCKCHAIN_TRANSACTION_CACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Memory-bounded map of tx store link to the deserialized tx, so that hot
+/// transactions are decoded once across queries and block reads. The link of
+/// a stored tx never changes, and only the tx itself is cached (its chain
+/// state is always read from the store), so reorganization cannot stale an
+/// entry. Shards are independently locked and evicted least recently used.
+class BCB_API transaction_cache
+{
+public:
+    /// Construct a cache bounded to the given size (zero disables).
+    transaction_cache(size_t maximum_megabytes, size_t shards=16);
+
+    /// The cache is disabled.
+    bool disabled() const;
+
+    /// The number of cached transactions.
+    size_t size() const;
+
+    /// The serialized bytes of cached transactions.
+    size_t bytes() const;
+
+    /// The ratio of get hits to get queries.
+    float hit_rate() const;
+
+    /// Get the tx of the store link (with or without witness), or null.
+    transaction_const_ptr get(uint64_t link, bool witness);
+
+    /// Cache the tx of the store link (with or without witness).
+    void add(uint64_t link, bool witness, transaction_const_ptr tx);
+
+    /// Remove all entries.
+    void clear();
+
+private:
+    typedef std::pair<uint64_t, transaction_const_ptr> entry;
+    typedef std::list<entry> entries;
+
+    struct shard
+    {
+        entries order;
+        std::unordered_map<uint64_t, entries::iterator> map;
+        size_t bytes;
+        std::mutex mutex;
+    };
+
+    shard& to_shard(uint64_t key);
+
+    // These are thread safe.
+    const size_t maximum_bytes_;
+    std::atomic<size_t> hits_;
+    std::atomic<size_t> queries_;
+
+    // The shards are individually protected by their mutex.
+    std::vector<std::unique_ptr<shard>> shards_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
@@ -27,6 +27,7 @@
 #include <boost/bimap.hpp>
 #include <boost/bimap/multiset_of.hpp>
 #include <boost/functional/hash_fwd.hpp>
+#include <boost/pool/pool_alloc.hpp>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/blockchain/define.hpp>
 
@@ -52,15 +53,31 @@ public:
             const transaction_entry::ptr& rhs) const;
     };
 
+    // Entries and child edges are small and churn with the pool, so they are
+    // recycled through size-segregated pools rather than the general heap.
+    typedef boost::fast_pool_allocator<char> allocator;
+
     typedef boost::bimaps::bimap<
         boost::bimaps::set_of<uint32_t>,
-        boost::bimaps::multiset_of<ptr, ptr_less>> indexed_list;
+        boost::bimaps::multiset_of<ptr, ptr_less>, allocator> indexed_list;
+
+    /// Allocate an entry for the pool (see constructor).
+    static ptr create(transaction_const_ptr tx);
+
+    /// Allocate an entry for the pool with its counted signature operations.
+    static ptr create(transaction_const_ptr tx, size_t sigops);
+
+    /// Allocate a search key.
+    static ptr create(const hash_digest& hash);
 
     /// Construct an entry for the pool.
     /// Never store an invalid transaction in the pool except for the cases of:
     /// double spend and input invalid due to forks change (sentinel forks).
     transaction_entry(transaction_const_ptr tx);
 
+    /// Construct an entry for the pool with its counted signature operations.
+    transaction_entry(transaction_const_ptr tx, size_t sigops);
+
     /// Use this construction only as a search key.
     transaction_entry(const hash_digest& hash);
 
@@ -84,6 +101,10 @@ public:
     /// The hash table entry identity.
     const hash_digest& hash() const;
 
+    /// The pooled transaction, for compact block reconstruction.
+    /// This is nullptr if the entry was constructed from a hash.
+    transaction_const_ptr transaction() const;
+
     /// An anchor tx binds a subgraph to the chain and is not itself mempool.
     bool is_anchor() const;
 
@@ -100,6 +121,12 @@ public:
     /// The hash table entry's child (input transaction) hashes.
     const indexed_list& children() const;
 
+    /// The epoch of the last graph traversal to encounter this entry.
+    uint64_t mark() const;
+
+    /// Stamp the entry as encountered by the traversal of the epoch.
+    void set_mark(uint64_t epoch);
+
     /// Add transaction to the list of children of this transaction.
     void add_parent(ptr parent);
 
@@ -137,10 +164,12 @@ private:
     uint32_t sigops_;
     uint32_t size_;
     hash_digest hash_;
+    transaction_const_ptr transaction_;
 
     // These do not affect the entry hash, so must be mutable.
     list parents_;
     indexed_list children_;
+    uint64_t mark_;
 };
 
 } // namespace blockchain
@@ -21,15 +21,15 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <boost/bimap.hpp>
-#include <boost/bimap/multiset_of.hpp>
-#include <boost/bimap/unordered_set_of.hpp>
+#include <vector>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/blockchain/define.hpp>
 #include <bitcoin/blockchain/interface/safe_chain.hpp>
 #include <bitcoin/blockchain/settings.hpp>
+#include <bitcoin/blockchain/pools/hash_set.hpp>
 #include <bitcoin/blockchain/pools/transaction_entry.hpp>
 #include <bitcoin/blockchain/pools/transaction_pool_state.hpp>
+#include <bitcoin/blockchain/validate/script_cache.hpp>
 
 namespace libbitcoin {
 namespace blockchain {
@@ -39,49 +39,101 @@ class BCB_API transaction_pool
 {
 public:
     typedef safe_chain::inventory_fetch_handler inventory_fetch_handler;
-    typedef safe_chain::merkle_block_fetch_handler merkle_block_fetch_handler;
     typedef double priority;
 
-    transaction_pool(const settings& settings);
+    /// Signature operation counts of pooled txs are shared with validation.
+    transaction_pool(const settings& settings, script_cache& cache);
 
-    /// The tx exists in the pool.
+    /// The tx exists in the pool (thread safe).
     bool exists(transaction_const_ptr tx) const;
 
-    /// Remove all message vectors that match transaction hashes.
+    /// Add the stored unconfirmed tx to the pool and template (thread safe).
+    void add(transaction_const_ptr tx);
+
+    /// Add the hashes of txs of a block popped from the confirmed chain.
+    void add(block_const_ptr block);
+
+    /// Remove txs confirmed by the block and their conflicts (thread safe).
+    void remove(block_const_ptr block);
+
+    /// Populate the prevouts of pooled txs of the block that were confirmed
+    /// at pool validation and not since popped, flagging each populated input
+    /// (non-coinbase inputs in block order). Returns the number populated.
+    /// Valid only for a block extending the confirmed top (thread safe).
+    size_t populate(const chain::block& block,
+        std::vector<bool>& out_populated) const;
+
+    /// Remove all message vectors that match pooled tx hashes (thread safe).
     void filter(get_data_ptr message) const;
 
-    void fetch_template(merkle_block_fetch_handler handler) const;
+    /// Up to count_limit pooled txs at or above minimum_fee (per kilobyte),
+    /// by descending rate with parents preceding children (thread safe).
     void fetch_mempool(size_t count_limit, uint64_t minimum_fee,
         inventory_fetch_handler) const;
 
+    /// The template ordered with parents preceding children (thread safe).
     transaction_entry::list get_template() const;
+
+    /// All pooled txs in fetch_mempool order (thread safe).
     transaction_entry::list get_mempool() const;
 
+    /// The serialized bytes of pooled txs (thread safe).
+    size_t bytes() const;
+
+    /// Evict packages until the pool is reduced by the given bytes (thread
+    /// safe).
+    void shed(size_t bytes);
+
+    /// The transactions of the compact block in block order, shared from the
+    /// pool where matched by short id, and nullptr where not prefilled or
+    /// uniquely matched (to be requested). Empty if malformed (thread safe).
+    transaction_const_ptr_list reconstruct(
+        const message::compact_block& block) const;
+
+    /// The BIP152 siphash key for short ids of the block header and nonce.
+    static half_hash to_short_id_key(const chain::header& header,
+        uint64_t nonce);
+
+    /// The BIP152 (48 bit) short id of the transaction hash.
+    static uint64_t to_short_id(const half_hash& key, const hash_digest& hash);
+
+    /// Convert between the wire and integer forms of a short id.
+    static uint64_t to_short_id(const mini_hash& id);
+    static mini_hash to_mini_hash(uint64_t short_id);
+
+    /// Add txs to the pool, updating the template incrementally.
     void add_unconfirmed_transactions(
         const transaction_const_ptr_list& unconfirmed_txs);
 
+    /// Remove confirmed txs and their conflicts, refilling the template.
     void remove_transactions(transaction_const_ptr_list& txs);
 
 private:
-    typedef transaction_pool_state::prioritized_transactions::right_map::iterator
-        priority_iterator;
+    transaction_entry::ptr add_entry(transaction_const_ptr tx);
+    bool add_package(transaction_entry::ptr entry);
+    void remove_spends(const hash_list& confirmed,
+        const chain::point::list& spends);
+    void reprioritize(transaction_entry::ptr anchor);
+    void fill_template();
+    void trim(size_t maximum_bytes);
 
     priority calculate_priority(transaction_entry::ptr tx);
-
-    priority_iterator find_inflection(
-        transaction_pool_state::prioritized_transactions& container,
-        transaction_pool::priority value);
+    bool fits(size_t bytes, size_t sigops, size_t freed_bytes,
+        size_t freed_sigops) const;
 
     transaction_entry::list get_parent_closure(transaction_entry::ptr tx);
 
-    void populate_child_closure(transaction_entry::ptr tx);
-
-    void order_template_transactions();
-
-    void update_template(priority_iterator max_pool_change);
-
 private:
+    const size_t maximum_bytes_;
+
+    // These are protected by mutex.
     transaction_pool_state state_;
+    uint64_t popped_sequence_;
+    mutable shared_mutex mutex_;
+
+    // These are thread safe.
+    hash_set hashes_;
+    script_cache& script_cache_;
 };
 
 } // namespace blockchain
@@ -21,9 +21,16 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <boost/bimap.hpp>
-#include <boost/bimap/multiset_of.hpp>
-#include <boost/bimap/unordered_set_of.hpp>
+#include <map>
+#include <boost/functional/hash.hpp>
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/mem_fun.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/tag.hpp>
+#include <boost/pool/pool_alloc.hpp>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/blockchain/define.hpp>
 #include <bitcoin/blockchain/settings.hpp>
@@ -37,16 +44,90 @@ struct BCB_API transaction_pool_state
 public:
     typedef double priority;
 
-    // A bidirection map is used for efficient output and position retrieval.
-    // This produces the effect of a prioritized buffer tx hash table of outputs.
-    // TODO: replace with multi_indexed_container tracking dependency ordering
-    // for mempool/template emission efficiency
-    typedef boost::bimaps::bimap<
-        boost::bimaps::unordered_set_of<transaction_entry::ptr,
-            boost::hash<boost::bimaps::tags::support::value_type_of<
-                transaction_entry::ptr>::type>,
-            transaction_entry::ptr_equal>,
-        boost::bimaps::multiset_of<priority, std::greater<priority>>> prioritized_transactions;
+    /// A pooled entry, its priority and its template membership.
+    struct pooled_transaction
+    {
+        transaction_entry::ptr entry;
+        priority value;
+        bool templated;
+
+        // Parents are pooled before children, so this is topological.
+        uint64_t sequence;
+
+        // The lesser of the priority and the rates of pooled parents, so a
+        // parent never has a lower rate (or bucket) than its children.
+        priority rate;
+        int32_t bucket;
+
+        // Sums over the entry and its pooled descendants, for eviction.
+        uint64_t descendant_fees;
+        uint64_t descendant_bytes;
+
+        // The approximate memory cost of the entry, its node and edges.
+        size_t footprint;
+
+        /// Anchors are not evictable, so rate above all txs.
+        priority descendant_rate() const;
+    };
+
+    struct by_entry {};
+    struct by_priority {};
+    struct by_sequence {};
+    struct by_mempool {};
+    struct by_descendant {};
+
+    // A multi-index container is used for efficient retrieval by hash, by
+    // priority within or outside of the template, and in dependency order.
+    // Priority and membership changes are in place and do not allocate.
+    typedef boost::multi_index_container<pooled_transaction,
+        boost::multi_index::indexed_by<
+            boost::multi_index::hashed_unique<
+                boost::multi_index::tag<by_entry>,
+                boost::multi_index::member<pooled_transaction,
+                    transaction_entry::ptr, &pooled_transaction::entry>,
+                boost::hash<transaction_entry::ptr>,
+                transaction_entry::ptr_equal>,
+            boost::multi_index::ordered_non_unique<
+                boost::multi_index::tag<by_priority>,
+                boost::multi_index::composite_key<pooled_transaction,
+                    boost::multi_index::member<pooled_transaction, bool,
+                        &pooled_transaction::templated>,
+                    boost::multi_index::member<pooled_transaction, priority,
+                        &pooled_transaction::value>>,
+                boost::multi_index::composite_key_compare<
+                    std::less<bool>, std::greater<priority>>>,
+            boost::multi_index::ordered_unique<
+                boost::multi_index::tag<by_sequence>,
+                boost::multi_index::composite_key<pooled_transaction,
+                    boost::multi_index::member<pooled_transaction, bool,
+                        &pooled_transaction::templated>,
+                    boost::multi_index::member<pooled_transaction, uint64_t,
+                        &pooled_transaction::sequence>>>,
+            boost::multi_index::ordered_unique<
+                boost::multi_index::tag<by_mempool>,
+                boost::multi_index::composite_key<pooled_transaction,
+                    boost::multi_index::member<pooled_transaction, int32_t,
+                        &pooled_transaction::bucket>,
+                    boost::multi_index::member<pooled_transaction, uint64_t,
+                        &pooled_transaction::sequence>>,
+                boost::multi_index::composite_key_compare<
+                    std::greater<int32_t>, std::less<uint64_t>>>,
+            boost::multi_index::ordered_non_unique<
+                boost::multi_index::tag<by_descendant>,
+                boost::multi_index::const_mem_fun<pooled_transaction,
+                    priority, &pooled_transaction::descendant_rate>>>,
+        boost::fast_pool_allocator<pooled_transaction>>
+        prioritized_transactions;
+
+    typedef prioritized_transactions::index<by_priority>::type priority_index;
+    typedef prioritized_transactions::index<by_sequence>::type sequence_index;
+    typedef prioritized_transactions::index<by_mempool>::type mempool_index;
+
+    /// Anchors sort below all txs in the mempool index.
+    static const int32_t anchor_bucket;
+
+    /// The logarithmic feerate bucket of the rate (satoshis per byte).
+    static int32_t to_bucket(priority rate);
 
     transaction_pool_state();
 
@@ -54,9 +135,46 @@ public:
 
     ~transaction_pool_state();
 
+    /// Pool the entry outside of the template, false if already pooled.
+    bool insert(transaction_entry::ptr entry, priority value);
+
+    /// Remove the entry from the pool and template, false if not pooled.
+    /// Only the entry is removed from the sums of its ancestors, which must
+    /// therefore remain linked during the call, as must those of each pooled
+    /// descendant until it is itself erased.
+    bool erase(transaction_entry::ptr entry);
+
+    /// The pooled non-anchor with the lowest descendant feerate (or nullptr).
+    transaction_entry::ptr lowest_descendant_rate() const;
+
+    /// The entry is pooled.
+    bool exists(transaction_entry::ptr entry) const;
+
+    /// The entry is pooled and within the template.
+    bool templated(transaction_entry::ptr entry) const;
+
+    /// The priority of the pooled entry (zero if not pooled).
+    priority priority_of(transaction_entry::ptr entry) const;
+
+    /// Change the priority of the pooled entry in place, updating its rate.
+    /// Descendant rates are not updated, so change parents before children.
+    void set_priority(transaction_entry::ptr entry, priority value);
+
+    /// The insertion sequence of the pooled entry (zero if not pooled).
+    uint64_t sequence_of(transaction_entry::ptr entry) const;
+
+    /// The insertion sequence of the next pooled entry.
+    uint64_t next_sequence() const;
+
+    /// Add the pooled entry to the template, accumulating bytes and sigops.
+    bool select(transaction_entry::ptr entry);
+
+    /// Remove the entry from the template, releasing bytes and sigops.
+    bool deselect(transaction_entry::ptr entry);
+
     size_t block_template_bytes;
     size_t block_template_sigops;
-    prioritized_transactions block_template;
+    size_t pool_bytes;
     prioritized_transactions pool;
 
     size_t template_byte_limit;
@@ -64,11 +182,21 @@ public:
     size_t coinbase_byte_reserve;
     size_t coinbase_sigop_reserve;
 
+    /// Descendants of anchors, sorted by pool sequence when cached (closures
+    /// are computed in stack preorder) and appended on insert, so that
+    /// closure queries need not traverse the graph.
     std::map<transaction_entry::ptr, transaction_entry::list> cached_child_closures;
-    transaction_entry::list ordered_block_template;
 
 private:
+    priority rate_of(transaction_entry::ptr entry, priority value) const;
+    void add_descendant(transaction_entry::ptr entry, int64_t fees,
+        int64_t bytes, bool pooled);
+    void update_child_closure(transaction_entry::ptr ancestor,
+        transaction_entry::ptr entry, bool pooled);
+    void set_templated(prioritized_transactions::iterator it, bool templated);
     void disconnect_entries();
+
+    uint64_t sequence_;
 };
 
 } // namespace blockchain
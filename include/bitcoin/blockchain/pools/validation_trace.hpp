@@ -0,0 +1,139 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_VALIDATION_TRACE_HPP
+#define LIBBITCOIN_BLOCKCHAIN_VALIDATION_TRACE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+#include <bitcoin/blockchain/validate/input_scheduler.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Optional trace of each validated block, written as one JSON object per
+/// line. Once the file reaches its limit it is renamed (replacing the prior
+/// rotation) with a ".1" suffix and a new file is started.
+/// Population and connect stages report by block hash, and are retained
+/// until the block is written (or displaced by blocks that are abandoned).
+class BCB_API validation_trace
+  : noncopyable
+{
+public:
+    struct record
+    {
+        size_t height;
+        std::string hash;
+        int error;
+
+        /// Non-coinbase transactions and those skipped as verified.
+        size_t transactions;
+        size_t verified;
+
+        /// Prevouts resolved within the block, and the remainder populated
+        /// from the utxo cache or the store (with previous txs read from it).
+        size_t internal;
+        size_t prevouts;
+        size_t store_reads;
+
+        /// Inputs scheduled over buckets and the completion of each bucket.
+        size_t inputs;
+        size_t buckets;
+        std::vector<size_t> bucket_microseconds;
+        float utilization;
+        float imbalance;
+
+        /// The tx pool cache hit rate of the block.
+        float cache_efficiency;
+
+        /// Stage latencies, and the wait on the validation lock (of the first
+        /// block validated under the lock only).
+        uint64_t populate_microseconds;
+        uint64_t accept_microseconds;
+        uint64_t connect_microseconds;
+        uint64_t lock_microseconds;
+    };
+
+    /// Construct a trace to the given file (empty disables), rotated at the
+    /// given size (zero does not rotate).
+    validation_trace(const boost::filesystem::path& file,
+        size_t maximum_megabytes);
+
+    /// The trace is enabled.
+    bool enabled() const;
+
+    /// Retain the population counts of the block until it is written.
+    void populated(const hash_digest& hash, size_t internal, size_t prevouts,
+        size_t store_reads);
+
+    /// Retain the connect summary of the block until it is written.
+    void connected(const hash_digest& hash,
+        const input_scheduler::statistics& summary);
+
+    /// Write the record of the validated block, from its metadata and any
+    /// retained population and connect summary.
+    void write(block_const_ptr block, uint64_t lock_microseconds);
+
+    /// Write the record.
+    void write(const record& value);
+
+    /// The record as a single line JSON object (without line terminator).
+    static std::string to_json(const record& value);
+
+private:
+    struct stages
+    {
+        size_t internal;
+        size_t prevouts;
+        size_t store_reads;
+        bool connected;
+        input_scheduler::statistics summary;
+    };
+
+    typedef std::unordered_map<hash_digest, stages> pending;
+
+    stages& find(const hash_digest& hash);
+    bool open();
+    void rotate();
+
+    // These are thread safe.
+    const boost::filesystem::path file_;
+    const size_t maximum_bytes_;
+
+    // These are protected by mutex.
+    pending pending_;
+    std::deque<hash_digest> order_;
+    boost::filesystem::ofstream stream_;
+    size_t bytes_;
+    std::mutex mutex_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
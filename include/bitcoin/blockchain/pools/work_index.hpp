@@ -0,0 +1,74 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_WORK_INDEX_HPP
+#define LIBBITCOIN_BLOCKCHAIN_WORK_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Prefix sums of header proof for a block index above a base height, so
+/// that the work between any two indexed heights is a subtraction. The index
+/// is maintained incrementally as headers are pushed to and popped from the
+/// store index. Heights below the base require a store read.
+class BCB_API work_index
+{
+public:
+    /// Construct an empty index based at genesis.
+    work_index();
+
+    /// The height below the first indexed height.
+    size_t base() const;
+
+    /// The top indexed height (base if empty).
+    size_t top() const;
+
+    /// Clear the index and set the base height.
+    void reset(size_t base_height);
+
+    /// Index the proof of the header at the height above top.
+    void push(uint32_t bits);
+
+    /// Remove heights above the given height (resets if below base).
+    void pop(size_t height);
+
+    /// Get the work of heights above above_height to top_height inclusive.
+    /// False if either height is outside of the indexed range.
+    bool work(uint256_t& out_work, size_t above_height,
+        size_t top_height) const;
+
+private:
+    uint256_t sum(size_t height) const;
+
+    // These are protected by mutex.
+    size_t base_;
+    std::vector<uint256_t> sums_;
+    mutable shared_mutex mutex_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,118 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_WORKLOAD_RECORDER_HPP
+#define LIBBITCOIN_BLOCKCHAIN_WORKLOAD_RECORDER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Optional capture of each organize call (headers, blocks and txs) to a
+/// binary file, for deterministic replay against a copy of the store at its
+/// start. The capture begins with the confirmed and candidate tops at start.
+/// A record is the entity, the microseconds since the prior record, the
+/// candidate height (blocks only), and the serialized (wire, witness)
+/// payload. A capture present at start is renamed with the first unused
+/// numeric suffix (".1", ".2", ...), so that no capture is overwritten.
+/// Recording ends at stop, or once the file reaches its limit.
+class BCB_API workload_recorder
+  : noncopyable
+{
+public:
+    enum class entity : uint8_t
+    {
+        header,
+        headers,
+        transaction,
+        transactions,
+        block
+    };
+
+    struct record
+    {
+        entity type;
+        uint64_t microseconds;
+        size_t height;
+        data_chunk payload;
+    };
+
+    /// The leading bytes of a capture file.
+    static const uint32_t magic;
+
+    /// Construct a stopped recorder to the given file (empty disables),
+    /// stopped at the given size (zero does not stop).
+    workload_recorder(const boost::filesystem::path& file,
+        size_t maximum_megabytes);
+
+    /// The recorder is enabled.
+    bool enabled() const;
+
+    /// Start a capture from the given tops, false if the file fails to open.
+    bool start(const config::checkpoint& confirmed,
+        const config::checkpoint& candidate);
+
+    /// Record an organize call, ignored unless started.
+    void write(header_const_ptr header);
+    void write(headers_const_ptr headers);
+    void write(transaction_const_ptr tx);
+    void write(transaction_const_ptr_list_const_ptr txs);
+    void write(block_const_ptr block, size_t height);
+
+    /// Close the file, later writes are ignored.
+    void stop();
+
+    /// Read the capture magic and tops at start, false if not a capture.
+    static bool read_start(config::checkpoint& out_confirmed,
+        config::checkpoint& out_candidate, reader& source);
+
+    /// Read the next record, false if exhausted or the record is partial.
+    static bool read(record& out_record, reader& source);
+
+    /// Serialize the record.
+    static void write(writer& sink, const record& value);
+
+private:
+    void write(entity type, size_t height, data_chunk payload);
+    void rotate() const;
+
+    // These are thread safe.
+    const boost::filesystem::path file_;
+    const size_t maximum_bytes_;
+
+    // These are protected by mutex.
+    bool stopped_;
+    bool full_;
+    size_t bytes_;
+    asio::time_point last_;
+    boost::filesystem::ofstream stream_;
+    std::mutex mutex_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_COMPACT_OUTPUT_HPP
+#define LIBBITCOIN_BLOCKCHAIN_COMPACT_OUTPUT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is NOT thread safe.
+/// The value and script of an output, with the standard script templates
+/// (pay to key hash, pay to script hash and both witness programs) reduced to
+/// their hash, so that these retain no heap allocation. Other scripts are
+/// retained as their serialization. The output is rebuilt on demand.
+class BCB_API compact_output
+{
+public:
+    /// Construct an invalid output.
+    compact_output();
+
+    /// Construct from the output, compressing its script if templated.
+    compact_output(const chain::output& output);
+
+    /// The output value.
+    uint64_t value() const;
+
+    /// The script is one of the standard templates.
+    bool templated() const;
+
+    /// The approximate number of bytes retained.
+    size_t size() const;
+
+    /// Rebuild the full output (the script is parsed).
+    chain::output to_output() const;
+
+private:
+    enum class form : uint8_t
+    {
+        raw,
+        pay_key_hash,
+        pay_script_hash,
+        witness_key_hash,
+        witness_script_hash
+    };
+
+    uint64_t value_;
+    form form_;
+    hash_digest hash_;
+    data_chunk raw_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_PENDING_OUTPUTS_HPP
+#define LIBBITCOIN_BLOCKCHAIN_PENDING_OUTPUTS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is not thread safe (const methods are safe for concurrent use).
+/// Outputs created and spent by blocks that are validated but not yet marked
+/// as candidates in the store, used to populate prevouts of successor blocks.
+class BCB_API pending_outputs
+{
+public:
+    typedef std::shared_ptr<pending_outputs> ptr;
+    typedef std::shared_ptr<const pending_outputs> const_ptr;
+
+    /// Construct an empty instance.
+    pending_outputs();
+
+    /// Index the outputs created and spent by the block (requires state).
+    void add(block_const_ptr block);
+
+    /// Clear all indexed blocks.
+    void clear();
+
+    /// True if there are no indexed blocks.
+    bool empty() const;
+
+    /// Override store-populated prevout metadata with that of indexed blocks.
+    /// Returns true if the prevout was created or spent by an indexed block.
+    bool populate(const chain::output_point& outpoint) const;
+
+private:
+    struct creator
+    {
+        const chain::transaction* transaction;
+        size_t height;
+        uint32_t median_time_past;
+        bool coinbase;
+    };
+
+    typedef std::unordered_map<hash_digest, creator> creators;
+    typedef std::unordered_set<chain::point> spends;
+
+    // Blocks are retained so that creator transaction pointers remain valid.
+    block_const_ptr_list blocks_;
+    creators creators_;
+    spends spends_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
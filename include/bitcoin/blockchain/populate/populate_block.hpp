@@ -20,11 +20,17 @@
 #define LIBBITCOIN_BLOCKCHAIN_POPULATE_BLOCK_HPP
 
 #include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/blockchain/define.hpp>
 #include <bitcoin/blockchain/interface/fast_chain.hpp>
 #include <bitcoin/blockchain/pools/header_branch.hpp>
+#include <bitcoin/blockchain/pools/validation_trace.hpp>
+#include <bitcoin/blockchain/populate/pending_outputs.hpp>
 #include <bitcoin/blockchain/populate/populate_base.hpp>
+#include <bitcoin/blockchain/validate/abort_token.hpp>
 
 namespace libbitcoin {
 namespace blockchain {
@@ -34,18 +40,52 @@ class BCB_API populate_block
   : public populate_base
 {
 public:
-    populate_block(dispatcher& dispatch, const fast_chain& chain);
+    populate_block(dispatcher& dispatch, const fast_chain& chain,
+        validation_trace& trace);
 
     /// Populate validation state for the the next block.
-    void populate(block_const_ptr block, result_handler&& handler) const;
+    /// Population is abandoned (without error) once the token is tripped.
+    void populate(block_const_ptr block, abort_token::ptr token,
+        result_handler&& handler) const;
+
+    /// Populate validation state for the block that follows the given parent,
+    /// where the parent is validated but not yet a candidate in the store.
+    void populate(block_const_ptr block, block_const_ptr parent,
+        abort_token::ptr token, result_handler&& handler) const;
 
 protected:
+    // Block position of each tx by hash, used to resolve intra-block spends.
+    typedef std::unordered_map<hash_digest, size_t> positions;
+    typedef std::shared_ptr<const positions> positions_ptr;
+
+    // Non-coinbase inputs (in block order) populated from the tx pool.
+    typedef std::vector<bool> pooled;
+    typedef std::shared_ptr<const pooled> pooled_ptr;
+
+    static size_t to_bucket(const chain::output_point& prevout,
+        size_t buckets);
+    static bool populate_internal(block_const_ptr block,
+        const positions& internal, const chain::output_point& prevout,
+        size_t spender);
+    static bool is_next_confirmed(size_t height, size_t fork_height,
+        size_t next_confirmed_height);
+
+    void populate(block_const_ptr block, chain::chain_state::ptr parent_state,
+        pending_outputs::const_ptr pending, abort_token::ptr token,
+        result_handler&& handler) const;
     void populate_coinbase(block_const_ptr block, size_t fork_height) const;
     void populate_non_coinbase(block_const_ptr block, size_t fork_height,
-        bool use_txs, result_handler handler) const;
+        bool use_txs, pending_outputs::const_ptr pending,
+        abort_token::ptr token, result_handler handler) const;
     void populate_transactions(block_const_ptr block, size_t fork_height,
         size_t bucket, size_t buckets, bool use_txs,
+        pending_outputs::const_ptr pending, positions_ptr internal,
+        pooled_ptr from_pool, abort_token::ptr token,
         result_handler handler) const;
+
+private:
+    // This is thread safe.
+    validation_trace& trace_;
 };
 
 } // namespace blockchain
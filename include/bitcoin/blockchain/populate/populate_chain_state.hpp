@@ -48,6 +48,14 @@ public:
     chain::chain_state::ptr populate( chain::header& header,
         size_t header_height, bool candidate) const;
 
+    /// Populate chain state data for candidate or confirmed block|header by
+    /// height, for persistence.
+    bool populate(chain::chain_state::data& out_data, size_t header_height,
+        bool candidate) const;
+
+    /// Construct chain state from persisted data (no store reads).
+    chain::chain_state::ptr populate(chain::chain_state::data&& data) const;
+
 private:
     typedef chain::header header;
     typedef chain::chain_state::map map;
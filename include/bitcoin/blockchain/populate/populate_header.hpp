@@ -38,8 +38,12 @@ public:
     /// Populate validation state for the top indexed block.
     void populate(header_branch::ptr branch, result_handler&& handler) const;
 
+    /// Populate validation state for the top indexed block (blocking).
+    code populate(header_branch::ptr branch) const;
+
 private:
     bool set_branch_state(header_branch::ptr branch) const;
+    chain::chain_state::ptr rematerialize(header_branch::ptr branch) const;
 };
 
 } // namespace blockchain
@@ -20,6 +20,7 @@
 #define LIBBITCOIN_BLOCKCHAIN_POPULATE_TRANSACTION_HPP
 
 #include <cstddef>
+#include <memory>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/blockchain/define.hpp>
 #include <bitcoin/blockchain/interface/fast_chain.hpp>
@@ -38,9 +39,19 @@ public:
     /// Populate validation state for the pool transaction.
     void populate(transaction_const_ptr tx, result_handler&& handler) const;
 
+    /// Populate validation state for a set of pool transactions against one
+    /// chain state, with the prevouts of the set fanned out together.
+    void populate(transaction_const_ptr_list_const_ptr txs,
+        result_handler&& handler) const;
+
 protected:
+    typedef std::shared_ptr<const fast_chain::outpoints> outpoints_ptr;
+
     void populate_inputs(transaction_const_ptr tx, size_t bucket,
         size_t buckets, result_handler handler) const;
+    void populate_prevouts(transaction_const_ptr_list_const_ptr txs,
+        outpoints_ptr prevouts, size_t bucket, size_t buckets,
+        result_handler handler) const;
 };
 
 } // namespace blockchain
@@ -0,0 +1,122 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_UTXO_CACHE_HPP
+#define LIBBITCOIN_BLOCKCHAIN_UTXO_CACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+#include <bitcoin/blockchain/populate/compact_output.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Memory-bounded set of unspent outputs of the candidate chain, populated as
+/// blocks become valid candidates. Entries are evicted oldest first, so the
+/// outputs of recent blocks are retained. A miss implies only a store read.
+/// Outputs are retained compact (standard scripts as their hash), and the
+/// full output is rebuilt only as a prevout is populated.
+/// Each added block leaves an undo record (its created outputs and the cached
+/// outputs it spent), so disconnecting candidates replays records in reverse
+/// instead of discarding the cache.
+class BCB_API utxo_cache
+{
+public:
+    /// Construct a cache bounded to the given size (zero disables), retaining
+    /// undo records for the given number of blocks (zero is unbounded).
+    utxo_cache(size_t maximum_megabytes, size_t maximum_depth=0);
+
+    /// The cache is disabled.
+    bool disabled() const;
+
+    /// The number of cached outputs.
+    size_t size() const;
+
+    /// The bytes of cached outputs and undo records.
+    size_t bytes() const;
+
+    /// The ratio of populate hits to populate queries.
+    float hit_rate() const;
+
+    /// Populate metadata of a candidate chain prevout, false if not cached.
+    bool populate(const chain::output_point& outpoint,
+        size_t fork_height) const;
+
+    /// Add outputs created and remove outputs spent by the candidate block.
+    void add(block_const_ptr block);
+
+    /// Disconnect candidates above the fork height by replaying their undo
+    /// records, clearing all entries if any record has been pruned (false).
+    bool disconnect(size_t fork_height);
+
+    /// Remove all entries and undo records.
+    void clear();
+
+private:
+    struct entry
+    {
+        compact_output output;
+        size_t height;
+        uint32_t median_time_past;
+        bool coinbase;
+        size_t bytes;
+    };
+
+    typedef std::unordered_map<chain::point, entry> entries;
+
+    struct undo
+    {
+        size_t height;
+        std::vector<chain::point> created;
+        std::vector<std::pair<chain::point, entry>> spent;
+        size_t bytes;
+    };
+
+    void evict();
+    void push(undo&& record);
+    void replay(const undo& record);
+    void reset();
+
+    // These are thread safe.
+    const size_t maximum_bytes_;
+    const size_t maximum_depth_;
+    mutable std::atomic<size_t> hits_;
+    mutable std::atomic<size_t> queries_;
+
+    // These are protected by mutex.
+    entries entries_;
+    std::deque<chain::point> order_;
+    size_t bytes_;
+    std::deque<undo> journal_;
+    size_t journal_bytes_;
+    size_t unrecorded_;
+    mutable shared_mutex mutex_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
@@ -20,6 +20,7 @@
 #define LIBBITCOIN_BLOCKCHAIN_SETTINGS_HPP
 
 #include <cstdint>
+#include <vector>
 #include <boost/filesystem.hpp>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/blockchain/define.hpp>
@@ -39,14 +40,47 @@ public:
 
     /// Properties.
     uint32_t cores;
+    uint32_t io_cores;
+    std::vector<uint32_t> script_affinity;
+    std::vector<uint32_t> io_affinity;
+    int32_t numa_node;
     bool priority;
     bool use_libconsensus;
+    bool pipelined_validation;
+    bool fused_validation;
+    bool differential_verification;
+    uint32_t script_cache_size;
+    uint32_t utxo_cache_megabytes;
+    uint32_t candidate_cache_megabytes;
+    uint32_t hash_filter_megabytes;
+    uint32_t merkle_cache_megabytes;
+    uint32_t transaction_cache_megabytes;
+    uint32_t header_pool_megabytes;
+    uint32_t transaction_pool_megabytes;
+    uint32_t memory_budget_megabytes;
+    uint32_t download_cache_blocks;
+    uint32_t prefetch_blocks;
+    uint32_t speculative_blocks;
+    uint32_t checkpoint_window_blocks;
+    uint32_t header_commit_milliseconds;
     float byte_fee_satoshis;
     float sigop_fee_satoshis;
     uint64_t minimum_output_satoshis;
     uint32_t notify_limit_hours;
+    uint32_t notification_queue_limit;
+    uint32_t index_queue_limit;
+    bool index_filters;
+    bool map_headers;
+    bool index_spends;
+    boost::filesystem::path validation_trace_file;
+    uint32_t validation_trace_megabytes;
+    boost::filesystem::path workload_file;
+    uint32_t workload_megabytes;
     uint32_t reorganization_limit;
+    uint32_t prune_blocks;
+    uint32_t prune_witness_blocks;
     config::checkpoint::list checkpoints;
+    config::hash256 assume_valid;
     bool difficult;
     bool retarget;
     bool bip16;
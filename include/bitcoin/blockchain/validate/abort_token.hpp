@@ -0,0 +1,54 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_ABORT_TOKEN_HPP
+#define LIBBITCOIN_BLOCKCHAIN_ABORT_TOKEN_HPP
+
+#include <atomic>
+#include <memory>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Shared by the populate, accept and connect fan-outs of one block. Tripped
+/// upon the first failure (or by the organizer) so that all workers return.
+class BCB_API abort_token
+{
+public:
+    typedef std::shared_ptr<abort_token> ptr;
+
+    /// Construct an untripped token.
+    abort_token();
+
+    /// Signal all workers of the block to stop.
+    void trip();
+
+    /// True if the remaining work of the block should be skipped.
+    bool tripped() const;
+
+private:
+    std::atomic<bool> tripped_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_INPUT_SCHEDULER_HPP
+#define LIBBITCOIN_BLOCKCHAIN_INPUT_SCHEDULER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Partitions the unverified non-coinbase inputs of a block into contiguous
+/// ranges, one per bucket, of near equal estimated verification cost (script
+/// and witness bytes and sigops). Each bucket claims chunks from its own range
+/// and steals chunks from the ranges of other buckets once its own is empty.
+class BCB_API input_scheduler
+{
+public:
+    typedef std::shared_ptr<input_scheduler> ptr;
+
+    /// Scheduler work summary, valid once all buckets have completed.
+    struct statistics
+    {
+        /// Buckets over which inputs were partitioned.
+        size_t buckets;
+
+        /// Non-coinbase transactions and those skipped as verified.
+        size_t transactions;
+        size_t verified;
+
+        /// Inputs scheduled and those claimed by buckets other than owner.
+        size_t inputs;
+        size_t stolen;
+
+        /// Chunks claimed from the ranges of other buckets.
+        size_t steals;
+
+        /// Microseconds from construction until the last bucket completed.
+        size_t wall_microseconds;
+
+        /// Mean bucket completion time over that of the last (1 is perfect).
+        float utilization;
+
+        /// Estimated cost of the costliest range over the mean (1 is perfect).
+        float imbalance;
+
+        /// Microseconds from construction until each bucket completed.
+        std::vector<size_t> bucket_microseconds;
+    };
+
+    /// Schedule inputs of all non-coinbase transactions not yet verified.
+    /// Previous outputs should be populated, as these are part of the cost.
+    input_scheduler(block_const_ptr block, size_t maximum_buckets);
+
+    /// The estimated verification cost of the input (in units of a byte).
+    static uint64_t cost(const chain::input& input, bool bip16, bool bip141);
+
+    /// The number of buckets (zero if there are no inputs to verify).
+    size_t buckets() const;
+
+    /// The number of non-coinbase transactions in the block.
+    size_t transactions() const;
+
+    /// The number of those transactions skipped as already verified.
+    size_t verified() const;
+
+    /// The number of inputs scheduled across all buckets.
+    size_t inputs() const;
+
+    /// Claim the next chunk [begin, end) for the bucket, stealing if needed.
+    /// Returns false when all ranges are exhausted.
+    bool next(size_t bucket, size_t& begin, size_t& end);
+
+    /// Map a scheduled position to its block transaction and input index.
+    void locate(size_t position, size_t& out_transaction,
+        uint32_t& out_input) const;
+
+    /// Record completion of the bucket (call once per bucket).
+    void complete(size_t bucket);
+
+    /// Summarize the scheduler work, call only after all buckets complete.
+    statistics summary() const;
+
+private:
+    typedef asio::steady_clock clock;
+
+    struct range
+    {
+        std::atomic<size_t> cursor;
+        size_t end;
+    };
+
+    struct counters
+    {
+        size_t inputs;
+        size_t stolen;
+        size_t steals;
+        clock::time_point completed;
+    };
+
+    bool claim(size_t bucket, size_t& begin, size_t& end);
+
+    // These are thread safe (immutable after construction).
+    const clock::time_point started_;
+    size_t transactions_;
+    size_t verified_;
+    size_t inputs_;
+    size_t chunk_;
+    float imbalance_;
+
+    // Block transaction index and first scheduled position of each tx.
+    std::vector<size_t> positions_;
+    std::vector<size_t> offsets_;
+
+    // These are thread safe (ranges are atomic, counters are per bucket).
+    std::vector<range> ranges_;
+    std::vector<counters> counters_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,70 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_MERKLE_BUILDER_HPP
+#define LIBBITCOIN_BLOCKCHAIN_MERKLE_BUILDER_HPP
+
+#include <cstddef>
+#include <memory>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Computes merkle roots by folding power of two subtrees of the leaves
+/// concurrently and then combining the subtree roots, so that the txid and
+/// wtxid trees of large blocks do not serialize on the calling thread.
+class BCB_API merkle_builder
+{
+public:
+    /// Smaller leaf sets are folded serially, as dispatch would dominate.
+    static const size_t minimum_parallel_leaves;
+
+    /// Subtrees are folded on the given dispatcher and the calling thread.
+    merkle_builder(dispatcher& dispatch);
+
+    /// The merkle root of the leaves (null_hash if there are none).
+    hash_digest root(const hash_list& leaves) const;
+
+    /// The merkle root of the tx hashes of the block.
+    hash_digest root(block_const_ptr block) const;
+
+    /// The merkle root of the witness tx hashes of the block, with the
+    /// coinbase leaf as null_hash (bip141).
+    hash_digest witness_root(block_const_ptr block) const;
+
+    /// The merkle root of the leaves, folded on the calling thread.
+    static hash_digest serial_root(const hash_list& leaves);
+
+private:
+    struct fold_batch;
+
+    static hash_digest fold(const hash_list& leaves, size_t begin,
+        size_t end, size_t height);
+    static void fold_subtrees(std::shared_ptr<fold_batch> batch);
+
+    // This is thread safe.
+    dispatcher& dispatch_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
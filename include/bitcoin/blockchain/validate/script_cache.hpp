@@ -0,0 +1,114 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_SCRIPT_CACHE_HPP
+#define LIBBITCOIN_BLOCKCHAIN_SCRIPT_CACHE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe.
+/// Bounded set of successful script verifications, keyed by witness hash,
+/// input index and fork flags. A change in any of these forces verification.
+/// The oldest entries of a shard are evicted once the shard is full.
+/// Signature operation counts of txs are also retained, keyed by witness hash
+/// and the bip16/bip141 combination, so that the pool and block validation
+/// each do not parse the scripts of a tx again.
+class BCB_API script_cache
+{
+public:
+    /// Construct a cache of the given maximum entry count (zero disables).
+    script_cache(size_t capacity);
+
+    /// The maximum number of entries.
+    size_t capacity() const;
+
+    /// The current number of entries.
+    size_t size() const;
+
+    /// The input script of the tx has been verified under the forks.
+    bool exists(const chain::transaction& tx, uint32_t input_index,
+        uint32_t forks) const;
+
+    /// Record successful verification of the tx input under the forks.
+    void add(const chain::transaction& tx, uint32_t input_index,
+        uint32_t forks);
+
+    /// The signature operation count of the tx under the forks of its chain
+    /// state (see below), or of the tx without state if there is none.
+    size_t signature_operations(const chain::transaction& tx);
+
+    /// The signature operation count of the tx, counted upon first request.
+    /// Counts are retained only if all previous outputs are populated.
+    size_t signature_operations(const chain::transaction& tx, bool bip16,
+        bool bip141);
+
+    /// Remove all entries.
+    void clear();
+
+private:
+    struct key
+    {
+        hash_digest hash;
+        uint32_t index;
+        uint32_t forks;
+
+        bool operator==(const key& other) const;
+    };
+
+    struct key_hash
+    {
+        size_t operator()(const key& value) const;
+    };
+
+    struct shard
+    {
+        std::unordered_set<key, key_hash> keys;
+        std::deque<key> order;
+        std::unordered_map<key, size_t, key_hash> sigops;
+        std::deque<key> sigop_order;
+        mutable shared_mutex mutex;
+    };
+
+    static constexpr size_t shard_count = 16;
+
+    static key to_key(const chain::transaction& tx, uint32_t input_index,
+        uint32_t forks);
+
+    shard& to_shard(const key& value);
+    const shard& to_shard(const key& value) const;
+
+    // These are thread safe.
+    const size_t capacity_;
+    const size_t shard_capacity_;
+    std::array<shard, shard_count> shards_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
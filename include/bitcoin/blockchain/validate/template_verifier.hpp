@@ -0,0 +1,59 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_TEMPLATE_VERIFIER_HPP
+#define LIBBITCOIN_BLOCKCHAIN_TEMPLATE_VERIFIER_HPP
+
+#include <cstdint>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/define.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is thread safe (static).
+/// Verifies inputs that spend the pay to key hash, witness key hash and
+/// script hash wrapped witness key hash templates by a single signature
+/// check, without the script interpreter. Only success is affirmed, as that
+/// implies success of the interpreter. Any other input (or any failure) is
+/// not affirmed, and must be verified by the generic path for its error.
+class BCB_API template_verifier
+{
+public:
+    /// True if the input matches a template and its signature is valid.
+    /// The previous output of the input must be populated.
+    static bool verify(const chain::transaction& tx, uint32_t input_index,
+        uint32_t forks);
+
+private:
+    static bool check_signature(const data_chunk& endorsement,
+        const data_chunk& public_key, const chain::script& script_code,
+        const chain::transaction& tx, uint32_t input_index, uint32_t forks,
+        chain::script_version version, uint64_t value);
+    static bool verify_key_hash(const chain::transaction& tx,
+        uint32_t input_index, uint32_t forks, const data_chunk& script_sig,
+        const short_hash& hash, uint64_t value);
+    static bool verify_witness_key_hash(const chain::transaction& tx,
+        uint32_t input_index, uint32_t forks, const short_hash& hash,
+        uint64_t value);
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
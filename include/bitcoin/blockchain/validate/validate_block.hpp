@@ -27,8 +27,13 @@
 #include <bitcoin/blockchain/define.hpp>
 #include <bitcoin/blockchain/interface/fast_chain.hpp>
 #include <bitcoin/blockchain/pools/header_branch.hpp>
+#include <bitcoin/blockchain/pools/validation_trace.hpp>
 #include <bitcoin/blockchain/populate/populate_block.hpp>
 #include <bitcoin/blockchain/settings.hpp>
+#include <bitcoin/blockchain/validate/abort_token.hpp>
+#include <bitcoin/blockchain/validate/input_scheduler.hpp>
+#include <bitcoin/blockchain/validate/merkle_builder.hpp>
+#include <bitcoin/blockchain/validate/script_cache.hpp>
 
 namespace libbitcoin {
 namespace blockchain {
@@ -39,47 +44,81 @@ class BCB_API validate_block
 public:
     typedef handle0 result_handler;
 
-    validate_block(dispatcher& dispatch, const fast_chain& chain,
+    /// Population is dispatched to the io pool, verification to priority.
+    validate_block(dispatcher& dispatch, dispatcher& io_dispatch,
+        const fast_chain& chain, script_cache& cache, validation_trace& trace,
         const settings& settings,  bc::settings& bitcoin_settings);
 
     void start();
     void stop();
 
     void check(block_const_ptr block, size_t height) const;
-    void accept(block_const_ptr block, result_handler handler) const;
-    void connect(block_const_ptr block, result_handler handler) const;
+    /// The token is shared by all stages of the block and is tripped upon
+    /// any validation failure, short-circuiting all outstanding work. A block
+    /// whose token is tripped by the caller is not validated (discard it).
+    void accept(block_const_ptr block, abort_token::ptr token,
+        result_handler handler) const;
+    void accept(block_const_ptr block, block_const_ptr parent,
+        abort_token::ptr token, result_handler handler) const;
+    void connect(block_const_ptr block, abort_token::ptr token,
+        result_handler handler) const;
+
+    /// Verify scripts of inputs that spend confirmed outputs, ahead of the
+    /// block being next, caching successes for its connect. This populates
+    /// the block, so it must not be shared with the validation sequence.
+    void speculate(block_const_ptr block) const;
 
 protected:
     bool stopped() const;
     float hit_rate() const;
+    bool is_assumed_valid(size_t height) const;
 
 private:
     typedef std::atomic<size_t> atomic_counter;
     typedef std::shared_ptr<atomic_counter> atomic_counter_ptr;
+    struct hash_batch;
 
+    static void hash_transactions(std::shared_ptr<hash_batch> batch);
     static void dump(const code& ec,  chain::transaction& tx,
         uint32_t input_index, uint32_t forks, size_t height,
         bool use_libconsensus);
 
+    void hash(block_const_ptr block) const;
     void handle_populated(const code& ec, block_const_ptr block,
-        result_handler handler) const;
+        abort_token::ptr token, result_handler handler) const;
     void accept_transactions(block_const_ptr block, size_t bucket,
         size_t buckets, atomic_counter_ptr sigops, bool bip16, bool bip141,
-        result_handler handler) const;
+        abort_token::ptr token, result_handler handler) const;
     void handle_accepted(const code& ec, block_const_ptr block,
-        atomic_counter_ptr sigops, bool bip141, result_handler handler) const;
-    void connect_inputs(block_const_ptr block, size_t bucket,
-        size_t buckets, result_handler handler) const;
+        atomic_counter_ptr sigops, bool bip141, abort_token::ptr token,
+        result_handler handler) const;
+    void connect_inputs(block_const_ptr block, input_scheduler::ptr scheduler,
+        abort_token::ptr token, size_t bucket, result_handler handler) const;
     void handle_connected(const code& ec, block_const_ptr block,
+        input_scheduler::ptr scheduler, result_handler handler) const;
+    void connect_fused(block_const_ptr block, abort_token::ptr token,
         result_handler handler) const;
+    void fuse_transactions(block_const_ptr block, size_t bucket,
+        size_t buckets, atomic_counter_ptr sigops, bool bip16, bool bip141,
+        bool accept, bool verify, abort_token::ptr token,
+        result_handler handler) const;
+    void handle_fused(const code& ec, block_const_ptr block,
+        atomic_counter_ptr sigops, bool bip141, result_handler handler) const;
 
     // These are thread safe.
     std::atomic<bool> stopped_;
     const bool use_libconsensus_;
+    const bool differential_;
+    const bool fused_;
+    const hash_digest assume_valid_;
     const config::checkpoint::list& checkpoints_;
+    const fast_chain& fast_chain_;
     dispatcher& priority_dispatch_;
+    const merkle_builder merkle_builder_;
     mutable atomic_counter hits_;
     mutable atomic_counter queries_;
+    script_cache& script_cache_;
+    validation_trace& trace_;
     populate_block block_populator_;
     const bool scrypt_;
     bc::settings& bitcoin_settings_;
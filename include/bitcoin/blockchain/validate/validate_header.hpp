@@ -43,6 +43,9 @@ public:
     code check(header_const_ptr block) const;
     void accept(header_branch::ptr branch, result_handler handler) const;
 
+    /// Populate and accept the top header of the branch (blocking).
+    code accept(header_branch::ptr branch) const;
+
 protected:
     bool stopped() const;
 
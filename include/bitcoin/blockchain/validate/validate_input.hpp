@@ -22,6 +22,7 @@
 #include <cstdint>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/blockchain/define.hpp>
+#include <bitcoin/blockchain/validate/script_cache.hpp>
 
 #ifdef WITH_CONSENSUS
 #include <bitcoin/consensus.hpp>
@@ -40,8 +41,22 @@ public:
     static code convert_result(consensus::verify_result_type result);
 #endif
 
+    /// Compute the bip143 signature hash components of a segregated tx into
+    /// its hash caches before its inputs are fanned out, so that buckets
+    /// share them and do not race to compute them.
+    static void prepare(const chain::transaction& tx);
+
+    /// With libconsensus the tx serialization is retained by the calling
+    /// thread, so consecutive inputs of one tx share a single serialization.
     static code verify_script( chain::transaction& tx,
         uint32_t input_index, uint32_t forks, bool use_libconsensus);
+
+    /// Verify the script unless cached, optionally caching success.
+    /// Standard templates are verified without the interpreter, and if
+    /// differential each affirmation is checked against the generic path.
+    static code verify_script( chain::transaction& tx,
+        uint32_t input_index, uint32_t forks, bool use_libconsensus,
+        script_cache& cache, bool store, bool differential);
 };
 
 } // namespace blockchain
@@ -21,10 +21,15 @@
 
 #include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/blockchain/define.hpp>
 #include <bitcoin/blockchain/populate/populate_transaction.hpp>
 #include <bitcoin/blockchain/settings.hpp>
+#include <bitcoin/blockchain/validate/script_cache.hpp>
 
 namespace libbitcoin {
 namespace blockchain {
@@ -34,8 +39,12 @@ class BCB_API validate_transaction
 {
 public:
     typedef handle0 result_handler;
+    typedef std::vector<code> result_list;
+    typedef std::shared_ptr<result_list> result_list_ptr;
 
-    validate_transaction(dispatcher& dispatch, const fast_chain& chain,
+    /// Population is dispatched to the io pool, verification to priority.
+    validate_transaction(dispatcher& dispatch, dispatcher& io_dispatch,
+        const fast_chain& chain, script_cache& cache,
         const settings& settings);
 
     void start();
@@ -45,6 +54,14 @@ public:
     void accept(transaction_const_ptr tx, result_handler handler) const;
     void connect(transaction_const_ptr tx, result_handler handler) const;
 
+    /// Set variants record a result for each tx, aligned with the set. A tx
+    /// with a failed result is skipped, and the handler code is only set for
+    /// failures of the set as a whole (i.e. stopped).
+    void accept(transaction_const_ptr_list_const_ptr txs,
+        result_list_ptr results, result_handler handler) const;
+    void connect(transaction_const_ptr_list_const_ptr txs,
+        result_list_ptr results, result_handler handler) const;
+
 protected:
     bool stopped() const;
 
@@ -54,11 +71,27 @@ private:
     void connect_inputs(transaction_const_ptr tx, size_t bucket,
         size_t buckets, result_handler handler) const;
 
+    // A flattened (tx position, input index) list over the set.
+    typedef std::vector<std::pair<size_t, uint32_t>> input_list;
+    typedef std::shared_ptr<const input_list> input_list_const_ptr;
+    typedef std::shared_ptr<std::vector<result_list>> bucket_results_ptr;
+
+    void handle_populated_set(const code& ec,
+        transaction_const_ptr_list_const_ptr txs, result_list_ptr results,
+        result_handler handler) const;
+    void connect_set_inputs(transaction_const_ptr_list_const_ptr txs,
+        input_list_const_ptr inputs, bucket_results_ptr partials,
+        size_t bucket, size_t buckets, result_handler handler) const;
+    void handle_connected_set(const code& ec, bucket_results_ptr partials,
+        result_list_ptr results, result_handler handler) const;
+
     // These are thread safe.
     std::atomic<bool> stopped_;
     const bool retarget_;
     const bool use_libconsensus_;
+    const bool differential_;
     dispatcher& dispatch_;
+    script_cache& script_cache_;
     populate_transaction transaction_populator_;
 };
 
@@ -19,12 +19,19 @@
 #include <bitcoin/blockchain/interface/block_chain.hpp>
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
+#include <ctime>
 #include <functional>
+#include <iterator>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/database.hpp>
 #include <bitcoin/blockchain/settings.hpp>
@@ -40,13 +47,64 @@ using namespace std::placeholders;
 
 #define NAME "block_chain"
 
+// Smaller blocks are deserialized serially, as dispatch would dominate.
+static constexpr size_t minimum_parallel_read = 64;
+
+// Each reader claims this many slabs per bucket, for balance across workers.
+static constexpr size_t slabs_per_bucket = 4;
+
+// History tx links are resolved in sorted batches of this size.
+static constexpr size_t history_batch = 1000;
+
+// Promoted chain states are allocated in slabs of this many states, so that
+// a full headers message promotes with about one allocation per slab.
+static constexpr size_t state_slab_size = 256;
+
+// Configured processors take precedence over those of the numa node.
+static thread_binder::cpus affinity(const thread_binder::cpus& configured,
+    int32_t numa_node)
+{
+    return !configured.empty() || numa_node < 0 ? configured :
+        thread_binder::node_cpus(static_cast<uint32_t>(numa_node));
+}
+
+// Chain state population reaches back at most a retarget interval or a bip9
+// activation sample, so windowing this many heights avoids store reads.
+static size_t window_size(const bc::settings& bitcoin_settings)
+{
+    return std::max(size_t(bitcoin_settings.retargeting_interval()),
+        size_t(bitcoin_settings.activation_sample)) + 1u;
+}
+
+// The tip snapshot is bound to the settings from which chain state derives.
+static hash_digest snapshot_context(const blockchain::settings& settings,
+    const bc::settings& bitcoin_settings)
+{
+    data_chunk data;
+    data_sink ostream(data);
+    ostream_writer sink(ostream);
+    sink.write_4_bytes_little_endian(settings.enabled_forks());
+    sink.write_4_bytes_little_endian(bitcoin_settings.retargeting_interval());
+    sink.write_8_bytes_little_endian(bitcoin_settings.activation_sample);
+
+    for (const auto& checkpoint: config::checkpoint::sort(
+        settings.checkpoints))
+    {
+        sink.write_hash(checkpoint.hash());
+        sink.write_8_bytes_little_endian(checkpoint.height());
+    }
+
+    ostream.flush();
+    return bitcoin_hash(data);
+}
+
 block_chain::block_chain(threadpool& pool,
     const blockchain::settings& settings,
     const database::settings& database_settings,
      bc::settings& bitcoin_settings)
   : database_(database_settings),
     stopped_(true),
-    fork_point_({ null_hash, 0 }),
+    view_(std::make_shared<chain_view>()),
     settings_(settings),
     bitcoin_settings_(bitcoin_settings),
     chain_state_populator_(*this, settings, bitcoin_settings),
@@ -56,31 +114,116 @@ block_chain::block_chain(threadpool& pool,
     validation_mutex_(database_settings.flush_writes),
 
     // Metadata pools.
-    header_pool_(settings.reorganization_limit),
-    transaction_pool_(settings),
+    header_pool_(settings.reorganization_limit, settings.header_pool_megabytes),
+    script_cache_(settings.script_cache_size),
+    transaction_pool_(settings, script_cache_),
+    utxo_cache_(settings.utxo_cache_megabytes, settings.reorganization_limit),
+    candidate_cache_(settings.candidate_cache_megabytes),
+    candidate_window_(window_size(bitcoin_settings)),
+    confirmed_window_(window_size(bitcoin_settings)),
+    tip_snapshot_(database_settings.directory / "tip_state",
+        snapshot_context(settings, bitcoin_settings)),
+    hash_filter_(settings.hash_filter_megabytes),
+    merkle_cache_(settings.merkle_cache_megabytes),
+    transaction_cache_(settings.transaction_cache_megabytes),
+    state_pool_(std::make_shared<state_pool>(state_slab_size)),
 
     // Create dispatchers for priority and non-priority operations.
-    priority_pool_(thread_ceiling(settings.cores) + 1u, priority(settings.priority)),
+    // Script verification (cpu) and population/reads (io) are pooled apart.
+    priority_pool_(thread_ceiling(settings.cores), priority(settings.priority)),
     priority_(priority_pool_, NAME "_priority"),
-    dispatch_(pool, NAME "_dispatch"),
+    io_pool_(thread_ceiling(settings.io_cores), priority(settings.priority)),
+    io_(io_pool_, NAME "_io"),
+
+    // Optional trace of each validated block.
+    trace_(settings.validation_trace_file, settings.validation_trace_megabytes),
+
+    // Optional capture of organize calls for replay.
+    workload_(settings.workload_file, settings.workload_megabytes),
+
+    // Pools and caches are enrolled with the memory budget below.
+    memory_budget_(settings.memory_budget_megabytes),
 
     // Organizers use priority dispatch and/or non-priority thread pool.
-    block_organizer_(validation_mutex_, priority_, pool, *this, settings,
-        bitcoin_settings),
-    header_organizer_(validation_mutex_, priority_, pool, *this, header_pool_,
-        settings.scrypt_proof_of_work, bitcoin_settings),
-    transaction_organizer_(validation_mutex_, priority_, pool, *this, transaction_pool_, settings),
+    block_organizer_(validation_mutex_, priority_, io_, pool, *this,
+        metrics_, trace_, script_cache_, settings, bitcoin_settings),
+    header_organizer_(validation_mutex_, priority_, pool, *this, metrics_,
+        header_pool_, settings, bitcoin_settings),
+    transaction_organizer_(validation_mutex_, priority_, io_, pool, *this,
+        metrics_, transaction_pool_, script_cache_, settings),
 
     // Subscriber thread pools are only used for unsubscribe, otherwise invoke.
     block_subscriber_(std::make_shared<block_subscriber>(pool, NAME "_block")),
     header_subscriber_(std::make_shared<header_subscriber>(pool, NAME "_header")),
-    transaction_subscriber_(std::make_shared<transaction_subscriber>(pool, NAME "_tx"))
+    transaction_subscriber_(std::make_shared<transaction_subscriber>(pool, NAME "_tx")),
+    template_subscriber_(std::make_shared<template_subscriber>(pool, NAME "_template")),
+    payment_subscriber_(std::make_shared<payment_subscriber>()),
+
+    // Subscribers are invoked in order on the dedicated notification thread.
+    notifications_(settings.notification_queue_limit,
+        [this](size_t fork_height, header_const_ptr_list_const_ptr incoming,
+            header_const_ptr_list_const_ptr outgoing)
+        {
+            const auto start = asio::steady_clock::now();
+            header_subscriber_->invoke(error::success, fork_height, incoming,
+                outgoing);
+            metrics_.record(stage_metrics::entity::header,
+                stage_metrics::stage::notify, start);
+        }),
+
+    // Payment indexing is batched on the dedicated indexer thread.
+    indexer_(database_settings.directory / "index_height",
+        settings.index_queue_limit,
+        std::bind(&block_chain::index_blocks, this, std::placeholders::_1),
+        std::bind(&block_chain::index_transactions, this,
+            std::placeholders::_1),
+        std::bind(&block_chain::get_indexable_block, this,
+            std::placeholders::_1)),
+
+    // Basic filters of candidate blocks are indexed alongside the store.
+    filters_(settings.index_filters ? database_settings.directory /
+        "filter_index" : boost::filesystem::path()),
+
+    // Serialized confirmed headers are mapped for headers replies.
+    headers_(settings.map_headers ? database_settings.directory /
+        "header_array" : boost::filesystem::path()),
+
+    // Confirmed spends are indexed by outpoint for spend queries.
+    spends_(settings.index_spends ? database_settings.directory /
+        "spend_index" : boost::filesystem::path())
 {
     const auto this_id = boost::this_thread::get_id();
     
     LOG_VERBOSE(LOG_BLOCKCHAIN)
     << this_id
     << " block_chain::block_chain() called.";
+
+    enroll_memory();
+}
+
+// private
+// Shedding order: pool eviction, then caches (each cleared, cheapest to
+// refill first), then header pool depth (lowest branches first).
+void block_chain::enroll_memory()
+{
+    memory_budget_.enroll("transaction_pool",
+        [this]() { return transaction_pool_.bytes(); },
+        [this](size_t bytes) { transaction_pool_.shed(bytes); });
+    memory_budget_.enroll("transaction_cache",
+        [this]() { return transaction_cache_.bytes(); },
+        [this](size_t) { transaction_cache_.clear(); });
+    memory_budget_.enroll("merkle_cache",
+        [this]() { return merkle_cache_.bytes(); },
+        [this](size_t) { merkle_cache_.clear(); });
+    memory_budget_.enroll("candidate_cache",
+        [this]() { return candidate_cache_.bytes(); },
+        [this](size_t) { candidate_cache_.clear(); });
+    memory_budget_.enroll("utxo_cache",
+        [this]() { return utxo_cache_.bytes(); },
+        [this](size_t) { utxo_cache_.clear(); });
+    memory_budget_.enroll("header_pool",
+        [this]() { return header_pool_.memory(); },
+        [this](size_t bytes) { header_pool_.shed(bytes); });
 }
 
 // ============================================================================
@@ -207,6 +350,10 @@ bool block_chain::get_block_hash(hash_digest& out_hash, size_t height,
     << this_id
     << " block_chain::get_block_hash() called. height: " << height;
 
+    if ((candidate ? candidate_window_ : confirmed_window_).get_block_hash(
+        out_hash, height))
+        return true;
+
     const auto result = database_.blocks().get(height, candidate);
 
     if (!result)
@@ -251,6 +398,10 @@ bool block_chain::get_bits(uint32_t& out_bits, size_t height,
 {
     const auto this_id = boost::this_thread::get_id();
 
+    if ((candidate ? candidate_window_ : confirmed_window_).get_bits(
+        out_bits, height))
+        return true;
+
     auto result = database_.blocks().get(height, candidate);
 
     if (!result)
@@ -280,6 +431,10 @@ bool block_chain::get_timestamp(uint32_t& out_timestamp, size_t height,
     << this_id
     << " block_chain::get_timestamp() called. height: " << height;
 
+    if ((candidate ? candidate_window_ : confirmed_window_).get_timestamp(
+        out_timestamp, height))
+        return true;
+
     auto result = database_.blocks().get(height, candidate);
 
     if (!result)
@@ -298,6 +453,10 @@ bool block_chain::get_version(uint32_t& out_version, size_t height,
     << this_id
     << " block_chain::get_version() called. height: " << height;
 
+    if ((candidate ? candidate_window_ : confirmed_window_).get_version(
+        out_version, height))
+        return true;
+
     auto result = database_.blocks().get(height, candidate);
 
     if (!result)
@@ -322,6 +481,19 @@ bool block_chain::get_work(uint256_t& out_work, const uint256_t& overcome,
     if (!database_.blocks().top(top, candidate))
         return false;
 
+    // Candidate chain is counted only to top validated block, and validated
+    // candidates are contiguous from the fork point.
+    if (candidate && !is_valid(get_block_state(top, true)))
+        return true;
+
+    // Indexed work is a subtraction, and exceeds overcome when required.
+    const auto& index = candidate ? candidate_work_index_ :
+        confirmed_work_index_;
+
+    if (index.top() == top && index.work(out_work, above_height, top))
+        return true;
+
+    // Heights below the index base are read from the store.
     // Set overcome to zero to bypass early exit.
     const auto no_maximum = overcome.is_zero();
 
@@ -356,6 +528,30 @@ bool block_chain::get_downloadable(hash_digest& out_hash, size_t height) const
     return true;
 }
 
+// Heights are read from the download bitmap and hashes from one snapshot of
+// the candidate hash index, so this does not query the store.
+void block_chain::get_downloadable(config::checkpoint::list& out_blocks,
+    size_t height, size_t count) const
+{
+    std::vector<size_t> heights;
+    candidate_downloads_.get(heights, height, count);
+    const auto hashes = view()->candidate_hashes;
+
+    out_blocks.clear();
+    out_blocks.reserve(heights.size());
+
+    for (const auto block_height: heights)
+    {
+        hash_digest hash;
+
+        // The index may have been reorganized since the heights were read.
+        if (!hashes->get(hash, block_height))
+            break;
+
+        out_blocks.emplace_back(hash, block_height);
+    }
+}
+
 bool block_chain::get_validatable(hash_digest& out_hash, size_t height) const
 {
     const auto result = database_.blocks().get(height, true);
@@ -392,12 +588,182 @@ void block_chain::populate_pool_transaction( chain::transaction& tx,
     database_.transactions().get_pool_metadata(tx, forks);
 }
 
+// The utxo cache reflects the candidate chain only.
 bool block_chain::populate_output(const chain::output_point& outpoint,
     size_t fork_height, bool candidate) const
 {
+    if (candidate && utxo_cache_.populate(outpoint, fork_height))
+        return true;
+
     return database_.transactions().get_output(outpoint, fork_height, candidate);
 }
 
+// The sorted reads are partitioned into contiguous slabs, so each worker
+// reads in store order. Slabs are claimed and awaited as in block_read.
+// Each read refers to the result of its previous tx, found by hash once.
+struct block_chain::output_read
+{
+    struct read
+    {
+        file_offset link;
+        const transaction_result* result;
+        const outpoints* prevouts;
+    };
+
+    output_read(size_t fork_height, bool candidate)
+      : fork_height(fork_height), candidate(candidate), slabs(1), next(0),
+        remaining(1)
+    {
+    }
+
+    const size_t fork_height;
+    const bool candidate;
+    std::vector<transaction_result> results;
+    std::vector<read> reads;
+    size_t slabs;
+
+    std::atomic<size_t> next;
+
+    // These are protected by mutex.
+    size_t remaining;
+    std::mutex mutex;
+    std::condition_variable completed;
+};
+
+// Each previous tx is found once and its outputs are then read in order of
+// tx store offset, so population on a cold cache avoids random seeks. Large
+// batches are read concurrently on the io dispatcher, so that more than one
+// page fault is outstanding (the store is memory mapped).
+size_t block_chain::populate_outputs(const outpoints& prevouts,
+    size_t fork_height, bool candidate) const
+{
+    typedef output_read::read read;
+    std::unordered_map<hash_digest, outpoints> groups;
+
+    // The utxo cache reflects the candidate chain only.
+    for (const auto prevout: prevouts)
+        if (!candidate || !utxo_cache_.populate(*prevout, fork_height))
+            groups[prevout->hash()].push_back(prevout);
+
+    const auto& tx_store = database_.transactions();
+    const auto batch = std::make_shared<output_read>(fork_height, candidate);
+    auto& results = batch->results;
+    auto& reads = batch->reads;
+    results.reserve(groups.size());
+    reads.reserve(groups.size());
+
+    // A missing tx sorts last and its outputs are populated as missing.
+    for (const auto& group: groups)
+    {
+        results.push_back(tx_store.get(group.first));
+        const auto& result = results.back();
+        reads.push_back({ result ? result.link() : max_uint64, &result,
+            &group.second });
+    }
+
+    std::sort(reads.begin(), reads.end(),
+        [](const read& left, const read& right)
+        {
+            return left.link < right.link;
+        });
+
+    const auto buckets = std::min(io_.size() + 1u,
+        reads.size() / minimum_parallel_read);
+
+    if (buckets < 2u)
+    {
+        read_outputs(batch);
+        return reads.size();
+    }
+
+    batch->slabs = buckets * slabs_per_bucket;
+    batch->remaining = batch->slabs;
+
+    // The calling thread is the remaining bucket.
+    for (size_t bucket = 1; bucket < buckets; ++bucket)
+        io_.concurrent(&block_chain::read_outputs, batch);
+
+    read_outputs(batch);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->completed.wait(lock, [&batch]() { return batch->remaining == 0; });
+    ///////////////////////////////////////////////////////////////////////////
+
+    return reads.size();
+}
+
+size_t block_chain::populate_pooled_outputs(const chain::block& block,
+    std::vector<bool>& out_populated) const
+{
+    return transaction_pool_.populate(block, out_populated);
+}
+
+// private static
+void block_chain::read_outputs(std::shared_ptr<output_read> read)
+{
+    const auto count = read->reads.size();
+
+    for (auto slab = read->next++; slab < read->slabs; slab = read->next++)
+    {
+        const auto begin = count * slab / read->slabs;
+        const auto end = count * (slab + 1u) / read->slabs;
+
+        for (auto position = begin; position < end; ++position)
+        {
+            const auto& value = read->reads[position];
+
+            for (const auto prevout: *value.prevouts)
+                populate_output(*prevout, *value.result, read->fork_height,
+                    read->candidate);
+        }
+
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        std::unique_lock<std::mutex> lock(read->mutex);
+
+        if (--read->remaining == 0)
+            read->completed.notify_one();
+        ///////////////////////////////////////////////////////////////////////
+    }
+}
+
+// private static
+// This is transaction_database::get_output, from the previous tx already
+// read, so that the tx is not found by hash again for each of its outputs.
+void block_chain::populate_output(const chain::output_point& outpoint,
+    const transaction_result& result, size_t fork_height, bool candidate)
+{
+    auto& prevout = outpoint.metadata;
+    prevout.spent = false;
+    prevout.candidate = false;
+    prevout.confirmed = false;
+    prevout.coinbase = false;
+    prevout.height = 0;
+    prevout.median_time_past = 0;
+    prevout.cache = chain::output{};
+
+    if (outpoint.is_null() || !result)
+        return;
+
+    // The cache is invalid if the tx does not have the output.
+    prevout.cache = result.output(outpoint.index());
+
+    if (!prevout.cache.is_valid())
+        return;
+
+    const auto position = result.position();
+    const auto confirmed = position != transaction_result::unconfirmed;
+
+    prevout.candidate = result.candidate();
+    prevout.confirmed = confirmed && result.height() <= fork_height;
+    prevout.coinbase = position == 0;
+    prevout.height = result.height();
+    prevout.median_time_past = result.median_time_past();
+    prevout.spent = prevout.cache.metadata.spent(fork_height, candidate);
+}
+
 uint8_t block_chain::get_block_state(size_t height, bool candidate) const
 {
     return database_.blocks().get(height, candidate).state();
@@ -459,208 +825,653 @@ header_const_ptr block_chain::get_header(size_t height, bool candidate) const
 // ----------------------------------------------------------------------------
 
 // private
-void block_chain::index_block(block_const_ptr block)
-{
-    const auto this_id = boost::this_thread::get_id();
+// Adds the hashes of indexed blocks and their txs, then marks the filter as
+// complete. Stored txs not in an indexed block (pool txs of a prior run) and
+// unindexed stored headers are not added, so these may be filtered as
+// missing. That implies only a redundant request, rejected as duplicate.
+void block_chain::populate_filter()
+{
+    // The fork point and both indexes are read from one view.
+    const auto view = this->view();
+    const auto fork_height = view->fork_point.height();
+    const auto& confirmed = view->confirmed_hashes;
+    const auto& candidate = view->candidate_hashes;
+    hash_list tx_hashes;
+
+    // Candidates at and below the fork point are confirmed.
+    const auto add = [&](const hash_index::snapshot& index, size_t first)
+    {
+        for (auto height = first; height < index.size() && !stopped();
+            ++height)
+        {
+            hash_digest hash;
+            index.get(hash, height);
+            hash_filter_.insert(hash);
 
-    if (!index_addresses_)
+            const auto result = database_.blocks().get(hash);
+            tx_hashes.clear();
+
+            if (result && get_transaction_hashes(tx_hashes, result))
+                for (const auto& tx_hash: tx_hashes)
+                    hash_filter_.insert(tx_hash);
+        }
+    };
+
+    add(*confirmed, 0);
+    add(*candidate, fork_height + 1u);
+
+    if (stopped())
         return;
 
-    code ec;
-    if ((ec = database_.index(*block)))
+    hash_filter_.set_complete();
+    LOG_INFO(LOG_BLOCKCHAIN)
+        << "Hash filter populated through confirmed block #"
+        << floor_subtract(confirmed->size(), size_t(1));
+}
+
+// private
+// Memory indexes mirror the store index, call after each store push.
+void block_chain::push_indexes(const chain::header& header, bool candidate)
+{
+    if (candidate)
+    {
+        candidate_work_index_.push(header.bits());
+        candidate_window_.push(header);
+        candidate_downloads_.push(!header.metadata.populated &&
+            !header.metadata.error);
+    }
+    else
     {
-        LOG_FATAL(LOG_BLOCKCHAIN)
-            << this_id
-            << " Failure in block payment indexing, store is now corrupt: "
-            << ec.message();
+        confirmed_work_index_.push(header.bits());
+        confirmed_window_.push(header);
+        headers_.push(header);
+    }
+}
 
-        // In the case of a store failure the server stops processing.
-        stop();
+// private
+// Memory indexes mirror the store index, call after each store pop.
+void block_chain::pop_indexes(size_t height, bool candidate)
+{
+    if (candidate)
+    {
+        candidate_work_index_.pop(height);
+        candidate_window_.pop(height);
+        candidate_downloads_.pop(height);
+    }
+    else
+    {
+        confirmed_work_index_.pop(height);
+        confirmed_window_.pop(height);
+        headers_.pop(height);
     }
 }
 
 // private
-void block_chain::index_transaction(transaction_const_ptr tx)
+bool block_chain::index_blocks(const block_const_ptr_list& blocks)
 {
     const auto this_id = boost::this_thread::get_id();
 
-    if (!index_addresses_ || tx->metadata.existed)
-        return;
-
     code ec;
-    if ((ec = database_.index(*tx)))
+    for (const auto block: blocks)
     {
-        LOG_FATAL(LOG_BLOCKCHAIN)
-            << this_id
-            << "Failure in transaction payment indexing, store is now corrupt: "
-            << ec.message();
+        if ((ec = database_.index(*block)))
+        {
+            LOG_FATAL(LOG_BLOCKCHAIN)
+                << this_id
+                << " Failure in block payment indexing, store is now corrupt: "
+                << ec.message();
 
-        // In the case of a store failure the server stops processing.
-        stop();
+            // In the case of a store failure the server stops processing.
+            stop();
+            return false;
+        }
     }
+
+    return true;
 }
 
-code block_chain::store(transaction_const_ptr tx)
+// private
+bool block_chain::index_transactions(const transaction_const_ptr_list& txs)
 {
     const auto this_id = boost::this_thread::get_id();
-    
-    LOG_VERBOSE(LOG_BLOCKCHAIN)
-    << this_id
-    << " block_chain::store() called.";
-
-    const auto state = tx->metadata.state;
-
-    if (!state)
-        return error::operation_failed;
-
-    // Clear chain state for store, index_transaction and notify.
-    tx->metadata.state.reset();
 
     code ec;
-    if ((ec = database_.store(*tx, state->enabled_forks())))
-        return ec;
-
-    // Payment indexing is asynchronous, after tx is stored. Therefore
-    // it is possible for a tx to be in any existing state and not be indexed.
-    if (index_addresses_ && !tx->metadata.existed)
-        dispatch_.concurrent(&block_chain::index_transaction, this, tx);
+    for (const auto tx: txs)
+    {
+        if ((ec = database_.index(*tx)))
+        {
+            LOG_FATAL(LOG_BLOCKCHAIN)
+                << this_id
+                << "Failure in transaction payment indexing, store is now corrupt: "
+                << ec.message();
 
-    notify(tx);
+            // In the case of a store failure the server stops processing.
+            stop();
+            return false;
+        }
+    }
 
-    // Restore chain state for last_transaction_ cache.
-    tx->metadata.state = state;
-    last_transaction_.store(tx);
-    return ec;
+    return true;
 }
 
-code block_chain::reorganize(const config::checkpoint& fork,
-    header_const_ptr_list_const_ptr incoming)
+// private
+// Catch-up blocks are read from the store, so prevouts are populated here as
+// for checkpointed candidates (nullptr if not a populated candidate).
+block_const_ptr block_chain::get_indexable_block(size_t height) const
 {
-    const auto this_id = boost::this_thread::get_id();
-    
-    LOG_VERBOSE(LOG_BLOCKCHAIN)
-    << this_id
-    << " block_chain::reorganize() 1 called.";
+    const auto block = get_block(height, false, true);
 
-    if (incoming->empty())
-        return error::operation_failed;
-
-    const auto top = incoming->back();
-    const auto top_state = top->metadata.state;
+    if (!block)
+        return block;
 
-    if (!top_state)
-        return error::operation_failed;
+    fast_chain::outpoints prevouts;
+    const auto& txs = block->transactions();
 
-    // TODO: if leave uncleared do not need header.median_time_past.
-    ////// Clear incoming chain state for reorganize and notify.
-    ////std::for_each(incoming->begin(), incoming->end(),
-    ////    [](header_const_ptr header) { header->metadata.state.reset(); });
+    // Must skip coinbase as it does not spend a previous output.
+    for (auto tx = std::next(txs.begin()); tx != txs.end(); ++tx)
+        for (const auto& input: tx->inputs())
+            prevouts.push_back(&input.previous_output());
 
-    code ec;
-    auto fork_height = fork.height();
-     auto outgoing = std::make_shared<header_const_ptr_list>();
+    populate_outputs(prevouts, fork_point().height(), false);
+    return block;
+}
 
-    // This unmarks candidate txs and spent outputs (may have been validated).
-    if ((ec = database_.reorganize(fork, incoming, outgoing)))
-        return ec;
+// private
+// Indexed filters of candidates popped while stopped are discarded, and those
+// not yet indexed (or when first enabled) are computed from the store, so the
+// index is contiguous with the candidate chain once organizers start.
+bool block_chain::start_filters()
+{
+    if (filters_.disabled())
+        return true;
 
-    // Don't add outgoing because only populated after reorganize and at that
-    // point the headers are no longer indexed (populator requires indexation).
-    if (!incoming->empty())
+    if (!filters_.start())
     {
-        header_pool_.remove(incoming);
-        header_pool_.prune(top_state->height());
+        LOG_ERROR(LOG_BLOCKCHAIN)
+            << "Failed to open the filter index.";
+        return false;
     }
 
-    // If confirmed fork point is above candidate fork point then lower it.
-    if (fork_point().height() > fork_height)
+    auto count = filters_.size();
+    hash_digest indexed;
+    hash_digest candidate;
+
+    while (count > 0u && !(filters_.get_hash(indexed, count - 1u) &&
+        get_block_hash(candidate, count - 1u, true) && indexed == candidate))
+        --count;
+
+    // A push at zero replaces all, so there is nothing to pop.
+    if (count > 0u && !filters_.pop(count - 1u))
+        return false;
+
+    const auto top = top_valid_candidate_state()->height();
+
+    for (auto height = count; height <= top; ++height)
     {
-        // Set new fork point and recompute confirmed work from it.
-        set_fork_point(fork);
-        set_confirmed_work();
+        const auto block = get_indexable_block(height);
 
-        // When fork point is lowered the top valid candidate is at fork point.
-        auto top_valid = chain_state_populator_.populate(fork_height, true);
-        set_top_valid_candidate_state(top_valid);
-        set_candidate_work(0);
+        if (!block || !filters_.push(*block, height))
+        {
+            LOG_ERROR(LOG_BLOCKCHAIN)
+                << "Failed to index filter of candidate block #" << height;
+            return false;
+        }
     }
 
-    set_top_candidate_state(top_state);
-    notify(fork_height, incoming, outgoing);
-    return ec;
+    if (count <= top)
+        LOG_INFO(LOG_BLOCKCHAIN)
+            << "Filter index computed through candidate block #" << top;
+
+    return true;
 }
 
-code block_chain::update(block_const_ptr block, size_t height)
+// private
+// Prevouts are not populated by validation under checkpoints (populated here).
+// A failure leaves a gap above which no filter is indexed until restart.
+void block_chain::push_filter(block_const_ptr block, size_t height)
 {
-    const auto this_id = boost::this_thread::get_id();
-    
-    LOG_VERBOSE(LOG_BLOCKCHAIN)
-    << this_id
-    << " block_chain::update() called. height: " << height;
-
-    code error_code;
-    const auto& metadata = block->header().metadata;
+    if (filters_.disabled())
+        return;
 
-    if (!metadata.error)
-    {
-        // Store or connect each transaction and set tx link metadata.
-        if ((error_code = database_.update(*block, height)))
-            return error_code;
-    }
-    else if (metadata.validated)
+    if (block->header().metadata.state->is_under_checkpoint())
     {
-        // Set block validation error state and error code.
-        // Never set valid on update as validation handling would be skipped.
-        error_code = database_.invalidate(block->header(), metadata.error);
+        fast_chain::outpoints prevouts;
+        const auto& txs = block->transactions();
+
+        // Must skip coinbase as it does not spend a previous output.
+        for (auto tx = std::next(txs.begin()); tx != txs.end(); ++tx)
+            for (const auto& input: tx->inputs())
+                if (!input.previous_output().metadata.cache.is_valid())
+                    prevouts.push_back(&input.previous_output());
+
+        if (!prevouts.empty())
+            populate_outputs(prevouts, fork_point().height(), false);
     }
 
-    return error_code;
+    if (!filters_.push(*block, height))
+        LOG_WARNING(LOG_BLOCKCHAIN)
+            << "Failed to index filter of candidate block #" << height;
 }
 
-code block_chain::invalidate( chain::header& header, const code& error)
+// private
+void block_chain::pop_filters(size_t height)
 {
-    // Mark candidate header as invalid.
-    return database_.invalidate(header, error);
+    if (!filters_.pop(height))
+        LOG_WARNING(LOG_BLOCKCHAIN)
+            << "Failed to pop filters above candidate block #" << height;
 }
 
-// Mark candidate block and descendants as invalid and pop them.
-code block_chain::invalidate(block_const_ptr block, size_t block_height)
+// private
+// The index is cleared if interrupted during an update (or diverged), and
+// confirmed blocks above its top are read from the store before organizers
+// start.
+bool block_chain::start_spends()
 {
-    auto& header = block->header();
-    BITCOIN_ASSERT(header.metadata.error);
+    if (spends_.disabled())
+        return true;
+
+    if (!spends_.start())
+    {
+        LOG_ERROR(LOG_BLOCKCHAIN)
+            << "Failed to map the spend index.";
+        return false;
+    }
 
     size_t top;
-    if (!get_top_height(top, true))
-        return error::operation_failed;
+    hash_digest indexed;
+    hash_digest confirmed;
+    size_t height = 0;
 
-    hash_digest fork_hash;
+    if (spends_.top(top, indexed))
+    {
+        if (get_block_hash(confirmed, top, false) && indexed == confirmed)
+            height = top + 1u;
+        else if (!spends_.clear())
+            return false;
+    }
+
+    const auto index = confirmed_hashes_.get();
+
+    for (const auto first = height; height < index->size(); ++height)
+    {
+        const auto block = get_block(height, false, false);
+
+        if (!block || !spends_.push(*block, height))
+        {
+            LOG_ERROR(LOG_BLOCKCHAIN)
+                << "Failed to index spends of confirmed block #" << height;
+            return false;
+        }
+
+        if (height == first)
+            LOG_INFO(LOG_BLOCKCHAIN)
+                << "Indexing spends from confirmed block #" << first;
+    }
+
+    return true;
+}
+
+// private
+// Outgoing blocks are ordered by height, so are popped from the last.
+// A failure leaves the index stale (it is cleared on the next start).
+void block_chain::index_spends(size_t fork_height,
+    block_const_ptr_list_const_ptr incoming,
+    block_const_ptr_list_const_ptr outgoing)
+{
+    if (spends_.disabled())
+        return;
+
+    auto height = fork_height + outgoing->size();
+
+    for (auto block = outgoing->rbegin(); block != outgoing->rend(); ++block)
+    {
+        if (!spends_.pop(**block, height--))
+        {
+            LOG_WARNING(LOG_BLOCKCHAIN)
+                << "Failed to remove spends of block #" << height + 1u;
+            return;
+        }
+    }
+
+    for (const auto block: *incoming)
+    {
+        if (!spends_.push(*block, ++height))
+        {
+            LOG_WARNING(LOG_BLOCKCHAIN)
+                << "Failed to index spends of block #" << height;
+            return;
+        }
+    }
+}
+
+// private
+// The input script is the height (bip34) followed by the configured script,
+// and the output claims the subsidy and fees to the configured script. The
+// witness commitment (with a null reserved value) is always included once
+// bip141 is active, as it is optional without witness txs.
+transaction_const_ptr block_chain::make_coinbase(
+    const chain::chain_state& state, uint64_t fees,
+    const hash_digest& witness_root) const
+{
+    using namespace machine;
+    static const data_chunk reserved(hash_size, 0x00);
+    static const data_chunk commitment_header{ 0xaa, 0x21, 0xa9, 0xed };
+
+    const auto height = state.height();
+    const auto bip42 = state.is_enabled(rule_fork::bip42_rule);
+    const auto bip141 = state.is_enabled(rule_fork::bip141_rule);
+
+    const chain::script& input_script = settings_.coinbase_input;
+    const chain::script& output_script = settings_.coinbase_output;
+    const auto& configured = input_script.operations();
+
+    operation::list operations{ operation(number(height).data()) };
+    operations.insert(operations.end(), configured.begin(), configured.end());
+
+    chain::input::list inputs(1);
+    inputs.front().set_previous_output({ null_hash, chain::point::null_index });
+    inputs.front().set_script(chain::script(std::move(operations)));
+    inputs.front().set_sequence(max_input_sequence);
+
+    if (bip141)
+        inputs.front().set_witness(chain::witness(data_stack{ reserved }));
+
+    const auto subsidy = chain::block::subsidy(height,
+        bitcoin_settings_.subsidy_interval_blocks,
+        bitcoin_settings_.initial_block_subsidy_satoshi(), bip42);
+
+    chain::output::list outputs;
+    outputs.emplace_back(subsidy + fees, output_script);
+
+    if (bip141)
+    {
+        const auto commitment = bitcoin_hash(build_chunk(
+            { witness_root, reserved }));
+        operation::list commit{ operation(opcode::return_),
+            operation(build_chunk({ commitment_header, commitment })) };
+        outputs.emplace_back(0, chain::script(std::move(commit)));
+    }
+
+    return std::make_shared<const chain::transaction>(1u, 0u,
+        std::move(inputs), std::move(outputs));
+}
+
+// private.
+// Mapped headers above a divergence from the confirmed index (a pop while
+// stopped) are removed, and those not mapped (or when first enabled) are
+// read from the store, so the array mirrors the confirmed index.
+bool block_chain::set_header_array()
+{
+    if (headers_.disabled())
+        return true;
+
+    if (!headers_.start())
+    {
+        LOG_ERROR(LOG_BLOCKCHAIN)
+            << "Failed to map the header array.";
+        return false;
+    }
+
+    const auto index = confirmed_hashes_.get();
+    auto count = std::min(headers_.size(), index->size());
+    chain::header header;
+    hash_digest hash;
+
+    while (count > 0u && !(headers_.get(header, count - 1u) &&
+        index->get(hash, count - 1u) && header.hash() == hash))
+        --count;
+
+    if (count == 0u)
+        headers_.clear();
+    else
+        headers_.pop(count - 1u);
+
+    for (auto height = count; height < index->size(); ++height)
+    {
+        const auto result = database_.blocks().get(height, false);
+
+        if (!result || !headers_.push(result.header()))
+            return false;
+    }
+
+    return true;
+}
+
+code block_chain::store(transaction_const_ptr tx)
+{
+    const auto this_id = boost::this_thread::get_id();
+    
+    LOG_VERBOSE(LOG_BLOCKCHAIN)
+    << this_id
+    << " block_chain::store() called.";
+
+    const auto state = tx->metadata.state;
+
+    if (!state)
+        return error::operation_failed;
+
+    // Clear chain state for store, indexing and notify.
+    tx->metadata.state.reset();
+
+    // Filter before store, so that a stored tx is never filtered as missing.
+    hash_filter_.insert(tx->hash());
+
+    code ec;
+    if ((ec = database_.store(*tx, state->enabled_forks())))
+        return ec;
+
+    // Pool after store, so that a pooled tx is always found in the store.
+    transaction_pool_.add(tx);
+    fee_estimator_.add(tx, state->height());
+    memory_budget_.enforce();
+
+    // Payment indexing is asynchronous, after tx is stored. Pool txs are not
+    // resumed on restart, so a tx may be in any existing state and not be
+    // indexed. This may wait on the indexer (backpressure).
+    if (index_addresses_ && !tx->metadata.existed)
+        indexer_.push(tx);
+
+    notify(tx);
+    notify_template(state->height());
+
+    // Restore chain state for last_transaction_ cache.
+    tx->metadata.state = state;
+    last_transaction_.store(tx);
+    return ec;
+}
+
+code block_chain::reorganize(const config::checkpoint& fork,
+    header_const_ptr_list_const_ptr incoming)
+{
+    const auto this_id = boost::this_thread::get_id();
+    
+    LOG_VERBOSE(LOG_BLOCKCHAIN)
+    << this_id
+    << " block_chain::reorganize() 1 called.";
+
+    if (incoming->empty())
+        return error::operation_failed;
+
+    const auto top = incoming->back();
+    const auto top_state = top->metadata.state;
+
+    if (!top_state)
+        return error::operation_failed;
+
+    // TODO: if leave uncleared do not need header.median_time_past.
+    ////// Clear incoming chain state for reorganize and notify.
+    ////std::for_each(incoming->begin(), incoming->end(),
+    ////    [](header_const_ptr header) { header->metadata.state.reset(); });
+
+    code ec;
+    auto fork_height = fork.height();
+     auto outgoing = std::make_shared<header_const_ptr_list>();
+
+    // Filter before store, so a stored header is never filtered as missing.
+    for (const auto header: *incoming)
+        hash_filter_.insert(header->hash());
+
+    // This unmarks candidate txs and spent outputs (may have been validated).
+    if ((ec = database_.reorganize(fork, incoming, outgoing)))
+        return ec;
+
+    // Candidate index is popped to the fork point and incoming are pushed.
+    pop_indexes(fork_height, true);
+    pop_filters(fork_height);
+    hash_list hashes;
+    hashes.reserve(incoming->size());
+
+    for (const auto header: *incoming)
+    {
+        push_indexes(*header, true);
+        hashes.push_back(header->hash());
+    }
+
+    candidate_hashes_.update(fork_height + 1u, hashes);
+
+    // Outputs spent by outgoing candidates are unspent again, so undo them.
+    // Outgoing validated candidates are no longer reorganizable, so clear all.
+    if (!outgoing->empty())
+    {
+        utxo_cache_.disconnect(fork_height);
+        candidate_cache_.clear();
+    }
+
+    // Don't add outgoing because only populated after reorganize and at that
+    // point the headers are no longer indexed (populator requires indexation).
+    if (!incoming->empty())
+    {
+        header_pool_.remove(incoming);
+        header_pool_.prune(top_state->height());
+    }
+
+    memory_budget_.enforce();
+
+    auto next = *view();
+
+    // If confirmed fork point is above candidate fork point then lower it.
+    if (next.fork_point.height() > fork_height)
+    {
+        // Set new fork point and recompute confirmed work from it.
+        uint256_t work_above_fork;
+        next.fork_point = fork;
+
+        if (get_work(work_above_fork, 0, fork_height, false))
+            next.confirmed_work = work_above_fork;
+
+        // When fork point is lowered the top valid candidate is at fork point.
+        next.top_valid_candidate_state = chain_state_populator_.populate(
+            fork_height, true);
+        next.candidate_work = 0;
+    }
+
+    next.top_candidate_state = top_state;
+    publish(next);
+    notify(fork_height, incoming, outgoing);
+    return ec;
+}
+
+code block_chain::update(block_const_ptr block, size_t height)
+{
+    const auto this_id = boost::this_thread::get_id();
+    
+    LOG_VERBOSE(LOG_BLOCKCHAIN)
+    << this_id
+    << " block_chain::update() called. height: " << height;
+
+    code error_code;
+    const auto& metadata = block->header().metadata;
+
+    // An unvalidated failed block is not marked, so remains downloadable.
+    if (metadata.error && !metadata.validated)
+        return error_code;
+
+    if (!metadata.error)
+    {
+        // Filter before store, so a stored tx is never filtered as missing.
+        for (const auto& tx: block->transactions())
+            hash_filter_.insert(tx.hash());
+
+        // Store or connect each transaction and set tx link metadata.
+        if ((error_code = database_.update(*block, height)))
+            return error_code;
+    }
+    else
+    {
+        // Set block validation error state and error code.
+        // Never set valid on update as validation handling would be skipped.
+        if ((error_code = database_.invalidate(block->header(),
+            metadata.error)))
+            return error_code;
+    }
+
+    // The block is now populated or failed, so it is not downloadable.
+    candidate_downloads_.clear(height);
+    return error_code;
+}
+
+code block_chain::invalidate( chain::header& header, const code& error)
+{
+    // Mark candidate header as invalid.
+    return database_.invalidate(header, error);
+}
+
+// Mark candidate block and descendants as invalid and pop them.
+// The range [height, top] is popped in one store reorganization, which
+// returns the popped headers, so descendants are not read individually.
+code block_chain::invalidate(block_const_ptr block, size_t block_height)
+{
+    auto& header = block->header();
+    BITCOIN_ASSERT(header.metadata.error);
+
+    hash_digest fork_hash;
     const auto fork_height = block_height - 1u;
     if (!get_block_hash(fork_hash, fork_height, true))
         return error::operation_failed;
 
     code ec;
+    const auto hash = header.hash();
     const config::checkpoint fork{ fork_hash, fork_height };
      auto outgoing = std::make_shared<header_const_ptr_list>();
      auto incoming = std::make_shared<header_const_ptr_list>();
 
-    // Copy first invalid candidate header to outgoing.
-    outgoing->push_back(std::make_shared<message::header>(header));
-
-    // Copy all dependant invalid candidates to outgoing.
-    for (auto height = block_height + 1u; height <= top; ++height)
-        outgoing->push_back(get_header(height, true));
-
-    // Mark all outgoing candidate blocks as invalid, in store and metadata.
-    for ( auto header: *outgoing)
-        if ((ec = invalidate(*header, error::store_block_missing_parent)))
-            return ec;
+    // Mark the first invalid candidate before the pop, so that a failure
+    // below leaves unmarked headers only as descendants of an invalid one.
+    if ((ec = invalidate(header, error::store_block_missing_parent)))
+        return ec;
 
     // This should not have to unmark because none were ever valid.
     if ((ec = database_.reorganize(fork, incoming, outgoing)))
         return ec;
 
+    // The store is popped, so the indexes and view must follow it regardless
+    // of whether the descendants below are marked.
+    pop_indexes(fork_height, true);
+    pop_filters(fork_height);
+    candidate_hashes_.update(fork_height + 1u, {});
+
     // Lower top candidate state to that of the top valid (previous header).
-    set_top_candidate_state(top_valid_candidate_state());
+    auto next = *view();
+    next.top_candidate_state = next.top_valid_candidate_state;
+    publish(next);
+
+    // Mark all popped dependant candidates as invalid, in store and metadata.
+    // The first failure is returned after notification of the pop.
+    for ( auto outgoing_header: *outgoing)
+    {
+        if (outgoing_header->hash() == hash)
+            continue;
+
+        const auto mark = invalidate(*outgoing_header,
+            error::store_block_missing_parent);
+
+        if (mark && !ec)
+            ec = mark;
+    }
+
+    LOG_DEBUG(LOG_BLOCKCHAIN)
+        << "Invalidated candidates [" << block_height << "-"
+        << fork_height + outgoing->size() << "]";
 
     notify(fork_height, incoming, outgoing);
     return ec;
@@ -677,14 +1488,106 @@ code block_chain::candidate(block_const_ptr block)
     if ((ec = database_.candidate(*block)))
         return ec;
 
-    // Advance the top valid candidate state and candidate work.
-    set_top_valid_candidate_state(header.metadata.state);
-    set_candidate_work(candidate_work() + header.proof());
+    // Cache outputs created and uncache outputs spent by the candidate.
+    utxo_cache_.add(block);
+
+    // Cache the validated candidate for reorganization into confirmed chain.
+    candidate_cache_.add(block);
+
+    // Cache the tx hashes of the candidate for merkle block replies.
+    merkle_cache_.add(block);
+    memory_budget_.enforce();
+
+    // Index the basic filter of the candidate from its populated prevouts.
+    push_filter(block, header.metadata.state->height());
+
+    LOG_DEBUG(LOG_BLOCKCHAIN)
+        << "Candidate block [" << header.metadata.state->height()
+        << "] utxo cache outputs: " << utxo_cache_.size()
+        << " hit rate: " << utxo_cache_.hit_rate();
 
-    // Payment indexing is asynchronous, after block is candidate. Therefore
-    // it is possible for a block to be in any valid state and not be indexed.
+    // Advance the top valid candidate state and candidate work.
+    auto next = *view();
+    next.top_valid_candidate_state = header.metadata.state;
+    next.candidate_work += header.proof();
+    publish(next);
+
+    // Payment indexing is asynchronous, after block is candidate. The indexer
+    // persists its height, so an unindexed block is indexed after restart.
+    // This may wait on the indexer (backpressure).
     if (index_addresses_)
-        dispatch_.concurrent(&block_chain::index_block, this, block);
+        indexer_.push(block, header.metadata.state->height());
+
+    return ec;
+}
+
+// Mark checkpointed candidate blocks valid and mark candidate-spent outputs.
+// Prevouts are not populated under checkpoints, so are populated here (in one
+// deduplicated read) only when required for filters or payment indexing.
+code block_chain::candidate(block_const_ptr_list_const_ptr blocks)
+{
+    code ec;
+
+    if (blocks->empty())
+        return ec;
+
+    uint256_t work;
+    fast_chain::outpoints prevouts;
+
+    // The store marks spends by block, which must be applied in chain order.
+    for (const auto block: *blocks)
+    {
+        const auto& header = block->header();
+        BITCOIN_ASSERT(!header.metadata.error);
+
+        if ((ec = database_.candidate(*block)))
+            return ec;
+
+        utxo_cache_.add(block);
+        candidate_cache_.add(block);
+        merkle_cache_.add(block);
+        memory_budget_.enforce();
+        work += header.proof();
+
+        if (!index_addresses_ && filters_.disabled())
+            continue;
+
+        const auto& txs = block->transactions();
+
+        // Must skip coinbase as it does not spend a previous output.
+        for (auto tx = std::next(txs.begin()); tx != txs.end(); ++tx)
+            for (const auto& input: tx->inputs())
+                prevouts.push_back(&input.previous_output());
+    }
+
+    const auto& top = blocks->back()->header();
+
+    LOG_DEBUG(LOG_BLOCKCHAIN)
+        << "Candidate blocks [" << blocks->front()->header().metadata.state->
+        height() << "-" << top.metadata.state->height() << "] utxo cache "
+        << "outputs: " << utxo_cache_.size();
+
+    // Advance the top valid candidate state and candidate work.
+    auto next = *view();
+    next.top_valid_candidate_state = top.metadata.state;
+    next.candidate_work += work;
+    publish(next);
+
+    if (!index_addresses_ && filters_.disabled())
+        return ec;
+
+    // Prevouts are populated once for both filters and payment indexing.
+    populate_outputs(prevouts, fork_point().height(), false);
+
+    for (const auto block: *blocks)
+        push_filter(block, block->header().metadata.state->height());
+
+    if (!index_addresses_)
+        return ec;
+
+    // Payment indexing is asynchronous, after block is candidate.
+    for (const auto block: *blocks)
+        indexer_.push(block, block->header().metadata.state->height());
 
     return ec;
 }
@@ -714,12 +1617,31 @@ code block_chain::reorganize(block_const_ptr_list_const_ptr branch_cache,
      auto outgoing = std::make_shared<block_const_ptr_list>();
      auto incoming = std::make_shared<block_const_ptr_list>();
 
-    // Get all missing incoming candidates with chain state (expensive reads).
+    // Get all missing incoming candidates with chain state (cached or read).
     for (auto height = fork.height() + 1u; height < branch_height; ++height)
     {
+        hash_digest hash;
+        if (!get_block_hash(hash, height, true))
+            return error::operation_failed;
+
+        // Validated candidates are cached with their chain state.
+        auto block = candidate_cache_.get(height, hash);
+
+        if (block && block->header().metadata.state)
+        {
+            metrics_.preceding(true);
+            state = block->header().metadata.state;
+            incoming->push_back(block);
+            continue;
+        }
+
         LOG_DEBUG(LOG_BLOCKCHAIN)
             << "Get preceding block #" << height;
-         auto block = get_block(height, true, true);
+        metrics_.preceding(false);
+        block = get_block(height, true, true);
+
+        if (!block)
+            return error::operation_failed;
 
         // Query chain state for first block, promote for remaining blocks.
         state = state ?
@@ -742,12 +1664,47 @@ code block_chain::reorganize(block_const_ptr_list_const_ptr branch_cache,
     if ((ec = database_.reorganize(fork, incoming, outgoing)))
         return ec;
 
+    // Confirmed index is popped to the fork point and incoming are pushed.
+    pop_indexes(fork.height(), false);
+    hash_list hashes;
+    hashes.reserve(incoming->size());
+
+    for (const auto block: *incoming)
+    {
+        push_indexes(block->header(), false);
+        hashes.push_back(block->hash());
+    }
+
+    confirmed_hashes_.update(fork.height() + 1u, hashes);
+
+    // Confirmed txs are no longer pooled, and outgoing txs are unconfirmed.
+    for (const auto block: *outgoing)
+        transaction_pool_.add(block);
+
+    for (const auto block: *incoming)
+        transaction_pool_.remove(block);
+
+    // Confirmation delays of pooled txs are sampled in height order.
+    auto height = fork.height();
+    for (const auto block: *incoming)
+        fee_estimator_.confirm(block, ++height);
+
+    index_spends(fork.height(), incoming, outgoing);
+
+    // Blocks at and below the new fork point are confirmed.
+    candidate_cache_.prune(top_state->height());
+
     // Top valid candidate is now top confirmed and the new fork point.
-    set_fork_point({ top->hash(), top_state->height() });
-    set_candidate_work(0);
-    set_confirmed_work(0);
-    set_next_confirmed_state(top_state);
+    // Tx pool state is promoted from the state of the top confirmed block.
+    auto next = *view();
+    next.fork_point = { top->hash(), top_state->height() };
+    next.candidate_work = 0;
+    next.confirmed_work = 0;
+    next.next_confirmed_state = std::make_shared<chain::chain_state>(
+        *top_state);
+    publish(next);
     notify(fork.height(), incoming, outgoing);
+    notify_template(top_state->height() + 1u);
 
     // Restore chain state for last_block_ cache.
     top->header().metadata.state = top_state;
@@ -760,38 +1717,98 @@ code block_chain::reorganize(block_const_ptr_list_const_ptr branch_cache,
 
 config::checkpoint block_chain::fork_point() const
 {
-    return fork_point_.load();
+    return view()->fork_point;
 }
 
 // private.
 uint256_t block_chain::candidate_work() const
 {
-    return candidate_work_.load();
+    return view()->candidate_work;
 }
 
 // private.
 uint256_t block_chain::confirmed_work() const
 {
-    return confirmed_work_.load();
+    return view()->confirmed_work;
 }
 
 chain::chain_state::ptr block_chain::top_candidate_state() const
 {
-    return top_candidate_state_.load();
+    return view()->top_candidate_state;
 }
 
 chain::chain_state::ptr block_chain::top_valid_candidate_state() const
 {
-    return top_valid_candidate_state_.load();
+    return view()->top_valid_candidate_state;
 }
 
 chain::chain_state::ptr block_chain::next_confirmed_state() const
 {
-    return next_confirmed_state_.load();
+    return view()->next_confirmed_state;
+}
+
+// private.
+// The snapshot is stale unless the candidate and confirmed tops are those of
+// the store, and is consumed by the load (so written only by a clean stop).
+bool block_chain::load_tip_snapshot(chain_view& next)
+{
+    tip_snapshot::tips tips;
+    if (!tip_snapshot_.load(tips, candidate_window_, confirmed_window_))
+        return false;
+
+    config::checkpoint candidate_top;
+    config::checkpoint confirmed_top;
+
+    if (!get_top(candidate_top, true) || !get_top(confirmed_top, false) ||
+        !(candidate_top == tips.candidate_top) ||
+        !(confirmed_top == tips.confirmed_top))
+        return false;
+
+    next.fork_point = tips.fork_point;
+    next.candidate_work = tips.candidate_work;
+    next.confirmed_work = tips.confirmed_work;
+    next.top_candidate_state = chain_state_populator_.populate(
+        std::move(tips.top_candidate_state));
+    next.top_valid_candidate_state = chain_state_populator_.populate(
+        std::move(tips.top_valid_candidate_state));
+    next.next_confirmed_state = chain_state_populator_.populate(
+        std::move(tips.next_confirmed_state));
+    return true;
 }
 
 // private.
-bool block_chain::set_fork_point()
+// Chain state data is repopulated, as states are retained only as objects.
+bool block_chain::save_tip_snapshot() const
+{
+    const auto view = this->view();
+
+    if (!view->top_candidate_state || !view->top_valid_candidate_state ||
+        !view->next_confirmed_state)
+        return false;
+
+    const auto& candidate = *view->top_candidate_state;
+    const auto& valid = *view->top_valid_candidate_state;
+    const auto& confirmed = *view->next_confirmed_state;
+
+    tip_snapshot::tips tips;
+    tips.candidate_top = { candidate.hash(), candidate.height() };
+    tips.confirmed_top = { confirmed.hash(), confirmed.height() };
+    tips.fork_point = view->fork_point;
+    tips.candidate_work = view->candidate_work;
+    tips.confirmed_work = view->confirmed_work;
+
+    return
+        chain_state_populator_.populate(tips.top_candidate_state,
+            candidate.height(), true) &&
+        chain_state_populator_.populate(tips.top_valid_candidate_state,
+            valid.height(), true) &&
+        chain_state_populator_.populate(tips.next_confirmed_state,
+            confirmed.height(), false) &&
+        tip_snapshot_.save(tips, candidate_window_, confirmed_window_);
+}
+
+// private.
+bool block_chain::set_fork_point(chain_view& next)
 {
     size_t candidate_height;
     size_t confirmed_height;
@@ -814,125 +1831,234 @@ bool block_chain::set_fork_point()
         candidate_hash != confirmed_hash)
         --common;
 
-    set_fork_point({ confirmed_hash, common });
+    next.fork_point = { confirmed_hash, common };
     return true;
 }
 
 // private.
-bool block_chain::set_candidate_work()
+// Work indexes are based at the fork point, as work is not summed below it.
+// Header windows are not set when restored from the tip snapshot.
+bool block_chain::set_indexes(const chain_view& next, bool windows)
 {
-    BITCOIN_ASSERT_MSG(fork_point().hash() != null_hash, "Set fork point.");
+    BITCOIN_ASSERT_MSG(next.fork_point.hash() != null_hash, "Set fork point.");
+
+    const auto fork_height = next.fork_point.height();
+    return set_work_index(candidate_work_index_, fork_height, true) &&
+        set_work_index(confirmed_work_index_, fork_height, false) &&
+        (!windows || (set_header_window(candidate_window_, true) &&
+            set_header_window(confirmed_window_, false))) &&
+        set_hash_index(candidate_hashes_, true) &&
+        set_hash_index(confirmed_hashes_, false) &&
+        set_download_bitmap(fork_height);
+}
 
-    uint256_t work_above_fork;
-    if (!get_work(work_above_fork, 0, fork_point().height(), true))
+// private.
+bool block_chain::set_work_index(work_index& index, size_t above_height,
+    bool candidate)
+{
+    size_t top;
+    if (!database_.blocks().top(top, candidate))
         return false;
 
-    set_candidate_work(work_above_fork);
+    index.reset(above_height);
+
+    for (auto height = above_height + 1u; height <= top; ++height)
+    {
+        const auto result = database_.blocks().get(height, candidate);
+
+        if (!result)
+            return false;
+
+        index.push(result.bits());
+    }
+
     return true;
 }
 
 // private.
-bool block_chain::set_confirmed_work()
+bool block_chain::set_header_window(header_window& window, bool candidate)
 {
-    BITCOIN_ASSERT_MSG(fork_point().hash() != null_hash, "Set fork point.");
-
-    uint256_t work_above_fork;
-    if (!get_work(work_above_fork, 0, fork_point().height(), false))
+    size_t top;
+    if (!database_.blocks().top(top, candidate))
         return false;
 
-    set_confirmed_work(work_above_fork);
+    const auto count = std::min(top + 1u, window.capacity());
+    const auto first = top + 1u - count;
+    window.reset(first);
+
+    for (auto height = first; height <= top; ++height)
+    {
+        const auto result = database_.blocks().get(height, candidate);
+
+        if (!result)
+            return false;
+
+        window.push(result.header());
+    }
+
     return true;
 }
 
 // private.
-bool block_chain::set_top_candidate_state()
+bool block_chain::set_hash_index(hash_index& index, bool candidate)
 {
-    set_top_candidate_state(chain_state_populator_.populate(true));
-    return top_candidate_state() != nullptr;
+    size_t top;
+    if (!database_.blocks().top(top, candidate))
+        return false;
+
+    hash_list hashes;
+    hashes.reserve(top + 1u);
+
+    for (size_t height = 0; height <= top; ++height)
+    {
+        const auto result = database_.blocks().get(height, candidate);
+
+        if (!result)
+            return false;
+
+        hashes.push_back(result.hash());
+    }
+
+    index.update(0, hashes);
+    return true;
 }
 
 // private.
-bool block_chain::set_top_valid_candidate_state()
+// Candidates at and below the fork point are confirmed (so populated).
+bool block_chain::set_download_bitmap(size_t above_height)
 {
-    size_t height;
-    if (!get_top_height(height, true))
+    size_t top;
+    if (!database_.blocks().top(top, true))
         return false;
 
-    // The loop must at least terminate on the genesis block.
-    BITCOIN_ASSERT(is_valid(get_block_state(0, true)));
+    candidate_downloads_.reset(above_height);
 
-    // Loop from top to genesis in the candidate index.
-    while (!is_valid(get_block_state(height, true)))
-        --height;
+    for (auto height = above_height + 1u; height <= top; ++height)
+    {
+        const auto result = database_.blocks().get(height, true);
+
+        if (!result)
+            return false;
 
-    const auto state = chain_state_populator_.populate(height, true);
-    set_top_valid_candidate_state(state);
-    return top_valid_candidate_state() != nullptr;
+        candidate_downloads_.push(!is_failed(result.state()) &&
+            result.transaction_count() == 0);
+    }
+
+    return true;
 }
 
 // private.
-bool block_chain::set_next_confirmed_state()
+bool block_chain::set_candidate_work(chain_view& next)
 {
-    set_next_confirmed_state(chain_state_populator_.populate(false));
-    return next_confirmed_state() != nullptr;
+    BITCOIN_ASSERT_MSG(next.fork_point.hash() != null_hash, "Set fork point.");
+
+    return get_work(next.candidate_work, 0, next.fork_point.height(), true);
 }
 
 // private.
-void block_chain::set_fork_point(const config::checkpoint& fork)
+bool block_chain::set_confirmed_work(chain_view& next)
 {
-    fork_point_.store(fork);
+    BITCOIN_ASSERT_MSG(next.fork_point.hash() != null_hash, "Set fork point.");
+
+    return get_work(next.confirmed_work, 0, next.fork_point.height(), false);
 }
 
 // private.
-void block_chain::set_candidate_work(const uint256_t& work_above_fork)
+bool block_chain::set_top_candidate_state(chain_view& next)
 {
-    candidate_work_.store(work_above_fork);
+    next.top_candidate_state = chain_state_populator_.populate(true);
+    return next.top_candidate_state != nullptr;
 }
 
 // private.
-void block_chain::set_confirmed_work(const uint256_t& work_above_fork)
+bool block_chain::set_top_valid_candidate_state(chain_view& next)
 {
-    confirmed_work_.store(work_above_fork);
+    size_t height;
+    if (!get_top_height(height, true))
+        return false;
+
+    // The loop must at least terminate on the genesis block.
+    BITCOIN_ASSERT(is_valid(get_block_state(0, true)));
+
+    // Loop from top to genesis in the candidate index.
+    while (!is_valid(get_block_state(height, true)))
+        --height;
+
+    next.top_valid_candidate_state = chain_state_populator_.populate(height,
+        true);
+    return next.top_valid_candidate_state != nullptr;
 }
 
 // private.
-void block_chain::set_top_candidate_state(chain::chain_state::ptr top)
+bool block_chain::set_next_confirmed_state(chain_view& next)
 {
-    top_candidate_state_.store(top);
+    next.next_confirmed_state = chain_state_populator_.populate(false);
+    return next.next_confirmed_state != nullptr;
 }
 
 // private.
-void block_chain::set_top_valid_candidate_state(chain::chain_state::ptr top)
+// The locator is read from one snapshot of the candidate hash index (no I/O),
+// and is null if the index does not reach the top height.
+block_chain::header_locator::ptr block_chain::make_header_locator(
+    size_t top_height) const
 {
-    top_valid_candidate_state_.store(top);
+    const auto locator = std::make_shared<header_locator>();
+    const auto hashes = candidate_hashes_.get();
+    locator->heights = block::locator_heights(top_height);
+    locator->hashes.reserve(locator->heights.size());
+
+    for (const auto height: locator->heights)
+    {
+        hash_digest hash;
+
+        if (!hashes->get(hash, height))
+            return {};
+
+        locator->hashes.push_back(hash);
+    }
+
+    return locator;
 }
 
 // private.
-void block_chain::set_next_confirmed_state(chain::chain_state::ptr top)
+// Writers are serialized, so the previous view is that of this writer. The
+// hash indexes are updated before publication, and the locator is rebuilt
+// only when the top candidate moves.
+void block_chain::publish(const chain_view& next)
 {
-    // Promotion always succeeds.
-    // Tx pool state is promoted from the state of the top confirmed block.
-    next_confirmed_state_.store(std::make_shared<chain::chain_state>(*top));
+    const auto previous = view_.load();
+    const auto view = std::make_shared<chain_view>(next);
+    const auto& top = view->top_candidate_state;
+    view->version = previous->version + 1u;
+    view->candidate_hashes = candidate_hashes_.get();
+    view->confirmed_hashes = confirmed_hashes_.get();
+
+    if (!top)
+        view->locator.reset();
+    else if (top != previous->top_candidate_state || !previous->locator)
+        view->locator = make_header_locator(top->height());
+
+    view_.store(view);
 }
 
 bool block_chain::is_candidates_stale() const
 {
     // The header state is as fresh as the last (top) indexed header.
-    const auto state = top_candidate_state_.load();
+    const auto state = top_candidate_state();
     return state && state->is_stale();
 }
 
 bool block_chain::is_validated_stale() const
 {
     // The valid candidate state is as fresh as the top valid candidate.
-    const auto state = top_valid_candidate_state_.load();
+    const auto state = top_valid_candidate_state();
     return state && state->is_stale();
 }
 
 bool block_chain::is_blocks_stale() const
 {
     // The pool state is as fresh as the last (top) indexed block.
-    const auto state = next_confirmed_state_.load();
+    const auto state = next_confirmed_state();
     return state && state->is_stale();
 }
 
@@ -958,8 +2084,10 @@ chain::chain_state::ptr block_chain::promote_state( chain::header& header,
     if (!parent || parent->hash() != header.previous_block_hash())
         return {};
 
-    return std::make_shared<chain::chain_state>(*parent, header,
-        bitcoin_settings_);
+    // Promoted states are recycled from slabs (states may outlive the chain).
+    const state_allocator<chain::chain_state> allocator(state_pool_);
+    return std::allocate_shared<chain::chain_state>(allocator, *parent,
+        header, bitcoin_settings_);
 }
 
 // Promote chain state for the last block in the multi-header branch.
@@ -1018,36 +2146,106 @@ bool block_chain::start()
     LOG_VERBOSE(LOG_BLOCKCHAIN)
     << this_id
     << " block_chain::start() called transaction_subscriber_->start()";
+
+    template_subscriber_->start();
+    LOG_VERBOSE(LOG_BLOCKCHAIN)
+    << this_id
+    << " block_chain::start() called template_subscriber_->start()";
+
+    payment_subscriber_->start();
+    LOG_VERBOSE(LOG_BLOCKCHAIN)
+    << this_id
+    << " block_chain::start() called payment_subscriber_->start()";
+
+    notifications_.start();
+    LOG_VERBOSE(LOG_BLOCKCHAIN)
+    << this_id
+    << " block_chain::start() called notifications_.start()";
     
-    bool retval = set_fork_point();
+    // Properties are set on one view, which is published once all are set.
+    // The tip snapshot of a clean stop bypasses recomputation of the tips.
+    chain_view next;
+    const auto restored = load_tip_snapshot(next);
+
+    if (restored)
+        LOG_INFO(LOG_BLOCKCHAIN)
+            << "Restored chain tip state from snapshot.";
+
+    bool retval = restored || set_fork_point(next);
     LOG_VERBOSE(LOG_BLOCKCHAIN)
     << this_id
     << " block_chain::start() called set_fork_point()";
 
-    retval = retval && set_top_candidate_state();
+    retval = retval && set_indexes(next, !restored);
+    LOG_VERBOSE(LOG_BLOCKCHAIN)
+    << this_id
+    << " block_chain::start() called set_indexes()";
+
+    retval = retval && set_header_array();
+    LOG_VERBOSE(LOG_BLOCKCHAIN)
+    << this_id
+    << " block_chain::start() called set_header_array()";
+
+    retval = retval && (restored || set_top_candidate_state(next));
     LOG_VERBOSE(LOG_BLOCKCHAIN)
     << this_id
     << " block_chain::start() called set_top_candidate_state()";
 
-    retval = retval && set_top_valid_candidate_state();
+    retval = retval && (restored || set_top_valid_candidate_state(next));
     LOG_VERBOSE(LOG_BLOCKCHAIN)
     << this_id
     << " block_chain::start() called set_top_valid_candidate_state()";
 
-    retval = retval && set_next_confirmed_state();
+    retval = retval && (restored || set_next_confirmed_state(next));
+    LOG_VERBOSE(LOG_BLOCKCHAIN)
+    << this_id
+    << " block_chain::start() called set_next_confirmed_state()";
+
+    retval = retval && (restored || set_candidate_work(next));
+    LOG_VERBOSE(LOG_BLOCKCHAIN)
+    << this_id
+    << " block_chain::start() called set_candidate_work()";
+
+    retval = retval && (restored || set_confirmed_work(next));
     LOG_VERBOSE(LOG_BLOCKCHAIN)
     << this_id
-    << " block_chain::start() called set_next_confirmed_state()";
+    << " block_chain::start() called set_confirmed_work()";
+
+    if (retval)
+        publish(next);
+
+    // Pools are bound while idle (before organizers start).
+    const auto script_cpus = affinity(settings_.script_affinity,
+        settings_.numa_node);
+    const auto io_cpus = affinity(settings_.io_affinity, settings_.numa_node);
 
-    retval = retval && set_candidate_work();
+    if (retval && !script_cpus.empty() &&
+        !thread_binder::bind(priority_pool_, script_cpus))
+        LOG_WARNING(LOG_BLOCKCHAIN)
+            << "Failed to bind script verification threads.";
+
+    if (retval && !io_cpus.empty() && !thread_binder::bind(io_pool_, io_cpus))
+        LOG_WARNING(LOG_BLOCKCHAIN)
+            << "Failed to bind io threads.";
+
+    // Filters are caught up to the top valid candidate before organizing.
+    retval = retval && start_filters();
     LOG_VERBOSE(LOG_BLOCKCHAIN)
     << this_id
-    << " block_chain::start() called set_candidate_work()";
+    << " block_chain::start() called start_filters()";
 
-    retval = retval && set_confirmed_work();
+    retval = retval && start_spends();
     LOG_VERBOSE(LOG_BLOCKCHAIN)
     << this_id
-    << " block_chain::start() called set_confirmed_work()";
+    << " block_chain::start() called start_spends()";
+
+    // The capture begins with the tops, the store to replay it against. A
+    // failure to capture does not fail the start (the recorder logs it).
+    if (retval && workload_.enabled())
+    {
+        const auto top = top_candidate_state();
+        workload_.start(fork_point(), { top->hash(), top->height() });
+    }
 
     retval = retval && block_organizer_.start();
     LOG_VERBOSE(LOG_BLOCKCHAIN)
@@ -1064,12 +2262,21 @@ bool block_chain::start()
     << this_id
     << " block_chain::start() called transaction_organizer_.start()";
 
+    // The indexer catches up from its persisted height in the background.
+    if (retval && index_addresses_)
+        indexer_.start(top_valid_candidate_state()->height());
+
+    // The filter is populated in the background and used once complete.
+    if (retval && !hash_filter_.disabled())
+        io_.concurrent(&block_chain::populate_filter, this);
+
     return retval;
 }
 
 bool block_chain::stop()
 {
-    stopped_ = true;
+    // The tip state is persisted only by the first stop of a started chain.
+    const auto started = !stopped_.exchange(true);
 
     const auto this_id = boost::this_thread::get_id();
     LOG_VERBOSE(LOG_BLOCKCHAIN)
@@ -1079,10 +2286,18 @@ bool block_chain::stop()
 
     // this can't be done in the critical section or block_organizer finishes validation before stop
     block_organizer_.stop();
+
+    // Pending notifications and index work are discarded, and these wait on
+    // any subscriber or batch in progress, so precede the critical section.
+    notifications_.stop();
+    indexer_.stop();
     
     // Critical Section
     ///////////////////////////////////////////////////////////////////////////
+    const auto waited = metrics_.locks().waiting(
+        lock_metrics::site::chain_stop);
     validation_mutex_.lock_high_priority();
+    metrics_.locks().acquired(lock_metrics::site::chain_stop, waited);
 
     LOG_VERBOSE(LOG_BLOCKCHAIN)
     << this_id
@@ -1094,24 +2309,42 @@ bool block_chain::stop()
         header_organizer_.stop() &&
         transaction_organizer_.stop();
 
+    // No candidate is pushed once the organizers are stopped.
+    filters_.stop();
+    headers_.stop();
+    spends_.stop();
+    workload_.stop();
+
+    // The tip state is persisted once deferred headers have been committed.
+    if (started && !save_tip_snapshot())
+        LOG_WARNING(LOG_BLOCKCHAIN)
+            << "Failed to persist the chain tip state.";
+
     // Clean up subscriptions and threadpool now that work is coalesced.
 
     block_subscriber_->stop();
     header_subscriber_->stop();
     transaction_subscriber_->stop();
+    template_subscriber_->stop();
 
     block_subscriber_->invoke(error::service_stopped, 0, {}, {});
     header_subscriber_->invoke(error::service_stopped, 0, {}, {});
     transaction_subscriber_->invoke(error::service_stopped, {});
+    template_subscriber_->invoke(error::service_stopped, 0);
 
-    // Stop the threadpool keep-alive allowing threads to terminate.
+    // Invokes and drops all payment subscribers with the stop code.
+    payment_subscriber_->stop();
+
+    // Stop the threadpool keep-alives allowing threads to terminate.
     priority_pool_.shutdown();
+    io_pool_.shutdown();
 
     LOG_VERBOSE(LOG_BLOCKCHAIN)
     << this_id
     << " block_chain::stop() with validation_mutex_ (aka mutex_) of "
     << &validation_mutex_ << " calling unlock_high_priority()";
     
+    metrics_.locks().released(lock_metrics::site::chain_stop);
     validation_mutex_.unlock_high_priority();
 
     LOG_VERBOSE(LOG_BLOCKCHAIN)
@@ -1128,6 +2361,7 @@ bool block_chain::close()
 {
     const auto result = stop();
     priority_pool_.join();
+    io_pool_.join();
     return result && database_.close();
 }
 
@@ -1139,6 +2373,37 @@ block_chain::~block_chain()
 // Queries.
 // ----------------------------------------------------------------------------
 
+// The transaction list is presized and each slab of offsets is deserialized
+// in place by whichever thread claims it. The calling thread also reads, and
+// waits only for slabs claimed by running helpers, so a saturated pool cannot
+// deadlock the read. Helpers that start late find no slab and touch nothing.
+struct block_chain::block_read
+{
+    block_read(const transaction_database& store, transaction_cache& cache,
+        bool witness, size_t slabs)
+      : store(store), cache(cache), witness(witness), slabs(slabs), next(0),
+        failed(false), remaining(slabs), transactions(nullptr)
+    {
+    }
+
+    const transaction_database& store;
+    transaction_cache& cache;
+    const bool witness;
+    const size_t slabs;
+    std::vector<file_offset> offsets;
+
+    std::atomic<size_t> next;
+    std::atomic<bool> failed;
+
+    // These are protected by mutex.
+    size_t remaining;
+    std::mutex mutex;
+    std::condition_variable completed;
+
+    // Valid only while slabs remain.
+    transaction::list* transactions;
+};
+
 // private
 bool block_chain::get_transactions(transaction::list& out_transactions,
     const database::block_result& result, bool witness) const
@@ -1149,20 +2414,122 @@ bool block_chain::get_transactions(transaction::list& out_transactions,
     << this_id
     << " block_chain::get_transactions() called.";
 
-    out_transactions.reserve(result.transaction_count());
+    const auto count = result.transaction_count();
     const auto& tx_store = database_.transactions();
+    const auto buckets = std::min(io_.size() + 1u,
+        count / minimum_parallel_read);
+
+    if (buckets < 2u)
+    {
+        out_transactions.reserve(count);
+
+        for (const auto offset: result)
+        {
+            // Cached txs are copied, but blocks are not cached (one-off reads).
+            const auto cached = transaction_cache_.get(offset, witness);
+
+            if (cached)
+            {
+                out_transactions.push_back(*cached);
+                continue;
+            }
+
+            const auto result = tx_store.get(offset);
+
+            if (!result)
+                return false;
+
+            out_transactions.push_back(result.transaction(witness));
+        }
+
+        return true;
+    }
+
+    const auto slabs = buckets * slabs_per_bucket;
+    const auto read = std::make_shared<block_read>(tx_store,
+        transaction_cache_, witness, slabs);
+    read->offsets.reserve(count);
 
     for (const auto offset: result)
+        read->offsets.push_back(offset);
+
+    out_transactions.resize(read->offsets.size());
+    read->transactions = &out_transactions;
+
+    // The calling thread is the remaining bucket.
+    for (size_t bucket = 1; bucket < buckets; ++bucket)
+        io_.concurrent(&block_chain::read_transactions, read);
+
+    read_transactions(read);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::unique_lock<std::mutex> lock(read->mutex);
+    read->completed.wait(lock, [&read]() { return read->remaining == 0; });
+    ///////////////////////////////////////////////////////////////////////////
+
+    return !read->failed;
+}
+
+// private static
+void block_chain::read_transactions(std::shared_ptr<block_read> read)
+{
+    const auto count = read->offsets.size();
+
+    for (auto slab = read->next++; slab < read->slabs; slab = read->next++)
     {
-        const auto result = tx_store.get(offset);
+        const auto begin = count * slab / read->slabs;
+        const auto end = count * (slab + 1u) / read->slabs;
+        auto& transactions = *read->transactions;
 
-        if (!result)
-            return false;
+        for (auto position = begin; position < end && !read->failed;
+            ++position)
+        {
+            const auto offset = read->offsets[position];
+            const auto cached = read->cache.get(offset, read->witness);
+
+            if (cached)
+            {
+                transactions[position] = *cached;
+                continue;
+            }
+
+            const auto result = read->store.get(offset);
 
-        out_transactions.push_back(result.transaction(witness));
+            if (!result)
+            {
+                read->failed = true;
+                break;
+            }
+
+            transactions[position] = result.transaction(read->witness);
+        }
+
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        std::unique_lock<std::mutex> lock(read->mutex);
+
+        if (--read->remaining == 0)
+            read->completed.notify_one();
+        ///////////////////////////////////////////////////////////////////////
     }
+}
 
-    return true;
+// private
+// The tx is decoded once per link, while its position and height are always
+// read from the result (these change with reorganization).
+transaction_const_ptr block_chain::get_transaction(
+    const transaction_result& result, bool witness) const
+{
+    const auto link = result.link();
+    auto tx = transaction_cache_.get(link, witness);
+
+    if (tx)
+        return tx;
+
+    tx = std::make_shared<const transaction>(result.transaction(witness));
+    transaction_cache_.add(link, witness, tx);
+    return tx;
 }
 
 // private
@@ -1185,6 +2552,90 @@ bool block_chain::get_transaction_hashes(hash_list& out_hashes,
     return true;
 }
 
+// private
+// Only the coinbase is deserialized, the remaining txs are read as hashes.
+compact_block_ptr block_chain::get_compact_block(
+    const database::block_result& result) const
+{
+    const auto nonce = pseudo_random();
+    const auto& header = result.header();
+    const auto key = transaction_pool::to_short_id_key(header, nonce);
+    const auto& tx_store = database_.transactions();
+
+    message::compact_block::short_id_list short_ids;
+    message::prefilled_transaction::list prefilled;
+    short_ids.reserve(result.transaction_count());
+
+    for (const auto offset: result)
+    {
+        const auto tx = tx_store.get(offset);
+
+        if (!tx)
+            return nullptr;
+
+        if (prefilled.empty())
+            prefilled.emplace_back(0, tx.transaction(false));
+        else
+            short_ids.push_back(transaction_pool::to_mini_hash(
+                transaction_pool::to_short_id(key, tx.hash())));
+    }
+
+    return std::make_shared<message::compact_block>(header, nonce,
+        short_ids, prefilled);
+}
+
+// private
+// Witness is stripped by serialization when not requested, as it is stored.
+std::shared_ptr<data_chunk> block_chain::get_block_raw(
+    const database::block_result& result, bool witness) const
+{
+    transaction::list txs;
+
+    if (!get_transactions(txs, result, witness))
+        return {};
+
+    auto size = chain::header::satoshi_fixed_size() +
+        variable_uint_size(txs.size());
+
+    for (const auto& tx: txs)
+        size += tx.serialized_size(true, witness);
+
+    const auto raw = std::make_shared<data_chunk>();
+    raw->reserve(size);
+    data_sink ostream(*raw);
+    ostream_writer sink(ostream);
+
+    result.header().to_data(sink);
+    sink.write_variable_little_endian(txs.size());
+
+    for (const auto& tx: txs)
+        tx.to_data(sink, true, witness);
+
+    ostream.flush();
+    BITCOIN_ASSERT(raw->size() == size);
+    return raw;
+}
+
+// private
+// Merkle leaves are cached, with store reads cached for subsequent requests.
+// A header-only block has no leaves yet, so its (empty) read is not cached.
+bool block_chain::get_merkle_hashes(hash_list& out_hashes,
+    const database::block_result& result) const
+{
+    const auto hash = result.hash();
+
+    if (merkle_cache_.get(out_hashes, hash))
+        return true;
+
+    if (!get_transaction_hashes(out_hashes, result))
+        return false;
+
+    if (result.transaction_count() != 0 && !out_hashes.empty())
+        merkle_cache_.add(hash, out_hashes);
+
+    return true;
+}
+
 void block_chain::fetch_block(size_t height, bool witness,
     block_fetch_handler handler) const
 {
@@ -1210,9 +2661,10 @@ void block_chain::fetch_block(size_t height, bool witness,
         return;
     }
 
+    // A pruned body is reported as not found, so the request is refused.
     const auto result = database_.blocks().get(height, false);
 
-    if (!result)
+    if (!result || !is_available(height, witness))
     {
         handler(error::not_found, nullptr, 0);
         return;
@@ -1259,9 +2711,10 @@ void block_chain::fetch_block(const hash_digest& hash, bool witness,
         return;
     }
 
+    // A pruned body is reported as not found, so the request is refused.
     const auto result = database_.blocks().get(hash);
 
-    if (!result)
+    if (!result || !is_available(result.height(), witness))
     {
         handler(error::not_found, nullptr, 0);
         return;
@@ -1282,6 +2735,65 @@ void block_chain::fetch_block(const hash_digest& hash, bool witness,
     handler(error::success, message, result.height());
 }
 
+// The serialization is written directly from the stored header and txs, so no
+// block object (or its hash and metadata caches) is constructed for relay.
+void block_chain::fetch_block_raw(size_t height, bool witness,
+    raw_block_fetch_handler handler) const
+{
+    if (stopped())
+    {
+        handler(error::service_stopped, nullptr, 0);
+        return;
+    }
+
+    const auto result = database_.blocks().get(height, false);
+
+    if (!result || !is_available(height, witness))
+    {
+        handler(error::not_found, nullptr, 0);
+        return;
+    }
+
+    BITCOIN_ASSERT(result.height() == height);
+    const auto raw = get_block_raw(result, witness);
+
+    if (!raw)
+    {
+        handler(error::operation_failed, nullptr, 0);
+        return;
+    }
+
+    handler(error::success, raw, height);
+}
+
+void block_chain::fetch_block_raw(const hash_digest& hash, bool witness,
+    raw_block_fetch_handler handler) const
+{
+    if (stopped())
+    {
+        handler(error::service_stopped, nullptr, 0);
+        return;
+    }
+
+    const auto result = database_.blocks().get(hash);
+
+    if (!result || !is_available(result.height(), witness))
+    {
+        handler(error::not_found, nullptr, 0);
+        return;
+    }
+
+    const auto raw = get_block_raw(result, witness);
+
+    if (!raw)
+    {
+        handler(error::operation_failed, nullptr, 0);
+        return;
+    }
+
+    handler(error::success, raw, result.height());
+}
+
 void block_chain::fetch_block_header(size_t height,
     block_header_fetch_handler handler) const
 {
@@ -1365,67 +2877,170 @@ void block_chain::fetch_merkle_block(size_t height,
     hash_list hashes;
     BITCOIN_ASSERT(result.height() == height);
 
-    if (!get_transaction_hashes(hashes, result))
+    if (!get_merkle_hashes(hashes, result))
+    {
+        handler(error::not_found, nullptr, 0);
+        return;
+    }
+
+    auto rheader = result.header();
+    auto merkle = std::make_shared<merkle_block>(rheader,
+     hashes.size(), hashes, data_chunk{});
+    handler(error::success, merkle, height);
+}
+
+void block_chain::fetch_merkle_block(const hash_digest& hash,
+    merkle_block_fetch_handler handler) 
+{
+    const auto this_id = boost::this_thread::get_id();
+    
+    LOG_VERBOSE(LOG_BLOCKCHAIN)
+    << this_id
+    << " block_chain::fetch_merkle_block() 2 called.";
+
+    if (stopped())
+    {
+        handler(error::service_stopped, nullptr, 0);
+        return;
+    }
+
+    const auto result = database_.blocks().get(hash);
+
+    if (!result)
+    {
+        handler(error::not_found, nullptr, 0);
+        return;
+    }
+
+    hash_list hashes;
+
+    if (!get_merkle_hashes(hashes, result))
+    {
+        handler(error::not_found, nullptr, 0);
+        return;
+    }
+
+    auto rheader = result.header();
+    auto merkle = std::make_shared<merkle_block>(rheader,
+        hashes.size(), hashes, data_chunk{});
+    handler(error::success, merkle, result.height());
+}
+
+// Short ids are of txids (BIP152 version 1), with the coinbase prefilled.
+void block_chain::fetch_compact_block(size_t height,
+    compact_block_fetch_handler handler) const
+{
+    if (stopped())
+    {
+        handler(error::service_stopped, nullptr, 0);
+        return;
+    }
+
+    const auto result = database_.blocks().get(height, false);
+
+    if (!result || !is_available(height, false))
+    {
+        handler(error::not_found, nullptr, 0);
+        return;
+    }
+
+    const auto compact = get_compact_block(result);
+
+    if (!compact)
+    {
+        handler(error::operation_failed, nullptr, 0);
+        return;
+    }
+
+    handler(error::success, compact, result.height());
+}
+
+void block_chain::fetch_compact_block(const hash_digest& hash,
+    compact_block_fetch_handler handler) const
+{
+    if (stopped())
+    {
+        handler(error::service_stopped, nullptr, 0);
+        return;
+    }
+
+    const auto result = database_.blocks().get(hash);
+
+    if (!result || !is_available(result.height(), false))
+    {
+        handler(error::not_found, nullptr, 0);
+        return;
+    }
+
+    const auto compact = get_compact_block(result);
+
+    if (!compact)
+    {
+        handler(error::operation_failed, nullptr, 0);
+        return;
+    }
+
+    handler(error::success, compact, result.height());
+}
+
+// Filters are indexed by candidate height, so are served only once confirmed.
+void block_chain::fetch_filter(size_t height,
+    filter_fetch_handler handler) const
+{
+    if (stopped())
+    {
+        handler(error::service_stopped, nullptr, 0);
+        return;
+    }
+
+    hash_digest indexed;
+    hash_digest confirmed;
+    const auto filter = std::make_shared<data_chunk>();
+
+    if (!filters_.get_filter(*filter, indexed, height) ||
+        !get_block_hash(confirmed, height, false) || indexed != confirmed)
     {
         handler(error::not_found, nullptr, 0);
         return;
     }
 
-    auto rheader = result.header();
-    auto merkle = std::make_shared<merkle_block>(rheader,
-     hashes.size(), hashes, data_chunk{});
-    handler(error::success, merkle, height);
+    handler(error::success, filter, height);
 }
 
-void block_chain::fetch_merkle_block(const hash_digest& hash,
-    merkle_block_fetch_handler handler) 
+// The candidate chain is linear, so the last confirmed implies all below it.
+// Candidates above the fork point are not confirmed, so the range is capped
+// at the fork point (the top confirmed block that is also a candidate).
+void block_chain::fetch_filter_headers(size_t height, size_t count,
+    filter_headers_fetch_handler handler) const
 {
-    const auto this_id = boost::this_thread::get_id();
-    
-    LOG_VERBOSE(LOG_BLOCKCHAIN)
-    << this_id
-    << " block_chain::fetch_merkle_block() 2 called.";
-
     if (stopped())
     {
         handler(error::service_stopped, nullptr, 0);
         return;
     }
 
-    const auto result = database_.blocks().get(hash);
+    const auto top = fork_point().height();
 
-    if (!result)
+    if (height > top)
     {
         handler(error::not_found, nullptr, 0);
         return;
     }
 
-    hash_list hashes;
+    hash_digest indexed;
+    hash_digest confirmed;
+    const auto headers = std::make_shared<hash_list>();
+    const auto capped = std::min(count, top - height + 1u);
 
-    if (!get_transaction_hashes(hashes, result))
+    if (!filters_.get_headers(*headers, indexed, height, capped) ||
+        !get_block_hash(confirmed, height + headers->size() - 1u, false) ||
+        indexed != confirmed)
     {
         handler(error::not_found, nullptr, 0);
         return;
     }
 
-    auto rheader = result.header();
-    auto merkle = std::make_shared<merkle_block>(rheader,
-        hashes.size(), hashes, data_chunk{});
-    handler(error::success, merkle, result.height());
-}
-
-void block_chain::fetch_compact_block(size_t ,
-    compact_block_fetch_handler handler) const
-{
-    // TODO: implement compact blocks.
-    handler(error::not_implemented, {}, 0);
-}
-
-void block_chain::fetch_compact_block(const hash_digest& ,
-    compact_block_fetch_handler handler) const
-{
-    // TODO: implement compact blocks.
-    handler(error::not_implemented, {}, 0);
+    handler(error::success, headers, height);
 }
 
 void block_chain::fetch_block_height(const hash_digest& hash,
@@ -1468,15 +3083,33 @@ void block_chain::fetch_last_height(last_height_fetch_handler handler) const
         return;
     }
 
-    size_t last_height;
+    // The confirmed index is populated from genesis, so this is the top.
+    const auto index = view()->confirmed_hashes;
 
-    if (!database_.blocks().top(last_height, false))
+    if (index->size() == 0)
     {
         handler(error::not_found, 0);
         return;
     }
 
-    handler(error::success, last_height);
+    handler(error::success, index->size() - 1u);
+}
+
+// Bodies older than the prune depth (and witnesses older than the witness
+// prune depth) are not served. Headers and tx hashes remain available, so
+// header, merkle block and height queries are unaffected.
+bool block_chain::is_available(size_t height, bool witness) const
+{
+    // The confirmed index is populated from genesis, so this is the top.
+    const auto size = view()->confirmed_hashes->size();
+
+    const auto within = [height, size](size_t depth)
+    {
+        return depth == 0 || height + depth >= size;
+    };
+
+    return within(settings_.prune_blocks) &&
+        (!witness || within(settings_.prune_witness_blocks));
 }
 
 void block_chain::fetch_transaction(const hash_digest& hash,
@@ -1519,8 +3152,7 @@ void block_chain::fetch_transaction(const hash_digest& hash,
     }
 
     // TODO: tx state may not be publishable.
-     auto tx = std::make_shared<transaction>(
-        result.transaction(witness));
+    const auto tx = get_transaction(result, witness);
     handler(error::success, tx, result.position(), result.height());
 }
 
@@ -1566,7 +3198,25 @@ void block_chain::fetch_transaction_position(const hash_digest& hash,
     handler(error::success, result.position(), result.height());
 }
 
-// This may execute over 500 queries.
+// private
+// Get the height of the hash if it is indexed in the snapshot.
+bool block_chain::get_height(size_t& out_height, const hash_digest& hash,
+    const hash_index::snapshot& index) const
+{
+    const auto result = database_.blocks().get(hash);
+
+    if (!result)
+        return false;
+
+    hash_digest indexed;
+    if (!index.get(indexed, result.height()) || indexed != hash)
+        return false;
+
+    out_height = result.height();
+    return true;
+}
+
+// Confirmed hashes are read from one chain view, so the chain is consistent.
 void block_chain::fetch_locator_block_hashes(get_blocks_const_ptr locator,
     const hash_digest& threshold, size_t limit,
     inventory_fetch_handler handler) const
@@ -1583,25 +3233,15 @@ void block_chain::fetch_locator_block_hashes(get_blocks_const_ptr locator,
         return;
     }
 
-    // BUGBUG: an intervening reorg can produce an invalid chain of hashes.
-    // TODO: instead walk backwards using parent hash lookups.
-
-    // This is based on the idea that looking up by block hash to get heights
-    // will be much faster than hashing each retrieved block to test for stop.
+    const auto index = view()->confirmed_hashes;
 
     // Find the start block height.
     // If no start block is on our chain we start with block 0.
     // TODO: we could return error or empty and drop peer for missing genesis.
     size_t start = 0;
     for (const auto& hash: locator->start_hashes())
-    {
-        const auto result = database_.blocks().get(hash);
-        if (result)
-        {
-            start = result.height();
+        if (get_height(start, hash, *index))
             break;
-        }
-    }
 
     // The begin block requested is always one after the start block.
     auto begin = safe_add(start, size_t(1));
@@ -1610,52 +3250,78 @@ void block_chain::fetch_locator_block_hashes(get_blocks_const_ptr locator,
     auto end = safe_add(begin, limit);
 
     // Find the upper threshold block height (peer-specified).
-    if (locator->stop_hash() != null_hash)
-    {
-        // If the stop block is not confirmed we treat it as a null stop.
-        const auto result = database_.blocks().get(locator->stop_hash());
-
-        // Otherwise limit the end height to the stop block height.
-        // If end precedes begin floor_subtract will handle below.
-        if (result)
-            end = std::min(result.height(), end);
-    }
+    // If the stop block is not confirmed we treat it as a null stop.
+    // Otherwise limit the end height to the stop block height.
+    // If end precedes begin floor_subtract will handle below.
+    size_t found;
+    if (locator->stop_hash() != null_hash &&
+        get_height(found, locator->stop_hash(), *index))
+        end = std::min(found, end);
 
     // Find the lower threshold block height (self-specified).
-    if (threshold != null_hash)
-    {
-        // If the threshold is not confirmed we ignore it.
-        const auto result = database_.blocks().get(threshold);
+    // If the threshold is not confirmed we ignore it.
+    // Otherwise limit the begin height to the threshold block height.
+    // If begin exceeds end floor_subtract will handle below.
+    if (threshold != null_hash && get_height(found, threshold, *index))
+        begin = std::max(found, begin);
 
-        // Otherwise limit the begin height to the threshold block height.
-        // If begin exceeds end floor_subtract will handle below.
-        if (result)
-            begin = std::max(result.height(), begin);
-    }
+    // Limit the end height to the snapshot top.
+    end = std::min(end, index->size());
 
     auto hashes = std::make_shared<inventory>();
     hashes->inventories().reserve(floor_subtract(end, begin));
 
-    // Build the hash list until we hit end or the blockchain top.
+    // Build the hash list until we hit end (bounded by the snapshot top).
     for (auto height = begin; height < end; ++height)
     {
-        const auto result = database_.blocks().get(height, false);
+        hash_digest hash;
+        index->get(hash, height);
+        static const auto id = inventory::type_id::block;
+        hashes->inventories().emplace_back(id, hash);
+    }
 
-        // If not found then we are at our top.
-        if (!result)
+    handler(error::success, std::move(hashes));
+}
+
+// private
+// The array may be reorganized after the snapshot was taken, but the slice is
+// a chain, so if its top is the snapshot hash at that height all below are.
+bool block_chain::get_mapped_headers(headers& out_headers,
+    const hash_index::snapshot& index, size_t begin, size_t end) const
+{
+    data_chunk data;
+    hash_digest hash;
+
+    if (begin >= end || !headers_.get(data, begin, end) ||
+        !index.get(hash, end - 1u))
+        return false;
+
+    data_source istream(data);
+    istream_reader source(istream);
+    auto& elements = out_headers.elements();
+
+    for (auto height = begin; height < end; ++height)
+    {
+        chain::header header;
+
+        if (!header.from_data(source))
         {
-            hashes->inventories().shrink_to_fit();
-            break;
+            elements.clear();
+            return false;
         }
 
-        static const auto id = inventory::type_id::block;
-        hashes->inventories().emplace_back(id, result.hash());
+        elements.push_back(std::move(header));
     }
 
-    handler(error::success, std::move(hashes));
+    if (elements.back().hash() == hash)
+        return true;
+
+    elements.clear();
+    return false;
 }
 
-// This may execute over 2000 queries.
+// Confirmed hashes are read from one chain view, so the chain is consistent.
+// Headers are read by hash, as a header at a height may be reorganized out.
 void block_chain::fetch_locator_block_headers(get_headers_const_ptr locator,
     const hash_digest& threshold, size_t limit,
     locator_block_headers_fetch_handler handler) const
@@ -1672,25 +3338,15 @@ void block_chain::fetch_locator_block_headers(get_headers_const_ptr locator,
         return;
     }
 
-    // BUGBUG: an intervening reorg can produce an invalid chain of headers.
-    // TODO: instead walk backwards using parent hash lookups.
-
-    // This is based on the idea that looking up by block hash to get heights
-    // will be much faster than hashing each retrieved block to test for stop.
+    const auto index = view()->confirmed_hashes;
 
     // Find the start block height.
     // If no start block is on our chain we start with block 0.
     // TODO: we could return error or empty and drop peer for missing genesis.
     size_t start = 0;
     for (const auto& hash: locator->start_hashes())
-    {
-        const auto result = database_.blocks().get(hash);
-        if (result)
-        {
-            start = result.height();
+        if (get_height(start, hash, *index))
             break;
-        }
-    }
 
     // The begin block requested is always one after the start block.
     auto begin = safe_add(start, size_t(1));
@@ -1699,38 +3355,42 @@ void block_chain::fetch_locator_block_headers(get_headers_const_ptr locator,
     auto end = safe_add(begin, limit);
 
     // Find the upper threshold block height (peer-specified).
-    if (locator->stop_hash() != null_hash)
-    {
-        // If the stop block is not confirmed we treat it as a null stop.
-        const auto result = database_.blocks().get(locator->stop_hash());
-
-        // Otherwise limit the end height to the stop block height.
-        // If end precedes begin floor_subtract will handle below.
-        if (result)
-            end = std::min(result.height(), end);
-    }
+    // If the stop block is not confirmed we treat it as a null stop.
+    // Otherwise limit the end height to the stop block height.
+    // If end precedes begin floor_subtract will handle below.
+    size_t found;
+    if (locator->stop_hash() != null_hash &&
+        get_height(found, locator->stop_hash(), *index))
+        end = std::min(found, end);
 
     // Find the lower threshold block height (self-specified).
-    if (threshold != null_hash)
-    {
-        // If the threshold is not confirmed we ignore it.
-        const auto result = database_.blocks().get(threshold);
+    // If the threshold is not confirmed we ignore it.
+    // Otherwise limit the begin height to the threshold block height.
+    // If begin exceeds end floor_subtract will handle below.
+    if (threshold != null_hash && get_height(found, threshold, *index))
+        begin = std::max(found, begin);
 
-        // Otherwise limit the begin height to the threshold block height.
-        // If begin exceeds end floor_subtract will handle below.
-        if (result)
-            begin = std::max(result.height(), begin);
-    }
+    // Limit the end height to the snapshot top.
+    end = std::min(end, index->size());
 
     auto message = std::make_shared<headers>();
     message->elements().reserve(floor_subtract(end, begin));
 
-    // Build the hash list until we hit end or the blockchain top.
+    // Mapped headers are one slice copy, so no store read or hash lookup.
+    if (get_mapped_headers(*message, *index, begin, end))
+    {
+        handler(error::success, std::move(message));
+        return;
+    }
+
+    // Build the header list until we hit end (bounded by the snapshot top).
     for (auto height = begin; height < end; ++height)
     {
-        const auto result = database_.blocks().get(height, false);
+        hash_digest hash;
+        index->get(hash, height);
+        const auto result = database_.blocks().get(hash);
 
-        // If not found then we are at our top.
+        // Stored headers are never removed, so this implies corruption.
         if (!result)
         {
             message->elements().shrink_to_fit();
@@ -1777,7 +3437,8 @@ void block_chain::fetch_locator_block_headers(get_headers_const_ptr locator,
 ////    handler(error::success, message);
 ////}
 
-// This may generally execute 29+ queries.
+// The locator of the top candidate is cached in the chain view, otherwise this
+// is read from the view's candidate hash index, falling back to the store.
 // There may be a reorg during this query (odd but ok behavior).
 // TODO: generate against any header branch using a header pool branch.
 void block_chain::fetch_header_locator(const block::indexes& heights,
@@ -1797,17 +3458,36 @@ void block_chain::fetch_header_locator(const block::indexes& heights,
 
     auto message = std::make_shared<get_headers>();
     auto& hashes = message->start_hashes();
+    const auto view = this->view();
+    const auto& cached = view->locator;
+
+    if (cached && cached->heights == heights)
+    {
+        hashes = cached->hashes;
+        handler(error::success, message);
+        return;
+    }
+
+    const auto& snapshot = view->candidate_hashes;
     hashes.reserve(heights.size());
 
     for (const auto height: heights)
     {
+        hash_digest hash;
+
+        if (snapshot->get(hash, height))
+        {
+            hashes.push_back(hash);
+            continue;
+        }
+
         // Header locators is generated for the header chain.
         const auto result = database_.blocks().get(height, true);
 
         if (!result)
         {
             handler(error::not_found, nullptr);
-            break;
+            return;
         }
 
         hashes.push_back(result.hash());
@@ -1820,8 +3500,8 @@ void block_chain::fetch_header_locator(const block::indexes& heights,
 //-----------------------------------------------------------------------------
 // Confirmed heights only.
 
-// TODO: reimplement in store.
-void block_chain::fetch_spend(const chain::output_point& ,
+// Index keys are truncated, so each spender is verified against its tx.
+void block_chain::fetch_spend(const chain::output_point& outpoint,
     spend_fetch_handler handler) const
 {
     if (stopped())
@@ -1830,17 +3510,34 @@ void block_chain::fetch_spend(const chain::output_point& ,
         return;
     }
 
-    ////auto point = database_.spends().get(outpoint);
+    if (spends_.disabled())
+    {
+        handler(error::not_implemented, {});
+        return;
+    }
+
+    const auto& tx_store = database_.transactions();
 
-    ////if (point.hash() == null_hash)
-    ////{
-    ////    handler(error::not_found, {});
-    ////    return;
-    ////}
+    for (const auto& spender: spends_.get(outpoint))
+    {
+        const auto result = tx_store.get(spender.link);
 
-    ////handler(error::success, std::move(point));
+        if (!result)
+            continue;
 
-    handler(error::not_implemented, {});
+        const auto tx = get_transaction(result, false);
+        const auto& inputs = tx->inputs();
+
+        if (spender.index < inputs.size() &&
+            inputs[spender.index].previous_output() == outpoint)
+        {
+            handler(error::success,
+                chain::input_point{ tx->hash(), spender.index });
+            return;
+        }
+    }
+
+    handler(error::not_found, {});
 }
 
 // TODO: could return an iterator with an internal tx store reference, which
@@ -1863,27 +3560,121 @@ void block_chain::fetch_history(const short_hash& address_hash, size_t limit,
 
     // Cannot know size without reading all, so dynamically allocate.
     chain::payment_record::list payments;
-    size_t count = 0;
+    chain::payment_record::list batch;
+    auto complete = false;
 
     // Result set is ordered most recent tx first (reverse point order in tx).
-    for (auto payment: database_.addresses().get(address_hash))
+    for (const auto& payment: database_.addresses().get(address_hash))
     {
-        if (count++ == limit)
+        if (payments.size() + batch.size() == limit)
             break;
 
-        const auto tx = database_.transactions().get(payment.link());
-        const auto height = tx.height();
+        batch.push_back(payment);
+
+        // Resolve in batches, so that reading stops near from_height.
+        if (batch.size() == history_batch)
+        {
+            complete = resolve_history(batch, from_height);
+            payments.insert(payments.end(), batch.begin(), batch.end());
+            batch.clear();
+
+            if (complete)
+                break;
+        }
+    }
+
+    if (!complete)
+    {
+        resolve_history(batch, from_height);
+        payments.insert(payments.end(), batch.begin(), batch.end());
+    }
+
+    handler(error::success, std::move(payments));
+}
+
+// Records preceding the cursor are skipped without tx store reads, and the
+// tx links of the page are resolved in one batch.
+void block_chain::fetch_history_page(const short_hash& address_hash,
+    size_t cursor, size_t page_size, size_t from_height,
+    history_page_fetch_handler handler) const
+{
+    if (stopped())
+    {
+        handler(error::service_stopped, {}, 0);
+        return;
+    }
+
+    if (page_size == 0)
+    {
+        handler(error::operation_failed, {}, 0);
+        return;
+    }
+
+    chain::payment_record::list payments;
+    payments.reserve(page_size);
+    size_t position = 0;
+    auto more = false;
+
+    // Result set is ordered most recent tx first (reverse point order in tx).
+    for (const auto& payment: database_.addresses().get(address_hash))
+    {
+        if (position++ < cursor)
+            continue;
 
-        if (height < from_height)
+        if (payments.size() == page_size)
+        {
+            more = true;
             break;
+        }
 
-        // Copy of each payment record above so can be modified here.
-        payment.set_height(height);
-        payment.set_hash(tx.hash());
         payments.push_back(payment);
     }
 
-    handler(error::success, std::move(payments));
+    // Records below from_height terminate the history.
+    if (resolve_history(payments, from_height))
+        more = false;
+
+    const auto next = more ? cursor + payments.size() : 0;
+    handler(error::success, std::move(payments), next);
+}
+
+// private
+// Set height and hash of each record from its tx, reading in link order.
+// Truncate at the first record below from_height, returning true if so.
+bool block_chain::resolve_history(chain::payment_record::list& payments,
+    size_t from_height) const
+{
+    std::vector<size_t> order(payments.size());
+
+    for (size_t index = 0; index < order.size(); ++index)
+        order[index] = index;
+
+    std::sort(order.begin(), order.end(), [&](size_t left, size_t right)
+    {
+        return payments[left].link() < payments[right].link();
+    });
+
+    const auto& tx_store = database_.transactions();
+
+    for (const auto index: order)
+    {
+        auto& payment = payments[index];
+        const auto tx = tx_store.get(payment.link());
+        payment.set_height(tx.height());
+        payment.set_hash(tx.hash());
+    }
+
+    // Records are ordered by descending height, so the remainder is lower.
+    for (size_t index = 0; index < payments.size(); ++index)
+    {
+        if (payments[index].height() < from_height)
+        {
+            payments.resize(index);
+            return true;
+        }
+    }
+
+    return false;
 }
 
 // TODO: eliminate.
@@ -1904,9 +3695,65 @@ void block_chain::fetch_stealth(const binary&, size_t,
 
 // Same as fetch_mempool but also optimized for maximum possible block fee as
 // limited by total bytes and signature operations.
-void block_chain::fetch_template(merkle_block_fetch_handler handler) const
+// The template is maintained on pool change, so this copies its hashes and
+// folds the new coinbase up the cached merkle branch. Only tx hashes that
+// differ from those of the last fetch are rehashed (with the right edge).
+void block_chain::fetch_template(template_fetch_handler handler) const
 {
-    transaction_pool_.fetch_template(handler);
+    if (stopped())
+    {
+        handler(error::service_stopped, nullptr, nullptr, nullptr, 0);
+        return;
+    }
+
+    const auto state = next_confirmed_state();
+    hash_digest previous;
+
+    if (!state || !get_block_hash(previous, state->height() - 1u, false))
+    {
+        handler(error::operation_failed, nullptr, nullptr, nullptr, 0);
+        return;
+    }
+
+    const auto entries = transaction_pool_.get_template();
+    const auto bip141 = state->is_enabled(machine::rule_fork::bip141_rule);
+    uint64_t fees = 0;
+    hash_list hashes;
+    hash_list witness_hashes;
+    hashes.reserve(entries.size() + 1u);
+
+    if (bip141)
+        witness_hashes.reserve(entries.size());
+
+    for (const auto& entry: entries)
+    {
+        fees += entry->fees();
+        hashes.push_back(entry->hash());
+
+        if (bip141)
+            witness_hashes.push_back(entry->transaction()->hash(true));
+    }
+
+    // The coinbase wtxid is committed as null_hash (bip141).
+    const auto witness_root = bip141 ? template_tree::root(null_hash,
+        witness_tree_.update(witness_hashes)) : null_hash;
+    const auto branch = std::make_shared<hash_list>(
+        template_tree_.update(hashes));
+    const auto coinbase = make_coinbase(*state, fees, witness_root);
+    const auto& coinbase_hash = coinbase->hash();
+
+    // The timestamp must exceed the median time past of the parent.
+    const auto now = static_cast<uint32_t>(std::time(nullptr));
+    const auto timestamp = std::max(now, state->median_time_past() + 1u);
+    const chain::header header(state->minimum_block_version(), previous,
+        template_tree::root(coinbase_hash, *branch), timestamp,
+        state->work_required(), 0);
+
+    hashes.insert(hashes.begin(), coinbase_hash);
+    const auto count = hashes.size();
+    const auto block = std::make_shared<merkle_block>(header, count,
+        std::move(hashes), data_chunk{});
+    handler(error::success, block, coinbase, branch, state->height());
 }
 
 // Fetch a set of currently-valid unconfirmed txs in dependency order.
@@ -1919,6 +3766,19 @@ void block_chain::fetch_mempool(size_t count_limit, uint64_t minimum_fee,
     transaction_pool_.fetch_mempool(count_limit, minimum_fee, handler);
 }
 
+uint64_t block_chain::estimate_fee(size_t target_blocks) const
+{
+    return fee_estimator_.estimate(target_blocks);
+}
+
+// Matched txs are shared with the pool, so they retain the metadata of pool
+// validation and are not deserialized or verified again for the block.
+transaction_const_ptr_list block_chain::reconstruct(
+    compact_block_const_ptr block) const
+{
+    return transaction_pool_.reconstruct(*block);
+}
+
 // Filters.
 //-----------------------------------------------------------------------------
 
@@ -1943,10 +3803,14 @@ void block_chain::filter_blocks(get_data_ptr message,
     // Excludes blocks that are known to block memory pool (not block pool).
     header_pool_.filter(message);
 
+    // A definite filter miss does not require a store query.
+    const auto filtered = hash_filter_.complete();
     auto& inventories = message->inventories();
     for (auto it = inventories.begin(); it != inventories.end();)
     {
-        if (it->is_block_type() && !database_.blocks().get(it->hash()))
+        if (it->is_block_type() && ((filtered &&
+            !hash_filter_.contains(it->hash())) ||
+            !database_.blocks().get(it->hash())))
         {
             ++it;
         }
@@ -1980,19 +3844,20 @@ void block_chain::filter_transactions(get_data_ptr message,
     // Excludes tx that are known to the tx memory pool (not tx pool).
     transaction_pool_.filter(message);
 
+    // A definite filter miss does not require a store query.
+    const auto filtered = hash_filter_.complete();
     auto& inventories = message->inventories();
-    for (auto it = inventories.begin(); it != inventories.end();)
+
+    const auto known = [&](const inventory_vector& inventory)
     {
-        if (it->is_transaction_type() &&
-            !database_.transactions().get(it->hash()))
-        {
-            ++it;
-        }
-        else
-        {
-            it = inventories.erase(it);
-        }
-    }
+        return !inventory.is_transaction_type() || ((!filtered ||
+            hash_filter_.contains(inventory.hash())) &&
+            database_.transactions().get(inventory.hash()));
+    };
+
+    // Compact in a single pass, avoiding repeated vector shifts on erase.
+    inventories.erase(std::remove_if(inventories.begin(), inventories.end(),
+        known), inventories.end());
 
     handler(error::success);
 }
@@ -2018,12 +3883,34 @@ void block_chain::subscribe_transactions(transaction_handler&& handler)
         error::service_stopped, {});
 }
 
+void block_chain::subscribe_template(template_handler&& handler)
+{
+    template_subscriber_->subscribe(std::move(handler),
+        error::service_stopped, 0);
+}
+
+void block_chain::subscribe_blocks(const address_filter& addresses,
+    payment_block_handler&& handler)
+{
+    payment_subscriber_->subscribe(addresses,
+        payment_subscriber::block_handler(std::move(handler)));
+}
+
+void block_chain::subscribe_transactions(const address_filter& addresses,
+    transaction_handler&& handler)
+{
+    payment_subscriber_->subscribe(addresses,
+        payment_subscriber::transaction_handler(std::move(handler)));
+}
+
 void block_chain::unsubscribe()
 {
     // TODO: review use of invoke here (to limit channel drop delay).
     block_subscriber_->relay(error::success, 0, {}, {});
     header_subscriber_->relay(error::success, 0, {}, {});
     transaction_subscriber_->relay(error::success, {});
+    template_subscriber_->relay(error::success, 0);
+    payment_subscriber_->invoke(error::success);
 }
 
 // protected
@@ -2032,8 +3919,18 @@ void block_chain::notify(size_t fork_height,
     block_const_ptr_list_const_ptr outgoing)
 {
     // TODO: check for subscription dependencies on non-empty incoming.
-    // This invokes handlers within the criticial section (deadlock risk).
-    block_subscriber_->invoke(error::success, fork_height, incoming, outgoing);
+    // Handlers are invoked by the notification thread, outside of the
+    // critical section, so the organizer does not wait on subscribers.
+    const auto subscriber = block_subscriber_;
+    const auto payments = payment_subscriber_;
+    notifications_.push([=]()
+    {
+        const auto start = asio::steady_clock::now();
+        subscriber->invoke(error::success, fork_height, incoming, outgoing);
+        payments->notify(fork_height, incoming, outgoing);
+        metrics_.record(stage_metrics::entity::block,
+            stage_metrics::stage::notify, start);
+    });
 }
 
 // protected
@@ -2042,16 +3939,36 @@ void block_chain::notify(size_t fork_height,
     header_const_ptr_list_const_ptr outgoing)
 {
     // TODO: check for subscription dependencies on non-empty incoming.
-    // This invokes handlers within the criticial section (deadlock risk).
-    header_subscriber_->invoke(error::success, fork_height, incoming, outgoing);
+    // Consecutive header reorganizations may be coalesced while queued.
+    notifications_.push(fork_height, incoming, outgoing);
 }
 
 // protected
 void block_chain::notify(transaction_const_ptr tx)
 {
     // TODO: check for subscription dependencies on non-empty incoming.
-    // This invokes handlers within the criticial section (deadlock risk).
-    transaction_subscriber_->invoke(error::success, tx);
+    const auto subscriber = transaction_subscriber_;
+    const auto payments = payment_subscriber_;
+    notifications_.push([=]()
+    {
+        const auto start = asio::steady_clock::now();
+        subscriber->invoke(error::success, tx);
+        payments->notify(tx);
+        metrics_.record(stage_metrics::entity::transaction,
+            stage_metrics::stage::notify, start);
+    });
+}
+
+// protected
+// Long-poll template waiters are notified of the height of the template,
+// which changes with the confirmed tip and with each pooled tx.
+void block_chain::notify_template(size_t height)
+{
+    const auto subscriber = template_subscriber_;
+    notifications_.push([=]()
+    {
+        subscriber->invoke(error::success, height);
+    });
 }
 
 // Organizer/Writers.
@@ -2059,22 +3976,71 @@ void block_chain::notify(transaction_const_ptr tx)
 
 void block_chain::organize(header_const_ptr header, result_handler handler)
 {
+    if (!stopped())
+        workload_.write(header);
+
     // The handler must not call organize (lock safety).
     header_organizer_.organize(header, handler);
 }
 
+void block_chain::organize(headers_const_ptr headers, result_handler handler)
+{
+    if (!stopped())
+        workload_.write(headers);
+
+    // The handler must not call organize (lock safety).
+    header_organizer_.organize(headers, handler);
+}
+
 void block_chain::organize(transaction_const_ptr tx, result_handler handler)
 {
+    if (!stopped())
+        workload_.write(tx);
+
     // The handler must not call organize (lock safety).
     transaction_organizer_.organize(tx, handler, bitcoin_settings_.max_money());
 }
 
+void block_chain::organize(transaction_const_ptr_list_const_ptr txs,
+    result_list_handler handler)
+{
+    if (!stopped())
+        workload_.write(txs);
+
+    // The handler must not call organize (lock safety).
+    transaction_organizer_.organize(txs, handler,
+        bitcoin_settings_.max_money());
+}
+
 code block_chain::organize(block_const_ptr block, size_t height)
 {
+    if (!stopped())
+        workload_.write(block, height);
+
     // This triggers block and header reorganization notifications.
     return block_organizer_.organize(block, height);
 }
 
+code block_chain::import(const block_importer::paths& files,
+    uint32_t identifier)
+{
+    // Stored blocks are bounded by the validation cache (and the cores).
+    const auto threads = thread_ceiling(settings_.cores);
+    const auto limit = std::max(size_t(settings_.download_cache_blocks),
+        size_t(threads));
+
+    block_importer importer(*this, *this, threads, limit,
+        asio::milliseconds(settings_.header_commit_milliseconds));
+
+    const auto ec = importer.import(files, identifier);
+
+    LOG_INFO(LOG_BLOCKCHAIN)
+        << "Imported " << importer.imported() << " blocks ("
+        << importer.skipped() << " skipped): " << ec.message();
+
+    return ec;
+}
+
 // Properties.
 // ----------------------------------------------------------------------------
 
@@ -2084,6 +4050,22 @@ const settings& block_chain::chain_settings() const
     return settings_;
 }
 
+// non-interface
+block_chain::chain_view::ptr block_chain::view() const
+{
+    return view_.load();
+}
+
+const stage_metrics& block_chain::metrics() const
+{
+    return metrics_;
+}
+
+const memory_budget& block_chain::budget() const
+{
+    return memory_budget_;
+}
+
 // protected
 bool block_chain::stopped() const
 {
@@ -0,0 +1,478 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/organizers/block_importer.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <condition_variable>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/interface/fast_chain.hpp>
+#include <bitcoin/blockchain/interface/safe_chain.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+using namespace bc::chain;
+using namespace bc::config;
+
+#define NAME "block_importer"
+
+// Headers are organized in runs of the protocol message limit.
+static constexpr size_t run_size = 2000;
+
+// Blocks read ahead of their parent are parked up to this many.
+static constexpr size_t maximum_orphans = 1024;
+
+// Deferred header commits are awaited beyond the commit latency by this.
+static const asio::duration commit_margin = asio::milliseconds(100);
+
+// Header reorganizations are counted and signaled, so that blocks awaiting a
+// deferred commit of their headers are promoted once it completes. The
+// subscription outlives the import, so it is shared and stopped on return.
+class commit_signal
+{
+public:
+    commit_signal()
+      : stopped_(false), count_(0)
+    {
+    }
+
+    // False (unsubscribe) once stopped.
+    bool notify(const code& ec)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        if (stopped_ || ec == error::service_stopped)
+            return false;
+
+        ++count_;
+        lock.unlock();
+        signal_.notify_one();
+        return true;
+    }
+
+    size_t count() const
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return count_;
+    }
+
+    // Wait for a signal after the given count, false if none by the deadline.
+    bool wait(size_t& count, const asio::time_point& deadline)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        if (!signal_.wait_until(lock, deadline, [this, count]()
+        {
+            return count_ != count;
+        }))
+            return false;
+
+        count = count_;
+        return true;
+    }
+
+    void stop()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stopped_ = true;
+    }
+
+private:
+    bool stopped_;
+    size_t count_;
+    mutable std::mutex mutex_;
+    std::condition_variable signal_;
+};
+
+block_importer::block_importer(fast_chain& chain, safe_chain& organizer,
+    size_t threads, size_t limit, const asio::duration& commit_latency)
+  : fast_chain_(chain),
+    safe_chain_(organizer),
+    threads_(std::max(threads, size_t(1))),
+    limit_(std::max(limit, size_t(1))),
+    commit_latency_(commit_latency),
+    top_height_(0),
+    skipped_(0),
+    pending_(0),
+    imported_(0)
+{
+}
+
+size_t block_importer::imported() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return imported_;
+}
+
+size_t block_importer::skipped() const
+{
+    return skipped_;
+}
+
+// Reading.
+//-----------------------------------------------------------------------------
+
+// Preallocated blk*.dat files are zero filled, so a zero magic ends records.
+bool block_importer::read(const boost::filesystem::path& file,
+    uint32_t identifier, block_handler handler)
+{
+    boost::filesystem::ifstream stream(file, std::ios::binary);
+
+    if (!stream)
+        return false;
+
+    istream_reader source(stream);
+
+    // The first four bytes select the format, and are then reread.
+    const auto records = source.read_4_bytes_little_endian() == identifier &&
+        source;
+
+    stream.clear();
+    stream.seekg(0);
+
+    while (source && !source.is_exhausted())
+    {
+        chain::block block;
+
+        if (records)
+        {
+            const auto magic = source.read_4_bytes_little_endian();
+
+            if (source && magic == 0)
+                return true;
+
+            const auto size = source.read_4_bytes_little_endian();
+
+            if (!source || magic != identifier)
+                return false;
+
+            if (!block.from_data(source.read_bytes(size), true))
+                return false;
+        }
+        else if (!block.from_data(source, true))
+        {
+            return false;
+        }
+
+        if (!handler(std::make_shared<const message::block>(std::move(block))))
+            return false;
+    }
+
+    return source;
+}
+
+// Import sequence.
+//-----------------------------------------------------------------------------
+
+code block_importer::import(const paths& files, uint32_t identifier)
+{
+    threadpool pool(threads_);
+    dispatcher dispatch(pool, NAME "_dispatch");
+
+    run_.clear();
+    waiting_.clear();
+    orphans_.clear();
+    skipped_ = 0;
+    reset_top();
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        pending_ = 0;
+        imported_ = 0;
+        error_ = error::success;
+    }
+
+    const auto handler = [this, &dispatch](block_const_ptr block)
+    {
+        return handle(block, dispatch);
+    };
+
+    const auto commits = std::make_shared<commit_signal>();
+    safe_chain_.subscribe_headers([commits](code ec, size_t,
+        header_const_ptr_list_const_ptr, header_const_ptr_list_const_ptr)
+    {
+        return commits->notify(ec);
+    });
+
+    auto read_failed = false;
+
+    for (const auto& file: files)
+    {
+        if (!read(file, identifier, handler))
+        {
+            read_failed = true;
+            break;
+        }
+    }
+
+    // A commit following the count (including of the last run) is signaled.
+    auto committed = commits->count();
+
+    if (!read_failed)
+        flush(dispatch);
+
+    // Deferred header commits complete within the commit latency.
+    const auto deadline = asio::steady_clock::now() + commit_latency_ +
+        commit_margin;
+
+    while (!read_failed && !waiting_.empty() &&
+        commits->wait(committed, deadline))
+        promote(dispatch);
+
+    commits->stop();
+
+    // Waiting blocks never became candidates (a run of the file that is not
+    // the strongest chain), and parked blocks never connected.
+    if (!read_failed && !waiting_.empty())
+        LOG_WARNING(LOG_BLOCKCHAIN)
+            << "Timed out awaiting the candidacy of " << waiting_.size()
+            << " imported blocks, which are skipped.";
+
+    skipped_ += orphans_.size() + waiting_.size() + run_.size();
+    orphans_.clear();
+    waiting_.clear();
+    run_.clear();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    completed_.wait(lock, [this]()
+    {
+        return pending_ == 0;
+    });
+
+    const auto ec = error_;
+    lock.unlock();
+
+    pool.shutdown();
+    pool.join();
+
+    if (ec)
+        return ec;
+
+    return read_failed ? error::bad_stream : error::success;
+}
+
+// private
+// Blocks of organized headers are stored at their height, others must extend
+// the run (directly or once their parent has been read).
+bool block_importer::handle(block_const_ptr block, dispatcher& dispatch)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (error_)
+            return false;
+    }
+
+    size_t height;
+    chain::header header;
+    const auto hash = block->hash();
+
+    if (fast_chain_.get_header(header, height, hash, true))
+    {
+        hash_digest downloadable;
+
+        // A block that has already been stored is not imported.
+        if (fast_chain_.get_downloadable(downloadable, height) &&
+            downloadable == hash)
+            submit(block, height, dispatch);
+        else
+            ++skipped_;
+
+        return true;
+    }
+
+    const auto& parent = block->header().previous_block_hash();
+
+    if (parent != top_hash_)
+    {
+        // A second child of the same parent is a competing block.
+        if (orphans_.size() >= maximum_orphans ||
+            !orphans_.emplace(parent, block).second)
+            ++skipped_;
+
+        return true;
+    }
+
+    extend(block, dispatch);
+
+    // Parked successors connect once their parent extends the run.
+    for (auto it = orphans_.find(top_hash_); it != orphans_.end();
+        it = orphans_.find(top_hash_))
+    {
+        const auto next = it->second;
+        orphans_.erase(it);
+        extend(next, dispatch);
+    }
+
+    return true;
+}
+
+// private
+void block_importer::extend(block_const_ptr block, dispatcher& dispatch)
+{
+    run_.push_back(block);
+    top_hash_ = block->hash();
+    ++top_height_;
+
+    if (run_.size() >= run_size)
+        flush(dispatch);
+}
+
+// private
+// The headers of the run are organized as one branch. A rejected run (or its
+// tail) does not become candidate, so later blocks must extend the top. Only
+// blocks of the rejected run are skipped, as those of earlier runs may await
+// a deferred commit.
+bool block_importer::flush(dispatcher& dispatch)
+{
+    if (run_.empty())
+    {
+        promote(dispatch);
+        return true;
+    }
+
+    message::header::list headers;
+    headers.reserve(run_.size());
+
+    for (const auto& block: run_)
+        headers.push_back(block->header());
+
+    std::promise<code> promise;
+    safe_chain_.organize(std::make_shared<const message::headers>(
+        std::move(headers)), [&promise](const code& ec)
+        {
+            promise.set_value(ec);
+        });
+
+    const auto ec = promise.get_future().get();
+    const auto first = top_height_ - run_.size() + 1u;
+    block_const_ptr_list run;
+    run.swap(run_);
+    auto height = first;
+
+    for (const auto& block: run)
+        waiting_.emplace_back(block, height++);
+
+    if (ec == error::service_stopped)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        error_ = ec;
+        return false;
+    }
+
+    promote(dispatch);
+
+    if (ec)
+    {
+        reset_top();
+
+        const auto end = std::remove_if(waiting_.begin(), waiting_.end(),
+            [&](const entry& value)
+            {
+                return value.second >= first &&
+                    value.second < first + run.size() &&
+                    run[value.second - first] == value.first;
+            });
+
+        skipped_ += std::distance(end, waiting_.end());
+        waiting_.erase(end, waiting_.end());
+    }
+
+    return true;
+}
+
+// private
+// Headers may be deferred by group commit, so candidacy is confirmed.
+void block_importer::promote(dispatcher& dispatch)
+{
+    std::vector<entry> waiting;
+
+    for (const auto& entry: waiting_)
+    {
+        hash_digest hash;
+
+        if (fast_chain_.get_downloadable(hash, entry.second) &&
+            hash == entry.first->hash())
+            submit(entry.first, entry.second, dispatch);
+        else
+            waiting.push_back(entry);
+    }
+
+    waiting_.swap(waiting);
+}
+
+// private
+// The number of blocks in checking and storage is bounded by the limit.
+void block_importer::submit(block_const_ptr block, size_t height,
+    dispatcher& dispatch)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    completed_.wait(lock, [this]()
+    {
+        return pending_ < limit_;
+    });
+
+    ++pending_;
+    lock.unlock();
+
+    dispatch.concurrent(&block_importer::store, this, block, height);
+}
+
+// private
+// Checks run on this thread, and validation is queued in height order.
+void block_importer::store(block_const_ptr block, size_t height)
+{
+    const auto ec = safe_chain_.organize(block, height);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (ec && !error_)
+        error_ = ec;
+
+    if (!ec)
+        ++imported_;
+
+    --pending_;
+    lock.unlock();
+    completed_.notify_all();
+}
+
+// private
+void block_importer::reset_top()
+{
+    checkpoint top;
+
+    if (fast_chain_.get_top(top, true))
+    {
+        top_hash_ = top.hash();
+        top_height_ = top.height();
+    }
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
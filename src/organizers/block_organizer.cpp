@@ -18,13 +18,19 @@
  */
 #include <bitcoin/blockchain/organizers/block_organizer.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <future>
 #include <memory>
+#include <mutex>
 #include <utility>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/blockchain/interface/fast_chain.hpp>
+#include <bitcoin/blockchain/pools/validation_trace.hpp>
 #include <bitcoin/blockchain/settings.hpp>
 
 namespace libbitcoin {
@@ -36,14 +42,33 @@ using namespace std::placeholders;
 
 #define NAME "block_organizer"
 
+// Prefetch depth is reduced for large blocks to bound prefetched memory.
+static constexpr size_t prefetch_budget_bytes = 64u * 1024u * 1024u;
+
+// Validated blocks held for reorganization are bounded in the same manner.
+static constexpr size_t branch_budget_bytes = 64u * 1024u * 1024u;
+
 block_organizer::block_organizer(prioritized_mutex& mutex,
-    dispatcher& priority_dispatch, threadpool& threads, fast_chain& chain,
-    const settings& settings,  bc::settings& bitcoin_settings)
+    dispatcher& priority_dispatch, dispatcher& io_dispatch,
+    threadpool& threads, fast_chain& chain, stage_metrics& metrics,
+    validation_trace& trace, script_cache& cache, const settings& settings,
+     bc::settings& bitcoin_settings)
   : fast_chain_(chain),
+    metrics_(metrics),
+    trace_(trace),
     mutex_(mutex),
     stopped_(true),
-    validator_(priority_dispatch, chain, settings, bitcoin_settings),
-    downloader_subscriber_(std::make_shared<download_subscriber>(threads, NAME))
+    pipelined_(settings.pipelined_validation),
+    prefetch_blocks_(settings.prefetch_blocks),
+    checkpoint_window_(settings.checkpoint_window_blocks),
+    prefetched_(0),
+    speculative_blocks_(settings.speculative_blocks),
+    speculating_(0),
+    validator_(priority_dispatch, io_dispatch, chain, cache, trace, settings,
+        bitcoin_settings),
+    download_cache_(settings.download_cache_blocks),
+    downloader_subscriber_(std::make_shared<download_subscriber>(threads, NAME)),
+    dispatch_(threads, NAME "_prefetch")
 {
     const auto this_id = boost::this_thread::get_id();
     LOG_VERBOSE(LOG_BLOCKCHAIN)
@@ -82,6 +107,7 @@ bool block_organizer::stop()
     validator_.stop();
     downloader_subscriber_->relay(error::service_stopped, null_hash, (size_t)0);
     downloader_subscriber_->stop();
+    download_cache_.clear();
     stopped_ = true;
     return true;
 }
@@ -96,6 +122,9 @@ code block_organizer::organize(block_const_ptr block, size_t height)
     // Checks that are independent of chain state (header, block, txs).
     validator_.check(block, height);
 
+    // Scripts of a block ahead of its parent are verified while it waits.
+    speculate(block, height);
+
     // Store txs (if missing) and associate them to candidate block.
     // Existing txs cannot suffer a state change as they may also be confirmed.
     //#########################################################################
@@ -107,7 +136,10 @@ code block_organizer::organize(block_const_ptr block, size_t height)
     << " block_organizer::organize() error_code: "
     << error_code;
 
-    // TODO: cache block as last downloaded (for fast top validation).
+    // Cache the stored block so that validation does not rebuild it.
+    if (!error_code && !block->header().metadata.error)
+        download_cache_.add(block);
+
     // Queue download notification to invoke validation on downloader thread.
     downloader_subscriber_->relay(error_code, block->hash(), height);
 
@@ -126,7 +158,10 @@ void block_organizer::prime_validation(const hash_digest& hash,
 // Validate sequence.
 //-----------------------------------------------------------------------------
 // This runs in single thread normal priority except validation fan-outs.
-// Therefore fan-outs may use all threads in the priority threadpool.
+// Therefore fan-outs may use all threads in the priority threadpool. The
+// sequence holds the validation lock, which is released only by its owning
+// thread, so this (network) thread joins each stage. Header and transaction
+// completions resume on the network pool, so no priority thread waits on it.
 
 // This is the start of the validation sequence.
 bool block_organizer::handle_check(const code& ec, const hash_digest& hash,
@@ -141,9 +176,19 @@ bool block_organizer::handle_check(const code& ec, const hash_digest& hash,
     << " block_organizer::handle_check() with mutex_ of "
     << &mutex_ << " calling lock_high_priority()";
     
+    auto& locks = metrics_.locks();
+    const auto site = lock_metrics::site::block_validate;
+    const auto waited = locks.waiting(site);
+
     // Critical Section
     ///////////////////////////////////////////////////////////////////////////
     mutex_.lock_high_priority();
+    locks.acquired(site, waited);
+
+    // The wait is traced with the first block validated under the lock.
+    auto lock_microseconds = static_cast<uint64_t>(
+        std::chrono::duration_cast<asio::microseconds>(
+            asio::steady_clock::now() - waited).count());
 
     LOG_VERBOSE(LOG_BLOCKCHAIN)
     << this_id
@@ -158,6 +203,7 @@ bool block_organizer::handle_check(const code& ec, const hash_digest& hash,
         << this_id
         << " block_organizer::handle_check() with mutex_ of "
         << &mutex_ << " calling unlock_high_priority()";
+        locks.released(site);
         mutex_.unlock_high_priority();
         LOG_VERBOSE(LOG_BLOCKCHAIN)
         << this_id
@@ -169,15 +215,24 @@ bool block_organizer::handle_check(const code& ec, const hash_digest& hash,
     // Stack up the validated blocks for possible reorganization.
     auto branch_cache = std::make_shared<block_const_ptr_list>();
     auto branch_height = height;
+    size_t branch_bytes = 0;
     code error_code;
 
-    for (auto branch_height = height; !stopped() && height != 0; ++height)
+    // The successor block and its accept stage, when pipelined.
+    block_const_ptr next;
+    abort_token::ptr next_token;
+    std::future<code> next_accepted;
+
+    // Checkpointed blocks are committed in windows ahead of validation.
+    if (checkpoint_window_ != 0)
+        error_code = organize_checkpointed(height, branch_cache,
+            branch_height, branch_bytes);
+
+    for (; !error_code && !stopped() && height != 0; ++height)
     {
-        // TODO: check last downloaded cache first (for fast top validation).
-        // TODO: create parallel block reader (this is expensive and serial).
-        // TODO: this can run in the block populator using priority dispatch.
         // TODO: consider metadata population in line with block read.
-        auto block = fast_chain_.get_block(height, true, true);
+        // A pipelined successor was read and accepted in the last iteration.
+        auto block = next ? next : get_block(height);
 
         LOG_DEBUG(LOG_BLOCKCHAIN)
             << this_id
@@ -188,10 +243,18 @@ bool block_organizer::handle_check(const code& ec, const hash_digest& hash,
             block->header().previous_block_hash())
             break;
 
+        // Read successors on the normal pool while this block is validated.
+        prefetch(block, height);
+
         // Checks that are dependent upon chain state.
-        if ((error_code = validate(block)))
+        if ((error_code = pipelined_ ?
+            validate(block, height, next, next_token, next_accepted) :
+            validate(block)))
             break;
 
+        trace_.write(block, lock_microseconds);
+        lock_microseconds = 0;
+
         if (block->header().metadata.error)
         {
             // TODO: handle invalidity caching of merkle mutations.
@@ -205,11 +268,18 @@ bool block_organizer::handle_check(const code& ec, const hash_digest& hash,
         }
         else
         {
+            const auto start = asio::steady_clock::now();
+
             // Mark candidate block as valid and mark candidate-spent outputs.
             //#################################################################
             error_code = fast_chain_.candidate(block);
             //#################################################################
+
+            metrics_.record(stage_metrics::entity::block,
+                stage_metrics::stage::candidate, start);
             branch_cache->push_back(block);
+            branch_bytes += block->serialized_size(true);
+            bound_branch(branch_cache, branch_height, branch_bytes);
 
             if (error_code)
                 break;
@@ -222,11 +292,16 @@ bool block_organizer::handle_check(const code& ec, const hash_digest& hash,
 
         if (fast_chain_.is_reorganizable())
         {
+            const auto start = asio::steady_clock::now();
+
             // Reorganize this stronger candidate branch into confirmed chain.
             //#################################################################
             error_code = fast_chain_.reorganize(branch_cache, branch_height);
             //#################################################################
 
+            metrics_.record(stage_metrics::entity::block,
+                stage_metrics::stage::reorganize, start);
+
             if (error_code)
                 break;
 
@@ -238,6 +313,7 @@ bool block_organizer::handle_check(const code& ec, const hash_digest& hash,
             // Reset the branch for next reorganization.
             branch_height += branch_cache->size();
             branch_cache->clear();
+            branch_bytes = 0;
         }
 
         // Top valid chain state should have been updated to match the block.
@@ -249,6 +325,7 @@ bool block_organizer::handle_check(const code& ec, const hash_digest& hash,
     << this_id
     << " block_organizer::handle_check() with mutex_ of "
     << &mutex_ << " calling unlock_high_priority()";
+    locks.released(site);
     mutex_.unlock_high_priority();
     LOG_VERBOSE(LOG_BLOCKCHAIN)
     << this_id
@@ -274,27 +351,461 @@ bool block_organizer::handle_check(const code& ec, const hash_digest& hash,
 // Convert validate.accept/connect to a sequential call.
 code block_organizer::validate(block_const_ptr block)
 {
-    resume_ = std::promise<code>();
+    const auto promise = std::make_shared<std::promise<code>>();
 
     const result_handler complete =
-        std::bind(&block_organizer::signal_completion,
-            this, _1);
+        std::bind(&block_organizer::handle_stage,
+            this, _1, promise);
+
+    // Shared by accept and connect, so an accept failure skips connect.
+    const auto token = std::make_shared<abort_token>();
 
     const auto accept_handler =
         std::bind(&block_organizer::handle_accept,
-            this, _1, block, complete);
+            this, _1, block, token, complete);
 
     // Checks that are dependent upon chain state.
-    validator_.accept(block, accept_handler);
+    validator_.accept(block, token, accept_handler);
 
     // Store failed or received stop code from validator.
-    return resume_.get_future().get();
+    return promise->get_future().get();
+}
+
+// private
+// Downloaded blocks are taken from the cache, falling back to the store.
+block_const_ptr block_organizer::get_block(size_t height)
+{
+    const auto start = asio::steady_clock::now();
+    block_const_ptr block;
+    hash_digest hash;
+
+    if (fast_chain_.get_block_hash(hash, height, true))
+        block = download_cache_.take(hash);
+
+    if (!block)
+        block = fast_chain_.get_block(height, true, true);
+
+    if (block)
+        metrics_.record(stage_metrics::entity::block,
+            stage_metrics::stage::read, start);
+
+    return block;
+}
+
+// private
+// Successor candidates are read ahead into the download cache, bounded by
+// configured depth, by cache capacity and by the size of the current block.
+void block_organizer::prefetch(block_const_ptr block, size_t height)
+{
+    const auto bytes = std::max(block->serialized_size(true), size_t(1));
+    const auto depth = std::min(
+    {
+        prefetch_blocks_,
+        download_cache_.capacity(),
+        std::max(prefetch_budget_bytes / bytes, size_t(1))
+    });
+
+    if (depth == 0)
+        return;
+
+    // Resume above heights already requested, unless a reorganization reset.
+    const auto last = height + depth;
+    const auto prefetched = prefetched_.load();
+    const auto first = prefetched > height && prefetched <= last ?
+        prefetched + 1u : height + 1u;
+
+    for (auto next = first; next <= last; ++next)
+        dispatch_.concurrent(&block_organizer::prefetch_block, this, next);
+
+    prefetched_.store(last);
+}
+
+// private
+void block_organizer::prefetch_block(size_t height)
+{
+    hash_digest hash;
+    if (stopped() || !fast_chain_.get_block_hash(hash, height, true) ||
+        download_cache_.exists(hash))
+        return;
+
+    // A block not yet downloaded is not returned, it will be cached on arrival.
+    const auto block = fast_chain_.get_block(height, true, true);
+
+    if (block)
+        download_cache_.add(block);
+}
+
+// private
+// Blocks downloaded ahead of the next candidate are copied (the copy is
+// populated) and verified on the normal pool, bounded to speculative_blocks
+// in flight, so that their connect finds their scripts cached. It is off by
+// default (zero), as it costs a block copy and script verification.
+void block_organizer::speculate(block_const_ptr block, size_t height)
+{
+    const auto& metadata = block->header().metadata;
+
+    if (speculative_blocks_ == 0 || metadata.error || metadata.validated ||
+        fast_chain_.top_valid_candidate_state()->height() + 1u >= height)
+        return;
+
+    if (++speculating_ > speculative_blocks_)
+    {
+        --speculating_;
+        return;
+    }
+
+    const auto copy = std::make_shared<const message::block>(*block);
+    dispatch_.concurrent(&block_organizer::speculate_block, this, copy);
 }
 
 // private
-void block_organizer::signal_completion(const code& ec)
+void block_organizer::speculate_block(block_const_ptr block)
 {
-    resume_.set_value(ec);
+    if (!stopped())
+    {
+        const auto start = asio::steady_clock::now();
+        validator_.speculate(block);
+
+        LOG_DEBUG(LOG_BLOCKCHAIN)
+            << "Speculated block [" << encode_hash(block->hash()) << "] in "
+            << std::chrono::duration_cast<asio::microseconds>(
+                asio::steady_clock::now() - start).count() << " us.";
+    }
+
+    --speculating_;
+}
+
+// Bulk checkpoint sequence.
+//-----------------------------------------------------------------------------
+// Blocks under checkpoint are neither populated nor validated (prevouts are
+// required only for payment indexing), so a window of them is promoted in
+// sequence and then marked as candidates in one call. The window ends at the
+// first block that is missing, does not link or is not under checkpoint.
+
+// private
+code block_organizer::organize_checkpointed(size_t& height,
+    block_const_ptr_list_ptr branch_cache, size_t& branch_height,
+    size_t& branch_bytes)
+{
+    code ec;
+    auto state = fast_chain_.top_valid_candidate_state();
+    auto full = true;
+
+    while (full && !stopped())
+    {
+        const auto window = std::make_shared<block_const_ptr_list>();
+        window->reserve(checkpoint_window_);
+
+        // The window is read concurrently and then linked in height order.
+        const auto blocks = read_window(height);
+        auto block = blocks.begin();
+
+        for (; block != blocks.end(); ++block)
+        {
+            if (!*block || (*block)->header().previous_block_hash() !=
+                state->hash())
+                break;
+
+            auto& metadata = (*block)->header().metadata;
+            const auto promoted = fast_chain_.promote_state(
+                (*block)->header(), state);
+
+            if (!promoted || !promoted->is_under_checkpoint())
+                break;
+
+            metadata.state = promoted;
+            metadata.validated = true;
+            window->push_back(*block);
+            state = promoted;
+            ++height;
+        }
+
+        // Blocks beyond the window are returned for the validation sequence.
+        for (; block != blocks.end(); ++block)
+            if (*block)
+                download_cache_.add(*block);
+
+        if (window->empty())
+            break;
+
+        // Read successors on the normal pool while the window is committed.
+        prefetch(window->back(), height - 1u);
+
+        full = (window->size() == checkpoint_window_);
+
+        // Mark candidate blocks as valid and mark candidate-spent outputs.
+        //#####################################################################
+        if ((ec = fast_chain_.candidate(window)))
+            break;
+        //#####################################################################
+
+        branch_cache->insert(branch_cache->end(), window->begin(),
+            window->end());
+
+        for (const auto& cached: *window)
+            branch_bytes += cached->serialized_size(true);
+
+        bound_branch(branch_cache, branch_height, branch_bytes);
+
+        LOG_DEBUG(LOG_BLOCKCHAIN)
+            << "Checkpointed blocks [" << height - window->size() << "-"
+            << height - 1u << "]";
+
+        if (fast_chain_.is_reorganizable())
+        {
+            const auto start = asio::steady_clock::now();
+
+            // Reorganize this stronger candidate branch into confirmed chain.
+            //#################################################################
+            ec = fast_chain_.reorganize(branch_cache, branch_height);
+            //#################################################################
+
+            metrics_.record(stage_metrics::entity::block,
+                stage_metrics::stage::reorganize, start);
+
+            if (ec)
+                break;
+
+            LOG_INFO(LOG_BLOCKCHAIN)
+                << "Organized blocks [" << branch_height << "-"
+                << branch_height + branch_cache->size() - 1u << "]";
+
+            // Reset the branch for next reorganization.
+            branch_height += branch_cache->size();
+            branch_cache->clear();
+            branch_bytes = 0;
+        }
+    }
+
+    return ec;
+}
+
+// private
+// A branch weaker than the confirmed chain is otherwise unbounded (as is the
+// reorganization limit by default), so blocks below its top are released.
+// Reorganization reads released blocks from the candidate cache or store.
+void block_organizer::bound_branch(block_const_ptr_list_ptr branch_cache,
+    size_t& branch_height, size_t& branch_bytes) const
+{
+    auto released = branch_cache->begin();
+
+    while (branch_bytes > branch_budget_bytes &&
+        std::next(released) != branch_cache->end())
+    {
+        branch_bytes -= (*released)->serialized_size(true);
+        ++branch_height;
+        ++released;
+    }
+
+    branch_cache->erase(branch_cache->begin(), released);
+}
+
+// Heights of the window are claimed by whichever thread is free, and the
+// calling thread also reads, waiting only for heights claimed by running
+// helpers. Helpers that start late find no height and touch nothing.
+struct block_organizer::window_read
+{
+    window_read(size_t height, size_t count)
+      : height(height), blocks(count), next(0), remaining(count)
+    {
+    }
+
+    const size_t height;
+
+    // Each block is written only by the thread that claims its height.
+    block_const_ptr_list blocks;
+    std::atomic<size_t> next;
+
+    // These are protected by mutex.
+    size_t remaining;
+    std::mutex mutex;
+    std::condition_variable completed;
+};
+
+// private
+block_const_ptr_list block_organizer::read_window(size_t height)
+{
+    const auto read = std::make_shared<window_read>(height,
+        checkpoint_window_);
+    const auto readers = std::min(dispatch_.size() + 1u, checkpoint_window_);
+
+    // The calling thread is the remaining reader.
+    for (size_t reader = 1; reader < readers; ++reader)
+        dispatch_.concurrent(&block_organizer::read_window_blocks, this,
+            read);
+
+    read_window_blocks(read);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::unique_lock<std::mutex> lock(read->mutex);
+    read->completed.wait(lock, [&read]() { return read->remaining == 0; });
+    ///////////////////////////////////////////////////////////////////////////
+
+    return read->blocks;
+}
+
+// private
+void block_organizer::read_window_blocks(std::shared_ptr<window_read> read)
+{
+    const auto count = read->blocks.size();
+
+    for (auto offset = read->next++; offset < count; offset = read->next++)
+    {
+        if (!stopped())
+            read->blocks[offset] = get_block(read->height + offset);
+
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        std::unique_lock<std::mutex> lock(read->mutex);
+
+        if (--read->remaining == 0)
+            read->completed.notify_one();
+        ///////////////////////////////////////////////////////////////////////
+    }
+}
+
+// Pipelined validate sequence.
+//-----------------------------------------------------------------------------
+// The successor is read, populated and accepted while the block is connected.
+// Successor population overlays the outputs created and spent by the block,
+// since these are not reflected in the store until the block is a candidate.
+// The successor stage is joined before return, so the store is not read by
+// the stage while the block is committed (ordering is enforced at commit).
+
+// private
+code block_organizer::validate(block_const_ptr block, size_t height,
+    block_const_ptr& next, abort_token::ptr& next_token,
+    std::future<code>& next_accepted)
+{
+    // The block was accepted upon its parent by the preceding iteration.
+    const auto pipelined = next && next == block;
+    const auto token = pipelined ? next_token :
+        std::make_shared<abort_token>();
+    auto accepted = pipelined ? std::move(next_accepted) :
+        start_accept(block, {}, token);
+
+    next.reset();
+    next_token.reset();
+
+    code ec;
+    if ((ec = accepted.get()))
+        return ec;
+
+    // A block found invalid in accept has no successor and is not connected.
+    if (block->header().metadata.error)
+        return ec;
+
+    auto connected = start_connect(block, token);
+
+    // Read the successor on this thread while connect runs on priority pool.
+    next = get_block(height + 1u);
+
+    if (next && next->header().previous_block_hash() == block->hash())
+    {
+        next_token = std::make_shared<abort_token>();
+        next_accepted = start_accept(next, block, next_token);
+    }
+    else
+    {
+        next.reset();
+    }
+
+    ec = connected.get();
+
+    // The successor is discarded by the caller if the block fails, so its
+    // outstanding accept work is abandoned before it is joined.
+    if (next)
+    {
+        if (ec || block->header().metadata.error)
+            next_token->trip();
+
+        next_accepted.wait();
+    }
+
+    return ec;
+}
+
+// private
+std::future<code> block_organizer::start_accept(block_const_ptr block,
+    block_const_ptr parent, abort_token::ptr token)
+{
+    const auto promise = std::make_shared<std::promise<code>>();
+    const result_handler handler =
+        std::bind(&block_organizer::handle_accepted,
+            this, _1, block, promise);
+
+    // Checks that are dependent upon chain state (or pending parent state).
+    if (parent)
+        validator_.accept(block, parent, token, handler);
+    else
+        validator_.accept(block, token, handler);
+
+    return promise->get_future();
+}
+
+// private
+std::future<code> block_organizer::start_connect(block_const_ptr block,
+    abort_token::ptr token)
+{
+    const auto promise = std::make_shared<std::promise<code>>();
+    const result_handler handler =
+        std::bind(&block_organizer::handle_connected,
+            this, _1, block, promise);
+
+    // Checks that include script metadata.
+    validator_.connect(block, token, handler);
+    return promise->get_future();
+}
+
+// private
+void block_organizer::handle_accepted(const code& ec, block_const_ptr block,
+    promise_ptr promise)
+{
+    if (!ec)
+        record_accept(block);
+
+    handle_stage(ec, promise);
+}
+
+// private
+void block_organizer::handle_connected(const code& ec, block_const_ptr block,
+    promise_ptr promise)
+{
+    if (!ec)
+        record_connect(block);
+
+    handle_stage(ec, promise);
+}
+
+// private
+void block_organizer::handle_stage(const code& ec, promise_ptr promise)
+{
+    promise->set_value(stopped() ? error::service_stopped : ec);
+}
+
+// private
+// Population ends where contextual checks begin (by the accept start time),
+// which are not performed for blocks under checkpoint or already validated.
+void block_organizer::record_accept(block_const_ptr block)
+{
+    const auto& metadata = block->metadata;
+
+    if (metadata.start_accept == asio::time_point())
+        return;
+
+    metrics_.record(stage_metrics::entity::block,
+        stage_metrics::stage::populate,
+        metadata.start_accept - metadata.start_populate);
+    metrics_.record(stage_metrics::entity::block,
+        stage_metrics::stage::accept, metadata.start_accept);
+}
+
+// private
+void block_organizer::record_connect(block_const_ptr block)
+{
+    metrics_.record(stage_metrics::entity::block,
+        stage_metrics::stage::connect, block->metadata.start_connect);
 }
 
 // Verify sub-sequence.
@@ -302,7 +813,7 @@ void block_organizer::signal_completion(const code& ec)
 
 // private
 void block_organizer::handle_accept(const code& ec, block_const_ptr block,
-    result_handler handler)
+    abort_token::ptr token, result_handler handler)
 {
     if (stopped())
     {
@@ -316,16 +827,18 @@ void block_organizer::handle_accept(const code& ec, block_const_ptr block,
         return;
     }
 
+    record_accept(block);
+
     const auto connect_handler =
         std::bind(&block_organizer::handle_connect,
             this, _1, block, handler);
 
     // Checks that include script metadata.
-    validator_.connect(block, connect_handler);
+    validator_.connect(block, token, connect_handler);
 }
 
 // private
-void block_organizer::handle_connect(const code& ec, block_const_ptr,
+void block_organizer::handle_connect(const code& ec, block_const_ptr block,
     result_handler handler)
 {
     if (stopped())
@@ -340,6 +853,7 @@ void block_organizer::handle_connect(const code& ec, block_const_ptr,
         return;
     }
 
+    record_connect(block);
     handler(error::success);
 }
 
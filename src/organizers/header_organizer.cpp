@@ -18,6 +18,7 @@
  */
 #include <bitcoin/blockchain/organizers/header_organizer.hpp>
 
+#include <algorithm>
 #include <cstddef>
 #include <functional>
 #include <future>
@@ -36,14 +37,24 @@ using namespace std::placeholders;
 
 #define NAME "header_organizer"
 
+// Runs shorter than this are checked on the calling thread.
+static constexpr size_t minimum_parallel_check = 16;
+
 header_organizer::header_organizer(prioritized_mutex& mutex,
-    dispatcher& priority_dispatch, threadpool&, fast_chain& chain,
-    header_pool& pool, bool scrypt, bc::settings& bitcoin_settings)
-  : fast_chain_(chain),
+    dispatcher& priority_dispatch, threadpool& threads, fast_chain& chain,
+    stage_metrics& metrics, header_pool& pool, const settings& settings,
+    bc::settings& bitcoin_settings)
+  : priority_dispatch_(priority_dispatch),
+    fast_chain_(chain),
+    metrics_(metrics),
     mutex_(mutex),
     stopped_(true),
     pool_(pool),
-    validator_(priority_dispatch, chain, scrypt, bitcoin_settings)
+    validator_(priority_dispatch, chain, settings.scrypt_proof_of_work,
+        bitcoin_settings),
+    threads_(threads),
+    dispatch_(threads, NAME "_dispatch"),
+    commit_latency_(asio::milliseconds(settings.header_commit_milliseconds))
 {
     const auto this_id = boost::this_thread::get_id();
     LOG_VERBOSE(LOG_BLOCKCHAIN)
@@ -73,8 +84,13 @@ bool header_organizer::start()
 bool header_organizer::stop()
 {
     validator_.stop();
+
+    // This is called within the critical section (see block_chain::stop).
+    // Deferred headers are committed before the store is closed.
+    const auto ec = flush();
+
     stopped_ = true;
-    return true;
+    return !ec;
 }
 
 // Organize sequence.
@@ -117,7 +133,10 @@ void header_organizer::organize(header_const_ptr header,
 
     // Critical Section
     ///////////////////////////////////////////////////////////////////////////
+    const auto waited = metrics_.locks().waiting(
+        lock_metrics::site::header_organize);
     mutex_.lock_high_priority();
+    metrics_.locks().acquired(lock_metrics::site::header_organize, waited);
 
     LOG_VERBOSE(LOG_BLOCKCHAIN)
     << this_id
@@ -126,7 +145,14 @@ void header_organizer::organize(header_const_ptr header,
     
     // The pool is safe for filtering only, so protect by critical section.
     // This sets height and presumes the fork point is an indexed header.
-    const auto branch = pool_.get_branch(header);
+    header_branch::ptr branch;
+
+    // A failed commit of the deferred branch leaves the store without it.
+    if ((error_code = get_branch(branch, header)))
+    {
+        complete(error_code);
+        return;
+    }
 
     // See symmetry with tx metadata memory pool.
     // The header is already memory pooled (nothing to do).
@@ -142,7 +168,7 @@ void header_organizer::organize(header_const_ptr header,
 
     const auto accept_handler =
         std::bind(&header_organizer::handle_accept,
-            this, _1, branch, complete);
+            this, _1, branch, asio::steady_clock::now(), complete);
 
     LOG_VERBOSE(LOG_BLOCKCHAIN)
     << this_id
@@ -153,6 +179,190 @@ void header_organizer::organize(header_const_ptr header,
     validator_.accept(branch, accept_handler);
 }
 
+// This is called from block_chain::organize.
+void header_organizer::organize(headers_const_ptr headers,
+    result_handler handler)
+{
+    const auto& elements = headers->elements();
+    const auto incoming = std::make_shared<header_const_ptr_list>();
+    incoming->reserve(elements.size());
+
+    for (const auto& element: elements)
+    {
+        const auto header = std::make_shared<const message::header>(element);
+
+        // The run must be contiguous to be organized as a single branch.
+        if (!incoming->empty() &&
+            header->previous_block_hash() != incoming->back()->hash())
+        {
+            handler(error::orphan_block);
+            return;
+        }
+
+        incoming->push_back(header);
+    }
+
+    if (incoming->empty())
+    {
+        handler(error::success);
+        return;
+    }
+
+    const auto count = incoming->size();
+    const auto threads = priority_dispatch_.size();
+    const auto token = std::make_shared<abort_token>();
+
+    // Checks that are independent of chain state (including proof of work).
+    if (count < minimum_parallel_check || threads < 2u)
+    {
+        const result_handler checked_handler =
+            std::bind(&header_organizer::handle_checked,
+                this, _1, incoming, handler);
+
+        check_headers(incoming, 0, 1, token, checked_handler);
+        return;
+    }
+
+    // The join completes on a priority thread, so resume on the network pool.
+    result_handler complete_handler =
+        std::bind(&header_organizer::resume_checked,
+            this, _1, incoming, handler);
+
+    const auto buckets = std::min(threads, count);
+
+    // The first failure invokes the handler, and trips the remaining buckets.
+    const auto join_handler = synchronize(std::move(complete_handler),
+        buckets, NAME "_check");
+
+    for (size_t bucket = 0; bucket < buckets; ++bucket)
+        priority_dispatch_.concurrent(&header_organizer::check_headers,
+            this, incoming, bucket, buckets, token, join_handler);
+}
+
+// private
+void header_organizer::check_headers(header_const_ptr_list_const_ptr headers,
+    size_t bucket, size_t buckets, abort_token::ptr token,
+    result_handler handler) const
+{
+    code ec;
+    const auto count = headers->size();
+
+    // Run context free header checks (not in header order).
+    for (auto index = bucket; index < count && !token->tripped();
+        index = ceiling_add(index, buckets))
+    {
+        if ((ec = validator_.check((*headers)[index])))
+        {
+            token->trip();
+            break;
+        }
+    }
+
+    handler(ec);
+}
+
+// private
+// The validation lock must never be awaited by a priority thread.
+void header_organizer::resume_checked(const code& ec,
+    header_const_ptr_list_const_ptr incoming, result_handler handler)
+{
+    dispatch_.concurrent(&header_organizer::handle_checked,
+        this, ec, incoming, handler);
+}
+
+// private
+void header_organizer::handle_checked(const code& ec,
+    header_const_ptr_list_const_ptr incoming, result_handler handler)
+{
+    if (stopped())
+    {
+        handler(error::service_stopped);
+        return;
+    }
+
+    if (ec)
+    {
+        handler(ec);
+        return;
+    }
+
+    code error_code;
+    size_t accepted = 0;
+    header_branch::ptr branch;
+    const result_handler complete =
+        std::bind(&header_organizer::handle_complete,
+            this, _1, handler);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    const auto waited = metrics_.locks().waiting(
+        lock_metrics::site::header_organize);
+    mutex_.lock_high_priority();
+    metrics_.locks().acquired(lock_metrics::site::header_organize, waited);
+
+    for (const auto& header: *incoming)
+    {
+        if (accepted == 0)
+        {
+            // The pool is safe for filtering only, so protect by critical
+            // section. This sets height and presumes the fork point is an
+            // indexed header.
+            if ((error_code = get_branch(branch, header)))
+                break;
+
+            // The header is already memory pooled (nothing to do).
+            if (branch->empty())
+            {
+                error_code = error::duplicate_block;
+                continue;
+            }
+        }
+        else
+        {
+            // The run is contiguous, so the header extends the branch top.
+            branch->extend(header);
+        }
+
+        const auto start = asio::steady_clock::now();
+
+        // Checks that are dependent on chain state, which is promoted from
+        // the previously accepted header (no store query).
+        error_code = validator_.accept(branch);
+
+        metrics_.record(stage_metrics::entity::header,
+            stage_metrics::stage::accept, start);
+
+        if (error_code)
+        {
+            // Headers already stored are skipped until one is accepted.
+            if (accepted == 0 && error_code == error::duplicate_block &&
+                branch != pending_)
+                continue;
+
+            // The failed header is dropped and the accepted run organized.
+            branch->pop();
+            break;
+        }
+
+        // Only the top of the branch retains chain state.
+        if (const auto parent = branch->top_parent())
+            parent->metadata.state.reset();
+
+        ++accepted;
+    }
+
+    if (accepted == 0)
+    {
+        complete(error_code);
+        return;
+    }
+
+    const auto result = organize_branch(branch, accepted);
+
+    // A failure above the accepted run is returned once the run is organized.
+    complete(result ? result : error_code);
+}
+
 // private
 void header_organizer::handle_complete(const code& ec, result_handler handler)
 {
@@ -161,6 +371,7 @@ void header_organizer::handle_complete(const code& ec, result_handler handler)
     << this_id
     << " header_organizer::handle_complete() with mutex_ of "
     << &mutex_ << " calling unlock_high_priority()";
+    metrics_.locks().released(lock_metrics::site::header_organize);
     mutex_.unlock_high_priority();
     LOG_VERBOSE(LOG_BLOCKCHAIN)
     << this_id
@@ -177,10 +388,13 @@ void header_organizer::handle_complete(const code& ec, result_handler handler)
 
 // private
 void header_organizer::handle_accept(const code& ec, header_branch::ptr branch,
-    result_handler handler)
+    const asio::time_point& start, result_handler handler)
 {
     const auto this_id = boost::this_thread::get_id();
 
+    metrics_.record(stage_metrics::entity::header,
+        stage_metrics::stage::accept, start);
+
     // The header may exist in the store in any not-invalid state.
     // An invalid state causes an error result and block rejection.
 
@@ -190,6 +404,10 @@ void header_organizer::handle_accept(const code& ec, header_branch::ptr branch,
         return;
     }
 
+    // The failed header is dropped from the deferred branch it extended.
+    if (ec && branch == pending_)
+        pending_->pop();
+
     if (ec)
     {
         // TODO: too many duplicate blocks! find out why and fix this problem.
@@ -205,6 +423,10 @@ void header_organizer::handle_accept(const code& ec, header_branch::ptr branch,
         return;
     }
 
+    // Only the top of the branch retains chain state.
+    if (const auto parent = branch->top_parent())
+        parent->metadata.state.reset();
+
     // The top block is valid even if the branch has insufficient work.
     const auto top = branch->top();
     const auto work = branch->work();
@@ -237,25 +459,172 @@ void header_organizer::handle_accept(const code& ec, header_branch::ptr branch,
         return;
     }
 
+    handler(defer(branch));
+}
+
+// private
+// The accepted headers are the top count headers of the branch.
+code header_organizer::organize_branch(header_branch::ptr branch,
+    size_t count)
+{
+    if (stopped())
+        return error::service_stopped;
+
+    const auto work = branch->work();
+    uint256_t required_work;
+
+    // This stops before the height or at the work level, which ever is first.
+    if (!fast_chain_.get_work(required_work, work, branch->height(), true))
+        return error::operation_failed;
+
+    // Consensus.
+    if (work <= required_work)
+    {
+        // The accepted run (the top count headers) is pooled, so that later
+        // headers may extend it to sufficient work.
+        const auto headers = branch->headers();
+        const auto pooled = std::make_shared<header_const_ptr_list>(
+            headers->end() - count, headers->end());
+
+        pool_.add(pooled, branch->top_height() - count + 1u);
+        return error::insufficient_work;
+    }
+
+    return defer(branch);
+}
+
+// Group commit sub-sequence.
+//-----------------------------------------------------------------------------
+// A branch with sufficient work may be held for the commit latency so that
+// headers which extend it are written to the store (and notified) at once.
+// Deferred headers are not stored, so the store remains consistent.
+
+// private
+// A header that extends the deferred branch is accepted onto it, otherwise
+// the deferred branch is committed so that the store reflects it. A failed
+// commit is returned here (and thereafter), as the store lacks the branch.
+code header_organizer::get_branch(header_branch::ptr& out_branch,
+    header_const_ptr header)
+{
+    if (failure_)
+        return failure_;
+
+    if (pending_ && header->previous_block_hash() == pending_->top()->hash())
+    {
+        pending_->extend(header);
+        out_branch = pending_;
+        return error::success;
+    }
+
+    const auto error_code = flush();
+
+    if (error_code)
+        return error_code;
+
+    const auto start = asio::steady_clock::now();
+    out_branch = pool_.get_branch(header);
+
+    metrics_.record(stage_metrics::entity::header,
+        stage_metrics::stage::read, start);
+
+    return error::success;
+}
+
+// private
+code header_organizer::commit(header_branch::ptr branch)
+{
+    const auto start = asio::steady_clock::now();
+
     //#########################################################################
-    auto fork_point = branch->fork_point();
-    auto branch_headers = branch->headers();
-    const auto error_code = fast_chain_.reorganize(fork_point,
-        branch_headers);
+    const auto error_code = fast_chain_.reorganize(branch->fork_point(),
+        branch->headers());
     //#########################################################################
 
+    metrics_.record(stage_metrics::entity::header,
+        stage_metrics::stage::reorganize, start);
+
     if (error_code)
     {
         LOG_FATAL(LOG_BLOCKCHAIN)
-            << this_id
-            << " Failure writing header to store, is now corrupted: "
+            << "Failure writing headers to store, is now corrupted: "
             << error_code.message();
+    }
 
-        handler(error_code);
-        return;
+    return error_code;
+}
+
+// private
+code header_organizer::defer(header_branch::ptr branch)
+{
+    if (commit_latency_ == asio::duration::zero())
+        return commit(branch);
+
+    // The latency of the commit is bounded by the first deferred header.
+    if (!pending_)
+    {
+        timer_ = std::make_shared<deadline>(threads_, commit_latency_);
+        timer_->start(
+            std::bind(&header_organizer::handle_timer,
+                this, _1));
     }
 
-    handler(error_code);
+    pending_ = branch;
+    return error::success;
+}
+
+// private
+code header_organizer::flush()
+{
+    if (!pending_)
+        return error::success;
+
+    const auto branch = pending_;
+    const auto fork_point = branch->fork_point();
+    pending_.reset();
+    timer_->stop();
+    timer_.reset();
+
+    hash_digest hash;
+
+    // The fork point is popped if a block below it is invalidated.
+    if (!fast_chain_.get_block_hash(hash, fork_point.height(), true) ||
+        hash != fork_point.hash())
+    {
+        LOG_DEBUG(LOG_BLOCKCHAIN)
+            << "Deferred headers dropped, fork point [" << fork_point.height()
+            << "] is no longer a candidate.";
+        return error::success;
+    }
+
+    // Work is sufficient, as the candidate chain can only have been lowered.
+    // A failure is retained, so that each later organize call reports it.
+    failure_ = commit(branch);
+    return failure_;
+}
+
+// private
+void header_organizer::handle_timer(const code& ec)
+{
+    // The timer is stopped when the deferred branch is flushed.
+    if (ec || stopped())
+        return;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    const auto waited = metrics_.locks().waiting(
+        lock_metrics::site::header_flush);
+    mutex_.lock_high_priority();
+    metrics_.locks().acquired(lock_metrics::site::header_flush, waited);
+    const auto error_code = flush();
+    metrics_.locks().released(lock_metrics::site::header_flush);
+    mutex_.unlock_high_priority();
+    ///////////////////////////////////////////////////////////////////////////
+
+    // The failure is logged by commit and retained for the next organize.
+    if (error_code)
+        LOG_ERROR(LOG_BLOCKCHAIN)
+            << "Deferred headers were not committed, header organization "
+            << "is suspended: " << error_code.message();
 }
 
 } // namespace blockchain
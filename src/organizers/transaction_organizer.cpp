@@ -21,9 +21,11 @@
 #include <algorithm>
 #include <cstddef>
 #include <functional>
-#include <future>
 #include <memory>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/blockchain/define.hpp>
 #include <bitcoin/blockchain/interface/fast_chain.hpp>
@@ -39,14 +41,18 @@ using namespace std::placeholders;
 #define NAME "transaction_organizer"
 
 transaction_organizer::transaction_organizer(prioritized_mutex& mutex,
-    dispatcher& priority_dispatch, threadpool&, fast_chain& chain,
-    transaction_pool& pool, const settings& settings)
+    dispatcher& priority_dispatch, dispatcher& io_dispatch,
+    threadpool& threads, fast_chain& chain, stage_metrics& metrics,
+    transaction_pool& pool, script_cache& cache, const settings& settings)
   : fast_chain_(chain),
+    metrics_(metrics),
     mutex_(mutex),
     stopped_(true),
     settings_(settings),
     pool_(pool),
-    validator_(priority_dispatch, fast_chain_, settings)
+    script_cache_(cache),
+    validator_(priority_dispatch, io_dispatch, fast_chain_, cache, settings),
+    dispatch_(threads, NAME "_dispatch")
 {
     const auto this_id = boost::this_thread::get_id();
     LOG_VERBOSE(LOG_BLOCKCHAIN)
@@ -82,8 +88,10 @@ bool transaction_organizer::stop()
 
 // Organize sequence.
 //-----------------------------------------------------------------------------
-// This runs in single thread normal priority except for validation fan-outs.
-// Therefore fan-outs may use all threads in the priority threadpool.
+// This runs on the calling thread until validation fans out to the priority
+// pool, and calls may run concurrently. No thread waits on validation. Each
+// completion resumes on the network pool, since the store takes the validation
+// lock, which must never be awaited by a priority thread (required by blocks).
 
 // This is called from block_chain::organize.
 void transaction_organizer::organize(transaction_const_ptr tx,
@@ -105,64 +113,313 @@ void transaction_organizer::organize(transaction_const_ptr tx,
         return;
     }
 
-    // Critical Section
-    ///////////////////////////////////////////////////////////////////////////
-    mutex_.lock_low_priority();
-
-    if (stopped())
+    // The pool is thread safe, so duplicates are rejected before locking.
+    // This locates only unconfirmed transactions stored since startup.
+    // See symmetry with header memory pool.
+    // The tx is already memory pooled (nothing to do).
+    if (pool_.exists(tx))
     {
-        mutex_.unlock_low_priority();
-        //---------------------------------------------------------------------
-        handler(error::service_stopped);
+        handler(error::duplicate_transaction);
         return;
     }
 
-    // The pool is safe for filtering only, so protect by critical section.
-    // This locates only unconfirmed transactions discovered since startup.
-    const auto exists = pool_.exists(tx);
-
-    // See symmetry with header memory pool.
-    // The tx is already memory pooled (nothing to do).
-    if (exists)
+    if (stopped())
     {
-        mutex_.unlock_low_priority();
-        //---------------------------------------------------------------------
-        handler(error::duplicate_transaction);
+        handler(error::service_stopped);
         return;
     }
 
-    // Reset the reusable promise.
-    resume_ = std::promise<code>();
+    // Population and script verification run outside of the critical section
+    // so that independent transactions are validated concurrently. Only the
+    // final duplicate check and the store are serialized.
+    validate(tx, handler);
+}
 
+// private
+void transaction_organizer::validate(transaction_const_ptr tx,
+    result_handler handler)
+{
     const result_handler complete =
-        std::bind(&transaction_organizer::signal_completion,
-            this, _1);
+        std::bind(&transaction_organizer::resume,
+            this, _1, tx, handler);
 
     const auto accept_handler =
         std::bind(&transaction_organizer::handle_accept,
-            this, _1, tx, complete);
+            this, _1, tx, asio::steady_clock::now(), complete);
 
     // Checks that are dependent on chain state and prevouts.
     validator_.accept(tx, accept_handler);
+}
+
+// private
+// Completion is invoked on a priority thread, so continue on the network pool.
+void transaction_organizer::resume(const code& ec, transaction_const_ptr tx,
+    result_handler handler)
+{
+    dispatch_.concurrent(&transaction_organizer::handle_validated,
+        this, ec, tx, handler);
+}
+
+// private
+// The tx is validated against the chain state obtained in population, so it
+// must be validated again if a block has been confirmed in the interim.
+void transaction_organizer::handle_validated(const code& ec,
+    transaction_const_ptr tx, result_handler handler)
+{
+    if (ec)
+    {
+        handler(ec);
+        return;
+    }
+
+    code error_code;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    const auto waited = metrics_.locks().waiting(
+        lock_metrics::site::transaction_store);
+    mutex_.lock_low_priority();
+    metrics_.locks().acquired(lock_metrics::site::transaction_store, waited);
 
-    // Wait on completion signal.
-    // This is necessary in order to continue on a non-priority thread.
-    // If we do not wait on the original thread there may be none left.
-    error_code = resume_.get_future().get();
+    const auto current = (fast_chain_.next_confirmed_state() ==
+        tx->metadata.state);
 
+    if (current)
+    {
+        const auto start = asio::steady_clock::now();
+        error_code = store(tx);
+        metrics_.record(stage_metrics::entity::transaction,
+            stage_metrics::stage::candidate, start);
+    }
+
+    metrics_.locks().released(lock_metrics::site::transaction_store);
     mutex_.unlock_low_priority();
     ///////////////////////////////////////////////////////////////////////////
 
+    if (!current)
+    {
+        validate(tx, handler);
+        return;
+    }
+
     // Invoke caller handler outside of critical section.
     handler(error_code);
 }
 
+// Each generation spends only outputs of the store or of prior generations,
+// so each is populated and verified as one set and stored under one lock.
+void transaction_organizer::organize(transaction_const_ptr_list_const_ptr txs,
+    result_list_handler handler, uint64_t max_money)
+{
+    const auto count = txs->size();
+    const auto sequence = std::make_shared<set_sequence>();
+    auto& results = sequence->results;
+    results.resize(count);
+    sequence->txs = txs;
+    sequence->handler = handler;
+
+    std::unordered_map<hash_digest, size_t> positions;
+    positions.reserve(count);
+
+    if (stopped())
+    {
+        handler(error::service_stopped, results);
+        return;
+    }
+
+    // Checks that are independent of chain state, and duplicates.
+    for (size_t position = 0; position < count; ++position)
+    {
+        const auto& tx = (*txs)[position];
+
+        if (!positions.emplace(tx->hash(), position).second || pool_.exists(tx))
+            results[position] = error::duplicate_transaction;
+        else
+            results[position] = validator_.check(tx, max_money);
+    }
+
+    // Link each tx to the txs of the set that it spends.
+    auto& parents = sequence->parents;
+    auto& children = sequence->children;
+    parents.resize(count, 0);
+    children.resize(count);
+
+    for (size_t position = 0; position < count; ++position)
+    {
+        std::unordered_set<size_t> spent;
+
+        for (const auto& input: (*txs)[position]->inputs())
+        {
+            const auto it = positions.find(input.previous_output().hash());
+
+            if (it != positions.end() && it->second != position &&
+                spent.insert(it->second).second)
+            {
+                children[it->second].push_back(position);
+                ++parents[position];
+            }
+        }
+    }
+
+    for (size_t position = 0; position < count; ++position)
+        if (parents[position] == 0)
+            sequence->generation.push_back(position);
+
+    organize_generation(sequence);
+}
+
+// private
+// Generations without a checked tx are skipped, a failed parent leaves its
+// children without previous outputs.
+void transaction_organizer::organize_generation(set_sequence_ptr sequence)
+{
+    auto& generation = sequence->generation;
+
+    while (!generation.empty())
+    {
+        const auto incoming = std::make_shared<transaction_const_ptr_list>();
+        sequence->mapping.clear();
+
+        for (const auto position: generation)
+        {
+            if (!sequence->results[position])
+            {
+                incoming->push_back((*sequence->txs)[position]);
+                sequence->mapping.push_back(position);
+            }
+        }
+
+        if (!incoming->empty())
+        {
+            sequence->incoming = incoming;
+            sequence->outcomes = std::make_shared<
+                validate_transaction::result_list>(incoming->size());
+            validate(sequence);
+            return;
+        }
+
+        next_generation(*sequence);
+    }
+
+    // Invoke caller handler outside of critical section.
+    sequence->handler(error::success, sequence->results);
+}
+
 // private
-void transaction_organizer::signal_completion(const code& ec)
+void transaction_organizer::next_generation(set_sequence& sequence)
 {
-    // This must be protected so that it is properly cleared.
-    // Signal completion, which results in original handler invoke with code.
-    resume_.set_value(ec);
+    std::vector<size_t> next;
+
+    for (const auto position: sequence.generation)
+        for (const auto child: sequence.children[position])
+            if (--sequence.parents[child] == 0)
+                next.push_back(child);
+
+    sequence.generation.swap(next);
+}
+
+// private
+void transaction_organizer::validate(set_sequence_ptr sequence)
+{
+    const auto& outcomes = sequence->outcomes;
+    std::fill(outcomes->begin(), outcomes->end(), error::success);
+
+    const result_handler complete =
+        std::bind(&transaction_organizer::resume_set,
+            this, _1, sequence);
+
+    const auto accept_handler =
+        std::bind(&transaction_organizer::handle_accept_set,
+            this, _1, sequence->incoming, outcomes, complete);
+
+    // Checks that are dependent on chain state and prevouts.
+    validator_.accept(sequence->incoming, outcomes, accept_handler);
+}
+
+// private
+// Completion is invoked on a priority thread, so continue on the network pool.
+void transaction_organizer::resume_set(const code& ec,
+    set_sequence_ptr sequence)
+{
+    dispatch_.concurrent(&transaction_organizer::handle_validated_set,
+        this, ec, sequence);
+}
+
+// private
+void transaction_organizer::handle_validated_set(const code& ec,
+    set_sequence_ptr sequence)
+{
+    const auto& txs = sequence->incoming;
+    auto& outcomes = *sequence->outcomes;
+
+    if (ec)
+    {
+        std::fill(outcomes.begin(), outcomes.end(), ec);
+    }
+    else
+    {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        const auto waited = metrics_.locks().waiting(
+            lock_metrics::site::transaction_store);
+        mutex_.lock_low_priority();
+        metrics_.locks().acquired(lock_metrics::site::transaction_store,
+            waited);
+
+        // The set was populated against a single chain state.
+        const auto current = (fast_chain_.next_confirmed_state() ==
+            txs->front()->metadata.state);
+
+        for (size_t position = 0; current && position < txs->size();
+            ++position)
+        {
+            auto& result = outcomes[position];
+
+            if (!result)
+                result = store((*txs)[position]);
+        }
+
+        metrics_.locks().released(lock_metrics::site::transaction_store);
+        mutex_.unlock_low_priority();
+        ///////////////////////////////////////////////////////////////////////
+
+        if (!current)
+        {
+            validate(sequence);
+            return;
+        }
+    }
+
+    for (size_t index = 0; index < sequence->mapping.size(); ++index)
+        sequence->results[sequence->mapping[index]] = outcomes[index];
+
+    next_generation(*sequence);
+    organize_generation(sequence);
+}
+
+// private
+code transaction_organizer::store(transaction_const_ptr tx)
+{
+    if (stopped())
+        return error::service_stopped;
+
+    // A concurrently-validated duplicate may have been stored since the check.
+    if (pool_.exists(tx))
+        return error::duplicate_transaction;
+
+    // The store adds the tx to pool_, so that it is never pooled unstored.
+    //#########################################################################
+    const auto error_code = fast_chain_.store(tx);
+    //#########################################################################
+
+    if (error_code)
+    {
+        LOG_FATAL(LOG_BLOCKCHAIN)
+            << "Failure writing transaction to store, is now corrupted: "
+            << error_code.message();
+    }
+
+    return error_code;
 }
 
 // Verify sub-sequence.
@@ -170,8 +427,12 @@ void transaction_organizer::signal_completion(const code& ec)
 
 // private
 void transaction_organizer::handle_accept(const code& ec,
-    transaction_const_ptr tx, result_handler handler)
+    transaction_const_ptr tx, const asio::time_point& start,
+    result_handler handler)
 {
+    metrics_.record(stage_metrics::entity::transaction,
+        stage_metrics::stage::accept, start);
+
     // The tx may exist in the store in any state except confirmed or verified.
     // Either state implies that the tx exists and is valid for its context.
 
@@ -202,16 +463,40 @@ void transaction_organizer::handle_accept(const code& ec,
     }
 
     const auto connect_handler =
-        std::bind(&transaction_organizer::handle_connect,
-            this, _1, tx, handler);
+        std::bind(&transaction_organizer::handle_connected,
+            this, _1, asio::steady_clock::now(), handler);
 
     // Checks that include script metadata.
     validator_.connect(tx, connect_handler);
 }
 
+// private
+void transaction_organizer::handle_connected(const code& ec,
+    const asio::time_point& start, result_handler handler)
+{
+    metrics_.record(stage_metrics::entity::transaction,
+        stage_metrics::stage::connect, start);
+
+    handle_connect(ec, handler);
+}
+
 // private
 void transaction_organizer::handle_connect(const code& ec,
-    transaction_const_ptr tx, result_handler handler)
+    result_handler handler)
+{
+    if (stopped())
+    {
+        handler(error::service_stopped);
+        return;
+    }
+
+    handler(ec);
+}
+
+// private
+void transaction_organizer::handle_accept_set(const code& ec,
+    transaction_const_ptr_list_const_ptr txs,
+    validate_transaction::result_list_ptr results, result_handler handler)
 {
     if (stopped())
     {
@@ -225,22 +510,29 @@ void transaction_organizer::handle_connect(const code& ec,
         return;
     }
 
-    // TODO: add to pool_.
-    //#########################################################################
-    const auto error_code = fast_chain_.store(tx);
-    //#########################################################################
-
-    if (error_code)
+    for (size_t position = 0; position < txs->size(); ++position)
     {
-        LOG_FATAL(LOG_BLOCKCHAIN)
-            << "Failure writing transaction to store, is now corrupted: "
-            << error_code.message();
+        const auto& tx = (*txs)[position];
+        auto& result = (*results)[position];
 
-        handler(error_code);
-        return;
+        if (result)
+            continue;
+
+        // Policy.
+        if (tx->fees() < price(tx))
+            result = error::insufficient_fee;
+
+        // Policy.
+        else if (tx->is_dusty(settings_.minimum_output_satoshis))
+            result = error::dusty_transaction;
     }
 
-    handler(error_code);
+    const auto connect_handler =
+        std::bind(&transaction_organizer::handle_connect,
+            this, _1, handler);
+
+    // Checks that include script metadata.
+    validator_.connect(txs, results, connect_handler);
 }
 
 // Utility.
@@ -255,10 +547,12 @@ uint64_t transaction_organizer::price(transaction_const_ptr tx) const
     if (byte_fee == 0.0f && sigop_fee == 0.0f)
         return 0;
 
-    // TODO: this is a second pass on size and sigops, implement cache.
+    // TODO: this is a second pass on size, implement cache.
     // This at least prevents uncached calls when zero fee is configured.
+    // The sigop count is retained for the pool entry and block validation.
     auto byte = byte_fee > 0 ? byte_fee * tx->serialized_size(true) : 0;
-    auto sigop = sigop_fee > 0 ? sigop_fee * tx->signature_operations() : 0;
+    auto sigop = sigop_fee > 0 ? sigop_fee *
+        script_cache_.signature_operations(*tx) : 0;
 
     // Require at least one satoshi per tx if there are any fees configured.
     return std::max(uint64_t(1), static_cast<uint64_t>(byte + sigop));
@@ -0,0 +1,293 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/address_indexer.hpp>
+
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+// Catch-up reads are batched to this many blocks when the queue is unbounded.
+static constexpr size_t default_batch = 100;
+
+address_indexer::address_indexer(const boost::filesystem::path& file,
+    size_t limit, block_handler index_blocks,
+    transaction_handler index_transactions, fetch_handler fetch_block)
+  : file_(file),
+    limit_(limit),
+    index_blocks_(index_blocks),
+    index_transactions_(index_transactions),
+    fetch_block_(fetch_block),
+    stopped_(true),
+    height_(0)
+{
+}
+
+address_indexer::~address_indexer()
+{
+    stop();
+
+    // A thread stopped from itself cannot be joined by itself.
+    if (thread_.joinable())
+        thread_.detach();
+}
+
+// A store without a persisted height was indexed synchronously (or by the
+// prior asynchronous dispatch), so it is presumed indexed through the top.
+void address_indexer::start(size_t top)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (!stopped_)
+        return;
+
+    // A thread stopped from itself remains joinable once it has returned.
+    if (thread_.joinable())
+    {
+        auto prior = std::move(thread_);
+        lock.unlock();
+        prior.join();
+        lock.lock();
+    }
+
+    if (!read_height())
+    {
+        height_ = top;
+        write_height(top);
+    }
+
+    stopped_ = false;
+    thread_ = std::thread(&address_indexer::index, this, top);
+}
+
+void address_indexer::stop()
+{
+    std::thread thread;
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::unique_lock<std::mutex> lock(mutex_);
+    stopped_ = true;
+    blocks_.clear();
+    transactions_.clear();
+
+    if (thread_.joinable() && thread_.get_id() != std::this_thread::get_id())
+        thread = std::move(thread_);
+
+    lock.unlock();
+    ///////////////////////////////////////////////////////////////////////////
+
+    pushed_.notify_all();
+    popped_.notify_all();
+
+    if (thread.joinable())
+        thread.join();
+}
+
+size_t address_indexer::height() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return height_;
+}
+
+size_t address_indexer::size() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return blocks_.size() + transactions_.size();
+}
+
+bool address_indexer::push(block_const_ptr block, size_t height)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (!enqueue(lock))
+        return false;
+
+    blocks_.emplace_back(block, height);
+    lock.unlock();
+    pushed_.notify_one();
+    return true;
+}
+
+bool address_indexer::push(transaction_const_ptr tx)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (!enqueue(lock))
+        return false;
+
+    transactions_.push_back(tx);
+    lock.unlock();
+    pushed_.notify_one();
+    return true;
+}
+
+// private
+//-----------------------------------------------------------------------------
+
+// Backpressure holds the organizer until the indexer catches up, except where
+// the indexer itself pushes (it would otherwise wait on itself).
+bool address_indexer::enqueue(std::unique_lock<std::mutex>& lock)
+{
+    const auto self = thread_.get_id() == std::this_thread::get_id();
+
+    popped_.wait(lock, [&]()
+    {
+        return stopped_ || self || limit_ == 0 ||
+            blocks_.size() + transactions_.size() < limit_;
+    });
+
+    return !stopped_;
+}
+
+// Blocks above the persisted height are read from the store in batches.
+// A missing block implies the candidate chain has since been reorganized
+// below the top, so catch-up ends there and queued blocks follow.
+bool address_indexer::catch_up(size_t top)
+{
+    const auto batch = limit_ == 0 ? default_batch : limit_;
+    auto next = height() + 1;
+
+    while (next <= top)
+    {
+        block_const_ptr_list blocks;
+        blocks.reserve(batch);
+
+        for (; next <= top && blocks.size() < batch; ++next)
+        {
+            const auto block = fetch_block_(next);
+            if (!block)
+            {
+                top = next - 1;
+                break;
+            }
+
+            blocks.push_back(block);
+        }
+
+        if (blocks.empty())
+            break;
+
+        if (!index_blocks_(blocks))
+        {
+            stop();
+            return false;
+        }
+
+        // A batch completed before stop is persisted.
+        std::unique_lock<std::mutex> lock(mutex_);
+        height_ = next - 1;
+        write_height(height_);
+
+        if (stopped_)
+            return false;
+    }
+
+    return true;
+}
+
+// private
+bool address_indexer::read_height()
+{
+    boost::filesystem::ifstream in(file_);
+    size_t height;
+
+    if (!(in >> height))
+        return false;
+
+    height_ = height;
+    return true;
+}
+
+// private
+// The height is written to a temporary and then renamed over the prior, so
+// that an interrupted write does not lose the prior height.
+bool address_indexer::write_height(size_t height) const
+{
+    auto temporary = file_;
+    temporary += ".tmp";
+
+    {
+        boost::filesystem::ofstream out(temporary, std::ios::trunc);
+        if (!(out << height << std::endl))
+            return false;
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::rename(temporary, file_, ec);
+    return !ec;
+}
+
+// Each batch is all queued work, with blocks indexed before txs.
+void address_indexer::index(size_t top)
+{
+    if (!catch_up(top))
+        return;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true)
+    {
+        pushed_.wait(lock, [this]()
+        {
+            return stopped_ || !blocks_.empty() || !transactions_.empty();
+        });
+
+        if (stopped_)
+            return;
+
+        std::deque<std::pair<block_const_ptr, size_t>> queued;
+        transaction_const_ptr_list transactions;
+        queued.swap(blocks_);
+        transactions.swap(transactions_);
+        lock.unlock();
+        popped_.notify_all();
+
+        block_const_ptr_list blocks;
+        blocks.reserve(queued.size());
+
+        for (const auto& block: queued)
+            blocks.push_back(block.first);
+
+        if ((!blocks.empty() && !index_blocks_(blocks)) ||
+            (!transactions.empty() && !index_transactions_(transactions)))
+        {
+            stop();
+            return;
+        }
+
+        // A batch completed before stop is persisted.
+        lock.lock();
+
+        if (!queued.empty())
+        {
+            height_ = queued.back().second;
+            write_height(height_);
+        }
+    }
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
@@ -47,9 +47,13 @@ bool anchor_converter::visit(element_type element)
 
     auto parents = element->parents();
 
+    // severed edges may retain the element, so drop affected closures
+    state_.cached_child_closures.erase(element);
+
     // sever parent connections, enqueue child-less anchor parents
     for (auto& entry : parents)
     {
+        state_.cached_child_closures.erase(entry);
         entry->remove_child(element);
         if (entry->is_anchor() && entry->children().size() == 0)
             enqueue(entry);
@@ -60,26 +64,18 @@ bool anchor_converter::visit(element_type element)
         element->remove_child(i);
 
     // remove entry from template if present
-    auto template_member = state_.block_template.left.find(element);
-    if (template_member != state_.block_template.left.end())
+    if (state_.templated(element))
     {
-        if (max_removed_ < template_member->second)
-            max_removed_ = template_member->second;
-
-        state_.block_template_bytes -= template_member->first->size();
-        state_.block_template_sigops -= template_member->first->sigops();
-        state_.block_template.erase(
-            transaction_pool_state::prioritized_transactions::value_type(
-            template_member->first, template_member->second));
+        const auto value = state_.priority_of(element);
+        if (max_removed_ < value)
+            max_removed_ = value;
+
+        state_.deselect(element);
     }
 
     // remove entry from pool if no child will remain
     if (remove)
-    {
-        auto pool_member = state_.pool.left.find(element);
-        if (pool_member != state_.pool.left.end())
-            state_.pool.left.erase(pool_member);
-    }
+        state_.erase(element);
 
 	return true;
 }
@@ -93,7 +89,12 @@ anchor_converter::priority anchor_converter::demote()
 
 void anchor_converter::add_bounds(transaction_const_ptr tx)
 {
-	bounds_.insert({ tx->hash(), true });
+	add_bounds(tx->hash());
+}
+
+void anchor_converter::add_bounds(const hash_digest& digest)
+{
+	bounds_.insert({ digest, true });
 }
 
 bool anchor_converter::within_bounds(hash_digest digest)
@@ -0,0 +1,131 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/candidate_cache.hpp>
+
+#include <cstddef>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+// Allowance for block object, chain state and map node beyond serialization.
+static constexpr size_t entry_overhead = 1024;
+
+candidate_cache::candidate_cache(size_t maximum_megabytes)
+  : maximum_bytes_(maximum_megabytes * 1024u * 1024u),
+    bytes_(0)
+{
+}
+
+bool candidate_cache::disabled() const
+{
+    return maximum_bytes_ == 0;
+}
+
+size_t candidate_cache::size() const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return entries_.size();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+size_t candidate_cache::bytes() const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return bytes_;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void candidate_cache::add(block_const_ptr block)
+{
+    if (disabled())
+        return;
+
+    const auto state = block->header().metadata.state;
+    BITCOIN_ASSERT(state);
+
+    const auto height = state->height();
+    const auto bytes = block->serialized_size(true) + entry_overhead;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    // A block at the same height is a reorganized-out candidate, replace it.
+    const auto it = entries_.find(height);
+
+    if (it != entries_.end())
+    {
+        bytes_ -= it->second.bytes;
+        entries_.erase(it);
+    }
+
+    if (bytes_ + bytes > maximum_bytes_)
+        return;
+
+    entries_.emplace(height, entry{ block, bytes });
+    bytes_ += bytes;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+block_const_ptr candidate_cache::get(size_t height,
+    const hash_digest& hash) const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    const auto it = entries_.find(height);
+
+    if (it == entries_.end() || it->second.block->hash() != hash)
+        return {};
+
+    return it->second.block;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void candidate_cache::prune(size_t height)
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    const auto end = entries_.upper_bound(height);
+
+    for (auto it = entries_.begin(); it != end; ++it)
+        bytes_ -= it->second.bytes;
+
+    entries_.erase(entries_.begin(), end);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void candidate_cache::clear()
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    entries_.clear();
+    bytes_ = 0;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
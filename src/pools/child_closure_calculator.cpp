@@ -35,14 +35,8 @@ bool child_closure_calculator::visit(transaction_entry::ptr element)
     {
         // short circuit exploration by using the existing closure for
         // this child node
-        for (auto it : closure_point->second)
-        {
-            if (!has_encountered(it))
-            {
-                mark_encountered(it);
-                closure_.push_back(it);
-            }
-        }
+        for (const auto& it: closure_point->second)
+            mark_encountered(it);
     }
     else
     {
@@ -52,24 +46,32 @@ bool child_closure_calculator::visit(transaction_entry::ptr element)
             enqueue(it->second);
     }
 
-    closure_.push_back(element);
-
     return true;
 }
 
-transaction_entry::list child_closure_calculator::get_closure(transaction_entry::ptr tx)
+// The tx is not itself enqueued, so the encountered set is the closure.
+// A cached closure of the tx seeds the stack in place of its children.
+const transaction_entry::list& child_closure_calculator::get_closure(
+    transaction_entry::ptr tx)
 {
-    closure_.clear();
-
     if (tx != nullptr)
     {
-        auto children = tx->children();
-        for (auto it = children.left.begin(); it != children.left.end(); ++it)
-            enqueue(it->second);
+        const auto cached = state_.cached_child_closures.find(tx);
+        if (cached != state_.cached_child_closures.end())
+        {
+            for (const auto& it: cached->second)
+                enqueue(it);
+        }
+        else
+        {
+            const auto& children = tx->children().left;
+            for (auto it = children.begin(); it != children.end(); ++it)
+                enqueue(it->second);
+        }
     }
 
     evaluate();
-    return closure_;
+    return encountered();
 }
 
 } // namespace blockchain
@@ -28,6 +28,8 @@ conflicting_spend_remover::conflicting_spend_remover(
 {
 }
 
+// Removals are collected before any is erased or severed, so that each is
+// erased while its ancestors remain linked.
 bool conflicting_spend_remover::visit(element_type element)
 {
     auto& children = element->children().left;
@@ -36,43 +38,43 @@ bool conflicting_spend_remover::visit(element_type element)
     for (auto entry = children.begin(); entry != children.end(); ++entry)
         enqueue(entry->second);
 
-    element->remove_children();
-    auto parents = element->parents();
+    return true;
+}
+
+conflicting_spend_remover::priority conflicting_spend_remover::deconflict()
+{
+    max_removed_ = 0.0;
+    evaluate();
+    const auto& removals = encountered();
 
-    // sever parent connections, enqueue child-less anchor parents
-    for (auto& entry : parents)
+    // remove entries from pool and template (while ancestors remain linked)
+    for (const auto& element: removals)
     {
-        entry->remove_child(element);
-        if (entry->is_anchor() && entry->children().size() == 0)
-            enqueue(entry);
-    }
+        if (state_.templated(element))
+        {
+            const auto value = state_.priority_of(element);
+            if (max_removed_ < value)
+                max_removed_ = value;
+        }
 
-    // remove entry from pool and template
-    auto pool_member = state_.pool.left.find(element);
-    if (pool_member != state_.pool.left.end())
-        state_.pool.left.erase(pool_member);
+        state_.erase(element);
+    }
 
-    auto template_member = state_.block_template.left.find(element);
-    if (template_member != state_.block_template.left.end())
+    // sever connections, remove child-less anchor parents
+    for (const auto& element: removals)
     {
-        if (max_removed_ < template_member->second)
-            max_removed_ = template_member->second;
+        element->remove_children();
+        auto parents = element->parents();
 
-        state_.block_template_bytes -= template_member->first->size();
-        state_.block_template_sigops -= template_member->first->sigops();
-        state_.block_template.erase(
-            transaction_pool_state::prioritized_transactions::value_type(
-            template_member->first, template_member->second));
+        for (auto& entry: parents)
+        {
+            entry->remove_child(element);
+            if (entry->is_anchor() && entry->children().size() == 0)
+                state_.erase(entry);
+        }
     }
 
-    return true;
-}
-
-conflicting_spend_remover::priority conflicting_spend_remover::deconflict()
-{
-    max_removed_ = 0.0;
-    evaluate();
-	return max_removed_;
+    return max_removed_;
 }
 
 } // namespace blockchain
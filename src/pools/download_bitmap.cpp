@@ -0,0 +1,169 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/download_bitmap.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+static constexpr size_t word_bits = 64;
+
+download_bitmap::download_bitmap()
+  : base_(0), size_(0)
+{
+}
+
+size_t download_bitmap::base() const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return base_;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+size_t download_bitmap::top() const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return base_ + size_;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void download_bitmap::reset(size_t base_height)
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    base_ = base_height;
+    size_ = 0;
+    words_.clear();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void download_bitmap::push(bool downloadable)
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    if (size_ % word_bits == 0)
+        words_.push_back(0);
+
+    if (downloadable)
+        words_.back() |= uint64_t(1) << (size_ % word_bits);
+
+    ++size_;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void download_bitmap::pop(size_t height)
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    if (height < base_)
+    {
+        base_ = height;
+        size_ = 0;
+        words_.clear();
+        return;
+    }
+
+    const auto count = height - base_;
+
+    if (count >= size_)
+        return;
+
+    // Clear the bits of removed heights in the retained partial word.
+    size_ = count;
+    words_.resize((size_ + word_bits - 1u) / word_bits);
+
+    if (size_ % word_bits != 0)
+        words_.back() &= (uint64_t(1) << (size_ % word_bits)) - 1u;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void download_bitmap::clear(size_t height)
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    if (height <= base_ || height > base_ + size_)
+        return;
+
+    const auto position = height - base_ - 1u;
+    words_[position / word_bits] &= ~(uint64_t(1) << (position % word_bits));
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool download_bitmap::get(size_t height) const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+
+    if (height <= base_ || height > base_ + size_)
+        return false;
+
+    const auto position = height - base_ - 1u;
+    return ((words_[position / word_bits] >> (position % word_bits)) & 1u) != 0;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void download_bitmap::get(std::vector<size_t>& out_heights, size_t height,
+    size_t count) const
+{
+    out_heights.clear();
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+
+    auto position = height <= base_ ? 0 : height - base_ - 1u;
+
+    while (position < size_ && out_heights.size() < count)
+    {
+        const auto word = words_[position / word_bits] >>
+            (position % word_bits);
+
+        // Skip the remainder of a word without downloadable heights.
+        if (word == 0)
+        {
+            position = (position / word_bits + 1u) * word_bits;
+            continue;
+        }
+
+        if ((word & 1u) != 0)
+            out_heights.push_back(base_ + position + 1u);
+
+        ++position;
+    }
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
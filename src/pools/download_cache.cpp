@@ -0,0 +1,123 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/download_cache.hpp>
+
+#include <cstddef>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+download_cache::download_cache(size_t maximum_blocks)
+  : maximum_blocks_(maximum_blocks)
+{
+}
+
+size_t download_cache::capacity() const
+{
+    return maximum_blocks_;
+}
+
+size_t download_cache::size() const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return blocks_.size();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool download_cache::exists(const hash_digest& hash) const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return blocks_.find(hash) != blocks_.end();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void download_cache::add(block_const_ptr block)
+{
+    if (maximum_blocks_ == 0)
+        return;
+
+    const auto hash = block->hash();
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    // A redownload replaces the block but retains its original position.
+    if (!blocks_.emplace(hash, block).second)
+    {
+        blocks_[hash] = block;
+        return;
+    }
+
+    order_.push_back(hash);
+
+    // Taken blocks leave stale hashes in the order, which are skipped here.
+    while (blocks_.size() > maximum_blocks_ && !order_.empty())
+    {
+        blocks_.erase(order_.front());
+        order_.pop_front();
+    }
+
+    // Bound the order to the blocks so that stale hashes cannot accumulate.
+    if (order_.size() > 2u * maximum_blocks_)
+    {
+        std::deque<hash_digest> order;
+
+        for (const auto& hash: order_)
+            if (blocks_.find(hash) != blocks_.end())
+                order.push_back(hash);
+
+        order_.swap(order);
+    }
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+block_const_ptr download_cache::take(const hash_digest& hash)
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    const auto it = blocks_.find(hash);
+
+    if (it == blocks_.end())
+        return {};
+
+    const auto block = it->second;
+    blocks_.erase(it);
+    return block;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void download_cache::clear()
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    blocks_.clear();
+    order_.clear();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
@@ -0,0 +1,239 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/fee_estimator.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+using namespace bc::chain;
+
+// Each bucket is 10% above the preceding bucket.
+static constexpr double bucket_spacing = 1.1;
+
+// Counts halve over about 350 blocks (a little over two days).
+static constexpr double block_decay = 0.998;
+
+// The share of a bucket's txs that must confirm within the target.
+static constexpr double success_threshold = 0.85;
+
+// The (decayed) txs required before a bucket range is evaluated.
+static constexpr double minimum_samples = 2.0;
+
+fee_estimator::fee_estimator()
+{
+    for (auto& estimate: estimates_)
+        estimate.store(0, std::memory_order_relaxed);
+
+    for (auto& counts: confirmed_)
+        counts.fill(0.0);
+
+    for (auto& counts: failed_)
+        counts.fill(0.0);
+}
+
+void fee_estimator::add(transaction_const_ptr tx, size_t height)
+{
+    if (tx->is_coinbase())
+        return;
+
+    const entry value{ height, bucket(rate(*tx)) };
+    const auto hash = tx->hash();
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (entries_.emplace(hash, value).second)
+        heights_[height].push_back(hash);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// A tx confirmed in the first block at which it could confirm has a delay of
+// one, and is confirmed within every target. A tx of greater delay has been
+// counted as failed (by expire) for each target below its delay.
+void fee_estimator::confirm(block_const_ptr block, size_t height)
+{
+    const auto& txs = block->transactions();
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(mutex_);
+    decay();
+
+    for (auto tx = txs.begin(); tx != txs.end(); ++tx)
+    {
+        const auto it = entries_.find(tx->hash());
+
+        if (it == entries_.end())
+            continue;
+
+        const auto& value = it->second;
+        const auto delay = height < value.height ? size_t(1) :
+            height - value.height + 1u;
+
+        for (auto target = std::max(delay, size_t(1));
+            target <= maximum_target; ++target)
+            confirmed_[target][value.bucket] += 1.0;
+
+        entries_.erase(it);
+    }
+
+    expire(height);
+    update();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+uint64_t fee_estimator::estimate(size_t target_blocks) const
+{
+    const auto target = std::max(size_t(1),
+        std::min(target_blocks, maximum_target));
+
+    return estimates_[target].load(std::memory_order_relaxed);
+}
+
+size_t fee_estimator::size() const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// static
+uint64_t fee_estimator::rate(const transaction& tx)
+{
+    const auto size = std::max(tx.serialized_size(true), size_t(1));
+    return static_cast<uint64_t>(tx.fees() * 1000.0 / size);
+}
+
+// static
+size_t fee_estimator::bucket(uint64_t rate)
+{
+    if (rate <= minimum_rate)
+        return 0;
+
+    const auto offset = std::log(static_cast<double>(rate) / minimum_rate) /
+        std::log(bucket_spacing);
+
+    return std::min(static_cast<size_t>(offset), buckets - 1u);
+}
+
+// static
+uint64_t fee_estimator::lower_bound(size_t bucket)
+{
+    return static_cast<uint64_t>(std::ceil(minimum_rate *
+        std::pow(bucket_spacing, static_cast<double>(bucket))));
+}
+
+// private, call under mutex.
+void fee_estimator::decay()
+{
+    for (auto& counts: confirmed_)
+        for (auto& count: counts)
+            count *= block_decay;
+
+    for (auto& counts: failed_)
+        for (auto& count: counts)
+            count *= block_decay;
+}
+
+// private, call under mutex.
+// Txs first confirmable at (height + 1 - target) are unconfirmed at the age of
+// target blocks, and are untracked once unconfirmed at the largest target.
+void fee_estimator::expire(size_t height)
+{
+    for (size_t target = 1; target <= maximum_target; ++target)
+    {
+        if (height + 1u < target)
+            break;
+
+        const auto it = heights_.find(height + 1u - target);
+
+        if (it == heights_.end())
+            continue;
+
+        for (const auto& hash: it->second)
+        {
+            const auto found = entries_.find(hash);
+
+            if (found != entries_.end())
+                failed_[target][found->second.bucket] += 1.0;
+        }
+    }
+
+    // Heights at or below the largest target age are no longer tracked.
+    const auto floor = floor_subtract(height + 1u, maximum_target);
+
+    while (!heights_.empty() && heights_.begin()->first <= floor)
+    {
+        for (const auto& hash: heights_.begin()->second)
+            entries_.erase(hash);
+
+        heights_.erase(heights_.begin());
+    }
+}
+
+// private, call under mutex.
+// Buckets are accumulated from the highest feerate down, and each range that
+// reaches the sample minimum must meet the threshold for the estimate to be
+// lowered to it. A larger target is never estimated above a smaller one.
+void fee_estimator::update()
+{
+    uint64_t previous = 0;
+
+    for (size_t target = 1; target <= maximum_target; ++target)
+    {
+        uint64_t value = 0;
+        auto confirmed = 0.0;
+        auto total = 0.0;
+
+        for (auto index = buckets; index-- > 0;)
+        {
+            confirmed += confirmed_[target][index];
+            total += confirmed_[target][index] + failed_[target][index];
+
+            if (total < minimum_samples)
+                continue;
+
+            if (confirmed / total < success_threshold)
+                break;
+
+            value = lower_bound(index);
+            confirmed = 0.0;
+            total = 0.0;
+        }
+
+        if (previous != 0 && (value == 0 || value > previous))
+            value = previous;
+
+        estimates_[target].store(value, std::memory_order_relaxed);
+        previous = value;
+    }
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
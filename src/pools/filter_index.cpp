@@ -0,0 +1,547 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/filter_index.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <iterator>
+#include <set>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+using namespace bc::chain;
+using namespace bc::machine;
+
+// BIP158 basic filter parameters (P and M).
+const uint8_t filter_index::rice_bits = 19;
+const uint64_t filter_index::false_positive_rate = 784931;
+
+// Each record is the block hash, filter header, filter size and filter.
+static constexpr size_t record_prefix = 2u * hash_size + sizeof(uint32_t);
+
+// The high 64 bits of the 128 bit product (portable, no 128 bit type).
+static uint64_t multiply_high(uint64_t left, uint64_t right)
+{
+    const uint64_t left_low = left & max_uint32;
+    const uint64_t left_high = left >> 32;
+    const uint64_t right_low = right & max_uint32;
+    const uint64_t right_high = right >> 32;
+
+    const auto low_low = left_low * right_low;
+    const auto high_low = left_high * right_low;
+    const auto low_high = left_low * right_high;
+    const auto high_high = left_high * right_high;
+
+    const auto middle = (low_low >> 32) + (high_low & max_uint32) +
+        (low_high & max_uint32);
+
+    return high_high + (high_low >> 32) + (low_high >> 32) + (middle >> 32);
+}
+
+// The siphash key is the first 16 bytes of the block hash.
+static half_hash to_key(const hash_digest& block_hash)
+{
+    half_hash key;
+    std::copy_n(block_hash.begin(), key.size(), key.begin());
+    return key;
+}
+
+// Items are mapped uniformly to [0, range) without modulo bias.
+static uint64_t to_range(const half_hash& key, const data_chunk& item,
+    uint64_t range)
+{
+    return multiply_high(siphash(key, item), range);
+}
+
+// The element count prefix size, zero if the filter is truncated.
+static size_t read_count(uint64_t& out_count, const data_chunk& filter)
+{
+    if (filter.empty())
+        return 0;
+
+    const auto prefix = filter.front();
+    const size_t size = prefix < 0xfd ? 1 : prefix == 0xfd ? 3 :
+        prefix == 0xfe ? 5 : 9;
+
+    if (filter.size() < size)
+        return 0;
+
+    if (size == 1)
+    {
+        out_count = prefix;
+        return size;
+    }
+
+    out_count = 0;
+    for (size_t byte = 1; byte < size; ++byte)
+        out_count |= uint64_t(filter[byte]) << (8 * (byte - 1u));
+
+    return size;
+}
+
+// Golomb-Rice coding: quotient in unary, remainder in rice_bits, msb first.
+class rice_writer
+{
+public:
+    rice_writer(data_chunk& out)
+      : out_(out), bits_(0)
+    {
+    }
+
+    void write(uint64_t delta)
+    {
+        for (auto quotient = delta >> filter_index::rice_bits; quotient > 0;
+            --quotient)
+            write_bit(true);
+
+        write_bit(false);
+
+        for (auto bit = filter_index::rice_bits; bit > 0; --bit)
+            write_bit(((delta >> (bit - 1u)) & 1u) != 0);
+    }
+
+private:
+    void write_bit(bool value)
+    {
+        if (bits_ % byte_bits == 0)
+            out_.push_back(0);
+
+        if (value)
+            out_.back() |= (0x80 >> (bits_ % byte_bits));
+
+        ++bits_;
+    }
+
+    data_chunk& out_;
+    size_t bits_;
+};
+
+class rice_reader
+{
+public:
+    rice_reader(const data_chunk& in, size_t offset)
+      : in_(in), bit_(offset * byte_bits)
+    {
+    }
+
+    bool read(uint64_t& out_delta)
+    {
+        bool value;
+        uint64_t quotient = 0;
+
+        while (true)
+        {
+            if (!read_bit(value))
+                return false;
+
+            if (!value)
+                break;
+
+            ++quotient;
+        }
+
+        out_delta = quotient << filter_index::rice_bits;
+
+        for (auto bit = filter_index::rice_bits; bit > 0; --bit)
+        {
+            if (!read_bit(value))
+                return false;
+
+            out_delta |= uint64_t(value ? 1 : 0) << (bit - 1u);
+        }
+
+        return true;
+    }
+
+private:
+    bool read_bit(bool& out_value)
+    {
+        if (bit_ >= in_.size() * byte_bits)
+        {
+            out_value = false;
+            return false;
+        }
+
+        out_value = ((in_[bit_ / byte_bits] >> (7u - bit_ % byte_bits)) &
+            1u) != 0;
+        ++bit_;
+        return true;
+    }
+
+    const data_chunk& in_;
+    size_t bit_;
+};
+
+filter_index::filter_index(const boost::filesystem::path& file)
+  : file_(file), end_(0)
+{
+}
+
+bool filter_index::disabled() const
+{
+    return file_.empty();
+}
+
+// A partial last record (interrupted write) is discarded.
+bool filter_index::start()
+{
+    if (disabled())
+        return true;
+
+    boost::system::error_code ec;
+    const auto exists = boost::filesystem::exists(file_, ec);
+    const auto file_size = exists ? boost::filesystem::file_size(file_, ec) :
+        uintmax_t(0);
+
+    if (ec)
+        return false;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    entries_.clear();
+    end_ = 0;
+
+    {
+        data_chunk prefix(record_prefix);
+        boost::filesystem::ifstream in(file_, std::ios::binary);
+
+        while (in.read(reinterpret_cast<char*>(prefix.data()), prefix.size()))
+        {
+            data_source istream(prefix);
+            istream_reader source(istream);
+
+            entry value;
+            value.hash = source.read_hash();
+            value.header = source.read_hash();
+            value.size = source.read_4_bytes_little_endian();
+            value.offset = end_ + record_prefix;
+
+            if (value.offset + value.size > file_size ||
+                !in.seekg(value.size, std::ios::cur))
+                break;
+
+            entries_.push_back(value);
+            end_ = value.offset + value.size;
+        }
+    }
+
+    if (exists && end_ != file_size)
+    {
+        boost::filesystem::resize_file(file_, end_, ec);
+
+        if (ec)
+            return false;
+    }
+
+    return open();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void filter_index::stop()
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    stream_.close();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+size_t filter_index::size() const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return entries_.size();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool filter_index::push(const block& block, size_t height)
+{
+    if (disabled())
+        return true;
+
+    // The filter is computed and serialized outside of the critical section.
+    data_chunk filter;
+    if (!compute(filter, block))
+        return false;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    if (!stream_.is_open() || height > entries_.size())
+        return false;
+
+    if (height < entries_.size() && !truncate(height))
+        return false;
+
+    const auto& previous = entries_.empty() ? null_hash :
+        entries_.back().header;
+
+    entry value;
+    value.hash = block.hash();
+    value.header = to_header(filter, previous);
+    value.offset = end_ + record_prefix;
+    value.size = static_cast<uint32_t>(filter.size());
+
+    data_chunk record;
+    record.reserve(record_prefix + filter.size());
+
+    {
+        data_sink ostream(record);
+        ostream_writer sink(ostream);
+        sink.write_hash(value.hash);
+        sink.write_hash(value.header);
+        sink.write_4_bytes_little_endian(value.size);
+        sink.write_bytes(filter);
+        ostream.flush();
+    }
+
+    // A failed write is truncated, so the file remains a sequence of records.
+    if (!stream_.write(reinterpret_cast<const char*>(record.data()),
+        record.size()) || !stream_.flush())
+    {
+        truncate(entries_.size());
+        return false;
+    }
+
+    entries_.push_back(value);
+    end_ += record.size();
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool filter_index::pop(size_t height)
+{
+    if (disabled())
+        return true;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    if (!stream_.is_open())
+        return false;
+
+    return height + 1u >= entries_.size() || truncate(height + 1u);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool filter_index::get_hash(hash_digest& out_hash, size_t height) const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+
+    if (height >= entries_.size())
+        return false;
+
+    out_hash = entries_[height].hash;
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool filter_index::get_filter(data_chunk& out_filter, hash_digest& out_hash,
+    size_t height) const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+
+    if (height >= entries_.size())
+        return false;
+
+    const auto& value = entries_[height];
+    boost::filesystem::ifstream in(file_, std::ios::binary);
+    out_filter.resize(value.size);
+    out_hash = value.hash;
+
+    return in.seekg(value.offset) && in.read(
+        reinterpret_cast<char*>(out_filter.data()), out_filter.size());
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool filter_index::get_headers(hash_list& out_headers,
+    hash_digest& out_stop_hash, size_t height, size_t count) const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+
+    if (height >= entries_.size() || count == 0)
+        return false;
+
+    const auto end = height + std::min(count, entries_.size() - height);
+    out_headers.clear();
+    out_headers.reserve(end - height);
+
+    for (auto index = height; index < end; ++index)
+        out_headers.push_back(entries_[index].header);
+
+    out_stop_hash = entries_[end - 1u].hash;
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// static
+// Items are output scripts (excluding empty and null data) and the scripts of
+// previous outputs spent by the block (excluding coinbase), deduplicated.
+bool filter_index::compute(data_chunk& out_filter, const block& block)
+{
+    std::set<data_chunk> items;
+    const auto& txs = block.transactions();
+    const auto null_data = static_cast<uint8_t>(opcode::return_);
+
+    for (const auto& tx: txs)
+    {
+        for (const auto& output: tx.outputs())
+        {
+            auto script = output.script().to_data(false);
+
+            if (!script.empty() && script.front() != null_data)
+                items.insert(std::move(script));
+        }
+    }
+
+    // Must skip coinbase as it does not spend a previous output.
+    for (auto tx = txs.empty() ? txs.end() : std::next(txs.begin());
+        tx != txs.end(); ++tx)
+    {
+        for (const auto& input: tx->inputs())
+        {
+            const auto& prevout = input.previous_output().metadata.cache;
+
+            if (!prevout.is_valid())
+                return false;
+
+            auto script = prevout.script().to_data(false);
+
+            if (!script.empty())
+                items.insert(std::move(script));
+        }
+    }
+
+    const auto count = static_cast<uint64_t>(items.size());
+    const auto range = count * false_positive_rate;
+    const auto key = to_key(block.hash());
+
+    std::vector<uint64_t> values;
+    values.reserve(items.size());
+
+    for (const auto& item: items)
+        values.push_back(to_range(key, item, range));
+
+    std::sort(values.begin(), values.end());
+    out_filter.clear();
+
+    {
+        data_sink ostream(out_filter);
+        ostream_writer sink(ostream);
+        sink.write_variable_little_endian(count);
+        ostream.flush();
+    }
+
+    uint64_t last = 0;
+    rice_writer writer(out_filter);
+
+    for (const auto value: values)
+    {
+        writer.write(value - last);
+        last = value;
+    }
+
+    return true;
+}
+
+// static
+hash_digest filter_index::to_header(const data_chunk& filter,
+    const hash_digest& previous)
+{
+    return bitcoin_hash(build_chunk({ bitcoin_hash(filter), previous }));
+}
+
+// static
+bool filter_index::match(const data_chunk& filter,
+    const hash_digest& block_hash, const data_chunk& item)
+{
+    uint64_t count;
+    const auto offset = read_count(count, filter);
+
+    if (offset == 0 || count == 0)
+        return false;
+
+    const auto target = to_range(to_key(block_hash), item,
+        count * false_positive_rate);
+
+    uint64_t value = 0;
+    rice_reader reader(filter, offset);
+
+    for (uint64_t index = 0; index < count; ++index)
+    {
+        uint64_t delta;
+
+        if (!reader.read(delta))
+            return false;
+
+        value += delta;
+
+        if (value >= target)
+            return value == target;
+    }
+
+    return false;
+}
+
+// private, call under mutex.
+bool filter_index::open()
+{
+    stream_.open(file_, std::ios::binary | std::ios::app);
+    return stream_.is_open();
+}
+
+// private, call under mutex.
+// Retain the blocks below the height, reopening the file for append.
+bool filter_index::truncate(size_t height)
+{
+    const auto end = height < entries_.size() ?
+        entries_[height].offset - record_prefix : end_;
+
+    stream_.close();
+    boost::system::error_code ec;
+    boost::filesystem::resize_file(file_, end, ec);
+    const auto opened = open();
+
+    if (ec || !opened)
+        return false;
+
+    entries_.resize(height);
+    end_ = end;
+    return true;
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
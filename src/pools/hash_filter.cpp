@@ -0,0 +1,104 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/hash_filter.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+// A block is one 64 byte cache line of eight words.
+static constexpr size_t block_words = 8;
+static constexpr size_t block_bytes = block_words * sizeof(uint64_t);
+
+// Each hash sets one bit in each word of its block.
+static constexpr size_t bit_count = block_words;
+
+hash_filter::hash_filter(size_t maximum_megabytes)
+  : blocks_(maximum_megabytes * 1024u * 1024u / block_bytes),
+    words_(blocks_ == 0 ? nullptr : new word[blocks_ * block_words]),
+    complete_(false)
+{
+    for (size_t index = 0; index < blocks_ * block_words; ++index)
+        words_[index].store(0, std::memory_order_relaxed);
+}
+
+bool hash_filter::disabled() const
+{
+    return blocks_ == 0;
+}
+
+bool hash_filter::complete() const
+{
+    return !disabled() && complete_.load();
+}
+
+void hash_filter::set_complete()
+{
+    complete_.store(true);
+}
+
+void hash_filter::insert(const hash_digest& hash)
+{
+    if (disabled())
+        return;
+
+    const auto first = block(hash) * block_words;
+
+    // Bytes 8 through 15 select one of 64 bits in each word of the block.
+    for (size_t bit = 0; bit < bit_count; ++bit)
+        words_[first + bit].fetch_or(uint64_t(1) << (hash[8 + bit] & 0x3f),
+            std::memory_order_relaxed);
+}
+
+bool hash_filter::contains(const hash_digest& hash) const
+{
+    if (disabled())
+        return true;
+
+    const auto first = block(hash) * block_words;
+
+    for (size_t bit = 0; bit < bit_count; ++bit)
+    {
+        const auto mask = uint64_t(1) << (hash[8 + bit] & 0x3f);
+
+        if ((words_[first + bit].load(std::memory_order_relaxed) & mask) == 0)
+            return false;
+    }
+
+    return true;
+}
+
+// private
+// Bytes 0 through 7 select the block.
+size_t hash_filter::block(const hash_digest& hash) const
+{
+    uint64_t value = 0;
+
+    for (size_t byte = 0; byte < sizeof(uint64_t); ++byte)
+        value = (value << 8) | hash[byte];
+
+    return static_cast<size_t>(value % blocks_);
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
@@ -0,0 +1,117 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/hash_index.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+// Modification copies at most one chunk (32KB) plus the chunk pointers.
+static constexpr size_t chunk_size = 1024;
+
+hash_index::snapshot::snapshot()
+  : version_(0), size_(0)
+{
+}
+
+size_t hash_index::snapshot::version() const
+{
+    return version_;
+}
+
+size_t hash_index::snapshot::size() const
+{
+    return size_;
+}
+
+bool hash_index::snapshot::get(hash_digest& out_hash, size_t height) const
+{
+    if (height >= size_)
+        return false;
+
+    out_hash = (*chunks_[height / chunk_size])[height % chunk_size];
+    return true;
+}
+
+hash_index::hash_index()
+  : snapshot_(std::make_shared<const snapshot>())
+{
+}
+
+hash_index::snapshot::ptr hash_index::get() const
+{
+    return snapshot_.load();
+}
+
+void hash_index::update(size_t first_height, const hash_list& hashes)
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    const auto current = snapshot_.load();
+    BITCOIN_ASSERT(first_height <= current->size_);
+
+    const auto next = std::make_shared<snapshot>();
+    const auto keep = std::min(first_height, current->size_);
+    const auto whole = keep / chunk_size;
+    const auto part = keep % chunk_size;
+
+    // Whole chunks below the first height are shared with the current view.
+    next->version_ = current->version_ + 1u;
+    next->size_ = keep + hashes.size();
+    next->chunks_.reserve((next->size_ + chunk_size - 1u) / chunk_size);
+    next->chunks_.assign(current->chunks_.begin(),
+        current->chunks_.begin() + whole);
+
+    auto tail = std::make_shared<chunk>();
+    tail->reserve(chunk_size);
+
+    // The partially-retained chunk is copied for modification.
+    if (part != 0)
+    {
+        const auto& partial = *current->chunks_[whole];
+        tail->assign(partial.begin(), partial.begin() + part);
+    }
+
+    for (const auto& hash: hashes)
+    {
+        tail->push_back(hash);
+
+        if (tail->size() == chunk_size)
+        {
+            next->chunks_.push_back(tail);
+            tail = std::make_shared<chunk>();
+            tail->reserve(chunk_size);
+        }
+    }
+
+    if (!tail->empty())
+        next->chunks_.push_back(tail);
+
+    snapshot_.store(next);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
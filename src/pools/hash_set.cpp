@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/hash_set.hpp>
+
+#include <cstddef>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+const size_t hash_set::shard_count;
+
+hash_set::hash_set()
+  : size_(0)
+{
+}
+
+size_t hash_set::size() const
+{
+    return size_.load();
+}
+
+// private
+// The last byte is used, as the leading bytes key the shard's own buckets.
+hash_set::shard& hash_set::get_shard(const hash_digest& hash)
+{
+    return shards_[hash.back() % shard_count];
+}
+
+// private
+const hash_set::shard& hash_set::get_shard(const hash_digest& hash) const
+{
+    return shards_[hash.back() % shard_count];
+}
+
+bool hash_set::contains(const hash_digest& hash) const
+{
+    const auto& shard = get_shard(hash);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(shard.mutex);
+    return shard.hashes.find(hash) != shard.hashes.end();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool hash_set::insert(const hash_digest& hash)
+{
+    auto& shard = get_shard(hash);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(shard.mutex);
+
+    if (!shard.hashes.insert(hash).second)
+        return false;
+
+    ++size_;
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool hash_set::erase(const hash_digest& hash)
+{
+    auto& shard = get_shard(hash);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(shard.mutex);
+
+    if (shard.hashes.erase(hash) == 0)
+        return false;
+
+    --size_;
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void hash_set::clear()
+{
+    for (auto& shard: shards_)
+    {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        unique_lock lock(shard.mutex);
+        size_ -= shard.hashes.size();
+        shard.hashes.clear();
+        ///////////////////////////////////////////////////////////////////////
+    }
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
@@ -0,0 +1,269 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/header_array.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/interprocess/exceptions.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+using namespace bc::chain;
+
+const size_t header_array::header_size = 80;
+
+// The little-endian count of mapped headers precedes the headers.
+static constexpr size_t count_size = sizeof(uint64_t);
+
+// The file is grown (and remapped) by this number of headers.
+static constexpr size_t growth = 65536;
+
+header_array::header_array(const boost::filesystem::path& file)
+  : file_(file), failed_(false), count_(0), capacity_(0)
+{
+}
+
+bool header_array::disabled() const
+{
+    return file_.empty();
+}
+
+// A new file is zero filled, so its count is zero.
+bool header_array::start()
+{
+    if (disabled())
+        return true;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    failed_ = false;
+    count_ = 0;
+
+    boost::system::error_code ec;
+    if (!boost::filesystem::exists(file_, ec))
+    {
+        boost::filesystem::ofstream out(file_, std::ios::binary);
+
+        if (!out)
+            return false;
+    }
+
+    const auto file_size = boost::filesystem::file_size(file_, ec);
+
+    if (ec)
+        return false;
+
+    if (file_size < count_size + header_size)
+    {
+        boost::filesystem::resize_file(file_,
+            count_size + growth * header_size, ec);
+
+        if (ec)
+            return false;
+    }
+
+    if (!map())
+        return false;
+
+    uint64_t count = 0;
+    const auto data = static_cast<const uint8_t*>(region_.get_address());
+
+    for (size_t byte = 0; byte < count_size; ++byte)
+        count |= uint64_t(data[byte]) << (8 * byte);
+
+    count_ = static_cast<size_t>(std::min(count, uint64_t(capacity_)));
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void header_array::stop()
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    if (region_.get_address() == nullptr)
+        return;
+
+    region_.flush();
+    boost::interprocess::mapped_region unmapped;
+    region_.swap(unmapped);
+    capacity_ = 0;
+    count_ = 0;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+size_t header_array::size() const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return count_;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool header_array::push(const header& header)
+{
+    if (disabled())
+        return true;
+
+    // The header is serialized outside of the critical section.
+    const auto data = header.to_data();
+    BITCOIN_ASSERT(data.size() == header_size);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    if (failed_ || region_.get_address() == nullptr)
+        return false;
+
+    if (count_ == capacity_ && !grow())
+    {
+        failed_ = true;
+        return false;
+    }
+
+    const auto base = static_cast<uint8_t*>(region_.get_address());
+    std::copy(data.begin(), data.end(),
+        base + count_size + count_ * header_size);
+
+    ++count_;
+    write_count();
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void header_array::pop(size_t height)
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    if (region_.get_address() == nullptr || height + 1u >= count_)
+        return;
+
+    count_ = height + 1u;
+    write_count();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void header_array::clear()
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    if (region_.get_address() == nullptr)
+        return;
+
+    count_ = 0;
+    write_count();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool header_array::get(header& out_header, size_t height) const
+{
+    data_chunk data;
+
+    if (!get(data, height, height + 1u))
+        return false;
+
+    data_source istream(data);
+    istream_reader source(istream);
+    return out_header.from_data(source);
+}
+
+bool header_array::get(data_chunk& out_data, size_t begin, size_t end) const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+
+    // A read racing stop finds the region unmapped (and the count reset).
+    const auto address = region_.get_address();
+
+    if (failed_ || address == nullptr || begin >= end || end > count_)
+        return false;
+
+    const auto base = static_cast<const uint8_t*>(address) + count_size;
+
+    out_data.assign(base + begin * header_size, base + end * header_size);
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// private, call under mutex.
+bool header_array::map()
+{
+    capacity_ = 0;
+
+    try
+    {
+        using namespace boost::interprocess;
+        const file_mapping mapping(file_.string().c_str(), read_write);
+        mapped_region region(mapping, read_write);
+        region_.swap(region);
+    }
+    catch (const boost::interprocess::interprocess_exception&)
+    {
+        return false;
+    }
+
+    capacity_ = (region_.get_size() - count_size) / header_size;
+    return true;
+}
+
+// private, call under mutex.
+// The prior region is unmapped before the file is resized.
+bool header_array::grow()
+{
+    {
+        boost::interprocess::mapped_region unmapped;
+        region_.swap(unmapped);
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::resize_file(file_,
+        count_size + (capacity_ + growth) * header_size, ec);
+
+    return !ec && map();
+}
+
+// private, call under mutex.
+void header_array::write_count()
+{
+    const auto data = static_cast<uint8_t*>(region_.get_address());
+    const auto count = static_cast<uint64_t>(count_);
+
+    for (size_t byte = 0; byte < count_size; ++byte)
+        data[byte] = static_cast<uint8_t>(count >> (8 * byte));
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
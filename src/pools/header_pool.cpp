@@ -20,6 +20,8 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <iterator>
 #include <memory>
 #include <utility>
@@ -29,23 +31,109 @@
 namespace libbitcoin {
 namespace blockchain {
 
-using namespace boost;
+// The slot table is sized to a power of two, at most half full.
+static constexpr size_t minimum_slots = 64;
 
-header_pool::header_pool(size_t maximum_depth)
-  : maximum_depth_(maximum_depth == 0 ? max_size_t : maximum_depth)
+// Roots are bucketed by height modulo the ring size (a power of two).
+static constexpr size_t ring_size = 1024;
+static constexpr size_t ring_mask = ring_size - 1u;
+
+// Block hashes are uniformly distributed in their low order bytes.
+inline size_t slot_key(const hash_digest& hash)
+{
+    uint64_t key;
+    std::memcpy(&key, hash.data(), sizeof(key));
+    return static_cast<size_t>(key);
+}
+
+const header_pool::link header_pool::null_link;
+
+header_pool::header_pool(size_t maximum_depth, size_t maximum_megabytes)
+  : maximum_depth_(maximum_depth == 0 ? max_size_t : maximum_depth),
+    maximum_bytes_(maximum_megabytes == 0 ? max_size_t :
+        maximum_megabytes * 1024u * 1024u),
+    count_(0),
+    headers_(0),
+    floor_(max_size_t),
+    roots_(ring_size)
 {
 }
 
 size_t header_pool::size() const
 {
-    return headers_.size();
+    return count_;
+}
+
+// Header objects are counted, but not their shared pointer control blocks.
+size_t header_pool::memory() const
+{
+    auto bytes = slots_.capacity() * sizeof(link) +
+        nodes_.capacity() * sizeof(node) +
+        recycled_.capacity() * sizeof(link) +
+        headers_ * sizeof(message::header);
+
+    for (const auto& bucket: roots_)
+        bytes += bucket.capacity() * sizeof(link);
+
+    return bytes;
+}
+
+// protected
+// The bytes of live nodes and headers, excluding reserved capacity.
+size_t header_pool::bytes() const
+{
+    return count_ * sizeof(node) + headers_ * sizeof(message::header);
+}
+
+// protected
+bool header_pool::live(link item) const
+{
+    return nodes_[item].origin != null_link;
+}
+
+// protected
+// A leaf header is shared, otherwise the header is rebuilt from its record.
+header_const_ptr header_pool::materialize(link item) const
+{
+    const auto& entry = nodes_[item];
+
+    if (entry.header)
+        return entry.header;
+
+    const auto& value = entry.value;
+    const auto header = std::make_shared<const message::header>(chain::header
+    {
+        value.version, value.previous_block_hash, value.merkle_root,
+        value.timestamp, value.bits, value.nonce
+    });
+
+    // The store requires the median time past of each reorganized header.
+    header->metadata.median_time_past = entry.median_time_past;
+    return header;
+}
+
+// protected
+header_pool::link header_pool::find(const hash_digest& hash) const
+{
+    if (slots_.empty())
+        return null_link;
+
+    const auto mask = slots_.size() - 1u;
+
+    // This terminates because the table is never full.
+    for (auto slot = slot_key(hash) & mask;; slot = (slot + 1u) & mask)
+    {
+        const auto item = slots_[slot];
+
+        if (item == null_link || nodes_[item].hash == hash)
+            return item;
+    }
 }
 
 // protected
 bool header_pool::exists(const hash_digest& hash) const
 {
-    const auto& left = headers_.left;
-    return left.find(header_entry{ hash }) != left.end();
+    return find(hash) != null_link;
 }
 
 bool header_pool::exists(header_const_ptr candidate_header) const
@@ -55,6 +143,196 @@ bool header_pool::exists(header_const_ptr candidate_header) const
     return exists(candidate_header->hash());
 }
 
+// protected
+void header_pool::place(link item)
+{
+    const auto mask = slots_.size() - 1u;
+    auto slot = slot_key(nodes_[item].hash) & mask;
+
+    while (slots_[slot] != null_link)
+        slot = (slot + 1u) & mask;
+
+    slots_[slot] = item;
+}
+
+// protected
+// Double the slot table when adding a node would make it more than half full.
+void header_pool::reserve()
+{
+    if ((count_ + 1u) * 2u <= slots_.size())
+        return;
+
+    slots_.assign(std::max(minimum_slots, slots_.size() * 2u), null_link);
+
+    for (link item = 0; item < nodes_.size(); ++item)
+        if (live(item))
+            place(item);
+}
+
+// protected
+void header_pool::plant(link item)
+{
+    auto& entry = nodes_[item];
+    entry.root = true;
+    entry.parent = null_link;
+    entry.next_sibling = null_link;
+    roots_[entry.height & ring_mask].push_back(item);
+    floor_ = std::min(floor_, entry.height);
+    reroot(item);
+}
+
+// protected
+// Set the memoized origin of each node of the tree to its new root.
+void header_pool::reroot(link item)
+{
+    links pending{ item };
+
+    while (!pending.empty())
+    {
+        auto& entry = nodes_[pending.back()];
+        pending.pop_back();
+        entry.origin = item;
+
+        for (auto child = entry.first_child; child != null_link;
+            child = nodes_[child].next_sibling)
+            pending.push_back(child);
+    }
+}
+
+// protected
+void header_pool::unplant(link item)
+{
+    auto& entry = nodes_[item];
+    auto& bucket = roots_[entry.height & ring_mask];
+    const auto it = std::find(bucket.begin(), bucket.end(), item);
+    BITCOIN_ASSERT(it != bucket.end());
+
+    *it = bucket.back();
+    bucket.pop_back();
+    entry.root = false;
+}
+
+// protected
+// Caller ensures the header does not exist by using exists(), but insert
+// rejects the header if there is an entry of the same hash.
+void header_pool::insert(header_const_ptr header, size_t height)
+{
+    const auto hash = header->hash();
+
+    if (exists(hash))
+        return;
+
+    reserve();
+    link item;
+
+    if (recycled_.empty())
+    {
+        item = static_cast<link>(nodes_.size());
+        nodes_.push_back({});
+    }
+    else
+    {
+        item = recycled_.back();
+        recycled_.pop_back();
+    }
+
+    const record value
+    {
+        header->version(), header->previous_block_hash(), header->merkle_root(),
+        header->timestamp(), header->bits(), header->nonce()
+    };
+
+    nodes_[item] =
+    {
+        hash, value, header->metadata.median_time_past, header, height,
+        null_link, item, null_link, null_link, false
+    };
+
+    place(item);
+    ++count_;
+    ++headers_;
+
+    const auto parent = find(header->previous_block_hash());
+
+    // Add child to the internal (parent) node, otherwise this is a root.
+    if (parent == null_link)
+    {
+        plant(item);
+        return;
+    }
+
+    // The parent is no longer a leaf, so its header (and state) is released.
+    if (nodes_[parent].header)
+    {
+        nodes_[parent].header.reset();
+        --headers_;
+    }
+
+    auto& entry = nodes_[item];
+    entry.parent = parent;
+    entry.origin = nodes_[parent].origin;
+    entry.next_sibling = nodes_[parent].first_child;
+    nodes_[parent].first_child = item;
+}
+
+// protected
+// The children of the node are not changed, caller must handle them.
+void header_pool::erase(link item)
+{
+    auto& entry = nodes_[item];
+    const auto mask = slots_.size() - 1u;
+    auto slot = slot_key(entry.hash) & mask;
+
+    while (slots_[slot] != item)
+        slot = (slot + 1u) & mask;
+
+    // Backward shift deletion keeps probe sequences intact (no tombstones).
+    for (auto next = (slot + 1u) & mask; slots_[next] != null_link;
+        next = (next + 1u) & mask)
+    {
+        const auto home = slot_key(nodes_[slots_[next]].hash) & mask;
+
+        if (((next - home) & mask) >= ((next - slot) & mask))
+        {
+            slots_[slot] = slots_[next];
+            slot = next;
+        }
+    }
+
+    slots_[slot] = null_link;
+
+    if (entry.root)
+    {
+        unplant(item);
+    }
+    else if (entry.parent != null_link)
+    {
+        // Unlink the node from its parent, which remains pooled.
+        auto* next = &nodes_[entry.parent].first_child;
+
+        while (*next != null_link && *next != item)
+            next = &nodes_[*next].next_sibling;
+
+        if (*next == item)
+            *next = entry.next_sibling;
+    }
+
+    // The children no longer have a parent position (it will be recycled).
+    for (auto child = entry.first_child; child != null_link;
+        child = nodes_[child].next_sibling)
+        nodes_[child].parent = null_link;
+
+    if (entry.header)
+    {
+        entry.header.reset();
+        --headers_;
+    }
+
+    entry.origin = null_link;
+    recycled_.push_back(item);
+    --count_;
+}
+
 // As blocks are popped from the confirmed chain they could be pushed here
 // which can result in existing dependent branches becoming disconnected from
 // those blocks. To prevent this existing branch roots must be reparented
@@ -63,44 +341,28 @@ void header_pool::add(header_const_ptr valid_header, size_t height)
 {
     // The header must be successfully validated.
     ////BITCOIN_ASSERT(!valid_header->metadata.error);
-    header_entry entry{ valid_header, height };
-    const auto& left = headers_.left;
-
-    // Caller ensures the entry does not exist by using exists(), but
-    // insert rejects the header if there is an entry of the same hash.
-    ////BITCOIN_ASSERT(left.find(entry) == left.end());
-
-    // Add a back pointer from the parent for clearing the path later.
-    const header_entry parent{ valid_header->previous_block_hash() };
-    const auto it = left.find(parent);
-
-    // Add child and clear chain state from internal (parent) node.
-    if (it != left.end())
-    {
-        height = 0;
-        it->first.add_child(valid_header);
-
-        // Disabling this line ensures all headers retain chain state.
-        ////it->first.header()->metadata.state.reset();
-    }
 
     // Critical Section
     ///////////////////////////////////////////////////////////////////////////
     unique_lock lock(mutex_);
-    headers_.insert({ std::move(entry), height });
+    insert(valid_header, height);
+    trim(maximum_bytes_);
     ///////////////////////////////////////////////////////////////////////////
 }
 
 void header_pool::add(header_const_ptr_list_const_ptr valid_headers,
     size_t height)
 {
-    const auto insert = [&](const header_const_ptr& header)
-    {
-        add(header, height++);
-    };
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
 
     // This is an ordered loop.
-    std::for_each(valid_headers->begin(), valid_headers->end(), insert);
+    for (const auto& header: *valid_headers)
+        insert(header, height++);
+
+    trim(maximum_bytes_);
+    ///////////////////////////////////////////////////////////////////////////
 }
 
 // The pool is a forest connected to the chain at the roots of each tree.
@@ -108,110 +370,139 @@ void header_pool::add(header_const_ptr_list_const_ptr valid_headers,
 // or acceptance. So there is never internal removal of a node.
 void header_pool::remove(header_const_ptr_list_const_ptr accepted_headers)
 {
-    hash_list child_hashes;
-    auto saver = [&](const hash_digest& hash){ child_hashes.push_back(hash); };
-    auto& left = headers_.left;
+    links children;
 
-    for (auto header: *accepted_headers)
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    for (const auto& header: *accepted_headers)
     {
-        auto it = left.find(header_entry{ header->hash() });
+        const auto item = find(header->hash());
 
-        if (it == left.end())
+        if (item == null_link)
             continue;
 
-        // Copy hashes of all children of nodes we delete.
-        const auto& children = it->first.children();
-        std::for_each(children.begin(), children.end(), saver);
+        // Save the links of all children of nodes we delete.
+        for (auto child = nodes_[item].first_child; child != null_link;
+            child = nodes_[child].next_sibling)
+            children.push_back(child);
 
-        ///////////////////////////////////////////////////////////////////////
-        // Critical Section
-        unique_lock lock(mutex_);
-        left.erase(it);
-        ///////////////////////////////////////////////////////////////////////
+        erase(item);
     }
 
     // Move all children that we have orphaned to the root (give them height).
-    for (auto child: child_hashes)
+    for (const auto child: children)
     {
-        auto it = left.find(header_entry{ child });
-
         // Except for sub-branches all children should have been deleted above.
-        if (it == left.end())
+        if (!live(child))
             continue;
 
-        // Copy the entry so that it can be deleted and replanted with height.
-        const auto copy = it->first;
-        BITCOIN_ASSERT(it->second == 0);
-
-        // Critical Section
-        ///////////////////////////////////////////////////////////////////////
-        unique_lock lock(mutex_);
-        left.erase(it);
-        headers_.insert({ copy, copy.height() });
-        ///////////////////////////////////////////////////////////////////////
+        BITCOIN_ASSERT(!nodes_[child].root);
+        plant(child);
     }
+    ///////////////////////////////////////////////////////////////////////////
 }
 
 // protected
-void header_pool::prune(const hash_list& hashes, size_t minimum_height)
+// This is an iterative traversal of the trees of the expired roots.
+void header_pool::prune(links&& expired, size_t minimum_height)
 {
-    hash_list child_hashes;
-    auto saver = [&](const hash_digest& hash){ child_hashes.push_back(hash); };
-    auto& left = headers_.left;
-
-    for (auto& hash: hashes)
+    while (!expired.empty())
     {
-        const auto it = left.find(header_entry{ hash });
-        BITCOIN_ASSERT(it != left.end());
-
-        const auto height = it->first.height();
+        const auto item = expired.back();
+        expired.pop_back();
+        const auto& entry = nodes_[item];
 
-        // Delete all roots and expired non-roots and recurse their children.
-        if (it->second != 0 || height < minimum_height)
+        // Delete all roots and expired non-roots and span their children.
+        if (entry.root || entry.height < minimum_height)
         {
-            // delete
-            const auto& children = it->first.children();
-            std::for_each(children.begin(), children.end(), saver);
-
-            ///////////////////////////////////////////////////////////////////
-            // Critical Section
-            unique_lock lock(mutex_);
-            left.erase(it);
-            ///////////////////////////////////////////////////////////////////
+            for (auto child = entry.first_child; child != null_link;
+                child = nodes_[child].next_sibling)
+                expired.push_back(child);
 
+            erase(item);
             continue;
         }
 
-        // Copy the entry so that it can be deleted and replanted with height.
-        const auto copy = it->first;
-
-        // Critical Section
-        ///////////////////////////////////////////////////////////////////////
-        unique_lock lock(mutex_);
-        left.erase(it);
-        headers_.insert({ copy, height });
-        ///////////////////////////////////////////////////////////////////////
+        // Replant the unexpired child of an expired parent with its height.
+        plant(item);
     }
-
-    // Recurse the children to span the tree.
-    if (!child_hashes.empty())
-        prune(child_hashes, minimum_height);
 }
 
 void header_pool::prune(size_t top_height)
 {
-    hash_list hashes;
     const auto minimum_height = floor_subtract(top_height, maximum_depth_);
 
-    // TODO: not using table sort here, should stop iterating once above min.
-    // Iterate over all root nodes with insufficient height.
-    for (auto it: headers_.right)
-        if (it.first != 0 && it.first < minimum_height)
-            hashes.push_back(it.second.hash());
+    // There are no roots below the floor.
+    if (floor_ >= minimum_height)
+        return;
+
+    links expired;
+
+    // Visit only the buckets of heights from the floor to the minimum.
+    const auto span = std::min(minimum_height - floor_, ring_size);
 
-    // Get outside of the hash table iterator before deleting.
-    if (!hashes.empty())
-        prune(hashes, minimum_height);
+    for (size_t offset = 0; offset < span; ++offset)
+        for (const auto item: roots_[(floor_ + offset) & ring_mask])
+            if (nodes_[item].height < minimum_height)
+                expired.push_back(item);
+
+    floor_ = minimum_height;
+
+    if (expired.empty())
+        return;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    prune(std::move(expired), minimum_height);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// protected
+// The lowest root is the least likely to be reorganized, so its tree is pulled
+// down one height at a time (children replanted) until within the bound.
+void header_pool::trim(size_t maximum_bytes)
+{
+    while (count_ != 0 && bytes() > maximum_bytes)
+    {
+        links expired;
+        auto lowest = max_size_t;
+
+        for (const auto& bucket: roots_)
+        {
+            for (const auto item: bucket)
+            {
+                const auto height = nodes_[item].height;
+
+                if (height < lowest)
+                {
+                    lowest = height;
+                    expired.clear();
+                }
+
+                if (height == lowest)
+                    expired.push_back(item);
+            }
+        }
+
+        // Every tree has a root, so this is not expected.
+        if (expired.empty())
+            return;
+
+        prune(std::move(expired), ceiling_add(lowest, size_t(1)));
+    }
+}
+
+// The pool is pulled down from its lowest roots as when over its own bound.
+void header_pool::shed(size_t bytes)
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    trim(floor_subtract(this->bytes(), bytes));
+    ///////////////////////////////////////////////////////////////////////////
 }
 
 // This is guarded against concurrent write (the only reason for the mutex).
@@ -219,6 +510,10 @@ void header_pool::filter(get_data_ptr message) const
 {
     auto& inventories = message->inventories();
 
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    mutex_.lock_shared();
+
     // TODO: optimize (prevent repeating vector erase moves).
     for (auto it = inventories.begin(); it != inventories.end();)
     {
@@ -228,92 +523,67 @@ void header_pool::filter(get_data_ptr message) const
             continue;
         }
 
-        // Critical Section
-        ///////////////////////////////////////////////////////////////////////
-        mutex_.lock_shared();
-        const auto found = exists(it->hash());
-        mutex_.unlock_shared();
-        ///////////////////////////////////////////////////////////////////////
-
-        it = (found ? inventories.erase(it) : std::next(it));
+        it = (exists(it->hash()) ? inventories.erase(it) : std::next(it));
     }
+
+    mutex_.unlock_shared();
+    ///////////////////////////////////////////////////////////////////////////
 }
 
 // protected
 header_const_ptr header_pool::parent(header_const_ptr header) const
 {
     // The header may be validated (pool) or not (new).
-    const auto& left = headers_.left;
-    auto parent = left.find(header_entry{ header->previous_block_hash() });
-    return parent == left.end() ? nullptr : parent->first.header();
+    const auto item = find(header->previous_block_hash());
+    return item == null_link ? nullptr : materialize(item);
 }
 
 // protected
 size_t header_pool::height(const hash_digest& hash) const
 {
-    const auto& left = headers_.left;
-    const auto entry = left.find(header_entry{ hash });
-    BITCOIN_ASSERT(entry != left.end());
+    const auto item = find(hash);
+    BITCOIN_ASSERT(item != null_link);
 
-    return entry->first.height();
+    return nodes_[item].height;
 }
 
+// The path is followed by position and the height of the branch is that of
+// the memoized tree root, so there is no hashing beyond the parent lookup.
 header_branch::ptr header_pool::get_branch(header_const_ptr header) const
 {
-    const auto this_id = boost::this_thread::get_id();
-
-    LOG_VERBOSE(LOG_BLOCKCHAIN)
-    << this_id
-    << " header_pool::get_branch() calling make_shared<header_branch>()";
-    
     const auto trace = std::make_shared<header_branch>();
-    auto root = header;
 
     // Empty list indicates duplicate.
     if (exists(header))
     {
         LOG_VERBOSE(LOG_BLOCKCHAIN)
-        << this_id
+        << boost::this_thread::get_id()
         << " header_pool::get_branch() exists(header) DUPLICATE DETECTED!";
 
         return trace;
     }
-    
-    while (header)
-    {
-        LOG_VERBOSE(LOG_BLOCKCHAIN)
-        << this_id
-        << " header_pool::get_branch() while(header) loop: header = " << header;
 
+    const auto parent = find(header->previous_block_hash());
+
+    if (parent == null_link)
+    {
         trace->push(header);
-        root = header;
-        header = parent(header);
+        return trace;
     }
 
     // A preexisting root header must have a non-zero height.
     // This precludes the need to search for the fork point for previous item.
-    if (trace->size() > 1u)
-    {
-        LOG_VERBOSE(LOG_BLOCKCHAIN)
-        << this_id
-        << " header_pool::get_branch() trace->size() > 1u";
-
-        auto autohashdebug = root->hash();
-        auto autoheightdebug = height(autohashdebug);
+    const auto& root = nodes_[nodes_[parent].origin];
+    header_const_ptr_list path;
 
-        LOG_VERBOSE(LOG_BLOCKCHAIN)
-        << this_id
-        << " root->hash() = " << encode_hash(autohashdebug) << " and height = " << autoheightdebug;
+    for (auto item = parent; item != null_link; item = nodes_[item].parent)
+        path.push_back(materialize(item));
 
-        trace->set_height(autoheightdebug - 1u);
-    }
-    else
-    {
-        LOG_VERBOSE(LOG_BLOCKCHAIN)
-        << this_id
-        << " header_pool::get_branch() trace->size() <= 1u";
-    }
+    for (auto it = path.rbegin(); it != path.rend(); ++it)
+        trace->extend(*it);
 
+    trace->extend(header);
+    trace->set_height(root.height - 1u);
     return trace;
 }
 
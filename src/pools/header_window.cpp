@@ -0,0 +1,242 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/header_window.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+header_window::header_window(size_t capacity)
+  : capacity_(capacity), first_(0)
+{
+}
+
+size_t header_window::capacity() const
+{
+    return capacity_;
+}
+
+void header_window::reset(size_t first_height)
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    first_ = first_height;
+    bits_.clear();
+    versions_.clear();
+    timestamps_.clear();
+    hashes_.clear();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void header_window::push(const chain::header& header)
+{
+    if (capacity_ == 0)
+        return;
+
+    const auto hash = header.hash();
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    if (hashes_.size() == capacity_)
+    {
+        bits_.pop_front();
+        versions_.pop_front();
+        timestamps_.pop_front();
+        hashes_.pop_front();
+        ++first_;
+    }
+
+    bits_.push_back(header.bits());
+    versions_.push_back(header.version());
+    timestamps_.push_back(header.timestamp());
+    hashes_.push_back(hash);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void header_window::pop(size_t height)
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    // The window is empty above the height, so the next push is above it.
+    if (height < first_)
+    {
+        first_ = height + 1u;
+        bits_.clear();
+        versions_.clear();
+        timestamps_.clear();
+        hashes_.clear();
+        return;
+    }
+
+    const auto count = height - first_ + 1u;
+
+    if (count < hashes_.size())
+    {
+        bits_.resize(count);
+        versions_.resize(count);
+        timestamps_.resize(count);
+        hashes_.resize(count);
+    }
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool header_window::get_bits(uint32_t& out_bits, size_t height) const
+{
+    size_t position;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+
+    if (!find(position, height))
+        return false;
+
+    out_bits = bits_[position];
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool header_window::get_version(uint32_t& out_version, size_t height) const
+{
+    size_t position;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+
+    if (!find(position, height))
+        return false;
+
+    out_version = versions_[position];
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool header_window::get_timestamp(uint32_t& out_timestamp,
+    size_t height) const
+{
+    size_t position;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+
+    if (!find(position, height))
+        return false;
+
+    out_timestamp = timestamps_[position];
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool header_window::get_block_hash(hash_digest& out_hash,
+    size_t height) const
+{
+    size_t position;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+
+    if (!find(position, height))
+        return false;
+
+    out_hash = hashes_[position];
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void header_window::to_data(writer& sink) const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    sink.write_8_bytes_little_endian(first_);
+    sink.write_variable_little_endian(hashes_.size());
+
+    for (size_t position = 0; position < hashes_.size(); ++position)
+    {
+        sink.write_4_bytes_little_endian(bits_[position]);
+        sink.write_4_bytes_little_endian(versions_[position]);
+        sink.write_4_bytes_little_endian(timestamps_[position]);
+        sink.write_hash(hashes_[position]);
+    }
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool header_window::from_data(reader& source)
+{
+    const auto first = source.read_8_bytes_little_endian();
+    const auto count = source.read_size_little_endian();
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    first_ = 0;
+    bits_.clear();
+    versions_.clear();
+    timestamps_.clear();
+    hashes_.clear();
+
+    if (!source || count > capacity_)
+        return false;
+
+    for (size_t position = 0; position < count && source; ++position)
+    {
+        bits_.push_back(source.read_4_bytes_little_endian());
+        versions_.push_back(source.read_4_bytes_little_endian());
+        timestamps_.push_back(source.read_4_bytes_little_endian());
+        hashes_.push_back(source.read_hash());
+    }
+
+    if (!source)
+    {
+        bits_.clear();
+        versions_.clear();
+        timestamps_.clear();
+        hashes_.clear();
+        return false;
+    }
+
+    first_ = first;
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// private
+// Call only from within a critical section.
+bool header_window::find(size_t& out_position, size_t height) const
+{
+    if (height < first_ || height - first_ >= hashes_.size())
+        return false;
+
+    out_position = height - first_;
+    return true;
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/memory_budget.hpp>
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+static constexpr size_t megabyte = 1024 * 1024;
+
+memory_budget::memory_budget(size_t maximum_megabytes)
+  : maximum_bytes_(maximum_megabytes * megabyte),
+    sheds_(0)
+{
+}
+
+bool memory_budget::disabled() const
+{
+    return maximum_bytes_ == 0;
+}
+
+size_t memory_budget::maximum() const
+{
+    return maximum_bytes_;
+}
+
+void memory_budget::enroll(const std::string& name, measure bytes,
+    shed action)
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(mutex_);
+    components_.push_back({ name, std::move(bytes), std::move(action) });
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// Components are measured independently, so the report of components under
+// concurrent update is approximate (and sufficient for monitoring).
+memory_budget::usages memory_budget::report() const
+{
+    usages out;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(mutex_);
+    out.reserve(components_.size());
+
+    for (const auto& component: components_)
+        out.push_back({ component.name, component.bytes() });
+    ///////////////////////////////////////////////////////////////////////////
+
+    return out;
+}
+
+size_t memory_budget::total() const
+{
+    size_t bytes = 0;
+
+    for (const auto& component: report())
+        bytes = ceiling_add(bytes, component.bytes);
+
+    return bytes;
+}
+
+size_t memory_budget::sheds() const
+{
+    return sheds_;
+}
+
+// Each component is shed of the excess at its turn and then remeasured, so a
+// component that cannot shed (or sheds more) is accounted as it actually is.
+void memory_budget::enforce()
+{
+    if (disabled())
+        return;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+
+    if (!lock.owns_lock())
+        return;
+
+    size_t bytes = 0;
+
+    for (const auto& component: components_)
+        bytes = ceiling_add(bytes, component.bytes());
+
+    for (const auto& component: components_)
+    {
+        if (bytes <= maximum_bytes_)
+            break;
+
+        const auto before = component.bytes();
+        component.action(bytes - maximum_bytes_);
+        const auto after = component.bytes();
+        ++sheds_;
+
+        LOG_DEBUG(LOG_BLOCKCHAIN)
+            << "Memory budget shed [" << component.name << "] from "
+            << before << " to " << after << " bytes.";
+
+        bytes = floor_subtract(bytes, floor_subtract(before, after));
+    }
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
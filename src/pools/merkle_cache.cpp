@@ -0,0 +1,141 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/merkle_cache.hpp>
+
+#include <cstddef>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+// Allowance for the map node and order entry beyond the tx hashes.
+static constexpr size_t entry_overhead = 128;
+
+static size_t entry_bytes(const hash_list& tx_hashes)
+{
+    return tx_hashes.size() * hash_size + entry_overhead;
+}
+
+merkle_cache::merkle_cache(size_t maximum_megabytes)
+  : maximum_bytes_(maximum_megabytes * 1024u * 1024u),
+    bytes_(0)
+{
+}
+
+bool merkle_cache::disabled() const
+{
+    return maximum_bytes_ == 0;
+}
+
+size_t merkle_cache::size() const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return entries_.size();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+size_t merkle_cache::bytes() const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return bytes_;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void merkle_cache::add(block_const_ptr block)
+{
+    if (disabled())
+        return;
+
+    const auto& txs = block->transactions();
+    hash_list tx_hashes;
+    tx_hashes.reserve(txs.size());
+
+    for (const auto& tx: txs)
+        tx_hashes.push_back(tx.hash());
+
+    add(block->hash(), tx_hashes);
+}
+
+void merkle_cache::add(const hash_digest& block_hash,
+    const hash_list& tx_hashes)
+{
+    const auto bytes = entry_bytes(tx_hashes);
+
+    // A block has at least a coinbase, so an empty list is of a header only.
+    if (tx_hashes.empty() || bytes > maximum_bytes_)
+        return;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    // The tx hashes of a block never change.
+    if (!entries_.emplace(block_hash, tx_hashes).second)
+        return;
+
+    order_.push_back(block_hash);
+    bytes_ += bytes;
+
+    while (bytes_ > maximum_bytes_ && !order_.empty())
+    {
+        const auto it = entries_.find(order_.front());
+        order_.pop_front();
+
+        if (it != entries_.end())
+        {
+            bytes_ -= entry_bytes(it->second);
+            entries_.erase(it);
+        }
+    }
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool merkle_cache::get(hash_list& out_hashes,
+    const hash_digest& block_hash) const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    const auto it = entries_.find(block_hash);
+
+    if (it == entries_.end())
+        return false;
+
+    out_hashes = it->second;
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void merkle_cache::clear()
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    entries_.clear();
+    order_.clear();
+    bytes_ = 0;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
@@ -0,0 +1,200 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/notification_queue.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+notification_queue::notification_queue(size_t limit, header_handler headers)
+  : limit_(limit), headers_(headers), stopped_(true)
+{
+}
+
+notification_queue::~notification_queue()
+{
+    stop();
+
+    // A thread stopped from itself cannot be joined by itself.
+    if (thread_.joinable())
+        thread_.detach();
+}
+
+void notification_queue::start()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (!stopped_)
+        return;
+
+    // A thread stopped from itself remains joinable once it has returned.
+    if (thread_.joinable())
+    {
+        auto prior = std::move(thread_);
+        lock.unlock();
+        prior.join();
+        lock.lock();
+    }
+
+    stopped_ = false;
+    thread_ = std::thread(&notification_queue::dispatch, this);
+}
+
+void notification_queue::stop()
+{
+    std::thread thread;
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::unique_lock<std::mutex> lock(mutex_);
+    stopped_ = true;
+    queue_.clear();
+
+    if (thread_.joinable() && thread_.get_id() != std::this_thread::get_id())
+        thread = std::move(thread_);
+
+    lock.unlock();
+    ///////////////////////////////////////////////////////////////////////////
+
+    pushed_.notify_all();
+    popped_.notify_all();
+
+    if (thread.joinable())
+        thread.join();
+}
+
+size_t notification_queue::size() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+bool notification_queue::push(handler notify)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return enqueue({ std::move(notify), 0, nullptr, nullptr }, lock);
+}
+
+bool notification_queue::push(size_t fork_height,
+    header_const_ptr_list_const_ptr incoming,
+    header_const_ptr_list_const_ptr outgoing)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (stopped_)
+        return false;
+
+    // Only the last is coalesced, as it has not yet been dispatched.
+    if (!queue_.empty() && coalesce(queue_.back(), fork_height, incoming,
+        outgoing))
+        return true;
+
+    return enqueue({ nullptr, fork_height, incoming, outgoing }, lock);
+}
+
+// private
+//-----------------------------------------------------------------------------
+
+// The next may pop only the tail of the prior's incoming headers, in which
+// case subscribers can see both as a single reorganization from the prior.
+bool notification_queue::coalesce(notification& prior, size_t fork_height,
+    header_const_ptr_list_const_ptr incoming,
+    header_const_ptr_list_const_ptr outgoing)
+{
+    if (prior.notify || !prior.incoming || !incoming)
+        return false;
+
+    const auto& pushed = *prior.incoming;
+    const auto popped = outgoing ? outgoing->size() : 0;
+    const auto top = prior.fork_height + pushed.size();
+
+    if (fork_height < prior.fork_height || fork_height + popped != top)
+        return false;
+
+    const auto retained = fork_height - prior.fork_height;
+
+    for (size_t index = 0; index < popped; ++index)
+        if ((*outgoing)[index]->hash() != pushed[retained + index]->hash())
+            return false;
+
+    const auto merged = std::make_shared<header_const_ptr_list>();
+    merged->reserve(retained + incoming->size());
+    merged->insert(merged->end(), pushed.begin(), pushed.begin() + retained);
+    merged->insert(merged->end(), incoming->begin(), incoming->end());
+    prior.incoming = merged;
+    return true;
+}
+
+bool notification_queue::enqueue(notification&& next,
+    std::unique_lock<std::mutex>& lock)
+{
+    const auto self = thread_.get_id() == std::this_thread::get_id();
+
+    // Backpressure holds the organizer until the subscribers catch up.
+    popped_.wait(lock, [&]()
+    {
+        return stopped_ || self || limit_ == 0 || queue_.size() < limit_;
+    });
+
+    if (stopped_)
+        return false;
+
+    queue_.push_back(std::move(next));
+    lock.unlock();
+    pushed_.notify_one();
+    return true;
+}
+
+void notification_queue::dispatch()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true)
+    {
+        pushed_.wait(lock, [this]()
+        {
+            return stopped_ || !queue_.empty();
+        });
+
+        if (stopped_)
+            return;
+
+        auto next = std::move(queue_.front());
+        queue_.pop_front();
+        lock.unlock();
+        popped_.notify_all();
+
+        // Subscriber code is invoked without any lock held.
+        if (next.notify)
+            next.notify();
+        else
+            headers_(next.fork_height, next.incoming, next.outgoing);
+
+        lock.lock();
+    }
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
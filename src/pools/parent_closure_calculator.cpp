@@ -37,18 +37,14 @@ bool parent_closure_calculator::visit(transaction_entry::ptr element)
     return true;
 }
 
-transaction_entry::list parent_closure_calculator::get_closure(
+const transaction_entry::list& parent_closure_calculator::get_closure(
     transaction_entry::ptr tx)
 {
     if (tx != nullptr)
         enqueue(tx);
 
     evaluate();
-    transaction_entry::list result;
-    for (auto it = begin_encountered(); it != end_encountered(); ++it)
-        result.push_back(it->second);
-
-    return result;
+    return encountered();
 }
 
 } // namespace blockchain
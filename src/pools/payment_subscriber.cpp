@@ -0,0 +1,336 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/payment_subscriber.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+using namespace bc::chain;
+
+payment_subscriber::payment_subscriber()
+  : stopped_(true), next_(0)
+{
+}
+
+void payment_subscriber::start()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = false;
+}
+
+void payment_subscriber::stop()
+{
+    subscriptions stopping;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    mutex_.lock();
+    stopped_ = true;
+    stopping.swap(subscriptions_);
+    index_.clear();
+    mutex_.unlock();
+    ///////////////////////////////////////////////////////////////////////////
+
+    for (const auto& entry: stopping)
+    {
+        const auto& value = entry.second;
+
+        if (value->blocks)
+            value->blocks(error::service_stopped, 0, {}, {});
+        else
+            value->transactions(error::service_stopped, {});
+    }
+}
+
+size_t payment_subscriber::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return subscriptions_.size();
+}
+
+void payment_subscriber::subscribe(const filter& addresses,
+    block_handler&& handler)
+{
+    const auto value = std::make_shared<subscription>();
+    value->addresses = addresses;
+    value->blocks = std::move(handler);
+    add(value);
+}
+
+void payment_subscriber::subscribe(const filter& addresses,
+    transaction_handler&& handler)
+{
+    const auto value = std::make_shared<subscription>();
+    value->addresses = addresses;
+    value->transactions = std::move(handler);
+    add(value);
+}
+
+void payment_subscriber::invoke(const code& ec)
+{
+    identifiers dropped;
+
+    for (const auto& entry: copy())
+    {
+        const auto& value = entry.second;
+
+        if (value->blocks ? !value->blocks(ec, 0, {}, {}) :
+            !value->transactions(ec, {}))
+            dropped.push_back(entry.first);
+    }
+
+    remove(dropped);
+}
+
+// Each tx is matched (and copied for delivery) once for all subscribers.
+// Matching is skipped without subscribers, the usual case.
+void payment_subscriber::notify(size_t fork_height,
+    block_const_ptr_list_const_ptr incoming,
+    block_const_ptr_list_const_ptr outgoing)
+{
+    if (size() == 0)
+        return;
+
+    matches in;
+    matches out;
+    match(in, incoming);
+    match(out, outgoing);
+
+    if (in.empty() && out.empty())
+        return;
+
+    identifiers dropped;
+    const auto none = std::make_shared<const transaction_const_ptr_list>();
+
+    for (const auto& entry: copy())
+    {
+        const auto id = entry.first;
+        const auto inbound = in.find(id);
+        const auto outbound = out.find(id);
+
+        if (inbound == in.end() && outbound == out.end())
+            continue;
+
+        const transaction_const_ptr_list_const_ptr matched_in =
+            inbound == in.end() ? none : inbound->second;
+        const transaction_const_ptr_list_const_ptr matched_out =
+            outbound == out.end() ? none : outbound->second;
+
+        if (!entry.second->blocks(error::success, fork_height, matched_in,
+            matched_out))
+            dropped.push_back(id);
+    }
+
+    remove(dropped);
+}
+
+void payment_subscriber::notify(transaction_const_ptr tx)
+{
+    if (size() == 0)
+        return;
+
+    const auto ids = match(*tx, false);
+
+    if (ids.empty())
+        return;
+
+    identifiers dropped;
+    const auto values = copy();
+
+    for (const auto id: ids)
+    {
+        const auto it = values.find(id);
+
+        if (it != values.end() && !it->second->transactions(error::success, tx))
+            dropped.push_back(id);
+    }
+
+    remove(dropped);
+}
+
+// static
+payment_subscriber::filter payment_subscriber::addresses(
+    const transaction& tx)
+{
+    filter out;
+
+    for (const auto& output: tx.outputs())
+        for (const auto& address: output.addresses())
+            if (address)
+                out.insert(address.hash());
+
+    // The coinbase input does not spend a previous output.
+    if (tx.is_coinbase())
+        return out;
+
+    for (const auto& input: tx.inputs())
+    {
+        const auto& prevout = input.previous_output().metadata.cache;
+
+        for (const auto& address: prevout.is_valid() ? prevout.addresses() :
+            input.addresses())
+            if (address)
+                out.insert(address.hash());
+    }
+
+    return out;
+}
+
+// private
+void payment_subscriber::add(subscription_ptr value)
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    mutex_.lock();
+
+    if (!stopped_)
+    {
+        const auto id = next_++;
+        subscriptions_.emplace(id, value);
+
+        for (const auto& address: value->addresses)
+            index_[address].push_back(id);
+
+        mutex_.unlock();
+        return;
+    }
+
+    mutex_.unlock();
+    ///////////////////////////////////////////////////////////////////////////
+
+    if (value->blocks)
+        value->blocks(error::service_stopped, 0, {}, {});
+    else
+        value->transactions(error::service_stopped, {});
+}
+
+// private
+void payment_subscriber::remove(const identifiers& ids)
+{
+    if (ids.empty())
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (const auto id: ids)
+    {
+        const auto it = subscriptions_.find(id);
+
+        if (it == subscriptions_.end())
+            continue;
+
+        for (const auto& address: it->second->addresses)
+        {
+            const auto entry = index_.find(address);
+
+            if (entry == index_.end())
+                continue;
+
+            auto& values = entry->second;
+            values.erase(std::remove(values.begin(), values.end(), id),
+                values.end());
+
+            if (values.empty())
+                index_.erase(entry);
+        }
+
+        subscriptions_.erase(it);
+    }
+}
+
+// private
+// The identifiers of block (or tx) subscriptions matching the tx, ascending.
+payment_subscriber::identifiers payment_subscriber::match(
+    const transaction& tx, bool blocks) const
+{
+    identifiers out;
+    const auto paid = addresses(tx);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (const auto& address: paid)
+    {
+        const auto entry = index_.find(address);
+
+        if (entry == index_.end())
+            continue;
+
+        for (const auto id: entry->second)
+        {
+            const auto it = subscriptions_.find(id);
+
+            if (it != subscriptions_.end() && !it->second->blocks == !blocks)
+                out.push_back(id);
+        }
+    }
+
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+// private
+void payment_subscriber::match(matches& out,
+    block_const_ptr_list_const_ptr blocks) const
+{
+    if (!blocks)
+        return;
+
+    for (const auto& block: *blocks)
+    {
+        for (const auto& tx: block->transactions())
+        {
+            const auto ids = match(tx, true);
+
+            if (ids.empty())
+                continue;
+
+            // Shared by all subscribers matching the tx.
+            const auto pointer = std::make_shared<const message::transaction>(
+                tx);
+
+            for (const auto id: ids)
+            {
+                auto& list = out[id];
+
+                if (!list)
+                    list = std::make_shared<transaction_const_ptr_list>();
+
+                list->push_back(pointer);
+            }
+        }
+    }
+}
+
+// private
+payment_subscriber::subscriptions payment_subscriber::copy() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return subscriptions_;
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
@@ -0,0 +1,589 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/spend_index.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <iterator>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/interprocess/exceptions.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+using namespace bc::chain;
+
+// The header is the count, capacity, top height, top hash and the flag set
+// when the table is consistent with the top (between updates).
+static constexpr size_t header_size = 64;
+static constexpr size_t count_offset = 0;
+static constexpr size_t capacity_offset = 8;
+static constexpr size_t top_offset = 16;
+static constexpr size_t top_hash_offset = 24;
+static constexpr size_t clean_offset = top_hash_offset + hash_size;
+
+// A slot is the key, spending tx store link and input index. The link is
+// offset by one, so that a zero filled slot is empty.
+static constexpr size_t key_size = sizeof(uint64_t);
+static constexpr size_t link_size = sizeof(uint64_t);
+static constexpr size_t slot_size = key_size + link_size + sizeof(uint32_t);
+
+// Capacity is a power of two slots, doubled at half load.
+static constexpr size_t initial_capacity = 1u << 20;
+static constexpr uint64_t no_top = max_uint64;
+
+struct spend
+{
+    uint64_t key;
+    uint64_t link;
+    uint32_t index;
+};
+
+static uint64_t read_little_endian(const uint8_t* data, size_t bytes)
+{
+    uint64_t value = 0;
+
+    for (size_t byte = 0; byte < bytes; ++byte)
+        value |= uint64_t(data[byte]) << (8 * byte);
+
+    return value;
+}
+
+static void write_little_endian(uint8_t* data, uint64_t value, size_t bytes)
+{
+    for (size_t byte = 0; byte < bytes; ++byte)
+        data[byte] = static_cast<uint8_t>(value >> (8 * byte));
+}
+
+// The outpoint hash is truncated and mixed with the index (golden ratio).
+static uint64_t to_key(const output_point& outpoint)
+{
+    static constexpr uint64_t mix = 0x9e3779b97f4a7c15;
+    return read_little_endian(outpoint.hash().data(), key_size) ^
+        (uint64_t(outpoint.index()) * mix);
+}
+
+static bool is_empty(const uint8_t* slot)
+{
+    return std::all_of(slot + key_size, slot + key_size + link_size,
+        [](uint8_t byte) { return byte == 0; });
+}
+
+static spend read_slot(const uint8_t* slot)
+{
+    spend value;
+    value.key = read_little_endian(slot, key_size);
+    value.link = read_little_endian(slot + key_size, link_size) - 1u;
+    value.index = static_cast<uint32_t>(read_little_endian(
+        slot + key_size + link_size, sizeof(uint32_t)));
+    return value;
+}
+
+static void write_slot(uint8_t* slot, const spend& value)
+{
+    write_little_endian(slot, value.key, key_size);
+    write_little_endian(slot + key_size, value.link + 1u, link_size);
+    write_little_endian(slot + key_size + link_size, value.index,
+        sizeof(uint32_t));
+}
+
+// Linear probing from the home slot of the key.
+static void insert(uint8_t* table, size_t capacity, const spend& value)
+{
+    const auto mask = capacity - 1u;
+    auto position = static_cast<size_t>(value.key & mask);
+
+    while (!is_empty(table + position * slot_size))
+        position = (position + 1u) & mask;
+
+    write_slot(table + position * slot_size, value);
+}
+
+// As insert, but false (not inserted) if the probe passes the last slot.
+static bool insert_unwrapped(uint8_t* table, size_t capacity,
+    const spend& value)
+{
+    for (auto position = static_cast<size_t>(value.key & (capacity - 1u));
+        position < capacity; ++position)
+    {
+        if (is_empty(table + position * slot_size))
+        {
+            write_slot(table + position * slot_size, value);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Backward shift deletion, so that the table has no tombstones. An entry is
+// shifted into the hole if the hole is on its probe path from its home slot.
+static bool erase(uint8_t* table, size_t capacity, const spend& value)
+{
+    const auto mask = capacity - 1u;
+    auto hole = static_cast<size_t>(value.key & mask);
+
+    while (true)
+    {
+        const auto slot = table + hole * slot_size;
+
+        if (is_empty(slot))
+            return false;
+
+        const auto entry = read_slot(slot);
+
+        if (entry.key == value.key && entry.link == value.link &&
+            entry.index == value.index)
+            break;
+
+        hole = (hole + 1u) & mask;
+    }
+
+    for (auto next = (hole + 1u) & mask; ; next = (next + 1u) & mask)
+    {
+        const auto slot = table + next * slot_size;
+
+        if (is_empty(slot))
+            break;
+
+        const auto home = static_cast<size_t>(read_little_endian(slot,
+            key_size) & mask);
+
+        if (((next - home) & mask) >= ((next - hole) & mask))
+        {
+            std::copy_n(slot, slot_size, table + hole * slot_size);
+            hole = next;
+        }
+    }
+
+    std::fill_n(table + hole * slot_size, slot_size, uint8_t(0));
+    return true;
+}
+
+spend_index::spend_index(const boost::filesystem::path& file)
+  : file_(file),
+    failed_(false),
+    count_(0),
+    capacity_(0),
+    top_(no_top),
+    top_hash_(null_hash)
+{
+}
+
+bool spend_index::disabled() const
+{
+    return file_.empty();
+}
+
+// The index is marked consistent at each update, so that only a crash during
+// an update (or a failed update) implies a clear.
+bool spend_index::start()
+{
+    if (disabled())
+        return true;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    failed_ = false;
+
+    boost::system::error_code ec;
+    if (!boost::filesystem::exists(file_, ec))
+    {
+        boost::filesystem::ofstream out(file_, std::ios::binary);
+
+        if (!out)
+            return false;
+    }
+
+    const auto file_size = boost::filesystem::file_size(file_, ec);
+    auto valid = !ec && file_size >= header_size && map();
+
+    if (valid)
+    {
+        const auto base = static_cast<const uint8_t*>(
+            region_.get_address());
+
+        read_header();
+        valid = base[clean_offset] != 0 && capacity_ != 0 &&
+            (capacity_ & (capacity_ - 1u)) == 0 && count_ <= capacity_ &&
+            region_.get_size() == header_size + capacity_ * slot_size;
+    }
+
+    if (!valid && !reset())
+        return false;
+
+    mark(true);
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void spend_index::stop()
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    if (region_.get_address() == nullptr)
+        return;
+
+    write_header(!failed_);
+    region_.flush(0, 0, false);
+    boost::interprocess::mapped_region unmapped;
+    region_.swap(unmapped);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+size_t spend_index::size() const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return count_;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool spend_index::top(size_t& out_height, hash_digest& out_hash) const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+
+    if (top_ == no_top)
+        return false;
+
+    out_height = static_cast<size_t>(top_);
+    out_hash = top_hash_;
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool spend_index::push(const block& block, size_t height)
+{
+    if (disabled())
+        return true;
+
+    const auto& header = block.header();
+    const auto& txs = block.transactions();
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    if (failed_ || region_.get_address() == nullptr)
+        return false;
+
+    if (top_ == no_top ? height != 0u : (height != top_ + 1u ||
+        header.previous_block_hash() != top_hash_))
+    {
+        failed_ = true;
+        return false;
+    }
+
+    mark(false);
+
+    // Must skip coinbase as it does not spend a previous output.
+    for (auto tx = txs.empty() ? txs.end() : std::next(txs.begin());
+        tx != txs.end(); ++tx)
+    {
+        // The spender is indexed by its store link, so it must be stored.
+        const auto link = tx->metadata.link;
+        const auto& inputs = tx->inputs();
+
+        if (link == transaction::validation::unlinked)
+        {
+            failed_ = true;
+            return false;
+        }
+
+        for (uint32_t index = 0; index < inputs.size(); ++index)
+        {
+            // The table is remapped when grown.
+            if (2u * (count_ + 1u) > capacity_ && !grow())
+            {
+                failed_ = true;
+                return false;
+            }
+
+            const auto table = static_cast<uint8_t*>(region_.get_address()) +
+                header_size;
+
+            insert(table, capacity_,
+                { to_key(inputs[index].previous_output()), link, index });
+            ++count_;
+        }
+    }
+
+    top_ = height;
+    top_hash_ = block.hash();
+    commit();
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool spend_index::pop(const block& block, size_t height)
+{
+    if (disabled())
+        return true;
+
+    const auto& header = block.header();
+    const auto& txs = block.transactions();
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    if (failed_ || region_.get_address() == nullptr)
+        return false;
+
+    if (top_ != height || top_hash_ != block.hash())
+    {
+        failed_ = true;
+        return false;
+    }
+
+    mark(false);
+    const auto table = static_cast<uint8_t*>(region_.get_address()) +
+        header_size;
+
+    // Must skip coinbase as it does not spend a previous output.
+    for (auto tx = txs.empty() ? txs.end() : std::next(txs.begin());
+        tx != txs.end(); ++tx)
+    {
+        const auto link = tx->metadata.link;
+        const auto& inputs = tx->inputs();
+
+        for (uint32_t index = 0; index < inputs.size(); ++index)
+        {
+            if (!erase(table, capacity_,
+                { to_key(inputs[index].previous_output()), link, index }))
+            {
+                failed_ = true;
+                return false;
+            }
+
+            --count_;
+        }
+    }
+
+    top_ = height == 0u ? no_top : height - 1u;
+    top_hash_ = height == 0u ? null_hash : header.previous_block_hash();
+    commit();
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool spend_index::clear()
+{
+    if (disabled())
+        return true;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    if (region_.get_address() == nullptr || !reset())
+        return false;
+
+    mark(true);
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+spend_index::spender::list spend_index::get(
+    const output_point& outpoint) const
+{
+    spender::list spenders;
+    const auto key = to_key(outpoint);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+
+    if (failed_ || region_.get_address() == nullptr)
+        return spenders;
+
+    const auto mask = capacity_ - 1u;
+    const auto table = static_cast<const uint8_t*>(region_.get_address()) +
+        header_size;
+
+    for (auto position = static_cast<size_t>(key & mask);
+        !is_empty(table + position * slot_size);
+        position = (position + 1u) & mask)
+    {
+        const auto entry = read_slot(table + position * slot_size);
+
+        if (entry.key == key)
+            spenders.push_back({ entry.link, entry.index });
+    }
+
+    return spenders;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// private, call under mutex.
+bool spend_index::map()
+{
+    try
+    {
+        using namespace boost::interprocess;
+        const file_mapping mapping(file_.string().c_str(), read_write);
+        mapped_region region(mapping, read_write);
+        region_.swap(region);
+    }
+    catch (const boost::interprocess::interprocess_exception&)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+// private, call under mutex.
+// The file is truncated and extended, so the new table is zero filled.
+bool spend_index::reset()
+{
+    {
+        boost::interprocess::mapped_region unmapped;
+        region_.swap(unmapped);
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::resize_file(file_, 0, ec);
+
+    if (!ec)
+        boost::filesystem::resize_file(file_,
+            header_size + initial_capacity * slot_size, ec);
+
+    if (ec || !map())
+        return false;
+
+    failed_ = false;
+    count_ = 0;
+    capacity_ = initial_capacity;
+    top_ = no_top;
+    top_hash_ = null_hash;
+    return true;
+}
+
+// private, call under mutex.
+// The file is extended and entries are rehashed in place, in probe order from
+// the start of a run, so that each entry is reinserted at or before its slot
+// or into the new half. An insertion that would wrap into unprocessed slots
+// is deferred to the end (this is only the run at the end of the table).
+bool spend_index::grow()
+{
+    const auto previous = capacity_;
+    const auto capacity = 2u * previous;
+    const auto previous_mask = previous - 1u;
+
+    {
+        boost::interprocess::mapped_region unmapped;
+        region_.swap(unmapped);
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::resize_file(file_,
+        header_size + capacity * slot_size, ec);
+
+    if (ec || !map())
+        return false;
+
+    const auto table = static_cast<uint8_t*>(region_.get_address()) +
+        header_size;
+
+    // The table is at most half full, so it has an empty slot.
+    size_t start = 0;
+    while (!is_empty(table + start * slot_size))
+        ++start;
+
+    std::vector<spend> deferred;
+
+    for (size_t step = 1; step < previous; ++step)
+    {
+        const auto slot = table + ((start + step) & previous_mask) *
+            slot_size;
+
+        if (is_empty(slot))
+            continue;
+
+        const auto entry = read_slot(slot);
+        std::fill_n(slot, slot_size, uint8_t(0));
+
+        if (!insert_unwrapped(table, capacity, entry))
+            deferred.push_back(entry);
+    }
+
+    for (const auto& entry: deferred)
+        insert(table, capacity, entry);
+
+    capacity_ = capacity;
+    return true;
+}
+
+// private, call under mutex.
+// The flag is synchronously flushed, so that it precedes (or follows) any
+// write of the table that it describes.
+void spend_index::mark(bool consistent)
+{
+    write_header(consistent);
+    region_.flush(0, header_size, false);
+}
+
+// private, call under mutex.
+// The update is flushed before it is marked consistent with the new top.
+void spend_index::commit()
+{
+    write_header(false);
+    region_.flush(0, 0, false);
+    mark(true);
+}
+
+// private, call under mutex.
+void spend_index::read_header()
+{
+    const auto base = static_cast<const uint8_t*>(region_.get_address());
+    count_ = static_cast<size_t>(read_little_endian(base + count_offset,
+        sizeof(uint64_t)));
+    capacity_ = static_cast<size_t>(read_little_endian(base +
+        capacity_offset, sizeof(uint64_t)));
+    top_ = read_little_endian(base + top_offset, sizeof(uint64_t));
+    std::copy_n(base + top_hash_offset, hash_size, top_hash_.begin());
+}
+
+// private, call under mutex.
+void spend_index::write_header(bool clean)
+{
+    const auto base = static_cast<uint8_t*>(region_.get_address());
+    write_little_endian(base + count_offset, count_, sizeof(uint64_t));
+    write_little_endian(base + capacity_offset, capacity_, sizeof(uint64_t));
+    write_little_endian(base + top_offset, top_, sizeof(uint64_t));
+    std::copy(top_hash_.begin(), top_hash_.end(), base + top_hash_offset);
+    base[clean_offset] = clean ? 1 : 0;
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
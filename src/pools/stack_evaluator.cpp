@@ -17,55 +17,105 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <map>
-
 #include <bitcoin/blockchain/pools/stack_evaluator.hpp>
 
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
 namespace libbitcoin {
 namespace blockchain {
 
+// Epochs are never reused, so a stale mark never matches a new traversal.
+static std::atomic<uint64_t> epochs(0);
+
+stack_evaluator::stack_evaluator()
+  : epoch_(0)
+{
+    auto& free = recycled();
+
+    if (free.empty())
+    {
+        scratch_.reset(new scratch);
+        return;
+    }
+
+    scratch_ = std::move(free.back());
+    free.pop_back();
+}
+
+// Buffers are returned empty but with their capacity for the next evaluator.
+stack_evaluator::~stack_evaluator()
+{
+    scratch_->stack.clear();
+    scratch_->encountered.clear();
+    scratch_->marks.clear();
+    recycled().push_back(std::move(scratch_));
+}
+
+std::vector<stack_evaluator::scratch_ptr>& stack_evaluator::recycled()
+{
+    static thread_local std::vector<scratch_ptr> free;
+    return free;
+}
+
 void stack_evaluator::enqueue(element_type element)
 {
-    stack_.push_back(element);
+    scratch_->stack.push_back(element);
 }
 
 void stack_evaluator::evaluate()
 {
-    encountered_.clear();
+    auto& stack = scratch_->stack;
+    scratch_->encountered.clear();
+    scratch_->marks.clear();
+    epoch_ = ++epochs;
 
-    while (!stack_.empty())
+    while (!stack.empty())
     {
-        auto element = stack_.back();
-        stack_.pop_back();
+        auto element = stack.back();
+        stack.pop_back();
 
-		if (has_encountered(element))
+        if (has_encountered(element))
             continue;
 
-		if (visit(element))
-			mark_encountered(element);
+        if (visit(element))
+            mark_encountered(element);
     }
+
+    restore();
 }
 
 bool stack_evaluator::has_encountered(element_type element) const
 {
-    return (encountered_.find(element->hash()) != encountered_.end());
+    return element->mark() == epoch_;
 }
 
 void stack_evaluator::mark_encountered(element_type element)
 {
-	encountered_.insert({ element->hash(), element });
+    if (has_encountered(element))
+        return;
+
+    scratch_->marks.push_back(element->mark());
+    scratch_->encountered.push_back(element);
+    element->set_mark(epoch_);
 }
 
-stack_evaluator::element_type_natural_key_map::const_iterator
-    stack_evaluator::begin_encountered() const
+const stack_evaluator::element_list& stack_evaluator::encountered() const
 {
-    return encountered_.begin();
+    return scratch_->encountered;
 }
 
-stack_evaluator::element_type_natural_key_map::const_iterator
-    stack_evaluator::end_encountered() const
+// private
+// Reverse order restores the marks of any enclosing traversal.
+void stack_evaluator::restore()
 {
-    return encountered_.end();
+    const auto& encountered = scratch_->encountered;
+    const auto& marks = scratch_->marks;
+
+    for (auto index = encountered.size(); index > 0; --index)
+        encountered[index - 1]->set_mark(marks[index - 1]);
 }
 
 } // namespace blockchain
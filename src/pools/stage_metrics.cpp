@@ -0,0 +1,327 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/stage_metrics.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+// Latency histogram.
+//-----------------------------------------------------------------------------
+
+// The first magnitude with sub-buckets (2^3 = latency_histogram::sub_buckets).
+static constexpr size_t linear_bits = 3;
+
+latency_histogram::latency_histogram()
+  : count_(0), total_(0), maximum_(0)
+{
+    for (auto& count: counts_)
+        count.store(0, std::memory_order_relaxed);
+}
+
+void latency_histogram::record(uint64_t microseconds)
+{
+    counts_[bucket(microseconds)].fetch_add(1, std::memory_order_relaxed);
+    total_.fetch_add(microseconds, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+
+    auto maximum = maximum_.load(std::memory_order_relaxed);
+    while (microseconds > maximum && !maximum_.compare_exchange_weak(maximum,
+        microseconds, std::memory_order_relaxed));
+}
+
+uint64_t latency_histogram::count() const
+{
+    return count_.load(std::memory_order_relaxed);
+}
+
+uint64_t latency_histogram::total() const
+{
+    return total_.load(std::memory_order_relaxed);
+}
+
+uint64_t latency_histogram::maximum() const
+{
+    return maximum_.load(std::memory_order_relaxed);
+}
+
+// Buckets are read independently, so the quantile of a histogram under
+// concurrent update is approximate (and sufficient for monitoring).
+uint64_t latency_histogram::quantile(double ratio) const
+{
+    const auto values = counts();
+    uint64_t samples = 0;
+
+    for (const auto value: values)
+        samples += value;
+
+    if (samples == 0)
+        return 0;
+
+    const auto bounded = std::max(0.0, std::min(ratio, 1.0));
+    const auto target = std::max(uint64_t(1),
+        static_cast<uint64_t>(bounded * samples + 0.5));
+
+    uint64_t seen = 0;
+    for (size_t index = 0; index < values.size(); ++index)
+        if ((seen += values[index]) >= target)
+            return std::min(upper_bound(index), maximum());
+
+    return maximum();
+}
+
+std::vector<uint64_t> latency_histogram::counts() const
+{
+    std::vector<uint64_t> out;
+    out.reserve(buckets);
+
+    for (const auto& count: counts_)
+        out.push_back(count.load(std::memory_order_relaxed));
+
+    return out;
+}
+
+// static
+size_t latency_histogram::bucket(uint64_t microseconds)
+{
+    if (microseconds < sub_buckets)
+        return static_cast<size_t>(microseconds);
+
+    // The magnitude is the index of the most significant bit.
+    size_t magnitude = linear_bits;
+    while (magnitude < 63u && (microseconds >> (magnitude + 1u)) != 0)
+        ++magnitude;
+
+    const auto shift = magnitude - linear_bits;
+    const auto sub = static_cast<size_t>(microseconds >> shift) - sub_buckets;
+    return (shift + 1u) * sub_buckets + sub;
+}
+
+// static
+uint64_t latency_histogram::upper_bound(size_t bucket)
+{
+    if (bucket < sub_buckets)
+        return bucket;
+
+    const auto shift = bucket / sub_buckets - 1u;
+    const auto sub = bucket % sub_buckets;
+    const auto lower = uint64_t(sub_buckets + sub) << shift;
+    return lower + ((uint64_t(1) << shift) - 1u);
+}
+
+// Lock metrics.
+//-----------------------------------------------------------------------------
+
+static uint64_t to_microseconds(const asio::duration& elapsed)
+{
+    const auto microseconds = std::chrono::duration_cast<
+        asio::microseconds>(elapsed).count();
+
+    return microseconds < 0 ? 0 : static_cast<uint64_t>(microseconds);
+}
+
+static size_t offset(lock_metrics::site caller)
+{
+    return static_cast<size_t>(caller);
+}
+
+lock_metrics::lock_metrics()
+{
+    for (size_t caller = 0; caller < sites; ++caller)
+    {
+        waiting_[caller].store(0, std::memory_order_relaxed);
+        overtaken_[caller].store(0, std::memory_order_relaxed);
+    }
+}
+
+asio::time_point lock_metrics::waiting(site caller)
+{
+    waiting_[offset(caller)].fetch_add(1, std::memory_order_relaxed);
+    return asio::steady_clock::now();
+}
+
+// Each waiter of low priority is charged once for each acquisition of high
+// priority that occurs while it waits (whether or not it requested first).
+void lock_metrics::acquired(site caller, const asio::time_point& start)
+{
+    const auto now = asio::steady_clock::now();
+    waits_[offset(caller)].record(to_microseconds(now - start));
+    waiting_[offset(caller)].fetch_sub(1, std::memory_order_relaxed);
+    acquired_ = now;
+
+    if (!is_high_priority(caller))
+        return;
+
+    for (size_t other = 0; other < sites; ++other)
+        if (!is_high_priority(static_cast<site>(other)))
+            overtaken_[other].fetch_add(waiting_[other].load(
+                std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void lock_metrics::released(site caller)
+{
+    holds_[offset(caller)].record(to_microseconds(asio::steady_clock::now() -
+        acquired_));
+}
+
+const latency_histogram& lock_metrics::wait(site caller) const
+{
+    return waits_[offset(caller)];
+}
+
+const latency_histogram& lock_metrics::hold(site caller) const
+{
+    return holds_[offset(caller)];
+}
+
+uint64_t lock_metrics::overtaken(site caller) const
+{
+    return overtaken_[offset(caller)].load(std::memory_order_relaxed);
+}
+
+// static
+bool lock_metrics::is_high_priority(site caller)
+{
+    return caller != site::transaction_store;
+}
+
+// static
+std::string lock_metrics::name(site caller)
+{
+    switch (caller)
+    {
+        case site::block_validate:
+            return "block_validate";
+        case site::header_organize:
+            return "header_organize";
+        case site::header_flush:
+            return "header_flush";
+        case site::transaction_store:
+            return "transaction_store";
+        case site::chain_stop:
+        default:
+            return "chain_stop";
+    }
+}
+
+// Stage metrics.
+//-----------------------------------------------------------------------------
+
+static size_t offset(stage_metrics::entity target, stage_metrics::stage step)
+{
+    return static_cast<size_t>(target) * stage_metrics::stages +
+        static_cast<size_t>(step);
+}
+
+stage_metrics::stage_metrics()
+  : cached_preceding_(0), stored_preceding_(0)
+{
+}
+
+void stage_metrics::record(entity target, stage step,
+    const asio::duration& elapsed)
+{
+    histograms_[offset(target, step)].record(to_microseconds(elapsed));
+}
+
+void stage_metrics::record(entity target, stage step,
+    const asio::time_point& start)
+{
+    record(target, step, asio::steady_clock::now() - start);
+}
+
+const latency_histogram& stage_metrics::histogram(entity target,
+    stage step) const
+{
+    return histograms_[offset(target, step)];
+}
+
+void stage_metrics::preceding(bool cached)
+{
+    ++(cached ? cached_preceding_ : stored_preceding_);
+}
+
+uint64_t stage_metrics::cached_preceding() const
+{
+    return cached_preceding_;
+}
+
+uint64_t stage_metrics::stored_preceding() const
+{
+    return stored_preceding_;
+}
+
+lock_metrics& stage_metrics::locks()
+{
+    return locks_;
+}
+
+const lock_metrics& stage_metrics::locks() const
+{
+    return locks_;
+}
+
+// static
+std::string stage_metrics::name(entity target)
+{
+    switch (target)
+    {
+        case entity::block:
+            return "block";
+        case entity::header:
+            return "header";
+        case entity::transaction:
+        default:
+            return "transaction";
+    }
+}
+
+// static
+std::string stage_metrics::name(stage step)
+{
+    switch (step)
+    {
+        case stage::read:
+            return "read";
+        case stage::populate:
+            return "populate";
+        case stage::accept:
+            return "accept";
+        case stage::connect:
+            return "connect";
+        case stage::candidate:
+            return "candidate";
+        case stage::reorganize:
+            return "reorganize";
+        case stage::notify:
+        default:
+            return "notify";
+    }
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
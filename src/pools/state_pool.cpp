@@ -0,0 +1,117 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/state_pool.hpp>
+
+#include <cstddef>
+#include <new>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+// Blocks are rounded to the strictest fundamental alignment.
+static constexpr size_t block_alignment = alignof(std::max_align_t);
+
+state_pool::state_pool(size_t slab_blocks)
+  : slab_blocks_(slab_blocks == 0 ? 1 : slab_blocks),
+    block_size_(0)
+{
+}
+
+state_pool::~state_pool()
+{
+    for (const auto slab: slabs_)
+        ::operator delete(slab);
+}
+
+// private
+size_t state_pool::round(size_t bytes)
+{
+    return (bytes + block_alignment - 1u) / block_alignment * block_alignment;
+}
+
+size_t state_pool::capacity() const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return slabs_.size() * slab_blocks_;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+size_t state_pool::size() const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return slabs_.size() * slab_blocks_ - free_.size();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void* state_pool::allocate(size_t bytes)
+{
+    const auto size = round(bytes);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    if (block_size_ == 0)
+        block_size_ = size;
+
+    if (size != block_size_)
+        return ::operator new(bytes);
+
+    if (free_.empty())
+    {
+        const auto slab = static_cast<char*>(
+            ::operator new(block_size_ * slab_blocks_));
+
+        slabs_.push_back(slab);
+        free_.reserve(slabs_.size() * slab_blocks_);
+
+        // Reverse order so that blocks are issued in address order.
+        for (auto block = slab_blocks_; block > 0; --block)
+            free_.push_back(slab + (block - 1u) * block_size_);
+    }
+
+    const auto block = free_.back();
+    free_.pop_back();
+    return block;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void state_pool::deallocate(void* block, size_t bytes)
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    if (round(bytes) != block_size_)
+    {
+        ::operator delete(block);
+        return;
+    }
+
+    free_.push_back(block);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/template_tree.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+static hash_digest parent(const hash_digest& left, const hash_digest& right)
+{
+    std::array<uint8_t, 2u * hash_size> concatenation;
+    std::copy(left.begin(), left.end(), concatenation.begin());
+    std::copy(right.begin(), right.end(), concatenation.begin() + hash_size);
+    return bitcoin_hash(concatenation);
+}
+
+// The leaf level always holds the (null) coinbase placeholder.
+template_tree::template_tree()
+  : levels_{ { null_hash } }
+{
+}
+
+size_t template_tree::size() const
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    shared_lock lock(mutex_);
+
+    return levels_.front().size() - 1u;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// A template is refilled by appending in dependency order and trimmed from
+// its tail, so the common prefix with the cached leaves is usually long.
+hash_list template_tree::update(const hash_list& hashes)
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    unique_lock lock(mutex_);
+
+    auto& leaves = levels_.front();
+    const auto cached = leaves.size() - 1u;
+    const auto common = std::min(cached, hashes.size());
+    const auto prefix = std::mismatch(hashes.begin(), hashes.begin() + common,
+        leaves.begin() + 1u).first - hashes.begin();
+
+    if (static_cast<size_t>(prefix) == cached && cached == hashes.size())
+        return branch_;
+
+    auto first = static_cast<size_t>(prefix) + 1u;
+    leaves.resize(first);
+    leaves.insert(leaves.end(), hashes.begin() + prefix, hashes.end());
+
+    // Each parent level is rehashed from above its first changed node, with
+    // an odd last node paired with itself.
+    size_t level = 0;
+    for (; levels_[level].size() > 1u; ++level)
+    {
+        if (levels_.size() == level + 1u)
+            levels_.emplace_back();
+
+        const auto& nodes = levels_[level];
+        auto& parents = levels_[level + 1u];
+        const auto last = nodes.size() - 1u;
+        first /= 2u;
+        parents.resize((nodes.size() + 1u) / 2u);
+
+        for (auto position = first; position < parents.size(); ++position)
+        {
+            const auto left = 2u * position;
+            parents[position] = parent(nodes[left],
+                nodes[std::min(left + 1u, last)]);
+        }
+    }
+
+    levels_.resize(level + 1u);
+    branch_.clear();
+    branch_.reserve(level);
+
+    // The sibling of the coinbase path is node one of each level below root.
+    for (size_t index = 0; index < level; ++index)
+        branch_.push_back(levels_[index][1]);
+
+    return branch_;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// The coinbase is the first leaf, so its path is always the left child.
+hash_digest template_tree::root(const hash_digest& coinbase,
+    const hash_list& branch)
+{
+    auto hash = coinbase;
+
+    for (const auto& sibling: branch)
+        hash = parent(hash, sibling);
+
+    return hash;
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
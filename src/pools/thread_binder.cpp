@@ -0,0 +1,165 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/thread_binder.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <bitcoin/bitcoin.hpp>
+
+#ifdef __linux__
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+namespace libbitcoin {
+namespace blockchain {
+
+// The rendezvous of the threads of a pool upon binding.
+struct thread_binder::binding
+{
+    explicit binding(size_t threads)
+      : threads(threads), started(0), failed(0)
+    {
+    }
+
+    const size_t threads;
+    size_t started;
+    std::atomic<size_t> failed;
+    std::mutex mutex;
+    std::condition_variable ready;
+};
+
+thread_binder::cpus thread_binder::node_cpus(uint32_t node)
+{
+    std::string list;
+    std::ifstream file("/sys/devices/system/node/node" +
+        std::to_string(node) + "/cpulist");
+
+    if (!file || !std::getline(file, list))
+        return {};
+
+    return parse(list);
+}
+
+thread_binder::cpus thread_binder::parse(const std::string& list)
+{
+    cpus out;
+    size_t position = 0;
+
+    while (position < list.size() && list[position] != '\n')
+    {
+        const auto end = list.find_first_of(",\n", position);
+        const auto range = list.substr(position, end - position);
+        const auto dash = range.find('-');
+
+        try
+        {
+            const auto first = std::stoul(range.substr(0, dash));
+            const auto last = dash == std::string::npos ? first :
+                std::stoul(range.substr(dash + 1u));
+
+            if (last < first)
+                return {};
+
+            for (auto cpu = first; cpu <= last; ++cpu)
+                out.push_back(static_cast<uint32_t>(cpu));
+        }
+        catch (const std::exception&)
+        {
+            return {};
+        }
+
+        if (end == std::string::npos)
+            break;
+
+        position = end + 1u;
+    }
+
+    return out;
+}
+
+bool thread_binder::bind(const cpus& processors)
+{
+    if (processors.empty())
+        return false;
+
+#ifdef __linux__
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+
+    for (const auto cpu: processors)
+        if (cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &mask);
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) == 0;
+#else
+    return false;
+#endif
+}
+
+// The pool must be idle, otherwise a busy thread delays the others.
+bool thread_binder::bind(threadpool& pool, const cpus& processors)
+{
+    const auto threads = pool.size();
+
+    if (threads == 0)
+        return true;
+
+    const auto state = std::make_shared<binding>(threads);
+
+    for (size_t thread = 0; thread < threads; ++thread)
+    {
+        pool.service().post([state, processors]()
+        {
+            if (!bind(processors))
+                ++state->failed;
+
+            // Hold this thread so that each thread runs one binding.
+            std::unique_lock<std::mutex> lock(state->mutex);
+
+            if (++state->started == state->threads)
+            {
+                state->ready.notify_all();
+                return;
+            }
+
+            state->ready.wait(lock, [&state]()
+            {
+                return state->started == state->threads;
+            });
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->ready.wait(lock, [&state]()
+    {
+        return state->started == state->threads;
+    });
+
+    return state->failed == 0;
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
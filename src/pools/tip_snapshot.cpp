@@ -0,0 +1,220 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/tip_snapshot.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <iterator>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/pools/header_window.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+using namespace bc::chain;
+using namespace bc::config;
+
+// Incremented upon any change to the serialization.
+static constexpr uint32_t snapshot_version = 1;
+
+static void write_checkpoint(writer& sink, const checkpoint& value)
+{
+    sink.write_hash(value.hash());
+    sink.write_8_bytes_little_endian(value.height());
+}
+
+static checkpoint read_checkpoint(reader& source)
+{
+    const auto hash = source.read_hash();
+    const auto height = source.read_8_bytes_little_endian();
+    return { hash, static_cast<size_t>(height) };
+}
+
+// Work is written as little-endian 64 bit limbs.
+static void write_work(writer& sink, const uint256_t& value)
+{
+    for (size_t limb = 0; limb < 4u; ++limb)
+        sink.write_8_bytes_little_endian(static_cast<uint64_t>(
+            (value >> (limb * 64u)) & max_uint64));
+}
+
+static uint256_t read_work(reader& source)
+{
+    uint256_t value = 0;
+
+    for (size_t limb = 0; limb < 4u; ++limb)
+        value |= uint256_t(source.read_8_bytes_little_endian()) <<
+            (limb * 64u);
+
+    return value;
+}
+
+template <typename Column>
+static void write_column(writer& sink, const Column& column)
+{
+    sink.write_variable_little_endian(column.size());
+
+    for (const auto value: column)
+        sink.write_4_bytes_little_endian(value);
+}
+
+template <typename Column>
+static void read_column(reader& source, Column& out_column)
+{
+    const auto count = source.read_size_little_endian();
+    out_column.clear();
+
+    for (size_t index = 0; index < count && source; ++index)
+        out_column.push_back(source.read_4_bytes_little_endian());
+}
+
+static void write_state(writer& sink, const chain_state::data& data)
+{
+    sink.write_8_bytes_little_endian(data.height);
+    sink.write_hash(data.hash);
+    sink.write_4_bytes_little_endian(data.bits.self);
+    write_column(sink, data.bits.ordered);
+    sink.write_4_bytes_little_endian(data.version.self);
+    write_column(sink, data.version.ordered);
+    sink.write_4_bytes_little_endian(data.timestamp.self);
+    sink.write_4_bytes_little_endian(data.timestamp.retarget);
+    write_column(sink, data.timestamp.ordered);
+    sink.write_hash(data.bip9_bit0_hash);
+    sink.write_hash(data.bip9_bit1_hash);
+}
+
+static void read_state(reader& source, chain_state::data& out_data)
+{
+    out_data.height = source.read_8_bytes_little_endian();
+    out_data.hash = source.read_hash();
+    out_data.bits.self = source.read_4_bytes_little_endian();
+    read_column(source, out_data.bits.ordered);
+    out_data.version.self = source.read_4_bytes_little_endian();
+    read_column(source, out_data.version.ordered);
+    out_data.timestamp.self = source.read_4_bytes_little_endian();
+    out_data.timestamp.retarget = source.read_4_bytes_little_endian();
+    read_column(source, out_data.timestamp.ordered);
+    out_data.bip9_bit0_hash = source.read_hash();
+    out_data.bip9_bit1_hash = source.read_hash();
+}
+
+tip_snapshot::tip_snapshot(const boost::filesystem::path& file,
+    const hash_digest& context)
+  : file_(file), context_(context)
+{
+}
+
+// The payload is followed by its checksum, which is verified before parsing.
+bool tip_snapshot::load(tips& out_tips, header_window& candidate,
+    header_window& confirmed) const
+{
+    data_chunk data;
+
+    {
+        boost::filesystem::ifstream in(file_, std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(in),
+            std::istreambuf_iterator<char>());
+    }
+
+    // The snapshot is consumed whether or not it is valid.
+    boost::system::error_code ec;
+    boost::filesystem::remove(file_, ec);
+
+    if (data.size() < hash_size)
+        return false;
+
+    const auto payload_size = data.size() - hash_size;
+    const auto checksum = bitcoin_hash(
+        data_slice(data.data(), data.data() + payload_size));
+
+    if (!std::equal(checksum.begin(), checksum.end(),
+        data.begin() + payload_size))
+        return false;
+
+    data.resize(payload_size);
+    data_source istream(data);
+    istream_reader source(istream);
+
+    if (source.read_4_bytes_little_endian() != snapshot_version ||
+        source.read_hash() != context_)
+        return false;
+
+    out_tips.candidate_top = read_checkpoint(source);
+    out_tips.confirmed_top = read_checkpoint(source);
+    out_tips.fork_point = read_checkpoint(source);
+    out_tips.candidate_work = read_work(source);
+    out_tips.confirmed_work = read_work(source);
+    read_state(source, out_tips.top_candidate_state);
+    read_state(source, out_tips.top_valid_candidate_state);
+    read_state(source, out_tips.next_confirmed_state);
+
+    return source && candidate.from_data(source) &&
+        confirmed.from_data(source) && source.is_exhausted();
+}
+
+// The snapshot is written to a temporary and then renamed over the prior, so
+// that an interrupted write does not leave a partial snapshot.
+bool tip_snapshot::save(const tips& tips, const header_window& candidate,
+    const header_window& confirmed) const
+{
+    data_chunk data;
+
+    {
+        data_sink ostream(data);
+        ostream_writer sink(ostream);
+        sink.write_4_bytes_little_endian(snapshot_version);
+        sink.write_hash(context_);
+        write_checkpoint(sink, tips.candidate_top);
+        write_checkpoint(sink, tips.confirmed_top);
+        write_checkpoint(sink, tips.fork_point);
+        write_work(sink, tips.candidate_work);
+        write_work(sink, tips.confirmed_work);
+        write_state(sink, tips.top_candidate_state);
+        write_state(sink, tips.top_valid_candidate_state);
+        write_state(sink, tips.next_confirmed_state);
+        candidate.to_data(sink);
+        confirmed.to_data(sink);
+        ostream.flush();
+    }
+
+    extend_data(data, bitcoin_hash(data));
+
+    auto temporary = file_;
+    temporary += ".tmp";
+
+    {
+        boost::filesystem::ofstream out(temporary,
+            std::ios::binary | std::ios::trunc);
+
+        if (!out.write(reinterpret_cast<const char*>(data.data()),
+            data.size()))
+            return false;
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::rename(temporary, file_, ec);
+    return !ec;
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
@@ -0,0 +1,187 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/transaction_cache.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+// Allowance for the list node, map node and shared pointer beyond the tx.
+static constexpr size_t entry_overhead = 256;
+static constexpr size_t megabyte = 1024 * 1024;
+
+// The witness flag is the low bit of the key, so both forms of a tx are
+// cached independently (in the same shard).
+static uint64_t to_key(uint64_t link, bool witness)
+{
+    return (link << 1) | (witness ? 1u : 0u);
+}
+
+static size_t entry_bytes(const transaction& tx, bool witness)
+{
+    return tx.serialized_size(true, witness) + entry_overhead;
+}
+
+transaction_cache::transaction_cache(size_t maximum_megabytes, size_t shards)
+  : maximum_bytes_(maximum_megabytes * megabyte),
+    hits_(0),
+    queries_(0)
+{
+    shards_.reserve(std::max(shards, size_t(1)));
+
+    for (size_t index = 0; index < shards_.capacity(); ++index)
+    {
+        shards_.emplace_back(new shard);
+        shards_.back()->bytes = 0;
+    }
+}
+
+bool transaction_cache::disabled() const
+{
+    return maximum_bytes_ == 0;
+}
+
+size_t transaction_cache::size() const
+{
+    size_t count = 0;
+
+    for (const auto& shard: shards_)
+    {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        std::unique_lock<std::mutex> lock(shard->mutex);
+        count += shard->map.size();
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    return count;
+}
+
+size_t transaction_cache::bytes() const
+{
+    size_t bytes = 0;
+
+    for (const auto& shard: shards_)
+    {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        std::unique_lock<std::mutex> lock(shard->mutex);
+        bytes += shard->bytes;
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    return bytes;
+}
+
+float transaction_cache::hit_rate() const
+{
+    // These values could overflow or divide by zero, but that's okay.
+    return queries_ == 0 ? 0.0f : (hits_ * 1.0f / queries_);
+}
+
+transaction_const_ptr transaction_cache::get(uint64_t link, bool witness)
+{
+    if (disabled())
+        return{};
+
+    ++queries_;
+    const auto key = to_key(link, witness);
+    auto& shard = to_shard(key);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    const auto it = shard.map.find(key);
+
+    if (it == shard.map.end())
+        return{};
+
+    // A hit becomes the most recently used.
+    shard.order.splice(shard.order.end(), shard.order, it->second);
+    const auto tx = it->second->second;
+    ///////////////////////////////////////////////////////////////////////////
+
+    ++hits_;
+    return tx;
+}
+
+void transaction_cache::add(uint64_t link, bool witness,
+    transaction_const_ptr tx)
+{
+    const auto budget = maximum_bytes_ / shards_.size();
+    const auto bytes = entry_bytes(*tx, witness);
+
+    if (disabled() || bytes > budget)
+        return;
+
+    const auto key = to_key(link, witness);
+    auto& shard = to_shard(key);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::unique_lock<std::mutex> lock(shard.mutex);
+
+    // The tx of a link never changes.
+    if (shard.map.find(key) != shard.map.end())
+        return;
+
+    shard.map.emplace(key, shard.order.insert(shard.order.end(),
+        entry{ key, tx }));
+    shard.bytes += bytes;
+
+    while (shard.bytes > budget && !shard.order.empty())
+    {
+        const auto& oldest = shard.order.front();
+        shard.bytes -= entry_bytes(*oldest.second, (oldest.first & 1u) != 0);
+        shard.map.erase(oldest.first);
+        shard.order.pop_front();
+    }
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void transaction_cache::clear()
+{
+    for (const auto& shard: shards_)
+    {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        std::unique_lock<std::mutex> lock(shard->mutex);
+        shard->map.clear();
+        shard->order.clear();
+        shard->bytes = 0;
+        ///////////////////////////////////////////////////////////////////////
+    }
+}
+
+// private
+// Store links are sequential offsets, so the key is mixed before reduction.
+transaction_cache::shard& transaction_cache::to_shard(uint64_t key)
+{
+    const auto mixed = key * 0x9e3779b97f4a7c15ull;
+    return *shards_[(mixed >> 32) % shards_.size()];
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
@@ -34,17 +34,26 @@ inline uint32_t cap(size_t value)
     return domain_constrain<uint32_t>(value);
 }
 
-// TODO: implement size, sigops, and fees caching on chain::transaction.
-// This requires the full population of transaction.metadata metadata.
 transaction_entry::transaction_entry(transaction_const_ptr tx)
+ : transaction_entry(tx, tx->signature_operations())
+{
+}
+
+// TODO: implement size and fees caching on chain::transaction.
+// This requires the full population of transaction.metadata metadata.
+// Sigops are counted by the caller, so a pool tx is not counted again.
+transaction_entry::transaction_entry(transaction_const_ptr tx, size_t sigops)
  : size_(cap(tx->serialized_size(message::version::level::canonical))),
-   sigops_(cap(tx->signature_operations())),
+   sigops_(cap(sigops)),
    fees_(tx->fees()),
    forks_(tx->metadata.state->enabled_forks()),
    hash_(tx->hash()),
+   transaction_(tx),
    parents_(),
-   children_()
+   children_(),
+   mark_(0)
 {
+    parents_.reserve(tx->inputs().size());
 }
 
 // Create a search key.
@@ -54,9 +63,27 @@ transaction_entry::transaction_entry(const hash_digest& hash)
    fees_(0),
    forks_(0),
    hash_(hash),
+   transaction_(),
    parents_(),
-   children_()
+   children_(),
+   mark_(0)
+{
+}
+
+transaction_entry::ptr transaction_entry::create(transaction_const_ptr tx)
+{
+    return std::allocate_shared<transaction_entry>(allocator(), tx);
+}
+
+transaction_entry::ptr transaction_entry::create(transaction_const_ptr tx,
+    size_t sigops)
 {
+    return std::allocate_shared<transaction_entry>(allocator(), tx, sigops);
+}
+
+transaction_entry::ptr transaction_entry::create(const hash_digest& hash)
+{
+    return std::allocate_shared<transaction_entry>(allocator(), hash);
 }
 
 transaction_entry::~transaction_entry()
@@ -100,6 +127,11 @@ const hash_digest& transaction_entry::hash() const
     return hash_;
 }
 
+transaction_const_ptr transaction_entry::transaction() const
+{
+    return transaction_;
+}
+
 // Not valid if the entry is a search key.
 const transaction_entry::list& transaction_entry::parents() const
 {
@@ -112,6 +144,16 @@ const transaction_entry::indexed_list& transaction_entry::children() const
     return children_;
 }
 
+uint64_t transaction_entry::mark() const
+{
+    return mark_;
+}
+
+void transaction_entry::set_mark(uint64_t epoch)
+{
+    mark_ = epoch;
+}
+
 // This is not guarded against redundant entries.
 void transaction_entry::add_parent(ptr parent)
 {
@@ -18,9 +18,14 @@
  */
 #include <bitcoin/blockchain/pools/transaction_pool.hpp>
 
+#include <algorithm>
 #include <cstddef>
 #include <deque>
+#include <iterator>
 #include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/blockchain/settings.hpp>
 #include <bitcoin/blockchain/pools/anchor_converter.hpp>
@@ -28,11 +33,17 @@
 #include <bitcoin/blockchain/pools/conflicting_spend_remover.hpp>
 #include <bitcoin/blockchain/pools/parent_closure_calculator.hpp>
 #include <bitcoin/blockchain/pools/priority_calculator.hpp>
-#include <bitcoin/blockchain/pools/transaction_order_calculator.hpp>
 
 namespace libbitcoin {
 namespace blockchain {
 
+using namespace bc::chain;
+
+typedef transaction_pool_state::by_priority by_priority;
+typedef transaction_pool_state::by_sequence by_sequence;
+typedef transaction_pool_state::by_mempool by_mempool;
+typedef transaction_pool_state::priority_index::reverse_iterator reverse;
+
 // Duplicate tx hashes are disallowed in a block and therefore same in pool.
 // A transaction hash that exists unspent in the chain is still not acceptable
 // even if the original becomes spent in the same block, because the BIP30
@@ -41,134 +52,536 @@ namespace blockchain {
 
 transaction_pool::priority anchor_priority = 0.0;
 
-transaction_pool::transaction_pool(const settings& )
+// The smallest tx, and the template refill bound once nearly full (these are
+// the values used by the satoshi client for package selection).
+static constexpr size_t minimum_transaction_bytes = 60;
+static constexpr size_t maximum_consecutive_failures = 1000;
+static constexpr size_t nearly_full_bytes = 4000;
+
+transaction_pool::transaction_pool(const settings& settings,
+    script_cache& cache)
+  : maximum_bytes_(static_cast<size_t>(settings.transaction_pool_megabytes) *
+        1024u * 1024u),
+    state_(settings),
+    popped_sequence_(0),
+    script_cache_(cache)
   ////: reject_conflicts_(settings.reject_conflicts),
   ////  minimum_fee_(settings.minimum_fee_satoshis)
 {
 }
 
-// TODO: implement.
-bool transaction_pool::exists(transaction_const_ptr /*tx*/) const
+// This locates only unconfirmed transactions stored since startup.
+bool transaction_pool::exists(transaction_const_ptr tx) const
+{
+    return hashes_.contains(tx->hash());
+}
+
+void transaction_pool::add(transaction_const_ptr tx)
+{
+    hashes_.insert(tx->hash());
+    add_unconfirmed_transactions({ tx });
+}
+
+// A coinbase cannot be unconfirmed, so it is not pooled.
+// Popped txs lack populated prevouts, so they are not templated. A popped tx
+// anchoring pooled children is no longer confirmed, so the anchor is evicted
+// with its descendants, which would otherwise be templated without it.
+void transaction_pool::add(block_const_ptr block)
+{
+    const auto& txs = block->transactions();
+
+    for (auto tx = std::next(txs.begin()); tx != txs.end(); ++tx)
+        hashes_.insert(tx->hash());
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    unique_lock lock(mutex_);
+
+    // Prevouts of txs pooled before the pop may no longer be confirmed.
+    popped_sequence_ = state_.next_sequence();
+
+    const auto template_bytes = state_.block_template_bytes;
+    conflicting_spend_remover remover(state_);
+
+    for (auto tx = std::next(txs.begin()); tx != txs.end(); ++tx)
+    {
+        const auto it = state_.pool.find(transaction_entry::create(
+            tx->hash()));
+
+        if (it != state_.pool.end())
+            remover.enqueue(it->entry);
+    }
+
+    remover.deconflict();
+
+    if (state_.block_template_bytes < template_bytes)
+        fill_template();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void transaction_pool::remove(block_const_ptr block)
 {
-    return false;
+    const auto& txs = block->transactions();
+    hash_list confirmed;
+    point::list spends;
+    confirmed.reserve(txs.size());
+
+    for (const auto& tx: txs)
+    {
+        hashes_.erase(tx.hash());
+        confirmed.push_back(tx.hash());
+
+        // A coinbase input does not spend a previous output.
+        if (tx.is_coinbase())
+            continue;
+
+        for (const auto& input: tx.inputs())
+            spends.push_back(input.previous_output());
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    unique_lock lock(mutex_);
+
+    remove_spends(confirmed, spends);
+    ///////////////////////////////////////////////////////////////////////////
 }
 
-// TODO: implement (performance optimization for tx filtering via store).
-void transaction_pool::filter(get_data_ptr /*message*/) const
+// A pooled tx was populated against the confirmed chain for the next block,
+// which is the context of a block extending the confirmed top. Its prevouts
+// confirmed then remain confirmed unless popped since, and remain unspent,
+// as a confirmed spend removes its pooled conflicts. Others are left to the
+// store.
+size_t transaction_pool::populate(const block& block,
+    std::vector<bool>& out_populated) const
 {
-    BITCOIN_ASSERT_MSG(false, "not implemented");
+    const auto& txs = block.transactions();
+    out_populated.assign(block.total_non_coinbase_inputs(), false);
+    size_t populated = 0;
+    size_t ordinal = 0;
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    shared_lock lock(mutex_);
+
+    // A coinbase cannot be pooled.
+    for (auto tx = std::next(txs.begin()); tx != txs.end(); ++tx)
+    {
+        const auto& inputs = tx->inputs();
+        const auto it = state_.pool.find(transaction_entry::create(
+            tx->hash()));
+
+        if (it == state_.pool.end() || it->entry->is_anchor() ||
+            it->sequence < popped_sequence_)
+        {
+            ordinal += inputs.size();
+            continue;
+        }
+
+        // The txid commits to the inputs, so these correspond by index.
+        const auto& pooled = it->entry->transaction()->inputs();
+        BITCOIN_ASSERT(pooled.size() == inputs.size());
+
+        for (size_t index = 0; index < inputs.size(); ++index, ++ordinal)
+        {
+            const auto& source = pooled[index].previous_output().metadata;
+
+            if (!source.confirmed || source.spent ||
+                !source.cache.is_valid())
+                continue;
+
+            inputs[index].previous_output().metadata = source;
+            out_populated[ordinal] = true;
+            ++populated;
+        }
+    }
+    ///////////////////////////////////////////////////////////////////////////
+
+    return populated;
 }
 
-void transaction_pool::fetch_template(merkle_block_fetch_handler handler) const
+// Compacts in a single pass, avoiding repeated vector shifts on erase.
+void transaction_pool::filter(get_data_ptr message) const
 {
-    const size_t height = max_size_t;
-    const auto block = std::make_shared<message::merkle_block>();
-    handler(error::success, block, height);
+    auto& inventories = message->inventories();
+
+    const auto pooled = [this](const message::inventory_vector& inventory)
+    {
+        return inventory.is_transaction_type() &&
+            hashes_.contains(inventory.hash());
+    };
+
+    inventories.erase(std::remove_if(inventories.begin(), inventories.end(),
+        pooled), inventories.end());
 }
 
-// TODO: implement mempool message payload discovery.
-void transaction_pool::fetch_mempool(size_t /*count_limit*/,
-    uint64_t /*minimum_fee*/, inventory_fetch_handler handler) const
+// The minimum fee is a rate in satoshis per kilobyte (as BIP133 feefilter).
+// The mempool index is read in order, so cost is bounded by the count limit.
+void transaction_pool::fetch_mempool(size_t count_limit, uint64_t minimum_fee,
+    inventory_fetch_handler handler) const
 {
-    const auto empty = std::make_shared<message::inventory>();
-    handler(error::success, empty);
+    static const auto type = message::inventory_vector::type_id::transaction;
+    const auto minimum_rate = minimum_fee / 1000.0;
+    const auto minimum_bucket = transaction_pool_state::to_bucket(
+        minimum_rate);
+    message::inventory_vector::list inventories;
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    shared_lock lock(mutex_);
+
+    const auto& index = state_.pool.get<by_mempool>();
+    for (auto it = index.begin(); it != index.end() &&
+        it->bucket >= minimum_bucket && inventories.size() < count_limit; ++it)
+    {
+        // Children of a skipped tx are also skipped, as they rate no higher.
+        if (it->rate >= minimum_rate)
+            inventories.push_back({ type, it->entry->hash() });
+    }
+    ///////////////////////////////////////////////////////////////////////////
+
+    handler(error::success, std::make_shared<message::inventory>(
+        std::move(inventories)));
 }
 
-// TODO: implement block template discovery.
+// Template entries are ordered such that parents precede children.
 transaction_entry::list transaction_pool::get_template() const
 {
     transaction_entry::list result;
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    shared_lock lock(mutex_);
+
+    const auto range = state_.pool.get<by_sequence>().equal_range(true);
+    for (auto it = range.first; it != range.second; ++it)
+        result.push_back(it->entry);
+    ///////////////////////////////////////////////////////////////////////////
+
     return result;
 }
 
-// TODO: implement mempool message payload discovery.
+size_t transaction_pool::bytes() const
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    shared_lock lock(mutex_);
+    return state_.pool_bytes;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// Eviction is by lowest descendant feerate, as when over the pool bound (a
+// zero bound disables trim, so one byte is the floor).
+void transaction_pool::shed(size_t bytes)
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    unique_lock lock(mutex_);
+    trim(std::max(floor_subtract(state_.pool_bytes, bytes), size_t(1)));
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// Mempool entries are ordered by rate bucket, with parents preceding children.
 transaction_entry::list transaction_pool::get_mempool() const
 {
     transaction_entry::list result;
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    shared_lock lock(mutex_);
+
+    const auto& index = state_.pool.get<by_mempool>();
+    for (auto it = index.begin(); it != index.end() &&
+        it->bucket != transaction_pool_state::anchor_bucket; ++it)
+        result.push_back(it->entry);
+    ///////////////////////////////////////////////////////////////////////////
+
+    return result;
+}
+
+// Short ids are keyed by the block, so they are computed over the pool for
+// each compact block. Colliding pooled txs are both treated as unmatched.
+transaction_const_ptr_list transaction_pool::reconstruct(
+    const message::compact_block& block) const
+{
+    const auto& short_ids = block.short_ids();
+    const auto& prefilled = block.transactions();
+    transaction_const_ptr_list result(short_ids.size() + prefilled.size());
+
+    for (const auto& tx: prefilled)
+    {
+        if (tx.index() >= result.size() || result[tx.index()])
+            return{};
+
+        result[tx.index()] = std::make_shared<const message::transaction>(
+            tx.transaction());
+    }
+
+    const auto key = to_short_id_key(block.header(), block.nonce());
+    std::unordered_map<uint64_t, transaction_const_ptr> matches;
+    matches.reserve(short_ids.size());
+
+    for (const auto& id: short_ids)
+        matches.emplace(to_short_id(id), nullptr);
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    shared_lock lock(mutex_);
+
+    for (const auto& record: state_.pool)
+    {
+        const auto tx = record.entry->transaction();
+
+        if (!tx || record.entry->is_anchor())
+            continue;
+
+        const auto it = matches.find(to_short_id(key, record.entry->hash()));
+
+        if (it == matches.end())
+            continue;
+
+        // A second match makes the short id ambiguous, so it is requested.
+        if (it->second)
+            matches.erase(it);
+        else
+            it->second = tx;
+    }
+    ///////////////////////////////////////////////////////////////////////////
+
+    auto id = short_ids.begin();
+
+    for (auto& tx: result)
+    {
+        if (tx)
+            continue;
+
+        const auto it = matches.find(to_short_id(*id++));
+
+        if (it != matches.end())
+            tx = it->second;
+    }
+
     return result;
 }
 
+half_hash transaction_pool::to_short_id_key(const chain::header& header,
+    uint64_t nonce)
+{
+    const auto digest = sha256_hash(build_chunk(
+    {
+        header.to_data(),
+        to_little_endian(nonce)
+    }));
+
+    half_hash key;
+    std::copy_n(digest.begin(), key.size(), key.begin());
+    return key;
+}
+
+uint64_t transaction_pool::to_short_id(const half_hash& key,
+    const hash_digest& hash)
+{
+    static constexpr uint64_t mask = (uint64_t(1) << 48) - 1u;
+    return siphash(key, hash) & mask;
+}
+
+uint64_t transaction_pool::to_short_id(const mini_hash& id)
+{
+    uint64_t value = 0;
+
+    for (size_t byte = 0; byte < id.size(); ++byte)
+        value |= uint64_t(id[byte]) << (8 * byte);
+
+    return value;
+}
+
+mini_hash transaction_pool::to_mini_hash(uint64_t short_id)
+{
+    mini_hash id;
+
+    for (size_t byte = 0; byte < id.size(); ++byte)
+        id[byte] = static_cast<uint8_t>(short_id >> (8 * byte));
+
+    return id;
+}
+
+// Parents must precede children in the list (as they do in the store).
 void transaction_pool::add_unconfirmed_transactions(
     const transaction_const_ptr_list& unconfirmed_txs)
 {
-//    tranasaction_entry::ptr max_introduced(null_hash);
-    auto max_introduced = state_.pool.left.end();
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    unique_lock lock(mutex_);
 
-    // order the transactions to be added preferring parents before children
+    for (const auto& tx: unconfirmed_txs)
+    {
+        const auto entry = add_entry(tx);
 
-    // for each entry to be added, check whether an entry already exists
-    // if the entry exists
-        // if an anchor, add parent anchors, for each ancestor, recalculate priority
-    // if the entry is new, add it
+        // The new entry only competes for the template tail below it.
+        if (entry)
+            add_package(entry);
+    }
 
-    for (const auto& tx: unconfirmed_txs)
+    trim(maximum_bytes_);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void transaction_pool::remove_transactions(transaction_const_ptr_list& txs)
+{
+    hash_list confirmed;
+    point::list spends;
+    confirmed.reserve(txs.size());
+
+    for (const auto& tx: txs)
     {
-        auto unconfirmed_entry = std::make_shared<transaction_entry>(tx);
-        uint32_t i = 0;
+        confirmed.push_back(tx->hash());
 
-        // Add/retrieve anchors for each transaction
-        for (const auto& input : tx->inputs())
-        {
-            auto lookup_entry = std::make_shared<transaction_entry>(
-                    input.previous_output().hash());
+        for (const auto& input: tx->inputs())
+            spends.push_back(input.previous_output());
+    }
 
-            const auto it = state_.pool.left.find(lookup_entry);
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    unique_lock lock(mutex_);
 
-            auto input_entry = (it != state_.pool.left.end()) ?
-                it->first : lookup_entry;
+    remove_spends(confirmed, spends);
+    ///////////////////////////////////////////////////////////////////////////
+}
 
-            if (input_entry == lookup_entry)
-                state_.pool.insert({ input_entry, anchor_priority });
+// private
+//-----------------------------------------------------------------------------
 
-            unconfirmed_entry->add_child(i, input_entry);
-            i++;
-        }
+// Returns nullptr if the tx is already pooled, or if it spends an unconfirmed
+// tx that is not pooled (evicted or popped), as it could not be templated.
+transaction_entry::ptr transaction_pool::add_entry(transaction_const_ptr tx)
+{
+    const auto key = transaction_entry::create(tx->hash());
+
+    if (state_.exists(key))
+        return nullptr;
 
-        // Add unconfirmed transaction
-        priority unconfirmed_priority = calculate_priority(unconfirmed_entry);
+    const auto& inputs = tx->inputs();
 
-        state_.pool.insert({ unconfirmed_entry, unconfirmed_priority });
+    for (const auto& input: inputs)
+    {
+        const auto& prevout = input.previous_output();
 
-        // track encountered maximum priority
-        if (unconfirmed_priority > max_introduced->second)
-            max_introduced = state_.pool.left.find(unconfirmed_entry);
+        if (!prevout.metadata.confirmed && !state_.exists(
+            transaction_entry::create(prevout.hash())))
+            return nullptr;
     }
 
-    // Using remembered highest priority inserted new transaction,
-    // invalidate cached solution below priority and recompute.
-    if (unconfirmed_txs.size() > 0)
+    const auto entry = transaction_entry::create(tx,
+        script_cache_.signature_operations(*tx));
+
+    // Link to pooled parents, or to anchors binding confirmed parents.
+    for (const auto& input: inputs)
     {
-        auto projected = state_.pool.project_right(max_introduced);
-        update_template(projected);
+        const auto& prevout = input.previous_output();
+        const auto lookup = transaction_entry::create(prevout.hash());
+        const auto it = state_.pool.find(lookup);
+        const auto parent = (it == state_.pool.end()) ? lookup : it->entry;
+
+        if (parent == lookup)
+            state_.insert(parent, anchor_priority);
+
+        parent->add_child(prevout.index(), entry);
+        entry->add_parent(parent);
     }
+
+    state_.insert(entry, calculate_priority(entry));
+    return entry;
 }
 
-void transaction_pool::remove_transactions(transaction_const_ptr_list& txs)
+// The tx and its untemplated ancestors are added as a package, evicting
+// lower priority template entries if required. Returns true if added.
+bool transaction_pool::add_package(transaction_entry::ptr entry)
+{
+    const auto member = state_.pool.find(entry);
+    if (member == state_.pool.end())
+        return false;
+
+    const auto value = member->value;
+    const auto closure = get_parent_closure(entry);
+    size_t bytes = 0;
+    size_t sigops = 0;
+    transaction_entry::list package;
+
+    for (const auto& element: closure)
+    {
+        if (!element->is_anchor() && !state_.templated(element))
+        {
+            bytes += element->size();
+            sigops += element->sigops();
+            package.push_back(element);
+        }
+    }
+
+    if (package.empty())
+        return false;
+
+    size_t freed_bytes = 0;
+    size_t freed_sigops = 0;
+    transaction_entry::list evictions;
+    const auto templated = state_.pool.get<by_priority>().equal_range(true);
+
+    const auto evicted = [&](const transaction_entry::ptr& candidate)
+    {
+        return std::find(evictions.begin(), evictions.end(), candidate) !=
+            evictions.end();
+    };
+
+    const auto ancestor = [&](const transaction_entry::ptr& candidate)
+    {
+        return std::find(closure.begin(), closure.end(), candidate) !=
+            closure.end();
+    };
+
+    // Evict from the lowest priority, sparing parents of retained txs.
+    for (reverse it(templated.second); it != reverse(templated.first) &&
+        it->value < value && !fits(bytes, sigops, freed_bytes, freed_sigops);
+        ++it)
+    {
+        auto spared = ancestor(it->entry);
+        for (const auto& child: it->entry->children().left)
+            spared |= state_.templated(child.second) &&
+                !evicted(child.second);
+
+        if (spared)
+            continue;
+
+        freed_bytes += it->entry->size();
+        freed_sigops += it->entry->sigops();
+        evictions.push_back(it->entry);
+    }
+
+    if (!fits(bytes, sigops, freed_bytes, freed_sigops))
+        return false;
+
+    for (const auto& eviction: evictions)
+        state_.deselect(eviction);
+
+    // The sequence index retains dependency order, so there is no sort.
+    for (const auto& element: package)
+        state_.select(element);
+
+    return true;
+}
+
+void transaction_pool::remove_spends(const hash_list& confirmed,
+    const point::list& spends)
 {
     anchor_converter anchorizer(state_);
     conflicting_spend_remover deconflictor(state_);
 
     // generate map of initial txs
-    for (auto& tx : txs)
-        anchorizer.add_bounds(tx);
+    for (const auto& hash: confirmed)
+        anchorizer.add_bounds(hash);
 
     // compute coverage of inputs being spent
     std::map<hash_digest, std::map<uint32_t, bool>> input_indicies;
-    for (auto& tx : txs)
-    {
-        for (auto& input : tx->inputs())
-        {
-            auto it = input_indicies.find(input.previous_output().hash());
-            if (it == input_indicies.end())
-                input_indicies.insert({ input.previous_output().hash(),
-                    { { input.previous_output().index(), true } } });
-            else
-            {
-                if (it->second.find(input.previous_output().index()) == it->second.end())
-                    it->second.insert({ input.previous_output().index(), true });
-            }
-        }
-    }
+    for (const auto& point: spends)
+        input_indicies[point.hash()].insert({ point.index(), true });
 
     // walk input transactions,
     for (auto& input_it : input_indicies)
@@ -176,12 +589,12 @@ void transaction_pool::remove_transactions(transaction_const_ptr_list& txs)
         if (anchorizer.within_bounds(input_it.first))
             continue;
 
-        auto key = std::make_shared<transaction_entry>(input_it.first);
-        auto member = state_.pool.left.find(key);
-        if (member == state_.pool.left.end())
+        auto key = transaction_entry::create(input_it.first);
+        auto member = state_.pool.find(key);
+        if (member == state_.pool.end())
             continue;
 
-        auto children = member->first->children().left;
+        auto children = member->entry->children().left;
         bool remove = (children.size() == input_it.second.size());
 
         for (auto index_it : input_it.second)
@@ -202,30 +615,116 @@ void transaction_pool::remove_transactions(transaction_const_ptr_list& txs)
         if (remove)
         {
             // NOTE: assert is inappropriate, but used to document assumption
-            BITCOIN_ASSERT(member->first->parents().size() == 0);
-            member->first->remove_children();
-            state_.pool.left.erase(member);
+            BITCOIN_ASSERT(member->entry->parents().size() == 0);
+            member->entry->remove_children();
+            state_.erase(key);
         }
     }
 
-    priority max_from_conflicts = deconflictor.deconflict();
+    deconflictor.deconflict();
+    anchorizer.demote();
 
-    priority max_from_demotion = anchorizer.demote();
+    // Confirmed txs that retain pooled children are now anchors, so the
+    // ancestor feerates of those children no longer include them.
+    for (const auto& hash: confirmed)
+    {
+        const auto key = transaction_entry::create(hash);
+        const auto anchor = state_.pool.find(key);
 
-//    priority max_from_conflicts = remove_spend_conflicts(
-//        unconditional_removal);
-//
-//    priority max_from_demotion = demote(conditional_removal, removal_bounds);
+        if (anchor != state_.pool.end())
+        {
+            const auto entry = anchor->entry;
+            state_.set_priority(entry, anchor_priority);
+            reprioritize(entry);
+        }
+    }
+
+    // Confirmation only opens space, so refill from the top of the pool.
+    fill_template();
+}
+
+// Ancestor feerates of descendants change when an ancestor is confirmed.
+// The closure is cached for the anchor, and thereafter maintained by state.
+void transaction_pool::reprioritize(transaction_entry::ptr anchor)
+{
+    child_closure_calculator calculator(state_);
+    auto closure = calculator.get_closure(anchor);
+
+    // Rates derive from those of parents, so update in dependency order.
+    std::sort(closure.begin(), closure.end(),
+        [this](const transaction_entry::ptr& left,
+            const transaction_entry::ptr& right)
+        {
+            return state_.sequence_of(left) < state_.sequence_of(right);
+        });
+
+    for (const auto& element: closure)
+        state_.set_priority(element, calculate_priority(element));
+
+    state_.cached_child_closures[anchor] = std::move(closure);
+}
+
+// Evict lowest descendant feerate packages until within the byte budget.
+// Evicted txs remain stored and hashed, so they are not accepted again, and
+// a later child of one is not pooled, as its parent is neither pooled nor
+// confirmed.
+void transaction_pool::trim(size_t maximum_bytes)
+{
+    if (maximum_bytes == 0)
+        return;
+
+    const auto template_bytes = state_.block_template_bytes;
+
+    while (state_.pool_bytes > maximum_bytes)
+    {
+        const auto entry = state_.lowest_descendant_rate();
+        if (!entry)
+            break;
+
+        // An evicted tx takes its descendants with it, as does a conflict.
+        conflicting_spend_remover remover(state_);
+        remover.enqueue(entry);
+        remover.deconflict();
+    }
 
-    priority max_removed = (max_from_conflicts > max_from_demotion) ?
-        max_from_conflicts : max_from_demotion;
+    if (state_.block_template_bytes < template_bytes)
+        fill_template();
+}
 
-    // Using remembered highest priority inserted new transaction,
-    // invalidate cached solution below priority and recompute.
-    if (txs.size() > 0)
+// Candidates are read by priority only until no tx could fit the space
+// opened, or until a run of packages fails to fit a nearly full template, so
+// the walk is bounded by the space opened rather than by the pool.
+void transaction_pool::fill_template()
+{
+    const auto reserved = state_.block_template_bytes +
+        state_.coinbase_byte_reserve;
+    const auto opened = floor_subtract(state_.template_byte_limit, reserved);
+    const auto limit = opened / minimum_transaction_bytes +
+        maximum_consecutive_failures;
+
+    // Collect first, as selection moves entries within the priority index.
+    transaction_entry::list candidates;
+    const auto range = state_.pool.get<by_priority>().equal_range(false);
+    for (auto it = range.first; it != range.second &&
+        candidates.size() < limit; ++it)
+        if (!it->entry->is_anchor())
+            candidates.push_back(it->entry);
+
+    size_t failures = 0;
+
+    for (const auto& candidate: candidates)
     {
-        auto inflection = find_inflection(state_.pool, max_removed);
-        update_template(inflection);
+        if (!fits(minimum_transaction_bytes, 0, 0, 0))
+            break;
+
+        if (state_.templated(candidate))
+            continue;
+
+        if (add_package(candidate))
+            failures = 0;
+        else if (++failures > maximum_consecutive_failures &&
+            !fits(nearly_full_bytes, 0, 0, 0))
+            break;
     }
 }
 
@@ -372,138 +871,24 @@ transaction_pool::priority transaction_pool::calculate_priority(
     uint64_t cumulative_fees = result.first;
     size_t cumulative_size = result.second;
 
-    // return ratio of size to rate
-    return (cumulative_size > 0) ? cumulative_fees / cumulative_size :
+    // return ancestor feerate (fees per byte of tx and unconfirmed ancestors)
+    return (cumulative_size > 0) ?
+        static_cast<priority>(cumulative_fees) / cumulative_size :
         std::numeric_limits<transaction_pool::priority>::max();
 }
 
-transaction_pool::priority_iterator transaction_pool::find_inflection(
-    transaction_pool_state::prioritized_transactions& container,
-    transaction_pool::priority value)
-{
-    priority_iterator changepoint = container.right.begin();
-
-    for (auto it = container.right.begin(); it != container.right.end(); ++it)
-    {
-        if (it->first <= value)
-        {
-            changepoint = it;
-            break;
-        }
-    }
-
-    return changepoint;
-}
-
-struct plus_sigops
+// Freed values are those of template entries pending eviction.
+bool transaction_pool::fits(size_t bytes, size_t sigops, size_t freed_bytes,
+    size_t freed_sigops) const
 {
-    size_t operator()(size_t lhs, const transaction_entry::ptr& rhs) const
-    {
-        return rhs ? lhs + rhs->sigops() : lhs;
-    }
-};
-
-struct plus_size
-{
-    size_t operator()(size_t lhs, const transaction_entry::ptr& rhs) const
-    {
-        return rhs ? lhs + rhs->size() : lhs;
-    }
-};
-
-void transaction_pool::update_template(priority_iterator max_pool_change)
-{
-    // as max_changepoint may not be a value within the template,
-    // walk the template entries until changepoint or a value less than it is
-    // discovered
-    auto template_point = find_inflection(state_.block_template,
-        max_pool_change->first);
-
-    // for each element in the template below this point, purge if
-    // not depended upon by an entry of higher priority
-    // alternately: scan closure of children for references in the template
-    // above this prioritization value
-    transaction_entry::list to_remove;
-    for (auto entry = template_point; entry != state_.block_template.right.end(); ++entry)
-    {
-        bool purge = true;
-        auto closure_element = state_.cached_child_closures.find(entry->second);
-
-        if (closure_element != state_.cached_child_closures.end())
-        {
-            for (auto child : closure_element->second)
-            {
-                auto child_in_template = state_.block_template.left.find(child);
-                if ((child_in_template != state_.block_template.left.end()) &&
-                    (child_in_template->second > max_pool_change->first))
-                {
-                    purge = false;
-                    break;
-                }
-            }
-        }
-
-        if (purge)
-            to_remove.push_back(closure_element->first);
-    }
-
-    auto pool_point = max_pool_change;
-
-    // for each element after the inflection point,
-    for (auto it = pool_point; it != state_.pool.right.end(); ++it)
-    {
-        // if within template, skip
-        if (state_.block_template.left.find(it->second) != state_.block_template.left.end())
-            continue;
-
-        // if outside template, test addition against sigops/size limits
-        auto proposed_entries = get_parent_closure(it->second);
-        size_t cumulative_sigops = std::accumulate(proposed_entries.begin(),
-            proposed_entries.end(), 0, plus_sigops());
-        size_t cumulative_bytes = std::accumulate(proposed_entries.begin(),
-            proposed_entries.end(), 0, plus_size());
-
-        if ((cumulative_sigops + state_.block_template_sigops +
-            state_.coinbase_sigop_reserve <= state_.template_sigop_limit) &&
-            (cumulative_bytes + state_.block_template_bytes +
-            state_.coinbase_byte_reserve <= state_.template_byte_limit))
-        {
-            state_.block_template_bytes += cumulative_bytes;
-            state_.block_template_sigops += cumulative_sigops;
-
-            for (auto entry : proposed_entries)
-            {
-                auto pool_entry = state_.pool.left.find(entry);
-                state_.block_template.insert({ pool_entry->first,
-                    pool_entry->second });
-
-                // calculate closure over children for fast filtering on
-                // subsequent update
-                populate_child_closure(pool_entry->first);
-            }
-        }
-    }
-
-    // Regenerate ordered template
-    order_template_transactions();
-
-    // NOTE: detection of change requires memory of purged and added sets
-    // for difference computation.  Not currently implemented.
-}
-
-void transaction_pool::order_template_transactions()
-{
-    transaction_order_calculator calculator;
-    for (auto entry : state_.block_template.left)
-        calculator.enqueue(entry.first);
-
-    state_.ordered_block_template = calculator.order_transactions();
-}
-
-void transaction_pool::populate_child_closure(transaction_entry::ptr tx)
-{
-    child_closure_calculator calculator(state_);
-    state_.cached_child_closures.insert({ tx, calculator.get_closure(tx) });
+    const auto template_bytes = state_.block_template_bytes - freed_bytes;
+    const auto template_sigops = state_.block_template_sigops - freed_sigops;
+
+    return
+        (bytes + template_bytes + state_.coinbase_byte_reserve <=
+            state_.template_byte_limit) &&
+        (sigops + template_sigops + state_.coinbase_sigop_reserve <=
+            state_.template_sigop_limit);
 }
 
 transaction_entry::list transaction_pool::get_parent_closure(
@@ -18,19 +18,73 @@
  */
 #include <bitcoin/blockchain/pools/transaction_pool_state.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <bitcoin/blockchain/pools/parent_closure_calculator.hpp>
+
 namespace libbitcoin {
 namespace blockchain {
 
+// Reserve space for the header, tx count and a generous coinbase.
+static constexpr size_t coinbase_bytes = 1000;
+static constexpr size_t coinbase_sigops = 100;
+
+// Buckets are 10% wide above one satoshi per kilobyte.
+static constexpr double bucket_minimum_rate = 0.001;
+static constexpr double bucket_spacing = 1.1;
+static constexpr int32_t maximum_bucket = 1000;
+
+const int32_t transaction_pool_state::anchor_bucket = -1;
+
+// Approximates allocation of the entry, its multi-index node and its edges.
+static constexpr size_t index_bytes = 5 * 3 * sizeof(void*);
+static constexpr size_t edge_bytes = sizeof(transaction_entry::ptr) +
+    6 * sizeof(void*);
+
+static size_t footprint(transaction_entry::ptr entry)
+{
+    return entry->size() + sizeof(transaction_entry) +
+        sizeof(transaction_pool_state::pooled_transaction) + index_bytes +
+        entry->parents().size() * edge_bytes;
+}
+
+transaction_pool_state::priority
+    transaction_pool_state::pooled_transaction::descendant_rate() const
+{
+    return bucket == anchor_bucket || descendant_bytes == 0 ?
+        std::numeric_limits<priority>::max() :
+        static_cast<priority>(descendant_fees) / descendant_bytes;
+}
+
+int32_t transaction_pool_state::to_bucket(priority rate)
+{
+    if (!(rate >= bucket_minimum_rate))
+        return 0;
+
+    const auto bucket = 1.0 + std::log(rate / bucket_minimum_rate) /
+        std::log(bucket_spacing);
+
+    return bucket >= maximum_bucket ? maximum_bucket :
+        static_cast<int32_t>(bucket);
+}
+
 transaction_pool_state::transaction_pool_state()
-  : block_template_bytes(0), block_template_sigops(0), block_template(),
-    pool(), template_byte_limit(0), template_sigop_limit(0),
+  : block_template_bytes(0), block_template_sigops(0), pool_bytes(0), pool(),
+    template_byte_limit(0), template_sigop_limit(0),
     coinbase_byte_reserve(0), coinbase_sigop_reserve(0),
-    cached_child_closures(), ordered_block_template()
+    cached_child_closures(), sequence_(0)
 {
 }
 
-transaction_pool_state::transaction_pool_state(const settings& )
-  : transaction_pool_state()
+transaction_pool_state::transaction_pool_state(const settings& settings)
+  : block_template_bytes(0), block_template_sigops(0), pool_bytes(0), pool(),
+    template_byte_limit(settings.block_bytes_limit),
+    template_sigop_limit(settings.block_sigop_limit),
+    coinbase_byte_reserve(coinbase_bytes),
+    coinbase_sigop_reserve(coinbase_sigops),
+    cached_child_closures(), sequence_(0)
 {
 }
 
@@ -39,12 +93,213 @@ transaction_pool_state::~transaction_pool_state()
     disconnect_entries();
 }
 
+// Link parents before pooling, so that the rate reflects them.
+bool transaction_pool_state::insert(transaction_entry::ptr entry,
+    priority value)
+{
+    const auto rate = rate_of(entry, value);
+    const auto bucket = entry->is_anchor() ? anchor_bucket : to_bucket(rate);
+    const auto cost = footprint(entry);
+
+    if (!pool.insert({ entry, value, false, sequence_++, rate, bucket,
+        entry->fees(), entry->size(), cost }).second)
+        return false;
+
+    pool_bytes += cost;
+    add_descendant(entry, entry->fees(), entry->size(), true);
+    return true;
+}
+
+bool transaction_pool_state::erase(transaction_entry::ptr entry)
+{
+    const auto it = pool.find(entry);
+    if (it == pool.end())
+        return false;
+
+    const auto fees = static_cast<int64_t>(entry->fees());
+    const auto bytes = static_cast<int64_t>(entry->size());
+    add_descendant(entry, -fees, -bytes, false);
+    cached_child_closures.erase(it->entry);
+
+    set_templated(it, false);
+    pool_bytes -= it->footprint;
+    pool.erase(it);
+    return true;
+}
+
+transaction_entry::ptr transaction_pool_state::lowest_descendant_rate() const
+{
+    const auto& index = pool.get<by_descendant>();
+    const auto it = index.begin();
+
+    return it == index.end() || it->bucket == anchor_bucket ? nullptr :
+        it->entry;
+}
+
+bool transaction_pool_state::exists(transaction_entry::ptr entry) const
+{
+    return pool.find(entry) != pool.end();
+}
+
+bool transaction_pool_state::templated(transaction_entry::ptr entry) const
+{
+    const auto it = pool.find(entry);
+    return it != pool.end() && it->templated;
+}
+
+transaction_pool_state::priority transaction_pool_state::priority_of(
+    transaction_entry::ptr entry) const
+{
+    const auto it = pool.find(entry);
+    return it == pool.end() ? 0.0 : it->value;
+}
+
+void transaction_pool_state::set_priority(transaction_entry::ptr entry,
+    priority value)
+{
+    const auto it = pool.find(entry);
+    if (it == pool.end())
+        return;
+
+    const auto rate = rate_of(entry, value);
+    const auto bucket = entry->is_anchor() ? anchor_bucket : to_bucket(rate);
+
+    pool.modify(it, [=](pooled_transaction& pooled)
+    {
+        pooled.value = value;
+        pooled.rate = rate;
+        pooled.bucket = bucket;
+    });
+}
+
+uint64_t transaction_pool_state::sequence_of(
+    transaction_entry::ptr entry) const
+{
+    const auto it = pool.find(entry);
+    return it == pool.end() ? 0 : it->sequence;
+}
+
+uint64_t transaction_pool_state::next_sequence() const
+{
+    return sequence_;
+}
+
+bool transaction_pool_state::select(transaction_entry::ptr entry)
+{
+    const auto it = pool.find(entry);
+    if (it == pool.end() || it->templated)
+        return false;
+
+    set_templated(it, true);
+    return true;
+}
+
+bool transaction_pool_state::deselect(transaction_entry::ptr entry)
+{
+    const auto it = pool.find(entry);
+    if (it == pool.end() || !it->templated)
+        return false;
+
+    set_templated(it, false);
+    return true;
+}
+
+// private
+transaction_pool_state::priority transaction_pool_state::rate_of(
+    transaction_entry::ptr entry, priority value) const
+{
+    auto rate = value;
+
+    for (const auto& parent: entry->parents())
+    {
+        const auto it = pool.find(parent);
+        if (it != pool.end() && !parent->is_anchor())
+            rate = std::min(rate, it->rate);
+    }
+
+    return rate;
+}
+
+// Apply the change to the sums of each pooled non-anchor ancestor, and add
+// or remove the entry from each cached child closure of an ancestor. The
+// closure is a set, so an ancestor by more than one path changes once.
+void transaction_pool_state::add_descendant(transaction_entry::ptr entry,
+    int64_t fees, int64_t bytes, bool pooled)
+{
+    parent_closure_calculator calculator(*this);
+
+    for (const auto& ancestor: calculator.get_closure(entry))
+    {
+        if (ancestor == entry)
+            continue;
+
+        update_child_closure(ancestor, entry, pooled);
+
+        if (ancestor->is_anchor())
+            continue;
+
+        const auto it = pool.find(ancestor);
+        if (it != pool.end())
+            pool.modify(it, [&](pooled_transaction& pooled)
+            {
+                pooled.descendant_fees = static_cast<uint64_t>(
+                    static_cast<int64_t>(pooled.descendant_fees) + fees);
+                pooled.descendant_bytes = static_cast<uint64_t>(
+                    static_cast<int64_t>(pooled.descendant_bytes) + bytes);
+            });
+    }
+}
+
+void transaction_pool_state::set_templated(
+    prioritized_transactions::iterator it, bool templated)
+{
+    if (it->templated == templated)
+        return;
+
+    const auto& entry = it->entry;
+
+    if (templated)
+    {
+        block_template_bytes += entry->size();
+        block_template_sigops += entry->sigops();
+    }
+    else
+    {
+        block_template_bytes -= entry->size();
+        block_template_sigops -= entry->sigops();
+    }
+
+    pool.modify(it, [templated](pooled_transaction& pooled)
+    {
+        pooled.templated = templated;
+    });
+}
+
+// An insertion has the highest sequence, so appending retains the sequence
+// order of a cached closure.
+void transaction_pool_state::update_child_closure(
+    transaction_entry::ptr ancestor, transaction_entry::ptr entry,
+    bool pooled)
+{
+    const auto it = cached_child_closures.find(ancestor);
+    if (it == cached_child_closures.end())
+        return;
+
+    auto& closure = it->second;
+
+    if (pooled)
+        closure.push_back(entry);
+    else
+        closure.erase(std::remove(closure.begin(), closure.end(), entry),
+            closure.end());
+}
+
 void transaction_pool_state::disconnect_entries()
 {
-    for (auto it : pool.left)
+    for (const auto& pooled: pool)
     {
-        it.first->remove_children();
-        it.first->remove_parents();
+        pooled.entry->remove_children();
+        pooled.entry->remove_parents();
     }
 }
 
@@ -0,0 +1,291 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/validation_trace.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/validate/input_scheduler.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+// Blocks in flight number at most two (pipelined), the remainder are those
+// abandoned before write, which are displaced in order of first report.
+static constexpr size_t pending_limit = 16;
+
+static constexpr size_t megabyte = 1024 * 1024;
+
+// A ratio over an empty denominator is not finite, which JSON cannot express.
+static float to_finite(float value)
+{
+    return std::isfinite(value) ? value : 0.0f;
+}
+
+static uint64_t elapsed(const asio::time_point& start,
+    const asio::time_point& end)
+{
+    if (start == asio::time_point() || end < start)
+        return 0;
+
+    return static_cast<uint64_t>(std::chrono::duration_cast<
+        asio::microseconds>(end - start).count());
+}
+
+validation_trace::validation_trace(const boost::filesystem::path& file,
+    size_t maximum_megabytes)
+  : file_(file),
+    maximum_bytes_(maximum_megabytes * megabyte),
+    bytes_(0)
+{
+}
+
+bool validation_trace::enabled() const
+{
+    return !file_.empty();
+}
+
+void validation_trace::populated(const hash_digest& hash, size_t internal,
+    size_t prevouts, size_t store_reads)
+{
+    if (!enabled())
+        return;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& entry = find(hash);
+    entry.internal += internal;
+    entry.prevouts += prevouts;
+    entry.store_reads += store_reads;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void validation_trace::connected(const hash_digest& hash,
+    const input_scheduler::statistics& summary)
+{
+    if (!enabled())
+        return;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& entry = find(hash);
+    entry.connected = true;
+    entry.summary = summary;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// Stage start times are set by validation, and a stage not performed (under
+// checkpoint or already validated) is recorded as zero.
+void validation_trace::write(block_const_ptr block,
+    uint64_t lock_microseconds)
+{
+    if (!enabled())
+        return;
+
+    const auto now = asio::steady_clock::now();
+    const auto& header = block->header().metadata;
+    const auto& metadata = block->metadata;
+    const auto hash = block->hash();
+
+    record value{};
+    value.height = header.state ? header.state->height() : 0;
+    value.hash = encode_hash(hash);
+    value.error = header.error.value();
+    value.cache_efficiency = metadata.cache_efficiency;
+    value.utilization = 1.0f;
+    value.imbalance = 1.0f;
+    value.lock_microseconds = lock_microseconds;
+
+    if (metadata.start_accept != asio::time_point())
+    {
+        value.populate_microseconds = elapsed(metadata.start_populate,
+            metadata.start_accept);
+        value.accept_microseconds = elapsed(metadata.start_accept,
+            metadata.start_connect == asio::time_point() ? now :
+                metadata.start_connect);
+    }
+
+    value.connect_microseconds = elapsed(metadata.start_connect, now);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = pending_.find(hash);
+
+        if (it != pending_.end())
+        {
+            const auto& entry = it->second;
+            value.internal = entry.internal;
+            value.prevouts = entry.prevouts;
+            value.store_reads = entry.store_reads;
+
+            if (entry.connected)
+            {
+                const auto& summary = entry.summary;
+                value.transactions = summary.transactions;
+                value.verified = summary.verified;
+                value.inputs = summary.inputs;
+                value.buckets = summary.buckets;
+                value.bucket_microseconds = summary.bucket_microseconds;
+                value.utilization = summary.utilization;
+                value.imbalance = summary.imbalance;
+            }
+
+            pending_.erase(it);
+        }
+    }
+    ///////////////////////////////////////////////////////////////////////////
+
+    write(value);
+}
+
+void validation_trace::write(const record& value)
+{
+    if (!enabled())
+        return;
+
+    const auto line = to_json(value) + "\n";
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (maximum_bytes_ != 0 && bytes_ != 0 &&
+        bytes_ + line.size() > maximum_bytes_)
+        rotate();
+
+    if (!open())
+        return;
+
+    stream_.write(line.data(), line.size());
+    stream_.flush();
+    bytes_ += line.size();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// static
+std::string validation_trace::to_json(const record& value)
+{
+    std::ostringstream out;
+    out << "{\"height\":" << value.height
+        << ",\"hash\":\"" << value.hash << "\""
+        << ",\"error\":" << value.error
+        << ",\"transactions\":" << value.transactions
+        << ",\"verified\":" << value.verified
+        << ",\"internal\":" << value.internal
+        << ",\"prevouts\":" << value.prevouts
+        << ",\"store_reads\":" << value.store_reads
+        << ",\"inputs\":" << value.inputs
+        << ",\"buckets\":" << value.buckets
+        << ",\"bucket_us\":[";
+
+    for (size_t bucket = 0; bucket < value.bucket_microseconds.size();
+        ++bucket)
+        out << (bucket == 0 ? "" : ",") << value.bucket_microseconds[bucket];
+
+    out << "],\"utilization\":" << to_finite(value.utilization)
+        << ",\"imbalance\":" << to_finite(value.imbalance)
+        << ",\"cache_efficiency\":" << to_finite(value.cache_efficiency)
+        << ",\"populate_us\":" << value.populate_microseconds
+        << ",\"accept_us\":" << value.accept_microseconds
+        << ",\"connect_us\":" << value.connect_microseconds
+        << ",\"lock_us\":" << value.lock_microseconds
+        << "}";
+
+    return out.str();
+}
+
+// private, call under mutex.
+validation_trace::stages& validation_trace::find(const hash_digest& hash)
+{
+    const auto it = pending_.find(hash);
+
+    if (it != pending_.end())
+        return it->second;
+
+    // Displaced hashes may already have been written (and so erased).
+    while (pending_.size() >= pending_limit && !order_.empty())
+    {
+        pending_.erase(order_.front());
+        order_.pop_front();
+    }
+
+    if (order_.size() >= pending_limit)
+        order_.pop_front();
+
+    order_.push_back(hash);
+    return pending_.emplace(hash, stages{}).first->second;
+}
+
+// private, call under mutex.
+// The file is opened on first write, appending to a prior trace.
+bool validation_trace::open()
+{
+    if (stream_.is_open())
+        return true;
+
+    boost::system::error_code ec;
+    const auto size = boost::filesystem::file_size(file_, ec);
+    bytes_ = ec ? 0 : static_cast<size_t>(size);
+
+    stream_.open(file_, std::ios::out | std::ios::app |
+        std::ios::binary);
+
+    if (stream_.is_open())
+        return true;
+
+    LOG_ERROR(LOG_BLOCKCHAIN)
+        << "Failed to open validation trace file [" << file_.string() << "]";
+    return false;
+}
+
+// private, call under mutex.
+void validation_trace::rotate()
+{
+    boost::system::error_code ec;
+    auto rotated = file_;
+    rotated += ".1";
+
+    stream_.close();
+    boost::filesystem::rename(file_, rotated, ec);
+
+    if (ec)
+    {
+        LOG_ERROR(LOG_BLOCKCHAIN)
+            << "Failed to rotate validation trace file [" << file_.string()
+            << "] : " << ec.message();
+        boost::filesystem::remove(file_, ec);
+    }
+
+    bytes_ = 0;
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/work_index.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+work_index::work_index()
+  : base_(0)
+{
+}
+
+size_t work_index::base() const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return base_;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+size_t work_index::top() const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return base_ + sums_.size();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void work_index::reset(size_t base_height)
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    base_ = base_height;
+    sums_.clear();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void work_index::push(uint32_t bits)
+{
+    const auto proof = chain::header::proof(bits);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    const auto prior = sums_.empty() ? uint256_t(0) : sums_.back();
+    sums_.push_back(prior + proof);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void work_index::pop(size_t height)
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    if (height < base_)
+    {
+        base_ = height;
+        sums_.clear();
+        return;
+    }
+
+    const auto count = height - base_;
+
+    if (count < sums_.size())
+        sums_.resize(count);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool work_index::work(uint256_t& out_work, size_t above_height,
+    size_t top_height) const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+
+    if (above_height < base_ || top_height > base_ + sums_.size() ||
+        above_height > top_height)
+        return false;
+
+    out_work = sum(top_height) - sum(above_height);
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// private
+uint256_t work_index::sum(size_t height) const
+{
+    return height == base_ ? uint256_t(0) : sums_[height - base_ - 1u];
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
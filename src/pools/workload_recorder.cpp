@@ -0,0 +1,303 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/pools/workload_recorder.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+using namespace bc::config;
+
+static constexpr size_t megabyte = 1024 * 1024;
+
+// "bcwl" as serialized.
+const uint32_t workload_recorder::magic = 0x6c776362;
+
+// Payloads are not larger than a p2p message, bounding the allocation of a
+// corrupt size read from the capture.
+static constexpr uint64_t maximum_payload = 32u * megabyte;
+
+workload_recorder::workload_recorder(const boost::filesystem::path& file,
+    size_t maximum_megabytes)
+  : file_(file),
+    maximum_bytes_(maximum_megabytes * megabyte),
+    stopped_(true),
+    full_(false),
+    bytes_(0)
+{
+}
+
+static void write_checkpoint(writer& sink, const checkpoint& value)
+{
+    sink.write_hash(value.hash());
+    sink.write_8_bytes_little_endian(value.height());
+}
+
+static checkpoint read_checkpoint(reader& source)
+{
+    const auto hash = source.read_hash();
+    const auto height = source.read_8_bytes_little_endian();
+    return { hash, static_cast<size_t>(height) };
+}
+
+bool workload_recorder::enabled() const
+{
+    return !file_.empty();
+}
+
+// A capture is replayed from a copy of the store at its start, so each is
+// started in a new file and a prior capture is retained as a rotation.
+bool workload_recorder::start(const checkpoint& confirmed,
+    const checkpoint& candidate)
+{
+    if (!enabled())
+        return true;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (stream_.is_open())
+        stream_.close();
+
+    rotate();
+    stream_.open(file_, std::ios::out | std::ios::trunc | std::ios::binary);
+
+    if (!stream_.is_open())
+    {
+        LOG_ERROR(LOG_BLOCKCHAIN)
+            << "Failed to open workload capture [" << file_.string() << "]";
+        return false;
+    }
+
+    ostream_writer sink(stream_);
+    sink.write_4_bytes_little_endian(magic);
+    write_checkpoint(sink, confirmed);
+    write_checkpoint(sink, candidate);
+    stream_.flush();
+
+    bytes_ = sizeof(magic) + 2u * (hash_size + sizeof(uint64_t));
+    last_ = asio::time_point();
+    full_ = false;
+    stopped_ = false;
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// Payloads are serialized before the critical section, so that only the
+// timestamp (establishing the replay order) and the write are serialized.
+void workload_recorder::write(header_const_ptr header)
+{
+    if (!enabled())
+        return;
+
+    const chain::header& value = *header;
+    write(entity::header, 0, value.to_data());
+}
+
+void workload_recorder::write(headers_const_ptr headers)
+{
+    if (!enabled())
+        return;
+
+    data_chunk payload;
+    data_sink ostream(payload);
+    ostream_writer sink(ostream);
+    sink.write_variable_little_endian(headers->elements().size());
+
+    for (const chain::header& header: headers->elements())
+        header.to_data(sink);
+
+    ostream.flush();
+    write(entity::headers, 0, payload);
+}
+
+void workload_recorder::write(transaction_const_ptr tx)
+{
+    if (!enabled())
+        return;
+
+    write(entity::transaction, 0, tx->to_data(true, true));
+}
+
+void workload_recorder::write(transaction_const_ptr_list_const_ptr txs)
+{
+    if (!enabled())
+        return;
+
+    data_chunk payload;
+    data_sink ostream(payload);
+    ostream_writer sink(ostream);
+    sink.write_variable_little_endian(txs->size());
+
+    for (const auto& tx: *txs)
+        tx->to_data(sink, true, true);
+
+    ostream.flush();
+    write(entity::transactions, 0, payload);
+}
+
+void workload_recorder::write(block_const_ptr block, size_t height)
+{
+    if (!enabled())
+        return;
+
+    write(entity::block, height, block->to_data(true));
+}
+
+// A call organized during shutdown is not recorded, nor is the capture
+// reopened (and so rotated) by it.
+void workload_recorder::stop()
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+
+    if (stream_.is_open())
+        stream_.close();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// static
+bool workload_recorder::read_start(checkpoint& out_confirmed,
+    checkpoint& out_candidate, reader& source)
+{
+    if (source.read_4_bytes_little_endian() != magic || !source)
+        return false;
+
+    out_confirmed = read_checkpoint(source);
+    out_candidate = read_checkpoint(source);
+    return source;
+}
+
+// static
+bool workload_recorder::read(record& out_record, reader& source)
+{
+    if (source.is_exhausted())
+        return false;
+
+    out_record.type = static_cast<entity>(source.read_byte());
+    out_record.microseconds = source.read_variable_little_endian();
+    out_record.height = out_record.type == entity::block ?
+        source.read_size_little_endian() : 0;
+
+    const auto size = source.read_variable_little_endian();
+
+    if (!source || out_record.type > entity::block || size > maximum_payload)
+        return false;
+
+    out_record.payload = source.read_bytes(static_cast<size_t>(size));
+    return source;
+}
+
+// static
+void workload_recorder::write(writer& sink, const record& value)
+{
+    sink.write_byte(static_cast<uint8_t>(value.type));
+    sink.write_variable_little_endian(value.microseconds);
+
+    if (value.type == entity::block)
+        sink.write_variable_little_endian(value.height);
+
+    sink.write_variable_little_endian(value.payload.size());
+    sink.write_bytes(value.payload);
+}
+
+// private
+void workload_recorder::write(entity type, size_t height,
+    data_chunk payload)
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (stopped_ || full_)
+        return;
+
+    // The first record of a capture is at zero.
+    const auto now = asio::steady_clock::now();
+    const auto delta = last_ == asio::time_point() ? 0 :
+        std::chrono::duration_cast<asio::microseconds>(now - last_).count();
+    last_ = now;
+
+    const record value{ type, static_cast<uint64_t>(delta), height,
+        std::move(payload) };
+
+    const auto size = 1u + variable_uint_size(value.microseconds) +
+        (type == entity::block ? variable_uint_size(height) : 0u) +
+        variable_uint_size(value.payload.size()) + value.payload.size();
+
+    if (maximum_bytes_ != 0 && bytes_ + size > maximum_bytes_)
+    {
+        full_ = true;
+        stream_.close();
+        LOG_WARNING(LOG_BLOCKCHAIN)
+            << "Workload capture [" << file_.string()
+            << "] reached its limit, recording stopped.";
+        return;
+    }
+
+    ostream_writer sink(stream_);
+    write(sink, value);
+    stream_.flush();
+    bytes_ += size;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// private, call under mutex.
+// Rotations are never overwritten, so the first unused suffix is taken.
+void workload_recorder::rotate() const
+{
+    boost::system::error_code ec;
+
+    if (!boost::filesystem::exists(file_, ec))
+        return;
+
+    auto rotated = file_;
+
+    for (size_t index = 1; ; ++index)
+    {
+        rotated = file_;
+        rotated += "." + std::to_string(index);
+
+        if (!boost::filesystem::exists(rotated, ec))
+            break;
+    }
+
+    boost::filesystem::rename(file_, rotated, ec);
+
+    if (ec)
+        LOG_ERROR(LOG_BLOCKCHAIN)
+            << "Failed to rotate workload capture [" << file_.string()
+            << "] : " << ec.message();
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
@@ -0,0 +1,138 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/populate/compact_output.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+using namespace bc::chain;
+using namespace bc::machine;
+
+static constexpr uint8_t push_20 = 0x14;
+static constexpr uint8_t push_32 = 0x20;
+static const auto op_dup = static_cast<uint8_t>(opcode::dup);
+static const auto op_hash160 = static_cast<uint8_t>(opcode::hash160);
+static const auto op_equal = static_cast<uint8_t>(opcode::equal);
+static const auto op_equalverify = static_cast<uint8_t>(opcode::equalverify);
+static const auto op_checksig = static_cast<uint8_t>(opcode::checksig);
+static const auto op_zero = static_cast<uint8_t>(opcode::push_size_0);
+
+compact_output::compact_output()
+  : value_(output::not_found), form_(form::raw), hash_(null_hash)
+{
+}
+
+// Templates are matched on the serialization, so only canonical encodings
+// (minimal pushes) are compressed and every rebuilt script is identical.
+compact_output::compact_output(const output& output)
+  : value_(output.value()), form_(form::raw), hash_(null_hash)
+{
+    auto script = output.script().to_data(false);
+    const auto size = script.size();
+    const auto data = script.data();
+
+    if (size == 25 && data[0] == op_dup && data[1] == op_hash160 &&
+        data[2] == push_20 && data[23] == op_equalverify &&
+        data[24] == op_checksig)
+    {
+        form_ = form::pay_key_hash;
+        std::copy_n(data + 3, short_hash_size, hash_.begin());
+    }
+    else if (size == 23 && data[0] == op_hash160 && data[1] == push_20 &&
+        data[22] == op_equal)
+    {
+        form_ = form::pay_script_hash;
+        std::copy_n(data + 2, short_hash_size, hash_.begin());
+    }
+    else if (size == 22 && data[0] == op_zero && data[1] == push_20)
+    {
+        form_ = form::witness_key_hash;
+        std::copy_n(data + 2, short_hash_size, hash_.begin());
+    }
+    else if (size == 34 && data[0] == op_zero && data[1] == push_32)
+    {
+        form_ = form::witness_script_hash;
+        std::copy_n(data + 2, hash_size, hash_.begin());
+    }
+    else
+    {
+        raw_ = std::move(script);
+        raw_.shrink_to_fit();
+    }
+}
+
+uint64_t compact_output::value() const
+{
+    return value_;
+}
+
+bool compact_output::templated() const
+{
+    return form_ != form::raw;
+}
+
+size_t compact_output::size() const
+{
+    return sizeof(compact_output) + raw_.capacity();
+}
+
+output compact_output::to_output() const
+{
+    if (form_ == form::raw)
+        return { value_, chain::script(raw_, false) };
+
+    data_chunk data;
+    data.reserve(34);
+    const auto begin = hash_.begin();
+    const auto end = begin + (form_ == form::witness_script_hash ? hash_size :
+        short_hash_size);
+
+    switch (form_)
+    {
+        case form::pay_key_hash:
+            data.insert(data.end(), { op_dup, op_hash160, push_20 });
+            data.insert(data.end(), begin, end);
+            data.insert(data.end(), { op_equalverify, op_checksig });
+            break;
+        case form::pay_script_hash:
+            data.insert(data.end(), { op_hash160, push_20 });
+            data.insert(data.end(), begin, end);
+            data.push_back(op_equal);
+            break;
+        case form::witness_key_hash:
+            data.insert(data.end(), { op_zero, push_20 });
+            data.insert(data.end(), begin, end);
+            break;
+        case form::witness_script_hash:
+        default:
+            data.insert(data.end(), { op_zero, push_32 });
+            data.insert(data.end(), begin, end);
+            break;
+    }
+
+    return { value_, chain::script(data, false) };
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
@@ -0,0 +1,107 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/populate/pending_outputs.hpp>
+
+#include <cstddef>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+using namespace bc::chain;
+
+pending_outputs::pending_outputs()
+{
+}
+
+void pending_outputs::add(block_const_ptr block)
+{
+    const auto state = block->header().metadata.state;
+    BITCOIN_ASSERT(state);
+
+    const auto height = state->height();
+    const auto median_time_past = state->median_time_past();
+    const auto& txs = block->transactions();
+    blocks_.push_back(block);
+
+    for (size_t position = 0; position < txs.size(); ++position)
+    {
+        const auto& tx = txs[position];
+        const auto coinbase = (position == 0);
+        creators_[tx.hash()] = { &tx, height, median_time_past, coinbase };
+
+        // A coinbase input does not spend a previous output.
+        if (coinbase)
+            continue;
+
+        for (const auto& input: tx.inputs())
+            spends_.insert(input.previous_output());
+    }
+}
+
+void pending_outputs::clear()
+{
+    spends_.clear();
+    creators_.clear();
+    blocks_.clear();
+}
+
+bool pending_outputs::empty() const
+{
+    return blocks_.empty();
+}
+
+bool pending_outputs::populate(const output_point& outpoint) const
+{
+    auto& prevout = outpoint.metadata;
+    const auto spent = spends_.find(outpoint) != spends_.end();
+    const auto it = creators_.find(outpoint.hash());
+
+    // The output was created by the store but spent by a pending block.
+    if (it == creators_.end())
+    {
+        if (spent)
+            prevout.spent = true;
+
+        return spent;
+    }
+
+    const auto& creator = it->second;
+    const auto& outputs = creator.transaction->outputs();
+
+    // The creator exists but the output does not, so it is missing.
+    if (outpoint.index() >= outputs.size())
+    {
+        prevout.cache = output{};
+        return true;
+    }
+
+    // A pending block is above the fork point, so this is a candidate output.
+    prevout.spent = spent;
+    prevout.candidate = true;
+    prevout.confirmed = false;
+    prevout.coinbase = creator.coinbase;
+    prevout.height = creator.height;
+    prevout.median_time_past = creator.median_time_past;
+    prevout.cache = outputs[outpoint.index()];
+    return true;
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
@@ -22,8 +22,14 @@
 #include <cstddef>
 #include <cstdint>
 #include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/blockchain/interface/fast_chain.hpp>
+#include <bitcoin/blockchain/pools/validation_trace.hpp>
+#include <bitcoin/blockchain/populate/pending_outputs.hpp>
+#include <bitcoin/blockchain/validate/abort_token.hpp>
 
 namespace libbitcoin {
 namespace blockchain {
@@ -33,22 +39,45 @@ using namespace bc::machine;
 
 #define NAME "populate_block"
 
-populate_block::populate_block(dispatcher& dispatch, const fast_chain& chain)
-  : populate_base(dispatch, chain)
+populate_block::populate_block(dispatcher& dispatch, const fast_chain& chain,
+    validation_trace& trace)
+  : populate_base(dispatch, chain),
+    trace_(trace)
 {
 }
 
 // Returns store code only.
-void populate_block::populate(block_const_ptr block,
+void populate_block::populate(block_const_ptr block, abort_token::ptr token,
     result_handler&& handler) const
+{
+    // This candidate must be that which follows the top valid candidate.
+    const auto top_valid = fast_chain_.top_valid_candidate_state();
+    populate(block, top_valid, {}, token, std::move(handler));
+}
+
+// Returns store code only.
+void populate_block::populate(block_const_ptr block, block_const_ptr parent,
+    abort_token::ptr token, result_handler&& handler) const
+{
+    // The parent is not yet a candidate, so its outputs and spends are not
+    // reflected in the store and must be applied over the store population.
+    const auto pending = std::make_shared<pending_outputs>();
+    pending->add(parent);
+
+    const auto parent_state = parent->header().metadata.state;
+    populate(block, parent_state, pending, token, std::move(handler));
+}
+
+// protected
+void populate_block::populate(block_const_ptr block,
+    chain::chain_state::ptr parent_state, pending_outputs::const_ptr pending,
+    abort_token::ptr token, result_handler&& handler) const
 {
     // The block class has no population method, so set timer externally.
     block->metadata.start_populate = asio::steady_clock::now();
 
-    // This candidate must be that which follows the top valid candidate.
     auto& metadata = block->header().metadata;
-    const auto top_valid = fast_chain_.top_valid_candidate_state();
-    metadata.state = fast_chain_.promote_state(block->header(), top_valid);
+    metadata.state = fast_chain_.promote_state(block->header(), parent_state);
 
     if (!metadata.state)
     {
@@ -63,7 +92,8 @@ void populate_block::populate(block_const_ptr block,
     if (metadata.state->is_under_checkpoint())
     {
         // Required for prevout indexing, and is not applicable to coinbase.
-        populate_non_coinbase(block, fork_height, false, handler);
+        populate_non_coinbase(block, fork_height, false, pending, token,
+            handler);
         return;
     }
 
@@ -75,16 +105,18 @@ void populate_block::populate(block_const_ptr block,
     if (metadata.validated)
     {
         // Required for prevout indexing, and is not applicable to coinbase.
-        populate_non_coinbase(block, fork_height, false, handler);
+        populate_non_coinbase(block, fork_height, false, pending, token,
+            handler);
         return;
     }
 
     populate_coinbase(block, fork_height);
-    populate_non_coinbase(block, fork_height, true, handler);
+    populate_non_coinbase(block, fork_height, true, pending, token, handler);
 }
 
 void populate_block::populate_non_coinbase(block_const_ptr block,
-    size_t fork_height, bool use_txs, result_handler handler) const
+    size_t fork_height, bool use_txs, pending_outputs::const_ptr pending,
+    abort_token::ptr token, result_handler handler) const
 {
     const auto non_coinbase_inputs = block->total_non_coinbase_inputs();
 
@@ -94,13 +126,33 @@ void populate_block::populate_non_coinbase(block_const_ptr block,
         return;
     }
 
+    // Index the block's own txs once, shared by all buckets.
+    const auto& txs = block->transactions();
+    const auto internal = std::make_shared<positions>();
+    internal->reserve(txs.size());
+
+    for (size_t position = 0; position < txs.size(); ++position)
+        internal->emplace(txs[position].hash(), position);
+
+    // A block extending the confirmed top is the next block of the tx pool,
+    // so the prevouts of its pooled txs are taken from their pool validation.
+    // The parent of a pending block is not yet confirmed, so it is excluded.
+    const auto from_pool = std::make_shared<pooled>();
+    const auto height = block->header().metadata.state->height();
+    const auto next_confirmed = fast_chain_.next_confirmed_state();
+
+    if (!pending && next_confirmed && is_next_confirmed(height, fork_height,
+        next_confirmed->height()))
+        fast_chain_.populate_pooled_outputs(*block, *from_pool);
+
     const auto buckets = std::min(dispatch_.size(), non_coinbase_inputs);
     const auto join_handler = synchronize(std::move(handler), buckets, NAME);
     BITCOIN_ASSERT(buckets != 0);
 
     for (size_t bucket = 0; bucket < buckets; ++bucket)
         dispatch_.concurrent(&populate_block::populate_transactions,
-            this, block, fork_height, bucket, buckets, use_txs, join_handler);
+            this, block, fork_height, bucket, buckets, use_txs, pending,
+            internal, from_pool, token, join_handler);
 }
 
 // Initialize the coinbase input for subsequent metadata.
@@ -135,13 +187,14 @@ void populate_block::populate_coinbase(block_const_ptr block,
 
 void populate_block::populate_transactions(block_const_ptr block,
     size_t fork_height, size_t bucket, size_t buckets, bool use_txs,
+    pending_outputs::const_ptr pending, positions_ptr internal,
+    pooled_ptr from_pool, abort_token::ptr token,
     result_handler handler) const
 {
     BITCOIN_ASSERT(bucket < buckets);
      auto& txs = block->transactions();
     const auto state = block->header().metadata.state;
     const auto forks = state->enabled_forks();
-    size_t input_position = 0;
 
     if (use_txs)
     {
@@ -149,31 +202,128 @@ void populate_block::populate_transactions(block_const_ptr block,
         for (auto position = (bucket == 0 ? buckets : bucket);
             position < txs.size(); position = ceiling_add(position, buckets))
         {
+            if (token->tripped())
+            {
+                handler(error::success);
+                return;
+            }
+
              auto& tx = txs[position];
             fast_chain_.populate_block_transaction(tx, forks, fork_height);
         }
     }
 
+    fast_chain::outpoints prevouts;
+    size_t internal_spends = 0;
+    size_t ordinal = 0;
+
+    // Partition by previous tx, so that each is read by only one bucket.
+    // Outputs created earlier in the block are resolved without the store,
+    // as are those populated from the tx pool.
     // Must skip coinbase here as it is already accounted for.
-    for (auto tx = std::next(txs.begin()); tx != txs.end(); ++tx)
+    for (size_t position = 1; position < txs.size(); ++position)
     {
-        const auto& inputs = tx->inputs();
-
-        for (size_t input_index = 0; input_index < inputs.size();
-            ++input_index, ++input_position)
+        for (const auto& input: txs[position].inputs())
         {
-            if (input_position % buckets != bucket)
+            const auto& prevout = input.previous_output();
+            const auto seeded = ordinal < from_pool->size() &&
+                (*from_pool)[ordinal];
+            ++ordinal;
+
+            if (seeded || to_bucket(prevout, buckets) != bucket)
+                continue;
+
+            if (populate_internal(block, *internal, prevout, position))
+            {
+                ++internal_spends;
                 continue;
+            }
+
+            prevouts.push_back(&prevout);
+        }
+    }
+
+    // The block is invalid or abandoned, so population is moot.
+    if (token->tripped())
+    {
+        handler(error::success);
+        return;
+    }
+
+    // Don't fail here if output is missing, populate all.
+    const auto reads = fast_chain_.populate_outputs(prevouts, fork_height,
+        true);
 
-            const auto& prevout = inputs[input_index].previous_output();
+    if (trace_.enabled())
+        trace_.populated(block->hash(), internal_spends, prevouts.size(),
+            reads);
 
-            // Don't fail here if output is missing, populate all.
-            /*bool*/ fast_chain_.populate_output(prevout, fork_height, true);
+    // Apply outputs created and spent by uncommitted predecessors.
+    if (pending)
+    {
+        for (const auto prevout: prevouts)
+        {
+            if (token->tripped())
+                break;
+
+            pending->populate(*prevout);
         }
     }
 
     handler(error::success);
 }
 
+// static
+// A candidate above the fork point descends from it, so it extends the
+// confirmed top only if its parent is the fork point and no confirmed block
+// is above the fork point. Header reorganization may lower the fork point
+// below the confirmed top, where the pool's prevouts are of another branch.
+bool populate_block::is_next_confirmed(size_t height, size_t fork_height,
+    size_t next_confirmed_height)
+{
+    return height == fork_height + 1u && height == next_confirmed_height;
+}
+
+// static
+// An output created by a preceding tx of the block is neither confirmed nor
+// spent before the block (an internal double spend is rejected by check).
+// A forward reference is left to the store, and is rejected by check.
+bool populate_block::populate_internal(block_const_ptr block,
+    const positions& internal, const output_point& prevout, size_t spender)
+{
+    const auto it = internal.find(prevout.hash());
+
+    if (it == internal.end() || it->second >= spender)
+        return false;
+
+    const auto state = block->header().metadata.state;
+    const auto& outputs = block->transactions()[it->second].outputs();
+    auto& metadata = prevout.metadata;
+
+    // The creator exists but the output does not, so it is missing.
+    if (prevout.index() >= outputs.size())
+    {
+        metadata.cache = output{};
+        return true;
+    }
+
+    metadata.spent = false;
+    metadata.candidate = true;
+    metadata.confirmed = false;
+    metadata.coinbase = (it->second == 0);
+    metadata.height = state->height();
+    metadata.median_time_past = state->median_time_past();
+    metadata.cache = outputs[prevout.index()];
+    return true;
+}
+
+// static
+// The hash of a previous tx is uniformly distributed.
+size_t populate_block::to_bucket(const output_point& prevout, size_t buckets)
+{
+    const auto& hash = prevout.hash();
+    return ((size_t(hash[0]) << 8) | hash[1]) % buckets;
+}
+
 } // namespace blockchain
 } // namespace libbitcoin
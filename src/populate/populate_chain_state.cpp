@@ -232,8 +232,28 @@ chain_state::ptr populate_chain_state::populate( header& header,
     data.hash = header.hash();
 
     return populate_all(data, header, header_height, candidate) ?
-        std::make_shared<chain_state>(std::move(data), checkpoints_,
-            forks_, stale_seconds_, bitcoin_settings_) : nullptr;
+        populate(std::move(data)) : nullptr;
+}
+
+// Get chain state data for the given block|header by height.
+bool populate_chain_state::populate(chain_state::data& out_data,
+    size_t header_height, bool candidate) const
+{
+    header header;
+
+    if (!fast_chain_.get_header(header, header_height, candidate))
+        return false;
+
+    out_data.height = header_height;
+    out_data.hash = header.hash();
+    return populate_all(out_data, header, header_height, candidate);
+}
+
+// The data must have been populated under the same checkpoints and forks.
+chain_state::ptr populate_chain_state::populate(chain_state::data&& data) const
+{
+    return std::make_shared<chain_state>(std::move(data), checkpoints_,
+        forks_, stale_seconds_, bitcoin_settings_);
 }
 
 } // namespace blockchain
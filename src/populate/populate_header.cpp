@@ -37,6 +37,11 @@ populate_header::populate_header(dispatcher& dispatch, const fast_chain& chain)
 
 void populate_header::populate(header_branch::ptr branch,
     result_handler&& handler) const
+{
+    handler(populate(branch));
+}
+
+code populate_header::populate(header_branch::ptr branch) const
 {
     const auto this_id = boost::this_thread::get_id();
     LOG_VERBOSE(LOG_BLOCKCHAIN)
@@ -48,10 +53,9 @@ void populate_header::populate(header_branch::ptr branch,
     {
         LOG_VERBOSE(LOG_BLOCKCHAIN)
         << this_id
-        << " populate_header::populate() calling handler(error::orphan_block)";
+        << " populate_header::populate() returning error::orphan_block";
 
-        handler(error::orphan_block);
-        return;
+        return error::orphan_block;
     }
 
     LOG_VERBOSE(LOG_BLOCKCHAIN)
@@ -78,10 +82,9 @@ void populate_header::populate(header_branch::ptr branch,
             {
                 LOG_VERBOSE(LOG_BLOCKCHAIN)
                 << this_id
-                << " populate_header::populate() calling handler(error::duplicate_block)";
+                << " populate_header::populate() returning error::duplicate_block";
                 
-                handler(error::duplicate_block);
-                return;
+                return error::duplicate_block;
             }
             
             if (header->metadata.state)
@@ -103,11 +106,11 @@ void populate_header::populate(header_branch::ptr branch,
 
             LOG_VERBOSE(LOG_BLOCKCHAIN)
             << this_id
-            << " populate_header::populate() calling handler(header.metadata.error) "
+            << " populate_header::populate() returning header.metadata.error "
             << header->metadata.error << " " << header->metadata.error.message();
             
             // If there is an existing full block validation error return it.
-            handler(header->metadata.error);
+            return header->metadata.error;
         }
         else
         {
@@ -116,6 +119,8 @@ void populate_header::populate(header_branch::ptr branch,
             << " populate_header::populate() header is nullptr after branch->top() call.";
         }
     }
+
+    return error::operation_failed;
 }
 
 // private
@@ -133,6 +138,13 @@ bool populate_header::set_branch_state(header_branch::ptr branch) const
         return true;
     }
 
+    // A pool ancestor that is not a leaf does not retain its chain state.
+    if (branch->size() > 1u && branch->height() != max_size_t)
+    {
+        metadata.state = rematerialize(branch);
+        return metadata.state != nullptr;
+    }
+
     config::checkpoint chain_top;
     const auto& parent = branch_top->previous_block_hash();
 
@@ -165,5 +177,37 @@ bool populate_header::set_branch_state(header_branch::ptr branch) const
     return false;
 }
 
+// private
+// Chain state is promoted through the branch from the nearest ancestor that
+// retains it, or from the fork point (the only store population).
+chain::chain_state::ptr populate_header::rematerialize(
+    header_branch::ptr branch) const
+{
+    const auto& headers = *branch->headers();
+    auto index = headers.size() - 1u;
+    chain::chain_state::ptr state;
+
+    while (index != 0 && !(state = headers[index - 1u]->metadata.state))
+        --index;
+
+    if (!state)
+    {
+        size_t fork_height;
+        chain::header fork_header;
+
+        if (!fast_chain_.get_header(fork_header, fork_height, branch->hash(),
+            true))
+            return {};
+
+        state = fast_chain_.chain_state(fork_header, fork_height);
+    }
+
+    // Intermediate states are not retained.
+    for (; state && index < headers.size(); ++index)
+        state = fast_chain_.promote_state(*headers[index], state);
+
+    return state;
+}
+
 } // namespace blockchain
 } // namespace libbitcoin
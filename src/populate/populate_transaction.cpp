@@ -22,6 +22,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/blockchain/define.hpp>
 #include <bitcoin/blockchain/interface/fast_chain.hpp>
@@ -80,17 +81,71 @@ void populate_transaction::populate_inputs(transaction_const_ptr tx,
 {
     BITCOIN_ASSERT(bucket < buckets);
     const auto& inputs = tx->inputs();
+    fast_chain::outpoints prevouts;
 
     for (auto input_index = bucket; input_index < inputs.size();
         input_index = ceiling_add(input_index, buckets))
+        prevouts.push_back(&inputs[input_index].previous_output());
+
+    // Don't fail here if output is missing, populate all.
+    fast_chain_.populate_outputs(prevouts, max_size_t, false);
+    handler(error::success);
+}
+
+// Confirmed and verified txs are populated as such but their prevouts are not,
+// and the caller must treat them as duplicates.
+void populate_transaction::populate(transaction_const_ptr_list_const_ptr txs,
+    result_handler&& handler) const
+{
+    // Get the chain state of the next block (tx pool), once for the set.
+    const auto state = fast_chain_.next_confirmed_state();
+    BITCOIN_ASSERT(state);
+
+    const auto forks = state->enabled_forks();
+    const auto prevouts = std::make_shared<fast_chain::outpoints>();
+
+    for (const auto& tx: *txs)
     {
-        const auto& input = inputs[input_index];
-        const auto& prevout = input.previous_output();
+        auto& metadata = tx->metadata;
+        metadata.state = state;
+        fast_chain_.populate_pool_transaction(*tx, forks);
+
+        if (metadata.confirmed || metadata.verified)
+            continue;
+
+        for (const auto& input: tx->inputs())
+            prevouts->push_back(&input.previous_output());
+    }
 
-        // Don't fail here if output is missing, populate all.
-        /*bool*/ fast_chain_.populate_output(prevout, max_size_t, false);
+    if (prevouts->empty())
+    {
+        handler(error::success);
+        return;
     }
 
+    const auto buckets = std::min(dispatch_.size(), prevouts->size());
+    const auto join_handler = synchronize(std::move(handler), buckets,
+        NAME "_set");
+
+    for (size_t bucket = 0; bucket < buckets; ++bucket)
+        dispatch_.concurrent(&populate_transaction::populate_prevouts,
+            this, txs, prevouts, bucket, buckets, join_handler);
+}
+
+// The txs are retained until population completes, as prevouts refer to them.
+void populate_transaction::populate_prevouts(
+    transaction_const_ptr_list_const_ptr, outpoints_ptr prevouts,
+    size_t bucket, size_t buckets, result_handler handler) const
+{
+    BITCOIN_ASSERT(bucket < buckets);
+    fast_chain::outpoints partition;
+
+    for (auto index = bucket; index < prevouts->size();
+        index = ceiling_add(index, buckets))
+        partition.push_back((*prevouts)[index]);
+
+    // Don't fail here if output is missing, populate all.
+    fast_chain_.populate_outputs(partition, max_size_t, false);
     handler(error::success);
 }
 
@@ -0,0 +1,303 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/populate/utxo_cache.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+using namespace bc::chain;
+
+// Approximate overhead of an entry, its key and its order position.
+static constexpr size_t entry_overhead = 128;
+static constexpr size_t megabyte = 1024 * 1024;
+
+// Undo records are bounded to this fraction of the cache size.
+static constexpr size_t journal_divisor = 4;
+
+utxo_cache::utxo_cache(size_t maximum_megabytes, size_t maximum_depth)
+  : maximum_bytes_(maximum_megabytes * megabyte),
+    maximum_depth_(maximum_depth == 0 ? max_size_t : maximum_depth),
+    hits_(0),
+    queries_(0),
+    bytes_(0),
+    journal_bytes_(0),
+    unrecorded_(0)
+{
+}
+
+bool utxo_cache::disabled() const
+{
+    return maximum_bytes_ == 0;
+}
+
+size_t utxo_cache::size() const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return entries_.size();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+size_t utxo_cache::bytes() const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return bytes_ + journal_bytes_;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+float utxo_cache::hit_rate() const
+{
+    // These values could overflow or divide by zero, but that's okay.
+    return queries_ == 0 ? 0.0f : (hits_ * 1.0f / queries_);
+}
+
+// A cached output is unspent in the candidate chain, and is confirmed if at
+// or below the fork point (spends by pending blocks are applied by caller).
+bool utxo_cache::populate(const output_point& outpoint,
+    size_t fork_height) const
+{
+    if (disabled())
+        return false;
+
+    ++queries_;
+    auto& prevout = outpoint.metadata;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    const auto it = entries_.find(outpoint);
+
+    if (it == entries_.end())
+        return false;
+
+    const auto& value = it->second;
+    prevout.spent = false;
+    prevout.candidate = true;
+    prevout.confirmed = value.height <= fork_height;
+    prevout.coinbase = value.coinbase;
+    prevout.height = value.height;
+    prevout.median_time_past = value.median_time_past;
+    prevout.cache = value.output.to_output();
+    ///////////////////////////////////////////////////////////////////////////
+
+    ++hits_;
+    return true;
+}
+
+void utxo_cache::add(block_const_ptr block)
+{
+    if (disabled())
+        return;
+
+    const auto state = block->header().metadata.state;
+    BITCOIN_ASSERT(state);
+
+    const auto height = state->height();
+    const auto median_time_past = state->median_time_past();
+    const auto& txs = block->transactions();
+    undo record{ height, {}, {}, 0 };
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    // Spends are applied in tx order, so intra-block spends are not cached.
+    for (size_t position = 0; position < txs.size(); ++position)
+    {
+        const auto& tx = txs[position];
+        const auto coinbase = (position == 0);
+
+        // A coinbase input does not spend a previous output.
+        if (!coinbase)
+        {
+            for (const auto& input: tx.inputs())
+            {
+                const auto it = entries_.find(input.previous_output());
+
+                if (it == entries_.end())
+                    continue;
+
+                bytes_ -= it->second.bytes;
+                record.bytes += it->second.bytes;
+                record.spent.emplace_back(it->first, std::move(it->second));
+                entries_.erase(it);
+            }
+        }
+
+        const auto hash = tx.hash();
+        const auto& outputs = tx.outputs();
+
+        for (uint32_t index = 0; index < outputs.size(); ++index)
+        {
+            const compact_output output(outputs[index]);
+            const auto bytes = output.size() + entry_overhead;
+            const point key{ hash, index };
+
+            if (entries_.emplace(key, entry{ output, height,
+                median_time_past, coinbase, bytes }).second)
+            {
+                order_.push_back(key);
+                record.created.push_back(key);
+                record.bytes += sizeof(point);
+                bytes_ += bytes;
+            }
+        }
+    }
+
+    push(std::move(record));
+    evict();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool utxo_cache::disconnect(size_t fork_height)
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+
+    // A block above the fork without a record cannot be disconnected.
+    if (unrecorded_ > fork_height)
+    {
+        reset();
+        return false;
+    }
+
+    // Records are replayed most recent first, as a sequential rollback.
+    while (!journal_.empty() && journal_.back().height > fork_height)
+    {
+        replay(journal_.back());
+        journal_bytes_ -= journal_.back().bytes;
+        journal_.pop_back();
+    }
+
+    evict();
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void utxo_cache::clear()
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    reset();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// private
+// Records must be contiguous by height, so a gap unrecords all prior blocks.
+void utxo_cache::push(undo&& record)
+{
+    if (!journal_.empty() && journal_.back().height + 1u != record.height)
+    {
+        unrecorded_ = std::max(unrecorded_, journal_.back().height);
+        journal_.clear();
+        journal_bytes_ = 0;
+    }
+
+    journal_bytes_ += record.bytes;
+    journal_.push_back(std::move(record));
+
+    // Pruned records leave their blocks unrecorded (oldest first).
+    while (!journal_.empty() && (journal_.size() > maximum_depth_ ||
+        journal_bytes_ > maximum_bytes_ / journal_divisor))
+    {
+        unrecorded_ = std::max(unrecorded_, journal_.front().height);
+        journal_bytes_ -= journal_.front().bytes;
+        journal_.pop_front();
+    }
+}
+
+// private
+// Spent outputs are restored before created outputs are removed, so that an
+// output both created and spent by the block is removed.
+void utxo_cache::replay(const undo& record)
+{
+    for (const auto& spent: record.spent)
+    {
+        if (entries_.emplace(spent.first, spent.second).second)
+        {
+            order_.push_back(spent.first);
+            bytes_ += spent.second.bytes;
+        }
+    }
+
+    for (const auto& key: record.created)
+    {
+        const auto it = entries_.find(key);
+
+        if (it == entries_.end())
+            continue;
+
+        bytes_ -= it->second.bytes;
+        entries_.erase(it);
+    }
+}
+
+// private
+void utxo_cache::reset()
+{
+    entries_.clear();
+    order_.clear();
+    bytes_ = 0;
+    journal_.clear();
+    journal_bytes_ = 0;
+    unrecorded_ = 0;
+}
+
+// private
+// Spent entries are erased but remain in the order until popped or compacted.
+void utxo_cache::evict()
+{
+    // Compact the order once it is mostly populated by spent outputs.
+    if (order_.size() > 2 * entries_.size())
+    {
+        std::deque<point> order;
+
+        for (const auto& key: order_)
+            if (entries_.find(key) != entries_.end())
+                order.push_back(key);
+
+        order_.swap(order);
+    }
+
+    while (bytes_ > maximum_bytes_ && !order_.empty())
+    {
+        const auto it = entries_.find(order_.front());
+        order_.pop_front();
+
+        if (it == entries_.end())
+            continue;
+
+        bytes_ -= it->second.bytes;
+        entries_.erase(it);
+    }
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
@@ -25,13 +25,41 @@ namespace blockchain {
 
 settings::settings()
   : cores(0),
+    io_cores(0),
+    numa_node(-1),
     priority(true),
     use_libconsensus(false),
+    pipelined_validation(false),
+    fused_validation(false),
+    differential_verification(false),
+    script_cache_size(100000),
+    utxo_cache_megabytes(128),
+    candidate_cache_megabytes(256),
+    hash_filter_megabytes(256),
+    merkle_cache_megabytes(64),
+    transaction_cache_megabytes(64),
+    header_pool_megabytes(64),
+    transaction_pool_megabytes(300),
+    memory_budget_megabytes(0),
+    download_cache_blocks(16),
+    prefetch_blocks(4),
+    speculative_blocks(0),
+    checkpoint_window_blocks(0),
+    header_commit_milliseconds(0),
     byte_fee_satoshis(1),
     sigop_fee_satoshis(100),
     minimum_output_satoshis(500),
     notify_limit_hours(24),
+    notification_queue_limit(1000),
+    index_queue_limit(100),
+    index_filters(false),
+    map_headers(false),
+    index_spends(false),
+    validation_trace_megabytes(64),
+    workload_megabytes(1024),
     reorganization_limit(0),
+    prune_blocks(0),
+    prune_witness_blocks(0),
     difficult(true),
     retarget(true),
     bip16(true),
@@ -48,7 +76,9 @@ settings::settings()
     bip147(true),
     time_warp_patch(false),
     retarget_overflow_patch(false),
-    scrypt_proof_of_work(false)
+    scrypt_proof_of_work(false),
+    block_sigop_limit(max_block_sigops),
+    block_bytes_limit(max_block_size)
 {
 }
 
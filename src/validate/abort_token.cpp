@@ -0,0 +1,40 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/validate/abort_token.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+abort_token::abort_token()
+  : tripped_(false)
+{
+}
+
+void abort_token::trip()
+{
+    tripped_.store(true, std::memory_order_relaxed);
+}
+
+bool abort_token::tripped() const
+{
+    return tripped_.load(std::memory_order_relaxed);
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
@@ -0,0 +1,249 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/validate/input_scheduler.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+using namespace bc::chain;
+using namespace bc::machine;
+
+// Bound the claim granularity so that stealing remains effective.
+static constexpr size_t chunks_per_bucket = 16;
+static constexpr size_t maximum_chunk = 64;
+
+// Each input has a fixed overhead, and each (weighted) sigop is a signature
+// check, which is much costlier than the script bytes that are evaluated.
+// Legacy sigops are weighted four times (bip141), as is their sighash cost.
+static constexpr uint64_t input_cost = 256;
+static constexpr uint64_t sigop_cost = 256;
+
+input_scheduler::input_scheduler(block_const_ptr block,
+    size_t maximum_buckets)
+  : started_(clock::now()),
+    transactions_(0),
+    verified_(0),
+    inputs_(0),
+    chunk_(1),
+    imbalance_(1.0f)
+{
+    const auto& txs = block->transactions();
+    const auto state = block->header().metadata.state;
+    const auto bip16 = state && state->is_enabled(rule_fork::bip16_rule);
+    const auto bip141 = state && state->is_enabled(rule_fork::bip141_rule);
+    std::vector<uint64_t> costs;
+    uint64_t total = 0;
+
+    // Must skip coinbase here as it is already accounted for.
+    for (size_t position = 1; position < txs.size(); ++position)
+    {
+        const auto& tx = txs[position];
+        ++transactions_;
+
+        // The tx exists with current fork state so outputs are validated.
+        if (tx.metadata.verified)
+        {
+            ++verified_;
+            continue;
+        }
+
+        positions_.push_back(position);
+        offsets_.push_back(inputs_);
+        inputs_ += tx.inputs().size();
+
+        for (const auto& input: tx.inputs())
+        {
+            costs.push_back(cost(input, bip16, bip141));
+            total += costs.back();
+        }
+    }
+
+    const auto buckets = std::min(maximum_buckets, inputs_);
+
+    if (buckets == 0)
+        return;
+
+    const auto width = inputs_ / buckets;
+    chunk_ = std::max(size_t(1), std::min(maximum_chunk,
+        width / chunks_per_bucket));
+
+    ranges_ = std::vector<range>(buckets);
+    counters_ = std::vector<counters>(buckets, { 0, 0, 0, started_ });
+
+    size_t position = 0;
+    uint64_t cumulative = 0;
+    uint64_t costliest = 0;
+
+    // Contiguous ranges, each ending once its share of the total is reached.
+    // Given equal costs the first (inputs % buckets) ranges are one wider.
+    for (size_t bucket = 0, begin = 0; bucket < buckets; ++bucket)
+    {
+        const auto prior = cumulative;
+        const auto target = total * (bucket + 1u);
+
+        while (position < inputs_ && cumulative * buckets < target)
+            cumulative += costs[position++];
+
+        ranges_[bucket].cursor.store(begin);
+        ranges_[bucket].end = position;
+        costliest = std::max(costliest, cumulative - prior);
+        begin = position;
+    }
+
+    if (total != 0)
+        imbalance_ = costliest * buckets * 1.0f / total;
+}
+
+uint64_t input_scheduler::cost(const input& input, bool bip16, bool bip141)
+{
+    const auto& prevout = input.previous_output().metadata.cache;
+    const auto prevout_bytes = prevout.is_valid() ?
+        prevout.script().serialized_size(false) : 0u;
+
+    return input_cost + input.script().serialized_size(false) +
+        input.witness().serialized_size(false) + prevout_bytes +
+        sigop_cost * input.signature_operations(bip16, bip141);
+}
+
+size_t input_scheduler::buckets() const
+{
+    return ranges_.size();
+}
+
+size_t input_scheduler::transactions() const
+{
+    return transactions_;
+}
+
+size_t input_scheduler::verified() const
+{
+    return verified_;
+}
+
+size_t input_scheduler::inputs() const
+{
+    return inputs_;
+}
+
+bool input_scheduler::next(size_t bucket, size_t& begin, size_t& end)
+{
+    BITCOIN_ASSERT(bucket < buckets());
+    auto& counts = counters_[bucket];
+
+    if (claim(bucket, begin, end))
+    {
+        counts.inputs += end - begin;
+        return true;
+    }
+
+    // Steal from other ranges, starting with the next bucket.
+    for (size_t offset = 1; offset < buckets(); ++offset)
+    {
+        if (claim((bucket + offset) % buckets(), begin, end))
+        {
+            ++counts.steals;
+            counts.stolen += end - begin;
+            counts.inputs += end - begin;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// private
+bool input_scheduler::claim(size_t bucket, size_t& begin, size_t& end)
+{
+    auto& range = ranges_[bucket];
+
+    // Avoid advancing the cursor of an exhausted range.
+    if (range.cursor.load(std::memory_order_relaxed) >= range.end)
+        return false;
+
+    begin = range.cursor.fetch_add(chunk_);
+
+    if (begin >= range.end)
+        return false;
+
+    end = std::min(begin + chunk_, range.end);
+    return true;
+}
+
+void input_scheduler::locate(size_t position, size_t& out_transaction,
+    uint32_t& out_input) const
+{
+    BITCOIN_ASSERT(position < inputs_);
+
+    // The last offset that is not greater than the position.
+    const auto it = std::prev(std::upper_bound(offsets_.begin(),
+        offsets_.end(), position));
+
+    const auto index = std::distance(offsets_.begin(), it);
+    out_transaction = positions_[index];
+    out_input = static_cast<uint32_t>(position - *it);
+}
+
+void input_scheduler::complete(size_t bucket)
+{
+    BITCOIN_ASSERT(bucket < buckets());
+    counters_[bucket].completed = clock::now();
+}
+
+input_scheduler::statistics input_scheduler::summary() const
+{
+    statistics out{ buckets(), transactions_, verified_, inputs_, 0, 0, 0,
+        1.0f, imbalance_ };
+
+    if (counters_.empty())
+        return out;
+
+    size_t total = 0;
+    size_t latest = 0;
+    out.bucket_microseconds.reserve(counters_.size());
+
+    for (const auto& counts: counters_)
+    {
+        const auto elapsed = static_cast<size_t>(
+            std::chrono::duration_cast<asio::microseconds>(
+                counts.completed - started_).count());
+
+        out.stolen += counts.stolen;
+        out.steals += counts.steals;
+        out.bucket_microseconds.push_back(elapsed);
+        latest = std::max(latest, elapsed);
+        total += elapsed;
+    }
+
+    out.wall_microseconds = latest;
+    out.utilization = latest == 0 ? 1.0f :
+        (total * 1.0f / counters_.size()) / latest;
+
+    return out;
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
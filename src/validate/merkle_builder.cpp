@@ -0,0 +1,206 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/validate/merkle_builder.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+// Each folder claims this many subtrees per bucket, for balance across workers.
+static constexpr size_t slabs_per_bucket = 4;
+
+const size_t merkle_builder::minimum_parallel_leaves = 1024;
+
+static hash_digest parent(const hash_digest& left, const hash_digest& right)
+{
+    std::array<uint8_t, 2u * hash_size> concatenation;
+    std::copy(left.begin(), left.end(), concatenation.begin());
+    std::copy(right.begin(), right.end(), concatenation.begin() + hash_size);
+    return bitcoin_hash(concatenation);
+}
+
+// Each level is folded in place, with an odd last node paired with itself.
+static void fold_level(hash_list& level)
+{
+    if (level.size() % 2u != 0)
+        level.push_back(level.back());
+
+    for (size_t position = 0; position < level.size(); position += 2u)
+        level[position / 2u] = parent(level[position], level[position + 1u]);
+
+    level.resize(level.size() / 2u);
+}
+
+merkle_builder::merkle_builder(dispatcher& dispatch)
+  : dispatch_(dispatch)
+{
+}
+
+// Subtrees are folded on whichever thread is free, and the calling thread
+// also folds, waiting only for subtrees claimed by running helpers, so a
+// saturated pool cannot stall the build. Helpers that start late find no
+// subtree and touch nothing.
+struct merkle_builder::fold_batch
+{
+    fold_batch(const hash_list& leaves, size_t height, size_t slabs)
+      : leaves(leaves), height(height), slabs(slabs), roots(slabs), next(0),
+        remaining(slabs)
+    {
+    }
+
+    const hash_list& leaves;
+    const size_t height;
+    const size_t slabs;
+
+    // Each root is written only by the thread that claims its subtree.
+    hash_list roots;
+    std::atomic<size_t> next;
+
+    // These are protected by mutex.
+    size_t remaining;
+    std::mutex mutex;
+    std::condition_variable completed;
+};
+
+hash_digest merkle_builder::root(const hash_list& leaves) const
+{
+    const auto count = leaves.size();
+    const auto buckets = std::min(dispatch_.size() + 1u,
+        count / minimum_parallel_leaves);
+
+    if (buckets < 2u)
+        return serial_root(leaves);
+
+    // Subtrees are the smallest power of two that yields at most the slabs.
+    // The subtree roots are then exactly the nodes of that level of the tree.
+    const auto slabs = buckets * slabs_per_bucket;
+    size_t height = 0;
+
+    while (((count - 1u) >> height) + 1u > slabs)
+        ++height;
+
+    const auto batch = std::make_shared<fold_batch>(leaves, height,
+        ((count - 1u) >> height) + 1u);
+
+    // The calling thread is the remaining bucket.
+    for (size_t bucket = 1; bucket < buckets; ++bucket)
+        dispatch_.concurrent(&merkle_builder::fold_subtrees, batch);
+
+    fold_subtrees(batch);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->completed.wait(lock, [&batch]() { return batch->remaining == 0; });
+    ///////////////////////////////////////////////////////////////////////////
+
+    return serial_root(batch->roots);
+}
+
+// Leaf hashes are cached by the txs, so these are not hashed again here.
+hash_digest merkle_builder::root(block_const_ptr block) const
+{
+    const auto& txs = block->transactions();
+    hash_list leaves;
+    leaves.reserve(txs.size());
+
+    for (const auto& tx: txs)
+        leaves.push_back(tx.hash(false));
+
+    return root(leaves);
+}
+
+hash_digest merkle_builder::witness_root(block_const_ptr block) const
+{
+    const auto& txs = block->transactions();
+    hash_list leaves;
+    leaves.reserve(txs.size());
+
+    for (const auto& tx: txs)
+        leaves.push_back(tx.hash(true));
+
+    // The coinbase wtxid is committed as null_hash (bip141).
+    if (!leaves.empty())
+        leaves.front() = null_hash;
+
+    return root(leaves);
+}
+
+// static
+hash_digest merkle_builder::serial_root(const hash_list& leaves)
+{
+    if (leaves.empty())
+        return null_hash;
+
+    auto level = leaves;
+
+    while (level.size() > 1u)
+        fold_level(level);
+
+    return level.front();
+}
+
+// private static
+// The last subtree may be partial, in which case its last node is paired
+// with itself at each level, as it is the last node of that level.
+hash_digest merkle_builder::fold(const hash_list& leaves, size_t begin,
+    size_t end, size_t height)
+{
+    hash_list level(leaves.begin() + begin, leaves.begin() + end);
+
+    for (size_t depth = 0; depth < height; ++depth)
+        fold_level(level);
+
+    return level.front();
+}
+
+// private static
+void merkle_builder::fold_subtrees(std::shared_ptr<fold_batch> batch)
+{
+    const auto count = batch->leaves.size();
+    const auto width = size_t(1) << batch->height;
+
+    for (auto slab = batch->next++; slab < batch->slabs;
+        slab = batch->next++)
+    {
+        const auto begin = slab * width;
+        const auto end = std::min(count, begin + width);
+        batch->roots[slab] = fold(batch->leaves, begin, end, batch->height);
+
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        std::unique_lock<std::mutex> lock(batch->mutex);
+
+        if (--batch->remaining == 0)
+            batch->completed.notify_one();
+        ///////////////////////////////////////////////////////////////////////
+    }
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
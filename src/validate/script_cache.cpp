@@ -0,0 +1,213 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/validate/script_cache.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+using namespace bc::chain;
+using namespace bc::machine;
+
+// Sigop counts are keyed on the fork combination with this (unused) index.
+static constexpr uint32_t sigop_index = max_uint32;
+
+constexpr size_t script_cache::shard_count;
+
+script_cache::script_cache(size_t capacity)
+  : capacity_(capacity),
+    shard_capacity_((capacity + shard_count - 1) / shard_count)
+{
+}
+
+size_t script_cache::capacity() const
+{
+    return capacity_;
+}
+
+size_t script_cache::size() const
+{
+    size_t total = 0;
+
+    for (const auto& shard: shards_)
+    {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        shared_lock lock(shard.mutex);
+        total += shard.keys.size();
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    return total;
+}
+
+bool script_cache::exists(const transaction& tx, uint32_t input_index,
+    uint32_t forks) const
+{
+    if (capacity_ == 0)
+        return false;
+
+    const auto value = to_key(tx, input_index, forks);
+    const auto& shard = to_shard(value);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(shard.mutex);
+    return shard.keys.find(value) != shard.keys.end();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void script_cache::add(const transaction& tx, uint32_t input_index,
+    uint32_t forks)
+{
+    if (capacity_ == 0)
+        return;
+
+    const auto value = to_key(tx, input_index, forks);
+    auto& shard = to_shard(value);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(shard.mutex);
+
+    if (!shard.keys.insert(value).second)
+        return;
+
+    shard.order.push_back(value);
+
+    // Evict the oldest entry of the shard.
+    if (shard.order.size() > shard_capacity_)
+    {
+        shard.keys.erase(shard.order.front());
+        shard.order.pop_front();
+    }
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+size_t script_cache::signature_operations(const transaction& tx)
+{
+    const auto state = tx.metadata.state;
+
+    if (!state)
+        return tx.signature_operations();
+
+    return signature_operations(tx, state->is_enabled(rule_fork::bip16_rule),
+        state->is_enabled(rule_fork::bip141_rule));
+}
+
+// Counts of txs with missing previous outputs omit the embedded script and
+// witness sigops, so these are not retained.
+size_t script_cache::signature_operations(const transaction& tx, bool bip16,
+    bool bip141)
+{
+    if (capacity_ == 0 || tx.is_coinbase() ||
+        tx.is_missing_previous_outputs())
+        return tx.signature_operations(bip16, bip141);
+
+    const auto forks = (bip16 ? 1u : 0u) | (bip141 ? 2u : 0u);
+    const auto value = to_key(tx, sigop_index, forks);
+    auto& shard = to_shard(value);
+
+    {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        shared_lock lock(shard.mutex);
+        const auto it = shard.sigops.find(value);
+
+        if (it != shard.sigops.end())
+            return it->second;
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    const auto count = tx.signature_operations(bip16, bip141);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(shard.mutex);
+
+    if (!shard.sigops.emplace(value, count).second)
+        return count;
+
+    shard.sigop_order.push_back(value);
+
+    // Evict the oldest count of the shard.
+    if (shard.sigop_order.size() > shard_capacity_)
+    {
+        shard.sigops.erase(shard.sigop_order.front());
+        shard.sigop_order.pop_front();
+    }
+    ///////////////////////////////////////////////////////////////////////////
+
+    return count;
+}
+
+void script_cache::clear()
+{
+    for (auto& shard: shards_)
+    {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        unique_lock lock(shard.mutex);
+        shard.keys.clear();
+        shard.order.clear();
+        shard.sigops.clear();
+        shard.sigop_order.clear();
+        ///////////////////////////////////////////////////////////////////////
+    }
+}
+
+// private
+// The witness hash commits to input scripts and witnesses, as well as to the
+// previous outputs, which are immutable for a given outpoint.
+script_cache::key script_cache::to_key(const transaction& tx,
+    uint32_t input_index, uint32_t forks)
+{
+    return { tx.hash(true), input_index, forks };
+}
+
+// private
+script_cache::shard& script_cache::to_shard(const key& value)
+{
+    return shards_[value.hash.back() % shard_count];
+}
+
+// private
+const script_cache::shard& script_cache::to_shard(const key& value) const
+{
+    return shards_[value.hash.back() % shard_count];
+}
+
+bool script_cache::key::operator==(const key& other) const
+{
+    return index == other.index && forks == other.forks &&
+        hash == other.hash;
+}
+
+// Hashes are uniformly distributed so a prefix is sufficient.
+size_t script_cache::key_hash::operator()(const key& value) const
+{
+    const auto prefix = from_little_endian_unsafe<size_t>(value.hash.begin());
+    return prefix ^ (size_t(value.index) << 8) ^ value.forks;
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
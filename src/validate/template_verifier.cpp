@@ -0,0 +1,189 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/blockchain/validate/template_verifier.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+using namespace bc::chain;
+using namespace bc::machine;
+
+static constexpr uint8_t push_20 = 0x14;
+static constexpr uint8_t push_22 = 0x16;
+static constexpr uint8_t push_75 = 0x4b;
+static const auto op_dup = static_cast<uint8_t>(opcode::dup);
+static const auto op_hash160 = static_cast<uint8_t>(opcode::hash160);
+static const auto op_equal = static_cast<uint8_t>(opcode::equal);
+static const auto op_equalverify = static_cast<uint8_t>(opcode::equalverify);
+static const auto op_checksig = static_cast<uint8_t>(opcode::checksig);
+static const auto op_zero = static_cast<uint8_t>(opcode::push_size_0);
+
+static short_hash to_short_hash(const uint8_t* data)
+{
+    short_hash out;
+    std::copy_n(data, short_hash_size, out.begin());
+    return out;
+}
+
+// Templates are matched on the serialization, so only canonical encodings
+// (direct pushes) are affirmed and all others take the generic path.
+bool template_verifier::verify(const transaction& tx, uint32_t input_index,
+    uint32_t forks)
+{
+    BITCOIN_ASSERT(input_index < tx.inputs().size());
+    const auto& input = tx.inputs()[input_index];
+    const auto& prevout = input.previous_output().metadata.cache;
+
+    if (!prevout.is_valid())
+        return false;
+
+    const auto script = prevout.script().to_data(false);
+    const auto size = script.size();
+    const auto data = script.data();
+    const auto value = prevout.value();
+
+    // The interpreter would reject any witness for a non-witness prevout.
+    if (size == 25 && data[0] == op_dup && data[1] == op_hash160 &&
+        data[2] == push_20 && data[23] == op_equalverify &&
+        data[24] == op_checksig)
+    {
+        return input.witness().stack().empty() && verify_key_hash(tx,
+            input_index, forks, input.script().to_data(false),
+            to_short_hash(data + 3), value);
+    }
+
+    if (!script::is_enabled(forks, rule_fork::bip141_rule))
+        return false;
+
+    // A native witness program requires an empty input script.
+    if (size == 22 && data[0] == op_zero && data[1] == push_20)
+    {
+        return input.script().empty() && verify_witness_key_hash(tx,
+            input_index, forks, to_short_hash(data + 2), value);
+    }
+
+    if (!script::is_enabled(forks, rule_fork::bip16_rule))
+        return false;
+
+    // A wrapped witness program requires an input script of one push of it.
+    if (size == 23 && data[0] == op_hash160 && data[1] == push_20 &&
+        data[22] == op_equal)
+    {
+        const auto redeem = input.script().to_data(false);
+
+        if (redeem.size() != 23 || redeem[0] != push_22 ||
+            redeem[1] != op_zero || redeem[2] != push_20)
+            return false;
+
+        const data_slice program(redeem.data() + 1,
+            redeem.data() + redeem.size());
+
+        if (bitcoin_short_hash(program) != to_short_hash(data + 2))
+            return false;
+
+        return verify_witness_key_hash(tx, input_index, forks,
+            to_short_hash(redeem.data() + 3), value);
+    }
+
+    return false;
+}
+
+// private static
+// The input script must be exactly two direct pushes (endorsement, key).
+bool template_verifier::verify_key_hash(const transaction& tx,
+    uint32_t input_index, uint32_t forks, const data_chunk& script_sig,
+    const short_hash& hash, uint64_t value)
+{
+    const auto size = script_sig.size();
+
+    if (size < 2u || script_sig[0] == 0 || script_sig[0] > push_75)
+        return false;
+
+    const size_t endorsement_size = script_sig[0];
+    const auto key_offset = endorsement_size + 1u;
+
+    if (key_offset >= size || script_sig[key_offset] == 0 ||
+        script_sig[key_offset] > push_75)
+        return false;
+
+    const size_t key_size = script_sig[key_offset];
+
+    if (key_offset + 1u + key_size != size)
+        return false;
+
+    const auto begin = script_sig.begin();
+    const data_chunk endorsement(begin + 1, begin + key_offset);
+    const data_chunk public_key(begin + key_offset + 1, script_sig.end());
+
+    if (bitcoin_short_hash(public_key) != hash)
+        return false;
+
+    const auto& script_code = tx.inputs()[input_index].previous_output().
+        metadata.cache.script();
+
+    return check_signature(endorsement, public_key, script_code, tx,
+        input_index, forks, script_version::unversioned, value);
+}
+
+// private static
+// The witness must be exactly two elements (endorsement, key).
+bool template_verifier::verify_witness_key_hash(const transaction& tx,
+    uint32_t input_index, uint32_t forks, const short_hash& hash,
+    uint64_t value)
+{
+    const auto& stack = tx.inputs()[input_index].witness().stack();
+
+    if (stack.size() != 2u || bitcoin_short_hash(stack[1]) != hash)
+        return false;
+
+    const script script_code(script::to_pay_key_hash_pattern(hash));
+    return check_signature(stack[0], stack[1], script_code, tx, input_index,
+        forks, script_version::zero, value);
+}
+
+// private static
+// This follows the checksig of the interpreter, where parse failure or an
+// invalid signature is a false result.
+bool template_verifier::check_signature(const data_chunk& endorsement,
+    const data_chunk& public_key, const script& script_code,
+    const transaction& tx, uint32_t input_index, uint32_t forks,
+    script_version version, uint64_t value)
+{
+    if (endorsement.empty())
+        return false;
+
+    uint8_t sighash_type;
+    der_signature distinguished;
+    ec_signature signature;
+    auto copy = endorsement;
+    const auto strict = script::is_enabled(forks, rule_fork::bip66_rule);
+
+    return parse_endorsement(sighash_type, distinguished, std::move(copy)) &&
+        parse_signature(signature, distinguished, strict) &&
+        script::check_signature(signature, sighash_type, public_key,
+            script_code, tx, input_index, version, value);
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
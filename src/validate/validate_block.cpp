@@ -19,14 +19,21 @@
 #include <bitcoin/blockchain/validate/validate_block.hpp>
 
 #include <algorithm>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <iterator>
 #include <memory>
+#include <mutex>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/blockchain/interface/fast_chain.hpp>
+#include <bitcoin/blockchain/pools/validation_trace.hpp>
 #include <bitcoin/blockchain/settings.hpp>
+#include <bitcoin/blockchain/validate/abort_token.hpp>
+#include <bitcoin/blockchain/validate/input_scheduler.hpp>
+#include <bitcoin/blockchain/validate/merkle_builder.hpp>
+#include <bitcoin/blockchain/validate/script_cache.hpp>
 #include <bitcoin/blockchain/validate/validate_input.hpp>
 
 namespace libbitcoin {
@@ -38,13 +45,27 @@ using namespace std::placeholders;
 
 #define NAME "validate_block"
 
-validate_block::validate_block(dispatcher& dispatch, const fast_chain& chain,
+// Smaller blocks are hashed serially by the check, as dispatch would dominate.
+static constexpr size_t minimum_parallel_hash = 64;
+
+// Each hasher claims this many slabs per bucket, for balance across workers.
+static constexpr size_t slabs_per_bucket = 4;
+
+validate_block::validate_block(dispatcher& dispatch, dispatcher& io_dispatch,
+    const fast_chain& chain, script_cache& cache, validation_trace& trace,
     const settings& settings,  bc::settings& bitcoin_settings)
   : stopped_(true),
     use_libconsensus_(settings.use_libconsensus),
+    differential_(settings.differential_verification),
+    fused_(settings.fused_validation),
+    assume_valid_(settings.assume_valid),
     checkpoints_(settings.checkpoints),
+    fast_chain_(chain),
     priority_dispatch_(dispatch),
-    block_populator_(dispatch, chain),
+    merkle_builder_(dispatch),
+    script_cache_(cache),
+    trace_(trace),
+    block_populator_(io_dispatch, chain, trace),
     scrypt_(settings.scrypt_proof_of_work),
     bitcoin_settings_(bitcoin_settings)
 {
@@ -58,6 +79,23 @@ bool validate_block::stopped() const
     return stopped_;
 }
 
+// Blocks are validated in the candidate index, so the block at the height is
+// an ancestor of the assumed valid block if that is a candidate at or above.
+bool validate_block::is_assumed_valid(size_t height) const
+{
+    if (assume_valid_ == null_hash)
+        return false;
+
+    size_t assumed_height;
+    chain::header assumed_header;
+    hash_digest candidate_hash;
+
+    return fast_chain_.get_header(assumed_header, assumed_height,
+        assume_valid_, true) && height <= assumed_height &&
+        fast_chain_.get_block_hash(candidate_hash, assumed_height, true) &&
+        candidate_hash == assume_valid_;
+}
+
 // Start/stop sequences.
 //-----------------------------------------------------------------------------
 
@@ -93,6 +131,20 @@ void validate_block::check(block_const_ptr block, size_t height) const
     }
     else
     {
+        // Tx hashes are cached, so the merkle root is computed from these.
+        hash(block);
+
+        // The root of a large block is folded concurrently, so that a
+        // malleated or corrupted block is rejected before the serial checks.
+        if (block->transactions().size() >=
+            merkle_builder::minimum_parallel_leaves &&
+            merkle_builder_.root(block) != block->header().merkle_root())
+        {
+            metadata.error = error::merkle_mismatch;
+            metadata.validated = false;
+            return;
+        }
+
         // Run context free checks, block is not yet fully validated.
         metadata.error = block->check(bitcoin_settings_.max_money(),
             bitcoin_settings_.timestamp_limit_seconds,
@@ -101,22 +153,116 @@ void validate_block::check(block_const_ptr block, size_t height) const
     }
 }
 
+// Slabs of txs are claimed by whichever thread is free, and the calling
+// thread also hashes, waiting only for slabs claimed by running helpers, so
+// a saturated pool cannot stall the check. Helpers that start late find no
+// slab and touch nothing.
+struct validate_block::hash_batch
+{
+    hash_batch(block_const_ptr block, size_t slabs)
+      : block(block), slabs(slabs), next(0), remaining(slabs)
+    {
+    }
+
+    const block_const_ptr block;
+    const size_t slabs;
+    std::atomic<size_t> next;
+
+    // These are protected by mutex.
+    size_t remaining;
+    std::mutex mutex;
+    std::condition_variable completed;
+};
+
+// private
+// Tx (and witness tx) hashes are computed concurrently into the hash caches
+// of the txs, so the merkle root, the store and filters do not hash again.
+// The bip143 signature hash components of segregated txs are also cached.
+void validate_block::hash(block_const_ptr block) const
+{
+    const auto count = block->transactions().size();
+    const auto buckets = std::min(priority_dispatch_.size() + 1u,
+        count / minimum_parallel_hash);
+
+    if (buckets < 2u)
+        return;
+
+    const auto batch = std::make_shared<hash_batch>(block,
+        buckets * slabs_per_bucket);
+
+    // The calling thread is the remaining bucket.
+    for (size_t bucket = 1; bucket < buckets; ++bucket)
+        priority_dispatch_.concurrent(&validate_block::hash_transactions,
+            batch);
+
+    hash_transactions(batch);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->completed.wait(lock, [&batch]() { return batch->remaining == 0; });
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// private static
+void validate_block::hash_transactions(std::shared_ptr<hash_batch> batch)
+{
+    const auto& txs = batch->block->transactions();
+    const auto count = txs.size();
+
+    for (auto slab = batch->next++; slab < batch->slabs;
+        slab = batch->next++)
+    {
+        const auto begin = count * slab / batch->slabs;
+        const auto end = count * (slab + 1u) / batch->slabs;
+
+        for (auto position = begin; position < end; ++position)
+        {
+            const auto& tx = txs[position];
+            /* hash_digest */ tx.hash(false);
+
+            if (tx.is_segregated())
+                /* hash_digest */ tx.hash(true);
+
+            validate_input::prepare(tx);
+        }
+
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        std::unique_lock<std::mutex> lock(batch->mutex);
+
+        if (--batch->remaining == 0)
+            batch->completed.notify_one();
+        ///////////////////////////////////////////////////////////////////////
+    }
+}
+
 // Accept sequence.
 //-----------------------------------------------------------------------------
 // These checks require chain state, and block state if not under checkpoint.
 
-void validate_block::accept(block_const_ptr block,
+void validate_block::accept(block_const_ptr block, abort_token::ptr token,
     result_handler handler) const
 {
     // Returns store code only.
-    block_populator_.populate(block,
+    block_populator_.populate(block, token,
+        std::bind(&validate_block::handle_populated,
+            this, _1, block, token, handler));
+}
+
+// The parent is validated but not yet committed as a candidate (pipelined).
+void validate_block::accept(block_const_ptr block, block_const_ptr parent,
+    abort_token::ptr token, result_handler handler) const
+{
+    // Returns store code only.
+    block_populator_.populate(block, parent, token,
         std::bind(&validate_block::handle_populated,
-            this, _1, block, handler));
+            this, _1, block, token, handler));
 }
 
 // Returns store code only.
 void validate_block::handle_populated(const code& ec, block_const_ptr block,
-    result_handler handler) const
+    abort_token::ptr token, result_handler handler) const
 {
     if (stopped())
     {
@@ -132,7 +278,8 @@ void validate_block::handle_populated(const code& ec, block_const_ptr block,
 
     auto& metadata = block->header().metadata;
 
-    if (metadata.validated)
+    // Population was abandoned, or the block is already validated.
+    if (token->tripped() || metadata.validated)
     {
         handler(error::success);
         return;
@@ -150,21 +297,28 @@ void validate_block::handle_populated(const code& ec, block_const_ptr block,
     // Run contextual block non-tx checks (sets start time).
     if ((metadata.error = block->accept(bitcoin_settings_, false)))
     {
+        token->trip();
         metadata.validated = true;
         handler(error::success);
         return;
     }
 
+    // Transaction checks are deferred to the fused pass of connect.
+    if (fused_)
+    {
+        handler(error::success);
+        return;
+    }
+
     const auto sigops = std::make_shared<atomic_counter>(0);
     const auto bip141 = metadata.state->is_enabled(rule_fork::bip141_rule);
 
     result_handler complete_handler =
         std::bind(&validate_block::handle_accepted,
-            this, _1, block, sigops, bip141, handler);
+            this, _1, block, sigops, bip141, token, handler);
 
-    // The threadpool must be initialized with at least 2 threads.
-    // One dedicated thread is required by the validation subscriber.
-    const auto threads = priority_dispatch_.size() - 1u;
+    // No priority thread waits on validation, so all may be used.
+    const auto threads = priority_dispatch_.size();
     const auto count = block->transactions().size();
     const auto bip16 = metadata.state->is_enabled(rule_fork::bip16_rule);
     const auto buckets = std::min(threads, count);
@@ -175,13 +329,14 @@ void validate_block::handle_populated(const code& ec, block_const_ptr block,
 
     for (size_t bucket = 0; bucket < buckets; ++bucket)
         priority_dispatch_.concurrent(&validate_block::accept_transactions,
-            this, block, bucket, buckets, sigops, bip16, bip141, join_handler);
+            this, block, bucket, buckets, sigops, bip16, bip141, token,
+            join_handler);
 }
 
 // Returns validation code only.
 void validate_block::accept_transactions(block_const_ptr block, size_t bucket,
     size_t buckets, atomic_counter_ptr sigops, bool bip16, bool bip141,
-    result_handler handler) const
+    abort_token::ptr token, result_handler handler) const
 {
     code ec;
     const auto& state = *block->header().metadata.state;
@@ -189,11 +344,19 @@ void validate_block::accept_transactions(block_const_ptr block, size_t bucket,
     const auto count = txs.size();
 
     // Run contextual tx non-script checks (not in tx order).
-    for (auto tx = bucket; tx < count && !ec; tx = ceiling_add(tx, buckets))
+    for (auto tx = bucket; tx < count && !token->tripped();
+        tx = ceiling_add(tx, buckets))
     {
          auto& transaction = txs[tx];
-        ec = transaction.accept(state, false);
-        *sigops += transaction.signature_operations(bip16, bip141);
+
+        if ((ec = transaction.accept(state, false)))
+        {
+            token->trip();
+            break;
+        }
+
+        *sigops += script_cache_.signature_operations(transaction, bip16,
+            bip141);
     }
 
     handler(ec);
@@ -201,7 +364,8 @@ void validate_block::accept_transactions(block_const_ptr block, size_t bucket,
 
 // Returns store code only.
 void validate_block::handle_accepted(const code& ec, block_const_ptr block,
-    atomic_counter_ptr sigops, bool bip141, result_handler handler) const
+    atomic_counter_ptr sigops, bool bip141, abort_token::ptr token,
+    result_handler handler) const
 {
     if (ec)
     {
@@ -210,7 +374,10 @@ void validate_block::handle_accepted(const code& ec, block_const_ptr block,
     else
     {
         if (*sigops > (bip141 ? max_fast_sigops : max_block_sigops))
+        {
+            token->trip();
             block->header().metadata.error = error::block_embedded_sigop_limit;
+        }
     }
 
     handler(error::success);
@@ -221,7 +388,7 @@ void validate_block::handle_accepted(const code& ec, block_const_ptr block,
 // These checks require chain state, block state and perform script metadata.
 
 // Returns store code only.
-void validate_block::connect(block_const_ptr block,
+void validate_block::connect(block_const_ptr block, abort_token::ptr token,
     result_handler handler) const
 {
     // We are reimplementing connect, so must set timer externally.
@@ -230,12 +397,20 @@ void validate_block::connect(block_const_ptr block,
     const auto state = block->header().metadata.state;
     BITCOIN_ASSERT(state);
 
-    if (state->is_under_checkpoint())
+    // The block failed accept or was abandoned, so do not verify scripts.
+    if (state->is_under_checkpoint() || token->tripped())
     {
         handler(error::success);
         return;
     }
 
+    // Transactions are accepted in connect, so this is required for coinbase.
+    if (fused_)
+    {
+        connect_fused(block, token, handler);
+        return;
+    }
+
     const auto non_coinbase_inputs = block->total_non_coinbase_inputs();
 
     // Return if there are no non-coinbase inputs to validate.
@@ -245,91 +420,108 @@ void validate_block::connect(block_const_ptr block,
         return;
     }
 
+    // Scripts of assumed valid blocks are not verified, treat all as cached.
+    if (is_assumed_valid(state->height()))
+    {
+        const auto transactions = block->transactions().size() - 1u;
+        hits_ = transactions;
+        queries_ = transactions;
+        block->metadata.cache_efficiency = hit_rate();
+
+        LOG_DEBUG(LOG_BLOCKCHAIN)
+            << "Assumed valid block [" << state->height()
+            << "] skipped script verification of " << non_coinbase_inputs
+            << " inputs.";
+
+        handler(error::success);
+        return;
+    }
+
+    // No priority thread waits on validation, so all may be used.
+    const auto threads = priority_dispatch_.size();
+    const auto scheduler = std::make_shared<input_scheduler>(block, threads);
+
     // Reset statistics for each block (treat coinbase as cached).
-    hits_ = 0;
-    queries_ = 0;
+    hits_ = scheduler->verified();
+    queries_ = scheduler->transactions();
+
+    // Return if all non-coinbase transactions are already verified.
+    if (scheduler->buckets() == 0)
+    {
+        handle_connected(error::success, block, scheduler, handler);
+        return;
+    }
 
     result_handler complete_handler =
         std::bind(&validate_block::handle_connected,
-            this, _1, block, handler);
+            this, _1, block, scheduler, handler);
 
-    // The threadpool must be initialized with at least 2 threads.
-    // One dedicated thread is required by the validation subscriber.
-    const auto threads = priority_dispatch_.size() - 1u;
-    const auto buckets = std::min(threads, non_coinbase_inputs);
-    BITCOIN_ASSERT(buckets != 0);
+    // These are already cached by the check of large blocks.
+    for (const auto& tx: block->transactions())
+        if (!tx.metadata.verified)
+            validate_input::prepare(tx);
 
+    const auto buckets = scheduler->buckets();
     const auto join_handler = synchronize(std::move(complete_handler), buckets,
         NAME "_validate");
 
     for (size_t bucket = 0; bucket < buckets; ++bucket)
         priority_dispatch_.concurrent(&validate_block::connect_inputs,
-            this, block, bucket, buckets, join_handler);
+            this, block, scheduler, token, bucket, join_handler);
 }
 
 // Returns store code only.
-void validate_block::connect_inputs(block_const_ptr block, size_t bucket,
-    size_t buckets, result_handler handler) const
+// Inputs are claimed in contiguous chunks, own range first and then stolen.
+// All buckets return within one input of the token being tripped.
+void validate_block::connect_inputs(block_const_ptr block,
+    input_scheduler::ptr scheduler, abort_token::ptr token, size_t bucket,
+    result_handler handler) const
 {
-    BITCOIN_ASSERT(bucket < buckets);
+    BITCOIN_ASSERT(bucket < scheduler->buckets());
 
     code ec(error::success);
     const auto state = block->header().metadata.state;
     const auto forks = state->enabled_forks();
      auto& txs = block->transactions();
-    size_t position = 0;
+    size_t begin;
+    size_t end;
 
-    // Must skip coinbase here as it is already accounted for.
-    for (auto tx = std::next(txs.begin()); tx != txs.end(); ++tx)
+    while (!ec && !token->tripped() && scheduler->next(bucket, begin, end))
     {
-        ++queries_;
-
-        // The tx exists with current fork state so outputs are validated.
-        if (tx->metadata.verified)
+        for (auto position = begin; position < end && !token->tripped();
+            ++position)
         {
-            ++hits_;
-            continue;
-        }
-
-        size_t input_index;
-        const auto& inputs = tx->inputs();
-
-        for (input_index = 0; input_index < inputs.size();
-            ++input_index, ++position)
-        {
-            if (position % buckets != bucket)
-                continue;
-
             if (stopped())
             {
+                scheduler->complete(bucket);
                 handler(error::service_stopped);
                 return;
             }
 
-            const auto& prevout = inputs[input_index].previous_output();
+            size_t tx_index;
+            uint32_t input_index;
+            scheduler->locate(position, tx_index, input_index);
+             auto& tx = txs[tx_index];
+            const auto& prevout = tx.inputs()[input_index].previous_output();
 
             if (!prevout.metadata.cache.is_valid())
-            {
                 ec = error::missing_previous_output;
-                break;
-            }
+            else
+                ec = validate_input::verify_script(tx, input_index, forks,
+                    use_libconsensus_, script_cache_, false, differential_);
 
-            if ((ec = validate_input::verify_script(*tx, input_index, forks,
-                use_libconsensus_)))
+            if (ec)
             {
+                token->trip();
+                block->header().metadata.error = ec;
+                const auto height = state->height();
+                dump(ec, tx, input_index, forks, height, use_libconsensus_);
                 break;
             }
         }
-
-        if (ec)
-        {
-            block->header().metadata.error = ec;
-            const auto height = state->height();
-            dump(ec, *tx, input_index, forks, height, use_libconsensus_);
-            break;
-        }
     }
 
+    scheduler->complete(bucket);
     handler(error::success);
 }
 
@@ -342,12 +534,205 @@ float validate_block::hit_rate() const
 
 // Returns store code only.
 void validate_block::handle_connected(const code& ec, block_const_ptr block,
-    result_handler handler) const
+    input_scheduler::ptr scheduler, result_handler handler) const
 {
     block->metadata.cache_efficiency = hit_rate();
+
+    const auto summary = scheduler->summary();
+    LOG_DEBUG(LOG_BLOCKCHAIN)
+        << "Connected block [" << block->header().metadata.state->height()
+        << "] inputs: " << summary.inputs
+        << " buckets: " << summary.buckets
+        << " steals: " << summary.steals
+        << " stolen: " << summary.stolen
+        << " utilization: " << summary.utilization
+        << " imbalance: " << summary.imbalance
+        << " wall: " << summary.wall_microseconds << "us";
+
+    if (trace_.enabled())
+        trace_.connected(block->hash(), summary);
+
     handler(ec);
 }
 
+// Fused sequence.
+//-----------------------------------------------------------------------------
+// Each bucket accepts, counts sigops and verifies scripts over a contiguous
+// slab of transactions, so that each tx and its prevouts are visited once.
+
+// Returns store code only.
+void validate_block::connect_fused(block_const_ptr block,
+    abort_token::ptr token, result_handler handler) const
+{
+    const auto& metadata = block->header().metadata;
+    const auto state = metadata.state;
+    const auto sigops = std::make_shared<atomic_counter>(0);
+    const auto bip16 = state->is_enabled(rule_fork::bip16_rule);
+    const auto bip141 = state->is_enabled(rule_fork::bip141_rule);
+
+    // Transactions of a block validated before population were not accepted.
+    const auto accept = !metadata.validated;
+    const auto verify = !is_assumed_valid(state->height());
+
+    // Reset statistics for each block (treat coinbase as cached).
+    hits_ = 0;
+    queries_ = 0;
+
+    result_handler complete_handler =
+        std::bind(&validate_block::handle_fused,
+            this, _1, block, sigops, bip141, handler);
+
+    // No priority thread waits on validation, so all may be used.
+    const auto threads = priority_dispatch_.size();
+    const auto count = block->transactions().size();
+    const auto buckets = std::min(threads, count);
+    BITCOIN_ASSERT_MSG(buckets != 0, "block check must require transactions");
+
+    const auto join_handler = synchronize(std::move(complete_handler), buckets,
+        NAME "_fused");
+
+    for (size_t bucket = 0; bucket < buckets; ++bucket)
+        priority_dispatch_.concurrent(&validate_block::fuse_transactions,
+            this, block, bucket, buckets, sigops, bip16, bip141, accept,
+            verify, token, join_handler);
+}
+
+// Returns validation code only.
+void validate_block::fuse_transactions(block_const_ptr block, size_t bucket,
+    size_t buckets, atomic_counter_ptr sigops, bool bip16, bool bip141,
+    bool accept, bool verify, abort_token::ptr token,
+    result_handler handler) const
+{
+    BITCOIN_ASSERT(bucket < buckets);
+
+    code ec;
+    const auto& state = *block->header().metadata.state;
+    const auto forks = state.enabled_forks();
+     auto& txs = block->transactions();
+    const auto count = txs.size();
+
+    // The contiguous slab of transactions owned by this bucket.
+    const auto first = count * bucket / buckets;
+    const auto last = count * (bucket + 1u) / buckets;
+
+    for (auto position = first; position < last && !token->tripped();
+        ++position)
+    {
+        if (stopped())
+        {
+            handler(error::service_stopped);
+            return;
+        }
+
+         auto& tx = txs[position];
+
+        if (accept && (ec = tx.accept(state, false)))
+            break;
+
+        *sigops += script_cache_.signature_operations(tx, bip16, bip141);
+
+        // A coinbase input does not spend a previous output.
+        if (position == 0)
+            continue;
+
+        ++queries_;
+
+        // The tx exists with current fork state so outputs are validated.
+        if (!verify || tx.metadata.verified)
+        {
+            ++hits_;
+            continue;
+        }
+
+        const auto& inputs = tx.inputs();
+
+        for (uint32_t index = 0; index < inputs.size() && !token->tripped();
+            ++index)
+        {
+            if (!inputs[index].previous_output().metadata.cache.is_valid())
+                ec = error::missing_previous_output;
+            else
+                ec = validate_input::verify_script(tx, index, forks,
+                    use_libconsensus_, script_cache_, false, differential_);
+
+            if (ec)
+            {
+                dump(ec, tx, index, forks, state.height(), use_libconsensus_);
+                break;
+            }
+        }
+
+        if (ec)
+            break;
+    }
+
+    if (ec)
+        token->trip();
+
+    handler(ec);
+}
+
+// Returns store code only.
+// The block-wide sigop limit is applied once all slabs are joined.
+void validate_block::handle_fused(const code& ec, block_const_ptr block,
+    atomic_counter_ptr sigops, bool bip141, result_handler handler) const
+{
+    if (stopped())
+    {
+        handler(error::service_stopped);
+        return;
+    }
+
+    if (ec)
+    {
+        block->header().metadata.error = ec;
+    }
+    else
+    {
+        if (*sigops > (bip141 ? max_fast_sigops : max_block_sigops))
+            block->header().metadata.error = error::block_embedded_sigop_limit;
+    }
+
+    block->metadata.cache_efficiency = hit_rate();
+    handler(error::success);
+}
+
+// Speculative sequence.
+//-----------------------------------------------------------------------------
+// Outputs created by unconfirmed blocks (including this one) are not
+// populated, so their spends are left to connect. Forks are those of the
+// top valid candidate (below the block), so a fork change between it and the
+// block only forgoes the cache.
+
+void validate_block::speculate(block_const_ptr block) const
+{
+    const auto state = fast_chain_.top_valid_candidate_state();
+    const auto forks = state->enabled_forks();
+     auto& txs = block->transactions();
+    fast_chain::outpoints prevouts;
+
+    // Must skip coinbase here as it does not spend a previous output.
+    for (size_t position = 1; position < txs.size(); ++position)
+        for (const auto& input: txs[position].inputs())
+            prevouts.push_back(&input.previous_output());
+
+    fast_chain_.populate_outputs(prevouts, max_size_t, false);
+
+    for (size_t position = 1; position < txs.size() && !stopped();
+        ++position)
+    {
+         auto& tx = txs[position];
+        const auto& inputs = tx.inputs();
+
+        // The tx is left to connect once any input fails.
+        for (uint32_t index = 0; index < inputs.size(); ++index)
+            if (inputs[index].previous_output().metadata.cache.is_valid() &&
+                validate_input::verify_script(tx, index, forks,
+                    use_libconsensus_, script_cache_, true, differential_))
+                break;
+    }
+}
+
 // Utility.
 //-----------------------------------------------------------------------------
 
@@ -97,6 +97,29 @@ void validate_header::accept(header_branch::ptr branch,
             this, _1, branch, handler));
 }
 
+code validate_header::accept(header_branch::ptr branch) const
+{
+    // Populate header state for the top header (others are valid).
+    const auto ec = header_populator_.populate(branch);
+
+    if (stopped())
+        return error::service_stopped;
+
+    if (ec)
+        return ec;
+
+    const auto header = branch->top();
+
+    // Skip validation if full block was validated (is valid at this point).
+    if (header->metadata.validated)
+        return error::success;
+
+    BITCOIN_ASSERT(header->metadata.state);
+
+    // Run contextual header checks.
+    return header->accept();
+}
+
 void validate_header::handle_populated(const code& ec,
     header_branch::ptr branch, result_handler handler) const
 {
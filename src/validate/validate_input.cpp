@@ -20,6 +20,7 @@
 
 #include <cstdint>
 #include <bitcoin/bitcoin.hpp>
+#include <bitcoin/blockchain/validate/template_verifier.hpp>
 
 #ifdef WITH_CONSENSUS
 #include <bitcoin/consensus.hpp>
@@ -150,7 +151,25 @@ code validate_input::convert_result(verify_result_type result)
     }
 }
 
-// TODO: cache transaction wire serialization.
+// The wire serialization of the last tx verified on this thread, keyed by its
+// witness hash, which commits to the full serialization. Each scheduler
+// verifies the inputs of a tx in runs on one thread, so a tx is serialized
+// once for all of its inputs, not once for each.
+static const data_chunk& serialize(const transaction& tx)
+{
+    static thread_local hash_digest hash = null_hash;
+    static thread_local data_chunk data;
+    const auto tx_hash = tx.hash(true);
+
+    if (data.empty() || tx_hash != hash)
+    {
+        data = tx.to_data(true, true);
+        hash = tx_hash;
+    }
+
+    return data;
+}
+
 code validate_input::verify_script( transaction& tx, uint32_t input_index,
     uint32_t forks, bool use_libconsensus)
 {
@@ -162,7 +181,7 @@ code validate_input::verify_script( transaction& tx, uint32_t input_index,
     const auto script_data = prevout.cache.script().to_data(false);
     const auto prevout_value = prevout.cache.value();
 
-    const auto tx_data = tx.to_data(true, true);
+    const auto& tx_data = serialize(tx);
 
     // libconsensus
     return convert_result(consensus::verify_script(tx_data.data(),
@@ -183,5 +202,40 @@ code validate_input::verify_script( transaction& tx,
 
 #endif
 
+void validate_input::prepare(const transaction& tx)
+{
+    if (!tx.is_segregated())
+        return;
+
+    /* hash_digest */ tx.inpoints_hash();
+    /* hash_digest */ tx.sequences_hash();
+    /* hash_digest */ tx.outputs_hash();
+}
+
+code validate_input::verify_script( transaction& tx, uint32_t input_index,
+    uint32_t forks, bool use_libconsensus, script_cache& cache, bool store,
+    bool differential)
+{
+    if (cache.exists(tx, input_index, forks))
+        return error::success;
+
+    const auto affirmed = template_verifier::verify(tx, input_index, forks);
+    const auto ec = affirmed && !differential ? code(error::success) :
+        verify_script(tx, input_index, forks, use_libconsensus);
+
+    // The generic result is authoritative, as the template is an optimization.
+    if (affirmed && ec)
+        LOG_ERROR(LOG_BLOCKCHAIN)
+            << "Template verification of input [" << input_index
+            << "] of tx [" << encode_hash(tx.hash()) << "] differs from "
+            << "generic (" << ec.message() << ").";
+
+    // Only successful verifications are cached.
+    if (!ec && store)
+        cache.add(tx, input_index, forks);
+
+    return ec;
+}
+
 } // namespace blockchain
 } // namespace libbitcoin
@@ -23,8 +23,10 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <utility>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/blockchain/settings.hpp>
+#include <bitcoin/blockchain/validate/script_cache.hpp>
 #include <bitcoin/blockchain/validate/validate_input.hpp>
 
 namespace libbitcoin {
@@ -37,12 +39,15 @@ using namespace std::placeholders;
 #define NAME "validate_transaction"
 
 validate_transaction::validate_transaction(dispatcher& dispatch,
-    const fast_chain& chain, const settings& settings)
+    dispatcher& io_dispatch, const fast_chain& chain, script_cache& cache,
+    const settings& settings)
   : stopped_(true),
     retarget_(settings.retarget),
     use_libconsensus_(settings.use_libconsensus),
+    differential_(settings.differential_verification),
     dispatch_(dispatch),
-    transaction_populator_(dispatch, chain)
+    script_cache_(cache),
+    transaction_populator_(io_dispatch, chain)
 {
 }
 
@@ -123,6 +128,9 @@ void validate_transaction::connect(transaction_const_ptr tx,
     const auto join_handler = synchronize(handler, buckets, NAME "_validate");
     BITCOIN_ASSERT_MSG(buckets != 0, "transaction check must require inputs");
 
+    // Inputs of the tx are interleaved across buckets.
+    validate_input::prepare(*tx);
+
     // If the priority threadpool is shut down when this is called the handler
     // will never be invoked, resulting in a threadpool.join indefinite hang.
     for (size_t bucket = 0; bucket < buckets; ++bucket)
@@ -157,8 +165,9 @@ void validate_transaction::connect_inputs(transaction_const_ptr tx,
             break;
         }
 
+        // Successful verifications are cached for validation of the block.
         if ((ec = validate_input::verify_script(*tx, input_index, forks,
-            use_libconsensus_)))
+            use_libconsensus_, script_cache_, true, differential_)))
         {
             break;
         }
@@ -167,5 +176,162 @@ void validate_transaction::connect_inputs(transaction_const_ptr tx,
     handler(ec);
 }
 
+// Set sequences.
+//-----------------------------------------------------------------------------
+// The set shares one chain state and one fan-out for each of population and
+// script verification, so small txs use all threads of the priority pool.
+
+void validate_transaction::accept(transaction_const_ptr_list_const_ptr txs,
+    result_list_ptr results, result_handler handler) const
+{
+    BITCOIN_ASSERT(results->size() == txs->size());
+
+    transaction_populator_.populate(txs,
+        std::bind(&validate_transaction::handle_populated_set,
+            this, _1, txs, results, handler));
+}
+
+void validate_transaction::handle_populated_set(const code& ec,
+    transaction_const_ptr_list_const_ptr txs, result_list_ptr results,
+    result_handler handler) const
+{
+    if (stopped())
+    {
+        handler(error::service_stopped);
+        return;
+    }
+
+    if (ec)
+    {
+        handler(ec);
+        return;
+    }
+
+    for (size_t position = 0; position < txs->size(); ++position)
+    {
+        auto& result = (*results)[position];
+        const auto& tx = (*txs)[position];
+
+        if (result)
+            continue;
+
+        BITCOIN_ASSERT(tx->metadata.state);
+
+        // The tx is already confirmed or verified for the pool.
+        if (tx->metadata.confirmed || tx->metadata.verified)
+            result = error::duplicate_transaction;
+        else
+            result = tx->accept();
+    }
+
+    handler(error::success);
+}
+
+void validate_transaction::connect(transaction_const_ptr_list_const_ptr txs,
+    result_list_ptr results, result_handler handler) const
+{
+    BITCOIN_ASSERT(results->size() == txs->size());
+    const auto inputs = std::make_shared<input_list>();
+
+    for (size_t position = 0; position < txs->size(); ++position)
+    {
+        if ((*results)[position])
+            continue;
+
+        const auto& tx = *(*txs)[position];
+        const auto count = tx.inputs().size();
+        validate_input::prepare(tx);
+
+        for (uint32_t index = 0; index < count; ++index)
+            inputs->emplace_back(position, index);
+    }
+
+    if (inputs->empty())
+    {
+        handler(error::success);
+        return;
+    }
+
+    // Each bucket records failures in its own result list, merged on join.
+    const auto buckets = std::min(dispatch_.size(), inputs->size());
+    const auto partials = std::make_shared<std::vector<result_list>>(buckets,
+        result_list(txs->size()));
+
+    const result_handler complete =
+        std::bind(&validate_transaction::handle_connected_set,
+            this, _1, partials, results, handler);
+
+    const auto join_handler = synchronize(complete, buckets,
+        NAME "_validate_set");
+
+    // If the priority threadpool is shut down when this is called the handler
+    // will never be invoked, resulting in a threadpool.join indefinite hang.
+    for (size_t bucket = 0; bucket < buckets; ++bucket)
+        dispatch_.concurrent(&validate_transaction::connect_set_inputs,
+            this, txs, inputs, partials, bucket, buckets, join_handler);
+}
+
+void validate_transaction::connect_set_inputs(
+    transaction_const_ptr_list_const_ptr txs, input_list_const_ptr inputs,
+    bucket_results_ptr partials, size_t bucket, size_t buckets,
+    result_handler handler) const
+{
+    BITCOIN_ASSERT(bucket < buckets);
+    auto& results = (*partials)[bucket];
+
+    for (auto index = bucket; index < inputs->size();
+        index = ceiling_add(index, buckets))
+    {
+        if (stopped())
+        {
+            handler(error::service_stopped);
+            return;
+        }
+
+        const auto& input = (*inputs)[index];
+        auto& result = results[input.first];
+
+        // This bucket has already failed the tx.
+        if (result)
+            continue;
+
+        const auto& tx = *(*txs)[input.first];
+        BITCOIN_ASSERT(tx.metadata.state);
+        const auto forks = tx.metadata.state->enabled_forks();
+        const auto& prevout = tx.inputs()[input.second].previous_output();
+
+        if (!prevout.metadata.cache.is_valid())
+        {
+            result = error::missing_previous_output;
+            continue;
+        }
+
+        // Successful verifications are cached for validation of the block.
+        result = validate_input::verify_script(tx, input.second, forks,
+            use_libconsensus_, script_cache_, true, differential_);
+    }
+
+    handler(error::success);
+}
+
+void validate_transaction::handle_connected_set(const code& ec,
+    bucket_results_ptr partials, result_list_ptr results,
+    result_handler handler) const
+{
+    // Buckets may still be running, so partial results are not read.
+    if (ec)
+    {
+        handler(ec);
+        return;
+    }
+
+    for (const auto& partial: *partials)
+        for (size_t position = 0; position < partial.size(); ++position)
+            if (partial[position] && !(*results)[position])
+                (*results)[position] = partial[position];
+
+    handler(error::success);
+}
+
 } // namespace blockchain
 } // namespace libbitcoin
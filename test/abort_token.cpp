@@ -0,0 +1,49 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <bitcoin/blockchain.hpp>
+
+using namespace bc;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(abort_token_tests)
+
+BOOST_AUTO_TEST_CASE(abort_token__construct__always__not_tripped)
+{
+    abort_token instance;
+    BOOST_REQUIRE(!instance.tripped());
+}
+
+BOOST_AUTO_TEST_CASE(abort_token__trip__once__tripped)
+{
+    abort_token instance;
+    instance.trip();
+    BOOST_REQUIRE(instance.tripped());
+}
+
+BOOST_AUTO_TEST_CASE(abort_token__trip__twice__tripped)
+{
+    abort_token instance;
+    instance.trip();
+    instance.trip();
+    BOOST_REQUIRE(instance.tripped());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
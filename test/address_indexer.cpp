@@ -0,0 +1,153 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <bitcoin/blockchain.hpp>
+#include "utility.hpp"
+
+using namespace bc;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(address_indexer_tests)
+
+static boost::filesystem::path make_file(size_t height, bool persisted)
+{
+    const boost::filesystem::path file(TEST_NAME + ".height");
+    boost::filesystem::remove(file);
+
+    if (persisted)
+    {
+        boost::filesystem::ofstream out(file);
+        out << height << std::endl;
+    }
+
+    return file;
+}
+
+static size_t read_file(const boost::filesystem::path& file)
+{
+    boost::filesystem::ifstream in(file);
+    size_t height = 0;
+    in >> height;
+    return height;
+}
+
+static bool ignore_transactions(const transaction_const_ptr_list&)
+{
+    return true;
+}
+
+static block_const_ptr fetch_none(size_t)
+{
+    return nullptr;
+}
+
+BOOST_AUTO_TEST_CASE(address_indexer__push__stopped__false)
+{
+    address_indexer instance(make_file(0, false), 0,
+        [](const block_const_ptr_list&) { return true; },
+        ignore_transactions, fetch_none);
+
+    BOOST_REQUIRE(!instance.push(std::make_shared<const message::block>(), 1));
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(address_indexer__start__not_persisted__presumed_top)
+{
+    const auto file = make_file(0, false);
+    address_indexer instance(file, 0,
+        [](const block_const_ptr_list&) { return true; },
+        ignore_transactions, fetch_none);
+
+    instance.start(42);
+    BOOST_REQUIRE_EQUAL(instance.height(), 42u);
+    BOOST_REQUIRE_EQUAL(read_file(file), 42u);
+    instance.stop();
+}
+
+BOOST_AUTO_TEST_CASE(address_indexer__start__persisted_below_top__caught_up)
+{
+    std::promise<size_t> indexed;
+    const auto file = make_file(40, true);
+    address_indexer instance(file, 0,
+        [&](const block_const_ptr_list& blocks)
+        {
+            indexed.set_value(blocks.size());
+            return true;
+        },
+        ignore_transactions,
+        [](size_t height)
+        {
+            return height <= 42 ? std::make_shared<const message::block>() :
+                nullptr;
+        });
+
+    instance.start(45);
+    BOOST_REQUIRE_EQUAL(indexed.get_future().get(), 2u);
+    instance.stop();
+    BOOST_REQUIRE_EQUAL(instance.height(), 42u);
+    BOOST_REQUIRE_EQUAL(read_file(file), 42u);
+}
+
+BOOST_AUTO_TEST_CASE(address_indexer__push__started__indexed_and_persisted)
+{
+    std::promise<void> indexed;
+    const auto file = make_file(10, true);
+    address_indexer instance(file, 0,
+        [&](const block_const_ptr_list&)
+        {
+            indexed.set_value();
+            return true;
+        },
+        ignore_transactions, fetch_none);
+
+    instance.start(10);
+    BOOST_REQUIRE(instance.push(std::make_shared<const message::block>(), 11));
+    indexed.get_future().wait();
+    instance.stop();
+    BOOST_REQUIRE_EQUAL(instance.height(), 11u);
+    BOOST_REQUIRE_EQUAL(read_file(file), 11u);
+}
+
+BOOST_AUTO_TEST_CASE(address_indexer__push__index_failure__stopped)
+{
+    std::promise<void> failed;
+    const auto file = make_file(10, true);
+    address_indexer instance(file, 0,
+        [&](const block_const_ptr_list&)
+        {
+            failed.set_value();
+            return false;
+        },
+        ignore_transactions, fetch_none);
+
+    instance.start(10);
+    BOOST_REQUIRE(instance.push(std::make_shared<const message::block>(), 11));
+    failed.get_future().wait();
+    instance.stop();
+    BOOST_REQUIRE(!instance.push(std::make_shared<const message::block>(), 12));
+    BOOST_REQUIRE_EQUAL(read_file(file), 10u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
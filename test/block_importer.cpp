@@ -0,0 +1,118 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <bitcoin/blockchain.hpp>
+#include "utility.hpp"
+
+using namespace bc;
+using namespace bc::chain;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(block_importer_tests)
+
+static const uint32_t identifier = 0xd9b4bef9;
+
+static boost::filesystem::path make_file(const data_chunk& data)
+{
+    const boost::filesystem::path file(TEST_NAME + ".dat");
+    boost::filesystem::ofstream stream(file, std::ios::binary);
+    stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+    return file;
+}
+
+static data_chunk make_record(const block& block)
+{
+    const auto data = block.to_data();
+    return build_chunk(
+    {
+        to_little_endian(identifier),
+        to_little_endian(static_cast<uint32_t>(data.size())),
+        data
+    });
+}
+
+static size_t read_count(const boost::filesystem::path& file, bool& result)
+{
+    size_t count = 0;
+    result = block_importer::read(file, identifier, [&](block_const_ptr)
+    {
+        ++count;
+        return true;
+    });
+
+    return count;
+}
+
+BOOST_AUTO_TEST_CASE(block_importer__read__missing__false_none)
+{
+    bool result;
+    const boost::filesystem::path file(TEST_NAME + ".dat");
+    boost::filesystem::remove(file);
+    BOOST_REQUIRE_EQUAL(read_count(file, result), 0u);
+    BOOST_REQUIRE(!result);
+}
+
+BOOST_AUTO_TEST_CASE(block_importer__read__raw_blocks__true_all)
+{
+    bool result;
+    const auto genesis = block::genesis_mainnet().to_data();
+    const auto file = make_file(build_chunk({ genesis, genesis }));
+    BOOST_REQUIRE_EQUAL(read_count(file, result), 2u);
+    BOOST_REQUIRE(result);
+}
+
+BOOST_AUTO_TEST_CASE(block_importer__read__records_with_padding__true_all)
+{
+    bool result;
+    const auto record = make_record(block::genesis_mainnet());
+    const auto file = make_file(build_chunk({ record, record,
+        data_chunk(16, 0x00) }));
+    BOOST_REQUIRE_EQUAL(read_count(file, result), 2u);
+    BOOST_REQUIRE(result);
+}
+
+BOOST_AUTO_TEST_CASE(block_importer__read__truncated_record__false)
+{
+    bool result;
+    auto record = make_record(block::genesis_mainnet());
+    record.resize(record.size() - 1);
+    const auto file = make_file(record);
+    BOOST_REQUIRE_EQUAL(read_count(file, result), 0u);
+    BOOST_REQUIRE(!result);
+}
+
+BOOST_AUTO_TEST_CASE(block_importer__read__handler_false__false)
+{
+    const auto record = make_record(block::genesis_mainnet());
+    const auto file = make_file(build_chunk({ record, record }));
+
+    size_t count = 0;
+    BOOST_REQUIRE(!block_importer::read(file, identifier, [&](block_const_ptr)
+    {
+        return ++count > 1;
+    }));
+
+    BOOST_REQUIRE_EQUAL(count, 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,118 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <bitcoin/blockchain.hpp>
+#include "utility.hpp"
+
+using namespace bc;
+using namespace bc::chain;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(candidate_cache_tests)
+
+static chain_state::data data(size_t height)
+{
+    chain_state::data value;
+    value.height = height;
+    value.bits = { 0, { 0 } };
+    value.version = { 1, { 0 } };
+    value.timestamp = { 0, 0, { 0 } };
+    return value;
+}
+
+static block_const_ptr make_block(block_const_ptr block, size_t height)
+{
+    block->header().metadata.state = std::make_shared<chain_state>(
+        chain_state{ data(height), {}, 0, 0, bc::settings() });
+    return block;
+}
+
+BOOST_AUTO_TEST_CASE(candidate_cache__construct__zero__disabled)
+{
+    candidate_cache instance(0);
+    BOOST_REQUIRE(instance.disabled());
+}
+
+BOOST_AUTO_TEST_CASE(candidate_cache__add__disabled__empty)
+{
+    candidate_cache instance(0);
+    instance.add(make_block(NEW_BLOCK(1), 1));
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(candidate_cache__get__added__expected)
+{
+    candidate_cache instance(1);
+    const auto block = make_block(NEW_BLOCK(1), 1);
+    instance.add(block);
+    BOOST_REQUIRE_EQUAL(instance.size(), 1u);
+    BOOST_REQUIRE(instance.get(1, block->hash()) == block);
+}
+
+BOOST_AUTO_TEST_CASE(candidate_cache__get__other_hash__null)
+{
+    candidate_cache instance(1);
+    instance.add(make_block(NEW_BLOCK(1), 1));
+    BOOST_REQUIRE(!instance.get(1, null_hash));
+}
+
+BOOST_AUTO_TEST_CASE(candidate_cache__get__other_height__null)
+{
+    candidate_cache instance(1);
+    const auto block = make_block(NEW_BLOCK(1), 1);
+    instance.add(block);
+    BOOST_REQUIRE(!instance.get(2, block->hash()));
+}
+
+BOOST_AUTO_TEST_CASE(candidate_cache__add__same_height__replaced)
+{
+    candidate_cache instance(1);
+    const auto block1 = make_block(NEW_BLOCK(1), 1);
+    const auto block2 = make_block(NEW_BLOCK(2), 1);
+    instance.add(block1);
+    instance.add(block2);
+    BOOST_REQUIRE_EQUAL(instance.size(), 1u);
+    BOOST_REQUIRE(!instance.get(1, block1->hash()));
+    BOOST_REQUIRE(instance.get(1, block2->hash()) == block2);
+}
+
+BOOST_AUTO_TEST_CASE(candidate_cache__prune__height__lower_removed)
+{
+    candidate_cache instance(1);
+    const auto block1 = make_block(NEW_BLOCK(1), 1);
+    const auto block2 = make_block(NEW_BLOCK(2), 2);
+    const auto block3 = make_block(NEW_BLOCK(3), 3);
+    instance.add(block1);
+    instance.add(block2);
+    instance.add(block3);
+    instance.prune(2);
+    BOOST_REQUIRE_EQUAL(instance.size(), 1u);
+    BOOST_REQUIRE(instance.get(3, block3->hash()) == block3);
+}
+
+BOOST_AUTO_TEST_CASE(candidate_cache__clear__added__empty)
+{
+    candidate_cache instance(1);
+    instance.add(make_block(NEW_BLOCK(1), 1));
+    instance.clear();
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
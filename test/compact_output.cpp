@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <bitcoin/blockchain.hpp>
+#include "utility.hpp"
+
+using namespace bc;
+using namespace bc::chain;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(compact_output_tests)
+
+static output make_output(const data_chunk& script)
+{
+    return { 42, chain::script(script, false) };
+}
+
+static void require_round_trip(const data_chunk& script, bool templated)
+{
+    const auto expected = make_output(script);
+    const compact_output instance(expected);
+    BOOST_REQUIRE_EQUAL(instance.templated(), templated);
+    BOOST_REQUIRE_EQUAL(instance.value(), 42u);
+    BOOST_REQUIRE(instance.to_output() == expected);
+}
+
+BOOST_AUTO_TEST_CASE(compact_output__construct__default__invalid)
+{
+    const compact_output instance;
+    BOOST_REQUIRE(!instance.templated());
+    BOOST_REQUIRE(!instance.to_output().is_valid());
+}
+
+BOOST_AUTO_TEST_CASE(compact_output__to_output__pay_key_hash__templated_round_trip)
+{
+    require_round_trip(base16_literal(
+        "76a91418ab2d2a9c2a7f3e8a6b0c2d4e6f8091a2b3c4d588ac"), true);
+}
+
+BOOST_AUTO_TEST_CASE(compact_output__to_output__pay_script_hash__templated_round_trip)
+{
+    require_round_trip(base16_literal(
+        "a91418ab2d2a9c2a7f3e8a6b0c2d4e6f8091a2b3c4d587"), true);
+}
+
+BOOST_AUTO_TEST_CASE(compact_output__to_output__witness_key_hash__templated_round_trip)
+{
+    require_round_trip(base16_literal(
+        "001418ab2d2a9c2a7f3e8a6b0c2d4e6f8091a2b3c4d5"), true);
+}
+
+BOOST_AUTO_TEST_CASE(compact_output__to_output__witness_script_hash__templated_round_trip)
+{
+    require_round_trip(base16_literal(
+        "002018ab2d2a9c2a7f3e8a6b0c2d4e6f8091a2b3c4d5e6f708192a3b4c5d6e7f8091"),
+        true);
+}
+
+BOOST_AUTO_TEST_CASE(compact_output__to_output__nonstandard__raw_round_trip)
+{
+    require_round_trip(base16_literal("6a0401020304"), false);
+}
+
+BOOST_AUTO_TEST_CASE(compact_output__size__templated__no_script_allocation)
+{
+    const compact_output instance(make_output(base16_literal(
+        "76a91418ab2d2a9c2a7f3e8a6b0c2d4e6f8091a2b3c4d588ac")));
+    BOOST_REQUIRE_EQUAL(instance.size(), sizeof(compact_output));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <vector>
+#include <bitcoin/blockchain.hpp>
+
+using namespace bc;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(download_bitmap_tests)
+
+BOOST_AUTO_TEST_CASE(download_bitmap__construct__always__empty_at_genesis)
+{
+    download_bitmap instance;
+    BOOST_REQUIRE_EQUAL(instance.base(), 0u);
+    BOOST_REQUIRE_EQUAL(instance.top(), 0u);
+    BOOST_REQUIRE(!instance.get(1));
+}
+
+BOOST_AUTO_TEST_CASE(download_bitmap__push__mixed__expected)
+{
+    download_bitmap instance;
+    instance.reset(10);
+    instance.push(true);
+    instance.push(false);
+    instance.push(true);
+    BOOST_REQUIRE_EQUAL(instance.top(), 13u);
+    BOOST_REQUIRE(!instance.get(10));
+    BOOST_REQUIRE(instance.get(11));
+    BOOST_REQUIRE(!instance.get(12));
+    BOOST_REQUIRE(instance.get(13));
+    BOOST_REQUIRE(!instance.get(14));
+}
+
+BOOST_AUTO_TEST_CASE(download_bitmap__clear__downloadable__not_downloadable)
+{
+    download_bitmap instance;
+    instance.push(true);
+    instance.clear(1);
+    BOOST_REQUIRE(!instance.get(1));
+}
+
+BOOST_AUTO_TEST_CASE(download_bitmap__pop__partial_word__cleared_above)
+{
+    download_bitmap instance;
+    instance.push(true);
+    instance.push(true);
+    instance.push(true);
+    instance.pop(1);
+    BOOST_REQUIRE_EQUAL(instance.top(), 1u);
+
+    // The popped heights are not downloadable once pushed again as such.
+    instance.push(false);
+    instance.push(false);
+    BOOST_REQUIRE(instance.get(1));
+    BOOST_REQUIRE(!instance.get(2));
+    BOOST_REQUIRE(!instance.get(3));
+}
+
+BOOST_AUTO_TEST_CASE(download_bitmap__pop__below_base__reset)
+{
+    download_bitmap instance;
+    instance.reset(10);
+    instance.push(true);
+    instance.pop(5);
+    BOOST_REQUIRE_EQUAL(instance.base(), 5u);
+    BOOST_REQUIRE_EQUAL(instance.top(), 5u);
+}
+
+BOOST_AUTO_TEST_CASE(download_bitmap__get_range__sparse__expected_heights)
+{
+    download_bitmap instance;
+
+    // Downloadable at heights 1, 70 and 200 (spanning words).
+    for (size_t height = 1; height <= 200; ++height)
+        instance.push(height == 1 || height == 70 || height == 200);
+
+    std::vector<size_t> heights;
+    instance.get(heights, 0, 10);
+    BOOST_REQUIRE_EQUAL(heights.size(), 3u);
+    BOOST_REQUIRE_EQUAL(heights[0], 1u);
+    BOOST_REQUIRE_EQUAL(heights[1], 70u);
+    BOOST_REQUIRE_EQUAL(heights[2], 200u);
+
+    instance.get(heights, 2, 1);
+    BOOST_REQUIRE_EQUAL(heights.size(), 1u);
+    BOOST_REQUIRE_EQUAL(heights[0], 70u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,98 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <bitcoin/blockchain.hpp>
+#include "utility.hpp"
+
+using namespace bc;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(download_cache_tests)
+
+BOOST_AUTO_TEST_CASE(download_cache__construct__always__empty)
+{
+    download_cache instance(2);
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(download_cache__capacity__always__expected)
+{
+    download_cache instance(42);
+    BOOST_REQUIRE_EQUAL(instance.capacity(), 42u);
+}
+
+BOOST_AUTO_TEST_CASE(download_cache__exists__added__true)
+{
+    download_cache instance(2);
+    const auto block = NEW_BLOCK(1);
+    instance.add(block);
+    BOOST_REQUIRE(instance.exists(block->hash()));
+    BOOST_REQUIRE(!instance.exists(null_hash));
+}
+
+BOOST_AUTO_TEST_CASE(download_cache__add__disabled__empty)
+{
+    download_cache instance(0);
+    instance.add(NEW_BLOCK(1));
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(download_cache__take__added__expected_and_removed)
+{
+    download_cache instance(2);
+    const auto block = NEW_BLOCK(1);
+    instance.add(block);
+    BOOST_REQUIRE(instance.take(block->hash()) == block);
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+    BOOST_REQUIRE(!instance.take(block->hash()));
+}
+
+BOOST_AUTO_TEST_CASE(download_cache__take__missing__null)
+{
+    download_cache instance(2);
+    instance.add(NEW_BLOCK(1));
+    BOOST_REQUIRE(!instance.take(null_hash));
+    BOOST_REQUIRE_EQUAL(instance.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(download_cache__add__over_capacity__oldest_evicted)
+{
+    download_cache instance(2);
+    const auto block1 = NEW_BLOCK(1);
+    const auto block2 = NEW_BLOCK(2);
+    const auto block3 = NEW_BLOCK(3);
+    instance.add(block1);
+    instance.add(block2);
+    instance.add(block3);
+    BOOST_REQUIRE_EQUAL(instance.size(), 2u);
+    BOOST_REQUIRE(!instance.take(block1->hash()));
+    BOOST_REQUIRE(instance.take(block2->hash()) == block2);
+    BOOST_REQUIRE(instance.take(block3->hash()) == block3);
+}
+
+BOOST_AUTO_TEST_CASE(download_cache__clear__added__empty)
+{
+    download_cache instance(2);
+    instance.add(NEW_BLOCK(1));
+    instance.clear();
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
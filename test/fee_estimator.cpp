@@ -0,0 +1,177 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <bitcoin/blockchain.hpp>
+
+using namespace bc;
+using namespace bc::chain;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(fee_estimator_tests)
+
+static const auto funding_hash = hash_literal(
+    "4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b");
+
+// The fee is the value of the single spent prevout (there are no outputs).
+static transaction_const_ptr make_tx(uint32_t index, uint64_t fee)
+{
+    input in;
+    output_point point{ funding_hash, index };
+    point.metadata.cache.set_value(fee);
+    in.set_previous_output(point);
+    return std::make_shared<const message::transaction>(
+        transaction{ 1, 0, { in }, {} });
+}
+
+static block_const_ptr make_block(const transaction_const_ptr_list& txs)
+{
+    transaction::list list;
+
+    for (const auto& tx: txs)
+        list.push_back(*tx);
+
+    return std::make_shared<const message::block>(header{}, std::move(list));
+}
+
+static transaction_const_ptr_list make_txs(size_t count, uint64_t fee,
+    uint32_t first_index=0)
+{
+    transaction_const_ptr_list txs;
+
+    for (uint32_t index = 0; index < count; ++index)
+        txs.push_back(make_tx(first_index + index, fee));
+
+    return txs;
+}
+
+BOOST_AUTO_TEST_CASE(fee_estimator__bucket__at_or_below_minimum__zero)
+{
+    BOOST_REQUIRE_EQUAL(fee_estimator::bucket(0), 0u);
+    BOOST_REQUIRE_EQUAL(fee_estimator::bucket(fee_estimator::minimum_rate),
+        0u);
+}
+
+BOOST_AUTO_TEST_CASE(fee_estimator__bucket__lower_bound__round_trips)
+{
+    for (size_t bucket = 0; bucket < fee_estimator::buckets; ++bucket)
+        BOOST_REQUIRE_EQUAL(fee_estimator::bucket(
+            fee_estimator::lower_bound(bucket) + 1u), bucket);
+}
+
+BOOST_AUTO_TEST_CASE(fee_estimator__bucket__maximum_rate__last)
+{
+    BOOST_REQUIRE_EQUAL(fee_estimator::bucket(max_uint64),
+        fee_estimator::buckets - 1u);
+}
+
+BOOST_AUTO_TEST_CASE(fee_estimator__rate__fee_and_size__per_kilobyte)
+{
+    const auto tx = make_tx(0, 1000);
+    const auto size = tx->serialized_size(true);
+    BOOST_REQUIRE_EQUAL(fee_estimator::rate(*tx), 1000u * 1000u / size);
+}
+
+BOOST_AUTO_TEST_CASE(fee_estimator__estimate__empty__zero)
+{
+    fee_estimator instance;
+    BOOST_REQUIRE_EQUAL(instance.estimate(1), 0u);
+    BOOST_REQUIRE_EQUAL(instance.estimate(fee_estimator::maximum_target), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(fee_estimator__confirm__next_block__estimated_for_all_targets)
+{
+    fee_estimator instance;
+    const auto txs = make_txs(4, 10000);
+    const auto height = 100u;
+
+    for (const auto& tx: txs)
+        instance.add(tx, height);
+
+    BOOST_REQUIRE_EQUAL(instance.size(), 4u);
+    instance.confirm(make_block(txs), height);
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+
+    const auto expected = fee_estimator::lower_bound(
+        fee_estimator::bucket(fee_estimator::rate(*txs.front())));
+
+    BOOST_REQUIRE_EQUAL(instance.estimate(0), expected);
+    BOOST_REQUIRE_EQUAL(instance.estimate(1), expected);
+    BOOST_REQUIRE_EQUAL(instance.estimate(fee_estimator::maximum_target),
+        expected);
+}
+
+BOOST_AUTO_TEST_CASE(fee_estimator__confirm__delayed__not_estimated_for_short_target)
+{
+    fee_estimator instance;
+    const auto txs = make_txs(4, 10000);
+    const auto height = 100u;
+
+    for (const auto& tx: txs)
+        instance.add(tx, height);
+
+    // Two blocks pass without the txs, which confirm in the third.
+    instance.confirm(make_block({}), height);
+    instance.confirm(make_block({}), height + 1u);
+    instance.confirm(make_block(txs), height + 2u);
+
+    BOOST_REQUIRE_EQUAL(instance.estimate(1), 0u);
+    BOOST_REQUIRE_EQUAL(instance.estimate(2), 0u);
+    BOOST_REQUIRE_NE(instance.estimate(3), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(fee_estimator__confirm__unconfirmed_beyond_maximum__untracked)
+{
+    fee_estimator instance;
+    const auto height = 100u;
+
+    for (const auto& tx: make_txs(4, 10000))
+        instance.add(tx, height);
+
+    for (size_t block = 0; block < fee_estimator::maximum_target; ++block)
+        instance.confirm(make_block({}), height + block);
+
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+    BOOST_REQUIRE_EQUAL(instance.estimate(fee_estimator::maximum_target), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(fee_estimator__confirm__low_rate_unconfirmed__high_rate_estimated)
+{
+    fee_estimator instance;
+    const auto height = 100u;
+    const auto high = make_txs(4, 100000);
+    const auto low = make_txs(4, 1000, 4);
+
+    for (const auto& tx: high)
+        instance.add(tx, height);
+
+    for (const auto& tx: low)
+        instance.add(tx, height);
+
+    instance.confirm(make_block(high), height);
+
+    const auto expected = fee_estimator::lower_bound(
+        fee_estimator::bucket(fee_estimator::rate(*high.front())));
+
+    BOOST_REQUIRE_EQUAL(instance.estimate(1), expected);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,225 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <boost/filesystem.hpp>
+#include <bitcoin/blockchain.hpp>
+#include "utility.hpp"
+
+using namespace bc;
+using namespace bc::blockchain;
+using namespace bc::chain;
+
+BOOST_AUTO_TEST_SUITE(filter_index_tests)
+
+// BIP158 test vector, testnet block 0.
+static const auto genesis_filter = "019dfca8";
+static const auto genesis_header =
+    "21584579b7eb08997773e5aeff3a7f932700042d0ed2a6129012b7d7ae81b750";
+
+static boost::filesystem::path make_file()
+{
+    const boost::filesystem::path file(TEST_NAME + ".filters");
+    boost::filesystem::remove(file);
+    return file;
+}
+
+static block make_spending_block(const output_point& prevout)
+{
+    auto value = block::genesis_testnet();
+    auto txs = value.transactions();
+    transaction tx;
+    tx.set_inputs({ input{ output_point{ prevout }, {}, 0 } });
+    tx.set_outputs({ output{ 1, script{ data_chunk{ 0x51 }, false } } });
+    txs.push_back(tx);
+    value.set_transactions(txs);
+    return value;
+}
+
+BOOST_AUTO_TEST_CASE(filter_index__compute__genesis_testnet__expected)
+{
+    data_chunk filter;
+    BOOST_REQUIRE(filter_index::compute(filter, block::genesis_testnet()));
+    BOOST_REQUIRE_EQUAL(encode_base16(filter), genesis_filter);
+    BOOST_REQUIRE_EQUAL(encode_hash(filter_index::to_header(filter,
+        null_hash)), genesis_header);
+}
+
+BOOST_AUTO_TEST_CASE(filter_index__compute__unpopulated_prevout__false)
+{
+    data_chunk filter;
+    const auto value = make_spending_block({ null_hash, 0 });
+    BOOST_REQUIRE(!filter_index::compute(filter, value));
+}
+
+BOOST_AUTO_TEST_CASE(filter_index__compute__populated_prevout__matched)
+{
+    const data_chunk prevout_script{ 0x52 };
+    output_point prevout{ null_hash, 0 };
+    prevout.metadata.cache = output{ 1, script{ prevout_script, false } };
+    const auto value = make_spending_block(prevout);
+
+    data_chunk filter;
+    BOOST_REQUIRE(filter_index::compute(filter, value));
+    BOOST_REQUIRE(filter_index::match(filter, value.hash(), prevout_script));
+    BOOST_REQUIRE(filter_index::match(filter, value.hash(), { 0x51 }));
+}
+
+BOOST_AUTO_TEST_CASE(filter_index__match__genesis_output_script__true)
+{
+    const auto genesis = block::genesis_testnet();
+    const auto& output = genesis.transactions().front().outputs().front();
+
+    data_chunk filter;
+    BOOST_REQUIRE(filter_index::compute(filter, genesis));
+    BOOST_REQUIRE(filter_index::match(filter, genesis.hash(),
+        output.script().to_data(false)));
+}
+
+BOOST_AUTO_TEST_CASE(filter_index__match__absent_item__false)
+{
+    const auto genesis = block::genesis_testnet();
+
+    data_chunk filter;
+    BOOST_REQUIRE(filter_index::compute(filter, genesis));
+    BOOST_REQUIRE(!filter_index::match(filter, genesis.hash(), { 0x51 }));
+}
+
+BOOST_AUTO_TEST_CASE(filter_index__match__empty_filter__false)
+{
+    BOOST_REQUIRE(!filter_index::match({ 0x00 }, null_hash, { 0x51 }));
+}
+
+BOOST_AUTO_TEST_CASE(filter_index__push__not_contiguous__false)
+{
+    filter_index instance(make_file());
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE(!instance.push(block::genesis_testnet(), 1));
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(filter_index__get_filter__pushed__expected)
+{
+    const auto genesis = block::genesis_testnet();
+    filter_index instance(make_file());
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE(instance.push(genesis, 0));
+
+    data_chunk filter;
+    hash_digest hash;
+    BOOST_REQUIRE(instance.get_filter(filter, hash, 0));
+    BOOST_REQUIRE_EQUAL(encode_base16(filter), genesis_filter);
+    BOOST_REQUIRE(hash == genesis.hash());
+    BOOST_REQUIRE(!instance.get_filter(filter, hash, 1));
+}
+
+BOOST_AUTO_TEST_CASE(filter_index__get_headers__chained__expected)
+{
+    const auto genesis = block::genesis_testnet();
+    filter_index instance(make_file());
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE(instance.push(genesis, 0));
+    BOOST_REQUIRE(instance.push(genesis, 1));
+
+    data_chunk filter;
+    BOOST_REQUIRE(filter_index::compute(filter, genesis));
+    const auto first = filter_index::to_header(filter, null_hash);
+
+    hash_list headers;
+    hash_digest stop_hash;
+    BOOST_REQUIRE(instance.get_headers(headers, stop_hash, 0, 10));
+    BOOST_REQUIRE_EQUAL(headers.size(), 2u);
+    BOOST_REQUIRE_EQUAL(encode_hash(headers[0]), genesis_header);
+    BOOST_REQUIRE(headers[1] == filter_index::to_header(filter, first));
+    BOOST_REQUIRE(stop_hash == genesis.hash());
+    BOOST_REQUIRE(!instance.get_headers(headers, stop_hash, 2, 1));
+}
+
+BOOST_AUTO_TEST_CASE(filter_index__pop__above_height__truncated)
+{
+    const auto genesis = block::genesis_testnet();
+    filter_index instance(make_file());
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE(instance.push(genesis, 0));
+    BOOST_REQUIRE(instance.push(genesis, 1));
+    BOOST_REQUIRE(instance.push(genesis, 2));
+    BOOST_REQUIRE(instance.pop(0));
+    BOOST_REQUIRE_EQUAL(instance.size(), 1u);
+    BOOST_REQUIRE(instance.push(genesis, 1));
+    BOOST_REQUIRE_EQUAL(instance.size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(filter_index__push__existing_height__replaced)
+{
+    const auto genesis = block::genesis_testnet();
+    filter_index instance(make_file());
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE(instance.push(genesis, 0));
+    BOOST_REQUIRE(instance.push(genesis, 1));
+    BOOST_REQUIRE(instance.push(genesis, 2));
+    BOOST_REQUIRE(instance.push(genesis, 1));
+    BOOST_REQUIRE_EQUAL(instance.size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(filter_index__start__restarted__reloaded)
+{
+    const auto file = make_file();
+    const auto genesis = block::genesis_testnet();
+
+    {
+        filter_index instance(file);
+        BOOST_REQUIRE(instance.start());
+        BOOST_REQUIRE(instance.push(genesis, 0));
+        BOOST_REQUIRE(instance.push(genesis, 1));
+        instance.stop();
+    }
+
+    filter_index instance(file);
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE_EQUAL(instance.size(), 2u);
+
+    data_chunk filter;
+    hash_digest hash;
+    BOOST_REQUIRE(instance.get_filter(filter, hash, 1));
+    BOOST_REQUIRE_EQUAL(encode_base16(filter), genesis_filter);
+}
+
+BOOST_AUTO_TEST_CASE(filter_index__start__partial_record__discarded)
+{
+    const auto file = make_file();
+    const auto genesis = block::genesis_testnet();
+
+    {
+        filter_index instance(file);
+        BOOST_REQUIRE(instance.start());
+        BOOST_REQUIRE(instance.push(genesis, 0));
+        BOOST_REQUIRE(instance.push(genesis, 1));
+        instance.stop();
+    }
+
+    const auto size = boost::filesystem::file_size(file);
+    boost::filesystem::resize_file(file, size - 1u);
+
+    filter_index instance(file);
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE_EQUAL(instance.size(), 1u);
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size(file), size / 2u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
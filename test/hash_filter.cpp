@@ -0,0 +1,71 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <bitcoin/blockchain.hpp>
+
+using namespace bc;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(hash_filter_tests)
+
+static const auto hash1 = hash_literal(
+    "4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b");
+static const auto hash2 = hash_literal(
+    "000000000019d6689c085ae165831e934ff763ae46a2a6c172b3f1b60a8ce26f");
+
+BOOST_AUTO_TEST_CASE(hash_filter__construct__zero__disabled_contains)
+{
+    hash_filter instance(0);
+    BOOST_REQUIRE(instance.disabled());
+    BOOST_REQUIRE(!instance.complete());
+    BOOST_REQUIRE(instance.contains(hash1));
+}
+
+BOOST_AUTO_TEST_CASE(hash_filter__construct__nonzero__incomplete_empty)
+{
+    hash_filter instance(1);
+    BOOST_REQUIRE(!instance.disabled());
+    BOOST_REQUIRE(!instance.complete());
+    BOOST_REQUIRE(!instance.contains(hash1));
+}
+
+BOOST_AUTO_TEST_CASE(hash_filter__set_complete__enabled__complete)
+{
+    hash_filter instance(1);
+    instance.set_complete();
+    BOOST_REQUIRE(instance.complete());
+}
+
+BOOST_AUTO_TEST_CASE(hash_filter__set_complete__disabled__incomplete)
+{
+    hash_filter instance(0);
+    instance.set_complete();
+    BOOST_REQUIRE(!instance.complete());
+}
+
+BOOST_AUTO_TEST_CASE(hash_filter__contains__inserted__true)
+{
+    hash_filter instance(1);
+    instance.insert(hash1);
+    BOOST_REQUIRE(instance.contains(hash1));
+    BOOST_REQUIRE(!instance.contains(hash2));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
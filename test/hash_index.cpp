@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <bitcoin/blockchain.hpp>
+
+using namespace bc;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(hash_index_tests)
+
+static hash_digest make_hash(size_t value)
+{
+    auto hash = null_hash;
+    hash[0] = static_cast<uint8_t>(value);
+    hash[1] = static_cast<uint8_t>(value >> 8);
+    hash[2] = static_cast<uint8_t>(value >> 16);
+    return hash;
+}
+
+static hash_list make_hashes(size_t first, size_t count)
+{
+    hash_list hashes;
+    for (auto value = first; value < first + count; ++value)
+        hashes.push_back(make_hash(value));
+
+    return hashes;
+}
+
+BOOST_AUTO_TEST_CASE(hash_index__construct__always__empty)
+{
+    hash_index instance;
+    const auto snapshot = instance.get();
+    hash_digest hash;
+    BOOST_REQUIRE_EQUAL(snapshot->version(), 0u);
+    BOOST_REQUIRE_EQUAL(snapshot->size(), 0u);
+    BOOST_REQUIRE(!snapshot->get(hash, 0));
+}
+
+BOOST_AUTO_TEST_CASE(hash_index__update__multiple_chunks__expected)
+{
+    hash_index instance;
+    instance.update(0, make_hashes(0, 3000));
+    const auto snapshot = instance.get();
+    BOOST_REQUIRE_EQUAL(snapshot->version(), 1u);
+    BOOST_REQUIRE_EQUAL(snapshot->size(), 3000u);
+
+    hash_digest hash;
+    BOOST_REQUIRE(snapshot->get(hash, 0));
+    BOOST_REQUIRE(hash == make_hash(0));
+    BOOST_REQUIRE(snapshot->get(hash, 1024));
+    BOOST_REQUIRE(hash == make_hash(1024));
+    BOOST_REQUIRE(snapshot->get(hash, 2999));
+    BOOST_REQUIRE(hash == make_hash(2999));
+    BOOST_REQUIRE(!snapshot->get(hash, 3000));
+}
+
+BOOST_AUTO_TEST_CASE(hash_index__update__reorganize__replaced_above_fork)
+{
+    hash_index instance;
+    instance.update(0, make_hashes(0, 2000));
+    instance.update(1500, make_hashes(5000, 10));
+    const auto snapshot = instance.get();
+    BOOST_REQUIRE_EQUAL(snapshot->size(), 1510u);
+
+    hash_digest hash;
+    BOOST_REQUIRE(snapshot->get(hash, 1499));
+    BOOST_REQUIRE(hash == make_hash(1499));
+    BOOST_REQUIRE(snapshot->get(hash, 1500));
+    BOOST_REQUIRE(hash == make_hash(5000));
+    BOOST_REQUIRE(snapshot->get(hash, 1509));
+    BOOST_REQUIRE(hash == make_hash(5009));
+}
+
+BOOST_AUTO_TEST_CASE(hash_index__update__prior_snapshot__unchanged)
+{
+    hash_index instance;
+    instance.update(0, make_hashes(0, 10));
+    const auto prior = instance.get();
+    instance.update(5, {});
+    const auto current = instance.get();
+
+    hash_digest hash;
+    BOOST_REQUIRE_EQUAL(prior->size(), 10u);
+    BOOST_REQUIRE(prior->get(hash, 9));
+    BOOST_REQUIRE(hash == make_hash(9));
+    BOOST_REQUIRE_EQUAL(current->size(), 5u);
+    BOOST_REQUIRE_EQUAL(current->version(), 2u);
+    BOOST_REQUIRE(!current->get(hash, 5));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,167 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <boost/filesystem.hpp>
+#include <bitcoin/blockchain.hpp>
+#include "utility.hpp"
+
+using namespace bc;
+using namespace bc::blockchain;
+using namespace bc::chain;
+
+BOOST_AUTO_TEST_SUITE(header_array_tests)
+
+static boost::filesystem::path make_file()
+{
+    const boost::filesystem::path file(TEST_NAME + ".headers");
+    boost::filesystem::remove(file);
+    return file;
+}
+
+static header make_header(uint32_t nonce)
+{
+    auto value = block::genesis_mainnet().header();
+    value.set_nonce(nonce);
+    return value;
+}
+
+BOOST_AUTO_TEST_CASE(header_array__start__new_file__empty)
+{
+    header_array instance(make_file());
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(header_array__push__stopped__false)
+{
+    header_array instance(make_file());
+    BOOST_REQUIRE(!instance.push(make_header(0)));
+}
+
+BOOST_AUTO_TEST_CASE(header_array__get__pushed__expected)
+{
+    header_array instance(make_file());
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE(instance.push(make_header(0)));
+    BOOST_REQUIRE(instance.push(make_header(1)));
+
+    header value;
+    BOOST_REQUIRE(instance.get(value, 1));
+    BOOST_REQUIRE(value == make_header(1));
+    BOOST_REQUIRE(!instance.get(value, 2));
+}
+
+BOOST_AUTO_TEST_CASE(header_array__get__slice__serialized_headers)
+{
+    header_array instance(make_file());
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE(instance.push(make_header(0)));
+    BOOST_REQUIRE(instance.push(make_header(1)));
+    BOOST_REQUIRE(instance.push(make_header(2)));
+
+    data_chunk data;
+    BOOST_REQUIRE(instance.get(data, 1, 3));
+    BOOST_REQUIRE(data == build_chunk(
+    {
+        make_header(1).to_data(),
+        make_header(2).to_data()
+    }));
+
+    BOOST_REQUIRE(!instance.get(data, 2, 4));
+    BOOST_REQUIRE(!instance.get(data, 2, 2));
+}
+
+BOOST_AUTO_TEST_CASE(header_array__get__stopped__false)
+{
+    header_array instance(make_file());
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE(instance.push(make_header(0)));
+    instance.stop();
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+
+    header value;
+    data_chunk data;
+    BOOST_REQUIRE(!instance.get(value, 0));
+    BOOST_REQUIRE(!instance.get(data, 0, 1));
+}
+
+BOOST_AUTO_TEST_CASE(header_array__pop__above_height__removed)
+{
+    header_array instance(make_file());
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE(instance.push(make_header(0)));
+    BOOST_REQUIRE(instance.push(make_header(1)));
+    BOOST_REQUIRE(instance.push(make_header(2)));
+    instance.pop(0);
+    BOOST_REQUIRE_EQUAL(instance.size(), 1u);
+    BOOST_REQUIRE(instance.push(make_header(3)));
+
+    header value;
+    BOOST_REQUIRE(instance.get(value, 1));
+    BOOST_REQUIRE(value == make_header(3));
+}
+
+BOOST_AUTO_TEST_CASE(header_array__clear__pushed__empty)
+{
+    header_array instance(make_file());
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE(instance.push(make_header(0)));
+    instance.clear();
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(header_array__push__beyond_growth__remapped)
+{
+    static const size_t count = 65537;
+    header_array instance(make_file());
+    BOOST_REQUIRE(instance.start());
+
+    for (size_t nonce = 0; nonce < count; ++nonce)
+        BOOST_REQUIRE(instance.push(make_header(static_cast<uint32_t>(nonce))));
+
+    header value;
+    BOOST_REQUIRE_EQUAL(instance.size(), count);
+    BOOST_REQUIRE(instance.get(value, count - 1u));
+    BOOST_REQUIRE(value == make_header(static_cast<uint32_t>(count - 1u)));
+}
+
+BOOST_AUTO_TEST_CASE(header_array__start__restarted__persisted)
+{
+    const auto file = make_file();
+
+    {
+        header_array instance(file);
+        BOOST_REQUIRE(instance.start());
+        BOOST_REQUIRE(instance.push(make_header(0)));
+        BOOST_REQUIRE(instance.push(make_header(1)));
+        instance.stop();
+    }
+
+    header_array instance(file);
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE_EQUAL(instance.size(), 2u);
+
+    header value;
+    BOOST_REQUIRE(instance.get(value, 1));
+    BOOST_REQUIRE(value == make_header(1));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -31,8 +31,8 @@ class header_pool_fixture
   : public header_pool
 {
 public:
-    header_pool_fixture(size_t maximum_depth)
-      : header_pool(maximum_depth)
+    header_pool_fixture(size_t maximum_depth, size_t maximum_megabytes=0)
+      : header_pool(maximum_depth, maximum_megabytes)
     {
     }
 
@@ -41,9 +41,31 @@ public:
         return maximum_depth_;
     }
 
-    header_entries& headers()
+    size_t height(header_const_ptr header) const
     {
-        return headers_;
+        return header_pool::height(header->hash());
+    }
+
+    // The header of a root at the height, or of any non-root if zero.
+    header_const_ptr root(size_t height) const
+    {
+        for (link item = 0; item < nodes_.size(); ++item)
+        {
+            const auto& entry = nodes_[item];
+
+            if (live(item) && (height == 0 ? !entry.root :
+                entry.root && entry.height == height))
+                return materialize(item);
+        }
+
+        return nullptr;
+    }
+
+    // The header object of the node is retained (it is a leaf).
+    bool retained(header_const_ptr header) const
+    {
+        const auto item = find(header->hash());
+        return item != null_link && nodes_[item].header == header;
     }
 };
 
@@ -82,6 +104,76 @@ BOOST_AUTO_TEST_CASE(header_pool__construct__nonzero_depth__round_trips)
     BOOST_REQUIRE_EQUAL(instance.maximum_depth(), expected);
 }
 
+// memory
+
+BOOST_AUTO_TEST_CASE(header_pool__memory__empty__zero)
+{
+    header_pool instance(0);
+    BOOST_REQUIRE_EQUAL(instance.memory(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(header_pool__memory__added__at_least_headers)
+{
+    header_pool instance(0);
+    instance.add(make_header(1), 42);
+    instance.add(make_header(2), 43);
+    BOOST_REQUIRE_GE(instance.memory(), 2u * sizeof(message::header));
+}
+
+// trim
+
+BOOST_AUTO_TEST_CASE(header_pool__trim__within_bound__unchanged)
+{
+    header_pool instance(0, 1);
+    instance.add(make_header(1), 42);
+    instance.add(make_header(2), 43);
+    BOOST_REQUIRE_EQUAL(instance.size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(header_pool__trim__over_bound__lowest_removed)
+{
+    header_pool instance(0, 1);
+    const auto count = static_cast<uint32_t>(
+        1024u * 1024u / sizeof(message::header) + 1u);
+    const auto lowest = make_header(1);
+    instance.add(lowest, 1);
+    header_const_ptr highest;
+
+    for (uint32_t id = 2; id <= count; ++id)
+    {
+        highest = make_header(id);
+        instance.add(highest, id);
+    }
+
+    BOOST_REQUIRE_LT(instance.size(), count);
+    BOOST_REQUIRE(!instance.exists(lowest));
+    BOOST_REQUIRE(instance.exists(highest));
+}
+
+// shed
+
+BOOST_AUTO_TEST_CASE(header_pool__shed__zero__unchanged)
+{
+    header_pool instance(0);
+    instance.add(make_header(1), 42);
+    instance.add(make_header(2), 43);
+    instance.shed(0);
+    BOOST_REQUIRE_EQUAL(instance.size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(header_pool__shed__one_byte__lowest_removed)
+{
+    header_pool instance(0);
+    const auto lowest = make_header(1);
+    const auto highest = make_header(2);
+    instance.add(lowest, 42);
+    instance.add(highest, 43);
+    instance.shed(1);
+    BOOST_REQUIRE_EQUAL(instance.size(), 1u);
+    BOOST_REQUIRE(!instance.exists(lowest));
+    BOOST_REQUIRE(instance.exists(highest));
+}
+
 // add1
 
 BOOST_AUTO_TEST_CASE(header_pool__add1__one__single)
@@ -94,10 +186,32 @@ BOOST_AUTO_TEST_CASE(header_pool__add1__one__single)
     instance.add(header1, height);
     BOOST_REQUIRE_EQUAL(instance.size(), 1u);
 
-    const auto entry = instance.headers().right.find(height);
-    BOOST_REQUIRE(entry != instance.headers().right.end());
-    BOOST_REQUIRE(entry->second.header() == header1);
-    BOOST_REQUIRE_EQUAL(entry->first, height);
+    const auto entry = instance.root(height);
+    BOOST_REQUIRE(entry);
+    BOOST_REQUIRE(entry == header1);
+    BOOST_REQUIRE_EQUAL(instance.height(entry), height);
+}
+
+BOOST_AUTO_TEST_CASE(header_pool__add1__child__parent_released_child_retained)
+{
+    header_pool_fixture instance(0);
+    const auto header1 = make_header(1);
+    const auto header2 = make_header(2, header1);
+    header1->metadata.median_time_past = 42;
+
+    instance.add(header1, 42);
+    BOOST_REQUIRE(instance.retained(header1));
+
+    instance.add(header2, 43);
+    BOOST_REQUIRE(!instance.retained(header1));
+    BOOST_REQUIRE(instance.retained(header2));
+
+    // The parent is rebuilt from its record (no chain state).
+    const auto entry = instance.root(42);
+    BOOST_REQUIRE(entry);
+    BOOST_REQUIRE(*entry == *header1);
+    BOOST_REQUIRE(!entry->metadata.state);
+    BOOST_REQUIRE_EQUAL(entry->metadata.median_time_past, 42u);
 }
 
 BOOST_AUTO_TEST_CASE(header_pool__add1__twice__single)
@@ -124,9 +238,9 @@ BOOST_AUTO_TEST_CASE(header_pool__add1__two_different_headers_with_same_hash__fi
     instance.add(header1b, height1a + 1);
     BOOST_REQUIRE_EQUAL(instance.size(), 1u);
 
-    const auto entry = instance.headers().right.find(height1a);
-    BOOST_REQUIRE(entry != instance.headers().right.end());
-    BOOST_REQUIRE(entry->second.header() == header1a);
+    const auto entry = instance.root(height1a);
+    BOOST_REQUIRE(entry);
+    BOOST_REQUIRE(entry == header1a);
 }
 
 BOOST_AUTO_TEST_CASE(header_pool__add1__two_distinct_hash__two)
@@ -144,13 +258,13 @@ BOOST_AUTO_TEST_CASE(header_pool__add1__two_distinct_hash__two)
     instance.add(header2, height2);
     BOOST_REQUIRE_EQUAL(instance.size(), 2u);
 
-    const auto& entry1 = instance.headers().right.find(height1);
-    BOOST_REQUIRE(entry1 != instance.headers().right.end());
-    BOOST_REQUIRE(entry1->second.header() == header1);
+    const auto entry1 = instance.root(height1);
+    BOOST_REQUIRE(entry1);
+    BOOST_REQUIRE(entry1 == header1);
 
-    const auto& entry2 = instance.headers().right.find(height2);
-    BOOST_REQUIRE(entry2 != instance.headers().right.end());
-    BOOST_REQUIRE(entry2->second.header() == header2);
+    const auto entry2 = instance.root(height2);
+    BOOST_REQUIRE(entry2);
+    BOOST_REQUIRE(entry2 == header2);
 }
 
 // add2
@@ -175,13 +289,13 @@ BOOST_AUTO_TEST_CASE(header_pool__add2__distinct__expected)
     instance.add(std::make_shared<const header_const_ptr_list>(std::move(headers)), 42);
     BOOST_REQUIRE_EQUAL(instance.size(), 2u);
 
-    const auto entry1 = instance.headers().right.find(42);
-    BOOST_REQUIRE(entry1 != instance.headers().right.end());
-    BOOST_REQUIRE(entry1->second.header() == header1);
+    const auto entry1 = instance.root(42);
+    BOOST_REQUIRE(entry1);
+    BOOST_REQUIRE(entry1 == header1);
 
-    const auto& entry2 = instance.headers().right.find(43);
-    BOOST_REQUIRE(entry2 != instance.headers().right.end());
-    BOOST_REQUIRE(entry2->second.header() == header2);
+    const auto entry2 = instance.root(43);
+    BOOST_REQUIRE(entry2);
+    BOOST_REQUIRE(entry2 == header2);
 }
 
 // remove
@@ -253,13 +367,13 @@ BOOST_AUTO_TEST_CASE(header_pool__remove__subtree__reorganized)
     BOOST_REQUIRE_EQUAL(instance.size(), 3u);
 
     // Entry3 is the new root header (non-zero height).
-    const auto entry3 = instance.headers().right.find(44);
-    BOOST_REQUIRE(entry3 != instance.headers().right.end());
-    BOOST_REQUIRE(entry3->second.header() == header3);
+    const auto entry3 = instance.root(44);
+    BOOST_REQUIRE(entry3);
+    BOOST_REQUIRE(*entry3 == *header3);
 
     // Remaining entries are children (zero height).
-    const auto children = instance.headers().right.find(0);
-    BOOST_REQUIRE(children != instance.headers().right.end());
+    const auto children = instance.root(0);
+    BOOST_REQUIRE(children);
 }
 
 // prune
@@ -383,12 +497,12 @@ BOOST_AUTO_TEST_CASE(header_pool__prune__partial_header_branch_expired__partial_
     BOOST_REQUIRE_EQUAL(instance.size(), 6u);
 
     // There are four headers at height 46, make sure at least one exists.
-    const auto entry = instance.headers().right.find(46);
-    BOOST_REQUIRE(entry != instance.headers().right.end());
+    const auto entry = instance.root(46);
+    BOOST_REQUIRE(entry);
 
     // There are two headers at 47 but neither is a root (not replanted).
-    const auto entry8 = instance.headers().right.find(47);
-    BOOST_REQUIRE(entry8 == instance.headers().right.end());
+    const auto entry8 = instance.root(47);
+    BOOST_REQUIRE(!entry8);
 }
 
 // filter
@@ -524,10 +638,10 @@ BOOST_AUTO_TEST_CASE(header_pool__get_branch__connected_one_path__expected_path_
     const auto path = instance.get_branch(header5);
     BOOST_REQUIRE_EQUAL(path->size(), 5u);
     BOOST_REQUIRE_EQUAL(path->height(), fork_point);
-    BOOST_REQUIRE((*path->headers())[0] == header1);
-    BOOST_REQUIRE((*path->headers())[1] == header2);
-    BOOST_REQUIRE((*path->headers())[2] == header3);
-    BOOST_REQUIRE((*path->headers())[3] == header4);
+    BOOST_REQUIRE(*(*path->headers())[0] == *header1);
+    BOOST_REQUIRE(*(*path->headers())[1] == *header2);
+    BOOST_REQUIRE(*(*path->headers())[2] == *header3);
+    BOOST_REQUIRE(*(*path->headers())[3] == *header4);
     BOOST_REQUIRE((*path->headers())[4] == header5);
 }
 
@@ -564,19 +678,19 @@ BOOST_AUTO_TEST_CASE(header_pool__get_branch__connected_multiple_paths__expected
     const auto path1 = instance.get_branch(header5);
     BOOST_REQUIRE_EQUAL(path1->size(), 5u);
     BOOST_REQUIRE_EQUAL(path1->height(), fork_point1);
-    BOOST_REQUIRE((*path1->headers())[0] == header1);
-    BOOST_REQUIRE((*path1->headers())[1] == header2);
-    BOOST_REQUIRE((*path1->headers())[2] == header3);
-    BOOST_REQUIRE((*path1->headers())[3] == header4);
+    BOOST_REQUIRE(*(*path1->headers())[0] == *header1);
+    BOOST_REQUIRE(*(*path1->headers())[1] == *header2);
+    BOOST_REQUIRE(*(*path1->headers())[2] == *header3);
+    BOOST_REQUIRE(*(*path1->headers())[3] == *header4);
     BOOST_REQUIRE((*path1->headers())[4] == header5);
 
     const auto path2 = instance.get_branch(header15);
     BOOST_REQUIRE_EQUAL(path2->size(), 5u);
     BOOST_REQUIRE_EQUAL(path2->height(), fork_point2);
-    BOOST_REQUIRE((*path2->headers())[0] == header11);
-    BOOST_REQUIRE((*path2->headers())[1] == header12);
-    BOOST_REQUIRE((*path2->headers())[2] == header13);
-    BOOST_REQUIRE((*path2->headers())[3] == header14);
+    BOOST_REQUIRE(*(*path2->headers())[0] == *header11);
+    BOOST_REQUIRE(*(*path2->headers())[1] == *header12);
+    BOOST_REQUIRE(*(*path2->headers())[2] == *header13);
+    BOOST_REQUIRE(*(*path2->headers())[3] == *header14);
     BOOST_REQUIRE((*path2->headers())[4] == header15);
 }
 
@@ -613,29 +727,56 @@ BOOST_AUTO_TEST_CASE(header_pool__get_branch__connected_multiple_sub_header_bran
     const auto path1 = instance.get_branch(header5);
     BOOST_REQUIRE_EQUAL(path1->size(), 5u);
     BOOST_REQUIRE_EQUAL(path1->height(), fork_point);
-    BOOST_REQUIRE((*path1->headers())[0] == header1);
-    BOOST_REQUIRE((*path1->headers())[1] == header2);
-    BOOST_REQUIRE((*path1->headers())[2] == header3);
-    BOOST_REQUIRE((*path1->headers())[3] == header4);
+    BOOST_REQUIRE(*(*path1->headers())[0] == *header1);
+    BOOST_REQUIRE(*(*path1->headers())[1] == *header2);
+    BOOST_REQUIRE(*(*path1->headers())[2] == *header3);
+    BOOST_REQUIRE(*(*path1->headers())[3] == *header4);
     BOOST_REQUIRE((*path1->headers())[4] == header5);
 
     const auto path2 = instance.get_branch(header12);
     BOOST_REQUIRE_EQUAL(path2->size(), 3u);
     BOOST_REQUIRE_EQUAL(path2->height(), fork_point);
-    BOOST_REQUIRE((*path2->headers())[0] == header1);
-    BOOST_REQUIRE((*path2->headers())[1] == header11);
+    BOOST_REQUIRE(*(*path2->headers())[0] == *header1);
+    BOOST_REQUIRE(*(*path2->headers())[1] == *header11);
     BOOST_REQUIRE((*path2->headers())[2] == header12);
 
     const auto path3 = instance.get_branch(header23);
     BOOST_REQUIRE_EQUAL(path3->size(), 7u);
     BOOST_REQUIRE_EQUAL(path3->height(), fork_point);
-    BOOST_REQUIRE((*path3->headers())[0] == header1);
-    BOOST_REQUIRE((*path3->headers())[1] == header2);
-    BOOST_REQUIRE((*path3->headers())[2] == header3);
-    BOOST_REQUIRE((*path3->headers())[3] == header4);
-    BOOST_REQUIRE((*path3->headers())[4] == header21);
-    BOOST_REQUIRE((*path3->headers())[5] == header22);
+    BOOST_REQUIRE(*(*path3->headers())[0] == *header1);
+    BOOST_REQUIRE(*(*path3->headers())[1] == *header2);
+    BOOST_REQUIRE(*(*path3->headers())[2] == *header3);
+    BOOST_REQUIRE(*(*path3->headers())[3] == *header4);
+    BOOST_REQUIRE(*(*path3->headers())[4] == *header21);
+    BOOST_REQUIRE(*(*path3->headers())[5] == *header22);
     BOOST_REQUIRE((*path3->headers())[6] == header23);
 }
 
+BOOST_AUTO_TEST_CASE(header_pool__get_branch__removed_root__replanted_height)
+{
+    header_pool_fixture instance(0);
+    const auto header1 = make_header(1);
+    const auto header2 = make_header(2, header1);
+    const auto header3 = make_header(3, header2);
+    const auto header4 = make_header(4, header3);
+    const auto header5 = make_header(5, header4);
+
+    instance.add(header1, 42);
+    instance.add(header2, 43);
+    instance.add(header3, 44);
+    instance.add(header4, 45);
+
+    header_const_ptr_list path{ header1, header2 };
+    instance.remove(std::make_shared<const header_const_ptr_list>(std::move(path)));
+    BOOST_REQUIRE_EQUAL(instance.size(), 2u);
+
+    // The sub-branch is replanted at header3, so the fork point is below it.
+    const auto branch = instance.get_branch(header5);
+    BOOST_REQUIRE_EQUAL(branch->size(), 3u);
+    BOOST_REQUIRE_EQUAL(branch->height(), 43u);
+    BOOST_REQUIRE(*(*branch->headers())[0] == *header3);
+    BOOST_REQUIRE(*(*branch->headers())[1] == *header4);
+    BOOST_REQUIRE((*branch->headers())[2] == header5);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
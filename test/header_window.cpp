@@ -0,0 +1,159 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <bitcoin/blockchain.hpp>
+
+using namespace bc;
+using namespace bc::chain;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(header_window_tests)
+
+static header make_header(uint32_t timestamp)
+{
+    return header{ 1, null_hash, null_hash, timestamp, 0x1d00ffff, 0 };
+}
+
+BOOST_AUTO_TEST_CASE(header_window__construct__always__empty)
+{
+    header_window instance(2);
+    uint32_t bits;
+    BOOST_REQUIRE_EQUAL(instance.capacity(), 2u);
+    BOOST_REQUIRE(!instance.get_bits(bits, 0));
+}
+
+BOOST_AUTO_TEST_CASE(header_window__push__reset_height__expected_fields)
+{
+    header_window instance(2);
+    const auto value = make_header(42);
+    instance.reset(10);
+    instance.push(value);
+
+    uint32_t bits;
+    uint32_t version;
+    uint32_t timestamp;
+    hash_digest hash;
+    BOOST_REQUIRE(instance.get_bits(bits, 10));
+    BOOST_REQUIRE(instance.get_version(version, 10));
+    BOOST_REQUIRE(instance.get_timestamp(timestamp, 10));
+    BOOST_REQUIRE(instance.get_block_hash(hash, 10));
+    BOOST_REQUIRE_EQUAL(bits, value.bits());
+    BOOST_REQUIRE_EQUAL(version, value.version());
+    BOOST_REQUIRE_EQUAL(timestamp, value.timestamp());
+    BOOST_REQUIRE(hash == value.hash());
+    BOOST_REQUIRE(!instance.get_bits(bits, 9));
+    BOOST_REQUIRE(!instance.get_bits(bits, 11));
+}
+
+BOOST_AUTO_TEST_CASE(header_window__push__over_capacity__oldest_dropped)
+{
+    header_window instance(2);
+    instance.reset(10);
+    instance.push(make_header(1));
+    instance.push(make_header(2));
+    instance.push(make_header(3));
+
+    uint32_t timestamp;
+    BOOST_REQUIRE(!instance.get_timestamp(timestamp, 10));
+    BOOST_REQUIRE(instance.get_timestamp(timestamp, 11));
+    BOOST_REQUIRE_EQUAL(timestamp, 2u);
+    BOOST_REQUIRE(instance.get_timestamp(timestamp, 12));
+    BOOST_REQUIRE_EQUAL(timestamp, 3u);
+}
+
+BOOST_AUTO_TEST_CASE(header_window__pop__within__truncated)
+{
+    header_window instance(3);
+    instance.reset(10);
+    instance.push(make_header(1));
+    instance.push(make_header(2));
+    instance.pop(10);
+    instance.push(make_header(3));
+
+    uint32_t timestamp;
+    BOOST_REQUIRE(instance.get_timestamp(timestamp, 11));
+    BOOST_REQUIRE_EQUAL(timestamp, 3u);
+}
+
+BOOST_AUTO_TEST_CASE(header_window__pop__below__empty_above_height)
+{
+    header_window instance(3);
+    instance.reset(10);
+    instance.push(make_header(1));
+    instance.pop(5);
+    instance.push(make_header(2));
+
+    uint32_t timestamp;
+    BOOST_REQUIRE(!instance.get_timestamp(timestamp, 10));
+    BOOST_REQUIRE(instance.get_timestamp(timestamp, 6));
+    BOOST_REQUIRE_EQUAL(timestamp, 2u);
+}
+
+BOOST_AUTO_TEST_CASE(header_window__from_data__to_data__round_trip)
+{
+    header_window instance(2);
+    instance.reset(10);
+    instance.push(make_header(1));
+    instance.push(make_header(2));
+
+    data_chunk data;
+    data_sink ostream(data);
+    ostream_writer sink(ostream);
+    instance.to_data(sink);
+    ostream.flush();
+
+    header_window copy(2);
+    data_source istream(data);
+    istream_reader source(istream);
+    BOOST_REQUIRE(copy.from_data(source));
+
+    uint32_t timestamp;
+    hash_digest hash;
+    BOOST_REQUIRE(!copy.get_timestamp(timestamp, 9));
+    BOOST_REQUIRE(copy.get_timestamp(timestamp, 11));
+    BOOST_REQUIRE_EQUAL(timestamp, 2u);
+    BOOST_REQUIRE(copy.get_block_hash(hash, 10));
+    BOOST_REQUIRE(hash == make_header(1).hash());
+}
+
+BOOST_AUTO_TEST_CASE(header_window__from_data__over_capacity__false_empty)
+{
+    header_window instance(2);
+    instance.reset(10);
+    instance.push(make_header(1));
+    instance.push(make_header(2));
+
+    data_chunk data;
+    data_sink ostream(data);
+    ostream_writer sink(ostream);
+    instance.to_data(sink);
+    ostream.flush();
+
+    header_window copy(1);
+    data_source istream(data);
+    istream_reader source(istream);
+    BOOST_REQUIRE(!copy.from_data(source));
+
+    uint32_t timestamp;
+    BOOST_REQUIRE(!copy.get_timestamp(timestamp, 10));
+    BOOST_REQUIRE(!copy.get_timestamp(timestamp, 11));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
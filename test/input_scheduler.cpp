@@ -0,0 +1,186 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <bitcoin/blockchain.hpp>
+
+using namespace bc;
+using namespace bc::chain;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(input_scheduler_tests)
+
+static transaction make_transaction(size_t inputs)
+{
+    transaction tx(1, 0, input::list(inputs), {});
+    return tx;
+}
+
+// Coinbase followed by transactions with the given input counts.
+static block_const_ptr make_block(const std::vector<size_t>& inputs)
+{
+    transaction::list txs{ make_transaction(1) };
+
+    for (const auto count: inputs)
+        txs.push_back(make_transaction(count));
+
+    return std::make_shared<const message::block>(header{}, std::move(txs));
+}
+
+BOOST_AUTO_TEST_CASE(input_scheduler__construct__coinbase_only__no_buckets)
+{
+    input_scheduler instance(make_block({}), 4);
+    BOOST_REQUIRE_EQUAL(instance.buckets(), 0u);
+    BOOST_REQUIRE_EQUAL(instance.transactions(), 0u);
+    BOOST_REQUIRE_EQUAL(instance.inputs(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(input_scheduler__construct__few_inputs__buckets_limited)
+{
+    input_scheduler instance(make_block({ 1, 2 }), 8);
+    BOOST_REQUIRE_EQUAL(instance.buckets(), 3u);
+    BOOST_REQUIRE_EQUAL(instance.transactions(), 2u);
+    BOOST_REQUIRE_EQUAL(instance.inputs(), 3u);
+}
+
+BOOST_AUTO_TEST_CASE(input_scheduler__construct__verified__skipped)
+{
+    const auto block = make_block({ 3, 2 });
+    block->transactions()[1].metadata.verified = true;
+    input_scheduler instance(block, 4);
+    BOOST_REQUIRE_EQUAL(instance.transactions(), 2u);
+    BOOST_REQUIRE_EQUAL(instance.verified(), 1u);
+    BOOST_REQUIRE_EQUAL(instance.inputs(), 2u);
+
+    size_t tx;
+    uint32_t input;
+    instance.locate(0, tx, input);
+    BOOST_REQUIRE_EQUAL(tx, 2u);
+    BOOST_REQUIRE_EQUAL(input, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(input_scheduler__locate__positions__expected)
+{
+    input_scheduler instance(make_block({ 2, 0, 3 }), 2);
+    BOOST_REQUIRE_EQUAL(instance.inputs(), 5u);
+
+    size_t tx;
+    uint32_t input;
+    instance.locate(1, tx, input);
+    BOOST_REQUIRE_EQUAL(tx, 1u);
+    BOOST_REQUIRE_EQUAL(input, 1u);
+    instance.locate(2, tx, input);
+    BOOST_REQUIRE_EQUAL(tx, 3u);
+    BOOST_REQUIRE_EQUAL(input, 0u);
+    instance.locate(4, tx, input);
+    BOOST_REQUIRE_EQUAL(tx, 3u);
+    BOOST_REQUIRE_EQUAL(input, 2u);
+}
+
+BOOST_AUTO_TEST_CASE(input_scheduler__next__single_bucket__steals_all)
+{
+    input_scheduler instance(make_block({ 100, 50, 7 }), 4);
+    BOOST_REQUIRE_EQUAL(instance.buckets(), 4u);
+
+    size_t begin;
+    size_t end;
+    std::vector<size_t> claimed(instance.inputs(), 0);
+
+    // A single bucket drains its own range and then steals the others.
+    while (instance.next(0, begin, end))
+        for (auto position = begin; position < end; ++position)
+            ++claimed[position];
+
+    for (const auto count: claimed)
+        BOOST_REQUIRE_EQUAL(count, 1u);
+
+    for (size_t bucket = 0; bucket < instance.buckets(); ++bucket)
+        instance.complete(bucket);
+
+    const auto summary = instance.summary();
+    BOOST_REQUIRE_EQUAL(summary.inputs, 157u);
+    BOOST_REQUIRE_EQUAL(summary.stolen, 157u - 40u);
+    BOOST_REQUIRE(summary.steals > 0u);
+}
+
+BOOST_AUTO_TEST_CASE(input_scheduler__next__all_buckets__each_position_once)
+{
+    input_scheduler instance(make_block({ 13, 1, 29 }), 3);
+
+    size_t begin;
+    size_t end;
+    std::vector<size_t> claimed(instance.inputs(), 0);
+
+    // Interleave buckets as concurrent workers would.
+    for (auto progress = true; progress;)
+    {
+        progress = false;
+
+        for (size_t bucket = 0; bucket < instance.buckets(); ++bucket)
+        {
+            if (!instance.next(bucket, begin, end))
+                continue;
+
+            progress = true;
+            for (auto position = begin; position < end; ++position)
+                ++claimed[position];
+        }
+    }
+
+    for (const auto count: claimed)
+        BOOST_REQUIRE_EQUAL(count, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(input_scheduler__construct__costly_input__own_range)
+{
+    // The first input (1024 units) costs more than the three others (768).
+    auto tx = make_transaction(4);
+    tx.inputs()[0].set_script(script(data_chunk(768, 0x61), false));
+    transaction::list txs{ make_transaction(1), tx };
+    const auto block = std::make_shared<const message::block>(header{},
+        std::move(txs));
+
+    input_scheduler instance(block, 2);
+    BOOST_REQUIRE_EQUAL(instance.buckets(), 2u);
+
+    size_t begin;
+    size_t end;
+    BOOST_REQUIRE(instance.next(0, begin, end));
+    BOOST_REQUIRE_EQUAL(begin, 0u);
+    BOOST_REQUIRE_EQUAL(end, 1u);
+
+    // The costliest range is 1024 of a mean of 896 units.
+    const auto summary = instance.summary();
+    BOOST_REQUIRE(summary.imbalance > 1.14f && summary.imbalance < 1.15f);
+}
+
+BOOST_AUTO_TEST_CASE(input_scheduler__cost__larger_script__costlier)
+{
+    const input small;
+    input large;
+    large.set_script(script(data_chunk(100, 0x61), false));
+    BOOST_REQUIRE_GT(input_scheduler::cost(large, true, true),
+        input_scheduler::cost(small, true, true));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <bitcoin/blockchain.hpp>
+
+using namespace bc;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(memory_budget_tests)
+
+static constexpr size_t megabyte = 1024 * 1024;
+
+BOOST_AUTO_TEST_CASE(memory_budget__disabled__zero__true)
+{
+    memory_budget instance(0);
+    BOOST_REQUIRE(instance.disabled());
+    BOOST_REQUIRE_EQUAL(instance.maximum(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(memory_budget__report__enrolled__in_order)
+{
+    memory_budget instance(1);
+    instance.enroll("first", []() { return size_t(10); }, [](size_t) {});
+    instance.enroll("second", []() { return size_t(20); }, [](size_t) {});
+
+    const auto report = instance.report();
+    BOOST_REQUIRE_EQUAL(report.size(), 2u);
+    BOOST_REQUIRE_EQUAL(report[0].name, "first");
+    BOOST_REQUIRE_EQUAL(report[0].bytes, 10u);
+    BOOST_REQUIRE_EQUAL(report[1].name, "second");
+    BOOST_REQUIRE_EQUAL(report[1].bytes, 20u);
+    BOOST_REQUIRE_EQUAL(instance.total(), 30u);
+}
+
+BOOST_AUTO_TEST_CASE(memory_budget__enforce__within_budget__not_shed)
+{
+    memory_budget instance(1);
+    auto shed = false;
+    instance.enroll("pool", []() { return size_t(100); },
+        [&](size_t) { shed = true; });
+
+    instance.enforce();
+    BOOST_REQUIRE(!shed);
+    BOOST_REQUIRE_EQUAL(instance.sheds(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(memory_budget__enforce__disabled__not_shed)
+{
+    memory_budget instance(0);
+    auto shed = false;
+    instance.enroll("pool", []() { return megabyte; },
+        [&](size_t) { shed = true; });
+
+    instance.enforce();
+    BOOST_REQUIRE(!shed);
+}
+
+BOOST_AUTO_TEST_CASE(memory_budget__enforce__first_sheds_excess__others_kept)
+{
+    memory_budget instance(1);
+    size_t pool = megabyte;
+    size_t cache = 100;
+    size_t requested = 0;
+    std::vector<std::string> order;
+
+    instance.enroll("pool", [&]() { return pool; },
+        [&](size_t bytes) { order.push_back("pool"); requested = bytes;
+            pool -= bytes; });
+    instance.enroll("cache", [&]() { return cache; },
+        [&](size_t) { order.push_back("cache"); cache = 0; });
+
+    instance.enforce();
+    BOOST_REQUIRE_EQUAL(requested, 100u);
+    BOOST_REQUIRE_EQUAL(order.size(), 1u);
+    BOOST_REQUIRE_EQUAL(cache, 100u);
+    BOOST_REQUIRE_EQUAL(instance.total(), megabyte);
+    BOOST_REQUIRE_EQUAL(instance.sheds(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(memory_budget__enforce__first_cannot_shed__next_shed)
+{
+    memory_budget instance(1);
+    size_t cache = megabyte;
+    std::vector<std::string> order;
+
+    instance.enroll("pool", []() { return size_t(100); },
+        [&](size_t) { order.push_back("pool"); });
+    instance.enroll("cache", [&]() { return cache; },
+        [&](size_t) { order.push_back("cache"); cache = 0; });
+    instance.enroll("headers", []() { return size_t(100); },
+        [&](size_t) { order.push_back("headers"); });
+
+    instance.enforce();
+    BOOST_REQUIRE_EQUAL(order.size(), 2u);
+    BOOST_REQUIRE_EQUAL(order[0], "pool");
+    BOOST_REQUIRE_EQUAL(order[1], "cache");
+    BOOST_REQUIRE_EQUAL(instance.total(), 200u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,95 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <bitcoin/blockchain.hpp>
+
+using namespace bc;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(merkle_builder_tests)
+
+static hash_list make_leaves(size_t count)
+{
+    hash_list leaves;
+    leaves.reserve(count);
+
+    for (size_t index = 0; index < count; ++index)
+        leaves.push_back(bitcoin_hash(to_chunk(to_little_endian(
+            static_cast<uint32_t>(index)))));
+
+    return leaves;
+}
+
+static hash_digest join(const hash_digest& left, const hash_digest& right)
+{
+    return bitcoin_hash(build_chunk({ left, right }));
+}
+
+BOOST_AUTO_TEST_CASE(merkle_builder__serial_root__empty__null_hash)
+{
+    BOOST_REQUIRE(merkle_builder::serial_root({}) == null_hash);
+}
+
+BOOST_AUTO_TEST_CASE(merkle_builder__serial_root__one__leaf)
+{
+    const auto leaves = make_leaves(1);
+    BOOST_REQUIRE(merkle_builder::serial_root(leaves) == leaves[0]);
+}
+
+BOOST_AUTO_TEST_CASE(merkle_builder__serial_root__three__last_paired_with_itself)
+{
+    const auto leaves = make_leaves(3);
+    const auto expected = join(join(leaves[0], leaves[1]),
+        join(leaves[2], leaves[2]));
+    BOOST_REQUIRE(merkle_builder::serial_root(leaves) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(merkle_builder__root__small__serial_root)
+{
+    threadpool pool(3);
+    dispatcher dispatch(pool, "merkle_builder");
+    const merkle_builder builder(dispatch);
+    const auto leaves = make_leaves(5);
+    BOOST_REQUIRE(builder.root(leaves) == merkle_builder::serial_root(leaves));
+    pool.shutdown();
+    pool.join();
+}
+
+BOOST_AUTO_TEST_CASE(merkle_builder__root__large__serial_root)
+{
+    threadpool pool(3);
+    dispatcher dispatch(pool, "merkle_builder");
+    const merkle_builder builder(dispatch);
+    const auto minimum = merkle_builder::minimum_parallel_leaves;
+
+    // Full, partial and single leaf last subtrees.
+    for (const auto count: { 2u * minimum, 2u * minimum + 1u,
+        3u * minimum + 7u, 5u * minimum - 1u })
+    {
+        const auto leaves = make_leaves(count);
+        BOOST_REQUIRE(builder.root(leaves) ==
+            merkle_builder::serial_root(leaves));
+    }
+
+    pool.shutdown();
+    pool.join();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
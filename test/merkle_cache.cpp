@@ -0,0 +1,87 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <bitcoin/blockchain.hpp>
+#include "utility.hpp"
+
+using namespace bc;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(merkle_cache_tests)
+
+static const auto hash1 = hash_literal(
+    "4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b");
+static const auto hash2 = hash_literal(
+    "000000000019d6689c085ae165831e934ff763ae46a2a6c172b3f1b60a8ce26f");
+
+BOOST_AUTO_TEST_CASE(merkle_cache__construct__zero__disabled)
+{
+    merkle_cache instance(0);
+    BOOST_REQUIRE(instance.disabled());
+}
+
+BOOST_AUTO_TEST_CASE(merkle_cache__add__disabled__not_cached)
+{
+    merkle_cache instance(0);
+    hash_list hashes;
+    instance.add(hash1, { hash2 });
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+    BOOST_REQUIRE(!instance.get(hashes, hash1));
+}
+
+BOOST_AUTO_TEST_CASE(merkle_cache__get__added__expected)
+{
+    merkle_cache instance(1);
+    const hash_list expected{ hash1, hash2 };
+    instance.add(hash1, expected);
+
+    hash_list hashes;
+    BOOST_REQUIRE(instance.get(hashes, hash1));
+    BOOST_REQUIRE(hashes == expected);
+    BOOST_REQUIRE(!instance.get(hashes, hash2));
+}
+
+BOOST_AUTO_TEST_CASE(merkle_cache__add__empty__not_cached)
+{
+    merkle_cache instance(1);
+    hash_list hashes;
+    instance.add(hash1, {});
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+    BOOST_REQUIRE(!instance.get(hashes, hash1));
+
+    // A later read of the block's txs is then cached.
+    instance.add(hash1, { hash2 });
+    BOOST_REQUIRE(instance.get(hashes, hash1));
+    BOOST_REQUIRE_EQUAL(hashes.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(merkle_cache__add__block__tx_hashes)
+{
+    merkle_cache instance(1);
+    const auto block = NEW_BLOCK(1);
+    instance.add(block);
+
+    hash_list hashes;
+    BOOST_REQUIRE(instance.get(hashes, block->hash()));
+    BOOST_REQUIRE_EQUAL(hashes.size(), block->transactions().size());
+    BOOST_REQUIRE(hashes.front() == block->transactions().front().hash());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
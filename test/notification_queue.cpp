@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <utility>
+#include <bitcoin/blockchain.hpp>
+
+using namespace bc;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(notification_queue_tests)
+
+static header_const_ptr_list_const_ptr make_headers(uint32_t first,
+    size_t count)
+{
+    const auto headers = std::make_shared<header_const_ptr_list>();
+
+    for (size_t index = 0; index < count; ++index)
+        headers->push_back(std::make_shared<const message::header>(
+            first + index, null_hash, null_hash, 0, 0, 0));
+
+    return headers;
+}
+
+static void ignore(size_t, header_const_ptr_list_const_ptr,
+    header_const_ptr_list_const_ptr)
+{
+}
+
+BOOST_AUTO_TEST_CASE(notification_queue__push__stopped__false)
+{
+    notification_queue instance(0, ignore);
+    BOOST_REQUIRE(!instance.push([](){}));
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(notification_queue__push__started__invoked)
+{
+    std::promise<bool> invoked;
+    notification_queue instance(0, ignore);
+    instance.start();
+    BOOST_REQUIRE(instance.push([&](){ invoked.set_value(true); }));
+    BOOST_REQUIRE(invoked.get_future().get());
+    instance.stop();
+}
+
+BOOST_AUTO_TEST_CASE(notification_queue__push__headers_extension__coalesced)
+{
+    std::promise<std::pair<size_t, size_t>> invoked;
+    notification_queue instance(0, [&](size_t fork_height,
+        header_const_ptr_list_const_ptr incoming,
+        header_const_ptr_list_const_ptr)
+    {
+        invoked.set_value({ fork_height, incoming->size() });
+    });
+
+    // The dispatch thread is held so that the headers remain queued.
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    instance.start();
+    BOOST_REQUIRE(instance.push([=](){ released.wait(); }));
+    BOOST_REQUIRE(instance.push(10, make_headers(1, 2), make_headers(100, 1)));
+    BOOST_REQUIRE(instance.push(12, make_headers(3, 3), make_headers(0, 0)));
+    BOOST_REQUIRE_LE(instance.size(), 2u);
+
+    release.set_value();
+    const auto result = invoked.get_future().get();
+    BOOST_REQUIRE_EQUAL(result.first, 10u);
+    BOOST_REQUIRE_EQUAL(result.second, 5u);
+    instance.stop();
+}
+
+BOOST_AUTO_TEST_CASE(notification_queue__push__headers_below_prior_fork__not_coalesced)
+{
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    notification_queue instance(0, ignore);
+    instance.start();
+    BOOST_REQUIRE(instance.push([=](){ released.wait(); }));
+
+    BOOST_REQUIRE(instance.push(10, make_headers(1, 2), make_headers(0, 0)));
+    const auto size = instance.size();
+    BOOST_REQUIRE(instance.push(9, make_headers(3, 1), make_headers(0, 0)));
+    BOOST_REQUIRE_EQUAL(instance.size(), size + 1u);
+
+    release.set_value();
+    instance.stop();
+}
+
+BOOST_AUTO_TEST_CASE(notification_queue__push__at_limit_stopped__false)
+{
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    notification_queue instance(1, ignore);
+    instance.start();
+
+    // The dispatch thread stops the queue, so it cannot drain the limit.
+    BOOST_REQUIRE(instance.push([&, released]()
+    {
+        released.wait();
+        instance.stop();
+    }));
+
+    while (instance.size() != 0u);
+    BOOST_REQUIRE(instance.push([](){}));
+    auto blocked = std::async(std::launch::async, [&]()
+    {
+        return instance.push([](){});
+    });
+
+    release.set_value();
+    BOOST_REQUIRE(!blocked.get());
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,170 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <utility>
+#include <bitcoin/blockchain.hpp>
+
+using namespace bc;
+using namespace bc::blockchain;
+using namespace bc::chain;
+
+BOOST_AUTO_TEST_SUITE(payment_subscriber_tests)
+
+static short_hash make_address(uint8_t value)
+{
+    auto hash = null_short_hash;
+    hash[0] = value;
+    return hash;
+}
+
+static transaction make_payment(const short_hash& address, uint32_t lock_time)
+{
+    input::list inputs{ { { null_hash, 0 }, script{}, 0 } };
+    output::list outputs{ { 42, script(script::to_pay_key_hash_pattern(
+        address)) } };
+    return { 1, lock_time, std::move(inputs), std::move(outputs) };
+}
+
+static block_const_ptr_list_const_ptr make_blocks(
+    const transaction::list& transactions)
+{
+    const auto block = std::make_shared<const message::block>(header{},
+        transaction::list(transactions));
+    return std::make_shared<const block_const_ptr_list>(
+        block_const_ptr_list{ block });
+}
+
+BOOST_AUTO_TEST_CASE(payment_subscriber__addresses__p2kh_output__address_hash)
+{
+    const auto addresses = payment_subscriber::addresses(
+        make_payment(make_address(1), 0));
+    BOOST_REQUIRE_EQUAL(addresses.size(), 1u);
+    BOOST_REQUIRE(addresses.find(make_address(1)) != addresses.end());
+}
+
+BOOST_AUTO_TEST_CASE(payment_subscriber__subscribe__stopped__service_stopped)
+{
+    payment_subscriber instance;
+    code result;
+    instance.subscribe({ make_address(1) },
+        payment_subscriber::transaction_handler(
+            [&](code ec, transaction_const_ptr)
+            {
+                result = ec;
+                return true;
+            }));
+
+    BOOST_REQUIRE_EQUAL(result, error::service_stopped);
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(payment_subscriber__notify_transaction__filtered__only_matching)
+{
+    payment_subscriber instance;
+    instance.start();
+    size_t first = 0;
+    size_t second = 0;
+    instance.subscribe({ make_address(1) },
+        payment_subscriber::transaction_handler(
+            [&](code, transaction_const_ptr)
+            {
+                ++first;
+                return true;
+            }));
+    instance.subscribe({ make_address(2) },
+        payment_subscriber::transaction_handler(
+            [&](code, transaction_const_ptr)
+            {
+                ++second;
+                return true;
+            }));
+
+    instance.notify(std::make_shared<const message::transaction>(
+        make_payment(make_address(1), 0)));
+    BOOST_REQUIRE_EQUAL(first, 1u);
+    BOOST_REQUIRE_EQUAL(second, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(payment_subscriber__notify_blocks__filtered__matching_in_order)
+{
+    payment_subscriber instance;
+    instance.start();
+    transaction_const_ptr_list_const_ptr matched;
+    instance.subscribe({ make_address(1) },
+        payment_subscriber::block_handler(
+            [&](code, size_t, transaction_const_ptr_list_const_ptr incoming,
+                transaction_const_ptr_list_const_ptr)
+            {
+                matched = incoming;
+                return true;
+            }));
+
+    const auto first = make_payment(make_address(1), 1);
+    const auto other = make_payment(make_address(2), 2);
+    const auto second = make_payment(make_address(1), 3);
+    instance.notify(0, make_blocks({ first, other, second }), {});
+
+    BOOST_REQUIRE(matched);
+    BOOST_REQUIRE_EQUAL(matched->size(), 2u);
+    BOOST_REQUIRE(matched->front()->hash() == first.hash());
+    BOOST_REQUIRE(matched->back()->hash() == second.hash());
+}
+
+BOOST_AUTO_TEST_CASE(payment_subscriber__notify__handler_false__unsubscribed)
+{
+    payment_subscriber instance;
+    instance.start();
+    size_t count = 0;
+    instance.subscribe({ make_address(1) },
+        payment_subscriber::transaction_handler(
+            [&](code, transaction_const_ptr)
+            {
+                ++count;
+                return false;
+            }));
+
+    const auto tx = std::make_shared<const message::transaction>(
+        make_payment(make_address(1), 0));
+    instance.notify(tx);
+    instance.notify(tx);
+    BOOST_REQUIRE_EQUAL(count, 1u);
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(payment_subscriber__stop__subscribed__service_stopped)
+{
+    payment_subscriber instance;
+    instance.start();
+    code result;
+    instance.subscribe({ make_address(1) },
+        payment_subscriber::transaction_handler(
+            [&](code ec, transaction_const_ptr)
+            {
+                result = ec;
+                return true;
+            }));
+
+    instance.stop();
+    BOOST_REQUIRE_EQUAL(result, error::service_stopped);
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
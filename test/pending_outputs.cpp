@@ -0,0 +1,161 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <utility>
+#include <bitcoin/blockchain.hpp>
+#include "utility.hpp"
+
+using namespace bc;
+using namespace bc::chain;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(pending_outputs_tests)
+
+static chain_state::data data()
+{
+    chain_state::data value;
+    value.height = 1;
+    value.bits = { 0, { 0 } };
+    value.version = { 1, { 0 } };
+    value.timestamp = { 0, 0, { 0 } };
+    return value;
+}
+
+static block_const_ptr make_parent()
+{
+    const auto block = NEW_BLOCK(1);
+    block->header().metadata.state = std::make_shared<chain_state>(
+        chain_state{ data(), {}, 0, 0, bc::settings() });
+    return block;
+}
+
+static transaction make_spender(const hash_digest& hash, uint32_t index)
+{
+    input in;
+    in.set_previous_output({ hash, index });
+    transaction tx(1, 0, {}, {});
+    tx.set_inputs({ in });
+    return tx;
+}
+
+static block_const_ptr make_child(block_const_ptr parent,
+    const transaction& spender)
+{
+    transaction::list txs{ parent->transactions().front(), spender };
+    const auto block = std::make_shared<const message::block>(header{},
+        std::move(txs));
+    block->header().metadata.state = parent->header().metadata.state;
+    return block;
+}
+
+BOOST_AUTO_TEST_CASE(pending_outputs__construct__always__empty)
+{
+    pending_outputs instance;
+    BOOST_REQUIRE(instance.empty());
+}
+
+BOOST_AUTO_TEST_CASE(pending_outputs__add__block__not_empty)
+{
+    pending_outputs instance;
+    instance.add(make_parent());
+    BOOST_REQUIRE(!instance.empty());
+}
+
+BOOST_AUTO_TEST_CASE(pending_outputs__clear__added__empty)
+{
+    pending_outputs instance;
+    instance.add(make_parent());
+    instance.clear();
+    BOOST_REQUIRE(instance.empty());
+}
+
+BOOST_AUTO_TEST_CASE(pending_outputs__populate__unrelated__false_unchanged)
+{
+    pending_outputs instance;
+    instance.add(make_parent());
+    const output_point point{ hash_literal(
+        "4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b"), 0 };
+    point.metadata.spent = false;
+    BOOST_REQUIRE(!instance.populate(point));
+    BOOST_REQUIRE(!point.metadata.spent);
+}
+
+BOOST_AUTO_TEST_CASE(pending_outputs__populate__created__expected_metadata)
+{
+    pending_outputs instance;
+    const auto parent = make_parent();
+    instance.add(parent);
+
+    const auto& coinbase = parent->transactions().front();
+    const output_point point{ coinbase.hash(), 0 };
+    BOOST_REQUIRE(instance.populate(point));
+
+    const auto& prevout = point.metadata;
+    const auto state = parent->header().metadata.state;
+    BOOST_REQUIRE(!prevout.spent);
+    BOOST_REQUIRE(prevout.candidate);
+    BOOST_REQUIRE(!prevout.confirmed);
+    BOOST_REQUIRE(prevout.coinbase);
+    BOOST_REQUIRE_EQUAL(prevout.height, state->height());
+    BOOST_REQUIRE_EQUAL(prevout.median_time_past, state->median_time_past());
+    BOOST_REQUIRE(prevout.cache == coinbase.outputs().front());
+}
+
+BOOST_AUTO_TEST_CASE(pending_outputs__populate__created_missing_index__invalid)
+{
+    pending_outputs instance;
+    const auto parent = make_parent();
+    instance.add(parent);
+
+    const auto& coinbase = parent->transactions().front();
+    const output_point point{ coinbase.hash(), 1 };
+    BOOST_REQUIRE(instance.populate(point));
+    BOOST_REQUIRE(!point.metadata.cache.is_valid());
+}
+
+BOOST_AUTO_TEST_CASE(pending_outputs__populate__spent_by_pending__spent)
+{
+    pending_outputs instance;
+    const auto parent = make_parent();
+    const auto hash = hash_literal(
+        "4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b");
+    instance.add(make_child(parent, make_spender(hash, 0)));
+
+    const output_point point{ hash, 0 };
+    point.metadata.spent = false;
+    BOOST_REQUIRE(instance.populate(point));
+    BOOST_REQUIRE(point.metadata.spent);
+}
+
+BOOST_AUTO_TEST_CASE(pending_outputs__populate__created_and_spent__spent)
+{
+    pending_outputs instance;
+    const auto parent = make_parent();
+    const auto& coinbase = parent->transactions().front();
+    instance.add(parent);
+    instance.add(make_child(parent, make_spender(coinbase.hash(), 0)));
+
+    const output_point point{ coinbase.hash(), 0 };
+    BOOST_REQUIRE(instance.populate(point));
+    BOOST_REQUIRE(point.metadata.spent);
+    BOOST_REQUIRE(point.metadata.cache.is_valid());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
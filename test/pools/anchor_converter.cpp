@@ -28,21 +28,19 @@ using namespace bc::blockchain::test::pools;
 static void insert_pool(transaction_pool_state& state,
     transaction_entry::ptr entry, transaction_pool_state::priority value)
 {
-    state.pool.insert({ entry, value });
+    state.insert(entry, value);
 }
 
 static void insert_block_template(transaction_pool_state& state,
     transaction_entry::ptr entry, transaction_pool_state::priority value)
 {
-    state.pool.insert({ entry, value });
-    state.block_template.insert({ entry, value });
-    state.block_template_bytes += entry->size();
-    state.block_template_sigops += entry->sigops();
+    state.insert(entry, value);
+    state.select(entry);
 }
 
 static bool in_pool(transaction_pool_state& state, transaction_entry::ptr entry)
 {
-    return (state.pool.left.find(entry) != state.pool.left.end());
+    return state.exists(entry);
 }
 
 BOOST_AUTO_TEST_SUITE(anchor_converter_tests)
@@ -154,4 +154,57 @@ BOOST_AUTO_TEST_CASE(child_closure_calculator__get_closure__entry_with_descendan
     utilities::sever({ parent_entry, child1_entry, child2_entry, child3_entry });
 }
 
+BOOST_AUTO_TEST_CASE(child_closure_calculator__get_closure__repeated__returns_same_list)
+{
+    transaction_pool_state pool_state;
+    auto state = std::make_shared<chain_state>(
+        chain_state{ utilities::get_chain_data(), {}, 0, 0, bc::settings() });
+    auto parent_entry = utilities::get_entry(state, 1, 0);
+    auto child1_entry = utilities::get_entry(state, 2, 0);
+    auto child2_entry = utilities::get_entry(state, 3, 0);
+    utilities::connect(parent_entry, child1_entry, 0);
+    utilities::connect(child1_entry, child2_entry, 0);
+    child_closure_calculator calculator(pool_state);
+    const auto first = calculator.get_closure(parent_entry);
+    const auto second = calculator.get_closure(parent_entry);
+    BOOST_REQUIRE_EQUAL(second.size(), 2u);
+    BOOST_REQUIRE(utilities::unordered_entries_equal(first, second));
+
+    // cleanup
+    utilities::sever({ parent_entry, child1_entry, child2_entry });
+}
+
+BOOST_AUTO_TEST_CASE(child_closure_calculator__get_closure__cached_anchor_descendant_pooled_and_erased__returns_updated_list)
+{
+    transaction_pool_state pool_state;
+    auto state = std::make_shared<chain_state>(
+        chain_state{ utilities::get_chain_data(), {}, 0, 0, bc::settings() });
+    auto anchor = utilities::get_entry(state, 1, 0);
+    auto child1_entry = utilities::get_entry(state, 2, 0);
+    auto child2_entry = utilities::get_entry(state, 3, 0);
+    utilities::connect(anchor, child1_entry, 0);
+    pool_state.insert(anchor, 0.0);
+    pool_state.insert(child1_entry, 1.0);
+
+    // populate cache
+    pool_state.cached_child_closures.insert({ anchor, { child1_entry } });
+
+    utilities::connect(child1_entry, child2_entry, 0);
+    pool_state.insert(child2_entry, 1.0);
+    BOOST_REQUIRE(utilities::ordered_entries_equal(
+        pool_state.cached_child_closures[anchor], { child1_entry, child2_entry }));
+
+    child_closure_calculator calculator(pool_state);
+    auto result = calculator.get_closure(anchor);
+    BOOST_REQUIRE(utilities::unordered_entries_equal(result, { child1_entry, child2_entry }));
+
+    pool_state.erase(child2_entry);
+    result = calculator.get_closure(anchor);
+    BOOST_REQUIRE_EQUAL(result.size(), 1u);
+    BOOST_REQUIRE(result.front() == child1_entry);
+
+    // cleanup
+    utilities::sever({ anchor, child1_entry, child2_entry });
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -28,16 +28,14 @@ using namespace bc::blockchain::test::pools;
 static void insert_pool(transaction_pool_state& state,
     transaction_entry::ptr entry, transaction_pool_state::priority value)
 {
-    state.pool.insert({ entry, value });
+    state.insert(entry, value);
 }
 
 static void insert_block_template(transaction_pool_state& state,
     transaction_entry::ptr entry, transaction_pool_state::priority value)
 {
-    state.pool.insert({ entry, value });
-    state.block_template.insert({ entry, value });
-    state.block_template_bytes += entry->size();
-    state.block_template_sigops += entry->sigops();
+    state.insert(entry, value);
+    state.select(entry);
 }
 
 BOOST_AUTO_TEST_SUITE(conflicting_spend_remover_tests)
@@ -151,4 +149,52 @@ BOOST_AUTO_TEST_CASE(conflicting_spend_remover__deconflict__entry_with_descendan
 
 }
 
+BOOST_AUTO_TEST_CASE(conflicting_spend_remover__deconflict__diamond_descendant__ancestor_sums_exclude_each_removal_once)
+{
+    auto state = std::make_shared<chain_state>(
+        chain_state{ utilities::get_chain_data(), {}, 0, 0, bc::settings() });
+    transaction_pool_state pool_state;
+    conflicting_spend_remover remover(pool_state);
+    auto anchor = utilities::get_entry(state, 1, 0);
+    auto root = utilities::get_fee_entry(state, 2, 0, 100);
+    auto left = utilities::get_fee_entry(state, 3, 0, 200);
+    auto right = utilities::get_fee_entry(state, 4, 0, 300);
+    auto bottom = utilities::get_fee_entry(state, 5, 0, 400);
+    utilities::connect(anchor, root, 0);
+    utilities::connect(root, left, 0);
+    utilities::connect(root, right, 1);
+    utilities::connect(left, bottom, 0);
+    utilities::connect(right, bottom, 0);
+    insert_pool(pool_state, anchor, 0.5);
+    insert_pool(pool_state, root, 0.5);
+    insert_pool(pool_state, left, 0.5);
+    insert_pool(pool_state, right, 0.5);
+    insert_pool(pool_state, bottom, 0.5);
+
+    // The bottom is a descendant of the root by two paths, counted once.
+    const auto pooled_root = pool_state.pool.find(root);
+    BOOST_REQUIRE(pooled_root != pool_state.pool.end());
+    BOOST_REQUIRE_EQUAL(pooled_root->descendant_fees, root->fees() +
+        left->fees() + right->fees() + bottom->fees());
+
+    // Removing the left takes the bottom, which is removed from the root
+    // once, though the root remains its ancestor through the right.
+    remover.enqueue(left);
+    remover.deconflict();
+    BOOST_REQUIRE(!pool_state.exists(left));
+    BOOST_REQUIRE(!pool_state.exists(bottom));
+
+    const auto remaining_root = pool_state.pool.find(root);
+    const auto remaining_right = pool_state.pool.find(right);
+    BOOST_REQUIRE(remaining_root != pool_state.pool.end());
+    BOOST_REQUIRE(remaining_right != pool_state.pool.end());
+    BOOST_REQUIRE_EQUAL(remaining_root->descendant_fees, root->fees() +
+        right->fees());
+    BOOST_REQUIRE_EQUAL(remaining_root->descendant_bytes, root->size() +
+        right->size());
+    BOOST_REQUIRE_EQUAL(remaining_right->descendant_fees, right->fees());
+    BOOST_REQUIRE_EQUAL(remaining_right->descendant_bytes, right->size());
+    utilities::sever({ anchor, root, left, right, bottom });
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,56 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <bitcoin/blockchain.hpp>
+
+using namespace bc;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(populate_block_tests)
+
+// Access to protected members.
+class populate_block_fixture
+  : public populate_block
+{
+public:
+    using populate_block::is_next_confirmed;
+};
+
+BOOST_AUTO_TEST_CASE(populate_block__is_next_confirmed__fork_at_confirmed_top__true)
+{
+    // Confirmed top and fork point at 41.
+    BOOST_REQUIRE(populate_block_fixture::is_next_confirmed(42, 41, 42));
+}
+
+BOOST_AUTO_TEST_CASE(populate_block__is_next_confirmed__confirmed_above_fork__false)
+{
+    // Fork point at 41, below the confirmed top at 43, so the pool prevouts
+    // may be created by confirmed blocks that are not ancestors of the block.
+    BOOST_REQUIRE(!populate_block_fixture::is_next_confirmed(42, 41, 44));
+}
+
+BOOST_AUTO_TEST_CASE(populate_block__is_next_confirmed__above_fork_successor__false)
+{
+    // Confirmed top and fork point at 41, block two above it.
+    BOOST_REQUIRE(!populate_block_fixture::is_next_confirmed(43, 41, 42));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,133 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <bitcoin/blockchain.hpp>
+
+using namespace bc;
+using namespace bc::chain;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(script_cache_tests)
+
+static transaction make_transaction(uint32_t locktime)
+{
+    return transaction(1, locktime, input::list(2), {});
+}
+
+BOOST_AUTO_TEST_CASE(script_cache__construct__capacity__empty)
+{
+    script_cache instance(42);
+    BOOST_REQUIRE_EQUAL(instance.capacity(), 42u);
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(script_cache__exists__added__true)
+{
+    script_cache instance(10);
+    const auto tx = make_transaction(0);
+    instance.add(tx, 1, 0x0f);
+    BOOST_REQUIRE(instance.exists(tx, 1, 0x0f));
+    BOOST_REQUIRE_EQUAL(instance.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(script_cache__exists__other_index__false)
+{
+    script_cache instance(10);
+    const auto tx = make_transaction(0);
+    instance.add(tx, 1, 0x0f);
+    BOOST_REQUIRE(!instance.exists(tx, 0, 0x0f));
+}
+
+BOOST_AUTO_TEST_CASE(script_cache__exists__other_forks__false)
+{
+    script_cache instance(10);
+    const auto tx = make_transaction(0);
+    instance.add(tx, 1, 0x0f);
+    BOOST_REQUIRE(!instance.exists(tx, 1, 0x1f));
+}
+
+BOOST_AUTO_TEST_CASE(script_cache__exists__other_transaction__false)
+{
+    script_cache instance(10);
+    instance.add(make_transaction(0), 1, 0x0f);
+    BOOST_REQUIRE(!instance.exists(make_transaction(1), 1, 0x0f));
+}
+
+BOOST_AUTO_TEST_CASE(script_cache__add__zero_capacity__disabled)
+{
+    script_cache instance(0);
+    const auto tx = make_transaction(0);
+    instance.add(tx, 0, 0);
+    BOOST_REQUIRE(!instance.exists(tx, 0, 0));
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(script_cache__add__duplicate__single_entry)
+{
+    script_cache instance(10);
+    const auto tx = make_transaction(0);
+    instance.add(tx, 0, 0);
+    instance.add(tx, 0, 0);
+    BOOST_REQUIRE_EQUAL(instance.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(script_cache__add__full_shard__evicts_oldest)
+{
+    // A capacity of one allows one entry per shard.
+    script_cache instance(1);
+    const auto tx = make_transaction(0);
+    instance.add(tx, 0, 0);
+    instance.add(tx, 1, 0);
+    BOOST_REQUIRE(!instance.exists(tx, 0, 0));
+    BOOST_REQUIRE(instance.exists(tx, 1, 0));
+}
+
+BOOST_AUTO_TEST_CASE(script_cache__clear__added__empty)
+{
+    script_cache instance(10);
+    const auto tx = make_transaction(0);
+    instance.add(tx, 0, 0);
+    instance.clear();
+    BOOST_REQUIRE(!instance.exists(tx, 0, 0));
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(script_cache__signature_operations__repeated__counted)
+{
+    script_cache instance(10);
+    auto tx = make_transaction(0);
+    const output prevout(1, script({ { machine::opcode::checksig } }));
+    tx.inputs()[0].previous_output().metadata.cache = prevout;
+    tx.inputs()[1].previous_output().metadata.cache = prevout;
+    const auto expected = tx.signature_operations(true, true);
+    BOOST_REQUIRE_EQUAL(instance.signature_operations(tx, true, true), expected);
+    BOOST_REQUIRE_EQUAL(instance.signature_operations(tx, true, true), expected);
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(script_cache__signature_operations__missing_prevouts__counted)
+{
+    script_cache instance(10);
+    const auto tx = make_transaction(0);
+    const auto expected = tx.signature_operations(true, false);
+    BOOST_REQUIRE_EQUAL(instance.signature_operations(tx, true, false), expected);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
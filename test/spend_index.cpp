@@ -0,0 +1,221 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <boost/filesystem.hpp>
+#include <bitcoin/blockchain.hpp>
+#include "utility.hpp"
+
+using namespace bc;
+using namespace bc::blockchain;
+using namespace bc::chain;
+
+BOOST_AUTO_TEST_SUITE(spend_index_tests)
+
+static boost::filesystem::path make_file()
+{
+    const boost::filesystem::path file(TEST_NAME + ".spends");
+    boost::filesystem::remove(file);
+    return file;
+}
+
+// The block spends the given outpoints from one tx, above the previous block.
+// The tx is linked as if stored at the nonce.
+static block make_block(const block& previous, uint32_t nonce,
+    const output_point::list& prevouts)
+{
+    header header;
+    header.set_previous_block_hash(previous.hash());
+    header.set_nonce(nonce);
+
+    input::list inputs;
+    for (const auto& prevout: prevouts)
+        inputs.push_back(input{ output_point{ prevout }, {}, nonce });
+
+    transaction tx;
+    tx.set_inputs(inputs);
+    tx.set_outputs({ output{ 1, script{ data_chunk{ 0x51 }, false } } });
+    tx.metadata.link = nonce;
+
+    const auto genesis = block::genesis_mainnet();
+    return block{ header, { genesis.transactions().front(), tx } };
+}
+
+BOOST_AUTO_TEST_CASE(spend_index__start__new_file__empty)
+{
+    size_t height;
+    hash_digest hash;
+    spend_index instance(make_file());
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+    BOOST_REQUIRE(!instance.top(height, hash));
+}
+
+BOOST_AUTO_TEST_CASE(spend_index__push__not_contiguous__false)
+{
+    spend_index instance(make_file());
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE(!instance.push(block::genesis_mainnet(), 1));
+    BOOST_REQUIRE(!instance.push(block::genesis_mainnet(), 0));
+}
+
+BOOST_AUTO_TEST_CASE(spend_index__get__pushed__spender)
+{
+    const auto genesis = block::genesis_mainnet();
+    const output_point first{ genesis.transactions().front().hash(), 0 };
+    const output_point second{ first.hash(), 1 };
+    const auto next = make_block(genesis, 1, { first, second });
+
+    spend_index instance(make_file());
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE(instance.push(genesis, 0));
+    BOOST_REQUIRE(instance.push(next, 1));
+    BOOST_REQUIRE_EQUAL(instance.size(), 2u);
+
+    const auto spenders = instance.get(second);
+    BOOST_REQUIRE_EQUAL(spenders.size(), 1u);
+    BOOST_REQUIRE_EQUAL(spenders.front().link, 1u);
+    BOOST_REQUIRE_EQUAL(spenders.front().index, 1u);
+    BOOST_REQUIRE(instance.get({ first.hash(), 2 }).empty());
+
+    size_t height;
+    hash_digest hash;
+    BOOST_REQUIRE(instance.top(height, hash));
+    BOOST_REQUIRE_EQUAL(height, 1u);
+    BOOST_REQUIRE(hash == next.hash());
+}
+
+BOOST_AUTO_TEST_CASE(spend_index__push__unlinked__false)
+{
+    const auto genesis = block::genesis_mainnet();
+    const output_point prevout{ genesis.transactions().front().hash(), 0 };
+    const auto next = make_block(genesis, 1, { prevout });
+    next.transactions().back().metadata.link =
+        transaction::validation::unlinked;
+
+    spend_index instance(make_file());
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE(instance.push(genesis, 0));
+    BOOST_REQUIRE(!instance.push(next, 1));
+}
+
+BOOST_AUTO_TEST_CASE(spend_index__pop__top__spends_removed)
+{
+    const auto genesis = block::genesis_mainnet();
+    const output_point prevout{ genesis.transactions().front().hash(), 0 };
+    const auto next = make_block(genesis, 1, { prevout });
+
+    spend_index instance(make_file());
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE(instance.push(genesis, 0));
+    BOOST_REQUIRE(instance.push(next, 1));
+    BOOST_REQUIRE(instance.pop(next, 1));
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+    BOOST_REQUIRE(instance.get(prevout).empty());
+
+    size_t height;
+    hash_digest hash;
+    BOOST_REQUIRE(instance.top(height, hash));
+    BOOST_REQUIRE_EQUAL(height, 0u);
+    BOOST_REQUIRE(hash == genesis.hash());
+}
+
+BOOST_AUTO_TEST_CASE(spend_index__pop__not_top__false)
+{
+    const auto genesis = block::genesis_mainnet();
+    const output_point prevout{ genesis.transactions().front().hash(), 0 };
+    const auto next = make_block(genesis, 1, { prevout });
+
+    spend_index instance(make_file());
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE(instance.push(genesis, 0));
+    BOOST_REQUIRE(!instance.pop(next, 1));
+
+    // A failed update fails subsequent updates until cleared.
+    BOOST_REQUIRE(!instance.push(next, 1));
+    BOOST_REQUIRE(instance.clear());
+    BOOST_REQUIRE(instance.push(genesis, 0));
+}
+
+BOOST_AUTO_TEST_CASE(spend_index__start__clean_stop__persisted)
+{
+    const auto file = make_file();
+    const auto genesis = block::genesis_mainnet();
+    const output_point prevout{ genesis.transactions().front().hash(), 0 };
+    const auto next = make_block(genesis, 1, { prevout });
+
+    {
+        spend_index instance(file);
+        BOOST_REQUIRE(instance.start());
+        BOOST_REQUIRE(instance.push(genesis, 0));
+        BOOST_REQUIRE(instance.push(next, 1));
+        instance.stop();
+    }
+
+    spend_index instance(file);
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE_EQUAL(instance.size(), 1u);
+    BOOST_REQUIRE_EQUAL(instance.get(prevout).size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(spend_index__start__not_stopped__committed_persisted)
+{
+    const auto file = make_file();
+    const auto genesis = block::genesis_mainnet();
+    const output_point prevout{ genesis.transactions().front().hash(), 0 };
+    const auto next = make_block(genesis, 1, { prevout });
+
+    {
+        spend_index instance(file);
+        BOOST_REQUIRE(instance.start());
+        BOOST_REQUIRE(instance.push(genesis, 0));
+        BOOST_REQUIRE(instance.push(next, 1));
+    }
+
+    size_t height;
+    hash_digest hash;
+    spend_index instance(file);
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE(instance.top(height, hash));
+    BOOST_REQUIRE_EQUAL(height, 1u);
+    BOOST_REQUIRE_EQUAL(instance.get(prevout).size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(spend_index__start__failed_update__cleared)
+{
+    const auto file = make_file();
+    const auto genesis = block::genesis_mainnet();
+
+    {
+        spend_index instance(file);
+        BOOST_REQUIRE(instance.start());
+        BOOST_REQUIRE(instance.push(genesis, 0));
+        BOOST_REQUIRE(!instance.push(genesis, 0));
+        instance.stop();
+    }
+
+    size_t height;
+    hash_digest hash;
+    spend_index instance(file);
+    BOOST_REQUIRE(instance.start());
+    BOOST_REQUIRE(!instance.top(height, hash));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
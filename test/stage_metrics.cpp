@@ -0,0 +1,195 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <bitcoin/blockchain.hpp>
+
+using namespace bc;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(stage_metrics_tests)
+
+BOOST_AUTO_TEST_CASE(latency_histogram__construct__always__empty)
+{
+    latency_histogram instance;
+    BOOST_REQUIRE_EQUAL(instance.count(), 0u);
+    BOOST_REQUIRE_EQUAL(instance.total(), 0u);
+    BOOST_REQUIRE_EQUAL(instance.maximum(), 0u);
+    BOOST_REQUIRE_EQUAL(instance.quantile(0.5), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(latency_histogram__bucket__small_values__exact)
+{
+    for (uint64_t value = 0; value < latency_histogram::sub_buckets; ++value)
+    {
+        const auto bucket = latency_histogram::bucket(value);
+        BOOST_REQUIRE_EQUAL(bucket, value);
+        BOOST_REQUIRE_EQUAL(latency_histogram::upper_bound(bucket), value);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(latency_histogram__bucket__large_values__bounded)
+{
+    for (uint64_t value = 8; value < 100000; value = value * 3 / 2 + 1)
+    {
+        const auto bucket = latency_histogram::bucket(value);
+        const auto upper = latency_histogram::upper_bound(bucket);
+        BOOST_REQUIRE(value <= upper);
+        BOOST_REQUIRE(latency_histogram::upper_bound(bucket - 1u) < value);
+        BOOST_REQUIRE(upper - value <= value / latency_histogram::sub_buckets);
+    }
+
+    BOOST_REQUIRE_EQUAL(latency_histogram::bucket(max_uint64),
+        latency_histogram::buckets - 1u);
+    BOOST_REQUIRE_EQUAL(latency_histogram::upper_bound(
+        latency_histogram::buckets - 1u), max_uint64);
+}
+
+BOOST_AUTO_TEST_CASE(latency_histogram__record__samples__expected_quantiles)
+{
+    latency_histogram instance;
+
+    for (uint64_t value = 1; value <= 100; ++value)
+        instance.record(value);
+
+    BOOST_REQUIRE_EQUAL(instance.count(), 100u);
+    BOOST_REQUIRE_EQUAL(instance.total(), 5050u);
+    BOOST_REQUIRE_EQUAL(instance.maximum(), 100u);
+    BOOST_REQUIRE_EQUAL(instance.quantile(0.0), 1u);
+    BOOST_REQUIRE_EQUAL(instance.quantile(1.0), 100u);
+
+    const auto median = instance.quantile(0.5);
+    BOOST_REQUIRE(median >= 50u && median <= 55u);
+}
+
+BOOST_AUTO_TEST_CASE(stage_metrics__record__stage__only_that_histogram)
+{
+    stage_metrics instance;
+    instance.record(stage_metrics::entity::block,
+        stage_metrics::stage::connect, asio::microseconds(42));
+
+    BOOST_REQUIRE_EQUAL(instance.histogram(stage_metrics::entity::block,
+        stage_metrics::stage::connect).count(), 1u);
+    BOOST_REQUIRE_EQUAL(instance.histogram(stage_metrics::entity::block,
+        stage_metrics::stage::connect).total(), 42u);
+    BOOST_REQUIRE_EQUAL(instance.histogram(stage_metrics::entity::block,
+        stage_metrics::stage::accept).count(), 0u);
+    BOOST_REQUIRE_EQUAL(instance.histogram(stage_metrics::entity::header,
+        stage_metrics::stage::connect).count(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(stage_metrics__record__negative_duration__zero)
+{
+    stage_metrics instance;
+    instance.record(stage_metrics::entity::transaction,
+        stage_metrics::stage::notify, -asio::microseconds(5));
+
+    BOOST_REQUIRE_EQUAL(instance.histogram(stage_metrics::entity::transaction,
+        stage_metrics::stage::notify).maximum(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(lock_metrics__acquired_released__site__only_that_site)
+{
+    lock_metrics instance;
+    const auto site = lock_metrics::site::header_organize;
+    const auto start = instance.waiting(site);
+    instance.acquired(site, start);
+    instance.released(site);
+
+    BOOST_REQUIRE_EQUAL(instance.wait(site).count(), 1u);
+    BOOST_REQUIRE_EQUAL(instance.hold(site).count(), 1u);
+    BOOST_REQUIRE_EQUAL(instance.wait(
+        lock_metrics::site::block_validate).count(), 0u);
+    BOOST_REQUIRE_EQUAL(instance.hold(
+        lock_metrics::site::transaction_store).count(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(lock_metrics__acquired__high_while_low_waits__overtaken)
+{
+    lock_metrics instance;
+    const auto low = lock_metrics::site::transaction_store;
+    const auto high = lock_metrics::site::block_validate;
+    const auto low_start = instance.waiting(low);
+
+    const auto high_start = instance.waiting(high);
+    instance.acquired(high, high_start);
+    instance.released(high);
+
+    const auto next_start = instance.waiting(high);
+    instance.acquired(high, next_start);
+    instance.released(high);
+
+    instance.acquired(low, low_start);
+    instance.released(low);
+
+    BOOST_REQUIRE_EQUAL(instance.overtaken(low), 2u);
+    BOOST_REQUIRE_EQUAL(instance.overtaken(high), 0u);
+    BOOST_REQUIRE_EQUAL(instance.wait(high).count(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(lock_metrics__acquired__low_without_waiters__not_overtaken)
+{
+    lock_metrics instance;
+    const auto low = lock_metrics::site::transaction_store;
+    const auto high = lock_metrics::site::header_flush;
+
+    const auto high_start = instance.waiting(high);
+    instance.acquired(high, high_start);
+    instance.released(high);
+
+    const auto low_start = instance.waiting(low);
+    instance.acquired(low, low_start);
+    instance.released(low);
+
+    BOOST_REQUIRE_EQUAL(instance.overtaken(low), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(lock_metrics__is_high_priority__transaction_store__false)
+{
+    BOOST_REQUIRE(!lock_metrics::is_high_priority(
+        lock_metrics::site::transaction_store));
+    BOOST_REQUIRE(lock_metrics::is_high_priority(
+        lock_metrics::site::block_validate));
+    BOOST_REQUIRE(lock_metrics::is_high_priority(
+        lock_metrics::site::chain_stop));
+}
+
+BOOST_AUTO_TEST_CASE(stage_metrics__preceding__cached_and_stored__counted)
+{
+    stage_metrics instance;
+    instance.preceding(true);
+    instance.preceding(true);
+    instance.preceding(false);
+
+    BOOST_REQUIRE_EQUAL(instance.cached_preceding(), 2u);
+    BOOST_REQUIRE_EQUAL(instance.stored_preceding(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(stage_metrics__locks__always__shared_instance)
+{
+    stage_metrics instance;
+    const auto site = lock_metrics::site::chain_stop;
+    instance.locks().acquired(site, instance.locks().waiting(site));
+    instance.locks().released(site);
+
+    const auto& view = instance;
+    BOOST_REQUIRE_EQUAL(view.locks().hold(site).count(), 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <bitcoin/blockchain.hpp>
+
+using namespace bc;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(state_pool_tests)
+
+BOOST_AUTO_TEST_CASE(state_pool__construct__always__empty)
+{
+    state_pool instance(4);
+    BOOST_REQUIRE_EQUAL(instance.capacity(), 0u);
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(state_pool__allocate__first__one_slab)
+{
+    state_pool instance(4);
+    const auto block = instance.allocate(100);
+    BOOST_REQUIRE(block != nullptr);
+    BOOST_REQUIRE_EQUAL(instance.capacity(), 4u);
+    BOOST_REQUIRE_EQUAL(instance.size(), 1u);
+    instance.deallocate(block, 100);
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(state_pool__allocate__deallocated__recycled)
+{
+    state_pool instance(4);
+    const auto block = instance.allocate(100);
+    instance.deallocate(block, 100);
+    BOOST_REQUIRE(instance.allocate(100) == block);
+    BOOST_REQUIRE_EQUAL(instance.capacity(), 4u);
+}
+
+BOOST_AUTO_TEST_CASE(state_pool__allocate__beyond_slab__second_slab)
+{
+    state_pool instance(2);
+    const auto block1 = instance.allocate(100);
+    const auto block2 = instance.allocate(100);
+    const auto block3 = instance.allocate(100);
+    BOOST_REQUIRE(block1 != block2);
+    BOOST_REQUIRE(block2 != block3);
+    BOOST_REQUIRE_EQUAL(instance.capacity(), 4u);
+    BOOST_REQUIRE_EQUAL(instance.size(), 3u);
+    instance.deallocate(block1, 100);
+    instance.deallocate(block2, 100);
+    instance.deallocate(block3, 100);
+}
+
+BOOST_AUTO_TEST_CASE(state_pool__allocate__other_size__not_pooled)
+{
+    state_pool instance(4);
+    const auto block1 = instance.allocate(100);
+    const auto block2 = instance.allocate(1000);
+    BOOST_REQUIRE_EQUAL(instance.size(), 1u);
+    instance.deallocate(block2, 1000);
+    instance.deallocate(block1, 100);
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(state_pool__allocate_shared__released__recycled)
+{
+    const auto pool = std::make_shared<state_pool>(4);
+    const state_allocator<uint64_t> allocator(pool);
+
+    auto value = std::allocate_shared<uint64_t>(allocator, 42u);
+    BOOST_REQUIRE_EQUAL(*value, 42u);
+    BOOST_REQUIRE_EQUAL(pool->size(), 1u);
+
+    value.reset();
+    BOOST_REQUIRE_EQUAL(pool->size(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,123 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <bitcoin/blockchain.hpp>
+
+using namespace bc;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(template_tree_tests)
+
+static const hash_digest coinbase{ { 42 } };
+
+static hash_list make_hashes(size_t count, uint32_t seed = 0)
+{
+    hash_list hashes;
+    hashes.reserve(count);
+
+    for (size_t index = 0; index < count; ++index)
+        hashes.push_back(bitcoin_hash(to_chunk(to_little_endian(
+            static_cast<uint32_t>(seed + index)))));
+
+    return hashes;
+}
+
+static hash_digest expected_root(const hash_list& hashes)
+{
+    hash_list leaves{ coinbase };
+    leaves.insert(leaves.end(), hashes.begin(), hashes.end());
+    return merkle_builder::serial_root(leaves);
+}
+
+BOOST_AUTO_TEST_CASE(template_tree__update__empty__coinbase_root)
+{
+    template_tree tree;
+    const auto branch = tree.update({});
+    BOOST_REQUIRE(branch.empty());
+    BOOST_REQUIRE(template_tree::root(coinbase, branch) == coinbase);
+    BOOST_REQUIRE_EQUAL(tree.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(template_tree__update__new__expected_root)
+{
+    for (size_t count = 1; count <= 17; ++count)
+    {
+        const auto hashes = make_hashes(count);
+        template_tree tree;
+        BOOST_REQUIRE(template_tree::root(coinbase, tree.update(hashes)) ==
+            expected_root(hashes));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(template_tree__update__unchanged__same_branch)
+{
+    template_tree tree;
+    const auto hashes = make_hashes(9);
+    const auto branch = tree.update(hashes);
+    BOOST_REQUIRE(tree.update(hashes) == branch);
+    BOOST_REQUIRE_EQUAL(branch.size(), 4u);
+}
+
+BOOST_AUTO_TEST_CASE(template_tree__update__appended__expected_root)
+{
+    template_tree tree;
+    auto hashes = make_hashes(5);
+    tree.update(hashes);
+
+    for (const auto& hash: make_hashes(20, 100))
+    {
+        hashes.push_back(hash);
+        BOOST_REQUIRE(template_tree::root(coinbase, tree.update(hashes)) ==
+            expected_root(hashes));
+    }
+
+    BOOST_REQUIRE_EQUAL(tree.size(), 25u);
+}
+
+BOOST_AUTO_TEST_CASE(template_tree__update__trimmed__expected_root)
+{
+    template_tree tree;
+    auto hashes = make_hashes(33);
+    tree.update(hashes);
+
+    while (!hashes.empty())
+    {
+        hashes.pop_back();
+        BOOST_REQUIRE(template_tree::root(coinbase, tree.update(hashes)) ==
+            expected_root(hashes));
+    }
+
+    BOOST_REQUIRE_EQUAL(tree.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(template_tree__update__replaced__expected_root)
+{
+    template_tree tree;
+    auto hashes = make_hashes(12);
+    tree.update(hashes);
+    hashes[0] = make_hashes(1, 500).front();
+    hashes.resize(7);
+    BOOST_REQUIRE(template_tree::root(coinbase, tree.update(hashes)) ==
+        expected_root(hashes));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,138 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <bitcoin/blockchain.hpp>
+
+using namespace bc;
+using namespace bc::chain;
+using namespace bc::blockchain;
+using namespace bc::machine;
+
+BOOST_AUTO_TEST_SUITE(template_verifier_tests)
+
+static const auto forks = static_cast<uint32_t>(rule_fork::all_rules);
+static const uint64_t value = 1000;
+static const ec_secret secret = base16_literal(
+    "8010b1bb119ad37d4b65a1022a314897b1b3614b345974332cb1b9582cf03536");
+
+static data_chunk public_key()
+{
+    ec_compressed point;
+    BOOST_REQUIRE(secret_to_public(point, secret));
+    return to_chunk(point);
+}
+
+static transaction make_spend(const script& prevout_script)
+{
+    transaction tx;
+    tx.set_version(1);
+    tx.set_inputs({ { { null_hash, 0 }, {}, max_input_sequence } });
+    tx.set_outputs({ { value, prevout_script } });
+    tx.inputs()[0].previous_output().metadata.cache =
+        output(value, prevout_script);
+    return tx;
+}
+
+static endorsement sign(const transaction& tx, const script& script_code,
+    script_version version)
+{
+    endorsement out;
+    BOOST_REQUIRE(script::create_endorsement(out, secret, script_code, tx, 0,
+        sighash_algorithm::all, version, value));
+    return out;
+}
+
+BOOST_AUTO_TEST_CASE(template_verifier__verify__pay_key_hash__generic_success)
+{
+    const auto key = public_key();
+    const script prevout(script::to_pay_key_hash_pattern(
+        bitcoin_short_hash(key)));
+    auto tx = make_spend(prevout);
+    const auto endorsement = sign(tx, prevout, script_version::unversioned);
+    tx.inputs()[0].set_script(script({ { endorsement }, { key } }));
+
+    BOOST_REQUIRE(template_verifier::verify(tx, 0, forks));
+    BOOST_REQUIRE_EQUAL(script::verify(tx, 0, forks).value(), error::success);
+}
+
+BOOST_AUTO_TEST_CASE(template_verifier__verify__pay_key_hash_other_key__false)
+{
+    const auto key = public_key();
+    const script prevout(script::to_pay_key_hash_pattern(
+        bitcoin_short_hash(data_chunk{ 42 })));
+    auto tx = make_spend(prevout);
+    const auto endorsement = sign(tx, prevout, script_version::unversioned);
+    tx.inputs()[0].set_script(script({ { endorsement }, { key } }));
+
+    BOOST_REQUIRE(!template_verifier::verify(tx, 0, forks));
+    BOOST_REQUIRE(script::verify(tx, 0, forks));
+}
+
+BOOST_AUTO_TEST_CASE(template_verifier__verify__pay_key_hash_tampered__false)
+{
+    const auto key = public_key();
+    const script prevout(script::to_pay_key_hash_pattern(
+        bitcoin_short_hash(key)));
+    auto tx = make_spend(prevout);
+    const auto endorsement = sign(tx, prevout, script_version::unversioned);
+    tx.inputs()[0].set_script(script({ { endorsement }, { key } }));
+    tx.inputs()[0].set_sequence(42);
+
+    BOOST_REQUIRE(!template_verifier::verify(tx, 0, forks));
+    BOOST_REQUIRE(script::verify(tx, 0, forks));
+}
+
+BOOST_AUTO_TEST_CASE(template_verifier__verify__witness_key_hash__generic_success)
+{
+    const auto key = public_key();
+    const auto hash = bitcoin_short_hash(key);
+    const script prevout({ { opcode::push_size_0 }, { to_chunk(hash) } });
+    const script script_code(script::to_pay_key_hash_pattern(hash));
+    auto tx = make_spend(prevout);
+    const auto endorsement = sign(tx, script_code, script_version::zero);
+    tx.inputs()[0].set_witness(witness(data_stack{ endorsement, key }));
+
+    BOOST_REQUIRE(template_verifier::verify(tx, 0, forks));
+    BOOST_REQUIRE_EQUAL(script::verify(tx, 0, forks).value(), error::success);
+}
+
+BOOST_AUTO_TEST_CASE(template_verifier__verify__witness_key_hash_without_bip141__false)
+{
+    const auto key = public_key();
+    const auto hash = bitcoin_short_hash(key);
+    const script prevout({ { opcode::push_size_0 }, { to_chunk(hash) } });
+    const script script_code(script::to_pay_key_hash_pattern(hash));
+    auto tx = make_spend(prevout);
+    const auto endorsement = sign(tx, script_code, script_version::zero);
+    tx.inputs()[0].set_witness(witness(data_stack{ endorsement, key }));
+    const auto legacy = forks & ~static_cast<uint32_t>(rule_fork::bip141_rule);
+
+    BOOST_REQUIRE(!template_verifier::verify(tx, 0, legacy));
+}
+
+BOOST_AUTO_TEST_CASE(template_verifier__verify__non_template__false)
+{
+    const script prevout({ { opcode::push_positive_1 } });
+    const auto tx = make_spend(prevout);
+
+    BOOST_REQUIRE(!template_verifier::verify(tx, 0, forks));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,62 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <bitcoin/blockchain.hpp>
+
+using namespace bc;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(thread_binder_tests)
+
+BOOST_AUTO_TEST_CASE(thread_binder__parse__ranges_and_singles__expected)
+{
+    const auto cpus = thread_binder::parse("0-2,5,8-9\n");
+    const thread_binder::cpus expected{ 0, 1, 2, 5, 8, 9 };
+    BOOST_REQUIRE(cpus == expected);
+}
+
+BOOST_AUTO_TEST_CASE(thread_binder__parse__empty__empty)
+{
+    BOOST_REQUIRE(thread_binder::parse("").empty());
+}
+
+BOOST_AUTO_TEST_CASE(thread_binder__parse__invalid__empty)
+{
+    BOOST_REQUIRE(thread_binder::parse("0-x").empty());
+    BOOST_REQUIRE(thread_binder::parse("3-1").empty());
+}
+
+BOOST_AUTO_TEST_CASE(thread_binder__bind__empty_processors__false)
+{
+    BOOST_REQUIRE(!thread_binder::bind(thread_binder::cpus{}));
+}
+
+BOOST_AUTO_TEST_CASE(thread_binder__bind__pool__returns)
+{
+    threadpool pool(3);
+    const thread_binder::cpus none{};
+
+    // Each thread runs one binding, so this returns once all have run.
+    BOOST_REQUIRE(!thread_binder::bind(pool, none));
+    pool.shutdown();
+    pool.join();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <bitcoin/blockchain.hpp>
+#include "utility.hpp"
+
+using namespace bc;
+using namespace bc::chain;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(tip_snapshot_tests)
+
+static const hash_digest context{ { 42 } };
+
+static boost::filesystem::path make_file()
+{
+    const boost::filesystem::path file(TEST_NAME + ".tip_state");
+    boost::filesystem::remove(file);
+    return file;
+}
+
+static header make_header(uint32_t timestamp)
+{
+    return header{ 1, null_hash, null_hash, timestamp, 0x1d00ffff, 0 };
+}
+
+static tip_snapshot::tips make_tips()
+{
+    tip_snapshot::tips tips;
+    tips.candidate_top = { hash_digest{ { 1 } }, 12 };
+    tips.confirmed_top = { hash_digest{ { 2 } }, 11 };
+    tips.fork_point = { hash_digest{ { 2 } }, 11 };
+    tips.candidate_work = uint256_t(1) << 200;
+    tips.confirmed_work = 42;
+    tips.top_candidate_state.height = 12;
+    tips.top_candidate_state.hash = tips.candidate_top.hash();
+    tips.top_candidate_state.bits.self = 0x1d00ffff;
+    tips.top_candidate_state.bits.ordered.push_back(0x1d00ffff);
+    tips.top_candidate_state.timestamp.ordered.push_back(7);
+    tips.top_valid_candidate_state = tips.top_candidate_state;
+    tips.next_confirmed_state = tips.top_candidate_state;
+    tips.next_confirmed_state.height = 11;
+    return tips;
+}
+
+BOOST_AUTO_TEST_CASE(tip_snapshot__load__missing__false)
+{
+    const tip_snapshot instance(make_file(), context);
+    tip_snapshot::tips tips;
+    header_window candidate(2);
+    header_window confirmed(2);
+    BOOST_REQUIRE(!instance.load(tips, candidate, confirmed));
+}
+
+BOOST_AUTO_TEST_CASE(tip_snapshot__load__saved__round_trip_and_removed)
+{
+    const auto file = make_file();
+    const tip_snapshot instance(file, context);
+    header_window candidate(2);
+    header_window confirmed(2);
+    candidate.reset(11);
+    candidate.push(make_header(1));
+    candidate.push(make_header(2));
+    confirmed.reset(11);
+    confirmed.push(make_header(1));
+    BOOST_REQUIRE(instance.save(make_tips(), candidate, confirmed));
+
+    tip_snapshot::tips tips;
+    header_window candidate_copy(2);
+    header_window confirmed_copy(2);
+    BOOST_REQUIRE(instance.load(tips, candidate_copy, confirmed_copy));
+    BOOST_REQUIRE(!boost::filesystem::exists(file));
+
+    const auto expected = make_tips();
+    BOOST_REQUIRE(tips.candidate_top == expected.candidate_top);
+    BOOST_REQUIRE(tips.confirmed_top == expected.confirmed_top);
+    BOOST_REQUIRE(tips.fork_point == expected.fork_point);
+    BOOST_REQUIRE(tips.candidate_work == expected.candidate_work);
+    BOOST_REQUIRE(tips.confirmed_work == expected.confirmed_work);
+    BOOST_REQUIRE_EQUAL(tips.top_candidate_state.height, 12u);
+    BOOST_REQUIRE_EQUAL(tips.next_confirmed_state.height, 11u);
+    BOOST_REQUIRE_EQUAL(tips.top_valid_candidate_state.bits.ordered.size(), 1u);
+    BOOST_REQUIRE_EQUAL(tips.top_valid_candidate_state.timestamp.ordered[0], 7u);
+
+    uint32_t timestamp;
+    BOOST_REQUIRE(candidate_copy.get_timestamp(timestamp, 12));
+    BOOST_REQUIRE_EQUAL(timestamp, 2u);
+    BOOST_REQUIRE(confirmed_copy.get_timestamp(timestamp, 11));
+    BOOST_REQUIRE(!confirmed_copy.get_timestamp(timestamp, 12));
+}
+
+BOOST_AUTO_TEST_CASE(tip_snapshot__load__other_context__false)
+{
+    const auto file = make_file();
+    header_window candidate(2);
+    header_window confirmed(2);
+    BOOST_REQUIRE(tip_snapshot(file, context).save(make_tips(), candidate,
+        confirmed));
+
+    tip_snapshot::tips tips;
+    const tip_snapshot instance(file, hash_digest{ { 43 } });
+    BOOST_REQUIRE(!instance.load(tips, candidate, confirmed));
+}
+
+BOOST_AUTO_TEST_CASE(tip_snapshot__load__corrupt__false)
+{
+    const auto file = make_file();
+    const tip_snapshot instance(file, context);
+    header_window candidate(2);
+    header_window confirmed(2);
+    BOOST_REQUIRE(instance.save(make_tips(), candidate, confirmed));
+
+    {
+        boost::filesystem::fstream out(file, std::ios::binary |
+            std::ios::in | std::ios::out);
+        out.seekp(10);
+        out.put('x');
+    }
+
+    tip_snapshot::tips tips;
+    BOOST_REQUIRE(!instance.load(tips, candidate, confirmed));
+    BOOST_REQUIRE(!boost::filesystem::exists(file));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
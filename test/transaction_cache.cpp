@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <bitcoin/blockchain.hpp>
+#include "utility.hpp"
+
+using namespace bc;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(transaction_cache_tests)
+
+static transaction_const_ptr make_tx(uint32_t lock_time)
+{
+    return std::make_shared<const message::transaction>(
+        chain::transaction{ 1, lock_time, {}, {} });
+}
+
+BOOST_AUTO_TEST_CASE(transaction_cache__construct__zero__disabled)
+{
+    transaction_cache instance(0);
+    BOOST_REQUIRE(instance.disabled());
+}
+
+BOOST_AUTO_TEST_CASE(transaction_cache__add__disabled__not_cached)
+{
+    transaction_cache instance(0);
+    instance.add(42, true, make_tx(0));
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+    BOOST_REQUIRE(!instance.get(42, true));
+}
+
+BOOST_AUTO_TEST_CASE(transaction_cache__get__added__same_tx)
+{
+    transaction_cache instance(1);
+    const auto tx = make_tx(0);
+    instance.add(42, true, tx);
+    BOOST_REQUIRE(instance.get(42, true) == tx);
+    BOOST_REQUIRE(!instance.get(43, true));
+}
+
+BOOST_AUTO_TEST_CASE(transaction_cache__get__other_witness__not_cached)
+{
+    transaction_cache instance(1);
+    instance.add(42, true, make_tx(0));
+    BOOST_REQUIRE(!instance.get(42, false));
+}
+
+BOOST_AUTO_TEST_CASE(transaction_cache__add__over_shard_size__oldest_evicted)
+{
+    // One shard of a megabyte holds a few thousand small txs.
+    transaction_cache instance(1, 1);
+
+    for (uint64_t link = 0; link < 10000; ++link)
+        instance.add(link, false, make_tx(0));
+
+    BOOST_REQUIRE_LT(instance.size(), 10000u);
+    BOOST_REQUIRE(!instance.get(0, false));
+    BOOST_REQUIRE(instance.get(9999, false));
+}
+
+BOOST_AUTO_TEST_CASE(transaction_cache__get__recently_used__retained)
+{
+    transaction_cache instance(1, 1);
+    instance.add(0, false, make_tx(0));
+
+    for (uint64_t link = 1; link < 10000; ++link)
+    {
+        instance.add(link, false, make_tx(0));
+        BOOST_REQUIRE(instance.get(0, false));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(transaction_cache__clear__added__not_cached)
+{
+    transaction_cache instance(1);
+    instance.add(42, true, make_tx(0));
+    instance.clear();
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+    BOOST_REQUIRE(!instance.get(42, true));
+}
+
+BOOST_AUTO_TEST_CASE(transaction_cache__hit_rate__one_of_two__half)
+{
+    transaction_cache instance(1);
+    instance.add(42, true, make_tx(0));
+    BOOST_REQUIRE(instance.get(42, true));
+    BOOST_REQUIRE(!instance.get(43, true));
+    BOOST_REQUIRE_EQUAL(instance.hit_rate(), 0.5f);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
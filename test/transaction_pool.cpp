@@ -18,13 +18,69 @@
  */
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
+#include <iterator>
+#include <vector>
 #include <bitcoin/blockchain.hpp>
 
 using namespace bc;
+using namespace bc::chain;
 using namespace bc::blockchain;
 
 BOOST_AUTO_TEST_SUITE(transaction_pool_tests)
 
+static chain_state::ptr state()
+{
+    chain_state::data value;
+    value.height = 1;
+    value.bits = { 0, { 0 } };
+    value.version = { 1, { 0 } };
+    value.timestamp = { 0, 0, { 0 } };
+    return std::make_shared<chain_state>(
+        chain_state{ std::move(value), {}, 0, 0, bc::settings() });
+}
+
+static const auto confirmed_hash = hash_literal(
+    "4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b");
+
+// The fee is the value of the single spent prevout (there are no outputs).
+// A prevout of confirmed_hash is confirmed, others are of pooled parents.
+static transaction_const_ptr make_tx(uint32_t version, const hash_digest& hash,
+    uint32_t index, uint64_t fee)
+{
+    input in;
+    output_point point{ hash, index };
+    point.metadata.cache.set_value(fee);
+    point.metadata.confirmed = (hash == confirmed_hash);
+    in.set_previous_output(point);
+    const auto tx = std::make_shared<const message::transaction>(
+        transaction{ version, 0, { in }, {} });
+    tx->metadata.state = state();
+    return tx;
+}
+
+static bool contains(const transaction_entry::list& entries,
+    transaction_const_ptr tx)
+{
+    return std::any_of(entries.begin(), entries.end(),
+        [&](const transaction_entry::ptr& entry)
+        {
+            return entry->hash() == tx->hash();
+        });
+}
+
+static size_t position(const transaction_entry::list& entries,
+    transaction_const_ptr tx)
+{
+    const auto it = std::find_if(entries.begin(), entries.end(),
+        [&](const transaction_entry::ptr& entry)
+        {
+            return entry->hash() == tx->hash();
+        });
+
+    return std::distance(entries.begin(), it);
+}
+
 BOOST_AUTO_TEST_CASE(transaction_pool__construct__foo__bar)
 {
     // TODO
@@ -33,13 +89,466 @@ BOOST_AUTO_TEST_CASE(transaction_pool__construct__foo__bar)
 BOOST_AUTO_TEST_CASE(transaction_pool__add_unconfirmed_transactions__empty_list__noop)
 {
     blockchain::settings blockchain_settings;
-    transaction_pool pool(blockchain_settings);
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
 
     transaction_const_ptr_list txs;
     pool.add_unconfirmed_transactions(txs);
     BOOST_REQUIRE_EQUAL(true, true);
 }
 
+BOOST_AUTO_TEST_CASE(transaction_pool__exists__added__true)
+{
+    blockchain::settings blockchain_settings;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+
+    const auto tx = make_tx(1, confirmed_hash, 0, 0);
+    BOOST_REQUIRE(!pool.exists(tx));
+    pool.add(tx);
+    BOOST_REQUIRE(pool.exists(tx));
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__filter__pooled__removed)
+{
+    blockchain::settings blockchain_settings;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+
+    const auto tx = make_tx(1, confirmed_hash, 0, 0);
+    pool.add(tx);
+
+    static const auto type = message::inventory_vector::type_id::transaction;
+    const auto other = hash_literal(
+        "4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b");
+    const auto message = std::make_shared<message::get_data>(
+        message::inventory_vector::list
+        {
+            { type, other },
+            { type, tx->hash() },
+            { message::inventory_vector::type_id::block, tx->hash() }
+        });
+
+    pool.filter(message);
+    const auto& inventories = message->inventories();
+    BOOST_REQUIRE_EQUAL(inventories.size(), 2u);
+    BOOST_REQUIRE(inventories[0].hash() == other);
+    BOOST_REQUIRE(inventories[1].is_block_type());
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__get_template__empty__empty)
+{
+    blockchain::settings blockchain_settings;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+    BOOST_REQUIRE(pool.get_template().empty());
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__add_unconfirmed_transactions__single__templated)
+{
+    blockchain::settings blockchain_settings;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+
+    const auto tx = make_tx(1, confirmed_hash, 0, 1000);
+    pool.add_unconfirmed_transactions({ tx });
+
+    const auto entries = pool.get_template();
+    BOOST_REQUIRE_EQUAL(entries.size(), 1u);
+    BOOST_REQUIRE(entries.front()->hash() == tx->hash());
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__add_unconfirmed_transactions__parent_child__parent_first)
+{
+    blockchain::settings blockchain_settings;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+
+    const auto parent = make_tx(1, confirmed_hash, 0, 10);
+    const auto child = make_tx(2, parent->hash(), 0, 10000);
+    pool.add_unconfirmed_transactions({ parent, child });
+
+    const auto entries = pool.get_template();
+    BOOST_REQUIRE_EQUAL(entries.size(), 2u);
+    BOOST_REQUIRE_LT(position(entries, parent), position(entries, child));
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__add_unconfirmed_transactions__full_higher_priority__evicts_lowest)
+{
+    blockchain::settings blockchain_settings;
+    blockchain_settings.block_bytes_limit = 1000 + 2 * 100;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+
+    const auto low = make_tx(1, confirmed_hash, 0, 100);
+    const auto middle = make_tx(2, confirmed_hash, 1, 200);
+    const auto high = make_tx(3, confirmed_hash, 2, 300);
+    pool.add_unconfirmed_transactions({ low, middle, high });
+
+    const auto entries = pool.get_template();
+    BOOST_REQUIRE_EQUAL(entries.size(), 2u);
+    BOOST_REQUIRE(!contains(entries, low));
+    BOOST_REQUIRE(contains(entries, middle));
+    BOOST_REQUIRE(contains(entries, high));
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__add_unconfirmed_transactions__full_lower_priority__unchanged)
+{
+    blockchain::settings blockchain_settings;
+    blockchain_settings.block_bytes_limit = 1000 + 100;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+
+    const auto high = make_tx(1, confirmed_hash, 0, 300);
+    const auto low = make_tx(2, confirmed_hash, 1, 100);
+    pool.add_unconfirmed_transactions({ high, low });
+
+    const auto entries = pool.get_template();
+    BOOST_REQUIRE_EQUAL(entries.size(), 1u);
+    BOOST_REQUIRE(contains(entries, high));
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__remove_transactions__confirmed__refills_template)
+{
+    blockchain::settings blockchain_settings;
+    blockchain_settings.block_bytes_limit = 1000 + 100;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+
+    const auto high = make_tx(1, confirmed_hash, 0, 300);
+    const auto low = make_tx(2, confirmed_hash, 1, 100);
+    pool.add_unconfirmed_transactions({ high, low });
+
+    transaction_const_ptr_list confirmed{ high };
+    pool.remove_transactions(confirmed);
+
+    const auto entries = pool.get_template();
+    BOOST_REQUIRE_EQUAL(entries.size(), 1u);
+    BOOST_REQUIRE(contains(entries, low));
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__remove_transactions__confirmed_parent__child_retained)
+{
+    blockchain::settings blockchain_settings;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+
+    const auto parent = make_tx(1, confirmed_hash, 0, 10);
+    const auto child = make_tx(2, parent->hash(), 0, 10000);
+    pool.add_unconfirmed_transactions({ parent, child });
+
+    transaction_const_ptr_list confirmed{ parent };
+    pool.remove_transactions(confirmed);
+
+    const auto entries = pool.get_template();
+    BOOST_REQUIRE_EQUAL(entries.size(), 1u);
+    BOOST_REQUIRE(contains(entries, child));
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__add_unconfirmed_transactions__unpooled_unconfirmed_parent__not_pooled)
+{
+    blockchain::settings blockchain_settings;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+
+    // The parent is neither pooled nor confirmed (as if evicted or popped).
+    const auto parent = make_tx(1, confirmed_hash, 0, 10);
+    const auto child = make_tx(2, parent->hash(), 0, 10000);
+    pool.add_unconfirmed_transactions({ child });
+
+    BOOST_REQUIRE(pool.get_template().empty());
+    BOOST_REQUIRE(pool.get_mempool().empty());
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__add__popped_anchor__descendants_evicted)
+{
+    blockchain::settings blockchain_settings;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+
+    const auto parent = make_tx(1, confirmed_hash, 0, 10);
+    const auto child = make_tx(2, parent->hash(), 0, 10000);
+    const auto other = make_tx(3, confirmed_hash, 1, 100);
+    pool.add_unconfirmed_transactions({ parent, child, other });
+
+    transaction_const_ptr_list confirmed{ parent };
+    pool.remove_transactions(confirmed);
+    BOOST_REQUIRE(contains(pool.get_template(), child));
+
+    // The parent is popped, so its child can no longer be templated.
+    pool.add(std::make_shared<const message::block>(
+        block{ header{}, { transaction{ 1, 0, {}, {} }, *parent } }));
+
+    const auto entries = pool.get_template();
+    BOOST_REQUIRE_EQUAL(entries.size(), 1u);
+    BOOST_REQUIRE(contains(entries, other));
+    BOOST_REQUIRE(!contains(pool.get_mempool(), child));
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__remove_transactions__conflict__removed)
+{
+    blockchain::settings blockchain_settings;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+
+    const auto pooled = make_tx(1, confirmed_hash, 0, 100);
+    const auto child = make_tx(2, pooled->hash(), 0, 100);
+    const auto other = make_tx(3, confirmed_hash, 1, 100);
+    pool.add_unconfirmed_transactions({ pooled, child, other });
+
+    transaction_const_ptr_list confirmed{ make_tx(4, confirmed_hash, 0, 100) };
+    pool.remove_transactions(confirmed);
+
+    const auto entries = pool.get_template();
+    BOOST_REQUIRE_EQUAL(entries.size(), 1u);
+    BOOST_REQUIRE(contains(entries, other));
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__get_mempool__parent_child__descending_rate_parent_first)
+{
+    blockchain::settings blockchain_settings;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+
+    const auto parent = make_tx(1, confirmed_hash, 0, 100);
+    const auto child = make_tx(2, parent->hash(), 0, 100000);
+    const auto other = make_tx(3, confirmed_hash, 1, 10000);
+    pool.add_unconfirmed_transactions({ parent, child, other });
+
+    const auto entries = pool.get_mempool();
+    BOOST_REQUIRE_EQUAL(entries.size(), 3u);
+    BOOST_REQUIRE_EQUAL(position(entries, other), 0u);
+    BOOST_REQUIRE_LT(position(entries, parent), position(entries, child));
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__fetch_mempool__count_limit__limited)
+{
+    blockchain::settings blockchain_settings;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+
+    const auto high = make_tx(1, confirmed_hash, 0, 20000);
+    const auto low = make_tx(2, confirmed_hash, 1, 10000);
+    pool.add_unconfirmed_transactions({ low, high });
+
+    pool.fetch_mempool(1, 0, [&](const code& ec, inventory_ptr inventory)
+    {
+        BOOST_REQUIRE_EQUAL(ec, error::success);
+        BOOST_REQUIRE_EQUAL(inventory->inventories().size(), 1u);
+        BOOST_REQUIRE(inventory->inventories().front().hash() == high->hash());
+    });
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__fetch_mempool__minimum_fee__excludes_lower_rates)
+{
+    blockchain::settings blockchain_settings;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+
+    // Rates of 200 and 100 satoshis per byte.
+    const auto high = make_tx(1, confirmed_hash, 0, 20000);
+    const auto low = make_tx(2, confirmed_hash, 1, 10000);
+    const auto child = make_tx(3, low->hash(), 0, 100000);
+    pool.add_unconfirmed_transactions({ low, high, child });
+
+    pool.fetch_mempool(10, 150000, [&](const code& ec, inventory_ptr inventory)
+    {
+        BOOST_REQUIRE_EQUAL(ec, error::success);
+        BOOST_REQUIRE_EQUAL(inventory->inventories().size(), 1u);
+        BOOST_REQUIRE(inventory->inventories().front().hash() == high->hash());
+    });
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__add_unconfirmed_transactions__over_budget__evicts_lowest_rates)
+{
+    blockchain::settings blockchain_settings;
+    blockchain_settings.transaction_pool_megabytes = 1;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+
+    // Each tx is a distinct version spending a distinct confirmed output.
+    static const uint32_t count = 5000;
+    transaction_const_ptr_list txs;
+    for (uint32_t index = 1; index <= count; ++index)
+        txs.push_back(make_tx(index, confirmed_hash, index, index * 100));
+
+    pool.add_unconfirmed_transactions(txs);
+
+    const auto entries = pool.get_mempool();
+    BOOST_REQUIRE_LT(entries.size(), count);
+    BOOST_REQUIRE(!contains(entries, txs.front()));
+    BOOST_REQUIRE(contains(entries, txs.back()));
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__add_unconfirmed_transactions__over_budget__retains_paying_descendants)
+{
+    blockchain::settings blockchain_settings;
+    blockchain_settings.transaction_pool_megabytes = 1;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+
+    // A zero fee parent is carried by its child above all other txs.
+    const auto parent = make_tx(1, confirmed_hash, 0, 0);
+    const auto child = make_tx(2, parent->hash(), 0, 10000000);
+    pool.add_unconfirmed_transactions({ parent, child });
+
+    static const uint32_t count = 5000;
+    transaction_const_ptr_list txs;
+    for (uint32_t index = 3; index <= count; ++index)
+        txs.push_back(make_tx(index, confirmed_hash, index, index * 100));
+
+    pool.add_unconfirmed_transactions(txs);
+
+    const auto entries = pool.get_mempool();
+    BOOST_REQUIRE(contains(entries, parent));
+    BOOST_REQUIRE(contains(entries, child));
+    BOOST_REQUIRE(!contains(entries, txs.front()));
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__to_mini_hash__short_id__round_trip)
+{
+    static const uint64_t short_id = 0x0000a1b2c3d4e5f6;
+    const auto id = transaction_pool::to_mini_hash(short_id);
+    BOOST_REQUIRE_EQUAL(id[0], 0xf6);
+    BOOST_REQUIRE_EQUAL(transaction_pool::to_short_id(id), short_id);
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__reconstruct__pooled__shared_and_missing_null)
+{
+    blockchain::settings blockchain_settings;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+
+    const auto pooled = make_tx(1, confirmed_hash, 0, 1000);
+    const auto missing = make_tx(2, confirmed_hash, 1, 1000);
+    pool.add_unconfirmed_transactions({ pooled });
+
+    const header header;
+    static const uint64_t nonce = 42;
+    const auto key = transaction_pool::to_short_id_key(header, nonce);
+    const message::compact_block block(header, nonce,
+    {
+        transaction_pool::to_mini_hash(transaction_pool::to_short_id(key,
+            missing->hash())),
+        transaction_pool::to_mini_hash(transaction_pool::to_short_id(key,
+            pooled->hash()))
+    },
+    {
+        { 0, transaction{ 3, 0, {}, {} } }
+    });
+
+    const auto txs = pool.reconstruct(block);
+    BOOST_REQUIRE_EQUAL(txs.size(), 3u);
+    BOOST_REQUIRE(txs[0]);
+    BOOST_REQUIRE_EQUAL(txs[0]->version(), 3u);
+    BOOST_REQUIRE(!txs[1]);
+    BOOST_REQUIRE(txs[2] == pooled);
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__reconstruct__prefilled_out_of_range__empty)
+{
+    blockchain::settings blockchain_settings;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+
+    const message::compact_block block(header{}, 0, {},
+    {
+        { 1, transaction{ 1, 0, {}, {} } }
+    });
+
+    BOOST_REQUIRE(pool.reconstruct(block).empty());
+}
+
+// The block copy of the pooled tx, with its prevout unpopulated.
+static block make_block(transaction_const_ptr tx)
+{
+    transaction copy(*tx);
+    auto& metadata = copy.inputs().front().previous_output().metadata;
+    metadata.confirmed = false;
+    metadata.height = 0;
+    metadata.cache = output{};
+    return block{ header{}, { transaction{ 1, 0, {}, {} }, copy } };
+}
+
+// The prevout is populated as confirmed at height 42.
+static transaction_const_ptr make_confirmed_tx(uint32_t index)
+{
+    const auto tx = make_tx(1, confirmed_hash, index, 1000);
+    auto& metadata = tx->inputs().front().previous_output().metadata;
+    metadata.confirmed = true;
+    metadata.height = 42;
+    return tx;
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__populate__confirmed_prevout__populated)
+{
+    blockchain::settings blockchain_settings;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+
+    const auto tx = make_confirmed_tx(0);
+    pool.add_unconfirmed_transactions({ tx });
+
+    const auto value = make_block(tx);
+    std::vector<bool> populated;
+    BOOST_REQUIRE_EQUAL(pool.populate(value, populated), 1u);
+    BOOST_REQUIRE_EQUAL(populated.size(), 1u);
+    BOOST_REQUIRE(populated.front());
+
+    const auto& tx_copy = value.transactions().back();
+    const auto& metadata = tx_copy.inputs().front().previous_output().metadata;
+    BOOST_REQUIRE(metadata.confirmed);
+    BOOST_REQUIRE_EQUAL(metadata.height, 42u);
+    BOOST_REQUIRE_EQUAL(metadata.cache.value(), 1000u);
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__populate__unconfirmed_prevout__unpopulated)
+{
+    blockchain::settings blockchain_settings;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+
+    const auto parent = make_tx(1, confirmed_hash, 0, 1000);
+    const auto tx = make_tx(2, parent->hash(), 0, 1000);
+    pool.add_unconfirmed_transactions({ parent, tx });
+
+    std::vector<bool> populated;
+    BOOST_REQUIRE_EQUAL(pool.populate(make_block(tx), populated), 0u);
+    BOOST_REQUIRE_EQUAL(populated.size(), 1u);
+    BOOST_REQUIRE(!populated.front());
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__populate__not_pooled__unpopulated)
+{
+    blockchain::settings blockchain_settings;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+
+    std::vector<bool> populated;
+    const auto value = make_block(make_confirmed_tx(0));
+    BOOST_REQUIRE_EQUAL(pool.populate(value, populated), 0u);
+    BOOST_REQUIRE(!populated.front());
+}
+
+BOOST_AUTO_TEST_CASE(transaction_pool__populate__popped_since_pooled__unpopulated)
+{
+    blockchain::settings blockchain_settings;
+    script_cache cache(0);
+    transaction_pool pool(blockchain_settings, cache);
+
+    const auto before = make_confirmed_tx(0);
+    pool.add_unconfirmed_transactions({ before });
+    pool.add(std::make_shared<const message::block>(
+        block{ header{}, { transaction{ 1, 0, {}, {} } } }));
+
+    const auto after = make_confirmed_tx(1);
+    pool.add_unconfirmed_transactions({ after });
+
+    std::vector<bool> populated;
+    BOOST_REQUIRE_EQUAL(pool.populate(make_block(before), populated), 0u);
+    BOOST_REQUIRE_EQUAL(pool.populate(make_block(after), populated), 1u);
+}
+
 ////BOOST_AUTO_TEST_CASE(transaction_pool__add_unconfirmed_transactions__empty_list__noop)
 ////{
 ////    settings blockchain_settings;
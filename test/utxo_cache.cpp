@@ -0,0 +1,182 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <utility>
+#include <bitcoin/blockchain.hpp>
+#include "utility.hpp"
+
+using namespace bc;
+using namespace bc::chain;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(utxo_cache_tests)
+
+static chain_state::data data(size_t height=1)
+{
+    chain_state::data value;
+    value.height = height;
+    value.bits = { 0, { 0 } };
+    value.version = { 1, { 0 } };
+    value.timestamp = { 0, 0, { 0 } };
+    return value;
+}
+
+static block_const_ptr make_block()
+{
+    const auto block = NEW_BLOCK(1);
+    block->header().metadata.state = std::make_shared<chain_state>(
+        chain_state{ data(), {}, 0, 0, bc::settings() });
+    return block;
+}
+
+static block_const_ptr make_spender(block_const_ptr parent,
+    const output_point& spent, size_t height=1)
+{
+    input in;
+    in.set_previous_output(spent);
+    transaction tx(1, 0, {}, {});
+    tx.set_inputs({ in });
+
+    transaction::list txs{ parent->transactions().front(), tx };
+    const auto block = std::make_shared<const message::block>(header{},
+        std::move(txs));
+    block->header().metadata.state = height == 1 ?
+        parent->header().metadata.state : std::make_shared<chain_state>(
+            chain_state{ data(height), {}, 0, 0, bc::settings() });
+    return block;
+}
+
+BOOST_AUTO_TEST_CASE(utxo_cache__construct__zero__disabled)
+{
+    utxo_cache instance(0);
+    BOOST_REQUIRE(instance.disabled());
+}
+
+BOOST_AUTO_TEST_CASE(utxo_cache__add__disabled__not_cached)
+{
+    utxo_cache instance(0);
+    const auto block = make_block();
+    instance.add(block);
+    const output_point point{ block->transactions().front().hash(), 0 };
+    BOOST_REQUIRE(!instance.populate(point, 0));
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(utxo_cache__populate__created__expected_metadata)
+{
+    utxo_cache instance(1);
+    const auto block = make_block();
+    instance.add(block);
+
+    const auto& coinbase = block->transactions().front();
+    const output_point point{ coinbase.hash(), 0 };
+    point.metadata.spent = true;
+    BOOST_REQUIRE(instance.populate(point, 0));
+
+    const auto& prevout = point.metadata;
+    const auto state = block->header().metadata.state;
+    BOOST_REQUIRE(!prevout.spent);
+    BOOST_REQUIRE(prevout.candidate);
+    BOOST_REQUIRE(!prevout.confirmed);
+    BOOST_REQUIRE(prevout.coinbase);
+    BOOST_REQUIRE_EQUAL(prevout.height, state->height());
+    BOOST_REQUIRE_EQUAL(prevout.median_time_past, state->median_time_past());
+    BOOST_REQUIRE(prevout.cache == coinbase.outputs().front());
+}
+
+BOOST_AUTO_TEST_CASE(utxo_cache__populate__at_fork_point__confirmed)
+{
+    utxo_cache instance(1);
+    const auto block = make_block();
+    instance.add(block);
+
+    const output_point point{ block->transactions().front().hash(), 0 };
+    BOOST_REQUIRE(instance.populate(point, 1));
+    BOOST_REQUIRE(point.metadata.confirmed);
+}
+
+BOOST_AUTO_TEST_CASE(utxo_cache__populate__spent__not_cached)
+{
+    utxo_cache instance(1);
+    const auto block = make_block();
+    const output_point point{ block->transactions().front().hash(), 0 };
+    instance.add(block);
+    instance.add(make_spender(block, point));
+    BOOST_REQUIRE(!instance.populate(point, 0));
+}
+
+BOOST_AUTO_TEST_CASE(utxo_cache__clear__added__not_cached)
+{
+    utxo_cache instance(1);
+    const auto block = make_block();
+    instance.add(block);
+    instance.clear();
+
+    const output_point point{ block->transactions().front().hash(), 0 };
+    BOOST_REQUIRE(!instance.populate(point, 0));
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(utxo_cache__disconnect__spender__spent_restored)
+{
+    utxo_cache instance(1);
+    const auto block = make_block();
+    const output_point point{ block->transactions().front().hash(), 0 };
+    instance.add(block);
+    instance.add(make_spender(block, point, 2));
+    BOOST_REQUIRE(instance.disconnect(1));
+    BOOST_REQUIRE(instance.populate(point, 0));
+}
+
+BOOST_AUTO_TEST_CASE(utxo_cache__disconnect__at_top__unchanged)
+{
+    utxo_cache instance(1);
+    const auto block = make_block();
+    const output_point point{ block->transactions().front().hash(), 0 };
+    instance.add(block);
+    instance.add(make_spender(block, point, 2));
+    BOOST_REQUIRE(instance.disconnect(2));
+    BOOST_REQUIRE(!instance.populate(point, 0));
+}
+
+BOOST_AUTO_TEST_CASE(utxo_cache__disconnect__pruned_record__false_cleared)
+{
+    utxo_cache instance(1, 1);
+    const auto block = make_block();
+    const output_point point{ block->transactions().front().hash(), 0 };
+    instance.add(block);
+    instance.add(make_spender(block, point, 2));
+    BOOST_REQUIRE(!instance.disconnect(0));
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(utxo_cache__hit_rate__one_of_two__half)
+{
+    utxo_cache instance(1);
+    const auto block = make_block();
+    instance.add(block);
+
+    const auto& hash = block->transactions().front().hash();
+    BOOST_REQUIRE(instance.populate({ hash, 0 }, 0));
+    BOOST_REQUIRE(!instance.populate({ hash, 1 }, 0));
+    BOOST_REQUIRE_EQUAL(instance.hit_rate(), 0.5f);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
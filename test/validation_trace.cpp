@@ -0,0 +1,176 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <bitcoin/blockchain.hpp>
+#include "utility.hpp"
+
+using namespace bc;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(validation_trace_tests)
+
+static constexpr size_t megabyte = 1024 * 1024;
+
+static boost::filesystem::path make_file()
+{
+    const boost::filesystem::path file(TEST_NAME + ".trace");
+    auto rotated = file;
+    rotated += ".1";
+    boost::filesystem::remove(file);
+    boost::filesystem::remove(rotated);
+    return file;
+}
+
+static validation_trace::record make_record(size_t height)
+{
+    validation_trace::record value{};
+    value.height = height;
+    value.hash = "00ff";
+    value.transactions = 3;
+    value.verified = 1;
+    value.internal = 1;
+    value.prevouts = 4;
+    value.store_reads = 2;
+    value.inputs = 4;
+    value.buckets = 2;
+    value.bucket_microseconds = { 10, 20 };
+    value.utilization = 0.75f;
+    value.imbalance = 1.5f;
+    value.cache_efficiency = 0.5f;
+    value.populate_microseconds = 5;
+    value.accept_microseconds = 6;
+    value.connect_microseconds = 7;
+    value.lock_microseconds = 8;
+    return value;
+}
+
+static size_t count_lines(const boost::filesystem::path& file)
+{
+    size_t lines = 0;
+    std::string line;
+    boost::filesystem::ifstream in(file);
+
+    while (std::getline(in, line))
+        ++lines;
+
+    return lines;
+}
+
+BOOST_AUTO_TEST_CASE(validation_trace__to_json__record__expected)
+{
+    BOOST_REQUIRE_EQUAL(validation_trace::to_json(make_record(42)),
+        "{\"height\":42,\"hash\":\"00ff\",\"error\":0,\"transactions\":3,"
+        "\"verified\":1,\"internal\":1,\"prevouts\":4,\"store_reads\":2,"
+        "\"inputs\":4,\"buckets\":2,\"bucket_us\":[10,20],"
+        "\"utilization\":0.75,\"imbalance\":1.5,\"cache_efficiency\":0.5,"
+        "\"populate_us\":5,\"accept_us\":6,\"connect_us\":7,\"lock_us\":8}");
+}
+
+BOOST_AUTO_TEST_CASE(validation_trace__to_json__no_buckets__empty_array)
+{
+    auto value = make_record(1);
+    value.bucket_microseconds.clear();
+    const auto json = validation_trace::to_json(value);
+    BOOST_REQUIRE(json.find("\"bucket_us\":[]") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(validation_trace__to_json__non_finite_ratios__zero)
+{
+    auto value = make_record(1);
+    value.utilization = std::numeric_limits<float>::quiet_NaN();
+    value.imbalance = std::numeric_limits<float>::infinity();
+    value.cache_efficiency = -std::numeric_limits<float>::infinity();
+    const auto json = validation_trace::to_json(value);
+    BOOST_REQUIRE(json.find("\"utilization\":0,\"imbalance\":0,"
+        "\"cache_efficiency\":0,") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(validation_trace__enabled__empty_file__false)
+{
+    validation_trace instance({}, 1);
+    BOOST_REQUIRE(!instance.enabled());
+}
+
+BOOST_AUTO_TEST_CASE(validation_trace__write__disabled__no_file)
+{
+    const auto file = make_file();
+    {
+        validation_trace instance({}, 1);
+        instance.write(make_record(1));
+    }
+
+    BOOST_REQUIRE(!boost::filesystem::exists(file));
+}
+
+BOOST_AUTO_TEST_CASE(validation_trace__write__records__one_line_each)
+{
+    const auto file = make_file();
+    {
+        validation_trace instance(file, 0);
+        BOOST_REQUIRE(instance.enabled());
+        instance.write(make_record(1));
+        instance.write(make_record(2));
+        instance.write(make_record(3));
+    }
+
+    BOOST_REQUIRE_EQUAL(count_lines(file), 3u);
+}
+
+BOOST_AUTO_TEST_CASE(validation_trace__write__reopened__appends)
+{
+    const auto file = make_file();
+    {
+        validation_trace instance(file, 0);
+        instance.write(make_record(1));
+    }
+    {
+        validation_trace instance(file, 0);
+        instance.write(make_record(2));
+    }
+
+    BOOST_REQUIRE_EQUAL(count_lines(file), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(validation_trace__write__limit_exceeded__rotates)
+{
+    const auto file = make_file();
+    auto rotated = file;
+    rotated += ".1";
+
+    const auto line = validation_trace::to_json(make_record(1)).size() + 1u;
+    const auto records = megabyte / line + 1u;
+    {
+        validation_trace instance(file, 1);
+
+        for (size_t record = 0; record < records; ++record)
+            instance.write(make_record(1));
+    }
+
+    BOOST_REQUIRE(boost::filesystem::exists(rotated));
+    BOOST_REQUIRE_EQUAL(count_lines(file), 1u);
+    BOOST_REQUIRE_EQUAL(count_lines(rotated), records - 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
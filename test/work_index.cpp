@@ -0,0 +1,101 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <bitcoin/blockchain.hpp>
+
+using namespace bc;
+using namespace bc::chain;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(work_index_tests)
+
+static const uint32_t bits1 = 0x1d00ffff;
+static const uint32_t bits2 = 0x1b0404cb;
+
+BOOST_AUTO_TEST_CASE(work_index__construct__always__empty_at_genesis)
+{
+    work_index instance;
+    BOOST_REQUIRE_EQUAL(instance.base(), 0u);
+    BOOST_REQUIRE_EQUAL(instance.top(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(work_index__reset__height__empty_at_height)
+{
+    work_index instance;
+    instance.push(bits1);
+    instance.reset(42);
+    BOOST_REQUIRE_EQUAL(instance.base(), 42u);
+    BOOST_REQUIRE_EQUAL(instance.top(), 42u);
+}
+
+BOOST_AUTO_TEST_CASE(work_index__work__pushed__expected)
+{
+    work_index instance;
+    instance.reset(10);
+    instance.push(bits1);
+    instance.push(bits2);
+    BOOST_REQUIRE_EQUAL(instance.top(), 12u);
+
+    uint256_t work;
+    BOOST_REQUIRE(instance.work(work, 10, 12));
+    BOOST_REQUIRE(work == header::proof(bits1) + header::proof(bits2));
+    BOOST_REQUIRE(instance.work(work, 11, 12));
+    BOOST_REQUIRE(work == header::proof(bits2));
+    BOOST_REQUIRE(instance.work(work, 12, 12));
+    BOOST_REQUIRE(work == 0);
+}
+
+BOOST_AUTO_TEST_CASE(work_index__work__out_of_range__false)
+{
+    work_index instance;
+    instance.reset(10);
+    instance.push(bits1);
+
+    uint256_t work;
+    BOOST_REQUIRE(!instance.work(work, 9, 11));
+    BOOST_REQUIRE(!instance.work(work, 10, 12));
+    BOOST_REQUIRE(!instance.work(work, 11, 10));
+}
+
+BOOST_AUTO_TEST_CASE(work_index__pop__above_base__truncated)
+{
+    work_index instance;
+    instance.reset(10);
+    instance.push(bits1);
+    instance.push(bits2);
+    instance.pop(11);
+    BOOST_REQUIRE_EQUAL(instance.top(), 11u);
+
+    uint256_t work;
+    BOOST_REQUIRE(instance.work(work, 10, 11));
+    BOOST_REQUIRE(work == header::proof(bits1));
+}
+
+BOOST_AUTO_TEST_CASE(work_index__pop__below_base__reset_at_height)
+{
+    work_index instance;
+    instance.reset(10);
+    instance.push(bits1);
+    instance.pop(5);
+    BOOST_REQUIRE_EQUAL(instance.base(), 5u);
+    BOOST_REQUIRE_EQUAL(instance.top(), 5u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
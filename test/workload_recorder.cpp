@@ -0,0 +1,226 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <bitcoin/blockchain.hpp>
+#include "utility.hpp"
+
+using namespace bc;
+using namespace bc::blockchain;
+
+BOOST_AUTO_TEST_SUITE(workload_recorder_tests)
+
+typedef workload_recorder::entity entity;
+
+static const config::checkpoint confirmed{ null_hash, 0 };
+static const config::checkpoint candidate{ null_hash, 1 };
+
+static boost::filesystem::path make_rotation(
+    const boost::filesystem::path& file, const std::string& suffix)
+{
+    auto rotated = file;
+    rotated += suffix;
+    return rotated;
+}
+
+static boost::filesystem::path make_file()
+{
+    const boost::filesystem::path file(TEST_NAME + ".workload");
+    boost::filesystem::remove(file);
+    boost::filesystem::remove(make_rotation(file, ".1"));
+    boost::filesystem::remove(make_rotation(file, ".2"));
+    return file;
+}
+
+static header_const_ptr make_header(uint32_t nonce)
+{
+    return std::make_shared<const message::header>(chain::header(1,
+        null_hash, null_hash, 42, 0x207fffff, nonce));
+}
+
+static size_t count_records(const boost::filesystem::path& file)
+{
+    size_t records = 0;
+    config::checkpoint start_confirmed;
+    config::checkpoint start_candidate;
+    workload_recorder::record value;
+    boost::filesystem::ifstream stream(file, std::ios::binary);
+    istream_reader source(stream);
+
+    if (!workload_recorder::read_start(start_confirmed, start_candidate,
+        source))
+        return 0;
+
+    while (workload_recorder::read(value, source))
+        ++records;
+
+    return records;
+}
+
+BOOST_AUTO_TEST_CASE(workload_recorder__enabled__empty_file__false)
+{
+    workload_recorder instance({}, 1);
+    BOOST_REQUIRE(!instance.enabled());
+}
+
+BOOST_AUTO_TEST_CASE(workload_recorder__read__written_block__round_trips)
+{
+    const workload_recorder::record expected{ entity::block, 1234, 42,
+        { 0x01, 0x02, 0x03 } };
+
+    data_chunk data;
+    data_sink ostream(data);
+    ostream_writer sink(ostream);
+    workload_recorder::write(sink, expected);
+    ostream.flush();
+
+    workload_recorder::record value;
+    data_source istream(data);
+    istream_reader source(istream);
+    BOOST_REQUIRE(workload_recorder::read(value, source));
+    BOOST_REQUIRE(value.type == entity::block);
+    BOOST_REQUIRE_EQUAL(value.microseconds, 1234u);
+    BOOST_REQUIRE_EQUAL(value.height, 42u);
+    BOOST_REQUIRE(value.payload == expected.payload);
+    BOOST_REQUIRE(!workload_recorder::read(value, source));
+}
+
+BOOST_AUTO_TEST_CASE(workload_recorder__read__partial_record__false)
+{
+    const workload_recorder::record expected{ entity::transaction, 0, 0,
+        { 0x01, 0x02, 0x03 } };
+
+    data_chunk data;
+    data_sink ostream(data);
+    ostream_writer sink(ostream);
+    workload_recorder::write(sink, expected);
+    ostream.flush();
+    data.pop_back();
+
+    workload_recorder::record value;
+    data_source istream(data);
+    istream_reader source(istream);
+    BOOST_REQUIRE(!workload_recorder::read(value, source));
+}
+
+BOOST_AUTO_TEST_CASE(workload_recorder__write__disabled__no_file)
+{
+    const auto file = make_file();
+    {
+        workload_recorder instance({}, 1);
+        BOOST_REQUIRE(instance.start(confirmed, candidate));
+        instance.write(make_header(1));
+    }
+
+    BOOST_REQUIRE(!boost::filesystem::exists(file));
+}
+
+BOOST_AUTO_TEST_CASE(workload_recorder__write__not_started__no_file)
+{
+    const auto file = make_file();
+    {
+        workload_recorder instance(file, 0);
+        instance.write(make_header(1));
+    }
+
+    BOOST_REQUIRE(!boost::filesystem::exists(file));
+}
+
+BOOST_AUTO_TEST_CASE(workload_recorder__write__stopped__ignored)
+{
+    const auto file = make_file();
+    {
+        workload_recorder instance(file, 0);
+        BOOST_REQUIRE(instance.start(confirmed, candidate));
+        instance.write(make_header(1));
+        instance.stop();
+        instance.write(make_header(2));
+    }
+
+    BOOST_REQUIRE_EQUAL(count_records(file), 1u);
+    BOOST_REQUIRE(!boost::filesystem::exists(make_rotation(file, ".1")));
+}
+
+BOOST_AUTO_TEST_CASE(workload_recorder__write__headers__first_at_zero)
+{
+    const auto file = make_file();
+    {
+        workload_recorder instance(file, 0);
+        BOOST_REQUIRE(instance.start(confirmed, candidate));
+        instance.write(make_header(1));
+        instance.write(std::make_shared<const message::headers>(
+            message::header::list{ *make_header(2), *make_header(3) }));
+        instance.stop();
+    }
+
+    config::checkpoint start_confirmed;
+    config::checkpoint start_candidate;
+    workload_recorder::record value;
+    boost::filesystem::ifstream stream(file, std::ios::binary);
+    istream_reader source(stream);
+    BOOST_REQUIRE(workload_recorder::read_start(start_confirmed,
+        start_candidate, source));
+    BOOST_REQUIRE(start_confirmed == confirmed);
+    BOOST_REQUIRE(start_candidate == candidate);
+
+    BOOST_REQUIRE(workload_recorder::read(value, source));
+    BOOST_REQUIRE(value.type == entity::header);
+    BOOST_REQUIRE_EQUAL(value.microseconds, 0u);
+    const chain::header& header = *make_header(1);
+    BOOST_REQUIRE(value.payload == header.to_data());
+
+    BOOST_REQUIRE(workload_recorder::read(value, source));
+    BOOST_REQUIRE(value.type == entity::headers);
+    BOOST_REQUIRE_EQUAL(value.payload.size(), 1u + 2u * 80u);
+    BOOST_REQUIRE(!workload_recorder::read(value, source));
+}
+
+BOOST_AUTO_TEST_CASE(workload_recorder__start__prior_captures__rotated)
+{
+    const auto file = make_file();
+    {
+        workload_recorder instance(file, 0);
+        BOOST_REQUIRE(instance.start(confirmed, candidate));
+        instance.write(make_header(1));
+        instance.write(make_header(2));
+    }
+    {
+        workload_recorder instance(file, 0);
+        BOOST_REQUIRE(instance.start(confirmed, candidate));
+        instance.write(make_header(3));
+    }
+    {
+        workload_recorder instance(file, 0);
+        BOOST_REQUIRE(instance.start(confirmed, candidate));
+        instance.write(make_header(4));
+        instance.write(make_header(5));
+        instance.write(make_header(6));
+    }
+
+    BOOST_REQUIRE_EQUAL(count_records(make_rotation(file, ".1")), 2u);
+    BOOST_REQUIRE_EQUAL(count_records(make_rotation(file, ".2")), 1u);
+    BOOST_REQUIRE_EQUAL(count_records(file), 3u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,313 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/format.hpp>
+#include <bitcoin/blockchain.hpp>
+#include "memory_chain.hpp"
+
+#define BS_BENCHBLOCKS_USAGE \
+    "Usage: benchblocks <headers> <blocks> [threads...]\n" \
+    "  headers: concatenated wire headers from genesis\n" \
+    "  blocks:  records of wire block (with witness), prevout count\n" \
+    "           (varint), then per prevout the point, height (4 bytes),\n" \
+    "           median time past (4 bytes), coinbase (1 byte) and output\n"
+#define BS_BENCHBLOCKS_HEADERS_FAIL \
+    "Failed to read headers from %1%.\n"
+#define BS_BENCHBLOCKS_BLOCKS_FAIL \
+    "Failed to read block records from %1%.\n"
+#define BS_BENCHBLOCKS_UNINDEXED \
+    "Block %1% is not in the header index.\n"
+#define BS_BENCHBLOCKS_INVALID \
+    "Block #%1% [%2%] is invalid: %3%\n"
+#define BS_BENCHBLOCKS_CORPUS \
+    "Corpus of %1% blocks with %2% inputs.\n"
+#define BS_BENCHBLOCKS_RUN \
+    "threads %1%: %2% inputs/sec, %3% sigops/sec\n"
+#define BS_BENCHBLOCKS_STAGE \
+    "  %-8s total %10.3fms  p50 %8uus  p99 %8uus  max %8uus\n"
+
+using namespace bc;
+using namespace bc::blockchain;
+using namespace bc::chain;
+using boost::format;
+
+typedef std::chrono::duration<double, std::milli> milliseconds;
+
+struct record
+{
+    data_chunk block;
+    size_t height;
+};
+
+struct stage
+{
+    std::string name;
+    latency_histogram latency;
+};
+
+static bool load_blocks(std::vector<record>& out, memory_chain& store,
+    std::istream& stream, size_t& inputs)
+{
+    istream_reader source(stream);
+
+    while (!source.is_exhausted())
+    {
+        chain::block block;
+        if (!block.from_data(source, true))
+            return false;
+
+        record entry;
+        if (!store.get_height(entry.height, block.hash()) ||
+            entry.height == 0)
+        {
+            std::cerr << format(BS_BENCHBLOCKS_UNINDEXED) %
+                encode_hash(block.hash());
+            return false;
+        }
+
+        const auto count = source.read_size_little_endian();
+
+        for (size_t index = 0; index < count && source; ++index)
+        {
+            output_point point;
+            memory_chain::prevout value;
+            point.from_data(source);
+            value.height = source.read_4_bytes_little_endian();
+            value.median_time_past = source.read_4_bytes_little_endian();
+            value.coinbase = source.read_byte() != 0;
+            value.output.from_data(source);
+            store.add_prevout(point, std::move(value));
+        }
+
+        if (!source)
+            return false;
+
+        inputs += block.total_non_coinbase_inputs();
+        entry.block = block.to_data(true);
+        out.push_back(std::move(entry));
+    }
+
+    return !out.empty();
+}
+
+// Returns the validation stage result (store/stop code) of the block.
+template <typename Stage>
+static code run_stage(Stage&& start)
+{
+    std::promise<code> promise;
+    start([&promise](const code& ec)
+    {
+        promise.set_value(ec);
+    });
+
+    return promise.get_future().get();
+}
+
+static void report(size_t threads, std::vector<stage>& stages,
+    size_t inputs, size_t sigops)
+{
+    // Throughput is measured over script validation (connect) time.
+    const auto seconds = stages.back().latency.total() / 1000000.0;
+    const auto rate = [seconds](size_t count)
+    {
+        return seconds == 0.0 ? 0.0 : count / seconds;
+    };
+
+    std::cout << format(BS_BENCHBLOCKS_RUN) % threads %
+        static_cast<uint64_t>(rate(inputs)) %
+        static_cast<uint64_t>(rate(sigops));
+
+    for (const auto& step: stages)
+        std::cout << format(BS_BENCHBLOCKS_STAGE) % step.name %
+            (step.latency.total() / 1000.0) % step.latency.quantile(0.5) %
+            step.latency.quantile(0.99) % step.latency.maximum();
+}
+
+// Validate each block of the corpus against its parent in the header index.
+static bool run(const std::vector<record>& records, memory_chain& store,
+    const blockchain::settings& settings, bc::settings& bitcoin_settings,
+    size_t threads)
+{
+    threadpool priority_pool(threads);
+    threadpool io_pool(threads);
+    dispatcher priority(priority_pool, "benchblocks_priority");
+    dispatcher io(io_pool, "benchblocks_io");
+    script_cache cache(settings.script_cache_size);
+    validate_block validator(priority, io, store, cache, settings,
+        bitcoin_settings);
+
+    std::vector<stage> stages(4);
+    stages[0].name = "check";
+    stages[1].name = "populate";
+    stages[2].name = "accept";
+    stages[3].name = "connect";
+
+    const auto record_stage = [](stage& step, const asio::duration& elapsed)
+    {
+        const auto microseconds = std::chrono::duration_cast<
+            asio::microseconds>(elapsed).count();
+        step.latency.record(microseconds < 0 ? 0 : microseconds);
+    };
+
+    size_t inputs = 0;
+    size_t sigops = 0;
+    auto success = true;
+    validator.start();
+
+    for (const auto& entry: records)
+    {
+        // Deserialization and parent state population are not measured.
+        const auto block = std::make_shared<const message::block>(
+            chain::block::factory(entry.block, true));
+
+        if (!store.set_parent(entry.height - 1u))
+        {
+            success = false;
+            break;
+        }
+
+        const auto token = std::make_shared<abort_token>();
+        auto& metadata = block->header().metadata;
+
+        const auto start = asio::steady_clock::now();
+        validator.check(block, entry.height);
+        record_stage(stages[0], asio::steady_clock::now() - start);
+
+        const auto& times = block->metadata;
+        auto ec = metadata.error;
+
+        if (!ec)
+        {
+            ec = run_stage([&](const validate_block::result_handler& handler)
+            {
+                validator.accept(block, token, handler);
+            });
+
+            // The accept start time is set by contextual checks (populated).
+            const auto accepted = asio::steady_clock::now();
+
+            if (times.start_accept != asio::time_point())
+            {
+                record_stage(stages[1], times.start_accept -
+                    times.start_populate);
+                record_stage(stages[2], accepted - times.start_accept);
+            }
+        }
+
+        if (!ec && !metadata.error)
+        {
+            ec = run_stage([&](const validate_block::result_handler& handler)
+            {
+                validator.connect(block, token, handler);
+            });
+
+            record_stage(stages[3], asio::steady_clock::now() -
+                times.start_connect);
+        }
+
+        if ((ec = ec ? ec : metadata.error))
+        {
+            std::cerr << format(BS_BENCHBLOCKS_INVALID) % entry.height %
+                encode_hash(block->hash()) % ec.message();
+            success = false;
+            break;
+        }
+
+        const auto& state = *metadata.state;
+        inputs += block->total_non_coinbase_inputs();
+        sigops += block->signature_operations(
+            state.is_enabled(machine::rule_fork::bip16_rule),
+            state.is_enabled(machine::rule_fork::bip141_rule));
+    }
+
+    validator.stop();
+    priority_pool.shutdown();
+    io_pool.shutdown();
+    priority_pool.join();
+    io_pool.join();
+
+    if (success)
+        report(threads, stages, inputs, sigops);
+
+    return success;
+}
+
+// Replay a corpus of recorded mainnet blocks through block validation.
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << BS_BENCHBLOCKS_USAGE;
+        return -1;
+    }
+
+    std::vector<size_t> thread_counts;
+    for (auto arg = 3; arg < argc; ++arg)
+        thread_counts.push_back(std::max(std::stoul(argv[arg]), 1ul));
+
+    // Default to doubling thread counts up to the number of cores.
+    if (thread_counts.empty())
+        for (size_t threads = 1; threads <= thread_ceiling(0);
+            threads *= 2u)
+            thread_counts.push_back(threads);
+
+    blockchain::settings settings(config::settings::mainnet);
+    bc::settings bitcoin_settings(config::settings::mainnet);
+
+    // Validate all scripts of the corpus.
+    settings.checkpoints.clear();
+    settings.assume_valid = {};
+
+    memory_chain store(settings, bitcoin_settings);
+    std::ifstream headers(argv[1], std::ios::binary);
+
+    if (!store.load_headers(headers))
+    {
+        std::cerr << format(BS_BENCHBLOCKS_HEADERS_FAIL) % argv[1];
+        return -1;
+    }
+
+    size_t inputs = 0;
+    std::vector<record> records;
+    std::ifstream blocks(argv[2], std::ios::binary);
+
+    if (!load_blocks(records, store, blocks, inputs))
+    {
+        std::cerr << format(BS_BENCHBLOCKS_BLOCKS_FAIL) % argv[2];
+        return -1;
+    }
+
+    std::cout << format(BS_BENCHBLOCKS_CORPUS) % records.size() % inputs;
+
+    for (const auto threads: thread_counts)
+        if (!run(records, store, settings, bitcoin_settings, threads))
+            return -1;
+
+    return 0;
+}
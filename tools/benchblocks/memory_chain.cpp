@@ -0,0 +1,427 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "memory_chain.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <bitcoin/blockchain.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+using namespace bc::chain;
+using namespace bc::config;
+
+memory_chain::memory_chain(const settings& settings,
+    bc::settings& bitcoin_settings)
+  : bitcoin_settings_(bitcoin_settings),
+    populator_(*this, settings, bitcoin_settings)
+{
+}
+
+bool memory_chain::load_headers(std::istream& stream)
+{
+    istream_reader source(stream);
+
+    while (!source.is_exhausted())
+    {
+        header header;
+
+        if (!header.from_data(source))
+            return false;
+
+        push(header);
+    }
+
+    return !headers_.empty();
+}
+
+void memory_chain::push(const header& header)
+{
+    heights_[header.hash()] = headers_.size();
+    headers_.push_back(header);
+}
+
+void memory_chain::add_prevout(const output_point& point, prevout&& value)
+{
+    prevouts_[point] = std::move(value);
+}
+
+bool memory_chain::get_height(size_t& out_height,
+    const hash_digest& hash) const
+{
+    const auto it = heights_.find(hash);
+
+    if (it == heights_.end())
+        return false;
+
+    out_height = it->second;
+    return true;
+}
+
+// The parent state is populated from the header index (not promoted), so
+// blocks of the corpus need not be contiguous.
+bool memory_chain::set_parent(size_t height)
+{
+    if (height >= headers_.size())
+        return false;
+
+    auto parent = headers_[height];
+    top_ = chain_state(parent, height);
+    return static_cast<bool>(top_);
+}
+
+// Readers.
+// ----------------------------------------------------------------------------
+// The candidate and confirmed chains are both the header index.
+
+bool memory_chain::get_top(header& out_header, size_t& out_height,
+    bool) const
+{
+    if (headers_.empty())
+        return false;
+
+    out_height = headers_.size() - 1u;
+    out_header = headers_.back();
+    return true;
+}
+
+bool memory_chain::get_top(checkpoint& out_checkpoint, bool) const
+{
+    if (headers_.empty())
+        return false;
+
+    out_checkpoint = { headers_.back().hash(), headers_.size() - 1u };
+    return true;
+}
+
+bool memory_chain::get_top_height(size_t& out_height, bool) const
+{
+    if (headers_.empty())
+        return false;
+
+    out_height = headers_.size() - 1u;
+    return true;
+}
+
+bool memory_chain::get_header(header& out_header, size_t height, bool) const
+{
+    if (height >= headers_.size())
+        return false;
+
+    out_header = headers_[height];
+    return true;
+}
+
+bool memory_chain::get_header(header& out_header, size_t& out_height,
+    const hash_digest& block_hash, bool candidate) const
+{
+    return get_height(out_height, block_hash) &&
+        get_header(out_header, out_height, candidate);
+}
+
+bool memory_chain::get_block_hash(hash_digest& out_hash, size_t height,
+    bool) const
+{
+    if (height >= headers_.size())
+        return false;
+
+    out_hash = headers_[height].hash();
+    return true;
+}
+
+bool memory_chain::get_block_error(code&, const hash_digest&) const
+{
+    return false;
+}
+
+bool memory_chain::get_bits(uint32_t& out_bits, size_t height, bool) const
+{
+    if (height >= headers_.size())
+        return false;
+
+    out_bits = headers_[height].bits();
+    return true;
+}
+
+bool memory_chain::get_timestamp(uint32_t& out_timestamp, size_t height,
+    bool) const
+{
+    if (height >= headers_.size())
+        return false;
+
+    out_timestamp = headers_[height].timestamp();
+    return true;
+}
+
+bool memory_chain::get_version(uint32_t& out_version, size_t height,
+    bool) const
+{
+    if (height >= headers_.size())
+        return false;
+
+    out_version = headers_[height].version();
+    return true;
+}
+
+// Sums work above the height, stopping once the overcome work is exceeded
+// (a zero overcome bypasses early exit).
+bool memory_chain::get_work(uint256_t& out_work, const uint256_t& overcome,
+    size_t above_height, bool) const
+{
+    out_work = 0;
+    const auto no_maximum = overcome.is_zero();
+
+    for (auto height = headers_.size(); height > above_height + 1u &&
+        (no_maximum || out_work <= overcome); --height)
+        out_work += headers_[height - 1u].proof();
+
+    return true;
+}
+
+bool memory_chain::get_downloadable(hash_digest&, size_t) const
+{
+    return false;
+}
+
+void memory_chain::get_downloadable(checkpoint::list&, size_t, size_t) const
+{
+}
+
+bool memory_chain::get_validatable(hash_digest&, size_t) const
+{
+    return false;
+}
+
+void memory_chain::prime_validation(const hash_digest&, size_t) const
+{
+}
+
+// An indexed header exists, and tx metadata remains default (not stored).
+void memory_chain::populate_header(header& header) const
+{
+    header.metadata.exists = (heights_.find(header.hash()) != heights_.end());
+}
+
+void memory_chain::populate_block_transaction(transaction&, uint32_t,
+    size_t) const
+{
+}
+
+void memory_chain::populate_pool_transaction(transaction&, uint32_t) const
+{
+}
+
+// A corpus prevout is unspent in the candidate chain (as if utxo cached).
+bool memory_chain::populate_output(const output_point& outpoint,
+    size_t fork_height, bool) const
+{
+    const auto it = prevouts_.find(outpoint);
+
+    if (it == prevouts_.end())
+        return false;
+
+    const auto& value = it->second;
+    auto& prevout = outpoint.metadata;
+    prevout.spent = false;
+    prevout.candidate = true;
+    prevout.confirmed = value.height <= fork_height;
+    prevout.coinbase = value.coinbase;
+    prevout.height = value.height;
+    prevout.median_time_past = value.median_time_past;
+    prevout.cache = value.output;
+    return true;
+}
+
+void memory_chain::populate_outputs(const outpoints& prevouts,
+    size_t fork_height, bool candidate) const
+{
+    for (const auto prevout: prevouts)
+        populate_output(*prevout, fork_height, candidate);
+}
+
+// There is no pool, so all prevouts are populated from the corpus.
+size_t memory_chain::populate_pooled_outputs(const block&,
+    std::vector<bool>&) const
+{
+    return 0;
+}
+
+uint8_t memory_chain::get_block_state(size_t, bool) const
+{
+    return 0;
+}
+
+uint8_t memory_chain::get_block_state(const hash_digest&) const
+{
+    return 0;
+}
+
+header_const_ptr memory_chain::get_header(size_t, bool) const
+{
+    return {};
+}
+
+block_const_ptr memory_chain::get_block(size_t, bool, bool) const
+{
+    return {};
+}
+
+// Writers.
+// ----------------------------------------------------------------------------
+
+code memory_chain::store(transaction_const_ptr)
+{
+    return error::success;
+}
+
+// Headers above the fork point are replaced, and the top state is that of
+// the top incoming header (as retained by the header organizer).
+code memory_chain::reorganize(const checkpoint& fork,
+    header_const_ptr_list_const_ptr incoming)
+{
+    if (fork.height() >= headers_.size() || incoming->empty())
+        return error::operation_failed;
+
+    for (auto height = fork.height() + 1u; height < headers_.size(); ++height)
+        heights_.erase(headers_[height].hash());
+
+    headers_.resize(fork.height() + 1u);
+
+    for (const auto& header: *incoming)
+        push(*header);
+
+    top_ = incoming->back()->metadata.state;
+
+    if (!top_)
+        return set_parent(headers_.size() - 1u) ? error::success :
+            error::operation_failed;
+
+    return error::success;
+}
+
+code memory_chain::update(block_const_ptr, size_t)
+{
+    return error::success;
+}
+
+code memory_chain::invalidate(header&, const code&)
+{
+    return error::success;
+}
+
+code memory_chain::invalidate(block_const_ptr, size_t)
+{
+    return error::success;
+}
+
+code memory_chain::candidate(block_const_ptr)
+{
+    return error::success;
+}
+
+code memory_chain::candidate(block_const_ptr_list_const_ptr)
+{
+    return error::success;
+}
+
+code memory_chain::reorganize(block_const_ptr_list_const_ptr, size_t)
+{
+    return error::success;
+}
+
+// Properties.
+// ----------------------------------------------------------------------------
+// The top is the fork point, so all corpus prevouts are confirmed.
+
+checkpoint memory_chain::fork_point() const
+{
+    return top_ ? checkpoint{ top_->hash(), top_->height() } : checkpoint{};
+}
+
+chain::chain_state::ptr memory_chain::top_candidate_state() const
+{
+    return top_;
+}
+
+chain::chain_state::ptr memory_chain::top_valid_candidate_state() const
+{
+    return top_;
+}
+
+chain::chain_state::ptr memory_chain::next_confirmed_state() const
+{
+    return {};
+}
+
+bool memory_chain::is_candidates_stale() const
+{
+    return false;
+}
+
+bool memory_chain::is_validated_stale() const
+{
+    return false;
+}
+
+bool memory_chain::is_blocks_stale() const
+{
+    return false;
+}
+
+bool memory_chain::is_reorganizable() const
+{
+    return false;
+}
+
+// Chain State.
+// ----------------------------------------------------------------------------
+
+chain::chain_state::ptr memory_chain::chain_state(header& header,
+    size_t height) const
+{
+    return populator_.populate(header, height, true);
+}
+
+chain::chain_state::ptr memory_chain::promote_state(header& header,
+    chain::chain_state::ptr parent) const
+{
+    if (!parent || parent->hash() != header.previous_block_hash())
+        return {};
+
+    return std::make_shared<chain::chain_state>(*parent, header,
+        bitcoin_settings_);
+}
+
+chain::chain_state::ptr memory_chain::promote_state(
+    header_branch::const_ptr branch) const
+{
+    const auto parent = branch->top_parent();
+    if (!parent || !parent->metadata.state)
+        return {};
+
+    return promote_state(*branch->top(), parent->metadata.state);
+}
+
+} // namespace blockchain
+} // namespace libbitcoin
@@ -0,0 +1,164 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_BLOCKCHAIN_BENCHBLOCKS_MEMORY_CHAIN_HPP
+#define LIBBITCOIN_BLOCKCHAIN_BENCHBLOCKS_MEMORY_CHAIN_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <unordered_map>
+#include <vector>
+#include <bitcoin/blockchain.hpp>
+
+namespace libbitcoin {
+namespace blockchain {
+
+/// This class is NOT thread safe for writers.
+/// A fast_chain over an in-memory header index and prevout set, sufficient
+/// for population and validation of blocks on the indexed chain and for the
+/// organization of headers. Header reorganization updates the index, other
+/// writers succeed without effect (block validation is never committed).
+class memory_chain
+  : public fast_chain
+{
+public:
+    struct prevout
+    {
+        chain::output output;
+        size_t height;
+        uint32_t median_time_past;
+        bool coinbase;
+    };
+
+    memory_chain(const settings& settings, bc::settings& bitcoin_settings);
+
+    /// Load the header index from concatenated wire headers (from genesis).
+    bool load_headers(std::istream& stream);
+
+    /// Append a header to the index (the first is genesis).
+    void push(const chain::header& header);
+
+    /// Add a prevout of a block to be validated.
+    void add_prevout(const chain::output_point& point, prevout&& value);
+
+    /// Get the height of an indexed header by hash.
+    bool get_height(size_t& out_height, const hash_digest& hash) const;
+
+    /// Set the top state to that of the indexed header at the height, which
+    /// is the parent of the next block to validate.
+    bool set_parent(size_t height);
+
+    // Readers.
+    // ------------------------------------------------------------------------
+
+    bool get_top(chain::header& out_header, size_t& out_height,
+        bool candidate) const;
+    bool get_top(config::checkpoint& out_checkpoint,
+        bool candidate) const;
+    bool get_top_height(size_t& out_height, bool candidate) const;
+    bool get_header(chain::header& out_header, size_t height,
+        bool candidate) const;
+    bool get_header(chain::header& out_header, size_t& out_height,
+        const hash_digest& block_hash, bool candidate) const;
+    bool get_block_hash(hash_digest& out_hash, size_t height,
+        bool candidate) const;
+    bool get_block_error(code& out_error,
+        const hash_digest& block_hash) const;
+    bool get_bits(uint32_t& out_bits, size_t height,
+        bool candidate) const;
+    bool get_timestamp(uint32_t& out_timestamp, size_t height,
+        bool candidate) const;
+    bool get_version(uint32_t& out_version, size_t height,
+        bool candidate) const;
+    bool get_work(uint256_t& out_work, const uint256_t& overcome,
+        size_t above_height, bool candidate) const;
+    bool get_downloadable(hash_digest& out_hash,
+        size_t height) const;
+    void get_downloadable(config::checkpoint::list& out_blocks,
+        size_t height, size_t count) const;
+    bool get_validatable(hash_digest& out_hash,
+        size_t height) const;
+    void prime_validation(const hash_digest& hash,
+        size_t height) const;
+    void populate_header(chain::header& header) const;
+    void populate_block_transaction(chain::transaction& tx, uint32_t forks,
+        size_t fork_height) const;
+    void populate_pool_transaction(chain::transaction& tx,
+        uint32_t forks) const;
+    bool populate_output(const chain::output_point& outpoint,
+        size_t fork_height, bool candidate) const;
+    void populate_outputs(const outpoints& prevouts, size_t fork_height,
+        bool candidate) const;
+    size_t populate_pooled_outputs(const chain::block& block,
+        std::vector<bool>& out_populated) const;
+    uint8_t get_block_state(size_t height, bool candidate) const;
+    uint8_t get_block_state(const hash_digest& block_hash) const;
+    header_const_ptr get_header(size_t height, bool candidate) const;
+    block_const_ptr get_block(size_t height, bool witness,
+        bool candidate) const;
+
+    // Writers.
+    // ------------------------------------------------------------------------
+
+    code store(transaction_const_ptr tx);
+    code reorganize(const config::checkpoint& fork,
+        header_const_ptr_list_const_ptr incoming);
+    code update(block_const_ptr block, size_t height);
+    code invalidate(chain::header& header, const code& error);
+    code invalidate(block_const_ptr block, size_t height);
+    code candidate(block_const_ptr block);
+    code candidate(block_const_ptr_list_const_ptr blocks);
+    code reorganize(block_const_ptr_list_const_ptr branch_cache,
+        size_t branch_height);
+
+    // Properties.
+    // ------------------------------------------------------------------------
+
+    config::checkpoint fork_point() const;
+    chain::chain_state::ptr top_candidate_state() const;
+    chain::chain_state::ptr top_valid_candidate_state() const;
+    chain::chain_state::ptr next_confirmed_state() const;
+    bool is_candidates_stale() const;
+    bool is_validated_stale() const;
+    bool is_blocks_stale() const;
+    bool is_reorganizable() const;
+
+    // Chain State.
+    // ------------------------------------------------------------------------
+
+    chain::chain_state::ptr chain_state(chain::header& header,
+        size_t height) const;
+    chain::chain_state::ptr promote_state(chain::header& header,
+        chain::chain_state::ptr parent) const;
+    chain::chain_state::ptr promote_state(
+        header_branch::const_ptr branch) const;
+
+private:
+    bc::settings& bitcoin_settings_;
+    const populate_chain_state populator_;
+    chain::header::list headers_;
+    std::unordered_map<hash_digest, size_t> heights_;
+    std::unordered_map<chain::point, prevout> prevouts_;
+    chain::chain_state::ptr top_;
+};
+
+} // namespace blockchain
+} // namespace libbitcoin
+
+#endif
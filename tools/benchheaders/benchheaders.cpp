@@ -0,0 +1,442 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/format.hpp>
+#include <bitcoin/blockchain.hpp>
+#include "../benchblocks/memory_chain.hpp"
+
+#define BS_BENCHHEADERS_USAGE \
+    "Usage: benchheaders [headers] [forks] [reorgs] [depth]\n" \
+    "  headers: length of the linear header sync (800000)\n" \
+    "  forks:   number of short competing forks (10000)\n" \
+    "  reorgs:  number of deep reorganizations (100)\n" \
+    "  depth:   depth of each reorganization (100)\n"
+#define BS_BENCHHEADERS_FAIL \
+    "Failed to organize %1% header at height %2%: %3%\n"
+#define BS_BENCHHEADERS_UNORGANIZED \
+    "Reorganization at height %1% was not organized.\n"
+#define BS_BENCHHEADERS_POOL \
+    "pool     %1% headers (%2% bytes)\n"
+#define BS_BENCHHEADERS_RUN \
+    "%-8s %8u headers in %10.3fms: %10u headers/sec, pool %8u headers " \
+    "(%u bytes)\n"
+#define BS_BENCHHEADERS_STAGE \
+    "  %-12s count %8u  total %10.3fms  p50 %8uus  p99 %8uus  max %8uus\n"
+
+using namespace bc;
+using namespace bc::blockchain;
+using namespace bc::chain;
+using namespace bc::config;
+using boost::format;
+
+typedef std::chrono::duration<double, std::milli> milliseconds;
+
+// Headers of a linear sync are organized in messages of the protocol limit.
+static constexpr size_t batch_size = 2000;
+
+// Headers deeper than this below the top are pruned from the pool.
+static constexpr size_t pool_depth = 1000;
+
+// Competing forks are rooted within this distance of the top.
+static constexpr size_t fork_spread = 100;
+
+// The store of the benchmark, which (as block_chain) removes reorganized
+// headers from the header pool and prunes the pool to the new top.
+class pooled_chain
+  : public memory_chain
+{
+public:
+    pooled_chain(header_pool& pool, latency_histogram& prune,
+        const blockchain::settings& settings, bc::settings& bitcoin_settings)
+      : memory_chain(settings, bitcoin_settings), pool_(pool), prune_(prune)
+    {
+    }
+
+    using memory_chain::reorganize;
+
+    code reorganize(const checkpoint& fork,
+        header_const_ptr_list_const_ptr incoming)
+    {
+        const auto ec = memory_chain::reorganize(fork, incoming);
+
+        if (ec)
+            return ec;
+
+        const auto start = asio::steady_clock::now();
+        pool_.remove(incoming);
+        pool_.prune(fork.height() + incoming->size());
+        record(prune_, asio::steady_clock::now() - start);
+        return ec;
+    }
+
+    static void record(latency_histogram& latency,
+        const asio::duration& elapsed)
+    {
+        const auto microseconds = std::chrono::duration_cast<
+            asio::microseconds>(elapsed).count();
+        latency.record(microseconds < 0 ? 0 : microseconds);
+    }
+
+private:
+    header_pool& pool_;
+    latency_histogram& prune_;
+};
+
+// Mine a header on the parent at minimal (regtest) difficulty, where the
+// salt distinguishes competing headers of the same parent.
+static message::header mine(const chain::header& parent, uint64_t salt,
+    uint32_t proof_of_work_limit)
+{
+    message::header header(parent.version(), parent.hash(),
+        bitcoin_hash(to_chunk(to_little_endian(salt))),
+        parent.timestamp() + 1u, parent.bits(), 0);
+
+    while (!header.is_valid_proof_of_work(proof_of_work_limit))
+        header.set_nonce(header.nonce() + 1u);
+
+    return header;
+}
+
+static message::header top_header(const memory_chain& store, size_t& height)
+{
+    chain::header header;
+    store.get_top(header, height, true);
+    return header;
+}
+
+static message::header indexed_header(const memory_chain& store,
+    size_t height)
+{
+    chain::header header;
+    store.get_header(header, height, true);
+    return header;
+}
+
+// Returns the organization result of the header or headers message.
+template <typename Message>
+static code organize(header_organizer& organizer, Message message)
+{
+    std::promise<code> promise;
+    organizer.organize(message, [&promise](const code& ec)
+    {
+        promise.set_value(ec);
+    });
+
+    return promise.get_future().get();
+}
+
+// Insufficient work is the expected result of a competing fork.
+static bool organized(const code& ec, const std::string& phase,
+    size_t height)
+{
+    if (!ec || ec == error::insufficient_work)
+        return true;
+
+    std::cerr << format(BS_BENCHHEADERS_FAIL) % phase % height % ec.message();
+    return false;
+}
+
+static void report(const std::string& phase, size_t headers,
+    const milliseconds& elapsed, const header_pool& pool)
+{
+    const auto seconds = elapsed.count() / 1000.0;
+    const auto rate = seconds == 0.0 ? 0.0 : headers / seconds;
+
+    std::cout << format(BS_BENCHHEADERS_RUN) % phase % headers %
+        elapsed.count() % static_cast<uint64_t>(rate) % pool.size() %
+        pool.memory();
+}
+
+static void report(const std::string& name, const latency_histogram& latency)
+{
+    std::cout << format(BS_BENCHHEADERS_STAGE) % name % latency.count() %
+        (latency.total() / 1000.0) % latency.quantile(0.5) %
+        latency.quantile(0.99) % latency.maximum();
+}
+
+// Sync a linear chain from genesis in messages of the batch size.
+static bool run_linear(header_organizer& organizer, memory_chain& store,
+    const header_pool& pool, size_t count, uint32_t limit, uint64_t& salt)
+{
+    size_t height;
+    auto parent = top_header(store, height);
+    milliseconds elapsed(0);
+
+    for (size_t offset = 0; offset < count; offset += batch_size)
+    {
+        // Mining is not measured.
+        message::header::list batch;
+        batch.reserve(batch_size);
+
+        for (size_t index = offset; index < count &&
+            index < offset + batch_size; ++index)
+        {
+            batch.push_back(mine(parent, ++salt, limit));
+            parent = batch.back();
+        }
+
+        const auto message = std::make_shared<const message::headers>(
+            std::move(batch));
+
+        const auto start = asio::steady_clock::now();
+        const auto ec = organize(organizer, message);
+        elapsed += asio::steady_clock::now() - start;
+
+        if (!organized(ec, "linear", height + offset + 1u))
+            return false;
+    }
+
+    report("linear", count, elapsed, pool);
+    return true;
+}
+
+// Organize short forks of one to four headers, rooted within the spread of
+// the top and each with insufficient work, so that they accumulate in the
+// pool. The top is extended every sixteen forks so that the pool is pruned.
+static bool run_forks(header_organizer& organizer, memory_chain& store,
+    const header_pool& pool, size_t count, uint32_t limit, uint64_t& salt)
+{
+    size_t headers = 0;
+    milliseconds elapsed(0);
+
+    for (size_t fork = 0; fork < count; ++fork)
+    {
+        size_t height;
+        auto parent = top_header(store, height);
+
+        if (fork % 16u == 15u)
+        {
+            const auto header = std::make_shared<const message::header>(
+                mine(parent, ++salt, limit));
+
+            const auto start = asio::steady_clock::now();
+            const auto ec = organize(organizer, header);
+            elapsed += asio::steady_clock::now() - start;
+            ++headers;
+
+            if (!organized(ec, "extend", height + 1u))
+                return false;
+
+            continue;
+        }
+
+        const auto length = 1u + fork % 4u;
+        const auto root = height - length - fork % fork_spread;
+        parent = indexed_header(store, root);
+
+        for (size_t index = 0; index < length; ++index)
+        {
+            const auto header = std::make_shared<const message::header>(
+                mine(parent, ++salt, limit));
+            parent = *header;
+
+            const auto start = asio::steady_clock::now();
+            const auto ec = organize(organizer, header);
+            elapsed += asio::steady_clock::now() - start;
+            ++headers;
+
+            if (!organized(ec, "fork", root + index + 1u))
+                return false;
+        }
+    }
+
+    report("forks", headers, elapsed, pool);
+    return true;
+}
+
+// Replace the top depth headers with a single message of one more header,
+// so that each round is a reorganization of the depth.
+static bool run_reorgs(header_organizer& organizer, memory_chain& store,
+    const header_pool& pool, size_t count, size_t depth, uint32_t limit,
+    uint64_t& salt)
+{
+    size_t headers = 0;
+    milliseconds elapsed(0);
+
+    for (size_t round = 0; round < count; ++round)
+    {
+        size_t height;
+        top_header(store, height);
+        const auto root = height - depth;
+        auto parent = indexed_header(store, root);
+
+        message::header::list batch;
+        batch.reserve(depth + 1u);
+
+        for (size_t index = 0; index <= depth; ++index)
+        {
+            batch.push_back(mine(parent, ++salt, limit));
+            parent = batch.back();
+        }
+
+        headers += batch.size();
+        const auto message = std::make_shared<const message::headers>(
+            std::move(batch));
+
+        const auto start = asio::steady_clock::now();
+        const auto ec = organize(organizer, message);
+        elapsed += asio::steady_clock::now() - start;
+
+        if (!organized(ec, "reorg", root + 1u))
+            return false;
+
+        if (!store.get_top_height(height, true) || height != root + depth + 1u)
+        {
+            std::cerr << format(BS_BENCHHEADERS_UNORGANIZED) % root;
+            return false;
+        }
+    }
+
+    report("reorgs", headers, elapsed, pool);
+    return true;
+}
+
+// Fill a standalone pool with forks of the length rooted at each height
+// below the top, then measure branch reads from every leaf and pruning of
+// the pool one height at a time.
+static void run_pool(const chain::header& genesis, size_t forks,
+    size_t length, uint32_t limit, uint64_t& salt)
+{
+    header_pool pool(pool_depth);
+    header_const_ptr_list leaves;
+    leaves.reserve(forks * length);
+    message::header parent(genesis);
+
+    for (size_t fork = 0; fork < forks; ++fork)
+    {
+        // The forks are rooted on a notional chain (unknown to the pool).
+        const auto root = pool_depth + fork % pool_depth;
+        parent = mine(parent, ++salt, limit);
+
+        for (size_t index = 1; index <= length; ++index)
+        {
+            const auto header = std::make_shared<const message::header>(
+                mine(parent, ++salt, limit));
+            pool.add(header, root + index);
+            parent = *header;
+            leaves.push_back(header);
+        }
+    }
+
+    std::cout << format(BS_BENCHHEADERS_POOL) % pool.size() % pool.memory();
+
+    latency_histogram branch;
+    for (const auto& leaf: leaves)
+    {
+        const auto header = std::make_shared<const message::header>(
+            mine(*leaf, ++salt, limit));
+
+        const auto start = asio::steady_clock::now();
+        pool.get_branch(header);
+        pooled_chain::record(branch, asio::steady_clock::now() - start);
+    }
+
+    latency_histogram prune;
+    for (auto top = 2u * pool_depth; top <= 3u * pool_depth + length; ++top)
+    {
+        const auto start = asio::steady_clock::now();
+        pool.prune(top);
+        pooled_chain::record(prune, asio::steady_clock::now() - start);
+    }
+
+    report("get_branch", branch);
+    report("prune", prune);
+}
+
+// Drive header organization and the header pool with synthetic chains.
+int main(int argc, char** argv)
+{
+    const auto argument = [argc, argv](int index, size_t fallback)
+    {
+        return index < argc ? std::stoul(argv[index]) : fallback;
+    };
+
+    if (argc > 5)
+    {
+        std::cerr << BS_BENCHHEADERS_USAGE;
+        return -1;
+    }
+
+    const auto headers = argument(1, 800000);
+    const auto forks = argument(2, 10000);
+    const auto reorgs = argument(3, 100);
+    const auto depth = std::max(argument(4, 100), size_t(1));
+
+    blockchain::settings settings(config::settings::regtest);
+    bc::settings bitcoin_settings(config::settings::regtest);
+    settings.reorganization_limit = pool_depth;
+    settings.header_commit_milliseconds = 0;
+
+    // The reorganization and the fork spread must be within the chain.
+    if (headers < depth + fork_spread + 4u)
+    {
+        std::cerr << BS_BENCHHEADERS_USAGE;
+        return -1;
+    }
+
+    const auto limit = bitcoin_settings.proof_of_work_limit;
+    uint64_t salt = 0;
+
+    latency_histogram prune;
+    header_pool pool(settings.reorganization_limit,
+        settings.header_pool_megabytes);
+    pooled_chain store(pool, prune, settings, bitcoin_settings);
+    const auto& genesis = bitcoin_settings.genesis_block.header();
+    store.push(genesis);
+    store.set_parent(0);
+
+    threadpool threads(thread_ceiling(settings.cores));
+    dispatcher priority(threads, "benchheaders_priority");
+    prioritized_mutex mutex(true);
+    stage_metrics metrics;
+    header_organizer organizer(mutex, priority, threads, store, metrics,
+        pool, settings, bitcoin_settings);
+
+    organizer.start();
+
+    const auto success =
+        run_linear(organizer, store, pool, headers, limit, salt) &&
+        run_forks(organizer, store, pool, forks, limit, salt) &&
+        run_reorgs(organizer, store, pool, reorgs, depth, limit, salt);
+
+    organizer.stop();
+    threads.shutdown();
+    threads.join();
+
+    if (!success)
+        return -1;
+
+    const auto header = stage_metrics::entity::header;
+    for (const auto step: { stage_metrics::stage::read,
+        stage_metrics::stage::accept, stage_metrics::stage::reorganize })
+        report(stage_metrics::name(step), metrics.histogram(header, step));
+
+    report("prune", prune);
+    run_pool(genesis, forks, 4, limit, salt);
+    return 0;
+}
@@ -0,0 +1,593 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <bitcoin/blockchain.hpp>
+#include <bitcoin/database.hpp>
+
+#define BS_BENCHREORG_USAGE \
+    "Usage: benchreorg [blocks] [rounds] [size] [cache] [depths...]\n" \
+    "  blocks: length of the confirmed chain built before rounds (1000)\n" \
+    "  rounds: reorganizations and invalidations of each depth (10)\n" \
+    "  size:   approximate serialized bytes of each block (10000)\n" \
+    "  cache:  candidate cache megabytes, zero to read preceding blocks\n" \
+    "          of each reorganization from the store (default setting)\n" \
+    "  depths: blocks reorganized out of the confirmed chain (1 10 100),\n" \
+    "          each less than the length of the confirmed chain\n"
+#define BS_BENCHREORG_STORE_FAIL \
+    "Failed to create the store in %1%.\n"
+#define BS_BENCHREORG_START_FAIL \
+    "Failed to start the chain.\n"
+#define BS_BENCHREORG_FAIL \
+    "Failed to %1% at height %2%: %3%\n"
+#define BS_BENCHREORG_UNNOTIFIED \
+    "Subscribers were not notified of the %1% at height %2%.\n"
+#define BS_BENCHREORG_BUILD \
+    "build    %8u blocks of %8u bytes in %10.3fms\n"
+#define BS_BENCHREORG_READS \
+    "%-8s depth %4u  preceding cached %6u  stored %6u  " \
+    "candidate cache %u MB\n"
+#define BS_BENCHREORG_STAGE \
+    "%-8s depth %4u  %-10s count %6u  total %10.3fms  p50 %8uus  " \
+    "p99 %8uus  max %8uus\n"
+
+using namespace bc;
+using namespace bc::blockchain;
+using namespace bc::chain;
+using namespace bc::database;
+using namespace bc::machine;
+using boost::format;
+
+typedef std::chrono::duration<double, std::milli> milliseconds;
+
+// The store is created in this directory, removed before and after the run.
+static const auto directory = "benchreorg";
+
+// The approximate bytes of each spend (a tx and the coinbase output spent).
+static constexpr size_t spend_size = 70;
+
+// The approximate bytes of a block without spends.
+static constexpr size_t empty_size = 200;
+
+// Subscribers are awaited for this long before the run fails.
+static const auto notify_timeout = std::chrono::seconds(10);
+
+struct round_metrics
+{
+    latency_histogram headers;
+    latency_histogram store;
+    latency_histogram candidate;
+    latency_histogram reorganize;
+    latency_histogram invalidate;
+    latency_histogram notify;
+};
+
+static void record(latency_histogram& latency, const asio::duration& elapsed)
+{
+    const auto microseconds = std::chrono::duration_cast<
+        asio::microseconds>(elapsed).count();
+    latency.record(microseconds < 0 ? 0 : microseconds);
+}
+
+// The latency from the start of a store write until subscribers are invoked
+// with the expected numbers of incoming and outgoing blocks (or headers).
+// Notification is asynchronous, so it may precede the return of the write.
+class notification_probe
+{
+public:
+    notification_probe()
+      : expecting_(false), incoming_(0), outgoing_(0), latency_(nullptr)
+    {
+    }
+
+    void expect(size_t incoming, size_t outgoing, latency_histogram& latency)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        expecting_ = true;
+        incoming_ = incoming;
+        outgoing_ = outgoing;
+        latency_ = &latency;
+        start_ = asio::steady_clock::now();
+    }
+
+    void notify(size_t incoming, size_t outgoing)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (!expecting_ || incoming != incoming_ || outgoing != outgoing_)
+            return;
+
+        record(*latency_, asio::steady_clock::now() - start_);
+        expecting_ = false;
+        signal_.notify_one();
+    }
+
+    bool wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return signal_.wait_for(lock, notify_timeout, [this]()
+        {
+            return !expecting_;
+        });
+    }
+
+private:
+    bool expecting_;
+    size_t incoming_;
+    size_t outgoing_;
+    latency_histogram* latency_;
+    asio::time_point start_;
+    std::mutex mutex_;
+    std::condition_variable signal_;
+};
+
+static bool succeeded(const code& ec, const std::string& step, size_t height)
+{
+    if (!ec)
+        return true;
+
+    std::cerr << format(BS_BENCHREORG_FAIL) % step % height % ec.message();
+    return false;
+}
+
+static bool notified(notification_probe& probe, const std::string& step,
+    size_t height)
+{
+    if (probe.wait())
+        return true;
+
+    std::cerr << format(BS_BENCHREORG_UNNOTIFIED) % step % height;
+    return false;
+}
+
+// The coinbase is made unique by the salt and has an unencumbered output for
+// each spend of the child block, so that reorganization unspends (and spends
+// again) the outputs of the fork point. Blocks are not validated, so proof of
+// work and coinbase claims are not required.
+static block_const_ptr make_block(const chain::block& parent, size_t height,
+    size_t spends, uint64_t salt)
+{
+    static const chain::script unencumbered(operation::list
+    {
+        operation(opcode::push_positive_1)
+    });
+
+    // The genesis coinbase output is not spendable.
+    const auto& previous = parent.transactions().front().hash();
+    const auto spent = height > 1u ? spends : 0u;
+    transaction::list txs;
+    txs.reserve(spent + 1u);
+
+    input::list inputs(1);
+    inputs.front().set_previous_output({ null_hash, point::null_index });
+    inputs.front().set_script(chain::script(operation::list
+    {
+        operation(number(height).data()),
+        operation(to_chunk(to_little_endian(salt)))
+    }));
+    inputs.front().set_sequence(max_input_sequence);
+
+    output::list outputs;
+    outputs.reserve(std::max(spends, size_t(1)));
+
+    for (size_t index = 0; index < std::max(spends, size_t(1)); ++index)
+        outputs.emplace_back(1u, unencumbered);
+
+    txs.emplace_back(1u, 0u, std::move(inputs), std::move(outputs));
+
+    for (uint32_t index = 0; index < spent; ++index)
+    {
+        input::list spend(1);
+        spend.front().set_previous_output({ previous, index });
+        spend.front().set_sequence(max_input_sequence);
+
+        output::list output;
+        output.emplace_back(1u, unencumbered);
+        txs.emplace_back(1u, 0u, std::move(spend), std::move(output));
+    }
+
+    const auto& top = parent.header();
+    chain::header header(top.version(), parent.hash(), null_hash,
+        top.timestamp() + 1u, top.bits(), 0);
+
+    const auto block = std::make_shared<message::block>(std::move(header),
+        std::move(txs));
+    block->header().set_merkle(block->generate_merkle_root());
+    return block;
+}
+
+// Make a branch of the count of blocks on the candidate at the fork height,
+// with the chain state of each set (as by header organization).
+static bool make_branch(block_const_ptr_list& out_branch,
+    const block_chain& chain, size_t fork_height, size_t count,
+    size_t spends, uint64_t& salt)
+{
+    auto parent = chain.get_block(fork_height, false, true);
+
+    if (!parent)
+        return false;
+
+    out_branch.clear();
+    out_branch.reserve(count);
+    chain::chain_state::ptr state;
+
+    for (size_t index = 0; index < count; ++index)
+    {
+        const auto height = fork_height + index + 1u;
+        const auto block = make_block(*parent, height, spends, ++salt);
+        auto& header = block->header();
+
+        state = state ? chain.promote_state(header, state) :
+            chain.chain_state(header, height);
+
+        header.metadata.state = state;
+        out_branch.push_back(block);
+        parent = block;
+    }
+
+    return true;
+}
+
+// Reorganize the headers of the branch into the candidate index.
+static code push_headers(block_chain& chain,
+    const block_const_ptr_list& branch, size_t fork_height,
+    latency_histogram& latency)
+{
+    hash_digest fork_hash;
+    if (!chain.get_block_hash(fork_hash, fork_height, true))
+        return error::operation_failed;
+
+    const auto headers = std::make_shared<header_const_ptr_list>();
+    headers->reserve(branch.size());
+
+    for (const auto block: branch)
+    {
+        const auto header = std::make_shared<message::header>(
+            block->header());
+        header->metadata.state = block->header().metadata.state;
+        headers->push_back(header);
+    }
+
+    const auto start = asio::steady_clock::now();
+    const auto ec = chain.reorganize({ fork_hash, fork_height }, headers);
+    record(latency, asio::steady_clock::now() - start);
+    return ec;
+}
+
+// Store each block and mark it as a valid candidate, as the block organizer
+// does upon download and validation (validation is not performed).
+static bool store_branch(block_chain& chain,
+    const block_const_ptr_list& branch, size_t fork_height,
+    round_metrics& metrics, bool candidate)
+{
+    auto height = fork_height;
+
+    for (const auto block: branch)
+    {
+        auto start = asio::steady_clock::now();
+        auto ec = chain.update(block, ++height);
+        record(metrics.store, asio::steady_clock::now() - start);
+
+        if (!succeeded(ec, "store", height))
+            return false;
+
+        if (!candidate)
+            continue;
+
+        start = asio::steady_clock::now();
+        ec = chain.candidate(block);
+        record(metrics.candidate, asio::steady_clock::now() - start);
+
+        if (!succeeded(ec, "candidate", height))
+            return false;
+    }
+
+    return true;
+}
+
+// Confirm the top block of the branch. Preceding blocks of the branch are
+// read from the candidate cache or the store, as when they were validated by
+// a previous organization (the usual case for blocks arriving one by one).
+static bool confirm(block_chain& chain, const block_const_ptr_list& branch,
+    size_t fork_height, round_metrics& metrics)
+{
+    const auto height = fork_height + branch.size();
+    const auto top = std::make_shared<block_const_ptr_list>(
+        block_const_ptr_list{ branch.back() });
+
+    if (!chain.is_reorganizable())
+        return succeeded(error::insufficient_work, "reorganize", height);
+
+    const auto start = asio::steady_clock::now();
+    const auto ec = chain.reorganize(top, height);
+    record(metrics.reorganize, asio::steady_clock::now() - start);
+    return succeeded(ec, "reorganize", height);
+}
+
+// Extend the confirmed chain from genesis, one block at a time.
+static bool build(block_chain& chain, size_t blocks, size_t spends,
+    size_t size, uint64_t& salt)
+{
+    round_metrics metrics;
+    block_const_ptr_list branch;
+    milliseconds elapsed(0);
+
+    for (size_t height = 0; height < blocks; ++height)
+    {
+        // Block construction is not measured.
+        if (!make_branch(branch, chain, height, 1, spends, salt))
+            return succeeded(error::operation_failed, "build", height + 1u);
+
+        const auto start = asio::steady_clock::now();
+
+        if (!succeeded(push_headers(chain, branch, height, metrics.headers),
+            "organize headers", height + 1u) ||
+            !store_branch(chain, branch, height, metrics, true) ||
+            !confirm(chain, branch, height, metrics))
+            return false;
+
+        elapsed += asio::steady_clock::now() - start;
+    }
+
+    std::cout << format(BS_BENCHREORG_BUILD) % blocks % size %
+        elapsed.count();
+    return true;
+}
+
+// Replace the top depth confirmed blocks with a stronger branch of one more.
+static bool run_reorganize(block_chain& chain, notification_probe& probe,
+    size_t depth, size_t rounds, size_t spends, uint64_t& salt,
+    round_metrics& metrics)
+{
+    block_const_ptr_list branch;
+
+    for (size_t round = 0; round < rounds; ++round)
+    {
+        size_t top;
+        if (!chain.get_top_height(top, false))
+            return succeeded(error::operation_failed, "reorganize", 0);
+
+        const auto fork_height = top - depth;
+        if (!make_branch(branch, chain, fork_height, depth + 1u, spends, salt))
+            return succeeded(error::operation_failed, "reorganize", top);
+
+        if (!succeeded(push_headers(chain, branch, fork_height,
+            metrics.headers), "organize headers", fork_height + 1u) ||
+            !store_branch(chain, branch, fork_height, metrics, true))
+            return false;
+
+        probe.expect(depth + 1u, depth, metrics.notify);
+
+        if (!confirm(chain, branch, fork_height, metrics) ||
+            !notified(probe, "reorganization", fork_height + 1u))
+            return false;
+    }
+
+    return true;
+}
+
+// Invalidate the first block of a branch of one more than the depth above
+// the top, which pops all of its candidates.
+static bool run_invalidate(block_chain& chain, notification_probe& probe,
+    size_t depth, size_t rounds, size_t spends, uint64_t& salt,
+    round_metrics& metrics)
+{
+    block_const_ptr_list branch;
+
+    for (size_t round = 0; round < rounds; ++round)
+    {
+        size_t top;
+        if (!chain.get_top_height(top, false))
+            return succeeded(error::operation_failed, "invalidate", 0);
+
+        if (!make_branch(branch, chain, top, depth + 1u, spends, salt))
+            return succeeded(error::operation_failed, "invalidate", top);
+
+        // A queued header notification is coalesced with the next if that
+        // pops only its incoming headers, so this one must be awaited.
+        latency_histogram pushed;
+        probe.expect(depth + 1u, 0, pushed);
+
+        if (!succeeded(push_headers(chain, branch, top, metrics.headers),
+            "organize headers", top + 1u) ||
+            !notified(probe, "organization", top + 1u) ||
+            !store_branch(chain, branch, top, metrics, false))
+            return false;
+
+        // As set by block validation.
+        auto& metadata = branch.front()->header().metadata;
+        metadata.error = error::invalid_proof_of_work;
+        metadata.validated = true;
+
+        probe.expect(0, depth + 1u, metrics.notify);
+
+        const auto start = asio::steady_clock::now();
+        const auto ec = chain.invalidate(branch.front(), top + 1u);
+        record(metrics.invalidate, asio::steady_clock::now() - start);
+
+        if (!succeeded(ec, "invalidate", top + 1u) ||
+            !notified(probe, "invalidation", top + 1u))
+            return false;
+    }
+
+    return true;
+}
+
+static void report(const std::string& phase, size_t depth,
+    const std::string& name, const latency_histogram& latency)
+{
+    std::cout << format(BS_BENCHREORG_STAGE) % phase % depth % name %
+        latency.count() % (latency.total() / 1000.0) %
+        latency.quantile(0.5) % latency.quantile(0.99) % latency.maximum();
+}
+
+static bool run(block_chain& chain, notification_probe& blocks,
+    notification_probe& headers, size_t depth, size_t rounds, size_t spends,
+    size_t cache, uint64_t& salt)
+{
+    round_metrics reorganize;
+    round_metrics invalidate;
+
+    // Preceding blocks are counted by the chain, across rounds of the depth.
+    const auto& metrics = chain.metrics();
+    const auto cached = metrics.cached_preceding();
+    const auto stored = metrics.stored_preceding();
+
+    if (!run_reorganize(chain, blocks, depth, rounds, spends, salt,
+        reorganize) ||
+        !run_invalidate(chain, headers, depth, rounds, spends, salt,
+        invalidate))
+        return false;
+
+    // Invalidation does not read preceding blocks.
+    std::cout << format(BS_BENCHREORG_READS) % "reorg" % depth %
+        (metrics.cached_preceding() - cached) %
+        (metrics.stored_preceding() - stored) % cache;
+    report("reorg", depth, "headers", reorganize.headers);
+    report("reorg", depth, "store", reorganize.store);
+    report("reorg", depth, "candidate", reorganize.candidate);
+    report("reorg", depth, "reorganize", reorganize.reorganize);
+    report("reorg", depth, "notify", reorganize.notify);
+    report("invalid", depth, "headers", invalidate.headers);
+    report("invalid", depth, "store", invalidate.store);
+    report("invalid", depth, "invalidate", invalidate.invalidate);
+    report("invalid", depth, "notify", invalidate.notify);
+    return true;
+}
+
+// Drive block reorganization and invalidation of a store-backed chain with
+// synthetic branches of each depth, for regression tracking of their costs.
+int main(int argc, char** argv)
+{
+    const auto argument = [argc, argv](int index, size_t fallback)
+    {
+        return index < argc ? std::stoul(argv[index]) : fallback;
+    };
+
+    blockchain::settings settings(config::settings::regtest);
+    database::settings database_settings(config::settings::regtest);
+    bc::settings bitcoin_settings(config::settings::regtest);
+
+    const auto blocks = argument(1, 1000);
+    const auto rounds = std::max(argument(2, 10), size_t(1));
+    const auto size = argument(3, 10000);
+    const auto cache = argument(4, settings.candidate_cache_megabytes);
+    const auto spends = size > empty_size ? (size - empty_size) / spend_size :
+        0u;
+
+    std::vector<size_t> depths;
+    for (auto arg = 5; arg < argc; ++arg)
+        depths.push_back(std::max(std::stoul(argv[arg]), 1ul));
+
+    if (depths.empty())
+        depths = { 1, 10, 100 };
+
+    const auto deepest = *std::max_element(depths.begin(), depths.end());
+
+    if (blocks <= deepest)
+    {
+        std::cerr << BS_BENCHREORG_USAGE;
+        return -1;
+    }
+
+    settings.candidate_cache_megabytes = static_cast<uint32_t>(cache);
+    settings.reorganization_limit = std::max(settings.reorganization_limit,
+        static_cast<uint32_t>(deepest + 1u));
+    database_settings.directory = directory;
+
+    boost::filesystem::remove_all(directory);
+    boost::filesystem::create_directories(directory);
+
+    const chain::block& genesis = bitcoin_settings.genesis_block;
+    data_base database(database_settings);
+
+    if (!database.create(genesis) || !database.close())
+    {
+        std::cerr << format(BS_BENCHREORG_STORE_FAIL) % directory;
+        return -1;
+    }
+
+    threadpool pool(thread_ceiling(settings.cores));
+    block_chain chain(pool, settings, database_settings, bitcoin_settings);
+    notification_probe block_probe;
+    notification_probe header_probe;
+
+    if (!chain.start())
+    {
+        std::cerr << BS_BENCHREORG_START_FAIL;
+        return -1;
+    }
+
+    chain.subscribe_blocks([&block_probe](code ec, size_t,
+        block_const_ptr_list_const_ptr incoming,
+        block_const_ptr_list_const_ptr outgoing)
+    {
+        if (ec == error::service_stopped)
+            return false;
+
+        if (incoming && outgoing)
+            block_probe.notify(incoming->size(), outgoing->size());
+
+        return true;
+    });
+
+    chain.subscribe_headers([&header_probe](code ec, size_t,
+        header_const_ptr_list_const_ptr incoming,
+        header_const_ptr_list_const_ptr outgoing)
+    {
+        if (ec == error::service_stopped)
+            return false;
+
+        if (incoming && outgoing)
+            header_probe.notify(incoming->size(), outgoing->size());
+
+        return true;
+    });
+
+    uint64_t salt = 0;
+    auto success = build(chain, blocks, spends, size, salt);
+
+    for (auto depth = depths.begin(); success && depth != depths.end();
+        ++depth)
+        success = run(chain, block_probe, header_probe, *depth, rounds,
+            spends, cache, salt);
+
+    // Subscriber invocation, excluding queueing to the notification thread.
+    if (success)
+        report("chain", 0, "invoke", chain.metrics().histogram(
+            stage_metrics::entity::block, stage_metrics::stage::notify));
+
+    chain.stop();
+    chain.close();
+    pool.shutdown();
+    pool.join();
+    boost::filesystem::remove_all(directory);
+    return success ? 0 : -1;
+}
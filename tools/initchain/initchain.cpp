@@ -16,18 +16,36 @@
  * You should have received a copy of the GNU Affero General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
 #include <boost/format.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
 #include <bitcoin/blockchain.hpp>
 #include <bitcoin/database.hpp>
 
+#define BS_INITCHAIN_USAGE \
+    "Usage: initchain [directory] [--clean] [--headers <headers> <block>]\n" \
+    "  headers: concatenated wire headers from genesis to the block\n" \
+    "  block:   hash of the trusted top block\n"
 #define BS_INITCHAIN_DIR_NEW \
     "Failed to create directory %1% with error, '%2%'.\n"
 #define BS_INITCHAIN_DIR_EXISTS \
     "Failed because the directory %1% already exists.\n"
 #define BS_INITCHAIN_FAIL \
     "Failed to initialize blockchain files.\n"
+#define BS_INITCHAIN_HEADERS_FAIL \
+    "Failed to verify headers of %1% to the trusted block: %2%\n"
+#define BS_INITCHAIN_IMPORT_FAIL \
+    "Failed to import headers to the store: %1%\n"
+#define BS_INITCHAIN_IMPORTED \
+    "Imported %1% candidate headers to #%2% [%3%].\n"
 
 using namespace bc;
 using namespace bc::blockchain;
@@ -37,15 +55,185 @@ using namespace boost::filesystem;
 using namespace boost::system;
 using boost::format;
 
-// Create a new mainnet blockchain database.
+// Headers are imported to the candidate index in runs of this many.
+static constexpr size_t import_batch = 50000;
+
+// The median time past of a header is that of the eleven preceding it.
+static constexpr size_t median_time_past_interval = 11;
+
+struct trusted_headers
+{
+    path headers;
+    hash_digest block;
+};
+
+static uint32_t median_time_past(std::vector<uint32_t> timestamps)
+{
+    if (timestamps.empty())
+        return 0;
+
+    const auto middle = timestamps.begin() + timestamps.size() / 2u;
+    std::nth_element(timestamps.begin(), middle, timestamps.end());
+    return *middle;
+}
+
+// The trusted block hash authenticates each header by its linkage, so the
+// headers are read in full and verified before any is stored.
+static code read_headers(header_const_ptr_list& out_headers,
+    const trusted_headers& source, const bc::settings& bitcoin_settings)
+{
+    boost::filesystem::ifstream stream(source.headers, std::ios::binary);
+    istream_reader reader(stream);
+    std::vector<uint32_t> timestamps;
+    const chain::block& genesis = bitcoin_settings.genesis_block;
+    auto previous = genesis.hash();
+    auto first = true;
+
+    while (!reader.is_exhausted())
+    {
+        const auto header = std::make_shared<message::header>();
+
+        if (!header->from_data(reader))
+            return error::bad_stream;
+
+        // The genesis header is already in the new store.
+        if (first)
+        {
+            first = false;
+
+            if (header->hash() != previous)
+                return error::checkpoints_failed;
+
+            timestamps.push_back(header->timestamp());
+            continue;
+        }
+
+        if (header->previous_block_hash() != previous)
+            return error::orphan_block;
+
+        const auto ec = header->check(bitcoin_settings.timestamp_limit_seconds,
+            bitcoin_settings.proof_of_work_limit, false);
+
+        if (ec)
+            return ec;
+
+        header->metadata.median_time_past = median_time_past(timestamps);
+        timestamps.push_back(header->timestamp());
+
+        if (timestamps.size() > median_time_past_interval)
+            timestamps.erase(timestamps.begin());
+
+        previous = header->hash();
+        out_headers.push_back(header);
+    }
+
+    if (out_headers.empty() || previous != source.block)
+        return error::checkpoints_failed;
+
+    return error::success;
+}
+
+// Headers are pushed to the candidate index from genesis, in batches.
+static code import_headers(data_base& database,
+    const header_const_ptr_list& headers, const hash_digest& genesis)
+{
+    config::checkpoint fork(genesis, 0);
+
+    for (auto it = headers.begin(); it != headers.end();)
+    {
+        const auto end = it + std::min(import_batch,
+            static_cast<size_t>(std::distance(it, headers.end())));
+        const auto incoming = std::make_shared<header_const_ptr_list>(it, end);
+        const auto outgoing = std::make_shared<header_const_ptr_list>();
+
+        const auto ec = database.reorganize(fork, incoming, outgoing);
+        if (ec)
+            return ec;
+
+        fork = { incoming->back()->hash(), fork.height() + incoming->size() };
+        it = end;
+    }
+
+    return error::success;
+}
+
+// Verify the headers and import them to the candidate index of a new store.
+// Blocks are not imported, so the confirmed chain remains at genesis and the
+// node downloads and validates each block of the candidate chain.
+static int bootstrap(const trusted_headers& source,
+    const database::settings& settings, const bc::settings& bitcoin_settings)
+{
+    header_const_ptr_list headers;
+    const auto ec = read_headers(headers, source, bitcoin_settings);
+
+    if (ec)
+    {
+        std::cerr << format(BS_INITCHAIN_HEADERS_FAIL) % source.headers %
+            ec.message();
+        return -1;
+    }
+
+    const chain::block& genesis = bitcoin_settings.genesis_block;
+    data_base database(settings);
+
+    if (!database.create(genesis))
+    {
+        std::cerr << BS_INITCHAIN_FAIL;
+        return -1;
+    }
+
+    const auto result = import_headers(database, headers, genesis.hash());
+
+    if (result)
+    {
+        std::cerr << format(BS_INITCHAIN_IMPORT_FAIL) % result.message();
+        return -1;
+    }
+
+    std::cout << format(BS_INITCHAIN_IMPORTED) % headers.size() %
+        headers.size() % encode_hash(source.block);
+
+    return database.close() ? 0 : -1;
+}
+
+// Create a new mainnet blockchain database, optionally with trusted headers.
 int main(int argc, char** argv)
 {
     std::string prefix("mainnet");
+    auto clean = false;
+    std::shared_ptr<trusted_headers> source;
+
+    for (auto arg = 1; arg < argc; ++arg)
+    {
+        const std::string option(argv[arg]);
 
-    if (argc > 1)
-        prefix = argv[1];
+        if (option == "--clean")
+        {
+            clean = true;
+        }
+        else if (option == "--headers" && arg + 2 < argc)
+        {
+            source = std::make_shared<trusted_headers>();
+            source->headers = argv[++arg];
 
-    if (argc > 2 && std::string("--clean") == argv[2])
+            if (!decode_hash(source->block, argv[++arg]))
+            {
+                std::cerr << BS_INITCHAIN_USAGE;
+                return -1;
+            }
+        }
+        else if (arg == 1 && option.find("--") != 0)
+        {
+            prefix = option;
+        }
+        else
+        {
+            std::cerr << BS_INITCHAIN_USAGE;
+            return -1;
+        }
+    }
+
+    if (clean)
         boost::filesystem::remove_all(prefix);
 
     error_code code;
@@ -63,6 +251,9 @@ int main(int argc, char** argv)
     database::settings settings(config::settings::mainnet);
      bc::settings bitcoin_settings(config::settings::mainnet);
 
+    if (source)
+        return bootstrap(*source, settings, bitcoin_settings);
+
     if (!data_base(settings).create(*(chain::block *)&(bitcoin_settings.genesis_block)))
     {
         std::cerr << BS_INITCHAIN_FAIL;
@@ -0,0 +1,462 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/format.hpp>
+#include <bitcoin/blockchain.hpp>
+#include <bitcoin/database.hpp>
+
+#define BS_REPLAYCHAIN_USAGE \
+    "Usage: replaychain <capture> [directory] [--base <store>] " \
+    "[--speed <factor>] [--network <name>]\n" \
+    "  capture:   workload capture written by the workload_file setting\n" \
+    "  directory: store replayed into, replaced (replaychain)\n" \
+    "  store:     copy of the store at the start of the capture, copied\n" \
+    "             into directory (a new store from genesis)\n" \
+    "  factor:    one for original timing, greater to accelerate, zero\n" \
+    "             to replay without waiting (1)\n" \
+    "  name:      mainnet, testnet or regtest, as captured (mainnet)\n"
+#define BS_REPLAYCHAIN_OPEN_FAIL \
+    "Failed to open the capture %1%.\n"
+#define BS_REPLAYCHAIN_STORE_FAIL \
+    "Failed to create the store in %1%.\n"
+#define BS_REPLAYCHAIN_COPY_FAIL \
+    "Failed to copy the store %1% to %2%.\n"
+#define BS_REPLAYCHAIN_BASE_MISMATCH \
+    "The store is at confirmed %1% and candidate %2%, the capture starts " \
+    "at confirmed %3% and candidate %4%.\n"
+#define BS_REPLAYCHAIN_START_FAIL \
+    "Failed to start the chain.\n"
+#define BS_REPLAYCHAIN_DECODE_FAIL \
+    "Failed to decode record %1% of the capture.\n"
+#define BS_REPLAYCHAIN_TRUNCATED \
+    "The capture ends with a partial record after record %1%.\n"
+#define BS_REPLAYCHAIN_REPLAY \
+    "replay   %8u records in %10.3fms  captured %10.3fms  " \
+    "max lag %10.3fms\n"
+#define BS_REPLAYCHAIN_ENTITY \
+    "%-12s count %8u  errors %8u  total %10.3fms  p50 %8uus  " \
+    "p99 %8uus  max %8uus\n"
+
+using namespace bc;
+using namespace bc::blockchain;
+using namespace bc::chain;
+using namespace bc::database;
+using boost::format;
+
+typedef workload_recorder::entity entity;
+typedef std::chrono::duration<double, std::milli> milliseconds;
+
+struct entity_metrics
+{
+    std::string name;
+    size_t errors;
+    latency_histogram latency;
+};
+
+static bool to_context(config::settings& out_context,
+    const std::string& network)
+{
+    if (network == "mainnet")
+        out_context = config::settings::mainnet;
+    else if (network == "testnet")
+        out_context = config::settings::testnet;
+    else if (network == "regtest")
+        out_context = config::settings::regtest;
+    else
+        return false;
+
+    return true;
+}
+
+// A capture replays only against the store it started from.
+static bool copy_store(const boost::filesystem::path& from,
+    const boost::filesystem::path& to)
+{
+    using namespace boost::filesystem;
+    boost::system::error_code ec;
+
+    for (directory_iterator it(from, ec), end; !ec && it != end;
+        it.increment(ec))
+    {
+        const auto target = to / it->path().filename();
+
+        if (is_directory(it->status()))
+        {
+            create_directories(target, ec);
+
+            if (!ec && !copy_store(it->path(), target))
+                return false;
+        }
+        else
+        {
+            copy_file(it->path(), target, ec);
+        }
+    }
+
+    return !ec;
+}
+
+static std::string to_string(const config::checkpoint& value)
+{
+    return std::to_string(value.height()) + ":" + encode_hash(value.hash());
+}
+
+static void record(latency_histogram& latency, const asio::duration& elapsed)
+{
+    const auto microseconds = std::chrono::duration_cast<
+        asio::microseconds>(elapsed).count();
+    latency.record(microseconds < 0 ? 0 : microseconds);
+}
+
+// Organize runs asynchronously, and each call is awaited so that the replay
+// order (and so the organizer inputs) is that of the capture.
+template <typename Result, typename Organize>
+static Result await(Organize&& organize)
+{
+    std::promise<Result> promise;
+    organize([&promise](const Result& result)
+    {
+        promise.set_value(result);
+    });
+
+    return promise.get_future().get();
+}
+
+// Returns the number of failed organize calls of the record, false if the
+// payload does not decode.
+static bool replay(size_t& out_errors, block_chain& target,
+    const workload_recorder::record& value)
+{
+    data_source stream(value.payload);
+    istream_reader source(stream);
+    out_errors = 0;
+
+    switch (value.type)
+    {
+        case entity::header:
+        {
+            chain::header header;
+            if (!header.from_data(source) || !source.is_exhausted())
+                return false;
+
+            const auto item = std::make_shared<const message::header>(
+                std::move(header));
+
+            out_errors = await<code>([&](result_handler handler)
+            {
+                target.organize(item, handler);
+            }) ? 1 : 0;
+
+            return true;
+        }
+        case entity::headers:
+        {
+            message::header::list headers;
+            const auto count = source.read_size_little_endian();
+
+            for (size_t index = 0; index < count && source; ++index)
+            {
+                chain::header header;
+                header.from_data(source);
+                headers.emplace_back(std::move(header));
+            }
+
+            if (!source || !source.is_exhausted())
+                return false;
+
+            const auto item = std::make_shared<const message::headers>(
+                std::move(headers));
+
+            out_errors = await<code>([&](result_handler handler)
+            {
+                target.organize(item, handler);
+            }) ? 1 : 0;
+
+            return true;
+        }
+        case entity::transaction:
+        {
+            chain::transaction tx;
+            if (!tx.from_data(source, true, true) || !source.is_exhausted())
+                return false;
+
+            const auto item = std::make_shared<const message::transaction>(
+                std::move(tx));
+
+            out_errors = await<code>([&](result_handler handler)
+            {
+                target.organize(item, handler);
+            }) ? 1 : 0;
+
+            return true;
+        }
+        case entity::transactions:
+        {
+            const auto txs = std::make_shared<transaction_const_ptr_list>();
+            const auto count = source.read_size_little_endian();
+
+            for (size_t index = 0; index < count && source; ++index)
+            {
+                chain::transaction tx;
+                tx.from_data(source, true, true);
+                txs->push_back(std::make_shared<const message::transaction>(
+                    std::move(tx)));
+            }
+
+            if (!source || !source.is_exhausted())
+                return false;
+
+            const auto results = await<std::vector<code>>(
+                [&](safe_chain::result_list_handler handler)
+            {
+                target.organize(txs, handler);
+            });
+
+            out_errors = std::count_if(results.begin(), results.end(),
+                [](const code& ec)
+                {
+                    return bool(ec);
+                });
+
+            return true;
+        }
+        case entity::block:
+        {
+            chain::block block;
+            if (!block.from_data(source, true) || !source.is_exhausted())
+                return false;
+
+            const auto item = std::make_shared<const message::block>(
+                std::move(block));
+
+            // Block organization is synchronous.
+            out_errors = target.organize(item, value.height) ? 1 : 0;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void report(const entity_metrics& metrics)
+{
+    const auto& latency = metrics.latency;
+    std::cout << format(BS_REPLAYCHAIN_ENTITY) % metrics.name %
+        latency.count() % metrics.errors % (latency.total() / 1000.0) %
+        latency.quantile(0.5) % latency.quantile(0.99) % latency.maximum();
+}
+
+int main(int argc, char** argv)
+{
+    boost::filesystem::path capture;
+    boost::filesystem::path directory("replaychain");
+    boost::filesystem::path base;
+    auto context = config::settings::mainnet;
+    auto speed = 1.0;
+
+    for (auto arg = 1; arg < argc; ++arg)
+    {
+        const std::string option(argv[arg]);
+
+        if (option == "--speed" && arg + 1 < argc)
+        {
+            speed = std::max(std::stod(argv[++arg]), 0.0);
+        }
+        else if (option == "--base" && arg + 1 < argc)
+        {
+            base = argv[++arg];
+        }
+        else if (option == "--network" && arg + 1 < argc)
+        {
+            if (!to_context(context, argv[++arg]))
+            {
+                std::cerr << BS_REPLAYCHAIN_USAGE;
+                return -1;
+            }
+        }
+        else if (capture.empty() && option.find("--") != 0)
+        {
+            capture = option;
+        }
+        else if (arg == 2 && option.find("--") != 0)
+        {
+            directory = option;
+        }
+        else
+        {
+            std::cerr << BS_REPLAYCHAIN_USAGE;
+            return -1;
+        }
+    }
+
+    if (capture.empty())
+    {
+        std::cerr << BS_REPLAYCHAIN_USAGE;
+        return -1;
+    }
+
+    boost::filesystem::ifstream stream(capture, std::ios::binary);
+    istream_reader source(stream);
+    config::checkpoint confirmed;
+    config::checkpoint candidate;
+
+    if (!stream ||
+        !workload_recorder::read_start(confirmed, candidate, source))
+    {
+        std::cerr << format(BS_REPLAYCHAIN_OPEN_FAIL) % capture;
+        return -1;
+    }
+
+    // The replay is not itself captured.
+    blockchain::settings settings(context);
+    database::settings database_settings(context);
+    bc::settings bitcoin_settings(context);
+    settings.workload_file.clear();
+    database_settings.directory = directory;
+
+    boost::filesystem::remove_all(directory);
+    boost::filesystem::create_directories(directory);
+
+    if (!base.empty())
+    {
+        if (!copy_store(base, directory))
+        {
+            std::cerr << format(BS_REPLAYCHAIN_COPY_FAIL) % base % directory;
+            return -1;
+        }
+    }
+    else
+    {
+        const chain::block& genesis = bitcoin_settings.genesis_block;
+        data_base database(database_settings);
+
+        if (!database.create(genesis) || !database.close())
+        {
+            std::cerr << format(BS_REPLAYCHAIN_STORE_FAIL) % directory;
+            return -1;
+        }
+    }
+
+    threadpool pool(thread_ceiling(settings.cores));
+    block_chain chain(pool, settings, database_settings, bitcoin_settings);
+
+    if (!chain.start())
+    {
+        std::cerr << BS_REPLAYCHAIN_START_FAIL;
+        return -1;
+    }
+
+    // Replayed against other tops the organizer inputs would not be those of
+    // the capture, so its timings would not be comparable.
+    const auto top = chain.top_candidate_state();
+    const config::checkpoint top_candidate{ top->hash(), top->height() };
+    const auto fork_point = chain.fork_point();
+
+    if (!(fork_point == confirmed) || !(top_candidate == candidate))
+    {
+        std::cerr << format(BS_REPLAYCHAIN_BASE_MISMATCH) %
+            to_string(fork_point) % to_string(top_candidate) %
+            to_string(confirmed) % to_string(candidate);
+
+        chain.stop();
+        chain.close();
+        pool.shutdown();
+        pool.join();
+        return -1;
+    }
+
+    std::vector<entity_metrics> metrics(5);
+    metrics[0].name = "header";
+    metrics[1].name = "headers";
+    metrics[2].name = "transaction";
+    metrics[3].name = "transactions";
+    metrics[4].name = "block";
+
+    workload_recorder::record value;
+    size_t records = 0;
+    uint64_t captured = 0;
+    asio::duration lag(0);
+    auto result = 0;
+    const auto start = asio::steady_clock::now();
+
+    while (workload_recorder::read(value, source))
+    {
+        captured += value.microseconds;
+
+        // Each record is scheduled at its (scaled) capture offset, and once
+        // the replay falls behind it proceeds without waiting to catch up.
+        if (speed > 0.0)
+        {
+            const auto offset = std::chrono::duration_cast<asio::duration>(
+                asio::microseconds(captured) / speed);
+            const auto now = asio::steady_clock::now();
+
+            if (now < start + offset)
+                std::this_thread::sleep_until(start + offset);
+            else
+                lag = std::max(lag, asio::duration(now - start - offset));
+        }
+
+        auto& entry = metrics[static_cast<size_t>(value.type)];
+        const auto begin = asio::steady_clock::now();
+        size_t errors;
+
+        if (!replay(errors, chain, value))
+        {
+            std::cerr << format(BS_REPLAYCHAIN_DECODE_FAIL) % records;
+            result = -1;
+            break;
+        }
+
+        record(entry.latency, asio::steady_clock::now() - begin);
+        entry.errors += errors;
+        ++records;
+    }
+
+    // A capture of a stopped (or killed) node may end with a partial record.
+    if (result == 0 && !source.is_exhausted())
+        std::cerr << format(BS_REPLAYCHAIN_TRUNCATED) % records;
+
+    const milliseconds elapsed(asio::steady_clock::now() - start);
+    const milliseconds maximum_lag(lag);
+
+    std::cout << format(BS_REPLAYCHAIN_REPLAY) % records % elapsed.count() %
+        (captured / 1000.0) % maximum_lag.count();
+
+    for (const auto& entry: metrics)
+        report(entry);
+
+    chain.stop();
+    chain.close();
+    pool.shutdown();
+    pool.join();
+    return result;
+}